@@ -368,6 +368,16 @@ ClassDB::APIType ClassDB::get_api_type(const StringName &p_class) {
 	return ti->api;
 }
 
+void *ClassDB::get_class_ptr(const StringName &p_class) {
+
+	OBJTYPE_RLOCK;
+
+	ClassInfo *ti = classes.getptr(p_class);
+
+	ERR_FAIL_COND_V_MSG(!ti, nullptr, "Cannot get class '" + String(p_class) + "'.");
+	return ti->class_ptr;
+}
+
 uint64_t ClassDB::get_api_hash(APIType p_api) {
 
 	OBJTYPE_RLOCK;
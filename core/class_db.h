@@ -34,6 +34,7 @@
 #include "core/method_bind.h"
 #include "core/object.h"
 #include "core/print_string.h"
+#include "core/swiss_hash_map.h"
 
 /** To bind more then 6 parameters include this:
  *  #include "core/method_bind_ext.gen.inc"
@@ -117,7 +118,7 @@ public:
 		APIType api;
 		ClassInfo *inherits_ptr;
 		void *class_ptr;
-		HashMap<StringName, MethodBind *> method_map;
+		SwissHashMap<StringName, MethodBind *> method_map;
 		HashMap<StringName, int> constant_map;
 		HashMap<StringName, List<StringName>> enum_map;
 		HashMap<StringName, MethodInfo> signal_map;
@@ -129,7 +130,7 @@ public:
 		List<MethodInfo> virtual_methods;
 		StringName category;
 #endif
-		HashMap<StringName, PropertySetGet> property_setget;
+		SwissHashMap<StringName, PropertySetGet> property_setget;
 
 		StringName inherits;
 		StringName name;
@@ -226,6 +227,8 @@ public:
 	static bool can_instance(const StringName &p_class);
 	static Object *instance(const StringName &p_class);
 	static APIType get_api_type(const StringName &p_class);
+	// Pointer matched by Object::is_class_ptr() for instances of p_class and its subclasses.
+	static void *get_class_ptr(const StringName &p_class);
 
 	static uint64_t get_api_hash(APIType p_api);
 
@@ -32,84 +32,214 @@
 
 #include "core/os/os.h"
 
-void CommandQueueMT::lock() {
+#include <thread>
 
-	mutex.lock();
+static std::atomic<uint64_t> last_queue_id(0);
+
+// Producers a thread owns, released when the thread exits so other threads can reuse their buffers.
+struct CommandQueueMTProducerCache {
+	struct Entry {
+		uint64_t queue_id;
+		CommandQueueMT::Producer *producer;
+		Entry *next;
+	};
+
+	Entry *entries = nullptr;
+
+	~CommandQueueMTProducerCache() {
+		while (entries) {
+			Entry *e = entries;
+			entries = e->next;
+			e->producer->orphaned.store(true, std::memory_order_release);
+			CommandQueueMT::_unref_producer(e->producer);
+			memdelete(e);
+		}
+	}
+};
+
+static thread_local CommandQueueMTProducerCache producer_cache;
+
+CommandQueueMT::Producer *CommandQueueMT::_get_producer() {
+
+	for (CommandQueueMTProducerCache::Entry *e = producer_cache.entries; e; e = e->next) {
+		if (e->queue_id == id) {
+			return e->producer;
+		}
+	}
+
+	// First push from this thread, take over the buffer of a thread that exited, or make a new one.
+	Producer *producer = nullptr;
+	for (Producer *p = producers.load(std::memory_order_acquire); p; p = p->next) {
+		bool expected = true;
+		if (p->orphaned.load(std::memory_order_relaxed) && p->orphaned.compare_exchange_strong(expected, false, std::memory_order_acquire)) {
+			p->refcount.fetch_add(1, std::memory_order_relaxed);
+			producer = p;
+			break;
+		}
+	}
+
+	if (!producer) {
+		producer = _create_producer();
+	}
+
+	CommandQueueMTProducerCache::Entry *e = memnew(CommandQueueMTProducerCache::Entry);
+	e->queue_id = id;
+	e->producer = producer;
+	e->next = producer_cache.entries;
+	producer_cache.entries = e;
+
+	return producer;
 }
 
-void CommandQueueMT::unlock() {
+CommandQueueMT::Producer *CommandQueueMT::_create_producer() {
 
-	mutex.unlock();
+	Producer *producer = memnew(Producer);
+	producer->command_mem = (uint8_t *)memalloc(COMMAND_MEM_SIZE);
+	producer->write_ptr.store(0);
+	producer->dealloc_ptr.store(0);
+	producer->orphaned.store(false);
+	producer->refcount.store(2);
+
+	Producer *head = producers.load(std::memory_order_relaxed);
+	do {
+		producer->next = head;
+	} while (!producers.compare_exchange_weak(head, producer, std::memory_order_release, std::memory_order_relaxed));
+
+	return producer;
 }
 
-void CommandQueueMT::wait_for_flush() {
+void CommandQueueMT::_unref_producer(Producer *p_producer) {
 
-	// wait one millisecond for a flush to happen
-	OS::get_singleton()->delay_usec(1000);
+	if (p_producer->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		memfree(p_producer->command_mem);
+		memdelete(p_producer);
+	}
 }
 
-CommandQueueMT::SyncSemaphore *CommandQueueMT::_alloc_sync_sem() {
+bool CommandQueueMT::_peek(Producer *p_producer, uint64_t &r_seq) {
 
-	int idx = -1;
+	uint32_t write_ptr = p_producer->write_ptr.load(std::memory_order_acquire);
+	if (p_producer->read_ptr == write_ptr) {
+		return false;
+	}
 
-	while (true) {
+	CommandHeader *header = (CommandHeader *)&p_producer->command_mem[p_producer->read_ptr];
+	if (header->size == 0) {
+		// End of ring buffer, wrap.
+		p_producer->read_ptr = 0;
+		if (write_ptr == 0) {
+			return false;
+		}
+		header = (CommandHeader *)p_producer->command_mem;
+	}
+
+	r_seq = header->seq;
+	return true;
+}
 
-		lock();
-		for (int i = 0; i < SYNC_SEMAPHORES; i++) {
+bool CommandQueueMT::_has_commands() {
+
+	for (Producer *p = producers.load(std::memory_order_acquire); p; p = p->next) {
+		if (p->read_ptr != p->write_ptr.load(std::memory_order_acquire)) {
+			return true;
+		}
+	}
+	return false;
+}
 
-			if (!sync_sems[i].in_use) {
-				sync_sems[i].in_use = true;
-				idx = i;
-				break;
+bool CommandQueueMT::flush_one() {
+
+	MutexLock lock(consumer_mutex);
+
+	Producer *producer = nullptr;
+
+	while (true) {
+		uint64_t min_seq = 0;
+		producer = nullptr;
+
+		for (Producer *p = producers.load(std::memory_order_acquire); p; p = p->next) {
+			uint64_t seq;
+			if (_peek(p, seq) && (!producer || seq < min_seq)) {
+				producer = p;
+				min_seq = seq;
 			}
 		}
-		unlock();
 
-		if (idx == -1) {
-			wait_for_flush();
-		} else {
-			break;
+		if (!producer) {
+			// Tried to read an empty queue.
+			return false;
 		}
-	}
 
-	return &sync_sems[idx];
-}
+		if (min_seq == read_seq) {
+			break;
+		}
 
-bool CommandQueueMT::dealloc_one() {
-tryagain:
-	if (dealloc_ptr == write_ptr) {
-		// The queue is empty
-		return false;
+		// Another thread got an earlier sequence number, and is about to commit it.
+		std::this_thread::yield();
 	}
 
-	uint32_t size = *(uint32_t *)&command_mem[dealloc_ptr];
+	read_seq++;
 
-	if (size == 0) {
-		// End of command buffer wrap down
-		dealloc_ptr = 0;
-		goto tryagain;
-	}
+	CommandHeader *header = (CommandHeader *)&producer->command_mem[producer->read_ptr];
+	CommandBase *cmd = reinterpret_cast<CommandBase *>(&producer->command_mem[producer->read_ptr + sizeof(CommandHeader)]);
+	producer->read_ptr += sizeof(CommandHeader) + header->size;
 
-	if (size & 1) {
-		// Still used, nothing can be deallocated
-		return false;
+	flush_depth++;
+	cmd->call();
+	cmd->post();
+	cmd->~CommandBase();
+	flush_depth--;
+
+	if (flush_depth == 0) {
+		// Only give memory back once no command is running, a command may flush the queue recursively.
+		for (Producer *p = producers.load(std::memory_order_acquire); p; p = p->next) {
+			if (p->dealloc_ptr.load(std::memory_order_relaxed) != p->read_ptr) {
+				p->dealloc_ptr.store(p->read_ptr, std::memory_order_release);
+			}
+		}
 	}
 
-	dealloc_ptr += (size >> 1) + 8;
 	return true;
 }
 
-CommandQueueMT::CommandQueueMT(bool p_sync) {
+void CommandQueueMT::wait_and_flush_one() {
 
-	read_ptr = 0;
-	write_ptr = 0;
-	dealloc_ptr = 0;
-	command_mem = (uint8_t *)memalloc(COMMAND_MEM_SIZE);
+	ERR_FAIL_COND(!sync);
 
-	for (int i = 0; i < SYNC_SEMAPHORES; i++) {
+	while (!flush_one()) {
+		consumer_waiting.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
 
-		sync_sems[i].in_use = false;
+		// Check again now that producers can see us waiting.
+		if (_has_commands()) {
+			consumer_waiting.store(false, std::memory_order_relaxed);
+			continue;
+		}
+
+		sync->wait();
 	}
+}
+
+void CommandQueueMT::flush_all() {
+
+	MutexLock lock(consumer_mutex);
+	while (flush_one())
+		;
+}
+
+void CommandQueueMT::wait_for_flush() {
+
+	// wait one millisecond for a flush to happen
+	OS::get_singleton()->delay_usec(1000);
+}
+
+CommandQueueMT::CommandQueueMT(bool p_sync) {
+
+	id = last_queue_id.fetch_add(1) + 1;
+	producers.store(nullptr);
+	write_seq.store(0);
+	consumer_waiting.store(false);
+
 	if (p_sync)
 		sync = memnew(Semaphore);
 	else
@@ -120,5 +250,12 @@ CommandQueueMT::~CommandQueueMT() {
 
 	if (sync)
 		memdelete(sync);
-	memfree(command_mem);
+
+	// Threads that pushed commands keep their buffer alive until they exit.
+	Producer *p = producers.load(std::memory_order_acquire);
+	while (p) {
+		Producer *next = p->next;
+		_unref_producer(p);
+		p = next;
+	}
 }
@@ -37,6 +37,8 @@
 #include "core/simple_type.h"
 #include "core/typedefs.h"
 
+#include <atomic>
+
 #define COMMA(N) _COMMA_##N
 #define _COMMA_0
 #define _COMMA_1 ,
@@ -248,12 +250,12 @@
 #define DECL_PUSH(N)                                                         \
 	template <class T, class M COMMA(N) COMMA_SEP_LIST(TYPE_PARAM, N)>       \
 	void push(T *p_instance, M p_method COMMA(N) COMMA_SEP_LIST(PARAM, N)) { \
-		CMD_TYPE(N) *cmd = allocate_and_lock<CMD_TYPE(N)>();                 \
+		Producer *producer = _get_producer();                                \
+		CMD_TYPE(N) *cmd = allocate<CMD_TYPE(N)>(producer);                  \
 		cmd->instance = p_instance;                                          \
 		cmd->method = p_method;                                              \
 		SEMIC_SEP_LIST(CMD_ASSIGN_PARAM, N);                                 \
-		unlock();                                                            \
-		if (sync) sync->post();                                              \
+		commit(producer);                                                    \
 	}
 
 #define CMD_RET_TYPE(N) CommandRet##N<T, M, COMMA_SEP_LIST(TYPE_ARG, N) COMMA(N) R>
@@ -261,17 +263,16 @@
 #define DECL_PUSH_AND_RET(N)                                                                   \
 	template <class T, class M, COMMA_SEP_LIST(TYPE_PARAM, N) COMMA(N) class R>                \
 	void push_and_ret(T *p_instance, M p_method, COMMA_SEP_LIST(PARAM, N) COMMA(N) R *r_ret) { \
-		SyncSemaphore *ss = _alloc_sync_sem();                                                 \
-		CMD_RET_TYPE(N) *cmd = allocate_and_lock<CMD_RET_TYPE(N)>();                           \
+		Producer *producer = _get_producer();                                                  \
+		SyncSemaphore *ss = &producer->sync_sem;                                               \
+		CMD_RET_TYPE(N) *cmd = allocate<CMD_RET_TYPE(N)>(producer);                            \
 		cmd->instance = p_instance;                                                            \
 		cmd->method = p_method;                                                                \
 		SEMIC_SEP_LIST(CMD_ASSIGN_PARAM, N);                                                   \
 		cmd->ret = r_ret;                                                                      \
 		cmd->sync_sem = ss;                                                                    \
-		unlock();                                                                              \
-		if (sync) sync->post();                                                                \
+		commit(producer);                                                                      \
 		ss->sem.wait();                                                                        \
-		ss->in_use = false;                                                                    \
 	}
 
 #define CMD_SYNC_TYPE(N) CommandSync##N<T, M COMMA(N) COMMA_SEP_LIST(TYPE_ARG, N)>
@@ -279,16 +280,15 @@
 #define DECL_PUSH_AND_SYNC(N)                                                         \
 	template <class T, class M COMMA(N) COMMA_SEP_LIST(TYPE_PARAM, N)>                \
 	void push_and_sync(T *p_instance, M p_method COMMA(N) COMMA_SEP_LIST(PARAM, N)) { \
-		SyncSemaphore *ss = _alloc_sync_sem();                                        \
-		CMD_SYNC_TYPE(N) *cmd = allocate_and_lock<CMD_SYNC_TYPE(N)>();                \
+		Producer *producer = _get_producer();                                         \
+		SyncSemaphore *ss = &producer->sync_sem;                                      \
+		CMD_SYNC_TYPE(N) *cmd = allocate<CMD_SYNC_TYPE(N)>(producer);                 \
 		cmd->instance = p_instance;                                                   \
 		cmd->method = p_method;                                                       \
 		SEMIC_SEP_LIST(CMD_ASSIGN_PARAM, N);                                          \
 		cmd->sync_sem = ss;                                                           \
-		unlock();                                                                     \
-		if (sync) sync->post();                                                       \
+		commit(producer);                                                             \
 		ss->sem.wait();                                                               \
-		ss->in_use = false;                                                           \
 	}
 
 #define MAX_CMD_PARAMS 15
@@ -298,7 +298,6 @@ class CommandQueueMT {
 	struct SyncSemaphore {
 
 		Semaphore sem;
-		bool in_use;
 	};
 
 	struct CommandBase {
@@ -333,132 +332,106 @@ class CommandQueueMT {
 	enum {
 		COMMAND_MEM_SIZE_KB = 256,
 		COMMAND_MEM_SIZE = COMMAND_MEM_SIZE_KB * 1024,
-		SYNC_SEMAPHORES = 8
 	};
 
-	uint8_t *command_mem;
-	uint32_t read_ptr;
-	uint32_t write_ptr;
-	uint32_t dealloc_ptr;
-	SyncSemaphore sync_sems[SYNC_SEMAPHORES];
-	Mutex mutex;
-	Semaphore *sync;
-
-	template <class T>
-	T *allocate() {
+	// Every command is preceded by a header. A zero size marks the end of the
+	// ring buffer, the next command is at the beginning.
+	struct CommandHeader {
+		uint32_t size;
+		uint32_t padding;
+		uint64_t seq;
+	};
 
-		// alloc size is size+T+safeguard
-		uint32_t alloc_size = ((sizeof(T) + 8 - 1) & ~(8 - 1)) + 8;
+	// Each thread pushing commands gets its own single-producer ring buffer, so
+	// pushing never takes a lock. The only state shared between producers is the
+	// sequence counter, the consumer replays commands in sequence order so the
+	// queue behaves exactly like a single locked buffer would.
+	struct Producer {
+		uint8_t *command_mem = nullptr;
+		std::atomic<uint32_t> write_ptr; // Published by the producer.
+		std::atomic<uint32_t> dealloc_ptr; // Released by the consumer once commands are destroyed.
+		uint32_t read_ptr = 0; // Consumer only.
+		uint32_t pending_write_ptr = 0; // Producer only, end of the command being built.
+		CommandHeader *pending_header = nullptr; // Producer only.
+		std::atomic<bool> orphaned; // Owner thread exited, can be claimed by another one.
+		std::atomic<uint32_t> refcount; // The queue, plus the owner thread.
+		SyncSemaphore sync_sem;
+		Producer *next = nullptr;
+	};
 
-	tryagain:
+	uint64_t id;
+	std::atomic<Producer *> producers;
+	std::atomic<uint64_t> write_seq;
+	uint64_t read_seq = 0;
 
-		if (write_ptr < dealloc_ptr) {
-			// behind dealloc_ptr, check that there is room
-			if ((dealloc_ptr - write_ptr) <= alloc_size) {
+	Mutex consumer_mutex;
+	int flush_depth = 0;
+	std::atomic<bool> consumer_waiting;
+	Semaphore *sync;
 
-				// There is no more room, try to deallocate something
-				if (dealloc_one()) {
-					goto tryagain;
-				}
-				return nullptr;
-			}
-		} else {
-			// ahead of dealloc_ptr, check that there is room
+	template <class T>
+	T *allocate(Producer *p_producer) {
 
-			if ((COMMAND_MEM_SIZE - write_ptr) < alloc_size + sizeof(uint32_t)) {
-				// no room at the end, wrap down;
+		// Round up so every header and command stays 16 bytes aligned.
+		uint32_t size = (sizeof(T) + 16 - 1) & ~(16 - 1);
+		uint32_t alloc_size = sizeof(CommandHeader) + size;
+		uint32_t write_ptr = p_producer->write_ptr.load(std::memory_order_relaxed);
 
-				if (dealloc_ptr == 0) { // don't want write_ptr to become dealloc_ptr
+		while (true) {
+			uint32_t dealloc_ptr = p_producer->dealloc_ptr.load(std::memory_order_acquire);
 
-					// There is no more room, try to deallocate something
-					if (dealloc_one()) {
-						goto tryagain;
-					}
-					return nullptr;
+			if (write_ptr < dealloc_ptr) {
+				// Behind dealloc_ptr, write_ptr must never catch up with it or the buffer would look empty.
+				if (dealloc_ptr - write_ptr > alloc_size) {
+					break;
+				}
+			} else {
+				// Ahead of dealloc_ptr, always keep room at the end for a wrap marker.
+				if (COMMAND_MEM_SIZE - write_ptr >= alloc_size + sizeof(CommandHeader)) {
+					break;
+				}
+				if (dealloc_ptr > alloc_size) {
+					// The consumer can't see the marker before the command is committed.
+					((CommandHeader *)&p_producer->command_mem[write_ptr])->size = 0;
+					write_ptr = 0;
+					continue;
 				}
-
-				// if this happens, it's a bug
-				ERR_FAIL_COND_V((COMMAND_MEM_SIZE - write_ptr) < 8, nullptr);
-				// zero means, wrap to beginning
-
-				uint32_t *p = (uint32_t *)&command_mem[write_ptr];
-				*p = 0;
-				write_ptr = 0;
-				goto tryagain;
 			}
-		}
-		// Allocate the size and the 'in use' bit.
-		// First bit used to mark if command is still in use (1)
-		// or if it has been destroyed and can be deallocated (0).
-		uint32_t size = (sizeof(T) + 8 - 1) & ~(8 - 1);
-		uint32_t *p = (uint32_t *)&command_mem[write_ptr];
-		*p = (size << 1) | 1;
-		write_ptr += 8;
-		// allocate the command
-		T *cmd = memnew_placement(&command_mem[write_ptr], T);
-		write_ptr += size;
-		return cmd;
-	}
-
-	template <class T>
-	T *allocate_and_lock() {
 
-		lock();
-		T *ret;
-
-		while ((ret = allocate<T>()) == nullptr) {
-
-			unlock();
-			// sleep a little until fetch happened and some room is made
+			// Sleep a little until the consumer makes some room.
 			wait_for_flush();
-			lock();
 		}
 
-		return ret;
-	}
+		CommandHeader *header = (CommandHeader *)&p_producer->command_mem[write_ptr];
+		header->size = size;
+		p_producer->pending_header = header;
+		p_producer->pending_write_ptr = write_ptr + alloc_size;
 
-	bool flush_one(bool p_lock = true) {
-		if (p_lock) lock();
-	tryagain:
+		return memnew_placement(&p_producer->command_mem[write_ptr + sizeof(CommandHeader)], T);
+	}
 
-		// tried to read an empty queue
-		if (read_ptr == write_ptr) {
-			if (p_lock) unlock();
-			return false;
-		}
+	_FORCE_INLINE_ void commit(Producer *p_producer) {
 
-		uint32_t size_ptr = read_ptr;
-		uint32_t size = *(uint32_t *)&command_mem[read_ptr] >> 1;
+		p_producer->pending_header->seq = write_seq.fetch_add(1, std::memory_order_relaxed);
+		p_producer->write_ptr.store(p_producer->pending_write_ptr, std::memory_order_release);
 
-		if (size == 0) {
-			//end of ringbuffer, wrap
-			read_ptr = 0;
-			goto tryagain;
+		if (sync) {
+			// Pairs with the fence in wait_and_flush_one(), either we see the consumer going to sleep or it sees the command.
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (consumer_waiting.load(std::memory_order_relaxed) && consumer_waiting.exchange(false)) {
+				sync->post();
+			}
 		}
-
-		read_ptr += 8;
-
-		CommandBase *cmd = reinterpret_cast<CommandBase *>(&command_mem[read_ptr]);
-
-		read_ptr += size;
-
-		if (p_lock) unlock();
-		cmd->call();
-		if (p_lock) lock();
-
-		cmd->post();
-		cmd->~CommandBase();
-		*(uint32_t *)&command_mem[size_ptr] &= ~1;
-
-		if (p_lock) unlock();
-		return true;
 	}
 
-	void lock();
-	void unlock();
+	friend struct CommandQueueMTProducerCache;
+
+	Producer *_get_producer();
+	Producer *_create_producer();
+	static void _unref_producer(Producer *p_producer);
+	bool _peek(Producer *p_producer, uint64_t &r_seq);
+	bool _has_commands();
 	void wait_for_flush();
-	SyncSemaphore *_alloc_sync_sem();
-	bool dealloc_one();
 
 public:
 	/* NORMAL PUSH COMMANDS */
@@ -473,20 +446,10 @@ public:
 	DECL_PUSH_AND_SYNC(0)
 	SPACE_SEP_LIST(DECL_PUSH_AND_SYNC, 15)
 
-	void wait_and_flush_one() {
-		ERR_FAIL_COND(!sync);
-		sync->wait();
-		flush_one();
-	}
-
-	void flush_all() {
-
-		//ERR_FAIL_COND(sync);
-		lock();
-		while (flush_one(false))
-			;
-		unlock();
-	}
+	// Consumer side. Commands from all threads run in the order they were pushed.
+	bool flush_one();
+	void wait_and_flush_one();
+	void flush_all();
 
 	CommandQueueMT(bool p_sync);
 	~CommandQueueMT();
@@ -85,6 +85,14 @@ private:
 		return next_power_of_2(p_elements * sizeof(T));
 	}
 
+	// Bytes actually allocated, which is either an exact fit (first
+	// allocation) or a power of two (after growing or copy on write).
+	_FORCE_INLINE_ size_t _get_capacity() const {
+		if (!_ptr)
+			return 0;
+		return Memory::get_padded_size(_ptr);
+	}
+
 	_FORCE_INLINE_ bool _get_alloc_size_checked(size_t p_elements, size_t *out) const {
 #if defined(__GNUC__)
 		size_t o;
@@ -268,16 +276,17 @@ Error CowData<T>::resize(int p_size) {
 	// possibly changing size, copy on write
 	_copy_on_write();
 
-	size_t current_alloc_size = _get_alloc_size(current_size);
+	size_t current_alloc_size = _get_capacity();
 	size_t alloc_size;
 	ERR_FAIL_COND_V(!_get_alloc_size_checked(p_size, &alloc_size), ERR_OUT_OF_MEMORY);
 
 	if (p_size > current_size) {
 
-		if (alloc_size != current_alloc_size) {
+		if (p_size * sizeof(T) > current_alloc_size) {
 			if (current_size == 0) {
-				// alloc from scratch
-				uint32_t *ptr = (uint32_t *)Memory::alloc_static(alloc_size, true);
+				// alloc from scratch, with an exact fit since most strings
+				// and arrays are sized once and never grow afterwards.
+				uint32_t *ptr = (uint32_t *)Memory::alloc_static(p_size * sizeof(T), true);
 				ERR_FAIL_COND_V(!ptr, ERR_OUT_OF_MEMORY);
 				*(ptr - 1) = 0; //size, currently none
 				*(ptr - 2) = 1; //refcount
@@ -285,6 +294,7 @@ Error CowData<T>::resize(int p_size) {
 				_ptr = (T *)ptr;
 
 			} else {
+				// growing, round up so appending stays amortized
 				void *_ptrnew = (T *)Memory::realloc_static(_ptr, alloc_size, true);
 				ERR_FAIL_COND_V(!_ptrnew, ERR_OUT_OF_MEMORY);
 				_ptr = (T *)(_ptrnew);
@@ -313,7 +323,9 @@ Error CowData<T>::resize(int p_size) {
 			}
 		}
 
-		if (alloc_size != current_alloc_size) {
+		// only give memory back once less than half is used, so removing
+		// elements one by one doesn't reallocate every time
+		if (alloc_size <= current_alloc_size / 2) {
 			void *_ptrnew = (T *)Memory::realloc_static(_ptr, alloc_size, true);
 			ERR_FAIL_COND_V(!_ptrnew, ERR_OUT_OF_MEMORY);
 
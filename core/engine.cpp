@@ -217,6 +217,10 @@ Engine *Engine::get_singleton() {
 bool Engine::is_abort_on_gpu_errors_enabled() const {
 	return abort_on_gpu_errors;
 }
+
+String Engine::get_script_profile_path() const {
+	return script_profile_path;
+}
 Engine::Engine() {
 
 	singleton = this;
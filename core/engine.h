@@ -65,6 +65,7 @@ private:
 	uint64_t _physics_frames;
 	float _physics_interpolation_fraction;
 	bool abort_on_gpu_errors;
+	String script_profile_path;
 
 	uint64_t _idle_frames;
 	bool _in_physics;
@@ -128,6 +129,7 @@ public:
 	String get_license_text() const;
 
 	bool is_abort_on_gpu_errors_enabled() const;
+	String get_script_profile_path() const;
 
 	Engine();
 	virtual ~Engine() {}
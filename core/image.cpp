@@ -33,6 +33,7 @@
 #include "core/hash_map.h"
 #include "core/io/image_loader.h"
 #include "core/io/resource_loader.h"
+#include "core/job_system.h"
 #include "core/math/math_funcs.h"
 #include "core/os/copymem.h"
 #include "core/print_string.h"
@@ -41,6 +42,14 @@
 
 #include <stdio.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IMAGE_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define IMAGE_NEON
+#endif
+
 const char *Image::format_names[Image::FORMAT_MAX] = {
 	"Lum8", //luminance
 	"LumAlpha8", //luminance-alpha
@@ -389,17 +398,88 @@ int Image::get_mipmap_count() const {
 		return 0;
 }
 
+// Large images are split in bands of rows which are processed on the job
+// system, smaller ones aren't worth the scheduling.
+enum {
+	IMAGE_PARALLEL_MIN_BYTES = 256 * 1024,
+	IMAGE_BAND_BYTES = 64 * 1024,
+};
+
+typedef void (*ImageRowFunc)(const void *p_params, uint32_t p_from, uint32_t p_to);
+
+struct ImageRowBands {
+	ImageRowFunc func = nullptr;
+	const void *params = nullptr;
+	uint32_t rows = 0;
+	uint32_t band_rows = 0;
+
+	void process(uint32_t p_band, void *) {
+		uint32_t from = p_band * band_rows;
+		func(params, from, MIN(from + band_rows, rows));
+	}
+};
+
+static void _process_rows(ImageRowFunc p_func, const void *p_params, uint32_t p_rows, uint64_t p_row_bytes) {
+
+	JobSystem *job_system = JobSystem::get_singleton();
+	if (!job_system || job_system->get_thread_count() == 0 || p_rows < 2 || p_rows * p_row_bytes < IMAGE_PARALLEL_MIN_BYTES) {
+		p_func(p_params, 0, p_rows);
+		return;
+	}
+
+	ImageRowBands bands;
+	bands.func = p_func;
+	bands.params = p_params;
+	bands.rows = p_rows;
+	bands.band_rows = CLAMP(uint32_t(IMAGE_BAND_BYTES / MAX(p_row_bytes, (uint64_t)1)), 1u, p_rows);
+	job_system->do_work((p_rows + bands.band_rows - 1) / bands.band_rows, &bands, &ImageRowBands::process, (void *)nullptr, 1);
+}
+
+struct ImageRowParams {
+	const uint8_t *src;
+	uint8_t *dst;
+	uint32_t width;
+};
+
 //using template generates perfectly optimized code due to constant expression reduction and unused variable removal present in all compilers
 template <uint32_t read_bytes, bool read_alpha, uint32_t write_bytes, bool write_alpha, bool read_gray, bool write_gray>
-static void _convert(int p_width, int p_height, const uint8_t *p_src, uint8_t *p_dst) {
+static void _convert_rows(const void *p_params, uint32_t p_from, uint32_t p_to) {
+
+	const ImageRowParams *params = (const ImageRowParams *)p_params;
+	const uint8_t *src = params->src;
+	uint8_t *dst = params->dst;
+	int width = params->width;
 
 	uint32_t max_bytes = MAX(read_bytes, write_bytes);
 
-	for (int y = 0; y < p_height; y++) {
-		for (int x = 0; x < p_width; x++) {
+	for (int y = p_from; y < int(p_to); y++) {
+
+		int x = 0;
+
+#ifndef BIG_ENDIAN_ENABLED
+		// RGB8 <-> RGBA8 move whole pixels as 32-bit words. The last pixel of
+		// the row is left to the generic code, as its word would cross into
+		// the next row (or past the end of the image).
+		if (read_bytes == 3 && write_bytes == 3 && !read_gray && !write_gray && read_alpha != write_alpha) {
+			const uint8_t *rofs = &src[y * width * (read_alpha ? 4 : 3)];
+			uint8_t *wofs = &dst[y * width * (write_alpha ? 4 : 3)];
+			for (; x < width - 1; x++) {
+				uint32_t pixel;
+				memcpy(&pixel, rofs, 4);
+				if (write_alpha) {
+					pixel |= 0xFF000000;
+				}
+				memcpy(wofs, &pixel, 4);
+				rofs += read_alpha ? 4 : 3;
+				wofs += write_alpha ? 4 : 3;
+			}
+		}
+#endif
+
+		for (; x < width; x++) {
 
-			const uint8_t *rofs = &p_src[((y * p_width) + x) * (read_bytes + (read_alpha ? 1 : 0))];
-			uint8_t *wofs = &p_dst[((y * p_width) + x) * (write_bytes + (write_alpha ? 1 : 0))];
+			const uint8_t *rofs = &src[((y * width) + x) * (read_bytes + (read_alpha ? 1 : 0))];
+			uint8_t *wofs = &dst[((y * width) + x) * (write_bytes + (write_alpha ? 1 : 0))];
 
 			uint8_t rgba[4];
 
@@ -436,6 +516,16 @@ static void _convert(int p_width, int p_height, const uint8_t *p_src, uint8_t *p
 	}
 }
 
+template <uint32_t read_bytes, bool read_alpha, uint32_t write_bytes, bool write_alpha, bool read_gray, bool write_gray>
+static void _convert(int p_width, int p_height, const uint8_t *p_src, uint8_t *p_dst) {
+
+	ImageRowParams params;
+	params.src = p_src;
+	params.dst = p_dst;
+	params.width = p_width;
+	_process_rows(_convert_rows<read_bytes, read_alpha, write_bytes, write_alpha, read_gray, write_gray>, &params, p_height, uint64_t(p_width) * (write_bytes + (write_alpha ? 1 : 0)));
+}
+
 void Image::convert(Format p_new_format) {
 
 	if (data.size() == 0)
@@ -537,14 +627,32 @@ static double _bicubic_interp_kernel(double x) {
 	return bc;
 }
 
+struct ImageScaleParams {
+	const uint8_t *src;
+	uint8_t *dst;
+	uint32_t src_width;
+	uint32_t src_height;
+	uint32_t dst_width;
+	uint32_t dst_height;
+	const uint32_t *columns; // Source offsets of every destination column, for the kernels that use them.
+};
+
 template <int CC, class T>
-static void _scale_cubic(const uint8_t *__restrict p_src, uint8_t *__restrict p_dst, uint32_t p_src_width, uint32_t p_src_height, uint32_t p_dst_width, uint32_t p_dst_height) {
+static void _scale_cubic_rows(const void *p_params, uint32_t p_from, uint32_t p_to) {
+
+	const ImageScaleParams *params = (const ImageScaleParams *)p_params;
+	const uint8_t *__restrict src_data = params->src;
+	uint8_t *__restrict dst_data = params->dst;
+	uint32_t src_width = params->src_width;
+	uint32_t src_height = params->src_height;
+	uint32_t dst_width = params->dst_width;
+	uint32_t dst_height = params->dst_height;
 
 	// get source image size
-	int width = p_src_width;
-	int height = p_src_height;
-	double xfac = (double)width / p_dst_width;
-	double yfac = (double)height / p_dst_height;
+	int width = src_width;
+	int height = src_height;
+	double xfac = (double)width / dst_width;
+	double yfac = (double)height / dst_height;
 	// coordinates of source points and coefficients
 	double ox, oy, dx, dy, k1, k2;
 	int ox1, oy1, ox2, oy2;
@@ -554,13 +662,13 @@ static void _scale_cubic(const uint8_t *__restrict p_src, uint8_t *__restrict p_
 	int xmax = width - 1;
 	// temporary pointer
 
-	for (uint32_t y = 0; y < p_dst_height; y++) {
+	for (uint32_t y = p_from; y < p_to; y++) {
 		// Y coordinates
 		oy = (double)y * yfac - 0.5f;
 		oy1 = (int)oy;
 		dy = oy - (double)oy1;
 
-		for (uint32_t x = 0; x < p_dst_width; x++) {
+		for (uint32_t x = 0; x < dst_width; x++) {
 			// X coordinates
 			ox = (double)x * xfac - 0.5f;
 			ox1 = (int)ox;
@@ -568,7 +676,7 @@ static void _scale_cubic(const uint8_t *__restrict p_src, uint8_t *__restrict p_
 
 			// initial pixel value
 
-			T *__restrict dst = ((T *)p_dst) + (y * p_dst_width + x) * CC;
+			T *__restrict dst = ((T *)dst_data) + (y * dst_width + x) * CC;
 
 			double color[CC];
 			for (int i = 0; i < CC; i++) {
@@ -596,7 +704,7 @@ static void _scale_cubic(const uint8_t *__restrict p_src, uint8_t *__restrict p_
 						ox2 = xmax;
 
 					// get pixel of original image
-					const T *__restrict p = ((T *)p_src) + (oy2 * p_src_width + ox2) * CC;
+					const T *__restrict p = ((T *)src_data) + (oy2 * src_width + ox2) * CC;
 
 					for (int i = 0; i < CC; i++) {
 						if (sizeof(T) == 2) { //half float
@@ -621,63 +729,65 @@ static void _scale_cubic(const uint8_t *__restrict p_src, uint8_t *__restrict p_
 	}
 }
 
-template <int CC, class T>
-static void _scale_bilinear(const uint8_t *__restrict p_src, uint8_t *__restrict p_dst, uint32_t p_src_width, uint32_t p_src_height, uint32_t p_dst_width, uint32_t p_dst_height) {
+enum {
+	BILINEAR_FRAC_BITS = 8,
+	BILINEAR_FRAC_LEN = (1 << BILINEAR_FRAC_BITS),
+	BILINEAR_FRAC_MASK = BILINEAR_FRAC_LEN - 1
+};
 
-	enum {
-		FRAC_BITS = 8,
-		FRAC_LEN = (1 << FRAC_BITS),
-		FRAC_MASK = FRAC_LEN - 1
+template <int CC, class T>
+static void _scale_bilinear_rows(const void *p_params, uint32_t p_from, uint32_t p_to) {
 
-	};
+	const ImageScaleParams *params = (const ImageScaleParams *)p_params;
+	const uint8_t *__restrict src_data = params->src;
+	uint8_t *__restrict dst_data = params->dst;
+	uint32_t src_width = params->src_width;
+	uint32_t src_height = params->src_height;
+	uint32_t dst_width = params->dst_width;
+	uint32_t dst_height = params->dst_height;
+	const uint32_t *columns = params->columns;
 
-	for (uint32_t i = 0; i < p_dst_height; i++) {
+	for (uint32_t i = p_from; i < p_to; i++) {
 
-		uint32_t src_yofs_up_fp = (i * p_src_height * FRAC_LEN / p_dst_height);
-		uint32_t src_yofs_frac = src_yofs_up_fp & FRAC_MASK;
-		uint32_t src_yofs_up = src_yofs_up_fp >> FRAC_BITS;
+		uint32_t src_yofs_up_fp = (i * src_height * BILINEAR_FRAC_LEN / dst_height);
+		uint32_t src_yofs_frac = src_yofs_up_fp & BILINEAR_FRAC_MASK;
+		uint32_t src_yofs_up = src_yofs_up_fp >> BILINEAR_FRAC_BITS;
 
-		uint32_t src_yofs_down = (i + 1) * p_src_height / p_dst_height;
-		if (src_yofs_down >= p_src_height)
-			src_yofs_down = p_src_height - 1;
+		uint32_t src_yofs_down = (i + 1) * src_height / dst_height;
+		if (src_yofs_down >= src_height)
+			src_yofs_down = src_height - 1;
 
 		//src_yofs_up*=CC;
 		//src_yofs_down*=CC;
 
-		uint32_t y_ofs_up = src_yofs_up * p_src_width * CC;
-		uint32_t y_ofs_down = src_yofs_down * p_src_width * CC;
-
-		for (uint32_t j = 0; j < p_dst_width; j++) {
+		uint32_t y_ofs_up = src_yofs_up * src_width * CC;
+		uint32_t y_ofs_down = src_yofs_down * src_width * CC;
 
-			uint32_t src_xofs_left_fp = (j * p_src_width * FRAC_LEN / p_dst_width);
-			uint32_t src_xofs_frac = src_xofs_left_fp & FRAC_MASK;
-			uint32_t src_xofs_left = src_xofs_left_fp >> FRAC_BITS;
-			uint32_t src_xofs_right = (j + 1) * p_src_width / p_dst_width;
-			if (src_xofs_right >= p_src_width)
-				src_xofs_right = p_src_width - 1;
+		for (uint32_t j = 0; j < dst_width; j++) {
 
-			src_xofs_left *= CC;
-			src_xofs_right *= CC;
+			uint32_t src_xofs_left = columns[j * 3 + 0];
+			uint32_t src_xofs_right = columns[j * 3 + 1];
+			uint32_t src_xofs_frac = columns[j * 3 + 2];
 
 			for (uint32_t l = 0; l < CC; l++) {
 
 				if (sizeof(T) == 1) { //uint8
-					uint32_t p00 = p_src[y_ofs_up + src_xofs_left + l] << FRAC_BITS;
-					uint32_t p10 = p_src[y_ofs_up + src_xofs_right + l] << FRAC_BITS;
-					uint32_t p01 = p_src[y_ofs_down + src_xofs_left + l] << FRAC_BITS;
-					uint32_t p11 = p_src[y_ofs_down + src_xofs_right + l] << FRAC_BITS;
-
-					uint32_t interp_up = p00 + (((p10 - p00) * src_xofs_frac) >> FRAC_BITS);
-					uint32_t interp_down = p01 + (((p11 - p01) * src_xofs_frac) >> FRAC_BITS);
-					uint32_t interp = interp_up + (((interp_down - interp_up) * src_yofs_frac) >> FRAC_BITS);
-					interp >>= FRAC_BITS;
-					p_dst[i * p_dst_width * CC + j * CC + l] = interp;
+					uint32_t p00 = src_data[y_ofs_up + src_xofs_left + l] << BILINEAR_FRAC_BITS;
+					uint32_t p10 = src_data[y_ofs_up + src_xofs_right + l] << BILINEAR_FRAC_BITS;
+					uint32_t p01 = src_data[y_ofs_down + src_xofs_left + l] << BILINEAR_FRAC_BITS;
+					uint32_t p11 = src_data[y_ofs_down + src_xofs_right + l] << BILINEAR_FRAC_BITS;
+
+					uint32_t interp_up = p00 + (((p10 - p00) * src_xofs_frac) >> BILINEAR_FRAC_BITS);
+					uint32_t interp_down = p01 + (((p11 - p01) * src_xofs_frac) >> BILINEAR_FRAC_BITS);
+					uint32_t interp = interp_up + (((interp_down - interp_up) * src_yofs_frac) >> BILINEAR_FRAC_BITS);
+					interp >>= BILINEAR_FRAC_BITS;
+					dst_data[i * dst_width * CC + j * CC + l] = interp;
 				} else if (sizeof(T) == 2) { //half float
 
-					float xofs_frac = float(src_xofs_frac) / (1 << FRAC_BITS);
-					float yofs_frac = float(src_yofs_frac) / (1 << FRAC_BITS);
-					const T *src = ((const T *)p_src);
-					T *dst = ((T *)p_dst);
+					float xofs_frac = float(src_xofs_frac) / (1 << BILINEAR_FRAC_BITS);
+					float yofs_frac = float(src_yofs_frac) / (1 << BILINEAR_FRAC_BITS);
+					const T *src = ((const T *)src_data);
+					T *dst = ((T *)dst_data);
 
 					float p00 = Math::half_to_float(src[y_ofs_up + src_xofs_left + l]);
 					float p10 = Math::half_to_float(src[y_ofs_up + src_xofs_right + l]);
@@ -688,13 +798,13 @@ static void _scale_bilinear(const uint8_t *__restrict p_src, uint8_t *__restrict
 					float interp_down = p01 + (p11 - p01) * xofs_frac;
 					float interp = interp_up + ((interp_down - interp_up) * yofs_frac);
 
-					dst[i * p_dst_width * CC + j * CC + l] = Math::make_half_float(interp);
+					dst[i * dst_width * CC + j * CC + l] = Math::make_half_float(interp);
 				} else if (sizeof(T) == 4) { //float
 
-					float xofs_frac = float(src_xofs_frac) / (1 << FRAC_BITS);
-					float yofs_frac = float(src_yofs_frac) / (1 << FRAC_BITS);
-					const T *src = ((const T *)p_src);
-					T *dst = ((T *)p_dst);
+					float xofs_frac = float(src_xofs_frac) / (1 << BILINEAR_FRAC_BITS);
+					float yofs_frac = float(src_yofs_frac) / (1 << BILINEAR_FRAC_BITS);
+					const T *src = ((const T *)src_data);
+					T *dst = ((T *)dst_data);
 
 					float p00 = src[y_ofs_up + src_xofs_left + l];
 					float p10 = src[y_ofs_up + src_xofs_right + l];
@@ -705,7 +815,7 @@ static void _scale_bilinear(const uint8_t *__restrict p_src, uint8_t *__restrict
 					float interp_down = p01 + (p11 - p01) * xofs_frac;
 					float interp = interp_up + ((interp_down - interp_up) * yofs_frac);
 
-					dst[i * p_dst_width * CC + j * CC + l] = interp;
+					dst[i * dst_width * CC + j * CC + l] = interp;
 				}
 			}
 		}
@@ -713,30 +823,82 @@ static void _scale_bilinear(const uint8_t *__restrict p_src, uint8_t *__restrict
 }
 
 template <int CC, class T>
-static void _scale_nearest(const uint8_t *__restrict p_src, uint8_t *__restrict p_dst, uint32_t p_src_width, uint32_t p_src_height, uint32_t p_dst_width, uint32_t p_dst_height) {
+static void _scale_nearest_rows(const void *p_params, uint32_t p_from, uint32_t p_to) {
+
+	const ImageScaleParams *params = (const ImageScaleParams *)p_params;
+	const uint8_t *__restrict src_data = params->src;
+	uint8_t *__restrict dst_data = params->dst;
+	uint32_t src_width = params->src_width;
+	uint32_t src_height = params->src_height;
+	uint32_t dst_width = params->dst_width;
+	uint32_t dst_height = params->dst_height;
+	const uint32_t *columns = params->columns;
 
-	for (uint32_t i = 0; i < p_dst_height; i++) {
+	for (uint32_t i = p_from; i < p_to; i++) {
 
-		uint32_t src_yofs = i * p_src_height / p_dst_height;
-		uint32_t y_ofs = src_yofs * p_src_width * CC;
+		uint32_t src_yofs = i * src_height / dst_height;
+		uint32_t y_ofs = src_yofs * src_width * CC;
 
-		for (uint32_t j = 0; j < p_dst_width; j++) {
+		for (uint32_t j = 0; j < dst_width; j++) {
 
-			uint32_t src_xofs = j * p_src_width / p_dst_width;
-			src_xofs *= CC;
+			uint32_t src_xofs = columns[j];
 
 			for (uint32_t l = 0; l < CC; l++) {
 
-				const T *src = ((const T *)p_src);
-				T *dst = ((T *)p_dst);
+				const T *src = ((const T *)src_data);
+				T *dst = ((T *)dst_data);
 
 				T p = src[y_ofs + src_xofs + l];
-				dst[i * p_dst_width * CC + j * CC + l] = p;
+				dst[i * dst_width * CC + j * CC + l] = p;
 			}
 		}
 	}
 }
 
+template <int CC, class T>
+static void _scale_cubic(const uint8_t *__restrict p_src, uint8_t *__restrict p_dst, uint32_t p_src_width, uint32_t p_src_height, uint32_t p_dst_width, uint32_t p_dst_height) {
+
+	ImageScaleParams params = { p_src, p_dst, p_src_width, p_src_height, p_dst_width, p_dst_height, nullptr };
+	_process_rows(_scale_cubic_rows<CC, T>, &params, p_dst_height, uint64_t(p_dst_width) * CC * sizeof(T));
+}
+
+template <int CC, class T>
+static void _scale_bilinear(const uint8_t *__restrict p_src, uint8_t *__restrict p_dst, uint32_t p_src_width, uint32_t p_src_height, uint32_t p_dst_width, uint32_t p_dst_height) {
+
+	// Columns are the same for every row, so they are only computed once.
+	Vector<uint32_t> columns;
+	columns.resize(p_dst_width * 3);
+	uint32_t *columns_ptr = columns.ptrw();
+	for (uint32_t j = 0; j < p_dst_width; j++) {
+
+		uint32_t src_xofs_left_fp = (j * p_src_width * BILINEAR_FRAC_LEN / p_dst_width);
+		uint32_t src_xofs_right = (j + 1) * p_src_width / p_dst_width;
+		if (src_xofs_right >= p_src_width)
+			src_xofs_right = p_src_width - 1;
+
+		columns_ptr[j * 3 + 0] = (src_xofs_left_fp >> BILINEAR_FRAC_BITS) * CC;
+		columns_ptr[j * 3 + 1] = src_xofs_right * CC;
+		columns_ptr[j * 3 + 2] = src_xofs_left_fp & BILINEAR_FRAC_MASK;
+	}
+
+	ImageScaleParams params = { p_src, p_dst, p_src_width, p_src_height, p_dst_width, p_dst_height, columns.ptr() };
+	_process_rows(_scale_bilinear_rows<CC, T>, &params, p_dst_height, uint64_t(p_dst_width) * CC * sizeof(T));
+}
+
+template <int CC, class T>
+static void _scale_nearest(const uint8_t *__restrict p_src, uint8_t *__restrict p_dst, uint32_t p_src_width, uint32_t p_src_height, uint32_t p_dst_width, uint32_t p_dst_height) {
+
+	Vector<uint32_t> columns;
+	columns.resize(p_dst_width);
+	uint32_t *columns_ptr = columns.ptrw();
+	for (uint32_t j = 0; j < p_dst_width; j++) {
+		columns_ptr[j] = j * p_src_width / p_dst_width * CC;
+	}
+
+	ImageScaleParams params = { p_src, p_dst, p_src_width, p_src_height, p_dst_width, p_dst_height, columns.ptr() };
+	_process_rows(_scale_nearest_rows<CC, T>, &params, p_dst_height, uint64_t(p_dst_width) * CC * sizeof(T));
+}
+
 #define LANCZOS_TYPE 3
 
 static float _lanczos(float p_x) {
@@ -1284,25 +1446,103 @@ bool Image::_can_modify(Format p_format) const {
 	return p_format <= FORMAT_RGBE9995;
 }
 
+// Averages the 2x2 blocks of up to p_count RGBA destination pixels with
+// vector instructions, and returns how many were done.
+template <class Component>
+static uint32_t _average_rgba_row(const Component *p_up, const Component *p_down, Component *p_dst, uint32_t p_count) {
+	return 0;
+}
+
+static uint32_t _average_rgba_row(const uint8_t *p_up, const uint8_t *p_down, uint8_t *p_dst, uint32_t p_count) {
+
+	uint32_t done = 0;
+#if defined(IMAGE_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(2);
+	for (; done + 2 <= p_count; done += 2) {
+		__m128i up = _mm_loadu_si128((const __m128i *)(p_up + done * 8));
+		__m128i down = _mm_loadu_si128((const __m128i *)(p_down + done * 8));
+		// Vertical sums as 16 bits, two source pixels per half.
+		__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(up, zero), _mm_unpacklo_epi8(down, zero));
+		__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(up, zero), _mm_unpackhi_epi8(down, zero));
+		lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+		hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+		__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), round), 2);
+		_mm_storel_epi64((__m128i *)(p_dst + done * 4), _mm_packus_epi16(sum, sum));
+	}
+#elif defined(IMAGE_NEON)
+	for (; done + 2 <= p_count; done += 2) {
+		uint8x16_t up = vld1q_u8(p_up + done * 8);
+		uint8x16_t down = vld1q_u8(p_down + done * 8);
+		uint16x8_t lo = vaddl_u8(vget_low_u8(up), vget_low_u8(down));
+		uint16x8_t hi = vaddl_u8(vget_high_u8(up), vget_high_u8(down));
+		uint16x8_t sum = vcombine_u16(vadd_u16(vget_low_u16(lo), vget_high_u16(lo)), vadd_u16(vget_low_u16(hi), vget_high_u16(hi)));
+		vst1_u8(p_dst + done * 4, vrshrn_n_u16(sum, 2));
+	}
+#endif
+	return done;
+}
+
+static uint32_t _average_rgba_row(const float *p_up, const float *p_down, float *p_dst, uint32_t p_count) {
+
+	uint32_t done = 0;
+	// Summed in the same order as Image::average_4_float(), so results don't change.
+#if defined(IMAGE_SSE2)
+	const __m128 quarter = _mm_set1_ps(0.25f);
+	for (; done < p_count; done++) {
+		__m128 sum = _mm_add_ps(_mm_loadu_ps(p_up + done * 8), _mm_loadu_ps(p_up + done * 8 + 4));
+		sum = _mm_add_ps(_mm_add_ps(sum, _mm_loadu_ps(p_down + done * 8)), _mm_loadu_ps(p_down + done * 8 + 4));
+		_mm_storeu_ps(p_dst + done * 4, _mm_mul_ps(sum, quarter));
+	}
+#elif defined(IMAGE_NEON)
+	for (; done < p_count; done++) {
+		float32x4_t sum = vaddq_f32(vld1q_f32(p_up + done * 8), vld1q_f32(p_up + done * 8 + 4));
+		sum = vaddq_f32(vaddq_f32(sum, vld1q_f32(p_down + done * 8)), vld1q_f32(p_down + done * 8 + 4));
+		vst1q_f32(p_dst + done * 4, vmulq_n_f32(sum, 0.25f));
+	}
+#endif
+	return done;
+}
+
+struct ImageMipmapParams {
+	const void *src;
+	void *dst;
+	uint32_t width;
+	uint32_t height;
+};
+
 template <class Component, int CC, bool renormalize,
 		void (*average_func)(Component &, const Component &, const Component &, const Component &, const Component &),
 		void (*renormalize_func)(Component *)>
-static void _generate_po2_mipmap(const Component *p_src, Component *p_dst, uint32_t p_width, uint32_t p_height) {
+static void _generate_po2_mipmap_rows(const void *p_params, uint32_t p_from, uint32_t p_to) {
+
+	const ImageMipmapParams *params = (const ImageMipmapParams *)p_params;
+	const Component *src = (const Component *)params->src;
+	Component *dst = (Component *)params->dst;
+	uint32_t width = params->width;
+	uint32_t height = params->height;
 
 	//fast power of 2 mipmap generation
-	uint32_t dst_w = MAX(p_width >> 1, 1);
-	uint32_t dst_h = MAX(p_height >> 1, 1);
+	uint32_t dst_w = MAX(width >> 1, 1);
 
-	int right_step = (p_width == 1) ? 0 : CC;
-	int down_step = (p_height == 1) ? 0 : (p_width * CC);
+	int right_step = (width == 1) ? 0 : CC;
+	int down_step = (height == 1) ? 0 : (width * CC);
 
-	for (uint32_t i = 0; i < dst_h; i++) {
+	for (uint32_t i = p_from; i < p_to; i++) {
 
-		const Component *rup_ptr = &p_src[i * 2 * down_step];
+		const Component *rup_ptr = &src[i * 2 * down_step];
 		const Component *rdown_ptr = rup_ptr + down_step;
-		Component *dst_ptr = &p_dst[i * dst_w * CC];
+		Component *dst_ptr = &dst[i * dst_w * CC];
 		uint32_t count = dst_w;
 
+		if (CC == 4 && !renormalize && right_step) {
+			uint32_t done = _average_rgba_row(rup_ptr, rdown_ptr, dst_ptr, count);
+			count -= done;
+			dst_ptr += done * CC;
+			rup_ptr += done * right_step * 2;
+			rdown_ptr += done * right_step * 2;
+		}
+
 		while (count) {
 			count--;
 			for (int j = 0; j < CC; j++) {
@@ -1320,6 +1560,17 @@ static void _generate_po2_mipmap(const Component *p_src, Component *p_dst, uint3
 	}
 }
 
+template <class Component, int CC, bool renormalize,
+		void (*average_func)(Component &, const Component &, const Component &, const Component &, const Component &),
+		void (*renormalize_func)(Component *)>
+static void _generate_po2_mipmap(const Component *p_src, Component *p_dst, uint32_t p_width, uint32_t p_height) {
+
+	ImageMipmapParams params = { p_src, p_dst, p_width, p_height };
+	uint32_t dst_w = MAX(p_width >> 1, 1);
+	uint32_t dst_h = MAX(p_height >> 1, 1);
+	_process_rows(_generate_po2_mipmap_rows<Component, CC, renormalize, average_func, renormalize_func>, &params, dst_h, uint64_t(dst_w) * CC * sizeof(Component));
+}
+
 void Image::expand_x2_hq2x() {
 
 	ERR_FAIL_COND(!_can_modify(format));
@@ -2553,11 +2804,11 @@ void (*Image::_image_decompress_etc1)(Image *) = nullptr;
 void (*Image::_image_decompress_etc2)(Image *) = nullptr;
 
 Vector<uint8_t> (*Image::lossy_packer)(const Ref<Image> &, float) = nullptr;
-Ref<Image> (*Image::lossy_unpacker)(const Vector<uint8_t> &) = nullptr;
+Ref<Image> (*Image::lossy_unpacker)(const uint8_t *, int) = nullptr;
 Vector<uint8_t> (*Image::lossless_packer)(const Ref<Image> &) = nullptr;
-Ref<Image> (*Image::lossless_unpacker)(const Vector<uint8_t> &) = nullptr;
+Ref<Image> (*Image::lossless_unpacker)(const uint8_t *, int) = nullptr;
 Vector<uint8_t> (*Image::basis_universal_packer)(const Ref<Image> &, Image::UsedChannels) = nullptr;
-Ref<Image> (*Image::basis_universal_unpacker)(const Vector<uint8_t> &) = nullptr;
+Ref<Image> (*Image::basis_universal_unpacker)(const uint8_t *, int) = nullptr;
 
 void Image::_set_data(const Dictionary &p_data) {
 
@@ -3212,6 +3463,50 @@ void Image::srgb_to_linear() {
 	}
 }
 
+static void _premultiply_alpha_rows(const void *p_params, uint32_t p_from, uint32_t p_to) {
+
+	const ImageRowParams *params = (const ImageRowParams *)p_params;
+	uint8_t *ptr = &params->dst[p_from * params->width * 4];
+	uint32_t count = (p_to - p_from) * params->width;
+	uint32_t done = 0;
+
+#if defined(IMAGE_SSE2)
+	// Alpha is multiplied by 256, so it's kept as is after the shift.
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i keep_rgb = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+	const __m128i alpha_one = _mm_set_epi16(256, 0, 0, 0, 256, 0, 0, 0);
+	for (; done + 4 <= count; done += 4) {
+		__m128i pixels = _mm_loadu_si128((const __m128i *)(ptr + done * 4));
+		__m128i lo = _mm_unpacklo_epi8(pixels, zero);
+		__m128i hi = _mm_unpackhi_epi8(pixels, zero);
+		__m128i lo_alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		__m128i hi_alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		lo = _mm_srli_epi16(_mm_mullo_epi16(lo, _mm_or_si128(_mm_and_si128(lo_alpha, keep_rgb), alpha_one)), 8);
+		hi = _mm_srli_epi16(_mm_mullo_epi16(hi, _mm_or_si128(_mm_and_si128(hi_alpha, keep_rgb), alpha_one)), 8);
+		_mm_storeu_si128((__m128i *)(ptr + done * 4), _mm_packus_epi16(lo, hi));
+	}
+#elif defined(IMAGE_NEON)
+	for (; done + 16 <= count; done += 16) {
+		uint8x16x4_t pixels = vld4q_u8(ptr + done * 4);
+		for (int i = 0; i < 3; i++) {
+			uint16x8_t lo = vmull_u8(vget_low_u8(pixels.val[i]), vget_low_u8(pixels.val[3]));
+			uint16x8_t hi = vmull_u8(vget_high_u8(pixels.val[i]), vget_high_u8(pixels.val[3]));
+			pixels.val[i] = vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8));
+		}
+		vst4q_u8(ptr + done * 4, pixels);
+	}
+#endif
+
+	for (; done < count; done++) {
+
+		uint8_t *pixel = &ptr[done * 4];
+
+		pixel[0] = (uint16_t(pixel[0]) * uint16_t(pixel[3])) >> 8;
+		pixel[1] = (uint16_t(pixel[1]) * uint16_t(pixel[3])) >> 8;
+		pixel[2] = (uint16_t(pixel[2]) * uint16_t(pixel[3])) >> 8;
+	}
+}
+
 void Image::premultiply_alpha() {
 
 	if (data.size() == 0)
@@ -3220,18 +3515,11 @@ void Image::premultiply_alpha() {
 	if (format != FORMAT_RGBA8)
 		return; //not needed
 
-	uint8_t *data_ptr = data.ptrw();
-
-	for (int i = 0; i < height; i++) {
-		for (int j = 0; j < width; j++) {
-
-			uint8_t *ptr = &data_ptr[(i * width + j) * 4];
-
-			ptr[0] = (uint16_t(ptr[0]) * uint16_t(ptr[3])) >> 8;
-			ptr[1] = (uint16_t(ptr[1]) * uint16_t(ptr[3])) >> 8;
-			ptr[2] = (uint16_t(ptr[2]) * uint16_t(ptr[3])) >> 8;
-		}
-	}
+	ImageRowParams params;
+	params.src = nullptr;
+	params.dst = data.ptrw();
+	params.width = width;
+	_process_rows(_premultiply_alpha_rows, &params, height, uint64_t(width) * 4);
 }
 
 void Image::fix_alpha_edges() {
@@ -30,16 +30,317 @@
 
 #include "compression.h"
 
+#include "core/hash_map.h"
+#include "core/hashfuncs.h"
 #include "core/io/zip_io.h"
 #include "core/os/copymem.h"
 #include "core/project_settings.h"
+#include "core/spin_lock.h"
 
 #include "thirdparty/misc/fastlz.h"
 
 #include <zlib.h>
 #include <zstd.h>
 
-int Compression::compress(uint8_t *p_dst, const uint8_t *p_src, int p_src_size, Mode p_mode) {
+struct CompressionDictionary {
+	uint32_t id = 0;
+	uint32_t refcount = 0;
+	Vector<uint8_t> data; // Kept to tell dictionaries with colliding ids apart.
+	ZSTD_CDict *cdict = nullptr;
+	ZSTD_DDict *ddict = nullptr;
+};
+
+enum {
+	MAX_DICTIONARIES = 32,
+};
+
+static SpinLock dictionaries_lock;
+static CompressionDictionary dictionaries[MAX_DICTIONARIES];
+
+static CompressionDictionary *_find_dictionary(uint32_t p_id) {
+	for (int i = 0; i < MAX_DICTIONARIES; i++) {
+		if (dictionaries[i].id == p_id) {
+			return &dictionaries[i];
+		}
+	}
+	return nullptr;
+}
+
+static bool _is_same_dictionary(const CompressionDictionary *p_dictionary, const Vector<uint8_t> &p_data) {
+	return p_dictionary->data.size() == p_data.size() && memcmp(p_dictionary->data.ptr(), p_data.ptr(), p_data.size()) == 0;
+}
+
+// Creating zstd contexts costs more than compressing a small payload, so every
+// thread keeps its own.
+struct ZSTDThreadContexts {
+	ZSTD_CCtx *cctx = nullptr;
+	ZSTD_DCtx *dctx = nullptr;
+
+	~ZSTDThreadContexts() {
+		if (cctx) {
+			ZSTD_freeCCtx(cctx);
+		}
+		if (dctx) {
+			ZSTD_freeDCtx(dctx);
+		}
+	}
+};
+
+static thread_local ZSTDThreadContexts zstd_contexts;
+
+uint32_t Compression::register_dictionary(const Vector<uint8_t> &p_dictionary) {
+
+	ERR_FAIL_COND_V(p_dictionary.empty(), 0);
+
+	uint32_t id = hash_djb2_buffer(p_dictionary.ptr(), p_dictionary.size());
+	if (id == 0) {
+		id = 1; // Zero means no dictionary.
+	}
+
+	dictionaries_lock.lock();
+	CompressionDictionary *dictionary = _find_dictionary(id);
+	if (dictionary) {
+		bool same = _is_same_dictionary(dictionary, p_dictionary);
+		if (same) {
+			dictionary->refcount++;
+		}
+		dictionaries_lock.unlock();
+		ERR_FAIL_COND_V_MSG(!same, 0, "A different compression dictionary with the same id is already registered.");
+		return id;
+	}
+	dictionary = _find_dictionary(0);
+	dictionaries_lock.unlock();
+	ERR_FAIL_COND_V_MSG(!dictionary, 0, "Too many compression dictionaries registered.");
+
+	// Raw content dictionaries, zstd uses them as data preceding every payload.
+	ZSTD_CDict *cdict = ZSTD_createCDict(p_dictionary.ptr(), p_dictionary.size(), zstd_level);
+	ZSTD_DDict *ddict = ZSTD_createDDict(p_dictionary.ptr(), p_dictionary.size());
+	ERR_FAIL_COND_V(!cdict || !ddict, 0);
+
+	dictionaries_lock.lock();
+	dictionary = _find_dictionary(id);
+	if (dictionary) {
+		// Registered by another thread in the meantime.
+		bool same = _is_same_dictionary(dictionary, p_dictionary);
+		if (same) {
+			dictionary->refcount++;
+		}
+		dictionaries_lock.unlock();
+		ZSTD_freeCDict(cdict);
+		ZSTD_freeDDict(ddict);
+		ERR_FAIL_COND_V_MSG(!same, 0, "A different compression dictionary with the same id is already registered.");
+		return id;
+	}
+	dictionary = _find_dictionary(0);
+	if (dictionary) {
+		dictionary->data = p_dictionary;
+		dictionary->cdict = cdict;
+		dictionary->ddict = ddict;
+		dictionary->refcount = 1;
+		dictionary->id = id;
+	}
+	dictionaries_lock.unlock();
+
+	if (!dictionary) {
+		ZSTD_freeCDict(cdict);
+		ZSTD_freeDDict(ddict);
+		ERR_FAIL_V_MSG(0, "Too many compression dictionaries registered.");
+	}
+
+	return id;
+}
+
+void Compression::unregister_dictionary(uint32_t p_id) {
+
+	dictionaries_lock.lock();
+	CompressionDictionary *dictionary = p_id ? _find_dictionary(p_id) : nullptr;
+	if (!dictionary) {
+		dictionaries_lock.unlock();
+		ERR_FAIL_MSG("Compression dictionary is not registered.");
+	}
+
+	dictionary->refcount--;
+	if (dictionary->refcount > 0) {
+		dictionaries_lock.unlock();
+		return;
+	}
+
+	ZSTD_CDict *cdict = dictionary->cdict;
+	ZSTD_DDict *ddict = dictionary->ddict;
+	Vector<uint8_t> data = dictionary->data; // Freed outside of the lock.
+	dictionary->data = Vector<uint8_t>();
+	dictionary->id = 0;
+	dictionary->cdict = nullptr;
+	dictionary->ddict = nullptr;
+	dictionaries_lock.unlock();
+
+	ZSTD_freeCDict(cdict);
+	ZSTD_freeDDict(ddict);
+}
+
+bool Compression::has_dictionary(uint32_t p_id) {
+
+	dictionaries_lock.lock();
+	bool found = p_id && _find_dictionary(p_id);
+	dictionaries_lock.unlock();
+	return found;
+}
+
+// Picks the segments of the samples which share the most content with other
+// samples, in the spirit of zstd's COVER trainer: every segment is scored by
+// how many samples contain each of its d-mers, the best one is added and its
+// d-mers stop counting, so the next ones cover different content. The best
+// segments go last, where they are cheapest to reference.
+struct DictionaryTrainer {
+
+	enum {
+		DMER_SIZE = 8,
+		SEGMENT_SIZE = 64,
+		SEGMENT_STRIDE = 8,
+	};
+
+	struct Candidate {
+		uint32_t score;
+		uint32_t sample;
+		uint32_t offset;
+	};
+
+	const Vector<Vector<uint8_t>> &samples;
+	HashMap<uint64_t, uint32_t> frequencies; // How many samples contain each d-mer.
+	Vector<Candidate> heap; // Max-heap, rescored lazily as d-mers get used.
+	int heap_size = 0;
+
+	_FORCE_INLINE_ static uint64_t _dmer(const uint8_t *p_ptr) {
+		uint64_t dmer;
+		memcpy(&dmer, p_ptr, DMER_SIZE);
+		return dmer;
+	}
+
+	uint32_t score(const Candidate &p_candidate) const {
+		const uint8_t *ptr = &samples[p_candidate.sample][p_candidate.offset];
+		uint32_t total = 0;
+		for (int i = 0; i <= SEGMENT_SIZE - DMER_SIZE; i++) {
+			const uint32_t *frequency = frequencies.getptr(_dmer(ptr + i));
+			// Content found in a single sample doesn't help compressing others.
+			if (frequency && *frequency > 1) {
+				total += *frequency;
+			}
+		}
+		return total;
+	}
+
+	void sift_down(int p_index) {
+		Candidate *h = heap.ptrw();
+		while (true) {
+			int largest = p_index;
+			int left = p_index * 2 + 1;
+			int right = left + 1;
+			if (left < heap_size && h[left].score > h[largest].score) {
+				largest = left;
+			}
+			if (right < heap_size && h[right].score > h[largest].score) {
+				largest = right;
+			}
+			if (largest == p_index) {
+				return;
+			}
+			SWAP(h[p_index], h[largest]);
+			p_index = largest;
+		}
+	}
+
+	void count_dmers() {
+		Vector<uint64_t> sample_dmers;
+		for (int i = 0; i < samples.size(); i++) {
+			const Vector<uint8_t> &sample = samples[i];
+			if (sample.size() < DMER_SIZE) {
+				continue;
+			}
+			sample_dmers.resize(sample.size() - DMER_SIZE + 1);
+			for (int j = 0; j < sample_dmers.size(); j++) {
+				sample_dmers.write[j] = _dmer(&sample[j]);
+			}
+			sample_dmers.sort();
+			for (int j = 0; j < sample_dmers.size(); j++) {
+				if (j == 0 || sample_dmers[j] != sample_dmers[j - 1]) {
+					frequencies[sample_dmers[j]]++;
+				}
+			}
+		}
+	}
+
+	void build_heap() {
+		for (int i = 0; i < samples.size(); i++) {
+			for (int j = 0; j + SEGMENT_SIZE <= samples[i].size(); j += SEGMENT_STRIDE) {
+				Candidate candidate;
+				candidate.sample = i;
+				candidate.offset = j;
+				candidate.score = score(candidate);
+				if (candidate.score) {
+					heap.push_back(candidate);
+				}
+			}
+		}
+		heap_size = heap.size();
+		for (int i = heap_size / 2 - 1; i >= 0; i--) {
+			sift_down(i);
+		}
+	}
+
+	Vector<uint8_t> train(int p_max_size) {
+		count_dmers();
+		build_heap();
+
+		Vector<uint8_t> dictionary;
+		dictionary.resize(p_max_size);
+		int start = p_max_size;
+
+		while (heap_size && start >= SEGMENT_SIZE) {
+			Candidate &best = heap.write[0];
+			uint32_t best_score = score(best);
+			if (best_score < best.score) {
+				// Used d-mers made it worse, put it back where it belongs now.
+				best.score = best_score;
+				if (best_score == 0) {
+					heap.write[0] = heap[--heap_size];
+				}
+				sift_down(0);
+				continue;
+			}
+
+			const uint8_t *ptr = &samples[best.sample][best.offset];
+			start -= SEGMENT_SIZE;
+			memcpy(&dictionary.write[start], ptr, SEGMENT_SIZE);
+			for (int i = 0; i <= SEGMENT_SIZE - DMER_SIZE; i++) {
+				uint32_t *frequency = frequencies.getptr(_dmer(ptr + i));
+				if (frequency) {
+					*frequency = 0;
+				}
+			}
+
+			heap.write[0] = heap[--heap_size];
+			sift_down(0);
+		}
+
+		if (start == p_max_size) {
+			return Vector<uint8_t>(); // Nothing in common between the samples.
+		}
+		return dictionary.subarray(start, p_max_size - 1);
+	}
+
+	DictionaryTrainer(const Vector<Vector<uint8_t>> &p_samples) :
+			samples(p_samples) {}
+};
+
+Vector<uint8_t> Compression::train_dictionary(const Vector<Vector<uint8_t>> &p_samples, int p_max_size) {
+
+	ERR_FAIL_COND_V(p_max_size <= 0, Vector<uint8_t>());
+
+	DictionaryTrainer trainer(p_samples);
+	return trainer.train(p_max_size);
+}
+
+int Compression::compress(uint8_t *p_dst, const uint8_t *p_src, int p_src_size, Mode p_mode, uint32_t p_dictionary) {
 
 	switch (p_mode) {
 		case MODE_FASTLZ: {
@@ -80,15 +381,32 @@ int Compression::compress(uint8_t *p_dst, const uint8_t *p_src, int p_src_size,
 
 		} break;
 		case MODE_ZSTD: {
-			ZSTD_CCtx *cctx = ZSTD_createCCtx();
+			ZSTD_CCtx *cctx = zstd_contexts.cctx;
+			if (!cctx) {
+				cctx = ZSTD_createCCtx();
+				ERR_FAIL_COND_V(!cctx, -1);
+				zstd_contexts.cctx = cctx;
+			}
+			ZSTD_CCtx_reset(cctx, ZSTD_reset_session_and_parameters);
+			int max_dst_size = get_max_compressed_buffer_size(p_src_size, MODE_ZSTD);
+
+			if (p_dictionary) {
+				dictionaries_lock.lock();
+				CompressionDictionary *dictionary = _find_dictionary(p_dictionary);
+				ZSTD_CDict *cdict = dictionary ? dictionary->cdict : nullptr;
+				dictionaries_lock.unlock();
+				ERR_FAIL_COND_V_MSG(!cdict, -1, "Compression dictionary is not registered.");
+
+				size_t ret = ZSTD_compress_usingCDict(cctx, p_dst, max_dst_size, p_src, p_src_size, cdict);
+				return ZSTD_isError(ret) ? -1 : int(ret);
+			}
+
 			ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, zstd_level);
 			if (zstd_long_distance_matching) {
 				ZSTD_CCtx_setParameter(cctx, ZSTD_c_enableLongDistanceMatching, 1);
 				ZSTD_CCtx_setParameter(cctx, ZSTD_c_windowLog, zstd_window_log_size);
 			}
-			int max_dst_size = get_max_compressed_buffer_size(p_src_size, MODE_ZSTD);
 			int ret = ZSTD_compressCCtx(cctx, p_dst, max_dst_size, p_src, p_src_size, zstd_level);
-			ZSTD_freeCCtx(cctx);
 			return ret;
 		} break;
 	}
@@ -132,7 +450,7 @@ int Compression::get_max_compressed_buffer_size(int p_src_size, Mode p_mode) {
 	ERR_FAIL_V(-1);
 }
 
-int Compression::decompress(uint8_t *p_dst, int p_dst_max_size, const uint8_t *p_src, int p_src_size, Mode p_mode) {
+int Compression::decompress(uint8_t *p_dst, int p_dst_max_size, const uint8_t *p_src, int p_src_size, Mode p_mode, uint32_t p_dictionary) {
 
 	switch (p_mode) {
 		case MODE_FASTLZ: {
@@ -174,12 +492,29 @@ int Compression::decompress(uint8_t *p_dst, int p_dst_max_size, const uint8_t *p
 			return total;
 		} break;
 		case MODE_ZSTD: {
-			ZSTD_DCtx *dctx = ZSTD_createDCtx();
+			ZSTD_DCtx *dctx = zstd_contexts.dctx;
+			if (!dctx) {
+				dctx = ZSTD_createDCtx();
+				ERR_FAIL_COND_V(!dctx, -1);
+				zstd_contexts.dctx = dctx;
+			}
+			ZSTD_DCtx_reset(dctx, ZSTD_reset_session_and_parameters);
 			if (zstd_long_distance_matching) {
 				ZSTD_DCtx_setParameter(dctx, ZSTD_d_windowLogMax, zstd_window_log_size);
 			}
+
+			if (p_dictionary) {
+				dictionaries_lock.lock();
+				CompressionDictionary *dictionary = _find_dictionary(p_dictionary);
+				ZSTD_DDict *ddict = dictionary ? dictionary->ddict : nullptr;
+				dictionaries_lock.unlock();
+				ERR_FAIL_COND_V_MSG(!ddict, -1, "Compression dictionary is not registered.");
+
+				size_t ret = ZSTD_decompress_usingDDict(dctx, p_dst, p_dst_max_size, p_src, p_src_size, ddict);
+				return ZSTD_isError(ret) ? -1 : int(ret);
+			}
+
 			int ret = ZSTD_decompressDCtx(dctx, p_dst, p_dst_max_size, p_src, p_src_size);
-			ZSTD_freeDCtx(dctx);
 			return ret;
 		} break;
 	}
@@ -32,6 +32,7 @@
 #define COMPRESSION_H
 
 #include "core/typedefs.h"
+#include "core/vector.h"
 
 class Compression {
 
@@ -49,9 +50,18 @@ public:
 		MODE_GZIP
 	};
 
-	static int compress(uint8_t *p_dst, const uint8_t *p_src, int p_src_size, Mode p_mode = MODE_ZSTD);
+	// Dictionaries make small payloads compress much better in MODE_ZSTD, as
+	// long as the same one is used to decompress them. Ids are derived from
+	// the content, so they can be stored along with the compressed data. A
+	// different dictionary whose id collides with a registered one is refused.
+	static uint32_t register_dictionary(const Vector<uint8_t> &p_dictionary);
+	static void unregister_dictionary(uint32_t p_id); // Must not be in use by other threads.
+	static bool has_dictionary(uint32_t p_id);
+	static Vector<uint8_t> train_dictionary(const Vector<Vector<uint8_t>> &p_samples, int p_max_size = 16384);
+
+	static int compress(uint8_t *p_dst, const uint8_t *p_src, int p_src_size, Mode p_mode = MODE_ZSTD, uint32_t p_dictionary = 0);
 	static int get_max_compressed_buffer_size(int p_src_size, Mode p_mode = MODE_ZSTD);
-	static int decompress(uint8_t *p_dst, int p_dst_max_size, const uint8_t *p_src, int p_src_size, Mode p_mode = MODE_ZSTD);
+	static int decompress(uint8_t *p_dst, int p_dst_max_size, const uint8_t *p_src, int p_src_size, Mode p_mode = MODE_ZSTD, uint32_t p_dictionary = 0);
 
 	Compression();
 };
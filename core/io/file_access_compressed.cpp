@@ -32,7 +32,7 @@
 
 #include "core/print_string.h"
 
-void FileAccessCompressed::configure(const String &p_magic, Compression::Mode p_mode, int p_block_size) {
+void FileAccessCompressed::configure(const String &p_magic, Compression::Mode p_mode, int p_block_size, uint32_t p_dictionary) {
 
 	magic = p_magic.ascii().get_data();
 	if (magic.length() > 4)
@@ -44,6 +44,7 @@ void FileAccessCompressed::configure(const String &p_magic, Compression::Mode p_
 
 	cmode = p_mode;
 	block_size = p_block_size;
+	dictionary = p_mode == Compression::MODE_ZSTD ? p_dictionary : 0;
 }
 
 #define WRITE_FIT(m_bytes)                                  \
@@ -61,7 +62,13 @@ void FileAccessCompressed::configure(const String &p_magic, Compression::Mode p_
 Error FileAccessCompressed::open_after_magic(FileAccess *p_base) {
 
 	f = p_base;
-	cmode = (Compression::Mode)f->get_32();
+	uint32_t mode = f->get_32();
+	cmode = (Compression::Mode)(mode & ~MODE_HAS_DICTIONARY);
+	dictionary = (mode & MODE_HAS_DICTIONARY) ? f->get_32() : 0;
+	if (dictionary && !Compression::has_dictionary(dictionary)) {
+		f = nullptr;
+		ERR_FAIL_V_MSG(ERR_FILE_CORRUPT, "Can't open compressed file '" + p_base->get_path() + "', its compression dictionary is not registered.");
+	}
 	block_size = f->get_32();
 	if (block_size == 0) {
 		f = nullptr; // Let the caller to handle the FileAccess object if failed to open as compressed file.
@@ -90,7 +97,7 @@ Error FileAccessCompressed::open_after_magic(FileAccess *p_base) {
 	read_block_count = bc;
 	read_block_size = read_blocks.size() == 1 ? read_total : block_size;
 
-	Compression::decompress(buffer.ptrw(), read_block_size, comp_buffer.ptr(), read_blocks[0].csize, cmode);
+	Compression::decompress(buffer.ptrw(), read_block_size, comp_buffer.ptr(), read_blocks[0].csize, cmode, dictionary);
 	read_block = 0;
 	read_pos = 0;
 
@@ -126,11 +133,12 @@ Error FileAccessCompressed::_open(const String &p_path, int p_mode_flags) {
 		//don't store anything else unless it's done saving!
 	} else {
 
+		FileAccess *base = f; // open_after_magic() clears f when failing.
 		char rmagic[5];
-		f->get_buffer((uint8_t *)rmagic, 4);
+		base->get_buffer((uint8_t *)rmagic, 4);
 		rmagic[4] = 0;
-		if (magic != rmagic || open_after_magic(f) != OK) {
-			memdelete(f);
+		if (magic != rmagic || open_after_magic(base) != OK) {
+			memdelete(base);
 			f = nullptr;
 			return ERR_FILE_UNRECOGNIZED;
 		}
@@ -148,7 +156,13 @@ void FileAccessCompressed::close() {
 
 		CharString mgc = magic.utf8();
 		f->store_buffer((const uint8_t *)mgc.get_data(), mgc.length()); //write header 4
-		f->store_32(cmode); //write compression mode 4
+		if (dictionary) {
+			f->store_32(cmode | MODE_HAS_DICTIONARY); //write compression mode 4
+			f->store_32(dictionary); //write dictionary id 4
+		} else {
+			f->store_32(cmode); //write compression mode 4
+		}
+		uint64_t block_sizes_ofs = f->get_position() + 8;
 		f->store_32(block_size); //write block size 4
 		f->store_32(write_max); //max amount of data written 4
 		int bc = (write_max / block_size) + 1;
@@ -165,13 +179,13 @@ void FileAccessCompressed::close() {
 
 			Vector<uint8_t> cblock;
 			cblock.resize(Compression::get_max_compressed_buffer_size(bl, cmode));
-			int s = Compression::compress(cblock.ptrw(), bp, bl, cmode);
+			int s = Compression::compress(cblock.ptrw(), bp, bl, cmode, dictionary);
 
 			f->store_buffer(cblock.ptr(), s);
 			block_sizes.push_back(s);
 		}
 
-		f->seek(16); //ok write block sizes
+		f->seek(block_sizes_ofs); //ok write block sizes
 		for (int i = 0; i < bc; i++)
 			f->store_32(block_sizes[i]);
 		f->seek_end();
@@ -218,7 +232,7 @@ void FileAccessCompressed::seek(size_t p_position) {
 				read_block = block_idx;
 				f->seek(read_blocks[read_block].offset);
 				f->get_buffer(comp_buffer.ptrw(), read_blocks[read_block].csize);
-				Compression::decompress(buffer.ptrw(), read_blocks.size() == 1 ? read_total : block_size, comp_buffer.ptr(), read_blocks[read_block].csize, cmode);
+				Compression::decompress(buffer.ptrw(), read_blocks.size() == 1 ? read_total : block_size, comp_buffer.ptr(), read_blocks[read_block].csize, cmode, dictionary);
 				read_block_size = read_block == read_block_count - 1 ? read_total % block_size : block_size;
 			}
 
@@ -289,7 +303,7 @@ uint8_t FileAccessCompressed::get_8() const {
 		if (read_block < read_block_count) {
 			//read another block of compressed data
 			f->get_buffer(comp_buffer.ptrw(), read_blocks[read_block].csize);
-			Compression::decompress(buffer.ptrw(), read_blocks.size() == 1 ? read_total : block_size, comp_buffer.ptr(), read_blocks[read_block].csize, cmode);
+			Compression::decompress(buffer.ptrw(), read_blocks.size() == 1 ? read_total : block_size, comp_buffer.ptr(), read_blocks[read_block].csize, cmode, dictionary);
 			read_block_size = read_block == read_block_count - 1 ? read_total % block_size : block_size;
 			read_pos = 0;
 
@@ -321,7 +335,7 @@ int FileAccessCompressed::get_buffer(uint8_t *p_dst, int p_length) const {
 			if (read_block < read_block_count) {
 				//read another block of compressed data
 				f->get_buffer(comp_buffer.ptrw(), read_blocks[read_block].csize);
-				Compression::decompress(buffer.ptrw(), read_blocks.size() == 1 ? read_total : block_size, comp_buffer.ptr(), read_blocks[read_block].csize, cmode);
+				Compression::decompress(buffer.ptrw(), read_blocks.size() == 1 ? read_total : block_size, comp_buffer.ptr(), read_blocks[read_block].csize, cmode, dictionary);
 				read_block_size = read_block == read_block_count - 1 ? read_total % block_size : block_size;
 				read_pos = 0;
 
@@ -391,6 +405,7 @@ Error FileAccessCompressed::_set_unix_permissions(const String &p_file, uint32_t
 
 FileAccessCompressed::FileAccessCompressed() :
 		cmode(Compression::MODE_ZSTD),
+		dictionary(0),
 		writing(false),
 		write_ptr(nullptr),
 		write_buffer_size(0),
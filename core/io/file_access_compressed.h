@@ -36,7 +36,12 @@
 
 class FileAccessCompressed : public FileAccess {
 
+	enum {
+		MODE_HAS_DICTIONARY = 1 << 16, // Set in the stored mode when the dictionary id follows it.
+	};
+
 	Compression::Mode cmode;
+	uint32_t dictionary;
 	bool writing;
 	uint32_t write_pos;
 	uint8_t *write_ptr;
@@ -65,7 +70,9 @@ class FileAccessCompressed : public FileAccess {
 	FileAccess *f;
 
 public:
-	void configure(const String &p_magic, Compression::Mode p_mode = Compression::MODE_ZSTD, int p_block_size = 4096);
+	// A dictionary registered in Compression can be used with MODE_ZSTD, it must
+	// also be registered when reading the file back.
+	void configure(const String &p_magic, Compression::Mode p_mode = Compression::MODE_ZSTD, int p_block_size = 4096, uint32_t p_dictionary = 0);
 
 	Error open_after_magic(FileAccess *p_base);
 
@@ -30,6 +30,9 @@
 
 #include "file_access_pack.h"
 
+#include "core/io/compression.h"
+#include "core/io/marshalls.h"
+#include "core/os/copymem.h"
 #include "core/version.h"
 
 #include <stdio.h>
@@ -47,7 +50,7 @@ Error PackedData::add_pack(const String &p_path, bool p_replace_files) {
 	return ERR_FILE_UNRECOGNIZED;
 };
 
-void PackedData::add_path(const String &pkg_path, const String &path, uint64_t ofs, uint64_t size, const uint8_t *p_md5, PackSource *p_src, bool p_replace_files) {
+void PackedData::add_path(const String &pkg_path, const String &path, uint64_t ofs, uint64_t size, const uint8_t *p_md5, PackSource *p_src, bool p_replace_files, uint32_t p_flags, uint32_t p_dictionary) {
 
 	PathMD5 pmd5(path.md5_buffer());
 	//printf("adding path %ls, %lli, %lli\n", path.c_str(), pmd5.a, pmd5.b);
@@ -61,6 +64,8 @@ void PackedData::add_path(const String &pkg_path, const String &path, uint64_t o
 	for (int i = 0; i < 16; i++)
 		pf.md5[i] = p_md5[i];
 	pf.src = p_src;
+	pf.flags = p_flags;
+	pf.dictionary = p_dictionary;
 
 	if (!exists || p_replace_files)
 		files[pmd5] = pf;
@@ -112,7 +117,7 @@ PackedData::PackedData() {
 	root->parent = nullptr;
 	disabled = false;
 
-	add_pack_source(memnew(PackedSourcePCK));
+	add_pack_source(PackedSourcePCK::create());
 }
 
 void PackedData::_free_packed_dirs(PackedDir *p_dir) {
@@ -132,11 +137,18 @@ PackedData::~PackedData() {
 
 //////////////////////////////////////////////////////////////////
 
-bool PackedSourcePCK::try_open_pack(const String &p_path, bool p_replace_files) {
+PackedSourcePCK *PackedSourcePCK::create_func_default() {
+
+	return memnew(PackedSourcePCK);
+}
+
+PackedSourcePCK *(*PackedSourcePCK::create_func)() = PackedSourcePCK::create_func_default;
+
+Error PackedSourcePCK::read_directory(const String &p_path, Vector<DirectoryEntry> &r_entries) {
 
 	FileAccess *f = FileAccess::open(p_path, FileAccess::READ);
 	if (!f)
-		return false;
+		return ERR_FILE_CANT_OPEN;
 
 	uint32_t magic = f->get_32();
 
@@ -149,7 +161,7 @@ bool PackedSourcePCK::try_open_pack(const String &p_path, bool p_replace_files)
 
 			f->close();
 			memdelete(f);
-			return false;
+			return ERR_FILE_UNRECOGNIZED;
 		}
 		f->seek(f->get_position() - 12);
 
@@ -161,7 +173,7 @@ bool PackedSourcePCK::try_open_pack(const String &p_path, bool p_replace_files)
 
 			f->close();
 			memdelete(f);
-			return false;
+			return ERR_FILE_UNRECOGNIZED;
 		}
 	}
 
@@ -170,15 +182,15 @@ bool PackedSourcePCK::try_open_pack(const String &p_path, bool p_replace_files)
 	uint32_t ver_minor = f->get_32();
 	f->get_32(); // patch number, not used for validation.
 
-	if (version != PACK_FORMAT_VERSION) {
+	if (version == 0 || version > PACK_FORMAT_VERSION) {
 		f->close();
 		memdelete(f);
-		ERR_FAIL_V_MSG(false, "Pack version unsupported: " + itos(version) + ".");
+		ERR_FAIL_V_MSG(ERR_FILE_UNRECOGNIZED, "Pack version unsupported: " + itos(version) + ".");
 	}
 	if (ver_major > VERSION_MAJOR || (ver_major == VERSION_MAJOR && ver_minor > VERSION_MINOR)) {
 		f->close();
 		memdelete(f);
-		ERR_FAIL_V_MSG(false, "Pack created with a newer version of the engine: " + itos(ver_major) + "." + itos(ver_minor) + ".");
+		ERR_FAIL_V_MSG(ERR_FILE_UNRECOGNIZED, "Pack created with a newer version of the engine: " + itos(ver_major) + "." + itos(ver_minor) + ".");
 	}
 
 	for (int i = 0; i < 16; i++) {
@@ -196,26 +208,78 @@ bool PackedSourcePCK::try_open_pack(const String &p_path, bool p_replace_files)
 		f->get_buffer((uint8_t *)cs.ptr(), sl);
 		cs[sl] = 0;
 
-		String path;
-		path.parse_utf8(cs.ptr());
-
-		uint64_t ofs = f->get_64();
-		uint64_t size = f->get_64();
-		uint8_t md5[16];
-		f->get_buffer(md5, 16);
-		PackedData::get_singleton()->add_path(p_path, path, ofs, size, md5, this, p_replace_files);
+		DirectoryEntry entry;
+		entry.path.parse_utf8(cs.ptr());
+		entry.file.pack = p_path;
+		entry.file.offset = f->get_64();
+		entry.file.size = f->get_64();
+		f->get_buffer(entry.file.md5, 16);
+		entry.file.src = nullptr;
+		entry.file.flags = version >= 2 ? f->get_32() : 0;
+		entry.file.dictionary = 0;
+		r_entries.push_back(entry);
 	};
 
 	f->close();
 	memdelete(f);
+	return OK;
+}
+
+bool PackedSourcePCK::try_open_pack(const String &p_path, bool p_replace_files) {
+
+	Vector<DirectoryEntry> entries;
+	if (read_directory(p_path, entries) != OK) {
+		return false;
+	}
+
+	uint32_t dictionary = 0;
+	for (int i = 0; i < entries.size(); i++) {
+		const PackedData::PackedFile &file = entries[i].file;
+		if (!(file.flags & PACK_FILE_DICTIONARY)) {
+			continue;
+		}
+
+		FileAccess *f = FileAccess::open(p_path, FileAccess::READ);
+		ERR_FAIL_COND_V_MSG(!f, false, "Can't open the pack '" + p_path + "'.");
+		Vector<uint8_t> data;
+		data.resize(file.size);
+		f->seek(file.offset);
+		int read = f->get_buffer(data.ptrw(), data.size());
+		memdelete(f);
+
+		ERR_FAIL_COND_V_MSG(read != data.size(), false, "Can't read the compression dictionary of the pack '" + p_path + "'.");
+		dictionary = Compression::register_dictionary(data);
+		ERR_FAIL_COND_V_MSG(dictionary == 0, false, "Can't register the compression dictionary of the pack '" + p_path + "'.");
+		dictionaries.push_back(dictionary);
+		break;
+	}
+
+	for (int i = 0; i < entries.size(); i++) {
+		const PackedData::PackedFile &file = entries[i].file;
+		if (file.flags & PACK_FILE_DICTIONARY) {
+			continue;
+		}
+		PackedData::get_singleton()->add_path(p_path, entries[i].path, file.offset, file.size, file.md5, this, p_replace_files, file.flags, dictionary);
+	}
+
 	return true;
 };
 
 FileAccess *PackedSourcePCK::get_file(const String &p_path, PackedData::PackedFile *p_file) {
 
+	if (p_file->flags & PACK_FILE_COMPRESSED) {
+		return memnew(FileAccessPackCompressed(p_path, *p_file));
+	}
 	return memnew(FileAccessPack(p_path, *p_file));
 };
 
+PackedSourcePCK::~PackedSourcePCK() {
+
+	for (int i = 0; i < dictionaries.size(); i++) {
+		Compression::unregister_dictionary(dictionaries[i]);
+	}
+}
+
 //////////////////////////////////////////////////////////////////
 
 Error FileAccessPack::_open(const String &p_path, int p_mode_flags) {
@@ -226,11 +290,17 @@ Error FileAccessPack::_open(const String &p_path, int p_mode_flags) {
 
 void FileAccessPack::close() {
 
-	f->close();
+	if (f) {
+		f->close();
+	}
+	mapped = nullptr;
 }
 
 bool FileAccessPack::is_open() const {
 
+	if (!f) {
+		return mapped != nullptr;
+	}
 	return f->is_open();
 }
 
@@ -242,7 +312,9 @@ void FileAccessPack::seek(size_t p_position) {
 		eof = false;
 	}
 
-	f->seek(pf.offset + p_position);
+	if (f) {
+		f->seek(pf.offset + p_position);
+	}
 	pos = p_position;
 }
 void FileAccessPack::seek_end(int64_t p_position) {
@@ -270,6 +342,11 @@ uint8_t FileAccessPack::get_8() const {
 		return 0;
 	}
 
+	if (!f) {
+		ERR_FAIL_COND_V(!mapped, 0);
+		return mapped[pos++];
+	}
+
 	pos++;
 	return f->get_8();
 }
@@ -285,18 +362,40 @@ int FileAccessPack::get_buffer(uint8_t *p_dst, int p_length) const {
 		to_read = int64_t(pf.size) - int64_t(pos);
 	}
 
+	size_t from = pos;
 	pos += p_length;
 
 	if (to_read <= 0)
 		return 0;
+
+	if (!f) {
+		ERR_FAIL_COND_V(!mapped, 0);
+		copymem(p_dst, &mapped[from], to_read);
+		return to_read;
+	}
+
 	f->get_buffer(p_dst, to_read);
 
 	return to_read;
 }
 
+const uint8_t *FileAccessPack::get_buffer_view(int p_length) const {
+
+	if (!mapped || eof || p_length < 0 || pos + p_length > pf.size) {
+		return nullptr;
+	}
+
+	const uint8_t *view = &mapped[pos];
+	pos += p_length;
+
+	return view;
+}
+
 void FileAccessPack::set_endian_swap(bool p_swap) {
 	FileAccess::set_endian_swap(p_swap);
-	f->set_endian_swap(p_swap);
+	if (f) {
+		f->set_endian_swap(p_swap);
+	}
 }
 
 Error FileAccessPack::get_error() const {
@@ -326,18 +425,316 @@ bool FileAccessPack::file_exists(const String &p_name) {
 	return false;
 }
 
-FileAccessPack::FileAccessPack(const String &p_path, const PackedData::PackedFile &p_file) :
+FileAccessPack::FileAccessPack(const String &p_path, const PackedData::PackedFile &p_file, const uint8_t *p_mapped_pack) :
 		pf(p_file),
-		f(FileAccess::open(pf.pack, FileAccess::READ)) {
+		f(nullptr),
+		mapped(nullptr) {
+
+	pos = 0;
+	eof = false;
+
+	if (p_mapped_pack) {
+		// The whole pack is already in the address space, no need for a file handle.
+		mapped = p_mapped_pack + pf.offset;
+		return;
+	}
 
+	f = FileAccess::open(pf.pack, FileAccess::READ);
 	ERR_FAIL_COND_MSG(!f, "Can't open pack-referenced file '" + String(pf.pack) + "'.");
 
 	f->seek(pf.offset);
+}
+
+FileAccessPack::~FileAccessPack() {
+	if (f)
+		memdelete(f);
+}
+
+//////////////////////////////////////////////////////////////////
+
+void FileAccessPackCompressed::CachedBlock::decode(void *p_unused) {
+
+	if (src_size == uint32_t(data.size())) {
+		copymem(data.ptrw(), src, src_size); // Stored as is.
+		return;
+	}
+
+	int ret = Compression::decompress(data.ptrw(), data.size(), src, src_size, Compression::MODE_ZSTD, dictionary);
+	failed = ret != data.size();
+}
+
+void FileAccessPackCompressed::_start_decode(CachedBlock &p_slot, int64_t p_block, bool p_async) const {
+
+	if (p_slot.job.is_valid()) {
+		// Still decoding a block nobody asked for in the end, e.g. after a seek.
+		JobSystem::get_singleton()->wait(p_slot.job);
+		p_slot.job = JobSystem::Handle();
+	}
+
+	uint64_t from = block_offsets[p_block];
+	p_slot.block = p_block;
+	p_slot.failed = false;
+	p_slot.dictionary = pf.dictionary;
+	p_slot.src_size = block_offsets[p_block + 1] - from;
+	p_slot.data.resize(MIN(uint64_t(block_size), pf.size - uint64_t(p_block) * block_size));
+
+	if (mapped) {
+		p_slot.src = mapped + from;
+	} else {
+		// FileAccess isn't thread safe, so read here and only decompress in the job.
+		p_slot.compressed.resize(p_slot.src_size);
+		f->seek(pf.offset + from);
+		if (f->get_buffer(p_slot.compressed.ptrw(), p_slot.src_size) != int(p_slot.src_size)) {
+			p_slot.failed = true;
+			return;
+		}
+		p_slot.src = p_slot.compressed.ptr();
+	}
+
+	JobSystem *job_system = JobSystem::get_singleton();
+	if (p_async && job_system && job_system->get_thread_count() > 0) {
+		p_slot.job = job_system->add_task(&p_slot, &CachedBlock::decode, nullptr);
+	} else {
+		p_slot.decode(nullptr);
+	}
+}
+
+const uint8_t *FileAccessPackCompressed::_get_block(int64_t p_block) const {
+
+	bool sequential = p_block == last_block + 1;
+	last_block = p_block;
+
+	CachedBlock &slot = cache[p_block % CACHED_BLOCKS];
+	if (slot.block != p_block) {
+		_start_decode(slot, p_block, false);
+	}
+
+	if (sequential) {
+		int64_t block_count = block_offsets.size() - 1;
+		for (int64_t i = p_block + 1; i <= p_block + READAHEAD_BLOCKS && i < block_count; i++) {
+			CachedBlock &next = cache[i % CACHED_BLOCKS];
+			if (next.block != i) {
+				_start_decode(next, i, true);
+			}
+		}
+	}
+
+	if (slot.job.is_valid()) {
+		JobSystem::get_singleton()->wait(slot.job);
+		slot.job = JobSystem::Handle();
+	}
+
+	if (slot.failed) {
+		slot.block = -1;
+		current_block = -1;
+		ERR_FAIL_V_MSG(nullptr, "Can't decompress block " + itos(p_block) + " of a packed file in '" + String(pf.pack) + "'.");
+	}
+
+	current_block = p_block;
+	current_data = slot.data.ptr();
+	return current_data;
+}
+
+void FileAccessPackCompressed::_wait_jobs() {
+
+	for (int i = 0; i < CACHED_BLOCKS; i++) {
+		if (cache[i].job.is_valid()) {
+			JobSystem::get_singleton()->wait(cache[i].job);
+			cache[i].job = JobSystem::Handle();
+		}
+	}
+}
+
+Error FileAccessPackCompressed::_open(const String &p_path, int p_mode_flags) {
+
+	ERR_FAIL_V(ERR_UNAVAILABLE);
+	return ERR_UNAVAILABLE;
+}
+
+void FileAccessPackCompressed::close() {
+
+	_wait_jobs();
+	if (f) {
+		f->close();
+	}
+	mapped = nullptr;
+}
+
+bool FileAccessPackCompressed::is_open() const {
+
+	if (!f) {
+		return mapped != nullptr;
+	}
+	return f->is_open();
+}
+
+void FileAccessPackCompressed::seek(size_t p_position) {
+
+	eof = p_position > pf.size;
+	pos = p_position;
+}
+
+void FileAccessPackCompressed::seek_end(int64_t p_position) {
+
+	seek(pf.size + p_position);
+}
+
+size_t FileAccessPackCompressed::get_position() const {
+
+	return pos;
+}
+
+size_t FileAccessPackCompressed::get_len() const {
+
+	return pf.size;
+}
+
+bool FileAccessPackCompressed::eof_reached() const {
+
+	return eof;
+}
+
+uint8_t FileAccessPackCompressed::get_8() const {
+
+	if (pos >= pf.size) {
+		eof = true;
+		return 0;
+	}
+
+	int64_t block = pos / block_size;
+	if (block != current_block && !_get_block(block)) {
+		eof = true;
+		return 0;
+	}
+
+	uint8_t ret = current_data[pos - uint64_t(block) * block_size];
+	pos++;
+	return ret;
+}
+
+int FileAccessPackCompressed::get_buffer(uint8_t *p_dst, int p_length) const {
+
+	if (eof)
+		return 0;
+
+	uint64_t to_read = p_length;
+	if (to_read + pos > pf.size) {
+		eof = true;
+		to_read = pos < pf.size ? pf.size - pos : 0;
+	}
+
+	size_t end = pos + p_length;
+	int read = 0;
+
+	while (to_read > 0) {
+		int64_t block = pos / block_size;
+		if (block != current_block && !_get_block(block)) {
+			eof = true;
+			break;
+		}
+
+		uint64_t block_ofs = pos - uint64_t(block) * block_size;
+		uint64_t chunk = MIN(to_read, MIN(uint64_t(block_size), pf.size - uint64_t(block) * block_size) - block_ofs);
+		copymem(&p_dst[read], &current_data[block_ofs], chunk);
+
+		read += chunk;
+		pos += chunk;
+		to_read -= chunk;
+	}
+
+	pos = end;
+	return read;
+}
+
+Error FileAccessPackCompressed::get_error() const {
+
+	if (eof)
+		return ERR_FILE_EOF;
+	return OK;
+}
+
+void FileAccessPackCompressed::flush() {
+
+	ERR_FAIL();
+}
+
+void FileAccessPackCompressed::store_8(uint8_t p_dest) {
+
+	ERR_FAIL();
+}
+
+void FileAccessPackCompressed::store_buffer(const uint8_t *p_src, int p_length) {
+
+	ERR_FAIL();
+}
+
+bool FileAccessPackCompressed::file_exists(const String &p_name) {
+
+	return false;
+}
+
+FileAccessPackCompressed::FileAccessPackCompressed(const String &p_path, const PackedData::PackedFile &p_file, const uint8_t *p_mapped_pack, uint64_t p_mapped_size) :
+		pf(p_file),
+		f(nullptr),
+		mapped(nullptr),
+		block_size(0),
+		current_block(-1),
+		current_data(nullptr),
+		last_block(-1) {
+
 	pos = 0;
 	eof = false;
+
+	uint64_t available = 0; // Bytes in the pack from the file offset on.
+	uint32_t block_count = 0;
+
+	if (p_mapped_pack) {
+		ERR_FAIL_COND_MSG(pf.offset + 8 > p_mapped_size, "Packed file '" + p_path + "' goes past the end of '" + String(pf.pack) + "'.");
+		mapped = p_mapped_pack + pf.offset;
+		available = p_mapped_size - pf.offset;
+		block_size = decode_uint32(mapped);
+		block_count = decode_uint32(mapped + 4);
+	} else {
+		f = FileAccess::open(pf.pack, FileAccess::READ);
+		ERR_FAIL_COND_MSG(!f, "Can't open pack-referenced file '" + String(pf.pack) + "'.");
+		available = f->get_len() > pf.offset ? f->get_len() - pf.offset : 0;
+		f->seek(pf.offset);
+		block_size = f->get_32();
+		block_count = f->get_32();
+	}
+
+	uint64_t header_size = 8 + (uint64_t(block_count) + 1) * 8;
+	bool valid = block_size > 0 && uint64_t(block_count) == (pf.size + block_size - 1) / block_size && header_size <= available;
+
+	if (valid) {
+		block_offsets.resize(block_count + 1);
+		uint64_t *w = block_offsets.ptrw();
+		for (uint32_t i = 0; i <= block_count; i++) {
+			w[i] = mapped ? decode_uint64(mapped + 8 + i * 8) : f->get_64();
+		}
+
+		// Blocks must follow the header in order, and never be larger than their uncompressed size.
+		valid = w[0] >= header_size && w[block_count] <= available;
+		for (uint32_t i = 0; i < block_count && valid; i++) {
+			valid = w[i] <= w[i + 1] && w[i + 1] - w[i] <= MIN(uint64_t(block_size), pf.size - uint64_t(i) * block_size);
+		}
+	}
+
+	if (!valid) {
+		block_offsets.clear();
+		pf.size = 0;
+		mapped = nullptr;
+		if (f) {
+			memdelete(f);
+			f = nullptr;
+		}
+		ERR_FAIL_MSG("Corrupt compressed file '" + p_path + "' in pack '" + String(pf.pack) + "'.");
+	}
 }
 
-FileAccessPack::~FileAccessPack() {
+FileAccessPackCompressed::~FileAccessPackCompressed() {
+
+	_wait_jobs();
 	if (f)
 		memdelete(f);
 }
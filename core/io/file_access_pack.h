@@ -31,6 +31,7 @@
 #ifndef FILE_ACCESS_PACK_H
 #define FILE_ACCESS_PACK_H
 
+#include "core/job_system.h"
 #include "core/list.h"
 #include "core/map.h"
 #include "core/os/dir_access.h"
@@ -40,7 +41,14 @@
 // Godot's packed file magic header ("GDPC" in ASCII).
 #define PACK_HEADER_MAGIC 0x43504447
 // The current packed file format version number.
-#define PACK_FORMAT_VERSION 1
+// Version 2 added per-file flags to the directory.
+// Version 3 added the compression dictionary entry.
+#define PACK_FORMAT_VERSION 3
+
+enum PackFileFlags {
+	PACK_FILE_COMPRESSED = 1 << 0, // Stored as independently compressed blocks, see FileAccessPackCompressed.
+	PACK_FILE_DICTIONARY = 1 << 1, // Zstd dictionary used by the compressed files of the pack, not a file itself.
+};
 
 class PackSource;
 
@@ -57,6 +65,8 @@ public:
 		uint64_t size;
 		uint8_t md5[16];
 		PackSource *src;
+		uint32_t flags;
+		uint32_t dictionary; // Registered in Compression, for PACK_FILE_COMPRESSED files.
 	};
 
 private:
@@ -107,7 +117,7 @@ private:
 
 public:
 	void add_pack_source(PackSource *p_source);
-	void add_path(const String &pkg_path, const String &path, uint64_t ofs, uint64_t size, const uint8_t *p_md5, PackSource *p_src, bool p_replace_files); // for PackSource
+	void add_path(const String &pkg_path, const String &path, uint64_t ofs, uint64_t size, const uint8_t *p_md5, PackSource *p_src, bool p_replace_files, uint32_t p_flags = 0, uint32_t p_dictionary = 0); // for PackSource
 
 	void set_disabled(bool p_disabled) { disabled = p_disabled; }
 	_FORCE_INLINE_ bool is_disabled() const { return disabled; }
@@ -132,9 +142,28 @@ public:
 
 class PackedSourcePCK : public PackSource {
 
+	Vector<uint32_t> dictionaries;
+
+	static PackedSourcePCK *create_func_default();
+
+protected:
+	static PackedSourcePCK *(*create_func)();
+
 public:
+	struct DirectoryEntry {
+		String path;
+		PackedData::PackedFile file;
+	};
+
+	static PackedSourcePCK *create() { return create_func(); }
+
+	// Reads the directory of the pack at p_path without registering it.
+	static Error read_directory(const String &p_path, Vector<DirectoryEntry> &r_entries);
+
 	virtual bool try_open_pack(const String &p_path, bool p_replace_files);
 	virtual FileAccess *get_file(const String &p_path, PackedData::PackedFile *p_file);
+
+	virtual ~PackedSourcePCK();
 };
 
 class FileAccessPack : public FileAccess {
@@ -145,6 +174,7 @@ class FileAccessPack : public FileAccess {
 	mutable bool eof;
 
 	FileAccess *f;
+	const uint8_t *mapped; // Start of the file inside a memory-mapped pack, reads bypass `f` when set.
 	virtual Error _open(const String &p_path, int p_mode_flags);
 	virtual uint64_t _get_modified_time(const String &p_file) { return 0; }
 	virtual uint32_t _get_unix_permissions(const String &p_file) { return 0; }
@@ -164,6 +194,7 @@ public:
 	virtual uint8_t get_8() const;
 
 	virtual int get_buffer(uint8_t *p_dst, int p_length) const;
+	virtual const uint8_t *get_buffer_view(int p_length) const;
 
 	virtual void set_endian_swap(bool p_swap);
 
@@ -176,10 +207,90 @@ public:
 
 	virtual bool file_exists(const String &p_name);
 
-	FileAccessPack(const String &p_path, const PackedData::PackedFile &p_file);
+	FileAccessPack(const String &p_path, const PackedData::PackedFile &p_file, const uint8_t *p_mapped_pack = nullptr);
 	~FileAccessPack();
 };
 
+// Reads a file stored as independent zstd blocks, so any part of it can be
+// decoded without inflating what comes before. The data at the file offset is:
+//   uint32 block size, uint32 block count,
+//   uint64 block offsets (block count + 1, relative to the file offset),
+//   the blocks, stored uncompressed when that was smaller.
+// Sequential reads decompress the next blocks on the JobSystem while the
+// current one is consumed.
+class FileAccessPackCompressed : public FileAccess {
+
+	enum {
+		READAHEAD_BLOCKS = 4,
+		CACHED_BLOCKS = READAHEAD_BLOCKS + 1,
+	};
+
+	struct CachedBlock {
+		int64_t block = -1;
+		const uint8_t *src = nullptr;
+		uint32_t src_size = 0;
+		Vector<uint8_t> compressed; // Holds `src` when the pack isn't mapped.
+		Vector<uint8_t> data;
+		uint32_t dictionary = 0;
+		bool failed = false;
+		JobSystem::Handle job;
+
+		void decode(void *p_unused);
+	};
+
+	PackedData::PackedFile pf;
+
+	mutable size_t pos;
+	mutable bool eof;
+
+	FileAccess *f;
+	const uint8_t *mapped;
+
+	uint32_t block_size;
+	Vector<uint64_t> block_offsets;
+
+	mutable CachedBlock cache[CACHED_BLOCKS];
+	mutable int64_t current_block;
+	mutable const uint8_t *current_data;
+	mutable int64_t last_block;
+
+	void _start_decode(CachedBlock &p_slot, int64_t p_block, bool p_async) const;
+	const uint8_t *_get_block(int64_t p_block) const;
+	void _wait_jobs();
+
+	virtual Error _open(const String &p_path, int p_mode_flags);
+	virtual uint64_t _get_modified_time(const String &p_file) { return 0; }
+	virtual uint32_t _get_unix_permissions(const String &p_file) { return 0; }
+	virtual Error _set_unix_permissions(const String &p_file, uint32_t p_permissions) { return FAILED; }
+
+public:
+	virtual void close();
+	virtual bool is_open() const;
+
+	virtual void seek(size_t p_position);
+	virtual void seek_end(int64_t p_position = 0);
+	virtual size_t get_position() const;
+	virtual size_t get_len() const;
+
+	virtual bool eof_reached() const;
+
+	virtual uint8_t get_8() const;
+
+	virtual int get_buffer(uint8_t *p_dst, int p_length) const;
+
+	virtual Error get_error() const;
+
+	virtual void flush();
+	virtual void store_8(uint8_t p_dest);
+
+	virtual void store_buffer(const uint8_t *p_src, int p_length);
+
+	virtual bool file_exists(const String &p_name);
+
+	FileAccessPackCompressed(const String &p_path, const PackedData::PackedFile &p_file, const uint8_t *p_mapped_pack = nullptr, uint64_t p_mapped_size = 0);
+	~FileAccessPackCompressed();
+};
+
 FileAccess *PackedData::try_open_path(const String &p_path) {
 
 	PathMD5 pmd5(p_path.md5_buffer());
@@ -33,6 +33,7 @@
 
 #include "core/io/networked_multiplayer_peer.h"
 #include "core/reference.h"
+#include "core/swiss_hash_map.h"
 
 class MultiplayerAPI : public Reference {
 
@@ -58,7 +59,7 @@ private:
 	Ref<NetworkedMultiplayerPeer> network_peer;
 	int rpc_sender_id;
 	Set<int> connected_peers;
-	HashMap<NodePath, PathSentCache> path_send_cache;
+	SwissHashMap<NodePath, PathSentCache> path_send_cache;
 	Map<int, PathGetCache> path_get_cache;
 	int last_send_cache_id;
 	Vector<uint8_t> packet_cache;
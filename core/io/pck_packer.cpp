@@ -30,7 +30,10 @@
 
 #include "pck_packer.h"
 
+#include "core/io/compression.h"
 #include "core/io/file_access_pack.h" // PACK_HEADER_MAGIC, PACK_FORMAT_VERSION
+#include "core/io/marshalls.h"
+#include "core/job_system.h"
 #include "core/os/file_access.h"
 #include "core/version.h"
 
@@ -56,12 +59,14 @@ static void _pad(FileAccess *p_file, int p_bytes) {
 
 void PCKPacker::_bind_methods() {
 
-	ClassDB::bind_method(D_METHOD("pck_start", "pck_name", "alignment"), &PCKPacker::pck_start, DEFVAL(0));
+	ClassDB::bind_method(D_METHOD("pck_start", "pck_name", "alignment", "compress"), &PCKPacker::pck_start, DEFVAL(0), DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("set_compression_dictionary", "dictionary"), &PCKPacker::set_compression_dictionary);
+	ClassDB::bind_method(D_METHOD("get_compression_dictionary"), &PCKPacker::get_compression_dictionary);
 	ClassDB::bind_method(D_METHOD("add_file", "pck_path", "source_path"), &PCKPacker::add_file);
 	ClassDB::bind_method(D_METHOD("flush", "verbose"), &PCKPacker::flush, DEFVAL(false));
 };
 
-Error PCKPacker::pck_start(const String &p_file, int p_alignment) {
+Error PCKPacker::pck_start(const String &p_file, int p_alignment, bool p_compress) {
 
 	if (file != nullptr) {
 		memdelete(file);
@@ -72,6 +77,7 @@ Error PCKPacker::pck_start(const String &p_file, int p_alignment) {
 	ERR_FAIL_COND_V_MSG(!file, ERR_CANT_CREATE, "Can't open file to write: " + String(p_file) + ".");
 
 	alignment = p_alignment;
+	compress = p_compress;
 
 	file->store_32(PACK_HEADER_MAGIC);
 	file->store_32(PACK_FORMAT_VERSION);
@@ -89,6 +95,16 @@ Error PCKPacker::pck_start(const String &p_file, int p_alignment) {
 	return OK;
 };
 
+void PCKPacker::set_compression_dictionary(const Vector<uint8_t> &p_dictionary) {
+
+	dictionary = p_dictionary;
+}
+
+Vector<uint8_t> PCKPacker::get_compression_dictionary() const {
+
+	return dictionary;
+}
+
 Error PCKPacker::add_file(const String &p_file, const String &p_src) {
 
 	FileAccess *f = FileAccess::open(p_src, FileAccess::READ);
@@ -114,9 +130,27 @@ Error PCKPacker::flush(bool p_verbose) {
 
 	ERR_FAIL_COND_V_MSG(!file, ERR_INVALID_PARAMETER, "File must be opened before use.");
 
+	bool use_dictionary = compress && dictionary.size() > 0;
+	uint64_t dictionary_offset_offset = 0;
+	if (use_dictionary) {
+		dictionary_id = Compression::register_dictionary(dictionary);
+		ERR_FAIL_COND_V_MSG(dictionary_id == 0, ERR_INVALID_DATA, "Can't register the compression dictionary.");
+	}
+
 	// write the index
 
-	file->store_32(files.size());
+	file->store_32(files.size() + (use_dictionary ? 1 : 0));
+
+	if (use_dictionary) {
+		file->store_pascal_string("res://.pck_dictionary"); // Not added as a file when loading.
+		dictionary_offset_offset = file->get_position();
+		file->store_64(0); // offset
+		file->store_64(dictionary.size()); // size
+		for (int i = 0; i < 4; i++) {
+			file->store_32(0); // md5
+		}
+		file->store_32(PACK_FILE_DICTIONARY); // flags
+	}
 
 	for (int i = 0; i < files.size(); i++) {
 
@@ -130,6 +164,8 @@ Error PCKPacker::flush(bool p_verbose) {
 		file->store_32(0);
 		file->store_32(0);
 		file->store_32(0);
+
+		file->store_32(0); // flags
 	};
 
 	uint64_t ofs = file->get_position();
@@ -137,6 +173,17 @@ Error PCKPacker::flush(bool p_verbose) {
 
 	_pad(file, ofs - file->get_position());
 
+	if (use_dictionary) {
+		file->store_buffer(dictionary.ptr(), dictionary.size());
+		uint64_t pos = file->get_position();
+		file->seek(dictionary_offset_offset);
+		file->store_64(ofs);
+		file->seek(pos);
+
+		ofs = _align(ofs + dictionary.size(), alignment);
+		_pad(file, ofs - pos);
+	}
+
 	const uint32_t buf_max = 65536;
 	uint8_t *buf = memnew_arr(uint8_t, buf_max);
 
@@ -144,20 +191,40 @@ Error PCKPacker::flush(bool p_verbose) {
 	for (int i = 0; i < files.size(); i++) {
 
 		FileAccess *src = FileAccess::open(files[i].src_path, FileAccess::READ);
-		uint64_t to_write = files[i].size;
-		while (to_write > 0) {
-
-			int read = src->get_buffer(buf, MIN(to_write, buf_max));
-			file->store_buffer(buf, read);
-			to_write -= read;
-		};
+		uint64_t written = files[i].size;
+		uint32_t flags = 0;
+
+		Vector<uint8_t> data;
+		Vector<uint8_t> compressed;
+		if (compress) {
+			data.resize(files[i].size);
+			src->get_buffer(data.ptrw(), data.size());
+		}
+
+		if (compress && _compress_file(data, compressed)) {
+			file->store_buffer(compressed.ptr(), compressed.size());
+			written = compressed.size();
+			flags |= PACK_FILE_COMPRESSED;
+		} else if (compress) {
+			file->store_buffer(data.ptr(), data.size());
+		} else {
+			uint64_t to_write = files[i].size;
+			while (to_write > 0) {
+
+				int read = src->get_buffer(buf, MIN(to_write, buf_max));
+				file->store_buffer(buf, read);
+				to_write -= read;
+			};
+		}
 
 		uint64_t pos = file->get_position();
 		file->seek(files[i].offset_offset); // go back to store the file's offset
 		file->store_64(ofs);
+		file->seek(files[i].offset_offset + 8 + 8 + 16); // and flags, past size and md5
+		file->store_32(flags);
 		file->seek(pos);
 
-		ofs = _align(ofs + files[i].size, alignment);
+		ofs = _align(ofs + written, alignment);
 		_pad(file, ofs - pos);
 
 		src->close();
@@ -177,12 +244,92 @@ Error PCKPacker::flush(bool p_verbose) {
 	file->close();
 	memdelete_arr(buf);
 
+	if (use_dictionary) {
+		Compression::unregister_dictionary(dictionary_id);
+		dictionary_id = 0;
+	}
+
 	return OK;
 };
 
+void PCKPacker::_compress_block(uint32_t p_index, CompressedBlocks *p_blocks) {
+
+	uint64_t from = uint64_t(p_index) * COMPRESSED_BLOCK_SIZE;
+	int size = MIN(uint64_t(COMPRESSED_BLOCK_SIZE), p_blocks->src_size - from);
+	const uint8_t *src = p_blocks->src + from;
+
+	Vector<uint8_t> &block = p_blocks->blocks[p_index];
+	block.resize(Compression::get_max_compressed_buffer_size(size, Compression::MODE_ZSTD));
+	int ret = Compression::compress(block.ptrw(), src, size, Compression::MODE_ZSTD, dictionary_id);
+
+	if (ret > 0 && ret < size) {
+		block.resize(ret);
+	} else {
+		// Doesn't compress, store as is so reading it is a plain copy.
+		block.resize(size);
+		copymem(block.ptrw(), src, size);
+	}
+}
+
+// Splits p_data in blocks compressed on their own, in the layout FileAccessPackCompressed reads.
+// Returns false when that wouldn't make the file any smaller.
+bool PCKPacker::_compress_file(const Vector<uint8_t> &p_data, Vector<uint8_t> &r_compressed) {
+
+	uint64_t size = p_data.size();
+	uint32_t block_count = (size + COMPRESSED_BLOCK_SIZE - 1) / COMPRESSED_BLOCK_SIZE;
+	if (block_count == 0) {
+		return false;
+	}
+
+	Vector<Vector<uint8_t>> blocks;
+	blocks.resize(block_count);
+
+	CompressedBlocks cb;
+	cb.src = p_data.ptr();
+	cb.src_size = size;
+	cb.blocks = blocks.ptrw();
+
+	JobSystem *job_system = JobSystem::get_singleton();
+	if (job_system && job_system->get_thread_count() > 0) {
+		job_system->do_work(block_count, this, &PCKPacker::_compress_block, &cb, 1);
+	} else {
+		for (uint32_t i = 0; i < block_count; i++) {
+			_compress_block(i, &cb);
+		}
+	}
+
+	uint64_t header_size = 8 + (uint64_t(block_count) + 1) * 8;
+	uint64_t total = header_size;
+	for (uint32_t i = 0; i < block_count; i++) {
+		total += blocks[i].size();
+	}
+
+	if (total >= size) {
+		return false;
+	}
+
+	r_compressed.resize(total);
+	uint8_t *w = r_compressed.ptrw();
+	encode_uint32(COMPRESSED_BLOCK_SIZE, &w[0]);
+	encode_uint32(block_count, &w[4]);
+
+	uint64_t ofs = header_size;
+	for (uint32_t i = 0; i < block_count; i++) {
+		encode_uint64(ofs, &w[8 + i * 8]);
+		copymem(&w[ofs], blocks[i].ptr(), blocks[i].size());
+		ofs += blocks[i].size();
+	}
+	encode_uint64(ofs, &w[8 + block_count * 8]);
+
+	return true;
+}
+
 PCKPacker::PCKPacker() {
 
 	file = nullptr;
+	alignment = 0;
+	compress = false;
+	dictionary_id = 0;
 };
 
 PCKPacker::~PCKPacker() {
@@ -39,8 +39,15 @@ class PCKPacker : public Reference {
 
 	GDCLASS(PCKPacker, Reference);
 
+	enum {
+		COMPRESSED_BLOCK_SIZE = 64 * 1024,
+	};
+
 	FileAccess *file;
 	int alignment;
+	bool compress;
+	Vector<uint8_t> dictionary;
+	uint32_t dictionary_id; // Only registered during flush().
 
 	static void _bind_methods();
 
@@ -53,8 +60,19 @@ class PCKPacker : public Reference {
 	};
 	Vector<File> files;
 
+	struct CompressedBlocks {
+		const uint8_t *src;
+		uint64_t src_size;
+		Vector<uint8_t> *blocks;
+	};
+
+	void _compress_block(uint32_t p_index, CompressedBlocks *p_blocks);
+	bool _compress_file(const Vector<uint8_t> &p_data, Vector<uint8_t> &r_compressed);
+
 public:
-	Error pck_start(const String &p_file, int p_alignment = 0);
+	Error pck_start(const String &p_file, int p_alignment = 0, bool p_compress = false);
+	void set_compression_dictionary(const Vector<uint8_t> &p_dictionary);
+	Vector<uint8_t> get_compression_dictionary() const;
 	Error add_file(const String &p_file, const String &p_src);
 	Error flush(bool p_verbose = false);
 
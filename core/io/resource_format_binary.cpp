@@ -30,6 +30,7 @@
 
 #include "resource_format_binary.h"
 
+#include "core/engine.h"
 #include "core/image.h"
 #include "core/io/file_access_compressed.h"
 #include "core/io/marshalls.h"
@@ -87,12 +88,40 @@ enum {
 	OBJECT_EXTERNAL_RESOURCE_INDEX = 3,
 	//version 2: added 64 bits support for float and int
 	//version 3: changed nodepath encoding
-	FORMAT_VERSION = 3,
+	//version 4: aligned plain data arrays, listed in a table at the end of the file
+	FORMAT_VERSION = 4,
 	FORMAT_VERSION_CAN_RENAME_DEPS = 1,
 	FORMAT_VERSION_NO_NODEPATH_PROPERTY = 3,
+	FORMAT_VERSION_ALIGNED_ARRAYS = 4,
 
 };
 
+enum {
+	ARRAY_ALIGNMENT = 16,
+	ARRAY_LARGE_ALIGNMENT = 64, // Cache line, so large arrays can be used in place from a mapping.
+	ARRAY_LARGE_SIZE = 4096,
+	HEADER_ALIGNMENT = 64, // Renaming dependencies shifts the rest of the file by a multiple of this.
+};
+
+static uint64_t _get_array_alignment(uint64_t p_size) {
+
+	return p_size >= ARRAY_LARGE_SIZE ? ARRAY_LARGE_ALIGNMENT : ARRAY_ALIGNMENT;
+}
+
+void ResourceLoaderBinary::_advance_array_alignment(uint64_t p_size) {
+
+	if (ver_format < FORMAT_VERSION_ALIGNED_ARRAYS || p_size == 0) {
+		return;
+	}
+
+	uint64_t alignment = _get_array_alignment(p_size);
+	uint64_t pos = f->get_position();
+	uint64_t aligned = (pos + alignment - 1) & ~(alignment - 1);
+	if (aligned != pos) {
+		f->seek(aligned);
+	}
+}
+
 void ResourceLoaderBinary::_advance_padding(uint32_t p_len) {
 
 	uint32_t extra = 4 - (p_len % 4);
@@ -102,18 +131,85 @@ void ResourceLoaderBinary::_advance_padding(uint32_t p_len) {
 	}
 }
 
+bool ResourceLoaderBinary::_defer_variant(Resource::DeferredProperty &r_deferred) {
+
+	uint64_t offset = f->get_position();
+	uint32_t type = f->get_32();
+
+	// Only arrays of plain data can be skipped without parsing them.
+	uint32_t element_size = 0;
+	switch (type) {
+		case VARIANT_RAW_ARRAY: element_size = 1; break;
+		case VARIANT_INT32_ARRAY: element_size = sizeof(int32_t); break;
+		case VARIANT_INT64_ARRAY: element_size = sizeof(int64_t); break;
+		case VARIANT_FLOAT32_ARRAY: element_size = sizeof(float); break;
+		case VARIANT_FLOAT64_ARRAY: element_size = sizeof(double); break;
+		case VARIANT_VECTOR2_ARRAY: element_size = sizeof(real_t) * 2; break;
+		case VARIANT_VECTOR3_ARRAY: element_size = sizeof(real_t) * 3; break;
+		case VARIANT_COLOR_ARRAY: element_size = sizeof(real_t) * 4; break;
+	}
+
+	uint32_t length = element_size ? f->get_32() : 0;
+	uint64_t size = uint64_t(length) * element_size;
+
+	if (size == 0 || size < lazy_load_min_size) {
+		f->seek(offset);
+		return false;
+	}
+
+	_advance_array_alignment(size);
+	if (type == VARIANT_RAW_ARRAY) {
+		size = (size + 3) & ~uint64_t(3); //padded to 32
+	}
+
+	r_deferred.path = file_path;
+	r_deferred.offset = offset;
+	r_deferred.length = length;
+	r_deferred.load_func = _load_deferred_variant;
+
+	f->seek(f->get_position() + size);
+	return true;
+}
+
+Variant ResourceLoaderBinary::_load_deferred_variant(const Resource::DeferredProperty &p_property) {
+
+	Error err;
+	FileAccess *f = FileAccess::open(p_property.path, FileAccess::READ, &err);
+	ERR_FAIL_COND_V_MSG(!f, Variant(), "Cannot open file '" + p_property.path + "'.");
+
+	ResourceLoaderBinary loader;
+	loader.local_path = p_property.path;
+	loader.open(f);
+	ERR_FAIL_COND_V(loader.error != OK, Variant());
+
+	loader.f->seek(p_property.offset + 4);
+	ERR_FAIL_COND_V_MSG(loader.f->get_32() != p_property.length, Variant(), "File '" + p_property.path + "' changed since it was loaded, can't read deferred property.");
+	loader.f->seek(p_property.offset);
+
+	Variant value;
+	err = loader.parse_variant(value);
+	ERR_FAIL_COND_V_MSG(err != OK, Variant(), "Failed to read deferred property from '" + p_property.path + "'.");
+
+	return value;
+}
+
 StringName ResourceLoaderBinary::_get_string() {
 
 	uint32_t id = f->get_32();
 	if (id & 0x80000000) {
 		uint32_t len = id & 0x7FFFFFFF;
+		if (len == 0)
+			return StringName();
+		String s;
+		const uint8_t *view = f->get_buffer_view(len);
+		if (view) {
+			s.parse_utf8((const char *)view, len);
+			return s;
+		}
 		if ((int)len > str_buf.size()) {
 			str_buf.resize(len);
 		}
-		if (len == 0)
-			return StringName();
 		f->get_buffer((uint8_t *)&str_buf[0], len);
-		String s;
 		s.parse_utf8(&str_buf[0]);
 		return s;
 	}
@@ -454,6 +550,7 @@ Error ResourceLoaderBinary::parse_variant(Variant &r_v) {
 		case VARIANT_RAW_ARRAY: {
 
 			uint32_t len = f->get_32();
+			_advance_array_alignment(len);
 
 			Vector<uint8_t> array;
 			array.resize(len);
@@ -467,6 +564,7 @@ Error ResourceLoaderBinary::parse_variant(Variant &r_v) {
 		case VARIANT_INT32_ARRAY: {
 
 			uint32_t len = f->get_32();
+			_advance_array_alignment(len * sizeof(int32_t));
 
 			Vector<int32_t> array;
 			array.resize(len);
@@ -488,6 +586,7 @@ Error ResourceLoaderBinary::parse_variant(Variant &r_v) {
 		case VARIANT_INT64_ARRAY: {
 
 			uint32_t len = f->get_32();
+			_advance_array_alignment(len * sizeof(int64_t));
 
 			Vector<int64_t> array;
 			array.resize(len);
@@ -509,6 +608,7 @@ Error ResourceLoaderBinary::parse_variant(Variant &r_v) {
 		case VARIANT_FLOAT32_ARRAY: {
 
 			uint32_t len = f->get_32();
+			_advance_array_alignment(len * sizeof(float));
 
 			Vector<float> array;
 			array.resize(len);
@@ -530,6 +630,7 @@ Error ResourceLoaderBinary::parse_variant(Variant &r_v) {
 		case VARIANT_FLOAT64_ARRAY: {
 
 			uint32_t len = f->get_32();
+			_advance_array_alignment(len * sizeof(double));
 
 			Vector<double> array;
 			array.resize(len);
@@ -563,6 +664,7 @@ Error ResourceLoaderBinary::parse_variant(Variant &r_v) {
 		case VARIANT_VECTOR2_ARRAY: {
 
 			uint32_t len = f->get_32();
+			_advance_array_alignment(len * sizeof(real_t) * 2);
 
 			Vector<Vector2> array;
 			array.resize(len);
@@ -590,6 +692,7 @@ Error ResourceLoaderBinary::parse_variant(Variant &r_v) {
 		case VARIANT_VECTOR3_ARRAY: {
 
 			uint32_t len = f->get_32();
+			_advance_array_alignment(len * sizeof(real_t) * 3);
 
 			Vector<Vector3> array;
 			array.resize(len);
@@ -617,6 +720,7 @@ Error ResourceLoaderBinary::parse_variant(Variant &r_v) {
 		case VARIANT_COLOR_ARRAY: {
 
 			uint32_t len = f->get_32();
+			_advance_array_alignment(len * sizeof(real_t) * 4);
 
 			Vector<Color> array;
 			array.resize(len);
@@ -785,6 +889,14 @@ Error ResourceLoaderBinary::load() {
 				ERR_FAIL_V(ERR_FILE_CORRUPT);
 			}
 
+			if (lazy_load_min_size && r->can_defer_property(name)) {
+				Resource::DeferredProperty deferred;
+				if (_defer_variant(deferred)) {
+					r->set_deferred_property(name, deferred);
+					continue;
+				}
+			}
+
 			Variant value;
 
 			error = parse_variant(value);
@@ -843,13 +955,18 @@ static String get_ustring(FileAccess *f) {
 String ResourceLoaderBinary::get_unicode_string() {
 
 	int len = f->get_32();
+	if (len == 0)
+		return String();
+	String s;
+	const uint8_t *view = f->get_buffer_view(len);
+	if (view) {
+		s.parse_utf8((const char *)view, len);
+		return s;
+	}
 	if (len > str_buf.size()) {
 		str_buf.resize(len);
 	}
-	if (len == 0)
-		return String();
 	f->get_buffer((uint8_t *)&str_buf[0], len);
-	String s;
 	s.parse_utf8(&str_buf[0]);
 	return s;
 }
@@ -872,6 +989,25 @@ void ResourceLoaderBinary::get_dependencies(FileAccess *p_f, List<String> *p_dep
 	}
 }
 
+Error ResourceLoaderBinary::get_aligned_arrays(Vector<AlignedArray> *r_arrays) {
+
+	ERR_FAIL_COND_V(!f, ERR_UNCONFIGURED);
+	if (array_table_ofs == 0) {
+		return OK; //format version 3 or older, arrays are not aligned
+	}
+
+	f->seek(array_table_ofs);
+	uint32_t count = f->get_32();
+	for (uint32_t i = 0; i < count; i++) {
+		AlignedArray array;
+		array.offset = f->get_64();
+		array.size = f->get_64();
+		r_arrays->push_back(array);
+	}
+
+	return f->eof_reached() ? ERR_FILE_CORRUPT : OK;
+}
+
 void ResourceLoaderBinary::open(FileAccess *p_f) {
 
 	error = OK;
@@ -928,7 +1064,13 @@ void ResourceLoaderBinary::open(FileAccess *p_f) {
 	print_bl("type: " + type);
 
 	importmd_ofs = f->get_64();
-	for (int i = 0; i < 14; i++)
+	array_table_ofs = 0;
+	int reserved = 14;
+	if (ver_format >= FORMAT_VERSION_ALIGNED_ARRAYS) {
+		array_table_ofs = f->get_64();
+		reserved -= 2;
+	}
+	for (int i = 0; i < reserved; i++)
 		f->get_32(); //skip a few reserved fields
 
 	uint32_t string_table_size = f->get_32();
@@ -953,6 +1095,13 @@ void ResourceLoaderBinary::open(FileAccess *p_f) {
 	}
 
 	print_bl("ext resources: " + itos(ext_resources_size));
+
+	if (ver_format >= FORMAT_VERSION_ALIGNED_ARRAYS) {
+		// Keeps the rest of the file aligned when dependencies are renamed.
+		uint32_t padding = f->get_32();
+		f->seek(f->get_position() + padding);
+	}
+
 	uint32_t int_resources_size = f->get_32();
 
 	for (uint32_t i = 0; i < int_resources_size; i++) {
@@ -1023,9 +1172,11 @@ ResourceLoaderBinary::ResourceLoaderBinary() :
 		ver_format(0),
 		f(nullptr),
 		importmd_ofs(0),
+		array_table_ofs(0),
 		error(OK) {
 
 	use_nocache = false;
+	lazy_load_min_size = 0;
 	progress = nullptr;
 	use_sub_threads = false;
 }
@@ -1036,6 +1187,8 @@ ResourceLoaderBinary::~ResourceLoaderBinary() {
 		memdelete(f);
 }
 
+uint32_t ResourceFormatLoaderBinary::lazy_load_min_size = 0;
+
 RES ResourceFormatLoaderBinary::load(const String &p_path, const String &p_original_path, Error *r_error, bool p_use_sub_threads, float *r_progress, bool p_no_cache) {
 
 	if (r_error)
@@ -1053,6 +1206,11 @@ RES ResourceFormatLoaderBinary::load(const String &p_path, const String &p_origi
 	String path = p_original_path != "" ? p_original_path : p_path;
 	loader.local_path = ProjectSettings::get_singleton()->localize_path(path);
 	loader.res_path = loader.local_path;
+	loader.file_path = p_path;
+	if (!Engine::get_singleton()->is_editor_hint()) {
+		// The editor reimports and saves files under loaded resources.
+		loader.lazy_load_min_size = lazy_load_min_size;
+	}
 	//loader.set_local_path( Globals::get_singleton()->localize_path(p_path) );
 	loader.open(f);
 
@@ -1114,6 +1272,22 @@ void ResourceFormatLoaderBinary::get_dependencies(const String &p_path, List<Str
 	loader.get_dependencies(f, p_dependencies, p_add_types);
 }
 
+Error ResourceFormatLoaderBinary::get_aligned_arrays(const String &p_path, Vector<ResourceLoaderBinary::AlignedArray> *r_arrays) {
+
+	FileAccess *f = FileAccess::open(p_path, FileAccess::READ);
+	ERR_FAIL_COND_V_MSG(!f, ERR_CANT_OPEN, "Cannot open file '" + p_path + "'.");
+
+	ResourceLoaderBinary loader;
+	loader.local_path = ProjectSettings::get_singleton()->localize_path(p_path);
+	loader.res_path = loader.local_path;
+	loader.open(f);
+	if (loader.error != OK) {
+		return loader.error;
+	}
+
+	return loader.get_aligned_arrays(r_arrays);
+}
+
 Error ResourceFormatLoaderBinary::rename_dependencies(const String &p_path, const Map<String, String> &p_map) {
 
 	//Error error=OK;
@@ -1231,7 +1405,15 @@ Error ResourceFormatLoaderBinary::rename_dependencies(const String &p_path, cons
 	size_t importmd_ofs = f->get_64();
 	fw->store_64(0); //metadata offset
 
-	for (int i = 0; i < 14; i++) {
+	int reserved = 14;
+	uint64_t array_table_ofs = 0;
+	if (ver_format >= FORMAT_VERSION_ALIGNED_ARRAYS) {
+		array_table_ofs = f->get_64();
+		fw->store_64(0); //array table offset
+		reserved -= 2;
+	}
+
+	for (int i = 0; i < reserved; i++) {
 		fw->store_32(0);
 		f->get_32();
 	}
@@ -1275,6 +1457,19 @@ Error ResourceFormatLoaderBinary::rename_dependencies(const String &p_path, cons
 		save_ustring(fw, path);
 	}
 
+	if (ver_format >= FORMAT_VERSION_ALIGNED_ARRAYS) {
+		// Pad so the rest of the file moves by a multiple of the array
+		// alignment and the arrays in it stay aligned.
+		uint32_t old_padding = f->get_32();
+		f->seek(f->get_position() + old_padding);
+		int64_t shift = (int64_t)fw->get_position() + 4 - (int64_t)f->get_position();
+		uint32_t padding = (HEADER_ALIGNMENT - (shift % HEADER_ALIGNMENT)) % HEADER_ALIGNMENT;
+		fw->store_32(padding);
+		for (uint32_t i = 0; i < padding; i++) {
+			fw->store_8(0);
+		}
+	}
+
 	int64_t size_diff = (int64_t)fw->get_position() - (int64_t)f->get_position();
 
 	//internal resources
@@ -1301,6 +1496,18 @@ Error ResourceFormatLoaderBinary::rename_dependencies(const String &p_path, cons
 	fw->seek(md_ofs);
 	fw->store_64(importmd_ofs + size_diff);
 
+	if (array_table_ofs) {
+		fw->store_64(array_table_ofs + size_diff);
+
+		f->seek(array_table_ofs);
+		uint32_t array_count = f->get_32();
+		fw->seek(array_table_ofs + size_diff + 4);
+		for (uint32_t i = 0; i < array_count; i++) {
+			fw->store_64(f->get_64() + size_diff); //offset
+			fw->store_64(f->get_64()); //size
+		}
+	}
+
 	memdelete(f);
 	memdelete(fw);
 
@@ -1334,6 +1541,25 @@ String ResourceFormatLoaderBinary::get_resource_type(const String &p_path) const
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
 
+void ResourceFormatSaverBinaryInstance::_align_array(FileAccess *f, uint64_t p_size, Vector<ResourceLoaderBinary::AlignedArray> *r_aligned_arrays) {
+
+	if (!r_aligned_arrays || p_size == 0) {
+		return; //unaligned, as in format version 3
+	}
+
+	uint64_t alignment = _get_array_alignment(p_size);
+	uint64_t pos = f->get_position();
+	uint64_t aligned = (pos + alignment - 1) & ~(alignment - 1);
+	for (uint64_t i = pos; i < aligned; i++) {
+		f->store_8(0);
+	}
+
+	ResourceLoaderBinary::AlignedArray array;
+	array.offset = aligned;
+	array.size = p_size;
+	r_aligned_arrays->push_back(array);
+}
+
 void ResourceFormatSaverBinaryInstance::_pad_buffer(FileAccess *f, int p_bytes) {
 
 	int extra = 4 - (p_bytes % 4);
@@ -1345,10 +1571,10 @@ void ResourceFormatSaverBinaryInstance::_pad_buffer(FileAccess *f, int p_bytes)
 
 void ResourceFormatSaverBinaryInstance::_write_variant(const Variant &p_property, const PropertyInfo &p_hint) {
 
-	write_variant(f, p_property, resource_set, external_resources, string_map, p_hint);
+	write_variant(f, p_property, resource_set, external_resources, string_map, p_hint, &aligned_arrays);
 }
 
-void ResourceFormatSaverBinaryInstance::write_variant(FileAccess *f, const Variant &p_property, Set<RES> &resource_set, Map<RES, int> &external_resources, Map<StringName, int> &string_map, const PropertyInfo &p_hint) {
+void ResourceFormatSaverBinaryInstance::write_variant(FileAccess *f, const Variant &p_property, Set<RES> &resource_set, Map<RES, int> &external_resources, Map<StringName, int> &string_map, const PropertyInfo &p_hint, Vector<ResourceLoaderBinary::AlignedArray> *r_aligned_arrays) {
 
 	switch (p_property.get_type()) {
 
@@ -1629,8 +1855,8 @@ void ResourceFormatSaverBinaryInstance::write_variant(FileAccess *f, const Varia
 					continue;
 				*/
 
-				write_variant(f, E->get(), resource_set, external_resources, string_map);
-				write_variant(f, d[E->get()], resource_set, external_resources, string_map);
+				write_variant(f, E->get(), resource_set, external_resources, string_map, PropertyInfo(), r_aligned_arrays);
+				write_variant(f, d[E->get()], resource_set, external_resources, string_map, PropertyInfo(), r_aligned_arrays);
 			}
 
 		} break;
@@ -1641,7 +1867,7 @@ void ResourceFormatSaverBinaryInstance::write_variant(FileAccess *f, const Varia
 			f->store_32(uint32_t(a.size()));
 			for (int i = 0; i < a.size(); i++) {
 
-				write_variant(f, a[i], resource_set, external_resources, string_map);
+				write_variant(f, a[i], resource_set, external_resources, string_map, PropertyInfo(), r_aligned_arrays);
 			}
 
 		} break;
@@ -1651,6 +1877,7 @@ void ResourceFormatSaverBinaryInstance::write_variant(FileAccess *f, const Varia
 			Vector<uint8_t> arr = p_property;
 			int len = arr.size();
 			f->store_32(len);
+			_align_array(f, len, r_aligned_arrays);
 			const uint8_t *r = arr.ptr();
 			f->store_buffer(r, len);
 			_pad_buffer(f, len);
@@ -1662,6 +1889,7 @@ void ResourceFormatSaverBinaryInstance::write_variant(FileAccess *f, const Varia
 			Vector<int32_t> arr = p_property;
 			int len = arr.size();
 			f->store_32(len);
+			_align_array(f, len * sizeof(int32_t), r_aligned_arrays);
 			const int32_t *r = arr.ptr();
 			for (int i = 0; i < len; i++)
 				f->store_32(r[i]);
@@ -1673,6 +1901,7 @@ void ResourceFormatSaverBinaryInstance::write_variant(FileAccess *f, const Varia
 			Vector<int64_t> arr = p_property;
 			int len = arr.size();
 			f->store_32(len);
+			_align_array(f, len * sizeof(int64_t), r_aligned_arrays);
 			const int64_t *r = arr.ptr();
 			for (int i = 0; i < len; i++)
 				f->store_64(r[i]);
@@ -1684,6 +1913,7 @@ void ResourceFormatSaverBinaryInstance::write_variant(FileAccess *f, const Varia
 			Vector<float> arr = p_property;
 			int len = arr.size();
 			f->store_32(len);
+			_align_array(f, len * sizeof(float), r_aligned_arrays);
 			const float *r = arr.ptr();
 			for (int i = 0; i < len; i++) {
 				f->store_real(r[i]);
@@ -1696,6 +1926,7 @@ void ResourceFormatSaverBinaryInstance::write_variant(FileAccess *f, const Varia
 			Vector<double> arr = p_property;
 			int len = arr.size();
 			f->store_32(len);
+			_align_array(f, len * sizeof(double), r_aligned_arrays);
 			const double *r = arr.ptr();
 			for (int i = 0; i < len; i++) {
 				f->store_double(r[i]);
@@ -1720,6 +1951,7 @@ void ResourceFormatSaverBinaryInstance::write_variant(FileAccess *f, const Varia
 			Vector<Vector3> arr = p_property;
 			int len = arr.size();
 			f->store_32(len);
+			_align_array(f, len * sizeof(real_t) * 3, r_aligned_arrays);
 			const Vector3 *r = arr.ptr();
 			for (int i = 0; i < len; i++) {
 				f->store_real(r[i].x);
@@ -1734,6 +1966,7 @@ void ResourceFormatSaverBinaryInstance::write_variant(FileAccess *f, const Varia
 			Vector<Vector2> arr = p_property;
 			int len = arr.size();
 			f->store_32(len);
+			_align_array(f, len * sizeof(real_t) * 2, r_aligned_arrays);
 			const Vector2 *r = arr.ptr();
 			for (int i = 0; i < len; i++) {
 				f->store_real(r[i].x);
@@ -1747,6 +1980,7 @@ void ResourceFormatSaverBinaryInstance::write_variant(FileAccess *f, const Varia
 			Vector<Color> arr = p_property;
 			int len = arr.size();
 			f->store_32(len);
+			_align_array(f, len * sizeof(real_t) * 4, r_aligned_arrays);
 			const Color *r = arr.ptr();
 			for (int i = 0; i < len; i++) {
 				f->store_real(r[i].r);
@@ -1932,7 +2166,9 @@ Error ResourceFormatSaverBinaryInstance::save(const String &p_path, const RES &p
 
 	save_unicode_string(f, p_resource->get_class());
 	f->store_64(0); //offset to import metadata
-	for (int i = 0; i < 14; i++)
+	uint64_t array_table_ofs_pos = f->get_position();
+	f->store_64(0); //offset to aligned array table
+	for (int i = 0; i < 12; i++)
 		f->store_32(0); // reserved
 
 	List<ResourceData> resources;
@@ -2001,6 +2237,9 @@ Error ResourceFormatSaverBinaryInstance::save(const String &p_path, const RES &p
 		path = relative_paths ? local_path.path_to_file(path) : path;
 		save_unicode_string(f, path);
 	}
+
+	f->store_32(0); //padding, used when renaming dependencies
+
 	// save internal resource table
 	f->store_32(saved_resources.size()); //amount of internal resources
 	Vector<uint64_t> ofs_pos;
@@ -2050,6 +2289,7 @@ Error ResourceFormatSaverBinaryInstance::save(const String &p_path, const RES &p
 	}
 
 	Vector<uint64_t> ofs_table;
+	aligned_arrays.clear();
 
 	//now actually save the resources
 	for (List<ResourceData>::Element *E = resources.front(); E; E = E->next()) {
@@ -2075,6 +2315,18 @@ Error ResourceFormatSaverBinaryInstance::save(const String &p_path, const RES &p
 
 	f->seek_end();
 
+	// save aligned array table
+	uint64_t array_table_ofs = f->get_position();
+	f->store_32(aligned_arrays.size());
+	for (int i = 0; i < aligned_arrays.size(); i++) {
+		f->store_64(aligned_arrays[i].offset);
+		f->store_64(aligned_arrays[i].size);
+	}
+
+	f->seek(array_table_ofs_pos);
+	f->store_64(array_table_ofs);
+	f->seek_end();
+
 	f->store_buffer((const uint8_t *)"RSRC", 4); //magic at end
 
 	if (f->get_error() != OK && f->get_error() != ERR_FILE_EOF) {
@@ -36,10 +36,19 @@
 #include "core/os/file_access.h"
 
 class ResourceLoaderBinary {
+public:
+	// Plain data array payload, aligned in the file since format version 4.
+	struct AlignedArray {
+		uint64_t offset;
+		uint64_t size;
+	};
+
+private:
 
 	bool translation_remapped;
 	String local_path;
 	String res_path;
+	String file_path; // File actually read, which is the imported one for imported resources.
 	String type;
 	Ref<Resource> resource;
 	uint32_t ver_format;
@@ -47,6 +56,7 @@ class ResourceLoaderBinary {
 	FileAccess *f;
 
 	uint64_t importmd_ofs;
+	uint64_t array_table_ofs;
 
 	Vector<char> str_buf;
 	List<RES> resource_cache;
@@ -75,15 +85,19 @@ class ResourceLoaderBinary {
 
 	String get_unicode_string();
 	void _advance_padding(uint32_t p_len);
+	void _advance_array_alignment(uint64_t p_size);
 
 	Map<String, String> remaps;
 	Error error;
 
 	bool use_nocache;
+	uint32_t lazy_load_min_size;
 
 	friend class ResourceFormatLoaderBinary;
 
 	Error parse_variant(Variant &r_v);
+	bool _defer_variant(Resource::DeferredProperty &r_deferred);
+	static Variant _load_deferred_variant(const Resource::DeferredProperty &p_property);
 
 	Map<String, RES> dependency_cache;
 
@@ -97,13 +111,22 @@ public:
 	void open(FileAccess *p_f);
 	String recognize(FileAccess *p_f);
 	void get_dependencies(FileAccess *p_f, List<String> *p_dependencies, bool p_add_types);
+	Error get_aligned_arrays(Vector<AlignedArray> *r_arrays);
 
 	ResourceLoaderBinary();
 	~ResourceLoaderBinary();
 };
 
 class ResourceFormatLoaderBinary : public ResourceFormatLoader {
+
+	static uint32_t lazy_load_min_size;
+
 public:
+	// Arrays at least this big are left in the file for resources that can
+	// defer them, zero disables lazy loading.
+	static void set_lazy_load_min_size(uint32_t p_size) { lazy_load_min_size = p_size; }
+	static uint32_t get_lazy_load_min_size() { return lazy_load_min_size; }
+
 	virtual RES load(const String &p_path, const String &p_original_path = "", Error *r_error = nullptr, bool p_use_sub_threads = false, float *r_progress = nullptr, bool p_no_cache = false);
 	virtual void get_recognized_extensions_for_type(const String &p_type, List<String> *p_extensions) const;
 	virtual void get_recognized_extensions(List<String> *p_extensions) const;
@@ -111,6 +134,8 @@ public:
 	virtual String get_resource_type(const String &p_path) const;
 	virtual void get_dependencies(const String &p_path, List<String> *p_dependencies, bool p_add_types = false);
 	virtual Error rename_dependencies(const String &p_path, const Map<String, String> &p_map);
+
+	static Error get_aligned_arrays(const String &p_path, Vector<ResourceLoaderBinary::AlignedArray> *r_arrays);
 };
 
 class ResourceFormatSaverBinaryInstance {
@@ -139,6 +164,7 @@ class ResourceFormatSaverBinaryInstance {
 
 	Map<RES, int> external_resources;
 	List<RES> saved_resources;
+	Vector<ResourceLoaderBinary::AlignedArray> aligned_arrays;
 
 	struct Property {
 		int name_idx;
@@ -153,6 +179,7 @@ class ResourceFormatSaverBinaryInstance {
 	};
 
 	static void _pad_buffer(FileAccess *f, int p_bytes);
+	static void _align_array(FileAccess *f, uint64_t p_size, Vector<ResourceLoaderBinary::AlignedArray> *r_aligned_arrays);
 	void _write_variant(const Variant &p_property, const PropertyInfo &p_hint = PropertyInfo());
 	void _find_resources(const Variant &p_variant, bool p_main = false);
 	static void save_unicode_string(FileAccess *f, const String &p_string, bool p_bit_on_len = false);
@@ -160,7 +187,8 @@ class ResourceFormatSaverBinaryInstance {
 
 public:
 	Error save(const String &p_path, const RES &p_resource, uint32_t p_flags = 0);
-	static void write_variant(FileAccess *f, const Variant &p_property, Set<RES> &resource_set, Map<RES, int> &external_resources, Map<StringName, int> &string_map, const PropertyInfo &p_hint = PropertyInfo());
+	// Plain data arrays are aligned (format version 4) and listed in r_aligned_arrays when it's given.
+	static void write_variant(FileAccess *f, const Variant &p_property, Set<RES> &resource_set, Map<RES, int> &external_resources, Map<StringName, int> &string_map, const PropertyInfo &p_hint = PropertyInfo(), Vector<ResourceLoaderBinary::AlignedArray> *r_aligned_arrays = nullptr);
 };
 
 class ResourceFormatSaverBinary : public ResourceFormatSaver {
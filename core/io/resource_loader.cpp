@@ -223,10 +223,6 @@ void ResourceLoader::_thread_load_function(void *p_userdata) {
 	ThreadLoadTask &load_task = *(ThreadLoadTask *)p_userdata;
 	load_task.loader_id = Thread::get_caller_id();
 
-	if (load_task.semaphore) {
-		//this is an actual thread, so wait for Ok fom semaphore
-		thread_load_semaphore->wait(); //wait until its ok to start loading
-	}
 	load_task.resource = _load(load_task.remapped_path, load_task.remapped_path != load_task.local_path ? load_task.local_path : String(), load_task.type_hint, false, &load_task.error, load_task.use_sub_threads, &load_task.progress);
 
 	load_task.progress = 1.0; //it was fully loaded at this point, so force progress to 1.0
@@ -237,24 +233,8 @@ void ResourceLoader::_thread_load_function(void *p_userdata) {
 	} else {
 		load_task.status = THREAD_LOAD_LOADED;
 	}
-	if (load_task.semaphore) {
-
-		if (load_task.start_next && thread_waiting_count > 0) {
-			thread_waiting_count--;
-			//thread loading count remains constant, this ends but another one begins
-			thread_load_semaphore->post();
-		} else {
-			thread_loading_count--; //no threads waiting, just reduce loading count
-		}
 
-		print_lt("END: load count: " + itos(thread_loading_count) + " / wait count: " + itos(thread_waiting_count) + " / suspended count: " + itos(thread_suspended_count) + " / active: " + itos(thread_loading_count - thread_suspended_count));
-
-		for (int i = 0; i < load_task.poll_requests; i++) {
-			load_task.semaphore->post();
-		}
-		memdelete(load_task.semaphore);
-		load_task.semaphore = nullptr;
-	}
+	print_lt("END: " + load_task.local_path + " / tasks: " + itos(thread_load_tasks.size()));
 
 	if (load_task.resource.is_valid()) {
 		load_task.resource->set_path(load_task.local_path);
@@ -279,42 +259,16 @@ void ResourceLoader::_thread_load_function(void *p_userdata) {
 
 	thread_load_mutex->unlock();
 }
-Error ResourceLoader::load_threaded_request(const String &p_path, const String &p_type_hint, bool p_use_sub_threads, const String &p_source_resource) {
 
-	String local_path;
-	if (p_path.is_rel_path())
-		local_path = "res://" + p_path;
-	else
-		local_path = ProjectSettings::get_singleton()->localize_path(p_path);
+ResourceLoader::ThreadLoadTask *ResourceLoader::_request_task(const String &p_local_path, const String &p_type_hint, bool p_use_sub_threads) {
 
-	thread_load_mutex->lock();
+	//thread_load_mutex must be locked
 
-	if (p_source_resource != String()) {
-		//must be loading from this resource
-		if (!thread_load_tasks.has(p_source_resource)) {
-			thread_load_mutex->unlock();
-			ERR_FAIL_V_MSG(ERR_INVALID_PARAMETER, "There is no thread loading source resource '" + p_source_resource + "'.");
-		}
-		//must be loading from this thread
-		if (thread_load_tasks[p_source_resource].loader_id != Thread::get_caller_id()) {
-			thread_load_mutex->unlock();
-			ERR_FAIL_V_MSG(ERR_INVALID_PARAMETER, "Threading loading resource'" + local_path + " failed: Source specified: '" + p_source_resource + "' but was not called by it.");
-		}
-
-		//must not be already added as s sub tasks
-		if (thread_load_tasks[p_source_resource].sub_tasks.has(local_path)) {
-			thread_load_mutex->unlock();
-			ERR_FAIL_V_MSG(ERR_INVALID_PARAMETER, "Thread loading source resource '" + p_source_resource + "' already is loading '" + local_path + "'.");
-		}
-	}
-
-	if (thread_load_tasks.has(local_path)) {
-		thread_load_tasks[local_path].requests++;
-		if (p_source_resource != String()) {
-			thread_load_tasks[p_source_resource].sub_tasks.insert(local_path);
-		}
-		thread_load_mutex->unlock();
-		return OK;
+	ThreadLoadTask *existing = thread_load_tasks.getptr(p_local_path);
+	if (existing) {
+		//already being loaded (or loaded and not yet retrieved), share it
+		existing->requests++;
+		return existing;
 	}
 
 	{
@@ -323,24 +277,20 @@ Error ResourceLoader::load_threaded_request(const String &p_path, const String &
 		ThreadLoadTask load_task;
 
 		load_task.requests = 1;
-		load_task.remapped_path = _path_remap(local_path, &load_task.xl_remapped);
-		load_task.local_path = local_path;
+		load_task.remapped_path = _path_remap(p_local_path, &load_task.xl_remapped);
+		load_task.local_path = p_local_path;
 		load_task.type_hint = p_type_hint;
 		load_task.use_sub_threads = p_use_sub_threads;
 
 		{ //must check if resource is already loaded before attempting to load it in a thread
 
-			if (load_task.loader_id == Thread::get_caller_id()) {
-				thread_load_mutex->unlock();
-				ERR_FAIL_V_MSG(ERR_INVALID_PARAMETER, "Attempted to load a resource already being loaded from this thread, cyclic reference?");
-			}
 			//lock first if possible
 			if (ResourceCache::lock) {
 				ResourceCache::lock->read_lock();
 			}
 
 			//get ptr
-			Resource **rptr = ResourceCache::resources.getptr(local_path);
+			Resource **rptr = ResourceCache::resources.getptr(p_local_path);
 
 			if (rptr) {
 				RES res(*rptr);
@@ -357,57 +307,231 @@ Error ResourceLoader::load_threaded_request(const String &p_path, const String &
 			}
 		}
 
-		if (p_source_resource != String()) {
-			thread_load_tasks[p_source_resource].sub_tasks.insert(local_path);
-		}
+		thread_load_tasks[p_local_path] = load_task;
+	}
 
-		thread_load_tasks[local_path] = load_task;
+	ThreadLoadTask *load_task = thread_load_tasks.getptr(p_local_path);
+
+	if (load_task->resource.is_valid()) {
+		return load_task;
 	}
 
-	ThreadLoadTask &load_task = thread_load_tasks[local_path];
+	JobSystem *job_system = JobSystem::get_singleton();
+
+	if (!job_system || job_system->get_thread_count() == 0) {
+		//no worker threads to hand it to, so load it right away on this thread
+		load_task->loader_id = Thread::get_caller_id();
+		thread_load_mutex->unlock();
+		_thread_load_function(load_task);
+		thread_load_mutex->lock();
+		return load_task;
+	}
+
+	// Reading the dependencies means file I/O, so it happens in a job of its
+	// own instead of on the requesting thread with thread_load_mutex held.
+	// The load job is held until then, so it only starts once every
+	// dependency found is loaded, and independent sub-resources load in
+	// parallel. Each dependency does the same, expanding the whole graph.
+	load_task->requests++; // Held by the jobs until the load job is done.
+	load_task->job = job_system->add_held_task(load_task, &ThreadLoadTask::process, nullptr);
+	job_system->add_task(load_task, &ThreadLoadTask::expand, nullptr);
+
+	return load_task;
+}
+
+bool ResourceLoader::_task_depends_on(const String &p_local_path, const String &p_dependency, Set<String> &r_visited) {
 
-	if (load_task.resource.is_null()) { //needs  to be loaded in thread
+	//thread_load_mutex must be locked
 
-		load_task.semaphore = memnew(Semaphore);
-		if (thread_loading_count < thread_load_max) {
-			thread_loading_count++;
-			thread_load_semaphore->post(); //we have free threads, so allow one
+	if (r_visited.has(p_local_path)) {
+		return false;
+	}
+	r_visited.insert(p_local_path);
+
+	const ThreadLoadTask *load_task = thread_load_tasks.getptr(p_local_path);
+	if (!load_task) {
+		return false;
+	}
+
+	for (int i = 0; i < load_task->dependencies.size(); i++) {
+		if (load_task->dependencies[i] == p_dependency || _task_depends_on(load_task->dependencies[i], p_dependency, r_visited)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void ResourceLoader::_expand_task(ThreadLoadTask *p_load_task) {
+
+	List<String> dependencies;
+	get_dependencies(p_load_task->local_path, &dependencies, true);
+
+	JobSystem *job_system = JobSystem::get_singleton();
+	int waiting = 0;
+
+	thread_load_mutex->lock();
+
+	for (List<String>::Element *E = dependencies.front(); E; E = E->next()) {
+
+		String dep_path = E->get();
+		String dep_type;
+		int sep = dep_path.find("::");
+		if (sep != -1) {
+			dep_type = dep_path.substr(sep + 2, dep_path.length());
+			dep_path = dep_path.substr(0, sep);
+		}
+
+		if (dep_path.is_rel_path()) {
+			dep_path = "res://" + dep_path;
 		} else {
-			thread_waiting_count++;
+			dep_path = ProjectSettings::get_singleton()->localize_path(dep_path);
 		}
 
-		print_lt("REQUEST: load count: " + itos(thread_loading_count) + " / wait count: " + itos(thread_waiting_count) + " / suspended count: " + itos(thread_suspended_count) + " / active: " + itos(thread_loading_count - thread_suspended_count));
+		if (dep_path == p_load_task->local_path || p_load_task->dependencies.find(dep_path) != -1) {
+			continue;
+		}
+
+		// Dependencies are recorded and checked under the same lock, so of the
+		// tasks in a cycle, the last one to expand always sees it. The edge
+		// closing it is never recorded, which keeps the requests the tasks
+		// hold on each other from going around in a circle.
+		Set<String> visited;
+		if (_task_depends_on(dep_path, p_load_task->local_path, visited)) {
+			//waiting on it would never finish, let the format loader deal with it
+			print_verbose("Cyclic dependency between resources '" + p_load_task->local_path + "' and '" + dep_path + "', not loading them in parallel.");
+			continue;
+		}
 
-		load_task.thread = Thread::create(_thread_load_function, &thread_load_tasks[local_path]);
-		load_task.loader_id = load_task.thread->get_id();
+		ThreadLoadTask *dep_task = _request_task(dep_path, dep_type, p_load_task->use_sub_threads);
+		p_load_task->dependencies.push_back(dep_path);
+
+		if (dep_task->job.is_valid() && !dep_task->job.is_completed()) {
+			job_system->add_dependency(p_load_task->job, dep_task->job);
+			waiting++;
+		}
 	}
 
+	print_lt("REQUEST: " + p_load_task->local_path + " / dependencies: " + itos(p_load_task->dependencies.size()) + " / waiting on: " + itos(waiting));
+
+	JobSystem::Handle job = p_load_task->job;
+
 	thread_load_mutex->unlock();
 
-	return OK;
+	job_system->release(job);
 }
 
-float ResourceLoader::_dependency_get_progress(const String &p_path) {
+void ResourceLoader::_process_task(ThreadLoadTask *p_load_task) {
 
-	if (thread_load_tasks.has(p_path)) {
-		ThreadLoadTask &load_task = thread_load_tasks[p_path];
-		int dep_count = load_task.sub_tasks.size();
-		if (dep_count > 0) {
-			float dep_progress = 0;
-			for (Set<String>::Element *E = load_task.sub_tasks.front(); E; E = E->next()) {
-				dep_progress += _dependency_get_progress(E->get());
-			}
-			dep_progress /= float(dep_count);
-			dep_progress *= 0.5;
-			dep_progress += load_task.progress * 0.5;
-			return dep_progress;
-		} else {
-			return load_task.progress;
+	_thread_load_function(p_load_task);
+
+	// The task may go away as soon as the jobs let go of it.
+	thread_load_mutex->lock();
+	String local_path = p_load_task->local_path;
+	_release_task(local_path);
+	thread_load_mutex->unlock();
+}
+
+void ResourceLoader::_release_task(const String &p_local_path) {
+
+	//thread_load_mutex must be locked
+
+	ThreadLoadTask *load_task = thread_load_tasks.getptr(p_local_path);
+	if (!load_task) {
+		return;
+	}
+
+	load_task->requests--;
+
+	if (load_task->requests == 0) {
+		// Dependencies requested ahead of time are kept around until the task
+		// itself goes, so progress keeps counting them.
+		Vector<String> dependencies = load_task->dependencies;
+		thread_load_tasks.erase(p_local_path);
+		for (int i = 0; i < dependencies.size(); i++) {
+			_release_task(dependencies[i]);
 		}
+	}
+}
 
-	} else {
-		return 1.0; //assume finished loading it so it no longer exists
+Error ResourceLoader::load_threaded_request(const String &p_path, const String &p_type_hint, bool p_use_sub_threads, const String &p_source_resource) {
+
+	String local_path;
+	if (p_path.is_rel_path())
+		local_path = "res://" + p_path;
+	else
+		local_path = ProjectSettings::get_singleton()->localize_path(p_path);
+
+	thread_load_mutex->lock();
+
+	if (p_source_resource != String()) {
+		//must be loading from this resource
+		if (!thread_load_tasks.has(p_source_resource)) {
+			thread_load_mutex->unlock();
+			ERR_FAIL_V_MSG(ERR_INVALID_PARAMETER, "There is no thread loading source resource '" + p_source_resource + "'.");
+		}
+		//must be loading from this thread
+		if (thread_load_tasks[p_source_resource].loader_id != Thread::get_caller_id()) {
+			thread_load_mutex->unlock();
+			ERR_FAIL_V_MSG(ERR_INVALID_PARAMETER, "Threading loading resource'" + local_path + " failed: Source specified: '" + p_source_resource + "' but was not called by it.");
+		}
+
+		//must not be already added as s sub tasks
+		if (thread_load_tasks[p_source_resource].sub_tasks.has(local_path)) {
+			thread_load_mutex->unlock();
+			ERR_FAIL_V_MSG(ERR_INVALID_PARAMETER, "Thread loading source resource '" + p_source_resource + "' already is loading '" + local_path + "'.");
+		}
+	}
+
+	ThreadLoadTask *load_task = thread_load_tasks.getptr(local_path);
+	if (load_task && load_task->loader_id == Thread::get_caller_id() && load_task->status == THREAD_LOAD_IN_PROGRESS && !load_task->job.is_valid()) {
+		thread_load_mutex->unlock();
+		ERR_FAIL_V_MSG(ERR_INVALID_PARAMETER, "Attempted to load a resource already being loaded from this thread, cyclic reference?");
 	}
+
+	_request_task(local_path, p_type_hint, p_use_sub_threads);
+
+	if (p_source_resource != String()) {
+		thread_load_tasks[p_source_resource].sub_tasks.insert(local_path);
+	}
+
+	thread_load_mutex->unlock();
+
+	return OK;
+}
+
+void ResourceLoader::_dependency_add_progress(const String &p_path, Set<String> &r_visited, float &r_progress, int &r_count) {
+
+	if (r_visited.has(p_path)) {
+		return;
+	}
+	r_visited.insert(p_path);
+	r_count++;
+
+	const ThreadLoadTask *load_task = thread_load_tasks.getptr(p_path);
+	if (!load_task) {
+		r_progress += 1.0; //assume finished loading it so it no longer exists
+		return;
+	}
+
+	r_progress += load_task->progress;
+
+	for (int i = 0; i < load_task->dependencies.size(); i++) {
+		_dependency_add_progress(load_task->dependencies[i], r_visited, r_progress, r_count);
+	}
+	for (Set<String>::Element *E = load_task->sub_tasks.front(); E; E = E->next()) {
+		_dependency_add_progress(E->get(), r_visited, r_progress, r_count);
+	}
+}
+
+float ResourceLoader::_dependency_get_progress(const String &p_path) {
+
+	// Every resource in the dependency graph weighs the same, so progress
+	// advances as each texture or mesh of a large scene finishes.
+	Set<String> visited;
+	float progress = 0;
+	int count = 0;
+	_dependency_add_progress(p_path, visited, progress, count);
+	return progress / float(count);
 }
 
 ResourceLoader::ThreadLoadStatus ResourceLoader::load_threaded_get_status(const String &p_path, float *r_progress) {
@@ -427,7 +551,8 @@ ResourceLoader::ThreadLoadStatus ResourceLoader::load_threaded_get_status(const
 	ThreadLoadStatus status;
 	status = load_task.status;
 	if (r_progress) {
-		*r_progress = _dependency_get_progress(local_path);
+		load_task.reported_progress = MAX(load_task.reported_progress, _dependency_get_progress(local_path));
+		*r_progress = load_task.reported_progress;
 	}
 
 	thread_load_mutex->unlock();
@@ -453,40 +578,17 @@ RES ResourceLoader::load_threaded_get(const String &p_path, Error *r_error) {
 
 	ThreadLoadTask &load_task = thread_load_tasks[local_path];
 
-	//semaphore still exists, meaning its still loading, request poll
-	Semaphore *semaphore = load_task.semaphore;
-	if (semaphore) {
-		load_task.poll_requests++;
-
-		{
-			// As we got a semaphore, this means we are going to have to wait
-			// until the sub-resource is done loading
-			//
-			// As this thread will become 'blocked' we should "echange" its
-			// active status with a waiting one, to ensure load continues.
-			//
-			// This ensures loading is never blocked and that is also within
-			// the maximum number of active threads.
-
-			if (thread_waiting_count > 0) {
-				thread_waiting_count--;
-				thread_loading_count++;
-				thread_load_semaphore->post();
-
-				load_task.start_next = false; //do not start next since we are doing it here
-			}
-
-			thread_suspended_count++;
-
-			print_lt("GET: load count: " + itos(thread_loading_count) + " / wait count: " + itos(thread_waiting_count) + " / suspended count: " + itos(thread_suspended_count) + " / active: " + itos(thread_loading_count - thread_suspended_count));
-		}
+	if (!load_task.job.is_completed()) {
+		// Still loading. Waiting on the job runs other queued jobs on this
+		// thread in the meantime (likely this resource's own dependencies),
+		// so loaders waiting on sub-resources from worker threads never
+		// starve the pool.
+		JobSystem::Handle job = load_task.job;
 
 		thread_load_mutex->unlock();
-		semaphore->wait();
+		JobSystem::get_singleton()->wait(job);
 		thread_load_mutex->lock();
 
-		thread_suspended_count--;
-
 		if (!thread_load_tasks.has(local_path)) { //may have been erased during unlock and this was always an invalid call
 			thread_load_mutex->unlock();
 			if (r_error) {
@@ -501,15 +603,7 @@ RES ResourceLoader::load_threaded_get(const String &p_path, Error *r_error) {
 		*r_error = load_task.error;
 	}
 
-	load_task.requests--;
-
-	if (load_task.requests == 0) {
-		if (load_task.thread) { //thread may not have been used
-			Thread::wait_to_finish(load_task.thread);
-			memdelete(load_task.thread);
-		}
-		thread_load_tasks.erase(local_path);
-	}
+	_release_task(local_path);
 
 	thread_load_mutex->unlock();
 
@@ -585,10 +679,12 @@ RES ResourceLoader::load(const String &p_path, const String &p_type_hint, bool p
 		load_task.loader_id = Thread::get_caller_id();
 
 		thread_load_tasks[local_path] = load_task;
+		//look it up under the lock, jobs may be adding tasks meanwhile
+		ThreadLoadTask *task = thread_load_tasks.getptr(local_path);
 
 		thread_load_mutex->unlock();
 
-		_thread_load_function(&thread_load_tasks[local_path]);
+		_thread_load_function(task);
 
 		return load_threaded_get(p_path, r_error);
 
@@ -1127,17 +1223,11 @@ void ResourceLoader::remove_custom_loaders() {
 
 void ResourceLoader::initialize() {
 	thread_load_mutex = memnew(Mutex);
-	thread_load_max = OS::get_singleton()->get_processor_count();
-	thread_loading_count = 0;
-	thread_waiting_count = 0;
-	thread_suspended_count = 0;
-	thread_load_semaphore = memnew(Semaphore);
 }
 
 void ResourceLoader::finalize() {
 
 	memdelete(thread_load_mutex);
-	memdelete(thread_load_semaphore);
 }
 
 ResourceLoadErrorNotify ResourceLoader::err_notify = nullptr;
@@ -1151,12 +1241,6 @@ bool ResourceLoader::timestamp_on_load = false;
 
 Mutex *ResourceLoader::thread_load_mutex = nullptr;
 HashMap<String, ResourceLoader::ThreadLoadTask> ResourceLoader::thread_load_tasks;
-Semaphore *ResourceLoader::thread_load_semaphore = nullptr;
-
-int ResourceLoader::thread_loading_count = 0;
-int ResourceLoader::thread_waiting_count = 0;
-int ResourceLoader::thread_suspended_count = 0;
-int ResourceLoader::thread_load_max = 0;
 
 SelfList<Resource>::List ResourceLoader::remapped_list;
 HashMap<String, Vector<String>> ResourceLoader::translation_remaps;
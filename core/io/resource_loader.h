@@ -31,7 +31,7 @@
 #ifndef RESOURCE_LOADER_H
 #define RESOURCE_LOADER_H
 
-#include "core/os/semaphore.h"
+#include "core/job_system.h"
 #include "core/os/thread.h"
 #include "core/resource.h"
 
@@ -108,33 +108,36 @@ private:
 	static Ref<ResourceFormatLoader> _find_custom_resource_format_loader(String path);
 
 	struct ThreadLoadTask {
-		Thread *thread = nullptr;
+		JobSystem::Handle job;
 		Thread::ID loader_id = 0;
-		Semaphore *semaphore = nullptr;
 		String local_path;
 		String remapped_path;
 		String type_hint;
 		float progress = 0.0;
+		float reported_progress = 0.0; // Dependencies found later must not make progress go back.
 		ThreadLoadStatus status = THREAD_LOAD_IN_PROGRESS;
 		Error error = OK;
 		RES resource;
 		bool xl_remapped = false;
 		bool use_sub_threads = false;
-		bool start_next = true;
 		int requests = 0;
-		int poll_requests = 0;
-		Set<String> sub_tasks;
+		Set<String> sub_tasks; // Requested by the format loader while loading.
+		Vector<String> dependencies; // Requested ahead of time so they load in parallel, released along with this one.
+
+		void expand(void *p_userdata) { _expand_task(this); }
+		void process(void *p_userdata) { _process_task(this); }
 	};
 
 	static void _thread_load_function(void *p_userdata);
+	static ThreadLoadTask *_request_task(const String &p_local_path, const String &p_type_hint, bool p_use_sub_threads);
+	static bool _task_depends_on(const String &p_local_path, const String &p_dependency, Set<String> &r_visited);
+	static void _expand_task(ThreadLoadTask *p_load_task);
+	static void _process_task(ThreadLoadTask *p_load_task);
+	static void _release_task(const String &p_local_path);
 	static Mutex *thread_load_mutex;
 	static HashMap<String, ThreadLoadTask> thread_load_tasks;
-	static Semaphore *thread_load_semaphore;
-	static int thread_waiting_count;
-	static int thread_loading_count;
-	static int thread_suspended_count;
-	static int thread_load_max;
 
+	static void _dependency_add_progress(const String &p_path, Set<String> &r_visited, float &r_progress, int &r_count);
 	static float _dependency_get_progress(const String &p_path);
 
 public:
@@ -0,0 +1,437 @@
+/*************************************************************************/
+/*  job_system.cpp                                                       */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "job_system.h"
+
+#include "core/os/os.h"
+
+JobSystem *JobSystem::singleton = nullptr;
+
+thread_local JobSystem::Worker *JobSystem::current_worker = nullptr;
+
+bool JobSystem::Deque::push(Job *p_job) {
+
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	if (b - t >= CAPACITY) {
+		return false;
+	}
+	items[b & MASK].store(p_job, std::memory_order_relaxed);
+	bottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+JobSystem::Job *JobSystem::Deque::pop() {
+
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+
+	if (t > b) {
+		// Empty.
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job *job = items[b & MASK].load(std::memory_order_relaxed);
+	if (t == b) {
+		// Last item, race against thieves for it.
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			job = nullptr;
+		}
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+JobSystem::Job *JobSystem::Deque::steal() {
+
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+
+	if (t >= b) {
+		return nullptr;
+	}
+
+	Job *job = items[t & MASK].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+		return nullptr; // Lost the race, caller will try elsewhere.
+	}
+	return job;
+}
+
+void JobSystem::Handle::wait() const {
+
+	if (job) {
+		job->owner->wait(*this);
+	}
+}
+
+JobSystem::Worker *JobSystem::_get_current_worker() const {
+
+	if (current_worker && current_worker->owner == this) {
+		return current_worker;
+	}
+	return nullptr;
+}
+
+void JobSystem::_add_dependency(Job *p_job, Job *p_dependency) {
+
+	if (!p_dependency || p_dependency->completed.load(std::memory_order_acquire)) {
+		return;
+	}
+	ERR_FAIL_COND_MSG(p_dependency->owner != this, "Job dependencies must belong to the same JobSystem.");
+
+	p_dependency->continuation_lock.lock();
+	if (!p_dependency->completed.load(std::memory_order_relaxed)) {
+		p_job->dependencies.fetch_add(1, std::memory_order_relaxed);
+		p_job->refcount.fetch_add(1, std::memory_order_relaxed); // Held by the continuation list.
+		p_dependency->continuations.push_back(p_job);
+	}
+	p_dependency->continuation_lock.unlock();
+}
+
+void JobSystem::_submit(Job *p_job, uint32_t p_instances, const Handle *p_dependencies, int p_dependency_count, bool p_hold) {
+
+	p_job->owner = this;
+	p_job->instances.store(p_instances);
+
+	for (int i = 0; i < p_dependency_count; i++) {
+		_add_dependency(p_job, p_dependencies[i].job);
+	}
+
+	if (p_hold) {
+		return; // Keeps the submission guard until release().
+	}
+
+	// Drop the submission guard, schedule right away unless a dependency is still pending.
+	if (p_job->dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		_schedule(p_job);
+	}
+}
+
+void JobSystem::add_dependency(const Handle &p_held, const Handle &p_dependency) {
+
+	ERR_FAIL_COND(!p_held.job);
+	ERR_FAIL_COND_MSG(p_held.job->owner != this, "Adding a dependency to a job that belongs to a different JobSystem.");
+	_add_dependency(p_held.job, p_dependency.job);
+}
+
+void JobSystem::release(const Handle &p_held) {
+
+	ERR_FAIL_COND(!p_held.job);
+	ERR_FAIL_COND_MSG(p_held.job->owner != this, "Releasing a job that belongs to a different JobSystem.");
+	if (p_held.job->dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		_schedule(p_held.job);
+	}
+}
+
+void JobSystem::_schedule(Job *p_job) {
+
+	uint32_t instances = p_job->instances.load(std::memory_order_relaxed);
+	p_job->refcount.fetch_add(instances, std::memory_order_relaxed); // One per queued instance.
+
+	if (worker_count == 0) {
+		for (uint32_t i = 0; i < instances; i++) {
+			_run(p_job);
+		}
+		return;
+	}
+
+	for (uint32_t i = 0; i < instances; i++) {
+		_push(p_job);
+	}
+
+	// Pairs with the fence in _thread_function(), either we see the worker going to sleep or it sees our jobs.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	uint32_t sleeping = sleeping_workers.load(std::memory_order_relaxed);
+	for (uint32_t i = 0; i < MIN(sleeping, instances); i++) {
+		work_available.post();
+	}
+}
+
+void JobSystem::_push(Job *p_job) {
+
+	Worker *worker = _get_current_worker();
+	if (worker && worker->deque.push(p_job)) {
+		return;
+	}
+
+	// Either submitted from outside the pool, or the local deque is full.
+	MutexLock lock(injection_mutex);
+	injection_queue.push_back(p_job);
+	injection_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+JobSystem::Job *JobSystem::_fetch(Worker *p_worker) {
+
+	Job *job = nullptr;
+
+	if (p_worker) {
+		job = p_worker->deque.pop();
+		if (job) {
+			return job;
+		}
+	}
+
+	if (injection_count.load(std::memory_order_relaxed) > 0) {
+		MutexLock lock(injection_mutex);
+		if (injection_queue.size()) {
+			job = injection_queue.front()->get();
+			injection_queue.pop_front();
+			injection_count.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	uint32_t start = 0;
+	if (p_worker) {
+		// Xorshift, so thieves don't all hammer the same victim.
+		uint32_t seed = p_worker->steal_seed;
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		p_worker->steal_seed = seed;
+		start = seed % worker_count;
+	}
+
+	for (uint32_t i = 0; i < worker_count; i++) {
+		Worker *victim = &workers[(start + i) % worker_count];
+		if (victim == p_worker) {
+			continue;
+		}
+		job = victim->deque.steal();
+		if (job) {
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+void JobSystem::_run(Job *p_job) {
+
+	const uint32_t elements = p_job->elements;
+	const uint32_t batch_size = p_job->batch_size;
+
+	while (true) {
+		uint32_t from = p_job->index.fetch_add(batch_size, std::memory_order_relaxed);
+		if (from >= elements) {
+			break;
+		}
+		uint32_t to = MIN(from + batch_size, elements);
+		for (uint32_t i = from; i < to; i++) {
+			p_job->process(i);
+		}
+	}
+
+	if (p_job->instances.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		_complete(p_job);
+	}
+
+	_unref(p_job);
+}
+
+void JobSystem::_complete(Job *p_job) {
+
+	Vector<Job *> continuations;
+
+	p_job->continuation_lock.lock();
+	p_job->completed.store(true, std::memory_order_release);
+	continuations = p_job->continuations;
+	p_job->continuations.clear();
+	p_job->continuation_lock.unlock();
+
+	for (int i = 0; i < continuations.size(); i++) {
+		Job *continuation = continuations[i];
+		if (continuation->dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			_schedule(continuation);
+		}
+		_unref(continuation);
+	}
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (waiting_threads.load(std::memory_order_relaxed) > 0) {
+		std::lock_guard<std::mutex> lock(completion_mutex);
+		completion_cond.notify_all();
+	}
+}
+
+void JobSystem::wait(const Handle &p_handle) {
+
+	Job *job = p_handle.job;
+	if (!job) {
+		return;
+	}
+	ERR_FAIL_COND_MSG(job->owner != this, "Waiting on a job that belongs to a different JobSystem.");
+
+	Worker *worker = _get_current_worker();
+
+	while (!job->completed.load(std::memory_order_acquire)) {
+
+		Job *other = _fetch(worker);
+		if (other) {
+			_run(other);
+			continue;
+		}
+
+		// Nothing to help with, the remaining work is running elsewhere. Sleep until something completes,
+		// but not for long, as new jobs we could help with may be queued meanwhile.
+		waiting_threads.fetch_add(1, std::memory_order_seq_cst);
+		{
+			std::unique_lock<std::mutex> lock(completion_mutex);
+			if (!job->completed.load(std::memory_order_acquire)) {
+				completion_cond.wait_for(lock, std::chrono::microseconds(100));
+			}
+		}
+		waiting_threads.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+
+void JobSystem::_thread_function(Worker *p_worker) {
+
+	current_worker = p_worker;
+	JobSystem *js = p_worker->owner;
+
+	while (true) {
+
+		Job *job = js->_fetch(p_worker);
+		if (job) {
+			js->_run(job);
+			continue;
+		}
+
+		js->sleeping_workers.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		// Check again now that submitters can see us sleeping.
+		job = js->_fetch(p_worker);
+		if (job) {
+			js->sleeping_workers.fetch_sub(1, std::memory_order_relaxed);
+			js->_run(job);
+			continue;
+		}
+
+		if (js->exit.load()) {
+			js->sleeping_workers.fetch_sub(1, std::memory_order_relaxed);
+			break;
+		}
+
+		js->work_available.wait();
+		js->sleeping_workers.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	current_worker = nullptr;
+}
+
+void JobSystem::init(int p_thread_count) {
+
+	ERR_FAIL_COND(workers != nullptr);
+
+#ifdef NO_THREADS
+	p_thread_count = 0;
+#else
+	if (p_thread_count < 0) {
+		// Leave a core for the thread that submits and waits, it takes part in the work anyway.
+		p_thread_count = MAX(1, OS::get_singleton()->get_processor_count() - 1);
+	}
+#endif
+
+	worker_count = p_thread_count;
+	exit.store(false);
+
+	if (worker_count == 0) {
+		return;
+	}
+
+	workers = memnew_arr(Worker, worker_count);
+
+	for (uint32_t i = 0; i < worker_count; i++) {
+		workers[i].owner = this;
+		workers[i].index = i;
+		workers[i].steal_seed = i * 2654435761u + 1;
+	}
+	// Start threads only after every deque is set up, they steal from each other right away.
+	for (uint32_t i = 0; i < worker_count; i++) {
+		workers[i].thread = memnew(std::thread(JobSystem::_thread_function, &workers[i]));
+	}
+}
+
+void JobSystem::finish() {
+
+	if (workers == nullptr) {
+		worker_count = 0;
+		return;
+	}
+
+	exit.store(true);
+	for (uint32_t i = 0; i < worker_count; i++) {
+		work_available.post();
+	}
+	for (uint32_t i = 0; i < worker_count; i++) {
+		workers[i].thread->join();
+		memdelete(workers[i].thread);
+	}
+
+	// Workers exit only when they run out of jobs, anything left came from the injection queue after that.
+	worker_count = 0;
+	while (injection_queue.size()) {
+		Job *job = injection_queue.front()->get();
+		injection_queue.pop_front();
+		_run(job);
+	}
+	injection_count.store(0);
+
+	memdelete_arr(workers);
+	workers = nullptr;
+}
+
+JobSystem::JobSystem() {
+
+	injection_count.store(0);
+	sleeping_workers.store(0);
+	waiting_threads.store(0);
+	exit.store(false);
+
+	if (!singleton) {
+		singleton = this;
+	}
+}
+
+JobSystem::~JobSystem() {
+
+	finish();
+
+	if (singleton == this) {
+		singleton = nullptr;
+	}
+}
@@ -0,0 +1,295 @@
+/*************************************************************************/
+/*  job_system.h                                                         */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include "core/list.h"
+#include "core/os/memory.h"
+#include "core/os/mutex.h"
+#include "core/os/semaphore.h"
+#include "core/spin_lock.h"
+#include "core/vector.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Engine-wide work-stealing scheduler.
+//
+// Every worker owns a bounded Chase-Lev deque: it pushes and pops its own jobs
+// from the bottom (LIFO, cache friendly) while idle workers steal from the top
+// (FIFO). Jobs submitted from threads outside the pool go to a shared injection
+// queue. Jobs can depend on other jobs, in which case they are only queued once
+// every dependency has completed, and a thread waiting on a handle helps
+// running queued jobs instead of blocking, so nested waits don't deadlock and
+// the pool never needs more threads than cores.
+
+class JobSystem {
+public:
+	struct Job {
+		JobSystem *owner = nullptr;
+		std::atomic<uint32_t> refcount;
+		std::atomic<uint32_t> dependencies; // Unresolved dependencies, plus one while submitting.
+		std::atomic<uint32_t> instances; // Queued/running copies of this job that didn't finish yet.
+		std::atomic<uint32_t> index; // Next element to process.
+		std::atomic<bool> completed;
+		uint32_t elements = 1;
+		uint32_t batch_size = 1;
+
+		SpinLock continuation_lock;
+		Vector<Job *> continuations; // Jobs depending on this one, protected by continuation_lock.
+
+		virtual void process(uint32_t p_index) = 0;
+
+		Job() {
+			refcount.store(1);
+			dependencies.store(1);
+			instances.store(0);
+			index.store(0);
+			completed.store(false);
+		}
+		virtual ~Job() {}
+	};
+
+	class Handle {
+		friend class JobSystem;
+		Job *job = nullptr;
+
+		_FORCE_INLINE_ explicit Handle(Job *p_job) {
+			job = p_job;
+			job->refcount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+	public:
+		_FORCE_INLINE_ bool is_valid() const { return job != nullptr; }
+		// Non-blocking, an invalid handle counts as completed.
+		_FORCE_INLINE_ bool is_completed() const { return !job || job->completed.load(std::memory_order_acquire); }
+		void wait() const;
+
+		_FORCE_INLINE_ void operator=(const Handle &p_handle) {
+			if (job == p_handle.job) {
+				return;
+			}
+			JobSystem::_unref(job);
+			job = p_handle.job;
+			if (job) {
+				job->refcount.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		_FORCE_INLINE_ Handle(const Handle &p_handle) {
+			job = p_handle.job;
+			if (job) {
+				job->refcount.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		_FORCE_INLINE_ Handle() {}
+		_FORCE_INLINE_ ~Handle() { JobSystem::_unref(job); }
+	};
+
+private:
+	template <class C, class M, class U>
+	struct TaskJob : public Job {
+		C *instance;
+		M method;
+		U userdata;
+		virtual void process(uint32_t p_index) {
+			(instance->*method)(userdata);
+		}
+	};
+
+	template <class C, class M, class U>
+	struct GroupJob : public Job {
+		C *instance;
+		M method;
+		U userdata;
+		virtual void process(uint32_t p_index) {
+			(instance->*method)(p_index, userdata);
+		}
+	};
+
+	// Bounded Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing
+	// for Weak Memory Models"). push() and pop() may only be called by the owner.
+	class Deque {
+		enum {
+			CAPACITY = 1024,
+			MASK = CAPACITY - 1
+		};
+
+		std::atomic<int64_t> top;
+		std::atomic<int64_t> bottom;
+		std::atomic<Job *> items[CAPACITY];
+
+	public:
+		bool push(Job *p_job);
+		Job *pop();
+		Job *steal();
+
+		Deque() {
+			top.store(0);
+			bottom.store(0);
+		}
+	};
+
+	struct Worker {
+		JobSystem *owner = nullptr;
+		uint32_t index = 0;
+		uint32_t steal_seed = 0;
+		std::thread *thread = nullptr;
+		Deque deque;
+	};
+
+	static JobSystem *singleton;
+	static thread_local Worker *current_worker;
+
+	Worker *workers = nullptr;
+	uint32_t worker_count = 0;
+	std::atomic<bool> exit;
+
+	Mutex injection_mutex;
+	List<Job *> injection_queue;
+	std::atomic<uint32_t> injection_count;
+
+	Semaphore work_available;
+	std::atomic<uint32_t> sleeping_workers;
+
+	std::mutex completion_mutex;
+	std::condition_variable completion_cond;
+	std::atomic<uint32_t> waiting_threads;
+
+	static void _thread_function(Worker *p_worker);
+
+	static _FORCE_INLINE_ void _unref(Job *p_job) {
+		if (p_job && p_job->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			memdelete(p_job);
+		}
+	}
+
+	Worker *_get_current_worker() const;
+	void _add_dependency(Job *p_job, Job *p_dependency);
+	void _submit(Job *p_job, uint32_t p_instances, const Handle *p_dependencies, int p_dependency_count, bool p_hold = false);
+	void _schedule(Job *p_job);
+	void _push(Job *p_job);
+	Job *_fetch(Worker *p_worker);
+	void _run(Job *p_job);
+	void _complete(Job *p_job);
+
+	template <class C, class M, class U>
+	Handle _add_group_task(C *p_instance, M p_method, U p_userdata, uint32_t p_elements, uint32_t p_batch_size, const Handle *p_dependencies, int p_dependency_count) {
+		GroupJob<C, M, U> *job = memnew((GroupJob<C, M, U>));
+		job->instance = p_instance;
+		job->method = p_method;
+		job->userdata = p_userdata;
+		job->elements = p_elements;
+		if (p_batch_size == 0) {
+			// Enough batches for every thread to get a few, so stealing can balance uneven elements.
+			p_batch_size = MAX(1u, p_elements / ((worker_count + 1) * 4));
+		}
+		job->batch_size = p_batch_size;
+		uint32_t batches = (p_elements + p_batch_size - 1) / p_batch_size;
+		_submit(job, MAX(1u, MIN(batches, worker_count + 1)), p_dependencies, p_dependency_count);
+		Handle handle(job);
+		_unref(job);
+		return handle;
+	}
+
+	template <class C, class M, class U>
+	Handle _add_task(C *p_instance, M p_method, U p_userdata, const Handle *p_dependencies, int p_dependency_count, bool p_hold = false) {
+		TaskJob<C, M, U> *job = memnew((TaskJob<C, M, U>));
+		job->instance = p_instance;
+		job->method = p_method;
+		job->userdata = p_userdata;
+		_submit(job, 1, p_dependencies, p_dependency_count, p_hold);
+		Handle handle(job);
+		_unref(job);
+		return handle;
+	}
+
+public:
+	static JobSystem *get_singleton() { return singleton; }
+
+	// Runs (p_instance->*p_method)(p_userdata) once, after p_dependency (if valid) completes.
+	template <class C, class M, class U>
+	Handle add_task(C *p_instance, M p_method, U p_userdata, const Handle &p_dependency = Handle()) {
+		return _add_task(p_instance, p_method, p_userdata, &p_dependency, p_dependency.is_valid() ? 1 : 0);
+	}
+
+	template <class C, class M, class U>
+	Handle add_task(C *p_instance, M p_method, U p_userdata, const Vector<Handle> &p_dependencies) {
+		return _add_task(p_instance, p_method, p_userdata, p_dependencies.ptr(), p_dependencies.size());
+	}
+
+	// Like add_task(), but the job is held until release() is called for it.
+	// Until then more dependencies can be added with add_dependency(), for
+	// jobs whose dependencies are only known once other jobs have run.
+	template <class C, class M, class U>
+	Handle add_held_task(C *p_instance, M p_method, U p_userdata) {
+		return _add_task(p_instance, p_method, p_userdata, nullptr, 0, true);
+	}
+
+	void add_dependency(const Handle &p_held, const Handle &p_dependency); // Before release() only.
+	void release(const Handle &p_held);
+
+	// Runs (p_instance->*p_method)(i, p_userdata) for every i in [0, p_elements), spread over all threads.
+	// Elements are grabbed in batches of p_batch_size, zero picks a batch size based on the thread count.
+	template <class C, class M, class U>
+	Handle add_group_task(C *p_instance, M p_method, U p_userdata, uint32_t p_elements, uint32_t p_batch_size = 0, const Handle &p_dependency = Handle()) {
+		return _add_group_task(p_instance, p_method, p_userdata, p_elements, p_batch_size, &p_dependency, p_dependency.is_valid() ? 1 : 0);
+	}
+
+	template <class C, class M, class U>
+	Handle add_group_task(C *p_instance, M p_method, U p_userdata, uint32_t p_elements, uint32_t p_batch_size, const Vector<Handle> &p_dependencies) {
+		return _add_group_task(p_instance, p_method, p_userdata, p_elements, p_batch_size, p_dependencies.ptr(), p_dependencies.size());
+	}
+
+	// Blocking helper with the same semantics as ThreadWorkPool::do_work(), the calling thread takes part in the work.
+	template <class C, class M, class U>
+	void do_work(uint32_t p_elements, C *p_instance, M p_method, U p_userdata, uint32_t p_batch_size = 0) {
+		if (p_elements == 0) {
+			return;
+		}
+		wait(add_group_task(p_instance, p_method, p_userdata, p_elements, p_batch_size));
+	}
+
+	// Blocks until the job completes, running other queued jobs in the meantime.
+	void wait(const Handle &p_handle);
+
+	uint32_t get_thread_count() const { return worker_count; }
+	bool is_worker_thread() const { return _get_current_worker() != nullptr; }
+
+	void init(int p_thread_count = -1);
+	void finish();
+
+	JobSystem();
+	~JobSystem();
+};
+
+#endif // JOB_SYSTEM_H
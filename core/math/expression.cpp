@@ -2134,6 +2134,33 @@ bool Expression::_execute(const Array &p_inputs, Object *p_instance, Expression:
 				argp.write[i] = &arr[i];
 			}
 
+			Variant::Type base_type = base.get_type();
+			if (base_type != Variant::OBJECT) {
+
+				if (base_type != call->validated_base_type) {
+					call->validated_method = Variant::get_validated_builtin_method(base_type, call->method);
+					call->validated_arg_types = Variant::get_method_argument_types(base_type, call->method);
+					Variant::get_method_return_type(base_type, call->method, &call->validated_has_return);
+					call->validated_base_type = base_type;
+				}
+
+				// The validated version skips the checks and conversions, so only use it
+				// when every argument is given and already has the declared type.
+				bool validated = call->validated_method && argp.size() == call->validated_arg_types.size();
+				for (int i = 0; validated && i < argp.size(); i++) {
+					Variant::Type arg_type = call->validated_arg_types[i];
+					validated = arg_type == Variant::NIL || arg_type == argp[i]->get_type();
+				}
+
+				if (validated) {
+					if (!call->validated_has_return) {
+						r_ret = Variant();
+					}
+					call->validated_method(r_ret, base, (const Variant **)argp.ptr());
+					break;
+				}
+			}
+
 			Callable::CallError ce;
 			r_ret = base.call(call->method, (const Variant **)argp.ptr(), argp.size(), ce);
 
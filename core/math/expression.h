@@ -304,8 +304,17 @@ private:
 		StringName method;
 		Vector<ENode *> arguments;
 
+		// Builtin method resolved on the first call, reused while the base type stays the same.
+		mutable Variant::Type validated_base_type;
+		mutable Variant::ValidatedBuiltInMethod validated_method;
+		mutable Vector<Variant::Type> validated_arg_types;
+		mutable bool validated_has_return;
+
 		CallNode() {
 			type = TYPE_CALL;
+			validated_base_type = Variant::VARIANT_MAX;
+			validated_method = nullptr;
+			validated_has_return = false;
 		}
 	};
 
@@ -36,11 +36,161 @@
 
 MessageQueue *MessageQueue::singleton = nullptr;
 
+static std::atomic<uint64_t> last_queue_id(0);
+
+// Producers a thread owns, released when the thread exits so other threads can reuse them.
+struct MessageQueueProducerCache {
+	struct Entry {
+		uint64_t queue_id;
+		MessageQueue::Producer *producer;
+		Entry *next;
+	};
+
+	Entry *entries = nullptr;
+
+	~MessageQueueProducerCache() {
+		while (entries) {
+			Entry *e = entries;
+			entries = e->next;
+			e->producer->orphaned.store(true, std::memory_order_release);
+			MessageQueue::_unref_producer(e->producer);
+			memdelete(e);
+		}
+	}
+};
+
+static thread_local MessageQueueProducerCache producer_cache;
+
 MessageQueue *MessageQueue::get_singleton() {
 
 	return singleton;
 }
 
+MessageQueue::Producer *MessageQueue::_get_producer() {
+
+	for (MessageQueueProducerCache::Entry *e = producer_cache.entries; e; e = e->next) {
+		if (e->queue_id == id) {
+			return e->producer;
+		}
+	}
+
+	// First push from this thread, take over the producer of a thread that exited, or make a new one.
+	Producer *producer = nullptr;
+	for (Producer *p = producers.load(std::memory_order_acquire); p; p = p->next) {
+		bool expected = true;
+		if (p->orphaned.load(std::memory_order_relaxed) && p->orphaned.compare_exchange_strong(expected, false, std::memory_order_acquire)) {
+			p->refcount.fetch_add(1, std::memory_order_relaxed);
+			producer = p;
+			break;
+		}
+	}
+
+	if (!producer) {
+		producer = memnew(Producer);
+		producer->orphaned.store(false);
+		producer->refcount.store(2);
+
+		Producer *head = producers.load(std::memory_order_relaxed);
+		do {
+			producer->next = head;
+		} while (!producers.compare_exchange_weak(head, producer, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	MessageQueueProducerCache::Entry *e = memnew(MessageQueueProducerCache::Entry);
+	e->queue_id = id;
+	e->producer = producer;
+	e->next = producer_cache.entries;
+	producer_cache.entries = e;
+
+	return producer;
+}
+
+void MessageQueue::_unref_producer(Producer *p_producer) {
+
+	if (p_producer->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		memdelete(p_producer);
+	}
+}
+
+MessageQueue::Page *MessageQueue::_alloc_page(uint32_t p_size) {
+
+	Page *page = nullptr;
+
+	if (p_size <= PAGE_SIZE) {
+		free_pages_lock.lock();
+		page = free_pages;
+		if (page) {
+			free_pages = page->next;
+			free_pages_size -= PAGE_SIZE;
+		}
+		free_pages_lock.unlock();
+	}
+
+	if (!page) {
+		// Messages with many arguments get a page of their own.
+		uint32_t capacity = MAX(p_size, (uint32_t)PAGE_SIZE);
+		page = (Page *)memalloc(sizeof(Page) + capacity);
+		page->capacity = capacity;
+	}
+
+	page->next = nullptr;
+	page->used = 0;
+	return page;
+}
+
+void MessageQueue::_free_page(Page *p_page) {
+
+	if (p_page->capacity == PAGE_SIZE) {
+		// Keep up to the configured size around, so a steady load allocates nothing.
+		free_pages_lock.lock();
+		if (free_pages_size + PAGE_SIZE <= free_pages_max_size) {
+			p_page->next = free_pages;
+			free_pages = p_page;
+			free_pages_size += PAGE_SIZE;
+			p_page = nullptr;
+		}
+		free_pages_lock.unlock();
+	}
+
+	if (p_page) {
+		memfree(p_page);
+	}
+}
+
+MessageQueue::Message *MessageQueue::_allocate(Producer *p_producer, uint32_t p_size) {
+
+	Page *page = p_producer->last;
+	if (!page || page->capacity - page->used < p_size) {
+		Page *new_page = _alloc_page(p_size);
+		if (page) {
+			page->next = new_page;
+		} else {
+			p_producer->first = new_page;
+		}
+		p_producer->last = new_page;
+		page = new_page;
+	}
+
+	Message *msg = memnew_placement(page->data() + page->used, Message);
+	page->used += p_size;
+	msg->size = p_size;
+	// Released so that a flush reading a later number also sees this producer.
+	msg->seq = write_seq.fetch_add(1, std::memory_order_release);
+	return msg;
+}
+
+void MessageQueue::_destroy_message(Message *p_message) {
+
+	if ((p_message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
+		Variant *args = (Variant *)(p_message + 1);
+		for (int i = 0; i < p_message->args; i++) {
+			args[i].~Variant();
+		}
+	}
+
+	p_message->~Message();
+}
+
 Error MessageQueue::push_call(ObjectID p_id, const StringName &p_method, const Variant **p_args, int p_argcount, bool p_show_error) {
 
 	return push_callable(Callable(p_id, p_method), p_args, p_argcount, p_show_error);
@@ -63,55 +213,36 @@ Error MessageQueue::push_call(ObjectID p_id, const StringName &p_method, VARIANT
 
 Error MessageQueue::push_set(ObjectID p_id, const StringName &p_prop, const Variant &p_value) {
 
-	_THREAD_SAFE_METHOD_
-
-	uint8_t room_needed = sizeof(Message) + sizeof(Variant);
+	Producer *producer = _get_producer();
+	producer->lock.lock();
 
-	if ((buffer_end + room_needed) >= buffer_size) {
-		String type;
-		if (ObjectDB::get_instance(p_id))
-			type = ObjectDB::get_instance(p_id)->get_class();
-		print_line("Failed set: " + type + ":" + p_prop + " target ID: " + itos(p_id));
-		statistics();
-		ERR_FAIL_V_MSG(ERR_OUT_OF_MEMORY, "Message queue out of memory. Try increasing 'memory/limits/message_queue/max_size_kb' in project settings.");
-	}
-
-	Message *msg = memnew_placement(&buffer[buffer_end], Message);
+	Message *msg = _allocate(producer, sizeof(Message) + sizeof(Variant));
 	msg->args = 1;
 	msg->callable = Callable(p_id, p_prop);
 	msg->type = TYPE_SET;
 
-	buffer_end += sizeof(Message);
-
-	Variant *v = memnew_placement(&buffer[buffer_end], Variant);
-	buffer_end += sizeof(Variant);
+	Variant *v = memnew_placement(msg + 1, Variant);
 	*v = p_value;
 
+	producer->lock.unlock();
+
 	return OK;
 }
 
 Error MessageQueue::push_notification(ObjectID p_id, int p_notification) {
 
-	_THREAD_SAFE_METHOD_
-
 	ERR_FAIL_COND_V(p_notification < 0, ERR_INVALID_PARAMETER);
 
-	uint8_t room_needed = sizeof(Message);
-
-	if ((buffer_end + room_needed) >= buffer_size) {
-		print_line("Failed notification: " + itos(p_notification) + " target ID: " + itos(p_id));
-		statistics();
-		ERR_FAIL_V_MSG(ERR_OUT_OF_MEMORY, "Message queue out of memory. Try increasing 'memory/limits/message_queue/max_size_kb' in project settings.");
-	}
-
-	Message *msg = memnew_placement(&buffer[buffer_end], Message);
+	Producer *producer = _get_producer();
+	producer->lock.lock();
 
+	Message *msg = _allocate(producer, sizeof(Message));
 	msg->type = TYPE_NOTIFICATION;
 	msg->callable = Callable(p_id, CoreStringNames::get_singleton()->notification); //name is meaningless but callable needs it
 	//msg->target;
 	msg->notification = p_notification;
 
-	buffer_end += sizeof(Message);
+	producer->lock.unlock();
 
 	return OK;
 }
@@ -132,32 +263,25 @@ Error MessageQueue::push_set(Object *p_object, const StringName &p_prop, const V
 
 Error MessageQueue::push_callable(const Callable &p_callable, const Variant **p_args, int p_argcount, bool p_show_error) {
 
-	_THREAD_SAFE_METHOD_
-
-	int room_needed = sizeof(Message) + sizeof(Variant) * p_argcount;
-
-	if ((buffer_end + room_needed) >= buffer_size) {
-		print_line("Failed method: " + p_callable);
-		statistics();
-		ERR_FAIL_V_MSG(ERR_OUT_OF_MEMORY, "Message queue out of memory. Try increasing 'memory/limits/message_queue/max_size_kb' in project settings.");
-	}
+	Producer *producer = _get_producer();
+	producer->lock.lock();
 
-	Message *msg = memnew_placement(&buffer[buffer_end], Message);
+	Message *msg = _allocate(producer, sizeof(Message) + sizeof(Variant) * p_argcount);
 	msg->args = p_argcount;
 	msg->callable = p_callable;
 	msg->type = TYPE_CALL;
 	if (p_show_error)
 		msg->type |= FLAG_SHOW_ERROR;
 
-	buffer_end += sizeof(Message);
-
+	Variant *args = (Variant *)(msg + 1);
 	for (int i = 0; i < p_argcount; i++) {
 
-		Variant *v = memnew_placement(&buffer[buffer_end], Variant);
-		buffer_end += sizeof(Variant);
+		Variant *v = memnew_placement(&args[i], Variant);
 		*v = *p_args[i];
 	}
 
+	producer->lock.unlock();
+
 	return OK;
 }
 
@@ -167,57 +291,66 @@ void MessageQueue::statistics() {
 	Map<int, int> notify_count;
 	Map<Callable, int> call_count;
 	int null_count = 0;
+	uint32_t total_bytes = 0;
 
-	uint32_t read_pos = 0;
-	while (read_pos < buffer_end) {
-		Message *message = (Message *)&buffer[read_pos];
+	for (Producer *producer = producers.load(std::memory_order_acquire); producer; producer = producer->next) {
 
-		Object *target = message->callable.get_object();
+		producer->lock.lock();
 
-		if (target != nullptr) {
+		for (Page *page = producer->first; page; page = page->next) {
 
-			switch (message->type & FLAG_MASK) {
+			total_bytes += page->used;
 
-				case TYPE_CALL: {
+			uint32_t read_pos = 0;
+			while (read_pos < page->used) {
+				Message *message = (Message *)&page->data()[read_pos];
 
-					if (!call_count.has(message->callable))
-						call_count[message->callable] = 0;
+				Object *target = message->callable.get_object();
 
-					call_count[message->callable]++;
+				if (target != nullptr) {
 
-				} break;
-				case TYPE_NOTIFICATION: {
+					switch (message->type & FLAG_MASK) {
 
-					if (!notify_count.has(message->notification))
-						notify_count[message->notification] = 0;
+						case TYPE_CALL: {
 
-					notify_count[message->notification]++;
+							if (!call_count.has(message->callable))
+								call_count[message->callable] = 0;
 
-				} break;
-				case TYPE_SET: {
+							call_count[message->callable]++;
 
-					StringName t = message->callable.get_method();
-					if (!set_count.has(t))
-						set_count[t] = 0;
+						} break;
+						case TYPE_NOTIFICATION: {
 
-					set_count[t]++;
+							if (!notify_count.has(message->notification))
+								notify_count[message->notification] = 0;
 
-				} break;
-			}
+							notify_count[message->notification]++;
 
-		} else {
-			//object was deleted
-			print_line("Object was deleted while awaiting a callback");
+						} break;
+						case TYPE_SET: {
+
+							StringName t = message->callable.get_method();
+							if (!set_count.has(t))
+								set_count[t] = 0;
+
+							set_count[t]++;
 
-			null_count++;
+						} break;
+					}
+
+				} else {
+					//object was deleted
+					null_count++;
+				}
+
+				read_pos += message->size;
+			}
 		}
 
-		read_pos += sizeof(Message);
-		if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION)
-			read_pos += sizeof(Variant) * message->args;
+		producer->lock.unlock();
 	}
 
-	print_line("TOTAL BYTES: " + itos(buffer_end));
+	print_line("TOTAL BYTES: " + itos(total_bytes));
 	print_line("NULL count: " + itos(null_count));
 
 	for (Map<StringName, int>::Element *E = set_count.front(); E; E = E->next()) {
@@ -257,124 +390,193 @@ void MessageQueue::_call_function(const Callable &p_callable, const Variant *p_a
 	}
 }
 
-void MessageQueue::flush() {
+uint32_t MessageQueue::_take_pending_pages() {
+
+	uint32_t used = 0;
+
+	// Messages get their number while the lock of their producer is held, so
+	// the ones numbered below the limit are all in the pages taken after it.
+	flush_seq_limit = write_seq.load(std::memory_order_acquire);
 
-	if (buffer_end > buffer_max_used) {
-		buffer_max_used = buffer_end;
+	for (Producer *producer = producers.load(std::memory_order_acquire); producer; producer = producer->next) {
+
+		producer->lock.lock();
+		Page *pages = producer->first;
+		producer->first = nullptr;
+		producer->last = nullptr;
+		producer->lock.unlock();
+
+		// Pages left from the previous batch come first.
+		if (producer->flush_page) {
+			Page *last = producer->flush_page;
+			while (last->next) {
+				last = last->next;
+			}
+			last->next = pages;
+		} else {
+			producer->flush_page = pages;
+			producer->flush_pos = 0;
+		}
+
+		uint32_t read_pos = producer->flush_pos;
+		for (Page *page = producer->flush_page; page; page = page->next) {
+			used += page->used - read_pos;
+			read_pos = 0;
+		}
 	}
 
-	uint32_t read_pos = 0;
+	return used;
+}
+
+MessageQueue::Message *MessageQueue::_next_message(Producer *&r_producer) {
+
+	// Merge the pages taken from each producer back into push order.
+	Message *next = nullptr;
 
-	//using reverse locking strategy
-	_THREAD_SAFE_LOCK_
+	for (Producer *producer = producers.load(std::memory_order_acquire); producer; producer = producer->next) {
 
-	if (flushing) {
-		_THREAD_SAFE_UNLOCK_
-		ERR_FAIL_COND(flushing); //already flushing, you did something odd
+		if (!producer->flush_page)
+			continue;
+
+		Message *message = (Message *)&producer->flush_page->data()[producer->flush_pos];
+		if (message->seq >= flush_seq_limit) {
+			continue; // Pushed after the batch was taken.
+		}
+		if (!next || message->seq < next->seq) {
+			next = message;
+			r_producer = producer;
+		}
 	}
-	flushing = true;
 
-	while (read_pos < buffer_end) {
+	return next;
+}
 
-		//lock on each iteration, so a call can re-add itself to the message queue
+void MessageQueue::flush() {
 
-		Message *message = (Message *)&buffer[read_pos];
+	bool expected = false;
+	ERR_FAIL_COND(!flushing.compare_exchange_strong(expected, true)); //already flushing, you did something odd
 
-		uint32_t advance = sizeof(Message);
-		if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION)
-			advance += sizeof(Variant) * message->args;
+	// Messages pushed while flushing are taken by the next batch, until none are left.
+	uint32_t used;
+	while ((used = _take_pending_pages()) > 0) {
 
-		//pre-advance so this function is reentrant
-		read_pos += advance;
+		if (used > buffer_max_used) {
+			buffer_max_used = used;
+		}
 
-		_THREAD_SAFE_UNLOCK_
+		Producer *producer = nullptr;
+		Message *message;
+		while ((message = _next_message(producer))) {
 
-		Object *target = message->callable.get_object();
+			Object *target = message->callable.get_object();
 
-		if (target != nullptr) {
+			if (target != nullptr) {
 
-			switch (message->type & FLAG_MASK) {
-				case TYPE_CALL: {
+				switch (message->type & FLAG_MASK) {
+					case TYPE_CALL: {
 
-					Variant *args = (Variant *)(message + 1);
+						Variant *args = (Variant *)(message + 1);
 
-					// messages don't expect a return value
+						// messages don't expect a return value
 
-					_call_function(message->callable, args, message->args, message->type & FLAG_SHOW_ERROR);
+						_call_function(message->callable, args, message->args, message->type & FLAG_SHOW_ERROR);
 
-				} break;
-				case TYPE_NOTIFICATION: {
+					} break;
+					case TYPE_NOTIFICATION: {
 
-					// messages don't expect a return value
-					target->notification(message->notification);
+						// messages don't expect a return value
+						target->notification(message->notification);
 
-				} break;
-				case TYPE_SET: {
+					} break;
+					case TYPE_SET: {
 
-					Variant *arg = (Variant *)(message + 1);
-					// messages don't expect a return value
-					target->set(message->callable.get_method(), *arg);
+						Variant *arg = (Variant *)(message + 1);
+						// messages don't expect a return value
+						target->set(message->callable.get_method(), *arg);
 
-				} break;
+					} break;
+				}
 			}
-		}
 
-		if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
-			Variant *args = (Variant *)(message + 1);
-			for (int i = 0; i < message->args; i++) {
-				args[i].~Variant();
+			producer->flush_pos += message->size;
+			_destroy_message(message);
+
+			Page *page = producer->flush_page;
+			if (producer->flush_pos == page->used) {
+				producer->flush_page = page->next;
+				producer->flush_pos = 0;
+				_free_page(page);
 			}
 		}
-
-		message->~Message();
-
-		_THREAD_SAFE_LOCK_
 	}
 
-	buffer_end = 0; // reset buffer
-	flushing = false;
-	_THREAD_SAFE_UNLOCK_
+	flushing.store(false);
 }
 
 bool MessageQueue::is_flushing() const {
 
-	return flushing;
+	return flushing.load();
 }
 
 MessageQueue::MessageQueue() {
 
 	ERR_FAIL_COND_MSG(singleton != nullptr, "A MessageQueue singleton already exists.");
 	singleton = this;
-	flushing = false;
+	flushing.store(false);
+
+	id = ++last_queue_id;
+	producers.store(nullptr);
+	write_seq.store(0);
+	flush_seq_limit = 0;
 
-	buffer_end = 0;
+	free_pages = nullptr;
+	free_pages_size = 0;
 	buffer_max_used = 0;
-	buffer_size = GLOBAL_DEF_RST("memory/limits/message_queue/max_size_kb", DEFAULT_QUEUE_SIZE_KB);
+	free_pages_max_size = GLOBAL_DEF_RST("memory/limits/message_queue/max_size_kb", DEFAULT_QUEUE_SIZE_KB);
 	ProjectSettings::get_singleton()->set_custom_property_info("memory/limits/message_queue/max_size_kb", PropertyInfo(Variant::INT, "memory/limits/message_queue/max_size_kb", PROPERTY_HINT_RANGE, "1024,4096,1,or_greater"));
-	buffer_size *= 1024;
-	buffer = memnew_arr(uint8_t, buffer_size);
+	free_pages_max_size *= 1024;
 }
 
 MessageQueue::~MessageQueue() {
 
-	uint32_t read_pos = 0;
+	Producer *producer = producers.load();
+
+	while (producer) {
 
-	while (read_pos < buffer_end) {
+		Producer *next = producer->next;
 
-		Message *message = (Message *)&buffer[read_pos];
-		Variant *args = (Variant *)(message + 1);
-		int argc = message->args;
-		if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
-			for (int i = 0; i < argc; i++)
-				args[i].~Variant();
+		Page *lists[2] = { producer->flush_page, producer->first };
+		for (int i = 0; i < 2; i++) {
+
+			uint32_t read_pos = i == 0 ? producer->flush_pos : 0;
+			Page *page = lists[i];
+			while (page) {
+
+				while (read_pos < page->used) {
+					Message *message = (Message *)&page->data()[read_pos];
+					read_pos += message->size;
+					_destroy_message(message);
+				}
+
+				Page *page_next = page->next;
+				memfree(page);
+				page = page_next;
+				read_pos = 0;
+			}
 		}
-		message->~Message();
 
-		read_pos += sizeof(Message);
-		if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION)
-			read_pos += sizeof(Variant) * message->args;
+		producer->first = nullptr;
+		producer->last = nullptr;
+		producer->flush_page = nullptr;
+		_unref_producer(producer);
+		producer = next;
+	}
+
+	while (free_pages) {
+		Page *page = free_pages;
+		free_pages = page->next;
+		memfree(page);
 	}
 
 	singleton = nullptr;
-	memdelete_arr(buffer);
 }
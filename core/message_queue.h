@@ -32,15 +32,16 @@
 #define MESSAGE_QUEUE_H
 
 #include "core/object.h"
-#include "core/os/thread_safe.h"
+#include "core/spin_lock.h"
 
-class MessageQueue {
+#include <atomic>
 
-	_THREAD_SAFE_CLASS_
+class MessageQueue {
 
 	enum {
 
-		DEFAULT_QUEUE_SIZE_KB = 1024
+		DEFAULT_QUEUE_SIZE_KB = 1024,
+		PAGE_SIZE = 64 * 1024
 	};
 
 	enum {
@@ -60,18 +61,62 @@ class MessageQueue {
 			int16_t notification;
 			int16_t args;
 		};
+		uint32_t size; // Including the arguments.
+		uint64_t seq;
+	};
+
+	struct Page {
+		Page *next;
+		uint32_t capacity;
+		uint32_t used;
+		_FORCE_INLINE_ uint8_t *data() { return (uint8_t *)(this + 1); }
+	};
+
+	// Each thread pushing messages gets its own list of pages, so pushes from
+	// different threads never contend. Flushing takes the pending pages of every
+	// producer and replays them in sequence order, up to the sequence number
+	// read before taking them. Every message below it is in the taken pages, so
+	// the order is kept within each thread and across threads. Newer messages
+	// that were taken along wait for the next batch of the same flush.
+	struct Producer {
+		SpinLock lock; // Held while pushing, and by flush() to take the pages.
+		Page *first = nullptr;
+		Page *last = nullptr;
+		Page *flush_page = nullptr; // Flushing thread only, pages taken and not replayed yet.
+		uint32_t flush_pos = 0;
+		std::atomic<bool> orphaned; // Owner thread exited, can be claimed by another one.
+		std::atomic<uint32_t> refcount; // The queue, plus the owner thread.
+		Producer *next = nullptr;
 	};
 
-	uint8_t *buffer;
-	uint32_t buffer_end;
+	uint64_t id;
+	std::atomic<Producer *> producers;
+	std::atomic<uint64_t> write_seq;
+	uint64_t flush_seq_limit; // Flushing thread only, end of the current batch.
+
+	SpinLock free_pages_lock;
+	Page *free_pages;
+	uint32_t free_pages_size;
+	uint32_t free_pages_max_size;
+
 	uint32_t buffer_max_used;
-	uint32_t buffer_size;
+
+	friend struct MessageQueueProducerCache;
+
+	Producer *_get_producer();
+	static void _unref_producer(Producer *p_producer);
+	Message *_allocate(Producer *p_producer, uint32_t p_size);
+	Page *_alloc_page(uint32_t p_size);
+	void _free_page(Page *p_page);
+	void _destroy_message(Message *p_message);
+	uint32_t _take_pending_pages();
+	Message *_next_message(Producer *&r_producer);
 
 	void _call_function(const Callable &p_callable, const Variant *p_args, int p_argcount, bool p_show_error);
 
 	static MessageQueue *singleton;
 
-	bool flushing;
+	std::atomic<bool> flushing;
 
 public:
 	static MessageQueue *get_singleton();
@@ -1097,12 +1097,6 @@ bool Object::_has_user_signal(const StringName &p_name) const {
 	return signal_map[p_name].user.name.length() > 0;
 }
 
-struct _ObjectSignalDisconnectData {
-
-	StringName signal;
-	Callable callable;
-};
-
 Variant Object::_emit_signal(const Variant **p_args, int p_argcount, Callable::CallError &r_error) {
 
 	r_error.error = Callable::CallError::CALL_ERROR_TOO_FEW_ARGUMENTS;
@@ -1147,24 +1141,38 @@ Error Object::emit_signal(const StringName &p_name, const Variant **p_args, int
 		return ERR_UNAVAILABLE;
 	}
 
-	List<_ObjectSignalDisconnectData> disconnect_data;
-
-	//copy on write will ensure that disconnecting the signal or even deleting the object will not affect the signal calling.
-	//this happens automatically and will not change the performance of calling.
-	//awesome, isn't it?
-	VMap<Callable, SignalData::Slot> slot_map = s->slot_map;
-
-	int ssize = slot_map.size();
+	// Slots connected while emitting are appended past this count and skipped,
+	// see SignalData. The emission state is checked again after every call, as
+	// the callee may have disconnected slots or even freed this object.
+	int ssize = s->slots.size();
+	if (ssize == 0)
+		return OK;
 
 	OBJ_DEBUG_LOCK
 
-	Vector<const Variant *> bind_mem;
+	const Variant **bind_mem = nullptr;
+	if (s->max_binds) {
+		bind_mem = (const Variant **)alloca(sizeof(Variant *) * (p_argcount + s->max_binds));
+		for (int j = 0; j < p_argcount; j++) {
+			bind_mem[j] = p_args[j];
+		}
+	}
+
+	bool freed = false;
+	bool *prev_emit_freed = _emit_freed;
+	_emit_freed = &freed;
+	s->emitting++;
 
 	Error err = OK;
 
 	for (int i = 0; i < ssize; i++) {
 
-		const Connection &c = slot_map.getv(i).conn;
+		// Fetched again on every iteration, connecting may have reallocated the array.
+		const SignalData::Slot &slot = s->slots[i];
+		if (slot.removed)
+			continue;
+
+		const Connection &c = slot.conn;
 
 		Object *target = c.callable.get_object();
 		if (!target) {
@@ -1177,64 +1185,69 @@ Error Object::emit_signal(const StringName &p_name, const Variant **p_args, int
 
 		if (c.binds.size()) {
 			//handle binds
-			bind_mem.resize(p_argcount + c.binds.size());
-
-			for (int j = 0; j < p_argcount; j++) {
-				bind_mem.write[j] = p_args[j];
-			}
 			for (int j = 0; j < c.binds.size(); j++) {
-				bind_mem.write[p_argcount + j] = &c.binds[j];
+				bind_mem[p_argcount + j] = &c.binds[j];
 			}
 
-			args = (const Variant **)bind_mem.ptr();
-			argc = bind_mem.size();
+			args = bind_mem;
+			argc = p_argcount + c.binds.size();
 		}
 
-		if (c.flags & CONNECT_DEFERRED) {
+		uint32_t flags = c.flags;
+
+		if (flags & CONNECT_DEFERRED) {
 			MessageQueue::get_singleton()->push_callable(c.callable, args, argc, true);
 		} else {
 			Callable::CallError ce;
-			_emitting = true;
-			Variant ret;
-			c.callable.call(args, argc, ret, ce);
-			_emitting = false;
+			if (c.callable.is_custom()) {
+				// Custom callables (such as method pointers) dispatch directly.
+				Variant ret;
+				c.callable.call(args, argc, ret, ce);
+			} else {
+				// The target was already looked up, skip the second lookup in Callable::call().
+				target->call(c.callable.get_method(), args, argc, ce);
+			}
+
+			if (freed) {
+				// Freed from the callback, the error was already reported by the destructor.
+				if (prev_emit_freed) {
+					*prev_emit_freed = true;
+				}
+				return err;
+			}
 
 			if (ce.error != Callable::CallError::CALL_OK) {
 #ifdef DEBUG_ENABLED
-				if (c.flags & CONNECT_PERSIST && Engine::get_singleton()->is_editor_hint() && (script.is_null() || !Ref<Script>(script)->is_tool()))
+				if (flags & CONNECT_PERSIST && Engine::get_singleton()->is_editor_hint() && (script.is_null() || !Ref<Script>(script)->is_tool()))
 					continue;
 #endif
 				if (ce.error == Callable::CallError::CALL_ERROR_INVALID_METHOD && !ClassDB::class_exists(target->get_class_name())) {
 					//most likely object is not initialized yet, do not throw error.
 				} else {
-					ERR_PRINT("Error calling from signal '" + String(p_name) + "' to callable: " + Variant::get_callable_error_text(c.callable, args, argc, ce) + ".");
+					ERR_PRINT("Error calling from signal '" + String(p_name) + "' to callable: " + Variant::get_callable_error_text(s->slots[i].conn.callable, args, argc, ce) + ".");
 					err = ERR_METHOD_NOT_FOUND;
 				}
 			}
 		}
 
-		bool disconnect = c.flags & CONNECT_ONESHOT;
+		bool disconnect = flags & CONNECT_ONESHOT;
 #ifdef TOOLS_ENABLED
-		if (disconnect && (c.flags & CONNECT_PERSIST) && Engine::get_singleton()->is_editor_hint()) {
+		if (disconnect && (flags & CONNECT_PERSIST) && Engine::get_singleton()->is_editor_hint()) {
 			//this signal was connected from the editor, and is being edited. just don't disconnect for now
 			disconnect = false;
 		}
 #endif
-		if (disconnect) {
-
-			_ObjectSignalDisconnectData dd;
-			dd.signal = p_name;
-			dd.callable = c.callable;
-			disconnect_data.push_back(dd);
+		if (disconnect && !s->slots[i].removed) {
+			// Only flags the slot while emitting, so it is safe to do right away.
+			Callable callable = s->slots[i].conn.callable;
+			_disconnect(p_name, callable);
 		}
 	}
 
-	while (!disconnect_data.empty()) {
-
-		const _ObjectSignalDisconnectData &dd = disconnect_data.front()->get();
-
-		_disconnect(dd.signal, dd.callable);
-		disconnect_data.pop_front();
+	_emit_freed = prev_emit_freed;
+	s->emitting--;
+	if (s->emitting == 0 && s->removed_count) {
+		_compact_signal(p_name, s);
 	}
 
 	return err;
@@ -1373,9 +1386,10 @@ void Object::get_all_signal_connections(List<Connection> *p_connections) const {
 
 		const SignalData *s = &signal_map[*S];
 
-		for (int i = 0; i < s->slot_map.size(); i++) {
+		for (int i = 0; i < s->slots.size(); i++) {
 
-			p_connections->push_back(s->slot_map.getv(i).conn);
+			if (!s->slots[i].removed)
+				p_connections->push_back(s->slots[i].conn);
 		}
 	}
 }
@@ -1386,8 +1400,10 @@ void Object::get_signal_connection_list(const StringName &p_signal, List<Connect
 	if (!s)
 		return; //nothing
 
-	for (int i = 0; i < s->slot_map.size(); i++)
-		p_connections->push_back(s->slot_map.getv(i).conn);
+	for (int i = 0; i < s->slots.size(); i++) {
+		if (!s->slots[i].removed)
+			p_connections->push_back(s->slots[i].conn);
+	}
 }
 
 int Object::get_persistent_signal_connection_count() const {
@@ -1399,8 +1415,8 @@ int Object::get_persistent_signal_connection_count() const {
 
 		const SignalData *s = &signal_map[*S];
 
-		for (int i = 0; i < s->slot_map.size(); i++) {
-			if (s->slot_map.getv(i).conn.flags & CONNECT_PERSIST) {
+		for (int i = 0; i < s->slots.size(); i++) {
+			if (!s->slots[i].removed && s->slots[i].conn.flags & CONNECT_PERSIST) {
 				count += 1;
 			}
 		}
@@ -1456,7 +1472,7 @@ Error Object::connect(const StringName &p_signal, const Callable &p_callable, co
 
 	if (s->slot_map.has(target)) {
 		if (p_flags & CONNECT_REFERENCE_COUNTED) {
-			s->slot_map[target].reference_count++;
+			s->slots.write[s->slot_map[target]].reference_count++;
 			return OK;
 		} else {
 			ERR_FAIL_V_MSG(ERR_INVALID_PARAMETER, "Signal '" + p_signal + "' is already connected to given callable '" + p_callable + "' in that object.");
@@ -1476,7 +1492,9 @@ Error Object::connect(const StringName &p_signal, const Callable &p_callable, co
 		slot.reference_count = 1;
 	}
 
-	s->slot_map[target] = slot;
+	s->slot_map[target] = s->slots.size();
+	s->slots.push_back(slot);
+	s->max_binds = MAX(s->max_binds, p_binds.size());
 
 	return OK;
 }
@@ -1529,7 +1547,8 @@ void Object::_disconnect(const StringName &p_signal, const Callable &p_callable,
 
 	ERR_FAIL_COND_MSG(!s->slot_map.has(p_callable), "Disconnecting nonexistent signal '" + p_signal + "', callable: " + p_callable + ".");
 
-	SignalData::Slot *slot = &s->slot_map[p_callable];
+	int slot_index = s->slot_map[p_callable];
+	SignalData::Slot *slot = &s->slots.write[slot_index];
 
 	if (!p_force) {
 		slot->reference_count--; // by default is zero, if it was not referenced it will go below it
@@ -1541,7 +1560,40 @@ void Object::_disconnect(const StringName &p_signal, const Callable &p_callable,
 	target_object->connections.erase(slot->cE);
 	s->slot_map.erase(p_callable);
 
-	if (s->slot_map.empty() && ClassDB::has_signal(get_class_name(), p_signal)) {
+	if (s->emitting) {
+		// Being walked, compacted once the emission ends.
+		slot->removed = true;
+		s->removed_count++;
+		return;
+	}
+
+	s->slots.remove(slot_index);
+	for (int i = 0; i < s->slot_map.size(); i++) {
+		if (s->slot_map.getv(i) > slot_index) {
+			s->slot_map.getv(i)--;
+		}
+	}
+
+	if (s->slots.empty() && ClassDB::has_signal(get_class_name(), p_signal)) {
+		//not user signal, delete
+		signal_map.erase(p_signal);
+	}
+}
+
+void Object::_compact_signal(const StringName &p_signal, SignalData *p_signal_data) {
+
+	Vector<SignalData::Slot> slots;
+	for (int i = 0; i < p_signal_data->slots.size(); i++) {
+		const SignalData::Slot &slot = p_signal_data->slots[i];
+		if (!slot.removed) {
+			p_signal_data->slot_map[slot.conn.callable] = slots.size();
+			slots.push_back(slot);
+		}
+	}
+	p_signal_data->slots = slots;
+	p_signal_data->removed_count = 0;
+
+	if (slots.empty() && ClassDB::has_signal(get_class_name(), p_signal)) {
 		//not user signal, delete
 		signal_map.erase(p_signal);
 	}
@@ -1928,7 +1980,7 @@ void Object::_construct_object(bool p_reference) {
 	_instance_id = ObjectDB::add_instance(this);
 	_can_translate = true;
 	_is_queued_for_deletion = false;
-	_emitting = false;
+	_emit_freed = nullptr;
 	instance_binding_count = 0;
 	memset(_script_instance_bindings, 0, sizeof(void *) * MAX_SCRIPT_INSTANCE_BINDINGS);
 	script_instance = nullptr;
@@ -1959,8 +2011,9 @@ Object::~Object() {
 
 	const StringName *S = nullptr;
 
-	if (_emitting) {
+	if (_emit_freed) {
 		//@todo this may need to actually reach the debugger prioritarily somehow because it may crash before
+		*_emit_freed = true;
 		ERR_PRINT("Object " + to_string() + " was freed or unreferenced while a signal is being emitted from it. Try connecting to the signal using 'CONNECT_DEFERRED' flag, or use queue_free() to free the object (if this object is a Node) to avoid this error and potential crashes.");
 	}
 
@@ -1969,12 +2022,13 @@ Object::~Object() {
 		SignalData *s = &signal_map[*S];
 
 		//brute force disconnect for performance
-		int slot_count = s->slot_map.size();
-		const VMap<Callable, SignalData::Slot>::Pair *slot_list = s->slot_map.get_array();
+		int slot_count = s->slots.size();
+		const SignalData::Slot *slot_list = s->slots.ptr();
 
 		for (int i = 0; i < slot_count; i++) {
 
-			slot_list[i].value.conn.callable.get_object()->connections.erase(slot_list[i].value.cE);
+			if (!slot_list[i].removed)
+				slot_list[i].conn.callable.get_object()->connections.erase(slot_list[i].cE);
 		}
 
 		signal_map.erase(*S);
@@ -2012,60 +2066,135 @@ void postinitialize_handler(Object *p_object) {
 
 void ObjectDB::debug_objects(DebugFunc p_func) {
 
-	spin_lock.lock();
-	for (uint32_t i = 0; i < slot_count; i++) {
-		uint32_t slot = object_slots[i].next_free;
-		p_func(object_slots[slot].object);
+	uint32_t max = slot_max.load(std::memory_order_acquire);
+	for (uint32_t i = 0; i < max; i++) {
+		ObjectSlot *chunk = slot_chunks[i >> OBJECTDB_CHUNK_BITS].load(std::memory_order_acquire);
+		if (!chunk) {
+			continue; //being allocated
+		}
+		Object *object = chunk[i & OBJECTDB_CHUNK_MASK].object.load(std::memory_order_acquire);
+		if (object) {
+			p_func(object);
+		}
 	}
-	spin_lock.unlock();
 }
 
 void Object::get_argument_options(const StringName &p_function, int p_idx, List<String> *r_options) const {
 }
 
-SpinLock ObjectDB::spin_lock;
-uint32_t ObjectDB::slot_count = 0;
-uint32_t ObjectDB::slot_max = 0;
-ObjectDB::ObjectSlot *ObjectDB::object_slots = nullptr;
-uint64_t ObjectDB::validator_counter = 0;
+std::atomic<ObjectDB::ObjectSlot *> ObjectDB::slot_chunks[OBJECTDB_CHUNK_COUNT] = {};
+std::atomic<uint32_t> ObjectDB::slot_max(0);
+std::atomic<int> ObjectDB::slot_count(0);
+std::atomic<uint64_t> ObjectDB::validator_counter(0);
 
-int ObjectDB::get_object_count() {
+// Free slots are recycled through a small per thread cache, which is
+// refilled from and spilled to a shared list a batch at a time.
+enum {
+	OBJECTDB_THREAD_CACHE_SIZE = 64,
+	OBJECTDB_BATCH_SIZE = 32,
+};
+
+static SpinLock objectdb_free_lock;
+static uint32_t *objectdb_free_slots = nullptr;
+static uint32_t objectdb_free_count = 0;
+static uint32_t objectdb_free_max = 0;
+static bool objectdb_shut_down = false;
 
-	return slot_count;
+static uint32_t _objectdb_take_free_slots(uint32_t *r_slots, uint32_t p_max) {
+
+	objectdb_free_lock.lock();
+	uint32_t count = MIN(p_max, objectdb_free_count);
+	objectdb_free_count -= count;
+	memcpy(r_slots, objectdb_free_slots + objectdb_free_count, sizeof(uint32_t) * count);
+	objectdb_free_lock.unlock();
+
+	return count;
 }
 
-ObjectID ObjectDB::add_instance(Object *p_object) {
+static void _objectdb_give_free_slots(const uint32_t *p_slots, uint32_t p_count) {
 
-	spin_lock.lock();
-	if (unlikely(slot_count == slot_max)) {
+	objectdb_free_lock.lock();
+	if (!objectdb_shut_down) {
+		if (objectdb_free_count + p_count > objectdb_free_max) {
+			objectdb_free_max = MAX(objectdb_free_max * 2, objectdb_free_count + p_count);
+			objectdb_free_slots = (uint32_t *)memrealloc(objectdb_free_slots, sizeof(uint32_t) * objectdb_free_max);
+		}
+		memcpy(objectdb_free_slots + objectdb_free_count, p_slots, sizeof(uint32_t) * p_count);
+		objectdb_free_count += p_count;
+	}
+	objectdb_free_lock.unlock();
+}
 
-		CRASH_COND(slot_count == (1 << OBJECTDB_SLOT_MAX_COUNT_BITS));
+struct ObjectDBThreadCache {
+	uint32_t slots[OBJECTDB_THREAD_CACHE_SIZE];
+	uint32_t count = 0;
 
-		uint32_t new_slot_max = slot_max > 0 ? slot_max * 2 : 1;
-		object_slots = (ObjectSlot *)memrealloc(object_slots, sizeof(ObjectSlot) * new_slot_max);
-		for (uint32_t i = slot_max; i < new_slot_max; i++) {
-			object_slots[i].object = nullptr;
-			object_slots[i].is_reference = false;
-			object_slots[i].next_free = i;
-			object_slots[i].validator = 0;
+	~ObjectDBThreadCache() {
+		if (count) {
+			_objectdb_give_free_slots(slots, count);
+			count = 0;
 		}
-		slot_max = new_slot_max;
 	}
+};
+
+static thread_local ObjectDBThreadCache objectdb_thread_cache;
+
+int ObjectDB::get_object_count() {
 
-	uint32_t slot = object_slots[slot_count].next_free;
-	if (object_slots[slot].object != nullptr) {
-		spin_lock.unlock();
-		ERR_FAIL_COND_V(object_slots[slot].object != nullptr, ObjectID());
+	return slot_count.load(std::memory_order_relaxed);
+}
+
+ObjectID ObjectDB::add_instance(Object *p_object) {
+
+	ObjectDBThreadCache &cache = objectdb_thread_cache;
+
+	if (unlikely(cache.count == 0)) {
+		cache.count = _objectdb_take_free_slots(cache.slots, OBJECTDB_BATCH_SIZE);
 	}
-	object_slots[slot].object = p_object;
-	object_slots[slot].is_reference = p_object->is_reference();
-	validator_counter = (validator_counter + 1) & OBJECTDB_VALIDATOR_MASK;
-	if (unlikely(validator_counter == 0)) {
-		validator_counter = 1;
+
+	if (unlikely(cache.count == 0)) {
+		// Never used slots. Batches don't straddle chunks, so the first one
+		// to reach a chunk allocates it.
+		uint32_t first = slot_max.fetch_add(OBJECTDB_BATCH_SIZE, std::memory_order_acq_rel);
+		CRASH_COND(first + OBJECTDB_BATCH_SIZE > (1 << OBJECTDB_SLOT_MAX_COUNT_BITS));
+
+		std::atomic<ObjectSlot *> &chunk = slot_chunks[first >> OBJECTDB_CHUNK_BITS];
+		if (!chunk.load(std::memory_order_acquire)) {
+			ObjectSlot *new_chunk = memnew_arr(ObjectSlot, OBJECTDB_CHUNK_SIZE);
+			for (uint32_t i = 0; i < OBJECTDB_CHUNK_SIZE; i++) {
+				new_chunk[i].validator.store(0, std::memory_order_relaxed);
+				new_chunk[i].object.store(nullptr, std::memory_order_relaxed);
+				new_chunk[i].is_reference = false;
+			}
+			ObjectSlot *expected = nullptr;
+			if (!chunk.compare_exchange_strong(expected, new_chunk, std::memory_order_acq_rel)) {
+				memdelete_arr(new_chunk);
+			}
+		}
+
+		for (uint32_t i = 0; i < OBJECTDB_BATCH_SIZE; i++) {
+			cache.slots[i] = first + OBJECTDB_BATCH_SIZE - 1 - i;
+		}
+		cache.count = OBJECTDB_BATCH_SIZE;
 	}
-	object_slots[slot].validator = validator_counter;
 
-	uint64_t id = validator_counter;
+	uint32_t slot = cache.slots[--cache.count];
+	ObjectSlot &s = slot_chunks[slot >> OBJECTDB_CHUNK_BITS].load(std::memory_order_acquire)[slot & OBJECTDB_CHUNK_MASK];
+
+	ERR_FAIL_COND_V(s.object.load(std::memory_order_relaxed) != nullptr, ObjectID());
+
+	uint64_t validator;
+	do {
+		validator = (validator_counter.fetch_add(1, std::memory_order_relaxed) + 1) & OBJECTDB_VALIDATOR_MASK;
+	} while (unlikely(validator == 0));
+
+	s.is_reference = p_object->is_reference();
+	s.object.store(p_object, std::memory_order_release);
+	s.validator.store(validator, std::memory_order_release);
+
+	slot_count.fetch_add(1, std::memory_order_relaxed);
+
+	uint64_t id = validator;
 	id <<= OBJECTDB_SLOT_MAX_COUNT_BITS;
 	id |= uint64_t(slot);
 
@@ -2073,10 +2202,6 @@ ObjectID ObjectDB::add_instance(Object *p_object) {
 		id |= OBJECTDB_REFERENCE_BIT;
 	}
 
-	slot_count++;
-
-	spin_lock.unlock();
-
 	return ObjectID(id);
 }
 
@@ -2084,33 +2209,34 @@ void ObjectDB::remove_instance(Object *p_object) {
 	uint64_t t = p_object->get_instance_id();
 	uint32_t slot = t & OBJECTDB_SLOT_MAX_COUNT_MASK; //slot is always valid on valid object
 
-	spin_lock.lock();
+	ObjectSlot *chunk = slot_chunks[slot >> OBJECTDB_CHUNK_BITS].load(std::memory_order_acquire);
+	if (unlikely(!chunk)) {
+		return; //leaked past cleanup()
+	}
+	ObjectSlot &s = chunk[slot & OBJECTDB_CHUNK_MASK];
 
 #ifdef DEBUG_ENABLED
 
-	if (object_slots[slot].object != p_object) {
-		spin_lock.unlock();
-		ERR_FAIL_COND(object_slots[slot].object != p_object);
-	}
+	ERR_FAIL_COND(s.object.load(std::memory_order_relaxed) != p_object);
 	{
 		uint64_t validator = (t >> OBJECTDB_SLOT_MAX_COUNT_BITS) & OBJECTDB_VALIDATOR_MASK;
-		if (object_slots[slot].validator != validator) {
-			spin_lock.unlock();
-			ERR_FAIL_COND(object_slots[slot].validator != validator);
-		}
+		ERR_FAIL_COND(s.validator.load(std::memory_order_relaxed) != validator);
 	}
 
 #endif
-	//decrease slot count
-	slot_count--;
-	//set the free slot properly
-	object_slots[slot_count].next_free = slot;
 	//invalidate, so checks against it fail
-	object_slots[slot].validator = 0;
-	object_slots[slot].is_reference = false;
-	object_slots[slot].object = nullptr;
+	s.validator.store(0, std::memory_order_release);
+	s.object.store(nullptr, std::memory_order_release);
+	s.is_reference = false;
+
+	slot_count.fetch_sub(1, std::memory_order_relaxed);
 
-	spin_lock.unlock();
+	ObjectDBThreadCache &cache = objectdb_thread_cache;
+	if (unlikely(cache.count == OBJECTDB_THREAD_CACHE_SIZE)) {
+		cache.count -= OBJECTDB_BATCH_SIZE;
+		_objectdb_give_free_slots(cache.slots + cache.count, OBJECTDB_BATCH_SIZE);
+	}
+	cache.slots[cache.count++] = slot;
 }
 
 void ObjectDB::setup() {
@@ -2120,14 +2246,18 @@ void ObjectDB::setup() {
 
 void ObjectDB::cleanup() {
 
-	if (slot_count > 0) {
-		spin_lock.lock();
+	if (slot_count.load() > 0) {
 
 		WARN_PRINT("ObjectDB Instances still exist!");
 		if (OS::get_singleton()->is_stdout_verbose()) {
-			for (uint32_t i = 0; i < slot_count; i++) {
-				uint32_t slot = object_slots[i].next_free;
-				Object *obj = object_slots[slot].object;
+			uint32_t max = slot_max.load();
+			for (uint32_t slot = 0; slot < max; slot++) {
+				ObjectSlot *chunk = slot_chunks[slot >> OBJECTDB_CHUNK_BITS].load();
+				if (!chunk || !chunk[slot & OBJECTDB_CHUNK_MASK].object.load()) {
+					continue;
+				}
+				ObjectSlot &s = chunk[slot & OBJECTDB_CHUNK_MASK];
+				Object *obj = s.object.load();
 
 				String node_name;
 				if (obj->is_class("Node"))
@@ -2135,14 +2265,29 @@ void ObjectDB::cleanup() {
 				if (obj->is_class("Resource"))
 					node_name = " - Resource name: " + String(obj->call("get_name")) + " Path: " + String(obj->call("get_path"));
 
-				uint64_t id = uint64_t(slot) | (uint64_t(object_slots[slot].validator) << OBJECTDB_VALIDATOR_BITS) | (object_slots[slot].is_reference ? OBJECTDB_REFERENCE_BIT : 0);
+				uint64_t id = uint64_t(slot) | (s.validator.load() << OBJECTDB_SLOT_MAX_COUNT_BITS) | (s.is_reference ? OBJECTDB_REFERENCE_BIT : 0);
 				print_line("Leaked instance: " + String(obj->get_class()) + ":" + itos(id) + node_name);
 			}
 		}
-		spin_lock.unlock();
 	}
 
-	if (object_slots) {
-		memfree(object_slots);
+	for (uint32_t i = 0; i < OBJECTDB_CHUNK_COUNT; i++) {
+		ObjectSlot *chunk = slot_chunks[i].exchange(nullptr);
+		if (chunk) {
+			memdelete_arr(chunk);
+		}
 	}
+	slot_max.store(0);
+
+	objectdb_free_lock.lock();
+	objectdb_shut_down = true;
+	if (objectdb_free_slots) {
+		memfree(objectdb_free_slots);
+		objectdb_free_slots = nullptr;
+	}
+	objectdb_free_count = 0;
+	objectdb_free_max = 0;
+	objectdb_free_lock.unlock();
+
+	objectdb_thread_cache.count = 0;
 }
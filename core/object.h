@@ -41,6 +41,8 @@
 #include "core/variant.h"
 #include "core/vmap.h"
 
+#include <atomic>
+
 #define VARIANT_ARG_LIST const Variant &p_arg1 = Variant(), const Variant &p_arg2 = Variant(), const Variant &p_arg3 = Variant(), const Variant &p_arg4 = Variant(), const Variant &p_arg5 = Variant()
 #define VARIANT_ARG_PASS p_arg1, p_arg2, p_arg3, p_arg4, p_arg5
 #define VARIANT_ARG_DECLARE const Variant &p_arg1, const Variant &p_arg2, const Variant &p_arg3, const Variant &p_arg4, const Variant &p_arg5
@@ -444,12 +446,29 @@ private:
 			int reference_count;
 			Connection conn;
 			List<Connection>::Element *cE;
-			Slot() { reference_count = 0; }
+			bool removed;
+			Slot() {
+				reference_count = 0;
+				cE = nullptr;
+				removed = false;
+			}
 		};
 
 		MethodInfo user;
-		VMap<Callable, Slot> slot_map;
-		SignalData() {}
+		// Connections in connection order, walked by index when emitting. Slots
+		// disconnected during an emission are only flagged as removed, and the
+		// array is compacted once the outermost emission returns, so indices stay
+		// valid and slots connected meanwhile are appended past the walked range.
+		Vector<Slot> slots;
+		VMap<Callable, int> slot_map; // Index in slots.
+		int emitting;
+		int removed_count;
+		int max_binds;
+		SignalData() {
+			emitting = 0;
+			removed_count = 0;
+			max_binds = 0;
+		}
 	};
 
 	HashMap<StringName, SignalData> signal_map;
@@ -464,7 +483,7 @@ private:
 	bool _predelete();
 	void _postinitialize();
 	bool _can_translate;
-	bool _emitting;
+	bool *_emit_freed; // Set by the destructor when freed while emitting, see emit_signal().
 #ifdef TOOLS_ENABLED
 	bool _edited;
 	uint32_t _edited_version;
@@ -555,6 +574,7 @@ protected:
 	virtual void _validate_property(PropertyInfo &property) const;
 
 	void _disconnect(const StringName &p_signal, const Callable &p_callable, bool p_force = false);
+	void _compact_signal(const StringName &p_signal, SignalData *p_signal_data);
 
 public: //should be protected, but bug in clang++
 	static void initialize_class();
@@ -759,19 +779,25 @@ class ObjectDB {
 #define OBJECTDB_SLOT_MAX_COUNT_BITS 24
 #define OBJECTDB_SLOT_MAX_COUNT_MASK ((uint64_t(1) << OBJECTDB_SLOT_MAX_COUNT_BITS) - 1)
 #define OBJECTDB_REFERENCE_BIT (uint64_t(1) << (OBJECTDB_SLOT_MAX_COUNT_BITS + OBJECTDB_VALIDATOR_BITS))
-
-	struct ObjectSlot { //128 bits per slot
-		uint64_t validator : OBJECTDB_VALIDATOR_BITS;
-		uint64_t next_free : OBJECTDB_SLOT_MAX_COUNT_BITS;
-		uint64_t is_reference : 1;
-		Object *object;
+//slots are allocated in chunks that never move, so lookups need no lock
+#define OBJECTDB_CHUNK_BITS 12
+#define OBJECTDB_CHUNK_SIZE (1 << OBJECTDB_CHUNK_BITS)
+#define OBJECTDB_CHUNK_MASK (OBJECTDB_CHUNK_SIZE - 1)
+#define OBJECTDB_CHUNK_COUNT (1 << (OBJECTDB_SLOT_MAX_COUNT_BITS - OBJECTDB_CHUNK_BITS))
+
+	struct ObjectSlot {
+		// Zero when the slot is free. Set after the object and cleared
+		// before it, so a matching validator read before and after the
+		// object means the object belongs to the ID.
+		std::atomic<uint64_t> validator;
+		std::atomic<Object *> object;
+		bool is_reference;
 	};
 
-	static SpinLock spin_lock;
-	static uint32_t slot_count;
-	static uint32_t slot_max;
-	static ObjectSlot *object_slots;
-	static uint64_t validator_counter;
+	static std::atomic<ObjectSlot *> slot_chunks[OBJECTDB_CHUNK_COUNT];
+	static std::atomic<uint32_t> slot_max; // Slots ever handed out, free ones included.
+	static std::atomic<int> slot_count;
+	static std::atomic<uint64_t> validator_counter;
 
 	friend class Object;
 	friend void unregister_core_types();
@@ -791,20 +817,21 @@ public:
 		uint64_t id = p_instance_id;
 		uint32_t slot = id & OBJECTDB_SLOT_MAX_COUNT_MASK;
 
-		ERR_FAIL_COND_V(slot >= slot_max, nullptr); //this should never happen unless RID is corrupted
-
-		spin_lock.lock();
+		ObjectSlot *chunk = slot_chunks[slot >> OBJECTDB_CHUNK_BITS].load(std::memory_order_acquire);
+		ERR_FAIL_COND_V(!chunk, nullptr); //this should never happen unless RID is corrupted
 
 		uint64_t validator = (id >> OBJECTDB_SLOT_MAX_COUNT_BITS) & OBJECTDB_VALIDATOR_MASK;
+		ObjectSlot &s = chunk[slot & OBJECTDB_CHUNK_MASK];
 
-		if (unlikely(object_slots[slot].validator != validator)) {
-			spin_lock.unlock();
+		if (unlikely(s.validator.load(std::memory_order_acquire) != validator)) {
 			return nullptr;
 		}
 
-		Object *object = object_slots[slot].object;
+		Object *object = s.object.load(std::memory_order_acquire);
 
-		spin_lock.unlock();
+		if (unlikely(s.validator.load(std::memory_order_acquire) != validator)) {
+			return nullptr; //freed, and maybe reused, while reading it
+		}
 
 		return object;
 	}
@@ -407,6 +407,15 @@ int FileAccess::get_buffer(uint8_t *p_dst, int p_length) const {
 	return i;
 }
 
+/* Backends that keep the whole file in addressable memory (memory files, mapped packs)
+ * return a pointer to the next p_length bytes and advance the position past them.
+ * The view stays valid while the file is open. Everything else returns nullptr and
+ * leaves the position untouched, so callers fall back to get_buffer(). */
+const uint8_t *FileAccess::get_buffer_view(int p_length) const {
+
+	return nullptr;
+}
+
 String FileAccess::get_as_utf8_string() const {
 	Vector<uint8_t> sourcef;
 	int len = get_len();
@@ -0,0 +1,153 @@
+/*************************************************************************/
+/*  frame_allocator.cpp                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "frame_allocator.h"
+
+#include <string.h>
+
+FrameAllocator *FrameAllocator::singleton = nullptr;
+
+FrameAllocator::Block *FrameAllocator::_create_block(uint32_t p_size) {
+
+	Block *block = memnew(Block);
+	block->memory = (uint8_t *)Memory::alloc_static(p_size);
+	block->size = p_size;
+	block->offset.store(0, std::memory_order_relaxed);
+	return block;
+}
+
+void *FrameAllocator::_alloc_slow(Arena &p_arena, size_t p_bytes, size_t p_align) {
+
+	ERR_FAIL_COND_V_MSG(p_bytes + p_align > UINT32_MAX, nullptr, "Frame allocation too large.");
+
+	MutexLock lock(p_arena.mutex);
+
+	Block *block = p_arena.current.load(std::memory_order_relaxed);
+	// Another thread may have added a block while we waited for the lock.
+	uint32_t offset = block->offset.load(std::memory_order_relaxed);
+	while (true) {
+		size_t start = _align(block, offset, p_align);
+		if (start + p_bytes > block->size) {
+			break;
+		}
+		if (block->offset.compare_exchange_weak(offset, uint32_t(start + p_bytes), std::memory_order_relaxed)) {
+			return block->memory + start;
+		}
+	}
+
+	// Bytes lost at the end of the old block are counted too, so the merged
+	// block made on reset is large enough for the same pattern of allocations.
+	p_arena.used += block->size;
+
+	Block *new_block = _create_block(MAX(block_size, uint32_t(p_bytes + p_align)));
+	size_t start = _align(new_block, 0, p_align);
+	new_block->offset.store(uint32_t(start + p_bytes), std::memory_order_relaxed);
+	new_block->next = block;
+	p_arena.current.store(new_block, std::memory_order_release);
+	return new_block->memory + start;
+}
+
+void FrameAllocator::_reset_arena(Arena &p_arena) {
+
+	Block *block = p_arena.current.load(std::memory_order_relaxed);
+
+#ifdef DEBUG_ENABLED
+	for (Block *b = block; b; b = b->next) {
+		memset(b->memory, POISON_BYTE, b->offset.load(std::memory_order_relaxed));
+	}
+#endif
+
+	if (!block->next) {
+		block->offset.store(0, std::memory_order_relaxed);
+		return;
+	}
+
+	// The last frame overflowed the first block, replace the chain with a
+	// single block that fits everything so the common case stays one block.
+	uint64_t total = p_arena.used + block->offset.load(std::memory_order_relaxed);
+	while (block) {
+		Block *next = block->next;
+		Memory::free_static(block->memory);
+		memdelete(block);
+		block = next;
+	}
+
+	uint32_t size = block_size;
+	while (size < total && size < (1u << 31)) {
+		size <<= 1;
+	}
+	p_arena.used = 0;
+	p_arena.current.store(_create_block(size), std::memory_order_relaxed);
+}
+
+void FrameAllocator::begin_frame() {
+
+	uint64_t next_frame = frame.load(std::memory_order_relaxed) + 1;
+	_reset_arena(arenas[next_frame & 1]);
+	frame.store(next_frame, std::memory_order_release);
+}
+
+uint64_t FrameAllocator::get_used_bytes() const {
+
+	const Arena &arena = arenas[get_frame() & 1];
+	Block *block = arena.current.load(std::memory_order_acquire);
+	return arena.used + block->offset.load(std::memory_order_relaxed);
+}
+
+FrameAllocator::FrameAllocator(uint32_t p_block_size) {
+
+	block_size = p_block_size;
+	for (int i = 0; i < 2; i++) {
+		arenas[i].current.store(_create_block(block_size), std::memory_order_relaxed);
+	}
+	// Start past zero so FrameVector frame checks never wrap.
+	frame.store(2, std::memory_order_relaxed);
+
+	if (!singleton) {
+		singleton = this;
+	}
+}
+
+FrameAllocator::~FrameAllocator() {
+
+	for (int i = 0; i < 2; i++) {
+		Block *block = arenas[i].current.load(std::memory_order_relaxed);
+		while (block) {
+			Block *next = block->next;
+			Memory::free_static(block->memory);
+			memdelete(block);
+			block = next;
+		}
+	}
+
+	if (singleton == this) {
+		singleton = nullptr;
+	}
+}
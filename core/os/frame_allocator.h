@@ -0,0 +1,235 @@
+/*************************************************************************/
+/*  frame_allocator.h                                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef FRAME_ALLOCATOR_H
+#define FRAME_ALLOCATOR_H
+
+#include "core/error_macros.h"
+#include "core/os/memory.h"
+#include "core/os/mutex.h"
+#include "core/typedefs.h"
+
+#include <atomic>
+#include <new>
+
+// Linear allocator for transient data that only needs to live for the frame
+// it was created in, such as scratch copies and per-frame lists.
+//
+// Allocating is an atomic bump of an offset and memory is never freed
+// individually. There are two arenas: the one of the current frame and the
+// one of the previous frame. begin_frame(), called at the start of every
+// Main::iteration(), rewinds the arena of the frame before the previous one,
+// so an allocation stays valid until the end of the frame after the one it
+// was made in (enough to hand data over to the render thread).
+//
+// With DEBUG_ENABLED, rewound memory is poisoned and FrameVector checks the
+// frame it was allocated in on every access, so use after reset crashes
+// right away instead of reading stale data.
+
+class FrameAllocator {
+	enum {
+		DEFAULT_BLOCK_SIZE = 256 * 1024,
+		POISON_BYTE = 0xDD,
+	};
+
+	struct Block {
+		uint8_t *memory = nullptr;
+		uint32_t size = 0;
+		std::atomic<uint32_t> offset;
+		Block *next = nullptr;
+	};
+
+	struct Arena {
+		std::atomic<Block *> current;
+		Mutex mutex; // Adding blocks.
+		uint64_t used = 0; // Bytes in blocks that filled up, updated under mutex.
+	};
+
+	static FrameAllocator *singleton;
+
+	Arena arenas[2];
+	std::atomic<uint64_t> frame;
+	uint32_t block_size;
+
+	// Offset in p_block of the first address at or past p_offset aligned to p_align.
+	static _FORCE_INLINE_ size_t _align(const Block *p_block, uint32_t p_offset, size_t p_align) {
+		uintptr_t address = uintptr_t(p_block->memory) + p_offset;
+		return ((address + p_align - 1) & ~uintptr_t(p_align - 1)) - uintptr_t(p_block->memory);
+	}
+
+	Block *_create_block(uint32_t p_size);
+	void *_alloc_slow(Arena &p_arena, size_t p_bytes, size_t p_align);
+	void _reset_arena(Arena &p_arena);
+
+public:
+	static FrameAllocator *get_singleton() { return singleton; }
+
+	// Thread-safe. p_align must be a power of two.
+	_FORCE_INLINE_ void *alloc(size_t p_bytes, size_t p_align = 16) {
+		Arena &arena = arenas[frame.load(std::memory_order_acquire) & 1];
+		Block *block = arena.current.load(std::memory_order_acquire);
+		uint32_t offset = block->offset.load(std::memory_order_relaxed);
+		while (true) {
+			size_t start = _align(block, offset, p_align);
+			if (start + p_bytes > block->size) {
+				return _alloc_slow(arena, p_bytes, p_align);
+			}
+			if (block->offset.compare_exchange_weak(offset, uint32_t(start + p_bytes), std::memory_order_relaxed)) {
+				return block->memory + start;
+			}
+		}
+	}
+
+	template <class T>
+	_FORCE_INLINE_ T *alloc_array(uint32_t p_count) {
+		return (T *)alloc(sizeof(T) * p_count, alignof(T) > 16 ? alignof(T) : 16);
+	}
+
+	_FORCE_INLINE_ uint64_t get_frame() const { return frame.load(std::memory_order_acquire); }
+	// Whether memory allocated during p_frame has not been rewound yet.
+	_FORCE_INLINE_ bool is_frame_alive(uint64_t p_frame) const { return get_frame() - p_frame < 2; }
+
+	// Main thread only, no allocation from the frame being rewound may be in use.
+	void begin_frame();
+
+	uint64_t get_used_bytes() const; // Current frame.
+
+	FrameAllocator(uint32_t p_block_size = DEFAULT_BLOCK_SIZE);
+	~FrameAllocator();
+};
+
+// Growable array backed by the frame allocator. Growing leaves the old buffer
+// behind in the arena, so reserve() up front when the size is known. Elements
+// are destructed, but the memory is only reclaimed when the frame is rewound.
+template <class T>
+class FrameVector {
+	T *data = nullptr;
+	uint32_t count = 0;
+	uint32_t capacity = 0;
+#ifdef DEBUG_ENABLED
+	uint64_t frame = 0;
+#endif
+
+	_FORCE_INLINE_ void _check_frame() const {
+#ifdef DEBUG_ENABLED
+		CRASH_COND_MSG(data && !FrameAllocator::get_singleton()->is_frame_alive(frame), "FrameVector used after its frame was reset.");
+#endif
+	}
+
+public:
+	_FORCE_INLINE_ uint32_t size() const { return count; }
+	_FORCE_INLINE_ bool empty() const { return count == 0; }
+
+	_FORCE_INLINE_ T *ptr() {
+		_check_frame();
+		return data;
+	}
+	_FORCE_INLINE_ const T *ptr() const {
+		_check_frame();
+		return data;
+	}
+
+	_FORCE_INLINE_ T &operator[](uint32_t p_index) {
+		CRASH_BAD_INDEX(p_index, count);
+		_check_frame();
+		return data[p_index];
+	}
+	_FORCE_INLINE_ const T &operator[](uint32_t p_index) const {
+		CRASH_BAD_INDEX(p_index, count);
+		_check_frame();
+		return data[p_index];
+	}
+
+	void reserve(uint32_t p_capacity) {
+		if (p_capacity <= capacity) {
+			return;
+		}
+		_check_frame();
+		T *new_data = FrameAllocator::get_singleton()->alloc_array<T>(p_capacity);
+		for (uint32_t i = 0; i < count; i++) {
+			memnew_placement(&new_data[i], T(data[i]));
+			if (!__has_trivial_destructor(T)) {
+				data[i].~T();
+			}
+		}
+		data = new_data;
+		capacity = p_capacity;
+#ifdef DEBUG_ENABLED
+		frame = FrameAllocator::get_singleton()->get_frame();
+#endif
+	}
+
+	void resize(uint32_t p_size) {
+		if (p_size < count) {
+			if (!__has_trivial_destructor(T)) {
+				for (uint32_t i = p_size; i < count; i++) {
+					data[i].~T();
+				}
+			}
+		} else if (p_size > count) {
+			reserve(p_size);
+			for (uint32_t i = count; i < p_size; i++) {
+				memnew_placement(&data[i], T);
+			}
+		}
+		count = p_size;
+	}
+
+	_FORCE_INLINE_ void push_back(const T &p_value) {
+		if (unlikely(count == capacity)) {
+			reserve(capacity ? capacity * 2 : 8);
+		}
+		memnew_placement(&data[count++], T(p_value));
+	}
+
+	void clear() { resize(0); }
+
+	// Copies the contents of any container with size() and ptr(), like Vector.
+	template <class C>
+	void assign(const C &p_from) {
+		clear();
+		uint32_t from_size = p_from.size();
+		reserve(from_size);
+		const T *from = p_from.ptr();
+		for (uint32_t i = 0; i < from_size; i++) {
+			memnew_placement(&data[i], T(from[i]));
+		}
+		count = from_size;
+	}
+
+	FrameVector() {}
+	explicit FrameVector(uint32_t p_reserve) { reserve(p_reserve); }
+	~FrameVector() { clear(); }
+
+	FrameVector(const FrameVector &) = delete;
+	FrameVector &operator=(const FrameVector &) = delete;
+};
+
+#endif // FRAME_ALLOCATOR_H
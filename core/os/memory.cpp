@@ -34,6 +34,12 @@
 #include "core/os/copymem.h"
 #include "core/safe_refcount.h"
 
+#ifdef SMALL_ALLOCATOR_ENABLED
+#include "core/os/small_allocator.h"
+
+#include <string.h>
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -71,6 +77,58 @@ uint64_t Memory::max_usage = 0;
 
 uint64_t Memory::alloc_count = 0;
 
+#ifdef SMALL_ALLOCATOR_ENABLED
+
+// Small blocks come from per-thread slabs, everything else from the system.
+
+static _FORCE_INLINE_ void *_system_alloc(size_t p_bytes) {
+
+	void *mem = SmallAllocator::alloc(p_bytes);
+	return mem ? mem : malloc(p_bytes);
+}
+
+static void *_system_realloc(void *p_memory, size_t p_bytes) {
+
+	if (!SmallAllocator::owns(p_memory)) {
+		return realloc(p_memory, p_bytes);
+	}
+
+	if (p_bytes == 0) {
+		SmallAllocator::free(p_memory);
+		return nullptr;
+	}
+
+	size_t block_size = SmallAllocator::get_block_size(p_memory);
+	if (p_bytes <= block_size && p_bytes > block_size / 2) {
+		return p_memory;
+	}
+
+	void *mem = _system_alloc(p_bytes);
+	if (!mem) {
+		return nullptr;
+	}
+	memcpy(mem, p_memory, MIN(block_size, p_bytes));
+	SmallAllocator::free(p_memory);
+	return mem;
+}
+
+static _FORCE_INLINE_ void _system_free(void *p_memory) {
+
+	if (SmallAllocator::owns(p_memory)) {
+		SmallAllocator::free(p_memory);
+	} else {
+		free(p_memory);
+	}
+}
+
+#else
+
+#define _system_alloc malloc
+#define _system_realloc realloc
+#define _system_free free
+
+#endif
+
 void *Memory::alloc_static(size_t p_bytes, bool p_pad_align) {
 
 #ifdef DEBUG_ENABLED
@@ -79,7 +137,7 @@ void *Memory::alloc_static(size_t p_bytes, bool p_pad_align) {
 	bool prepad = p_pad_align;
 #endif
 
-	void *mem = malloc(p_bytes + (prepad ? PAD_ALIGN : 0));
+	void *mem = _system_alloc(p_bytes + (prepad ? PAD_ALIGN : 0));
 
 	ERR_FAIL_COND_V(!mem, nullptr);
 
@@ -129,12 +187,12 @@ void *Memory::realloc_static(void *p_memory, size_t p_bytes, bool p_pad_align) {
 #endif
 
 		if (p_bytes == 0) {
-			free(mem);
+			_system_free(mem);
 			return nullptr;
 		} else {
 			*s = p_bytes;
 
-			mem = (uint8_t *)realloc(mem, p_bytes + PAD_ALIGN);
+			mem = (uint8_t *)_system_realloc(mem, p_bytes + PAD_ALIGN);
 			ERR_FAIL_COND_V(!mem, nullptr);
 
 			s = (uint64_t *)mem;
@@ -145,7 +203,7 @@ void *Memory::realloc_static(void *p_memory, size_t p_bytes, bool p_pad_align) {
 		}
 	} else {
 
-		mem = (uint8_t *)realloc(mem, p_bytes);
+		mem = (uint8_t *)_system_realloc(mem, p_bytes);
 
 		ERR_FAIL_COND_V(mem == nullptr && p_bytes > 0, nullptr);
 
@@ -175,10 +233,10 @@ void Memory::free_static(void *p_ptr, bool p_pad_align) {
 		atomic_sub(&mem_usage, *s);
 #endif
 
-		free(mem);
+		_system_free(mem);
 	} else {
 
-		free(mem);
+		_system_free(mem);
 	}
 }
 
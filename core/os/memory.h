@@ -55,6 +55,9 @@ public:
 	static void *realloc_static(void *p_memory, size_t p_bytes, bool p_pad_align = false);
 	static void free_static(void *p_ptr, bool p_pad_align = false);
 
+	// Bytes requested for a block allocated with p_pad_align.
+	_FORCE_INLINE_ static size_t get_padded_size(const void *p_ptr) { return *(const uint64_t *)((const uint8_t *)p_ptr - PAD_ALIGN); }
+
 	static uint64_t get_mem_available();
 	static uint64_t get_mem_usage();
 	static uint64_t get_mem_max_usage();
@@ -0,0 +1,478 @@
+/*************************************************************************/
+/*  small_allocator.cpp                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifdef SMALL_ALLOCATOR_ENABLED
+
+#include "small_allocator.h"
+
+#include "core/spin_lock.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+
+// Only the system allocator is used in here, as this sits underneath Memory.
+
+#define SLAB_SIZE (64 * 1024)
+#define SLAB_SHIFT 16
+#define SLAB_HEADER_SIZE 128
+#define SLABS_PER_CHUNK 16
+
+// Tells whether an address belongs to a slab. Two levels, indexed by slab number, covering 48-bit addresses.
+#define PAGEMAP_LEAF_BITS 16
+#define PAGEMAP_TOP_SIZE (1 << (48 - SLAB_SHIFT - PAGEMAP_LEAF_BITS))
+#define PAGEMAP_LEAF_WORDS ((1 << PAGEMAP_LEAF_BITS) / 64)
+
+static const uint32_t size_class_sizes[SmallAllocator::SIZE_CLASS_COUNT] = {
+	16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512
+};
+
+// Size class for every multiple of 16 bytes up to MAX_SIZE.
+static uint8_t size_class_lookup[SmallAllocator::MAX_SIZE / 16 + 1];
+static bool size_class_lookup_initialized = false;
+
+struct SmallAllocatorHeap;
+
+struct SmallAllocatorFreeBlock {
+	SmallAllocatorFreeBlock *next;
+};
+
+struct SmallAllocatorSlab {
+	SmallAllocatorHeap *owner;
+	uint32_t size_class;
+	uint32_t block_size;
+	uint32_t capacity;
+	uint32_t bump; // Blocks past this one were never handed out.
+	uint32_t used;
+	bool full;
+	SmallAllocatorFreeBlock *local_free;
+	std::atomic<SmallAllocatorFreeBlock *> remote_free; // Pushed by other threads.
+	SmallAllocatorSlab *prev;
+	SmallAllocatorSlab *next;
+};
+
+static_assert(sizeof(SmallAllocatorSlab) <= SLAB_HEADER_SIZE, "Slab header doesn't fit.");
+
+struct SmallAllocatorHeap {
+	struct SizeClass {
+		SmallAllocatorSlab *partial = nullptr; // Slabs that may have room, the first one is allocated from.
+		SmallAllocatorSlab *full = nullptr;
+		// Only written by the owning thread, atomic so stats can be read from anywhere.
+		std::atomic<uint64_t> used;
+		std::atomic<uint64_t> allocs;
+		std::atomic<uint64_t> remote_frees;
+	};
+
+	SizeClass classes[SmallAllocator::SIZE_CLASS_COUNT];
+	std::atomic<bool> remote_pending; // Some slab got blocks freed from another thread.
+	bool orphaned = false;
+	SmallAllocatorHeap *next = nullptr;
+};
+
+static SpinLock global_lock;
+static SmallAllocatorSlab *free_slabs = nullptr;
+static uint64_t free_slab_count = 0;
+static uint64_t reserved_bytes = 0;
+static SmallAllocatorHeap *heaps = nullptr;
+static std::atomic<std::atomic<uint64_t> *> pagemap[PAGEMAP_TOP_SIZE];
+
+static thread_local SmallAllocatorHeap *current_heap = nullptr;
+static thread_local bool thread_exiting = false;
+
+struct SmallAllocatorHeapReleaser {
+	~SmallAllocatorHeapReleaser() {
+		thread_exiting = true;
+		if (current_heap) {
+			// Slabs stay with the heap, a new thread will adopt it.
+			global_lock.lock();
+			current_heap->orphaned = true;
+			global_lock.unlock();
+			current_heap = nullptr;
+		}
+	}
+};
+
+static thread_local SmallAllocatorHeapReleaser heap_releaser;
+
+static _FORCE_INLINE_ SmallAllocatorSlab *_get_slab(const void *p_ptr) {
+	return (SmallAllocatorSlab *)((uintptr_t)p_ptr & ~(uintptr_t)(SLAB_SIZE - 1));
+}
+
+static void _list_remove(SmallAllocatorSlab *&r_list, SmallAllocatorSlab *p_slab) {
+	if (p_slab->prev) {
+		p_slab->prev->next = p_slab->next;
+	} else {
+		r_list = p_slab->next;
+	}
+	if (p_slab->next) {
+		p_slab->next->prev = p_slab->prev;
+	}
+	p_slab->prev = nullptr;
+	p_slab->next = nullptr;
+}
+
+static void _list_push_front(SmallAllocatorSlab *&r_list, SmallAllocatorSlab *p_slab) {
+	p_slab->prev = nullptr;
+	p_slab->next = r_list;
+	if (r_list) {
+		r_list->prev = p_slab;
+	}
+	r_list = p_slab;
+}
+
+// Must be called with global_lock held.
+static bool _reserve_chunk() {
+
+	uint8_t *chunk = (uint8_t *)::malloc(SLAB_SIZE * (SLABS_PER_CHUNK + 1));
+	if (!chunk) {
+		return false;
+	}
+	// Never given back to the system, empty slabs are recycled through the pool instead.
+	uint8_t *first = (uint8_t *)(((uintptr_t)chunk + SLAB_SIZE - 1) & ~(uintptr_t)(SLAB_SIZE - 1));
+
+	for (int i = 0; i < SLABS_PER_CHUNK; i++) {
+		uint64_t slab_index = uint64_t((uintptr_t)(first + i * SLAB_SIZE)) >> SLAB_SHIFT;
+		uint64_t top = slab_index >> PAGEMAP_LEAF_BITS;
+		if (top >= PAGEMAP_TOP_SIZE) {
+			// Outside the address range the map covers, give up on the rest of the chunk.
+			break;
+		}
+
+		std::atomic<uint64_t> *leaf = pagemap[top].load(std::memory_order_relaxed);
+		if (!leaf) {
+			leaf = (std::atomic<uint64_t> *)::calloc(PAGEMAP_LEAF_WORDS, sizeof(std::atomic<uint64_t>));
+			if (!leaf) {
+				break;
+			}
+			pagemap[top].store(leaf, std::memory_order_release);
+		}
+		uint64_t bit = slab_index & ((1 << PAGEMAP_LEAF_BITS) - 1);
+		leaf[bit >> 6].fetch_or(uint64_t(1) << (bit & 63), std::memory_order_release);
+
+		SmallAllocatorSlab *slab = new (first + i * SLAB_SIZE) SmallAllocatorSlab;
+		slab->next = free_slabs;
+		free_slabs = slab;
+		free_slab_count++;
+	}
+
+	reserved_bytes += SLAB_SIZE * (SLABS_PER_CHUNK + 1);
+	return true;
+}
+
+static SmallAllocatorSlab *_take_slab(SmallAllocatorHeap *p_heap, uint32_t p_size_class) {
+
+	global_lock.lock();
+	if (!free_slabs && !_reserve_chunk()) {
+		global_lock.unlock();
+		return nullptr;
+	}
+	SmallAllocatorSlab *slab = free_slabs;
+	free_slabs = slab->next;
+	free_slab_count--;
+	global_lock.unlock();
+
+	slab->owner = p_heap;
+	slab->size_class = p_size_class;
+	slab->block_size = size_class_sizes[p_size_class];
+	slab->capacity = (SLAB_SIZE - SLAB_HEADER_SIZE) / slab->block_size;
+	slab->bump = 0;
+	slab->used = 0;
+	slab->full = false;
+	slab->local_free = nullptr;
+	slab->remote_free.store(nullptr, std::memory_order_relaxed);
+	slab->prev = nullptr;
+	slab->next = nullptr;
+	return slab;
+}
+
+static void _release_slab(SmallAllocatorSlab *p_slab) {
+
+	global_lock.lock();
+	p_slab->owner = nullptr;
+	p_slab->next = free_slabs;
+	free_slabs = p_slab;
+	free_slab_count++;
+	global_lock.unlock();
+}
+
+static SmallAllocatorHeap *_acquire_heap() {
+
+	if (thread_exiting) {
+		// Thread-local destructors are running, the heap would never be released.
+		return nullptr;
+	}
+	(void)&heap_releaser; // Make sure it's constructed, so it runs on thread exit.
+
+	global_lock.lock();
+
+	if (!size_class_lookup_initialized) {
+		uint32_t size_class = 0;
+		for (uint32_t i = 0; i <= SmallAllocator::MAX_SIZE / 16; i++) {
+			while (size_class_sizes[size_class] < i * 16) {
+				size_class++;
+			}
+			size_class_lookup[i] = size_class;
+		}
+		size_class_lookup_initialized = true;
+	}
+
+	SmallAllocatorHeap *heap = heaps;
+	while (heap && !heap->orphaned) {
+		heap = heap->next;
+	}
+
+	if (heap) {
+		heap->orphaned = false;
+	} else {
+		void *mem = ::malloc(sizeof(SmallAllocatorHeap));
+		if (mem) {
+			heap = new (mem) SmallAllocatorHeap;
+			heap->remote_pending.store(false, std::memory_order_relaxed);
+			for (int i = 0; i < SmallAllocator::SIZE_CLASS_COUNT; i++) {
+				heap->classes[i].used.store(0, std::memory_order_relaxed);
+				heap->classes[i].allocs.store(0, std::memory_order_relaxed);
+				heap->classes[i].remote_frees.store(0, std::memory_order_relaxed);
+			}
+			heap->next = heaps;
+			heaps = heap;
+		}
+	}
+
+	global_lock.unlock();
+
+	current_heap = heap;
+	return heap;
+}
+
+// Moves blocks freed by other threads to the local free list, returns how many.
+static uint32_t _collect_remote_frees(SmallAllocatorSlab *p_slab) {
+
+	SmallAllocatorFreeBlock *block = p_slab->remote_free.exchange(nullptr, std::memory_order_acquire);
+	uint32_t count = 0;
+	while (block) {
+		SmallAllocatorFreeBlock *next = block->next;
+		block->next = p_slab->local_free;
+		p_slab->local_free = block;
+		block = next;
+		count++;
+	}
+	p_slab->used -= count;
+	return count;
+}
+
+static void _collect_heap_remote_frees(SmallAllocatorHeap *p_heap) {
+
+	for (int i = 0; i < SmallAllocator::SIZE_CLASS_COUNT; i++) {
+		SmallAllocatorHeap::SizeClass &sc = p_heap->classes[i];
+		uint64_t collected = 0;
+
+		for (SmallAllocatorSlab *slab = sc.partial; slab; slab = slab->next) {
+			collected += _collect_remote_frees(slab);
+		}
+
+		SmallAllocatorSlab *slab = sc.full;
+		while (slab) {
+			SmallAllocatorSlab *next = slab->next;
+			uint32_t count = _collect_remote_frees(slab);
+			if (count) {
+				collected += count;
+				_list_remove(sc.full, slab);
+				slab->full = false;
+				_list_push_front(sc.partial, slab);
+			}
+			slab = next;
+		}
+
+		if (collected) {
+			sc.used.store(sc.used.load(std::memory_order_relaxed) - collected, std::memory_order_relaxed);
+			sc.remote_frees.store(sc.remote_frees.load(std::memory_order_relaxed) + collected, std::memory_order_relaxed);
+		}
+	}
+}
+
+static _FORCE_INLINE_ void *_alloc_from_slab(SmallAllocatorHeap::SizeClass &r_sc, SmallAllocatorSlab *p_slab) {
+
+	void *block;
+	if (p_slab->local_free) {
+		block = p_slab->local_free;
+		p_slab->local_free = p_slab->local_free->next;
+	} else if (p_slab->bump < p_slab->capacity) {
+		block = (uint8_t *)p_slab + SLAB_HEADER_SIZE + p_slab->bump * p_slab->block_size;
+		p_slab->bump++;
+	} else {
+		return nullptr;
+	}
+
+	p_slab->used++;
+	r_sc.used.store(r_sc.used.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	r_sc.allocs.store(r_sc.allocs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	return block;
+}
+
+static void *_alloc_slow(SmallAllocatorHeap *p_heap, uint32_t p_size_class) {
+
+	if (p_heap->remote_pending.load(std::memory_order_relaxed) && p_heap->remote_pending.exchange(false, std::memory_order_acquire)) {
+		_collect_heap_remote_frees(p_heap);
+	}
+
+	SmallAllocatorHeap::SizeClass &sc = p_heap->classes[p_size_class];
+
+	SmallAllocatorSlab *slab = sc.partial;
+	while (slab) {
+		SmallAllocatorSlab *next = slab->next;
+		void *block = _alloc_from_slab(sc, slab);
+		if (block) {
+			if (slab != sc.partial) {
+				_list_remove(sc.partial, slab);
+				_list_push_front(sc.partial, slab);
+			}
+			return block;
+		}
+		// Exhausted, keep it out of the way until something is freed into it.
+		_list_remove(sc.partial, slab);
+		slab->full = true;
+		_list_push_front(sc.full, slab);
+		slab = next;
+	}
+
+	slab = _take_slab(p_heap, p_size_class);
+	if (!slab) {
+		return nullptr;
+	}
+	_list_push_front(sc.partial, slab);
+	return _alloc_from_slab(sc, slab);
+}
+
+void *SmallAllocator::alloc(size_t p_bytes) {
+
+	if (p_bytes > MAX_SIZE) {
+		return nullptr;
+	}
+
+	SmallAllocatorHeap *heap = current_heap;
+	if (unlikely(!heap)) {
+		heap = _acquire_heap();
+		if (!heap) {
+			return nullptr;
+		}
+	}
+
+	uint32_t size_class = size_class_lookup[(p_bytes + 15) >> 4];
+	SmallAllocatorHeap::SizeClass &sc = heap->classes[size_class];
+
+	if (likely(sc.partial)) {
+		void *block = _alloc_from_slab(sc, sc.partial);
+		if (likely(block)) {
+			return block;
+		}
+	}
+
+	return _alloc_slow(heap, size_class);
+}
+
+bool SmallAllocator::owns(const void *p_ptr) {
+
+	uint64_t slab_index = uint64_t((uintptr_t)p_ptr) >> SLAB_SHIFT;
+	uint64_t top = slab_index >> PAGEMAP_LEAF_BITS;
+	if (top >= PAGEMAP_TOP_SIZE) {
+		return false;
+	}
+	std::atomic<uint64_t> *leaf = pagemap[top].load(std::memory_order_acquire);
+	if (!leaf) {
+		return false;
+	}
+	uint64_t bit = slab_index & ((1 << PAGEMAP_LEAF_BITS) - 1);
+	return leaf[bit >> 6].load(std::memory_order_relaxed) & (uint64_t(1) << (bit & 63));
+}
+
+void SmallAllocator::free(void *p_ptr) {
+
+	SmallAllocatorSlab *slab = _get_slab(p_ptr);
+	SmallAllocatorFreeBlock *block = (SmallAllocatorFreeBlock *)p_ptr;
+	SmallAllocatorHeap *heap = current_heap;
+
+	if (slab->owner != heap) {
+		// Another thread's block, hand it back lock-free. The slab can't go away meanwhile, as this block is in use.
+		SmallAllocatorHeap *owner = slab->owner;
+		SmallAllocatorFreeBlock *head = slab->remote_free.load(std::memory_order_relaxed);
+		do {
+			block->next = head;
+		} while (!slab->remote_free.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+		owner->remote_pending.store(true, std::memory_order_release);
+		return;
+	}
+
+	SmallAllocatorHeap::SizeClass &sc = heap->classes[slab->size_class];
+
+	block->next = slab->local_free;
+	slab->local_free = block;
+	slab->used--;
+	sc.used.store(sc.used.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+
+	if (slab->full) {
+		_list_remove(sc.full, slab);
+		slab->full = false;
+		_list_push_front(sc.partial, slab);
+	} else if (slab->used == 0 && slab != sc.partial) {
+		// Give empty slabs back, so other threads and size classes can use them. Keep the current one to avoid thrashing.
+		// Blocks freed from other threads count as used until collected, so none can be in flight here.
+		_list_remove(sc.partial, slab);
+		_release_slab(slab);
+	}
+}
+
+size_t SmallAllocator::get_block_size(const void *p_ptr) {
+
+	return _get_slab(p_ptr)->block_size;
+}
+
+void SmallAllocator::get_stats(Stats &r_stats) {
+
+	r_stats = Stats();
+	for (int i = 0; i < SIZE_CLASS_COUNT; i++) {
+		r_stats.block_size[i] = size_class_sizes[i];
+	}
+
+	global_lock.lock();
+	r_stats.reserved_bytes = reserved_bytes;
+	r_stats.free_slabs = free_slab_count;
+	for (SmallAllocatorHeap *heap = heaps; heap; heap = heap->next) {
+		r_stats.heaps++;
+		for (int i = 0; i < SIZE_CLASS_COUNT; i++) {
+			r_stats.blocks_used[i] += heap->classes[i].used.load(std::memory_order_relaxed);
+			r_stats.allocs[i] += heap->classes[i].allocs.load(std::memory_order_relaxed);
+			r_stats.remote_frees[i] += heap->classes[i].remote_frees.load(std::memory_order_relaxed);
+		}
+	}
+	global_lock.unlock();
+}
+
+#endif // SMALL_ALLOCATOR_ENABLED
@@ -0,0 +1,76 @@
+/*************************************************************************/
+/*  small_allocator.h                                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef SMALL_ALLOCATOR_H
+#define SMALL_ALLOCATOR_H
+
+#include "core/typedefs.h"
+
+#include <stddef.h>
+
+// Size-class slab allocator for small blocks, used by Memory when built with
+// small_allocator=yes.
+//
+// Every thread allocates from its own heap of 64 KiB slabs, each slab serving
+// a single size class, so allocating and freeing on the same thread is a free
+// list push/pop with no atomics. Blocks freed from other threads go to a
+// lock-free list on their slab, which the owning heap collects lazily. Heaps
+// of threads that exit are adopted by new threads, and empty slabs are shared
+// between heaps and size classes through a global pool.
+
+class SmallAllocator {
+public:
+	enum {
+		MAX_SIZE = 512,
+		SIZE_CLASS_COUNT = 16,
+	};
+
+	struct Stats {
+		uint64_t reserved_bytes = 0; // Slab memory taken from the system.
+		uint64_t free_slabs = 0; // Slabs in the global pool.
+		uint32_t heaps = 0; // Thread heaps, including those of exited threads.
+		uint32_t block_size[SIZE_CLASS_COUNT] = {};
+		uint64_t blocks_used[SIZE_CLASS_COUNT] = {}; // Blocks freed from other threads count until their heap collects them.
+		uint64_t allocs[SIZE_CLASS_COUNT] = {};
+		uint64_t remote_frees[SIZE_CLASS_COUNT] = {};
+	};
+
+	// Returns nullptr if p_bytes is too large, the caller should fall back to the system allocator.
+	static void *alloc(size_t p_bytes);
+	// Whether p_ptr was returned by alloc(), safe to call with any pointer.
+	static bool owns(const void *p_ptr);
+	static void free(void *p_ptr);
+	// Usable size of a block returned by alloc().
+	static size_t get_block_size(const void *p_ptr);
+
+	static void get_stats(Stats &r_stats);
+};
+
+#endif // SMALL_ALLOCATOR_H
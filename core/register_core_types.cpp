@@ -95,6 +95,7 @@ extern Mutex _global_mutex;
 extern void register_global_constants();
 extern void unregister_global_constants();
 extern void register_variant_methods();
+extern void register_variant_operators();
 extern void unregister_variant_methods();
 
 void register_core_types() {
@@ -110,6 +111,7 @@ void register_core_types() {
 
 	register_global_constants();
 	register_variant_methods();
+	register_variant_operators();
 
 	CoreStringNames::create();
 
@@ -235,6 +237,9 @@ void register_core_settings() {
 
 	GLOBAL_DEF("network/ssl/certificates", "");
 	ProjectSettings::get_singleton()->set_custom_property_info("network/ssl/certificates", PropertyInfo(Variant::STRING, "network/ssl/certificates", PROPERTY_HINT_FILE, "*.crt"));
+
+	ResourceFormatLoaderBinary::set_lazy_load_min_size(int(GLOBAL_DEF("memory/resources/lazy_load_min_size_kb", 0)) * 1024);
+	ProjectSettings::get_singleton()->set_custom_property_info("memory/resources/lazy_load_min_size_kb", PropertyInfo(Variant::INT, "memory/resources/lazy_load_min_size_kb", PROPERTY_HINT_RANGE, "0,65536,1,or_greater"));
 }
 
 void register_core_singletons() {
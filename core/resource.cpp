@@ -364,6 +364,31 @@ bool Resource::is_translation_remapped() const {
 	return remapped_list.in_list();
 }
 
+void Resource::set_deferred_property(const StringName &p_property, const DeferredProperty &p_deferred) {
+
+	ERR_FAIL_COND(!p_deferred.load_func);
+	ERR_FAIL_COND_MSG(!can_defer_property(p_property), "Property '" + String(p_property) + "' of " + get_class() + " can't be deferred.");
+	deferred_properties[p_property] = p_deferred;
+}
+
+const Resource::DeferredProperty *Resource::get_deferred_property(const StringName &p_property) const {
+
+	const Map<StringName, DeferredProperty>::Element *E = deferred_properties.find(p_property);
+	return E ? &E->get() : nullptr;
+}
+
+Variant Resource::load_deferred_property(const StringName &p_property) const {
+
+	const DeferredProperty *deferred = get_deferred_property(p_property);
+	ERR_FAIL_COND_V_MSG(!deferred, Variant(), "Property '" + String(p_property) + "' is not deferred.");
+	return deferred->load_func(*deferred);
+}
+
+void Resource::clear_deferred_property(const StringName &p_property) {
+
+	deferred_properties.erase(p_property);
+}
+
 #ifdef TOOLS_ENABLED
 //helps keep IDs same number when loading/saving scenes. -1 clears ID and it Returns -1 when no id stored
 void Resource::set_id_for_path(const String &p_path, int p_id) {
@@ -453,7 +478,7 @@ Resource::~Resource() {
 	}
 }
 
-HashMap<String, Resource *> ResourceCache::resources;
+SwissHashMap<String, Resource *> ResourceCache::resources;
 #ifdef TOOLS_ENABLED
 HashMap<String, HashMap<String, int>> ResourceCache::resource_path_cache;
 #endif
@@ -505,14 +530,12 @@ Resource *ResourceCache::get(const String &p_path) {
 	lock->read_lock();
 
 	Resource **res = resources.getptr(p_path);
+	// Dereference while locked, inserting may move the cache entries.
+	Resource *r = res ? *res : nullptr;
 
 	lock->read_unlock();
 
-	if (!res) {
-		return nullptr;
-	}
-
-	return *res;
+	return r;
 }
 
 void ResourceCache::get_cached_resources(List<Ref<Resource>> *p_resources) {
@@ -521,7 +544,7 @@ void ResourceCache::get_cached_resources(List<Ref<Resource>> *p_resources) {
 	const String *K = nullptr;
 	while ((K = resources.next(K))) {
 
-		Resource *r = resources[*K];
+		Resource *r = resources.get(*K);
 		p_resources->push_back(Ref<Resource>(r));
 	}
 	lock->read_unlock();
@@ -551,7 +574,7 @@ void ResourceCache::dump(const char *p_file, bool p_short) {
 	const String *K = nullptr;
 	while ((K = resources.next(K))) {
 
-		Resource *r = resources[*K];
+		Resource *r = resources.get(*K);
 
 		if (!type_count.has(r->get_class())) {
 			type_count[r->get_class()] = 0;
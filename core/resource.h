@@ -36,6 +36,7 @@
 #include "core/reference.h"
 #include "core/safe_refcount.h"
 #include "core/self_list.h"
+#include "core/swiss_hash_map.h"
 
 #define RES_BASE_EXTENSION(m_ext)                                                                                   \
 public:                                                                                                             \
@@ -50,7 +51,20 @@ class Resource : public Reference {
 	OBJ_CATEGORY("Resources");
 	RES_BASE_EXTENSION("res");
 
+public:
+	// A large property value a loader left in the file instead of setting it,
+	// for classes that only need it later (see can_defer_property()).
+	struct DeferredProperty {
+		String path;
+		uint64_t offset = 0;
+		uint32_t length = 0; // Elements in the array.
+		uint32_t flags = 0; // Loader specific.
+		Variant (*load_func)(const DeferredProperty &p_property) = nullptr;
+	};
+
+private:
 	Set<ObjectID> owners;
+	Map<StringName, DeferredProperty> deferred_properties;
 
 	friend class ResBase;
 	friend class ResourceCache;
@@ -132,6 +146,15 @@ public:
 
 	virtual RID get_rid() const; // some resources may offer conversion to RID
 
+	// Lazy loading. Classes opt in per property and read the value back with
+	// load_deferred_property() when first needed, which can be done again
+	// after releasing it as long as the deferred property isn't cleared.
+	virtual bool can_defer_property(const StringName &p_property) const { return false; }
+	void set_deferred_property(const StringName &p_property, const DeferredProperty &p_deferred);
+	const DeferredProperty *get_deferred_property(const StringName &p_property) const;
+	Variant load_deferred_property(const StringName &p_property) const;
+	void clear_deferred_property(const StringName &p_property);
+
 #ifdef TOOLS_ENABLED
 	//helps keep IDs same number when loading/saving scenes. -1 clears ID and it Returns -1 when no id stored
 	void set_id_for_path(const String &p_path, int p_id);
@@ -148,7 +171,7 @@ class ResourceCache {
 	friend class Resource;
 	friend class ResourceLoader; //need the lock
 	static RWLock *lock;
-	static HashMap<String, Resource *> resources;
+	static SwissHashMap<String, Resource *> resources;
 #ifdef TOOLS_ENABLED
 	static HashMap<String, HashMap<String, int>> resource_path_cache; // each tscn has a set of resource paths and IDs
 	static RWLock *path_cache_lock;
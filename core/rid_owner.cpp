@@ -31,3 +31,5 @@
 #include "rid_owner.h"
 
 volatile uint64_t RID_AllocBase::base_id = 1;
+std::atomic<uint32_t> RID_AllocBase::thread_count(0);
+thread_local uint32_t RID_AllocBase::thread_index = 0;
@@ -39,12 +39,16 @@
 #include "core/safe_refcount.h"
 #include "core/set.h"
 #include "core/spin_lock.h"
+
 #include <stdio.h>
+#include <atomic>
 #include <typeinfo>
 
 class RID_AllocBase {
 
 	static volatile uint64_t base_id;
+	static std::atomic<uint32_t> thread_count;
+	static thread_local uint32_t thread_index;
 
 protected:
 	static RID _make_from_id(uint64_t p_id) {
@@ -61,6 +65,14 @@ protected:
 		return _make_from_id(_gen_id());
 	}
 
+	// Spreads threads over the free lists of thread safe allocators.
+	static uint32_t _get_thread_index() {
+		if (unlikely(thread_index == 0)) {
+			thread_index = thread_count.fetch_add(1, std::memory_order_relaxed) + 1;
+		}
+		return thread_index;
+	}
+
 public:
 	virtual ~RID_AllocBase() {}
 };
@@ -68,219 +80,302 @@ public:
 template <class T, bool THREAD_SAFE = false>
 class RID_Alloc : public RID_AllocBase {
 
-	T **chunks;
-	uint32_t **free_list_chunks;
-	uint32_t **validator_chunks;
+	enum {
+		INVALID_VALIDATOR = 0xFFFFFFFF,
+		FREE_LIST_COUNT = 8,
+		STEAL_COUNT = 64,
+	};
+
+	// Chunks never move once allocated. When the chunk table grows, a copy
+	// is published and the old one is kept until destruction, so thread
+	// safe lookups can read it without taking a lock.
+	struct ChunkTable {
+		T **chunks;
+		std::atomic<uint32_t> **validator_chunks;
+		std::atomic<uint32_t> chunk_count;
+		uint32_t chunk_capacity;
+		ChunkTable *retired;
+	};
+
+	// Thread safe allocators recycle indices through several free lists,
+	// each used by a subset of the threads.
+	struct FreeList {
+		SpinLock lock;
+		uint32_t *indices = nullptr;
+		uint32_t count = 0;
+		uint32_t capacity = 0;
+	};
+
+	std::atomic<ChunkTable *> table;
+	uint32_t **free_list_chunks; //not thread safe only, free indices are stored from alloc_count on
+	FreeList *free_lists; //thread safe only
 
 	uint32_t elements_in_chunk;
 	uint32_t max_alloc;
-	uint32_t alloc_count;
+	std::atomic<uint32_t> alloc_count;
 
 	const char *description;
 
-	SpinLock spin_lock;
+	SpinLock spin_lock; //thread safe only, taken to add chunks
 
-public:
-	RID make_rid(const T &p_value) {
+	void _add_chunk() {
 
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
+		ChunkTable *t = table.load(std::memory_order_relaxed);
+		uint32_t chunk_count = t->chunk_count.load(std::memory_order_relaxed);
 
-		if (alloc_count == max_alloc) {
-			//allocate a new chunk
-			uint32_t chunk_count = alloc_count == 0 ? 0 : (max_alloc / elements_in_chunk);
+		if (chunk_count == t->chunk_capacity) {
+			//grow the chunk table
+			ChunkTable *nt = memnew(ChunkTable);
+			nt->chunk_capacity = t->chunk_capacity ? t->chunk_capacity * 2 : 1;
+			nt->chunks = (T **)memalloc(sizeof(T *) * nt->chunk_capacity);
+			nt->validator_chunks = (std::atomic<uint32_t> **)memalloc(sizeof(std::atomic<uint32_t> *) * nt->chunk_capacity);
+			for (uint32_t i = 0; i < chunk_count; i++) {
+				nt->chunks[i] = t->chunks[i];
+				nt->validator_chunks[i] = t->validator_chunks[i];
+			}
+			nt->chunk_count.store(chunk_count, std::memory_order_relaxed);
+
+			if (THREAD_SAFE) {
+				nt->retired = t;
+			} else {
+				nt->retired = t->retired;
+				_free_table(t);
+			}
+			table.store(nt, std::memory_order_release);
+			t = nt;
+		}
 
-			//grow chunks
-			chunks = (T **)memrealloc(chunks, sizeof(T *) * (chunk_count + 1));
-			chunks[chunk_count] = (T *)memalloc(sizeof(T) * elements_in_chunk); //but don't initialize
+		t->chunks[chunk_count] = (T *)memalloc(sizeof(T) * elements_in_chunk); //but don't initialize
+		t->validator_chunks[chunk_count] = (std::atomic<uint32_t> *)memalloc(sizeof(std::atomic<uint32_t>) * elements_in_chunk);
+		for (uint32_t i = 0; i < elements_in_chunk; i++) {
+			memnew_placement(&t->validator_chunks[chunk_count][i], std::atomic<uint32_t>(INVALID_VALIDATOR));
+		}
 
-			//grow validators
-			validator_chunks = (uint32_t **)memrealloc(validator_chunks, sizeof(uint32_t *) * (chunk_count + 1));
-			validator_chunks[chunk_count] = (uint32_t *)memalloc(sizeof(uint32_t) * elements_in_chunk);
+		if (!THREAD_SAFE) {
 			//grow free lists
 			free_list_chunks = (uint32_t **)memrealloc(free_list_chunks, sizeof(uint32_t *) * (chunk_count + 1));
 			free_list_chunks[chunk_count] = (uint32_t *)memalloc(sizeof(uint32_t) * elements_in_chunk);
-
-			//initialize
 			for (uint32_t i = 0; i < elements_in_chunk; i++) {
-				//dont initialize chunk
-				validator_chunks[chunk_count][i] = 0xFFFFFFFF;
-				free_list_chunks[chunk_count][i] = alloc_count + i;
+				free_list_chunks[chunk_count][i] = max_alloc + i;
 			}
+		}
 
-			max_alloc += elements_in_chunk;
+		max_alloc += elements_in_chunk;
+		t->chunk_count.store(chunk_count + 1, std::memory_order_release);
+	}
+
+	static void _free_table(ChunkTable *p_table) {
+		if (p_table->chunk_capacity) {
+			memfree(p_table->chunks);
+			memfree(p_table->validator_chunks);
 		}
+		memdelete(p_table);
+	}
 
-		uint32_t free_index = free_list_chunks[alloc_count / elements_in_chunk][alloc_count % elements_in_chunk];
+	uint32_t _alloc_index() {
 
-		uint32_t free_chunk = free_index / elements_in_chunk;
-		uint32_t free_element = free_index % elements_in_chunk;
+		if (!THREAD_SAFE) {
+			if (alloc_count.load(std::memory_order_relaxed) == max_alloc) {
+				_add_chunk();
+			}
+			uint32_t count = alloc_count.load(std::memory_order_relaxed);
+			return free_list_chunks[count / elements_in_chunk][count % elements_in_chunk];
+		}
 
-		T *ptr = &chunks[free_chunk][free_element];
-		memnew_placement(ptr, T(p_value));
+		uint32_t list_index = _get_thread_index() % FREE_LIST_COUNT;
+		FreeList &list = free_lists[list_index];
 
-		uint32_t validator = (uint32_t)(_gen_id() & 0xFFFFFFFF);
-		uint64_t id = validator;
-		id <<= 32;
-		id |= free_index;
+		list.lock.lock();
+		if (likely(list.count)) {
+			uint32_t index = list.indices[--list.count];
+			list.lock.unlock();
+			return index;
+		}
+		list.lock.unlock();
+
+		// Take half of another list, or add a chunk when all are empty.
+		// Only one lock is held at a time, so threads refilling their
+		// lists from each other can't deadlock.
+		uint32_t stolen[STEAL_COUNT];
+		uint32_t stolen_count = 0;
+		for (uint32_t i = 1; i < FREE_LIST_COUNT && stolen_count == 0; i++) {
+			FreeList &other = free_lists[(list_index + i) % FREE_LIST_COUNT];
+			other.lock.lock();
+			stolen_count = MIN((other.count + 1) / 2, (uint32_t)STEAL_COUNT);
+			other.count -= stolen_count;
+			memcpy(stolen, other.indices + other.count, sizeof(uint32_t) * stolen_count);
+			other.lock.unlock();
+		}
 
-		validator_chunks[free_chunk][free_element] = validator;
-		alloc_count++;
+		if (stolen_count) {
+			list.lock.lock();
+			_free_list_reserve(list, list.count + stolen_count - 1);
+			memcpy(list.indices + list.count, stolen + 1, sizeof(uint32_t) * (stolen_count - 1));
+			list.count += stolen_count - 1;
+			list.lock.unlock();
+			return stolen[0];
+		}
+
+		spin_lock.lock();
+		uint32_t first = max_alloc;
+		_add_chunk();
+		spin_lock.unlock();
 
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
+		list.lock.lock();
+		_free_list_reserve(list, list.count + elements_in_chunk - 1);
+		for (uint32_t i = 1; i < elements_in_chunk; i++) {
+			list.indices[list.count++] = first + elements_in_chunk - i;
 		}
+		list.lock.unlock();
 
-		return _make_from_id(id);
+		return first;
 	}
 
-	_FORCE_INLINE_ T *getornull(const RID &p_rid) {
+	void _free_index(uint32_t p_index) {
 
-		if (THREAD_SAFE) {
-			spin_lock.lock();
+		if (!THREAD_SAFE) {
+			uint32_t count = alloc_count.load(std::memory_order_relaxed);
+			free_list_chunks[count / elements_in_chunk][count % elements_in_chunk] = p_index;
+			return;
 		}
 
-		uint64_t id = p_rid.get_id();
-		uint32_t idx = uint32_t(id & 0xFFFFFFFF);
-		if (unlikely(idx >= max_alloc)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
-			return nullptr;
-		}
+		FreeList &list = free_lists[_get_thread_index() % FREE_LIST_COUNT];
+		list.lock.lock();
+		_free_list_reserve(list, list.count + 1);
+		list.indices[list.count++] = p_index;
+		list.lock.unlock();
+	}
 
-		uint32_t idx_chunk = idx / elements_in_chunk;
-		uint32_t idx_element = idx % elements_in_chunk;
+	static void _free_list_reserve(FreeList &r_list, uint32_t p_count) {
+		if (p_count > r_list.capacity) {
+			r_list.capacity = MAX(p_count, r_list.capacity * 2);
+			r_list.indices = (uint32_t *)memrealloc(r_list.indices, sizeof(uint32_t) * r_list.capacity);
+		}
+	}
 
-		uint32_t validator = uint32_t(id >> 32);
-		if (unlikely(validator_chunks[idx_chunk][idx_element] != validator)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
+	uint32_t _find_index(uint32_t p_index) const {
+		const ChunkTable *t = table.load(std::memory_order_acquire);
+		uint32_t count = t->chunk_count.load(std::memory_order_acquire) * elements_in_chunk;
+		for (uint32_t i = 0; i < count; i++) {
+			if (t->validator_chunks[i / elements_in_chunk][i % elements_in_chunk].load(std::memory_order_acquire) != INVALID_VALIDATOR) {
+				if (p_index == 0) {
+					return i;
+				}
+				p_index--;
 			}
+		}
+		return INVALID_VALIDATOR;
+	}
+
+	_FORCE_INLINE_ std::atomic<uint32_t> *_get_validator(const ChunkTable *p_table, uint32_t p_index) const {
+		uint32_t idx_chunk = p_index / elements_in_chunk;
+		if (unlikely(idx_chunk >= p_table->chunk_count.load(std::memory_order_acquire))) {
 			return nullptr;
 		}
+		return &p_table->validator_chunks[idx_chunk][p_index % elements_in_chunk];
+	}
 
-		T *ptr = &chunks[idx_chunk][idx_element];
+public:
+	RID make_rid(const T &p_value) {
 
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
+		uint32_t free_index = _alloc_index();
 
-		return ptr;
-	}
+		ChunkTable *t = table.load(std::memory_order_acquire);
+		uint32_t free_chunk = free_index / elements_in_chunk;
+		uint32_t free_element = free_index % elements_in_chunk;
 
-	_FORCE_INLINE_ bool owns(const RID &p_rid) {
+		T *ptr = &t->chunks[free_chunk][free_element];
+		memnew_placement(ptr, T(p_value));
 
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
+		uint32_t validator = (uint32_t)(_gen_id() & 0xFFFFFFFF);
+		uint64_t id = validator;
+		id <<= 32;
+		id |= free_index;
+
+		//published after the value, so thread safe lookups see it constructed
+		t->validator_chunks[free_chunk][free_element].store(validator, std::memory_order_release);
+		alloc_count.fetch_add(1, std::memory_order_relaxed);
+
+		return _make_from_id(id);
+	}
+
+	_FORCE_INLINE_ T *getornull(const RID &p_rid) {
 
 		uint64_t id = p_rid.get_id();
 		uint32_t idx = uint32_t(id & 0xFFFFFFFF);
-		if (unlikely(idx >= max_alloc)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
-			return false;
-		}
+		const ChunkTable *t = table.load(std::memory_order_acquire);
 
-		uint32_t idx_chunk = idx / elements_in_chunk;
-		uint32_t idx_element = idx % elements_in_chunk;
+		std::atomic<uint32_t> *validator = _get_validator(t, idx);
+		if (unlikely(!validator || validator->load(std::memory_order_acquire) != uint32_t(id >> 32))) {
+			return nullptr;
+		}
 
-		uint32_t validator = uint32_t(id >> 32);
+		return &t->chunks[idx / elements_in_chunk][idx % elements_in_chunk];
+	}
 
-		bool owned = validator_chunks[idx_chunk][idx_element] == validator;
+	_FORCE_INLINE_ bool owns(const RID &p_rid) {
 
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
+		uint64_t id = p_rid.get_id();
+		uint32_t idx = uint32_t(id & 0xFFFFFFFF);
+		const ChunkTable *t = table.load(std::memory_order_acquire);
 
-		return owned;
+		std::atomic<uint32_t> *validator = _get_validator(t, idx);
+		return validator && validator->load(std::memory_order_acquire) == uint32_t(id >> 32);
 	}
 
 	_FORCE_INLINE_ void free(const RID &p_rid) {
 
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
-
 		uint64_t id = p_rid.get_id();
 		uint32_t idx = uint32_t(id & 0xFFFFFFFF);
-		if (unlikely(idx >= max_alloc)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
-			ERR_FAIL();
-		}
+		const ChunkTable *t = table.load(std::memory_order_acquire);
 
-		uint32_t idx_chunk = idx / elements_in_chunk;
-		uint32_t idx_element = idx % elements_in_chunk;
+		std::atomic<uint32_t> *validator = _get_validator(t, idx);
+		ERR_FAIL_COND(!validator);
 
-		uint32_t validator = uint32_t(id >> 32);
-		if (unlikely(validator_chunks[idx_chunk][idx_element] != validator)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
-			ERR_FAIL();
-		}
-
-		chunks[idx_chunk][idx_element].~T();
-		validator_chunks[idx_chunk][idx_element] = 0xFFFFFFFF; // go invalid
+		// Invalidate before destroying, so lookups stop finding it. When
+		// two threads free the same RID only one of them gets past this.
+		uint32_t expected = uint32_t(id >> 32);
+		ERR_FAIL_COND(!validator->compare_exchange_strong(expected, INVALID_VALIDATOR, std::memory_order_acq_rel));
 
-		alloc_count--;
-		free_list_chunks[alloc_count / elements_in_chunk][alloc_count % elements_in_chunk] = idx;
+		t->chunks[idx / elements_in_chunk][idx % elements_in_chunk].~T();
 
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
+		alloc_count.fetch_sub(1, std::memory_order_relaxed);
+		_free_index(idx);
 	}
 
 	_FORCE_INLINE_ uint32_t get_rid_count() const {
-		return alloc_count;
+		return alloc_count.load(std::memory_order_relaxed);
 	}
 
+	// Allocated indices aren't kept contiguous anywhere, so these look the
+	// index up by scanning.
 	_FORCE_INLINE_ T *get_ptr_by_index(uint32_t p_index) {
-		ERR_FAIL_INDEX_V(p_index, alloc_count, nullptr);
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
-		uint64_t idx = free_list_chunks[p_index / elements_in_chunk][p_index % elements_in_chunk];
-		T *ptr = &chunks[idx / elements_in_chunk][idx % elements_in_chunk];
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
-		return ptr;
+		ERR_FAIL_INDEX_V(p_index, get_rid_count(), nullptr);
+		uint32_t idx = _find_index(p_index);
+		ERR_FAIL_COND_V(idx == INVALID_VALIDATOR, nullptr);
+		const ChunkTable *t = table.load(std::memory_order_acquire);
+		return &t->chunks[idx / elements_in_chunk][idx % elements_in_chunk];
 	}
 
 	_FORCE_INLINE_ RID get_rid_by_index(uint32_t p_index) {
-		ERR_FAIL_INDEX_V(p_index, alloc_count, RID());
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
-		uint64_t idx = free_list_chunks[p_index / elements_in_chunk][p_index % elements_in_chunk];
-		uint64_t validator = validator_chunks[idx / elements_in_chunk][idx % elements_in_chunk];
+		ERR_FAIL_INDEX_V(p_index, get_rid_count(), RID());
+		uint32_t idx = _find_index(p_index);
+		ERR_FAIL_COND_V(idx == INVALID_VALIDATOR, RID());
+		const ChunkTable *t = table.load(std::memory_order_acquire);
+		uint64_t validator = t->validator_chunks[idx / elements_in_chunk][idx % elements_in_chunk].load(std::memory_order_acquire);
 
-		RID rid = _make_from_id((validator << 32) | idx);
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
-		return rid;
+		return _make_from_id((validator << 32) | idx);
 	}
 
 	void get_owned_list(List<RID> *p_owned) {
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
-		for (size_t i = 0; i < max_alloc; i++) {
-			uint64_t validator = validator_chunks[i / elements_in_chunk][i % elements_in_chunk];
-			if (validator != 0xFFFFFFFF) {
+		const ChunkTable *t = table.load(std::memory_order_acquire);
+		uint32_t count = t->chunk_count.load(std::memory_order_acquire) * elements_in_chunk;
+		for (uint32_t i = 0; i < count; i++) {
+			uint64_t validator = t->validator_chunks[i / elements_in_chunk][i % elements_in_chunk].load(std::memory_order_acquire);
+			if (validator != INVALID_VALIDATOR) {
 				p_owned->push_back(_make_from_id((validator << 32) | i));
 			}
 		}
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
 	}
 
 	void set_description(const char *p_descrption) {
@@ -288,47 +383,71 @@ public:
 	}
 
 	RID_Alloc(uint32_t p_target_chunk_byte_size = 4096) {
-		chunks = nullptr;
+		ChunkTable *t = memnew(ChunkTable);
+		t->chunks = nullptr;
+		t->validator_chunks = nullptr;
+		t->chunk_count.store(0);
+		t->chunk_capacity = 0;
+		t->retired = nullptr;
+		table.store(t);
+
 		free_list_chunks = nullptr;
-		validator_chunks = nullptr;
+		free_lists = THREAD_SAFE ? memnew_arr(FreeList, FREE_LIST_COUNT) : nullptr;
 
 		elements_in_chunk = sizeof(T) > p_target_chunk_byte_size ? 1 : (p_target_chunk_byte_size / sizeof(T));
 		max_alloc = 0;
-		alloc_count = 0;
+		alloc_count.store(0);
 		description = nullptr;
 	}
 
 	~RID_Alloc() {
-		if (alloc_count) {
+		ChunkTable *t = table.load();
+		uint32_t chunk_count = t->chunk_count.load();
+
+		if (alloc_count.load()) {
 			if (description) {
-				print_error("ERROR: " + itos(alloc_count) + " RID allocations of type '" + description + "' were leaked at exit.");
+				print_error("ERROR: " + itos(alloc_count.load()) + " RID allocations of type '" + description + "' were leaked at exit.");
 			} else {
 #ifdef NO_SAFE_CAST
-				print_error("ERROR: " + itos(alloc_count) + " RID allocations of type 'unknown' were leaked at exit.");
+				print_error("ERROR: " + itos(alloc_count.load()) + " RID allocations of type 'unknown' were leaked at exit.");
 #else
-				print_error("ERROR: " + itos(alloc_count) + " RID allocations of type '" + typeid(T).name() + "' were leaked at exit.");
+				print_error("ERROR: " + itos(alloc_count.load()) + " RID allocations of type '" + typeid(T).name() + "' were leaked at exit.");
 #endif
 			}
 
 			for (size_t i = 0; i < max_alloc; i++) {
-				uint64_t validator = validator_chunks[i / elements_in_chunk][i % elements_in_chunk];
-				if (validator != 0xFFFFFFFF) {
-					chunks[i / elements_in_chunk][i % elements_in_chunk].~T();
+				uint32_t validator = t->validator_chunks[i / elements_in_chunk][i % elements_in_chunk].load();
+				if (validator != INVALID_VALIDATOR) {
+					t->chunks[i / elements_in_chunk][i % elements_in_chunk].~T();
 				}
 			}
 		}
 
-		uint32_t chunk_count = max_alloc / elements_in_chunk;
 		for (uint32_t i = 0; i < chunk_count; i++) {
-			memfree(chunks[i]);
-			memfree(validator_chunks[i]);
-			memfree(free_list_chunks[i]);
+			memfree(t->chunks[i]);
+			memfree(t->validator_chunks[i]);
+			if (free_list_chunks) {
+				memfree(free_list_chunks[i]);
+			}
 		}
 
-		if (chunks) {
-			memfree(chunks);
+		if (free_list_chunks) {
 			memfree(free_list_chunks);
-			memfree(validator_chunks);
+		}
+
+		if (free_lists) {
+			for (uint32_t i = 0; i < FREE_LIST_COUNT; i++) {
+				if (free_lists[i].indices) {
+					memfree(free_lists[i].indices);
+				}
+			}
+			memdelete_arr(free_lists);
+		}
+
+		while (t) {
+			ChunkTable *retired = t->retired;
+			_free_table(t);
+			t = retired;
 		}
 	}
 };
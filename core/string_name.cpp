@@ -39,7 +39,7 @@ StaticCString StaticCString::create(const char *p_ptr) {
 	return scs;
 }
 
-StringName::_Data *StringName::_table[STRING_TABLE_LEN];
+StringName::_Shard StringName::_shards[SHARD_COUNT];
 
 StringName _scs_create(const char *p_chr) {
 
@@ -47,67 +47,275 @@ StringName _scs_create(const char *p_chr) {
 }
 
 bool StringName::configured = false;
-Mutex StringName::mutex;
+
+// Direct mapped per-thread caches in front of the shared tables, one for
+// names looked up by hash and one for static C strings looked up by address
+// (no hashing nor comparing needed). Each entry holds a reference, so a hit
+// only has to bump the refcount of a name that is certainly alive.
+struct StringNameThreadCache {
+	enum {
+		SIZE = 256,
+		MASK = SIZE - 1,
+	};
+
+	struct Entry {
+		uint32_t hash;
+		StringName::_Data *data;
+	};
+
+	struct StaticEntry {
+		const char *ptr;
+		StringName::_Data *data;
+	};
+
+	Entry names[SIZE] = {};
+	StaticEntry static_names[SIZE] = {};
+
+	_FORCE_INLINE_ void cache(Entry &p_entry, uint32_t p_hash, StringName::_Data *p_data) {
+		p_data->refcount.ref(); // Can't fail, the caller holds a reference.
+		StringName::_Data *old = p_entry.data;
+		p_entry.hash = p_hash;
+		p_entry.data = p_data;
+		if (old) {
+			StringName::_unref_data(old);
+		}
+	}
+
+	_FORCE_INLINE_ void cache(StaticEntry &p_entry, const char *p_ptr, StringName::_Data *p_data) {
+		p_data->refcount.ref();
+		StringName::_Data *old = p_entry.data;
+		p_entry.ptr = p_ptr;
+		p_entry.data = p_data;
+		if (old) {
+			StringName::_unref_data(old);
+		}
+	}
+
+	void clear() {
+		for (int i = 0; i < SIZE; i++) {
+			if (names[i].data) {
+				StringName::_unref_data(names[i].data);
+				names[i].data = nullptr;
+			}
+			if (static_names[i].data) {
+				StringName::_unref_data(static_names[i].data);
+				static_names[i].data = nullptr;
+				static_names[i].ptr = nullptr;
+			}
+		}
+	}
+
+	~StringNameThreadCache() {
+		// Threads still running at exit outlive the tables, their names were freed by cleanup().
+		if (StringName::_shards[0].buckets) {
+			clear();
+		}
+	}
+};
+
+static thread_local StringNameThreadCache thread_cache;
 
 void StringName::setup() {
 
 	ERR_FAIL_COND(configured);
-	for (int i = 0; i < STRING_TABLE_LEN; i++) {
+	for (int i = 0; i < SHARD_COUNT; i++) {
 
-		_table[i] = nullptr;
+		_shards[i].buckets = memnew_arr(_Data *, SHARD_MIN_BUCKETS);
+		_shards[i].bucket_mask = SHARD_MIN_BUCKETS - 1;
+		_shards[i].count = 0;
+		for (int j = 0; j < SHARD_MIN_BUCKETS; j++) {
+			_shards[i].buckets[j] = nullptr;
+		}
 	}
 	configured = true;
 }
 
 void StringName::cleanup() {
 
-	MutexLock lock(mutex);
+	thread_cache.clear();
 
 	int lost_strings = 0;
-	for (int i = 0; i < STRING_TABLE_LEN; i++) {
+	for (int i = 0; i < SHARD_COUNT; i++) {
 
-		while (_table[i]) {
+		_Shard &shard = _shards[i];
+		shard.lock.lock();
 
-			_Data *d = _table[i];
-			lost_strings++;
-			if (OS::get_singleton()->is_stdout_verbose()) {
-				if (d->cname) {
-					print_line("Orphan StringName: " + String(d->cname));
-				} else {
-					print_line("Orphan StringName: " + String(d->name));
+		for (uint32_t j = 0; j <= shard.bucket_mask; j++) {
+
+			while (shard.buckets[j]) {
+
+				_Data *d = shard.buckets[j];
+				lost_strings++;
+				if (OS::get_singleton()->is_stdout_verbose()) {
+					if (d->cname) {
+						print_line("Orphan StringName: " + String(d->cname));
+					} else {
+						print_line("Orphan StringName: " + String(d->name));
+					}
 				}
-			}
 
-			_table[i] = _table[i]->next;
-			memdelete(d);
+				shard.buckets[j] = d->next;
+				memdelete(d);
+			}
 		}
+
+		memdelete_arr(shard.buckets);
+		shard.buckets = nullptr;
+		shard.bucket_mask = 0;
+		shard.count = 0;
+		shard.lock.unlock();
 	}
 	if (lost_strings) {
 		print_verbose("StringName: " + itos(lost_strings) + " unclaimed string names at exit.");
 	}
 }
 
-void StringName::unref() {
+// Returns a referenced entry for p_name in p_shard, if any is alive. Must be called with the shard locked.
+template <class T>
+StringName::_Data *StringName::_find(_Shard &p_shard, const T &p_name, uint32_t p_hash) {
 
-	ERR_FAIL_COND(!configured);
+	_Data *d = p_shard.buckets[(p_hash >> SHARD_BITS) & p_shard.bucket_mask];
+
+	while (d) {
 
-	if (_data && _data->refcount.unref()) {
+		// compare hash first
+		// an entry whose last reference is being dropped can't be referenced,
+		// a new one is added next to it instead.
+		if (d->hash == p_hash && d->is_name(p_name) && d->refcount.ref()) {
+			return d;
+		}
+		d = d->next;
+	}
+
+	return nullptr;
+}
+
+// Must be called with the shard locked.
+void StringName::_insert(_Shard &p_shard, _Data *p_data) {
 
-		MutexLock lock(mutex);
+	if (p_shard.count > p_shard.bucket_mask) {
+		// Keep chains short, grow once there are more names than buckets.
+		uint32_t new_mask = (p_shard.bucket_mask << 1) | 1;
+		_Data **new_buckets = memnew_arr(_Data *, new_mask + 1);
+		for (uint32_t i = 0; i <= new_mask; i++) {
+			new_buckets[i] = nullptr;
+		}
 
-		if (_data->prev) {
-			_data->prev->next = _data->next;
-		} else {
-			if (_table[_data->idx] != _data) {
-				ERR_PRINT("BUG!");
+		for (uint32_t i = 0; i <= p_shard.bucket_mask; i++) {
+			_Data *d = p_shard.buckets[i];
+			while (d) {
+				_Data *next = d->next;
+				uint32_t idx = (d->hash >> SHARD_BITS) & new_mask;
+				d->prev = nullptr;
+				d->next = new_buckets[idx];
+				if (new_buckets[idx]) {
+					new_buckets[idx]->prev = d;
+				}
+				new_buckets[idx] = d;
+				d = next;
 			}
-			_table[_data->idx] = _data->next;
 		}
 
-		if (_data->next) {
-			_data->next->prev = _data->prev;
+		memdelete_arr(p_shard.buckets);
+		p_shard.buckets = new_buckets;
+		p_shard.bucket_mask = new_mask;
+	}
+
+	uint32_t idx = (p_data->hash >> SHARD_BITS) & p_shard.bucket_mask;
+	p_data->prev = nullptr;
+	p_data->next = p_shard.buckets[idx];
+	if (p_shard.buckets[idx]) {
+		p_shard.buckets[idx]->prev = p_data;
+	}
+	p_shard.buckets[idx] = p_data;
+	p_shard.count++;
+}
+
+template <class T>
+StringName::_Data *StringName::_intern(const T &p_name, uint32_t p_hash, const char *p_static_name) {
+
+	_Shard &shard = _shards[p_hash & SHARD_MASK];
+
+	shard.lock.lock();
+	_Data *d = _find(shard, p_name, p_hash);
+	shard.lock.unlock();
+
+	if (d) {
+		// exists
+		return d;
+	}
+
+	// Allocate outside of the lock, then check again in case another thread added it meanwhile.
+	_Data *new_data = memnew(_Data);
+	if (p_static_name) {
+		new_data->cname = p_static_name;
+	} else {
+		new_data->name = p_name;
+	}
+	new_data->refcount.init();
+	new_data->hash = p_hash;
+
+	shard.lock.lock();
+	d = _find(shard, p_name, p_hash);
+	if (!d) {
+		_insert(shard, new_data);
+	}
+	shard.lock.unlock();
+
+	if (d) {
+		memdelete(new_data);
+		return d;
+	}
+	return new_data;
+}
+
+template <class T>
+StringName::_Data *StringName::_search(const T &p_name, uint32_t p_hash) {
+
+	_Shard &shard = _shards[p_hash & SHARD_MASK];
+
+	shard.lock.lock();
+	_Data *d = _find(shard, p_name, p_hash);
+	shard.lock.unlock();
+
+	return d;
+}
+
+void StringName::_unref_data(_Data *p_data) {
+
+	if (!p_data->refcount.unref()) {
+		return;
+	}
+
+	_Shard &shard = _shards[p_data->hash & SHARD_MASK];
+	shard.lock.lock();
+
+	if (p_data->prev) {
+		p_data->prev->next = p_data->next;
+	} else {
+		uint32_t idx = (p_data->hash >> SHARD_BITS) & shard.bucket_mask;
+		if (shard.buckets[idx] != p_data) {
+			ERR_PRINT("BUG!");
 		}
-		memdelete(_data);
+		shard.buckets[idx] = p_data->next;
+	}
+
+	if (p_data->next) {
+		p_data->next->prev = p_data->prev;
+	}
+	shard.count--;
+
+	shard.lock.unlock();
+
+	memdelete(p_data);
+}
+
+void StringName::unref() {
+
+	ERR_FAIL_COND(!configured);
+
+	if (_data) {
+		_unref_data(_data);
 	}
 
 	_data = nullptr;
@@ -178,40 +386,17 @@ StringName::StringName(const char *p_name) {
 	if (!p_name || p_name[0] == 0)
 		return; //empty, ignore
 
-	MutexLock lock(mutex);
-
 	uint32_t hash = String::hash(p_name);
 
-	uint32_t idx = hash & STRING_TABLE_MASK;
-
-	_data = _table[idx];
-
-	while (_data) {
-
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_name)
-			break;
-		_data = _data->next;
-	}
-
-	if (_data) {
-		if (_data->refcount.ref()) {
-			// exists
-			return;
-		}
+	StringNameThreadCache::Entry &entry = thread_cache.names[(hash >> SHARD_BITS) & StringNameThreadCache::MASK];
+	if (entry.data && entry.hash == hash && entry.data->is_name(p_name)) {
+		entry.data->refcount.ref();
+		_data = entry.data;
+		return;
 	}
 
-	_data = memnew(_Data);
-	_data->name = p_name;
-	_data->refcount.init();
-	_data->hash = hash;
-	_data->idx = idx;
-	_data->cname = nullptr;
-	_data->next = _table[idx];
-	_data->prev = nullptr;
-	if (_table[idx])
-		_table[idx]->prev = _data;
-	_table[idx] = _data;
+	_data = _intern(p_name, hash, nullptr);
+	thread_cache.cache(entry, hash, _data);
 }
 
 StringName::StringName(const StaticCString &p_static_string) {
@@ -222,40 +407,18 @@ StringName::StringName(const StaticCString &p_static_string) {
 
 	ERR_FAIL_COND(!p_static_string.ptr || !p_static_string.ptr[0]);
 
-	MutexLock lock(mutex);
-
-	uint32_t hash = String::hash(p_static_string.ptr);
-
-	uint32_t idx = hash & STRING_TABLE_MASK;
-
-	_data = _table[idx];
-
-	while (_data) {
-
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_static_string.ptr)
-			break;
-		_data = _data->next;
+	// Static strings never change, so the address alone identifies the name.
+	StringNameThreadCache::StaticEntry &entry = thread_cache.static_names[(uintptr_t(p_static_string.ptr) >> 3) & StringNameThreadCache::MASK];
+	if (entry.ptr == p_static_string.ptr) {
+		entry.data->refcount.ref();
+		_data = entry.data;
+		return;
 	}
 
-	if (_data) {
-		if (_data->refcount.ref()) {
-			// exists
-			return;
-		}
-	}
+	uint32_t hash = String::hash(p_static_string.ptr);
 
-	_data = memnew(_Data);
-
-	_data->refcount.init();
-	_data->hash = hash;
-	_data->idx = idx;
-	_data->cname = p_static_string.ptr;
-	_data->next = _table[idx];
-	_data->prev = nullptr;
-	if (_table[idx])
-		_table[idx]->prev = _data;
-	_table[idx] = _data;
+	_data = _intern(p_static_string.ptr, hash, p_static_string.ptr);
+	thread_cache.cache(entry, p_static_string.ptr, _data);
 }
 
 StringName::StringName(const String &p_name) {
@@ -267,38 +430,17 @@ StringName::StringName(const String &p_name) {
 	if (p_name == String())
 		return;
 
-	MutexLock lock(mutex);
-
 	uint32_t hash = p_name.hash();
-	uint32_t idx = hash & STRING_TABLE_MASK;
-
-	_data = _table[idx];
-
-	while (_data) {
 
-		if (_data->hash == hash && _data->get_name() == p_name)
-			break;
-		_data = _data->next;
-	}
-
-	if (_data) {
-		if (_data->refcount.ref()) {
-			// exists
-			return;
-		}
+	StringNameThreadCache::Entry &entry = thread_cache.names[(hash >> SHARD_BITS) & StringNameThreadCache::MASK];
+	if (entry.data && entry.hash == hash && entry.data->is_name(p_name)) {
+		entry.data->refcount.ref();
+		_data = entry.data;
+		return;
 	}
 
-	_data = memnew(_Data);
-	_data->name = p_name;
-	_data->refcount.init();
-	_data->hash = hash;
-	_data->idx = idx;
-	_data->cname = nullptr;
-	_data->next = _table[idx];
-	_data->prev = nullptr;
-	if (_table[idx])
-		_table[idx]->prev = _data;
-	_table[idx] = _data;
+	_data = _intern(p_name, hash, nullptr);
+	thread_cache.cache(entry, hash, _data);
 }
 
 StringName StringName::search(const char *p_name) {
@@ -309,23 +451,9 @@ StringName StringName::search(const char *p_name) {
 	if (!p_name[0])
 		return StringName();
 
-	MutexLock lock(mutex);
-
-	uint32_t hash = String::hash(p_name);
-	uint32_t idx = hash & STRING_TABLE_MASK;
-
-	_Data *_data = _table[idx];
-
-	while (_data) {
-
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_name)
-			break;
-		_data = _data->next;
-	}
-
-	if (_data && _data->refcount.ref()) {
-		return StringName(_data);
+	_Data *d = _search(p_name, String::hash(p_name));
+	if (d) {
+		return StringName(d);
 	}
 
 	return StringName(); //does not exist
@@ -339,50 +467,21 @@ StringName StringName::search(const CharType *p_name) {
 	if (!p_name[0])
 		return StringName();
 
-	MutexLock lock(mutex);
-
-	uint32_t hash = String::hash(p_name);
-
-	uint32_t idx = hash & STRING_TABLE_MASK;
-
-	_Data *_data = _table[idx];
-
-	while (_data) {
-
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_name)
-			break;
-		_data = _data->next;
-	}
-
-	if (_data && _data->refcount.ref()) {
-		return StringName(_data);
+	_Data *d = _search(p_name, String::hash(p_name));
+	if (d) {
+		return StringName(d);
 	}
 
 	return StringName(); //does not exist
 }
+
 StringName StringName::search(const String &p_name) {
 
 	ERR_FAIL_COND_V(p_name == "", StringName());
 
-	MutexLock lock(mutex);
-
-	uint32_t hash = p_name.hash();
-
-	uint32_t idx = hash & STRING_TABLE_MASK;
-
-	_Data *_data = _table[idx];
-
-	while (_data) {
-
-		// compare hash first
-		if (_data->hash == hash && p_name == _data->get_name())
-			break;
-		_data = _data->next;
-	}
-
-	if (_data && _data->refcount.ref()) {
-		return StringName(_data);
+	_Data *d = _search(p_name, p_name.hash());
+	if (d) {
+		return StringName(d);
 	}
 
 	return StringName(); //does not exist
@@ -33,6 +33,7 @@
 
 #include "core/os/mutex.h"
 #include "core/safe_refcount.h"
+#include "core/spin_lock.h"
 #include "core/ustring.h"
 
 struct StaticCString {
@@ -43,11 +44,14 @@ struct StaticCString {
 
 class StringName {
 
+	// Names are interned in SHARD_COUNT independent tables picked by the low
+	// bits of the hash, each with its own lock and growing as needed, so
+	// threads building names at the same time rarely contend.
 	enum {
-
-		STRING_TABLE_BITS = 12,
-		STRING_TABLE_LEN = 1 << STRING_TABLE_BITS,
-		STRING_TABLE_MASK = STRING_TABLE_LEN - 1
+		SHARD_BITS = 6,
+		SHARD_COUNT = 1 << SHARD_BITS,
+		SHARD_MASK = SHARD_COUNT - 1,
+		SHARD_MIN_BUCKETS = 64,
 	};
 
 	struct _Data {
@@ -56,19 +60,28 @@ class StringName {
 		String name;
 
 		String get_name() const { return cname ? String(cname) : name; }
-		int idx;
+		// Compare without building a String out of cname.
+		_FORCE_INLINE_ bool is_name(const char *p_name) const { return cname ? strcmp(cname, p_name) == 0 : name == p_name; }
+		_FORCE_INLINE_ bool is_name(const CharType *p_name) const { return cname ? String(cname) == p_name : name == p_name; }
+		_FORCE_INLINE_ bool is_name(const String &p_name) const { return cname ? p_name == cname : name == p_name; }
 		uint32_t hash;
 		_Data *prev;
 		_Data *next;
 		_Data() {
 			cname = nullptr;
 			next = prev = nullptr;
-			idx = 0;
 			hash = 0;
 		}
 	};
 
-	static _Data *_table[STRING_TABLE_LEN];
+	struct _Shard {
+		SpinLock lock;
+		_Data **buckets = nullptr;
+		uint32_t bucket_mask = 0;
+		uint32_t count = 0;
+	};
+
+	static _Shard _shards[SHARD_COUNT];
 
 	_Data *_data;
 
@@ -79,14 +92,23 @@ class StringName {
 	};
 
 	void unref();
+	static void _unref_data(_Data *p_data);
 	friend void register_core_types();
 	friend void unregister_core_types();
+	friend struct StringNameThreadCache;
 
-	static Mutex mutex;
 	static void setup();
 	static void cleanup();
 	static bool configured;
 
+	template <class T>
+	static _Data *_find(_Shard &p_shard, const T &p_name, uint32_t p_hash);
+	static void _insert(_Shard &p_shard, _Data *p_data);
+	template <class T>
+	static _Data *_intern(const T &p_name, uint32_t p_hash, const char *p_static_name);
+	template <class T>
+	static _Data *_search(const T &p_name, uint32_t p_hash);
+
 	StringName(_Data *p_data) { _data = p_data; }
 
 public:
@@ -0,0 +1,453 @@
+/*************************************************************************/
+/*  swiss_hash_map.h                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef SWISS_HASH_MAP_H
+#define SWISS_HASH_MAP_H
+
+#include "core/error_macros.h"
+#include "core/hashfuncs.h"
+#include "core/list.h"
+#include "core/os/memory.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SWISS_HASH_MAP_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SWISS_HASH_MAP_NEON
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/**
+ * An open addressing HashMap that keeps one control byte per slot and probes
+ * groups of 16 slots at a time (SSE2 or NEON when available, scalar code
+ * otherwise), in the style of Google's Swiss tables.
+ *
+ * A control byte is either empty, deleted, or the low 7 bits of the hash of
+ * the key in the slot. A lookup compares those bits against a whole group in
+ * one go and only compares keys on a match, so most probes never touch the
+ * keys at all, and a lookup that misses usually stops at the first group.
+ *
+ * The API mirrors HashMap so it can be swapped in, with one important
+ * difference: keys and values are stored inplace, so inserting (through set()
+ * or operator[]) may move every element. Pointers returned by getptr(),
+ * next() and friends are only valid until the next insertion.
+ */
+
+template <class TKey, class TData, class Hasher = HashMapHasherDefault, class Comparator = HashMapComparatorDefault<TKey>>
+class SwissHashMap {
+public:
+	struct Pair {
+		TKey key;
+		TData data;
+
+		Pair() {}
+		Pair(const TKey &p_key, const TData &p_data) :
+				key(p_key),
+				data(p_data) {
+		}
+	};
+
+private:
+	enum {
+		GROUP_WIDTH = 16,
+		CTRL_EMPTY = 0x80,
+		CTRL_DELETED = 0xFE,
+	};
+
+	// Bit i is set for every matching slot i of a group.
+	struct BitMask {
+		uint32_t mask;
+
+		_FORCE_INLINE_ explicit operator bool() const { return mask != 0; }
+		_FORCE_INLINE_ uint32_t lowest() const {
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return index;
+#else
+			return __builtin_ctz(mask);
+#endif
+		}
+		_FORCE_INLINE_ void clear_lowest() { mask &= mask - 1; }
+	};
+
+	struct Group {
+#if defined(SWISS_HASH_MAP_SSE2)
+		__m128i ctrl;
+
+		_FORCE_INLINE_ explicit Group(const uint8_t *p_ctrl) { ctrl = _mm_loadu_si128((const __m128i *)p_ctrl); }
+		_FORCE_INLINE_ BitMask match(uint8_t p_h2) const {
+			return BitMask{ uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)p_h2)))) };
+		}
+		_FORCE_INLINE_ BitMask match_empty() const {
+			return BitMask{ uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)CTRL_EMPTY)))) };
+		}
+		// Empty and deleted are the only control bytes with the high bit set.
+		_FORCE_INLINE_ BitMask match_empty_or_deleted() const {
+			return BitMask{ uint32_t(_mm_movemask_epi8(ctrl)) };
+		}
+#elif defined(SWISS_HASH_MAP_NEON)
+		uint8x16_t ctrl;
+
+		static _FORCE_INLINE_ BitMask _to_mask(uint8x16_t p_cmp) {
+			static const uint8_t bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+			uint8x16_t masked = vandq_u8(p_cmp, vld1q_u8(bits));
+			return BitMask{ uint32_t(vaddv_u8(vget_low_u8(masked))) | (uint32_t(vaddv_u8(vget_high_u8(masked))) << 8) };
+		}
+
+		_FORCE_INLINE_ explicit Group(const uint8_t *p_ctrl) { ctrl = vld1q_u8(p_ctrl); }
+		_FORCE_INLINE_ BitMask match(uint8_t p_h2) const { return _to_mask(vceqq_u8(ctrl, vdupq_n_u8(p_h2))); }
+		_FORCE_INLINE_ BitMask match_empty() const { return _to_mask(vceqq_u8(ctrl, vdupq_n_u8(CTRL_EMPTY))); }
+		_FORCE_INLINE_ BitMask match_empty_or_deleted() const { return _to_mask(vcltzq_s8(vreinterpretq_s8_u8(ctrl))); }
+#else
+		const uint8_t *ctrl;
+
+		_FORCE_INLINE_ explicit Group(const uint8_t *p_ctrl) { ctrl = p_ctrl; }
+		_FORCE_INLINE_ BitMask match(uint8_t p_h2) const {
+			uint32_t mask = 0;
+			for (uint32_t i = 0; i < GROUP_WIDTH; i++) {
+				mask |= uint32_t(ctrl[i] == p_h2) << i;
+			}
+			return BitMask{ mask };
+		}
+		_FORCE_INLINE_ BitMask match_empty() const { return match(CTRL_EMPTY); }
+		_FORCE_INLINE_ BitMask match_empty_or_deleted() const {
+			uint32_t mask = 0;
+			for (uint32_t i = 0; i < GROUP_WIDTH; i++) {
+				mask |= uint32_t(ctrl[i] >> 7) << i;
+			}
+			return BitMask{ mask };
+		}
+#endif
+	};
+
+	uint8_t *ctrl = nullptr;
+	Pair *slots = nullptr;
+	uint32_t capacity = 0; // Zero or a power of two, at least GROUP_WIDTH.
+	uint32_t elements = 0;
+	uint32_t growth_left = 0; // Empty slots that may still be filled before rehashing.
+
+	// Hashers return identity hashes for integers, mix them so that both the
+	// group index and the 7 control bits are well distributed.
+	static _FORCE_INLINE_ uint32_t _hash(const TKey &p_key) {
+		uint32_t h = Hasher::hash(p_key);
+		h ^= h >> 16;
+		h *= 0x85ebca6b;
+		h ^= h >> 13;
+		h *= 0xc2b2ae35;
+		h ^= h >> 16;
+		return h;
+	}
+
+	static _FORCE_INLINE_ uint32_t _max_load(uint32_t p_capacity) { return p_capacity - p_capacity / 8; }
+
+	// Probes groups in triangular steps, which visits every group of a power
+	// of two table.
+	_FORCE_INLINE_ int64_t _find(const TKey &p_key, uint32_t p_hash) const {
+		if (unlikely(!capacity)) {
+			return -1;
+		}
+		uint32_t group_mask = capacity / GROUP_WIDTH - 1;
+		uint32_t group = (p_hash >> 7) & group_mask;
+		uint8_t h2 = p_hash & 0x7F;
+		for (uint32_t step = 1;; step++) {
+			Group g(ctrl + group * GROUP_WIDTH);
+			for (BitMask m = g.match(h2); m; m.clear_lowest()) {
+				uint32_t index = group * GROUP_WIDTH + m.lowest();
+				if (likely(Comparator::compare(slots[index].key, p_key))) {
+					return index;
+				}
+			}
+			// A group with an empty slot never overflowed, so the key can't be further along.
+			if (likely(g.match_empty())) {
+				return -1;
+			}
+			group = (group + step) & group_mask;
+		}
+	}
+
+	_FORCE_INLINE_ uint32_t _find_insert_slot(uint32_t p_hash) const {
+		uint32_t group_mask = capacity / GROUP_WIDTH - 1;
+		uint32_t group = (p_hash >> 7) & group_mask;
+		for (uint32_t step = 1;; step++) {
+			BitMask m = Group(ctrl + group * GROUP_WIDTH).match_empty_or_deleted();
+			if (m) {
+				return group * GROUP_WIDTH + m.lowest();
+			}
+			group = (group + step) & group_mask;
+		}
+	}
+
+	void _allocate(uint32_t p_capacity) {
+		capacity = p_capacity;
+		uint32_t slots_offset = (capacity + alignof(Pair) - 1) & ~uint32_t(alignof(Pair) - 1);
+		ctrl = (uint8_t *)Memory::alloc_static(slots_offset + sizeof(Pair) * capacity);
+		slots = (Pair *)(ctrl + slots_offset);
+		memset(ctrl, CTRL_EMPTY, capacity);
+		growth_left = _max_load(capacity) - elements;
+	}
+
+	void _free() {
+		if (!ctrl) {
+			return;
+		}
+		for (uint32_t i = 0; i < capacity; i++) {
+			if (ctrl[i] < CTRL_EMPTY) {
+				slots[i].~Pair();
+			}
+		}
+		Memory::free_static(ctrl);
+		ctrl = nullptr;
+		slots = nullptr;
+		capacity = 0;
+	}
+
+	void _rehash(uint32_t p_capacity) {
+		uint8_t *old_ctrl = ctrl;
+		Pair *old_slots = slots;
+		uint32_t old_capacity = capacity;
+
+		_allocate(p_capacity);
+
+		for (uint32_t i = 0; i < old_capacity; i++) {
+			if (old_ctrl[i] >= CTRL_EMPTY) {
+				continue;
+			}
+			uint32_t index = _find_insert_slot(_hash(old_slots[i].key));
+			ctrl[index] = old_ctrl[i];
+			memnew_placement(&slots[index], Pair(old_slots[i]));
+			old_slots[i].~Pair();
+		}
+
+		if (old_ctrl) {
+			Memory::free_static(old_ctrl);
+		}
+	}
+
+	static uint32_t _capacity_for(uint32_t p_elements) {
+		uint32_t new_capacity = GROUP_WIDTH;
+		while (_max_load(new_capacity) < p_elements) {
+			new_capacity <<= 1;
+		}
+		return new_capacity;
+	}
+
+	// Returns the slot of p_key, inserting it with a default value if missing.
+	uint32_t _find_or_insert(const TKey &p_key) {
+		uint32_t hash = _hash(p_key);
+		int64_t found = _find(p_key, hash);
+		if (found >= 0) {
+			return found;
+		}
+
+		uint32_t index = capacity ? _find_insert_slot(hash) : 0;
+		if (unlikely(!capacity || (growth_left == 0 && ctrl[index] == CTRL_EMPTY))) {
+			// Out of empty slots. If half of the load is tombstones, clean
+			// them up in place rather than growing.
+			_rehash(capacity && elements < _max_load(capacity) / 2 ? capacity : _capacity_for(elements + 1));
+			index = _find_insert_slot(hash);
+		}
+
+		if (ctrl[index] == CTRL_EMPTY) {
+			growth_left--;
+		}
+		ctrl[index] = hash & 0x7F;
+		memnew_placement(&slots[index], Pair(p_key, TData()));
+		elements++;
+		return index;
+	}
+
+	void _copy_from(const SwissHashMap &p_map) {
+		elements = 0;
+		if (!p_map.elements) {
+			return;
+		}
+		_allocate(_capacity_for(p_map.elements));
+		for (uint32_t i = 0; i < p_map.capacity; i++) {
+			if (p_map.ctrl[i] >= CTRL_EMPTY) {
+				continue;
+			}
+			uint32_t index = _find_insert_slot(_hash(p_map.slots[i].key));
+			ctrl[index] = p_map.ctrl[i];
+			memnew_placement(&slots[index], Pair(p_map.slots[i]));
+			growth_left--;
+		}
+		elements = p_map.elements;
+	}
+
+public:
+	void set(const TKey &p_key, const TData &p_data) {
+		uint32_t index = _find_or_insert(p_key); // Before reading slots, inserting may rehash.
+		slots[index].data = p_data;
+	}
+
+	void set(const Pair &p_pair) {
+		set(p_pair.key, p_pair.data);
+	}
+
+	_FORCE_INLINE_ bool has(const TKey &p_key) const {
+		return _find(p_key, _hash(p_key)) >= 0;
+	}
+
+	const TData &get(const TKey &p_key) const {
+		const TData *res = getptr(p_key);
+		CRASH_COND_MSG(!res, "SwissHashMap key not found.");
+		return *res;
+	}
+
+	TData &get(const TKey &p_key) {
+		TData *res = getptr(p_key);
+		CRASH_COND_MSG(!res, "SwissHashMap key not found.");
+		return *res;
+	}
+
+	_FORCE_INLINE_ TData *getptr(const TKey &p_key) {
+		int64_t index = _find(p_key, _hash(p_key));
+		return index >= 0 ? &slots[index].data : nullptr;
+	}
+
+	_FORCE_INLINE_ const TData *getptr(const TKey &p_key) const {
+		int64_t index = _find(p_key, _hash(p_key));
+		return index >= 0 ? &slots[index].data : nullptr;
+	}
+
+	bool erase(const TKey &p_key) {
+		int64_t index = _find(p_key, _hash(p_key));
+		if (index < 0) {
+			return false;
+		}
+
+		slots[index].~Pair();
+		elements--;
+
+		// If the group still has an empty slot no probe ever went past it,
+		// so the slot can become empty again instead of a tombstone.
+		uint32_t group = uint32_t(index) & ~uint32_t(GROUP_WIDTH - 1);
+		if (Group(ctrl + group).match_empty()) {
+			ctrl[index] = CTRL_EMPTY;
+			growth_left++;
+		} else {
+			ctrl[index] = CTRL_DELETED;
+		}
+		return true;
+	}
+
+	inline const TData &operator[](const TKey &p_key) const {
+		return get(p_key);
+	}
+
+	inline TData &operator[](const TKey &p_key) {
+		uint32_t index = _find_or_insert(p_key);
+		return slots[index].data;
+	}
+
+	/**
+	 * Iterates the keys in table order, pass nullptr to get the first one.
+	 * p_key is normally a pointer returned by a previous call, but any key
+	 * in the map works too.
+	 */
+	const TKey *next(const TKey *p_key) const {
+		uint32_t index = 0;
+		if (p_key) {
+			const uint8_t *first = (const uint8_t *)&slots[0].key;
+			if ((const uint8_t *)p_key >= first && (const uint8_t *)p_key < first + sizeof(Pair) * capacity) {
+				index = ((const uint8_t *)p_key - first) / sizeof(Pair) + 1;
+			} else {
+				int64_t found = _find(*p_key, _hash(*p_key));
+				ERR_FAIL_COND_V(found < 0, nullptr);
+				index = found + 1;
+			}
+		}
+		for (; index < capacity; index++) {
+			if (ctrl[index] < CTRL_EMPTY) {
+				return &slots[index].key;
+			}
+		}
+		return nullptr;
+	}
+
+	inline unsigned int size() const {
+		return elements;
+	}
+
+	inline bool empty() const {
+		return elements == 0;
+	}
+
+	_FORCE_INLINE_ uint32_t get_capacity() const { return capacity; }
+
+	void clear() {
+		_free();
+		elements = 0;
+		growth_left = 0;
+	}
+
+	// Makes room for p_elements without further rehashing.
+	void reserve(uint32_t p_elements) {
+		uint32_t new_capacity = _capacity_for(p_elements);
+		if (new_capacity > capacity) {
+			_rehash(new_capacity);
+		}
+	}
+
+	void get_key_list(List<TKey> *p_keys) const {
+		for (uint32_t i = 0; i < capacity; i++) {
+			if (ctrl[i] < CTRL_EMPTY) {
+				p_keys->push_back(slots[i].key);
+			}
+		}
+	}
+
+	void operator=(const SwissHashMap &p_map) {
+		if (this == &p_map) {
+			return;
+		}
+		clear();
+		_copy_from(p_map);
+	}
+
+	SwissHashMap() {}
+
+	SwissHashMap(const SwissHashMap &p_map) {
+		_copy_from(p_map);
+	}
+
+	~SwissHashMap() {
+		_free();
+	}
+};
+
+#endif // SWISS_HASH_MAP_H
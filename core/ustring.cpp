@@ -233,19 +233,7 @@ bool String::operator==(const String &p_str) const {
 	if (empty())
 		return true;
 
-	int l = length();
-
-	const CharType *src = c_str();
-	const CharType *dst = p_str.c_str();
-
-	/* Compare char by char */
-	for (int i = 0; i < l; i++) {
-
-		if (src[i] != dst[i])
-			return false;
-	}
-
-	return true;
+	return memcmp(c_str(), p_str.c_str(), length() * sizeof(CharType)) == 0;
 }
 
 bool String::operator!=(const String &p_str) const {
@@ -255,8 +243,22 @@ bool String::operator!=(const String &p_str) const {
 
 String String::operator+(const String &p_str) const {
 
-	String res = *this;
-	res += p_str;
+	if (p_str.empty())
+		return *this;
+	if (empty())
+		return p_str;
+
+	// Build the result in one allocation, rather than copying this string
+	// and then growing the copy.
+	int l = length();
+	int r = p_str.length();
+
+	String res;
+	res.resize(l + r + 1);
+	CharType *dst = res.ptrw();
+	memcpy(dst, c_str(), l * sizeof(CharType));
+	memcpy(dst + l, p_str.c_str(), (r + 1) * sizeof(CharType));
+
 	return res;
 }
 
@@ -279,16 +281,13 @@ String &String::operator+=(const String &p_str) {
 		return *this;
 
 	int from = length();
+	int count = p_str.size(); // includes the terminating zero
 
-	resize(length() + p_str.size());
+	resize(from + count);
 
-	const CharType *src = p_str.c_str();
 	CharType *dst = ptrw();
-
-	set(length(), 0);
-
-	for (int i = 0; i < p_str.length(); i++)
-		dst[from + i] = src[i];
+	const CharType *src = &p_str == this ? dst : p_str.c_str();
+	memmove(dst + from, src, count * sizeof(CharType));
 
 	return *this;
 }
@@ -301,9 +300,12 @@ String &String::operator+=(const CharType *p_str) {
 
 String &String::operator+=(CharType p_char) {
 
-	resize(size() ? size() + 1 : 2);
-	set(length(), 0);
-	set(length() - 1, p_char);
+	int from = length();
+
+	resize(from + 2);
+	CharType *dst = ptrw();
+	dst[from] = p_char;
+	dst[from + 1] = 0;
 
 	return *this;
 }
@@ -322,12 +324,10 @@ String &String::operator+=(const char *p_str) {
 
 	resize(from + src_len + 1);
 
-	CharType *dst = ptrw();
-
-	set(length(), 0);
+	CharType *dst = ptrw() + from;
 
-	for (int i = 0; i < src_len; i++)
-		dst[from + i] = p_str[i];
+	for (int i = 0; i <= src_len; i++)
+		dst[i] = p_str[i];
 
 	return *this;
 }
@@ -2215,8 +2215,19 @@ bool operator==(const char *p_chr, const String &p_str) {
 
 String operator+(const char *p_chr, const String &p_str) {
 
-	String tmp = p_chr;
-	tmp += p_str;
+	int l = p_chr ? strlen(p_chr) : 0;
+	if (l == 0)
+		return p_str;
+
+	int r = p_str.length();
+
+	String tmp;
+	tmp.resize(l + r + 1);
+	CharType *dst = tmp.ptrw();
+	for (int i = 0; i < l; i++)
+		dst[i] = p_chr[i];
+	memcpy(dst + l, p_str.c_str(), (r + 1) * sizeof(CharType));
+
 	return tmp;
 }
 String operator+(CharType p_chr, const String &p_str) {
@@ -123,6 +123,10 @@ struct StrRange {
 	}
 };
 
+// One reference counted UTF-32 buffer behind a single pointer. Copies are cheap,
+// and ptr() is contiguous CharType storage, which much of the engine relies on.
+// There is no small string buffer: at 4 bytes per character, the 16 bytes a
+// Variant has for its value would hold 3 characters.
 class String {
 
 	CowData<CharType> _cowdata;
@@ -127,6 +127,9 @@ public:
 
 private:
 	friend struct _VariantCall;
+	template <class T>
+	friend struct VariantInternalAccessor;
+	friend struct VariantInternal;
 	// Variant takes 20 bytes when real_t is float, and 36 if double
 	// it only allocates extra memory for aabb/matrix.
 
@@ -417,6 +420,14 @@ public:
 		return res;
 	}
 
+	// Validated evaluators skip the type dispatch of evaluate() and can't fail,
+	// so callers that know the operand types can resolve one ahead of time and cache it.
+	// Returns nullptr when the combination must go through evaluate(). Unary
+	// operators ignore p_type_b.
+	typedef void (*ValidatedOperatorEvaluator)(const Variant *p_left, const Variant *p_right, Variant *r_ret);
+	static ValidatedOperatorEvaluator get_validated_operator_evaluator(Operator p_op, Type p_type_a, Type p_type_b);
+	static Type get_operator_return_type(Operator p_op, Type p_type_a, Type p_type_b);
+
 	void zero();
 	Variant duplicate(bool deep = false) const;
 	static void blend(const Variant &a, const Variant &b, float c, Variant &r_dst);
@@ -431,6 +442,17 @@ public:
 
 	static Variant construct(const Variant::Type, const Variant **p_args, int p_argcount, Callable::CallError &r_error, bool p_strict = true);
 
+	// Validated calls skip the method lookup and the argument checks and conversions
+	// of call(), so callers can resolve them once and cache them. p_self must hold
+	// the builtin type and p_args every declared argument with exactly the declared
+	// type, defaults included. r_ret is left untouched by methods with no return value.
+	typedef void (*ValidatedBuiltInMethod)(Variant &r_ret, Variant &p_self, const Variant **p_args);
+	// Same, with pointers to the raw values encoded as in MethodBind::ptrcall().
+	// Only available for the math types' methods, nullptr otherwise.
+	typedef void (*PTRBuiltInMethod)(void *p_self, const void **p_args, void *r_ret);
+	static ValidatedBuiltInMethod get_validated_builtin_method(Variant::Type p_type, const StringName &p_method);
+	static PTRBuiltInMethod get_ptr_builtin_method(Variant::Type p_type, const StringName &p_method);
+
 	void get_method_list(List<MethodInfo> *p_list) const;
 	bool has_method(const StringName &p_method) const;
 	static Vector<Variant::Type> get_method_argument_types(Variant::Type p_type, const StringName &p_method);
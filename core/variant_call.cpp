@@ -35,12 +35,104 @@
 #include "core/crypto/crypto_core.h"
 #include "core/debugger/engine_debugger.h"
 #include "core/io/compression.h"
+#include "core/method_ptrcall.h"
 #include "core/object.h"
 #include "core/os/os.h"
+#include "core/variant_internal.h"
 
 typedef void (*VariantFunc)(Variant &r_ret, Variant &p_self, const Variant **p_args);
 typedef void (*VariantConstructFunc)(Variant &r_ret, const Variant **p_args);
 
+// Typed bindings of builtin methods, generated from the member function pointer.
+// They back the validated and ptrcall paths, which skip the argument checks and
+// conversions of call(), so they are only registered for methods whose declared
+// argument types match the C++ signature exactly (see add_typed_method()).
+
+template <class M, M m_method>
+struct _VariantTypedMethod;
+
+#ifdef PTRCALL_ENABLED
+#define TYPED_METHOD_PTRCALL(m_call)                                                                            \
+	template <size_t... Is>                                                                                     \
+	static _FORCE_INLINE_ void _ptrcall(void *p_self, const void **p_args, void *r_ret, IndexSequence<Is...>) { \
+		m_call;                                                                                                 \
+	}                                                                                                           \
+	static void ptrcall(void *p_self, const void **p_args, void *r_ret) {                                       \
+		_ptrcall(p_self, p_args, r_ret, BuildIndexSequence<sizeof...(P)>{});                                    \
+	}
+#else
+#define TYPED_METHOD_PTRCALL(m_call)
+#endif
+
+#define TYPED_METHOD_COMMON(m_has_return)                                                       \
+	static Variant::Type get_self_type() { return VariantInternalAccessor<T>::TYPE; }           \
+	static void get_argument_types(Vector<Variant::Type> &r_types) {                            \
+		Variant::Type types[] = { VariantInternalAccessorFor<P>::type::TYPE..., Variant::NIL }; \
+		for (size_t i = 0; i < sizeof...(P); i++) {                                             \
+			r_types.push_back(types[i]);                                                        \
+		}                                                                                       \
+	}                                                                                           \
+	static bool has_return() { return m_has_return; }
+
+template <class T, class R, class... P, R (T::*m_method)(P...) const>
+struct _VariantTypedMethod<R (T::*)(P...) const, m_method> {
+	template <size_t... Is>
+	static _FORCE_INLINE_ void _validated(Variant &r_ret, Variant &p_self, const Variant **p_args, IndexSequence<Is...>) {
+		VariantInternalAccessorFor<R>::type::set(&r_ret, (VariantInternalAccessor<T>::get(&p_self).*m_method)(VariantInternalAccessorFor<P>::type::get(p_args[Is])...));
+	}
+	static void validated(Variant &r_ret, Variant &p_self, const Variant **p_args) {
+		_validated(r_ret, p_self, p_args, BuildIndexSequence<sizeof...(P)>{});
+	}
+	TYPED_METHOD_PTRCALL(PtrToArg<R>::encode((reinterpret_cast<const T *>(p_self)->*m_method)(PtrToArg<P>::convert(p_args[Is])...), r_ret))
+	static Variant::Type get_return_type() { return VariantInternalAccessorFor<R>::type::TYPE; }
+	TYPED_METHOD_COMMON(true)
+};
+
+template <class T, class R, class... P, R (T::*m_method)(P...)>
+struct _VariantTypedMethod<R (T::*)(P...), m_method> {
+	template <size_t... Is>
+	static _FORCE_INLINE_ void _validated(Variant &r_ret, Variant &p_self, const Variant **p_args, IndexSequence<Is...>) {
+		VariantInternalAccessorFor<R>::type::set(&r_ret, (VariantInternalAccessor<T>::get_ptr(&p_self)->*m_method)(VariantInternalAccessorFor<P>::type::get(p_args[Is])...));
+	}
+	static void validated(Variant &r_ret, Variant &p_self, const Variant **p_args) {
+		_validated(r_ret, p_self, p_args, BuildIndexSequence<sizeof...(P)>{});
+	}
+	TYPED_METHOD_PTRCALL(PtrToArg<R>::encode((reinterpret_cast<T *>(p_self)->*m_method)(PtrToArg<P>::convert(p_args[Is])...), r_ret))
+	static Variant::Type get_return_type() { return VariantInternalAccessorFor<R>::type::TYPE; }
+	TYPED_METHOD_COMMON(true)
+};
+
+template <class T, class... P, void (T::*m_method)(P...) const>
+struct _VariantTypedMethod<void (T::*)(P...) const, m_method> {
+	template <size_t... Is>
+	static _FORCE_INLINE_ void _validated(Variant &r_ret, Variant &p_self, const Variant **p_args, IndexSequence<Is...>) {
+		(VariantInternalAccessor<T>::get(&p_self).*m_method)(VariantInternalAccessorFor<P>::type::get(p_args[Is])...);
+	}
+	static void validated(Variant &r_ret, Variant &p_self, const Variant **p_args) {
+		_validated(r_ret, p_self, p_args, BuildIndexSequence<sizeof...(P)>{});
+	}
+	TYPED_METHOD_PTRCALL((reinterpret_cast<const T *>(p_self)->*m_method)(PtrToArg<P>::convert(p_args[Is])...))
+	static Variant::Type get_return_type() { return Variant::NIL; }
+	TYPED_METHOD_COMMON(false)
+};
+
+template <class T, class... P, void (T::*m_method)(P...)>
+struct _VariantTypedMethod<void (T::*)(P...), m_method> {
+	template <size_t... Is>
+	static _FORCE_INLINE_ void _validated(Variant &r_ret, Variant &p_self, const Variant **p_args, IndexSequence<Is...>) {
+		(VariantInternalAccessor<T>::get_ptr(&p_self)->*m_method)(VariantInternalAccessorFor<P>::type::get(p_args[Is])...);
+	}
+	static void validated(Variant &r_ret, Variant &p_self, const Variant **p_args) {
+		_validated(r_ret, p_self, p_args, BuildIndexSequence<sizeof...(P)>{});
+	}
+	TYPED_METHOD_PTRCALL((reinterpret_cast<T *>(p_self)->*m_method)(PtrToArg<P>::convert(p_args[Is])...))
+	static Variant::Type get_return_type() { return Variant::NIL; }
+	TYPED_METHOD_COMMON(false)
+};
+
+#undef TYPED_METHOD_PTRCALL
+#undef TYPED_METHOD_COMMON
+
 struct _VariantCall {
 
 	static void Vector3_dot(Variant &r_ret, Variant &p_self, const Variant **p_args) {
@@ -60,6 +152,9 @@ struct _VariantCall {
 		bool returns;
 
 		VariantFunc func;
+		// Skip argument checks and conversions, see add_typed_method().
+		VariantFunc validated_func;
+		Variant::PTRBuiltInMethod ptr_func;
 
 		_FORCE_INLINE_ bool verify_arguments(const Variant **p_args, Callable::CallError &r_error) {
 
@@ -153,6 +248,8 @@ struct _VariantCall {
 
 		FuncData funcdata;
 		funcdata.func = p_func;
+		funcdata.validated_func = p_func;
+		funcdata.ptr_func = nullptr;
 		funcdata.default_args = p_defaultarg;
 		funcdata._const = p_const;
 		funcdata.returns = p_has_return;
@@ -207,6 +304,32 @@ struct _VariantCall {
 		type_funcs[p_type].functions[p_name] = funcdata;
 	}
 
+	template <class M>
+	static void add_typed_method(Variant::Type p_type, const StringName &p_name) {
+
+		Map<StringName, FuncData>::Element *E = type_funcs[p_type].functions.find(p_name);
+		ERR_FAIL_COND_MSG(!E, "Typed method '" + String(p_name) + "' was not registered for " + Variant::get_type_name(p_type) + ".");
+		FuncData &funcdata = E->get();
+
+		// The typed versions read arguments straight from the Variant payload, so
+		// they are only valid if the declared types are exactly the C++ ones.
+		Vector<Variant::Type> arg_types;
+		M::get_argument_types(arg_types);
+		bool matches = M::get_self_type() == p_type && arg_types.size() == funcdata.arg_types.size() && M::has_return() == funcdata.returns;
+		for (int i = 0; matches && i < arg_types.size(); i++) {
+			matches = arg_types[i] == funcdata.arg_types[i];
+		}
+		if (matches && funcdata.returns) {
+			matches = M::get_return_type() == funcdata.return_type;
+		}
+		ERR_FAIL_COND_MSG(!matches, "Typed method '" + String(p_name) + "' does not match the declared signature in " + Variant::get_type_name(p_type) + ".");
+
+		funcdata.validated_func = M::validated;
+#ifdef PTRCALL_ENABLED
+		funcdata.ptr_func = M::ptrcall;
+#endif
+	}
+
 #define VCALL_LOCALMEM0(m_type, m_method) \
 	static void _call_##m_type##_##m_method(Variant &r_ret, Variant &p_self, const Variant **p_args) { reinterpret_cast<m_type *>(p_self._data._mem)->m_method(); }
 #define VCALL_LOCALMEM0R(m_type, m_method) \
@@ -1450,6 +1573,26 @@ Vector<Variant::Type> Variant::get_method_argument_types(Variant::Type p_type, c
 	return E->get().arg_types;
 }
 
+Variant::ValidatedBuiltInMethod Variant::get_validated_builtin_method(Variant::Type p_type, const StringName &p_method) {
+
+	ERR_FAIL_INDEX_V(p_type, VARIANT_MAX, nullptr);
+	const Map<StringName, _VariantCall::FuncData>::Element *E = _VariantCall::type_funcs[p_type].functions.find(p_method);
+	if (!E)
+		return nullptr;
+
+	return E->get().validated_func;
+}
+
+Variant::PTRBuiltInMethod Variant::get_ptr_builtin_method(Variant::Type p_type, const StringName &p_method) {
+
+	ERR_FAIL_INDEX_V(p_type, VARIANT_MAX, nullptr);
+	const Map<StringName, _VariantCall::FuncData>::Element *E = _VariantCall::type_funcs[p_type].functions.find(p_method);
+	if (!E)
+		return nullptr;
+
+	return E->get().ptr_func;
+}
+
 bool Variant::is_method_const(Variant::Type p_type, const StringName &p_method) {
 
 	const _VariantCall::TypeFunc &tf = _VariantCall::type_funcs[p_type];
@@ -2190,6 +2333,193 @@ void register_variant_methods() {
 	ADDFUNC1R(TRANSFORM, NIL, Transform, xform, NIL, "v", varray());
 	ADDFUNC1R(TRANSFORM, NIL, Transform, xform_inv, NIL, "v", varray());
 
+	/* TYPED FAST PATHS */
+
+	// Math heavy script code calls these in tight loops, give them typed
+	// validated and ptrcall versions (see add_typed_method()).
+
+#define ADDTYPED(m_vtype, m_class, m_method) \
+	_VariantCall::add_typed_method<_VariantTypedMethod<decltype(&m_class::m_method), &m_class::m_method>>(Variant::m_vtype, _scs_create(#m_method));
+
+	ADDTYPED(VECTOR2, Vector2, distance_to);
+	ADDTYPED(VECTOR2, Vector2, distance_squared_to);
+	ADDTYPED(VECTOR2, Vector2, length);
+	ADDTYPED(VECTOR2, Vector2, length_squared);
+	ADDTYPED(VECTOR2, Vector2, normalized);
+	ADDTYPED(VECTOR2, Vector2, is_normalized);
+	ADDTYPED(VECTOR2, Vector2, is_equal_approx);
+	ADDTYPED(VECTOR2, Vector2, posmod);
+	ADDTYPED(VECTOR2, Vector2, posmodv);
+	ADDTYPED(VECTOR2, Vector2, project);
+	ADDTYPED(VECTOR2, Vector2, angle_to);
+	ADDTYPED(VECTOR2, Vector2, angle_to_point);
+	ADDTYPED(VECTOR2, Vector2, direction_to);
+	ADDTYPED(VECTOR2, Vector2, slerp);
+	ADDTYPED(VECTOR2, Vector2, cubic_interpolate);
+	ADDTYPED(VECTOR2, Vector2, move_toward);
+	ADDTYPED(VECTOR2, Vector2, rotated);
+	ADDTYPED(VECTOR2, Vector2, tangent);
+	ADDTYPED(VECTOR2, Vector2, floor);
+	ADDTYPED(VECTOR2, Vector2, ceil);
+	ADDTYPED(VECTOR2, Vector2, round);
+	ADDTYPED(VECTOR2, Vector2, snapped);
+	ADDTYPED(VECTOR2, Vector2, aspect);
+	ADDTYPED(VECTOR2, Vector2, dot);
+	ADDTYPED(VECTOR2, Vector2, slide);
+	ADDTYPED(VECTOR2, Vector2, bounce);
+	ADDTYPED(VECTOR2, Vector2, reflect);
+	ADDTYPED(VECTOR2, Vector2, angle);
+	ADDTYPED(VECTOR2, Vector2, cross);
+	ADDTYPED(VECTOR2, Vector2, abs);
+	ADDTYPED(VECTOR2, Vector2, clamped);
+	ADDTYPED(VECTOR2, Vector2, sign);
+
+	ADDTYPED(RECT2, Rect2, get_area);
+	ADDTYPED(RECT2, Rect2, has_no_area);
+	ADDTYPED(RECT2, Rect2, has_point);
+	ADDTYPED(RECT2, Rect2, is_equal_approx);
+	ADDTYPED(RECT2, Rect2, intersects);
+	ADDTYPED(RECT2, Rect2, encloses);
+	ADDTYPED(RECT2, Rect2, clip);
+	ADDTYPED(RECT2, Rect2, merge);
+	ADDTYPED(RECT2, Rect2, expand);
+	ADDTYPED(RECT2, Rect2, grow);
+	ADDTYPED(RECT2, Rect2, grow_individual);
+	ADDTYPED(RECT2, Rect2, abs);
+
+	ADDTYPED(VECTOR3, Vector3, min_axis);
+	ADDTYPED(VECTOR3, Vector3, max_axis);
+	ADDTYPED(VECTOR3, Vector3, distance_to);
+	ADDTYPED(VECTOR3, Vector3, distance_squared_to);
+	ADDTYPED(VECTOR3, Vector3, length);
+	ADDTYPED(VECTOR3, Vector3, length_squared);
+	ADDTYPED(VECTOR3, Vector3, normalized);
+	ADDTYPED(VECTOR3, Vector3, is_normalized);
+	ADDTYPED(VECTOR3, Vector3, is_equal_approx);
+	ADDTYPED(VECTOR3, Vector3, inverse);
+	ADDTYPED(VECTOR3, Vector3, snapped);
+	ADDTYPED(VECTOR3, Vector3, rotated);
+	ADDTYPED(VECTOR3, Vector3, linear_interpolate);
+	ADDTYPED(VECTOR3, Vector3, slerp);
+	ADDTYPED(VECTOR3, Vector3, cubic_interpolate);
+	ADDTYPED(VECTOR3, Vector3, move_toward);
+	ADDTYPED(VECTOR3, Vector3, dot);
+	ADDTYPED(VECTOR3, Vector3, cross);
+	ADDTYPED(VECTOR3, Vector3, outer);
+	ADDTYPED(VECTOR3, Vector3, to_diagonal_matrix);
+	ADDTYPED(VECTOR3, Vector3, abs);
+	ADDTYPED(VECTOR3, Vector3, floor);
+	ADDTYPED(VECTOR3, Vector3, ceil);
+	ADDTYPED(VECTOR3, Vector3, round);
+	ADDTYPED(VECTOR3, Vector3, posmod);
+	ADDTYPED(VECTOR3, Vector3, posmodv);
+	ADDTYPED(VECTOR3, Vector3, project);
+	ADDTYPED(VECTOR3, Vector3, angle_to);
+	ADDTYPED(VECTOR3, Vector3, direction_to);
+	ADDTYPED(VECTOR3, Vector3, slide);
+	ADDTYPED(VECTOR3, Vector3, bounce);
+	ADDTYPED(VECTOR3, Vector3, reflect);
+	ADDTYPED(VECTOR3, Vector3, sign);
+
+	ADDTYPED(PLANE, Plane, normalized);
+	ADDTYPED(PLANE, Plane, center);
+	ADDTYPED(PLANE, Plane, get_any_point);
+	ADDTYPED(PLANE, Plane, is_equal_approx);
+	ADDTYPED(PLANE, Plane, is_point_over);
+	ADDTYPED(PLANE, Plane, distance_to);
+	ADDTYPED(PLANE, Plane, has_point);
+	ADDTYPED(PLANE, Plane, project);
+
+	ADDTYPED(QUAT, Quat, length);
+	ADDTYPED(QUAT, Quat, length_squared);
+	ADDTYPED(QUAT, Quat, normalized);
+	ADDTYPED(QUAT, Quat, is_normalized);
+	ADDTYPED(QUAT, Quat, is_equal_approx);
+	ADDTYPED(QUAT, Quat, inverse);
+	ADDTYPED(QUAT, Quat, dot);
+	ADDTYPED(QUAT, Quat, xform);
+	ADDTYPED(QUAT, Quat, slerp);
+	ADDTYPED(QUAT, Quat, slerpni);
+	ADDTYPED(QUAT, Quat, cubic_slerp);
+	ADDTYPED(QUAT, Quat, get_euler);
+	ADDTYPED(QUAT, Quat, set_euler);
+	ADDTYPED(QUAT, Quat, set_axis_angle);
+
+	ADDTYPED(COLOR, Color, to_argb32);
+	ADDTYPED(COLOR, Color, to_abgr32);
+	ADDTYPED(COLOR, Color, to_rgba32);
+	ADDTYPED(COLOR, Color, to_argb64);
+	ADDTYPED(COLOR, Color, to_abgr64);
+	ADDTYPED(COLOR, Color, to_rgba64);
+	ADDTYPED(COLOR, Color, inverted);
+	ADDTYPED(COLOR, Color, contrasted);
+	ADDTYPED(COLOR, Color, linear_interpolate);
+	ADDTYPED(COLOR, Color, blend);
+	ADDTYPED(COLOR, Color, lightened);
+	ADDTYPED(COLOR, Color, darkened);
+	ADDTYPED(COLOR, Color, to_html);
+	ADDTYPED(COLOR, Color, from_hsv);
+	ADDTYPED(COLOR, Color, is_equal_approx);
+
+	ADDTYPED(AABB, AABB, get_area);
+	ADDTYPED(AABB, AABB, has_no_area);
+	ADDTYPED(AABB, AABB, has_no_surface);
+	ADDTYPED(AABB, AABB, has_point);
+	ADDTYPED(AABB, AABB, is_equal_approx);
+	ADDTYPED(AABB, AABB, intersects);
+	ADDTYPED(AABB, AABB, encloses);
+	ADDTYPED(AABB, AABB, intersects_plane);
+	ADDTYPED(AABB, AABB, intersection);
+	ADDTYPED(AABB, AABB, merge);
+	ADDTYPED(AABB, AABB, expand);
+	ADDTYPED(AABB, AABB, grow);
+	ADDTYPED(AABB, AABB, get_support);
+	ADDTYPED(AABB, AABB, get_longest_axis);
+	ADDTYPED(AABB, AABB, get_longest_axis_index);
+	ADDTYPED(AABB, AABB, get_longest_axis_size);
+	ADDTYPED(AABB, AABB, get_shortest_axis);
+	ADDTYPED(AABB, AABB, get_shortest_axis_index);
+	ADDTYPED(AABB, AABB, get_shortest_axis_size);
+	ADDTYPED(AABB, AABB, get_endpoint);
+
+	ADDTYPED(TRANSFORM2D, Transform2D, inverse);
+	ADDTYPED(TRANSFORM2D, Transform2D, affine_inverse);
+	ADDTYPED(TRANSFORM2D, Transform2D, get_rotation);
+	ADDTYPED(TRANSFORM2D, Transform2D, get_origin);
+	ADDTYPED(TRANSFORM2D, Transform2D, get_scale);
+	ADDTYPED(TRANSFORM2D, Transform2D, orthonormalized);
+	ADDTYPED(TRANSFORM2D, Transform2D, rotated);
+	ADDTYPED(TRANSFORM2D, Transform2D, scaled);
+	ADDTYPED(TRANSFORM2D, Transform2D, translated);
+	ADDTYPED(TRANSFORM2D, Transform2D, interpolate_with);
+	ADDTYPED(TRANSFORM2D, Transform2D, is_equal_approx);
+
+	ADDTYPED(BASIS, Basis, inverse);
+	ADDTYPED(BASIS, Basis, transposed);
+	ADDTYPED(BASIS, Basis, determinant);
+	ADDTYPED(BASIS, Basis, scaled);
+	ADDTYPED(BASIS, Basis, get_scale);
+	ADDTYPED(BASIS, Basis, get_euler);
+	ADDTYPED(BASIS, Basis, tdotx);
+	ADDTYPED(BASIS, Basis, tdoty);
+	ADDTYPED(BASIS, Basis, tdotz);
+	ADDTYPED(BASIS, Basis, xform);
+	ADDTYPED(BASIS, Basis, xform_inv);
+	ADDTYPED(BASIS, Basis, get_orthogonal_index);
+	ADDTYPED(BASIS, Basis, orthonormalized);
+	ADDTYPED(BASIS, Basis, slerp);
+	ADDTYPED(BASIS, Basis, get_rotation_quat);
+
+	ADDTYPED(TRANSFORM, Transform, inverse);
+	ADDTYPED(TRANSFORM, Transform, affine_inverse);
+	ADDTYPED(TRANSFORM, Transform, rotated);
+	ADDTYPED(TRANSFORM, Transform, scaled);
+	ADDTYPED(TRANSFORM, Transform, translated);
+	ADDTYPED(TRANSFORM, Transform, orthonormalized);
+	ADDTYPED(TRANSFORM, Transform, looking_at);
+	ADDTYPED(TRANSFORM, Transform, interpolate_with);
+	ADDTYPED(TRANSFORM, Transform, is_equal_approx);
+
 	/* REGISTER CONSTRUCTORS */
 
 	_VariantCall::add_constructor(_VariantCall::Vector2_init1, Variant::VECTOR2, "x", Variant::FLOAT, "y", Variant::FLOAT);
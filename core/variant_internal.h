@@ -0,0 +1,225 @@
+/*************************************************************************/
+/*  variant_internal.h                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+
+#ifndef VARIANT_INTERNAL_H
+#define VARIANT_INTERNAL_H
+
+#include "core/simple_type.h"
+#include "core/variant.h"
+
+// Direct access to the payload of a Variant, for the validated operator and
+// builtin method paths. get() assumes the Variant already holds TYPE, so the
+// caller must have checked it; set() changes the type if needed.
+
+template <class T>
+struct VariantInternalAccessor;
+
+// Strips const and reference, so argument types of bound methods can be looked up.
+template <class T>
+struct VariantInternalAccessorFor {
+	typedef VariantInternalAccessor<typename GetSimpleTypeT<typename GetSimpleTypeT<T>::type_t>::type_t> type;
+};
+
+#define MAKE_VARIANT_ACCESSOR_CONV(m_type, m_var_type, m_member)       \
+	template <>                                                        \
+	struct VariantInternalAccessor<m_type> {                           \
+		static const Variant::Type TYPE = Variant::m_var_type;         \
+		static _FORCE_INLINE_ m_type get(const Variant *p_v) {         \
+			return m_type(p_v->_data.m_member);                        \
+		}                                                              \
+		static _FORCE_INLINE_ void set(Variant *p_v, m_type p_value) { \
+			if (p_v->type != TYPE) {                                   \
+				p_v->clear();                                          \
+				p_v->type = TYPE;                                      \
+			}                                                          \
+			p_v->_data.m_member = p_value;                             \
+		}                                                              \
+	};
+
+#define MAKE_VARIANT_ACCESSOR_LOCALMEM(m_type, m_var_type)                    \
+	template <>                                                               \
+	struct VariantInternalAccessor<m_type> {                                  \
+		static const Variant::Type TYPE = Variant::m_var_type;                \
+		static _FORCE_INLINE_ const m_type &get(const Variant *p_v) {         \
+			return *reinterpret_cast<const m_type *>(p_v->_data._mem);        \
+		}                                                                     \
+		static _FORCE_INLINE_ m_type *get_ptr(Variant *p_v) {                 \
+			return reinterpret_cast<m_type *>(p_v->_data._mem);               \
+		}                                                                     \
+		static _FORCE_INLINE_ void set(Variant *p_v, const m_type &p_value) { \
+			if (p_v->type == TYPE) {                                          \
+				*reinterpret_cast<m_type *>(p_v->_data._mem) = p_value;       \
+			} else {                                                          \
+				*p_v = p_value;                                               \
+			}                                                                 \
+		}                                                                     \
+	};
+
+#define MAKE_VARIANT_ACCESSOR_PTR(m_type, m_var_type, m_member)               \
+	template <>                                                               \
+	struct VariantInternalAccessor<m_type> {                                  \
+		static const Variant::Type TYPE = Variant::m_var_type;                \
+		static _FORCE_INLINE_ const m_type &get(const Variant *p_v) {         \
+			return *p_v->_data.m_member;                                      \
+		}                                                                     \
+		static _FORCE_INLINE_ m_type *get_ptr(Variant *p_v) {                 \
+			return p_v->_data.m_member;                                       \
+		}                                                                     \
+		static _FORCE_INLINE_ void set(Variant *p_v, const m_type &p_value) { \
+			if (p_v->type == TYPE) {                                          \
+				*p_v->_data.m_member = p_value;                               \
+			} else {                                                          \
+				*p_v = p_value;                                               \
+			}                                                                 \
+		}                                                                     \
+	};
+
+MAKE_VARIANT_ACCESSOR_CONV(bool, BOOL, _bool)
+MAKE_VARIANT_ACCESSOR_CONV(int32_t, INT, _int)
+MAKE_VARIANT_ACCESSOR_CONV(uint32_t, INT, _int)
+MAKE_VARIANT_ACCESSOR_CONV(int64_t, INT, _int)
+MAKE_VARIANT_ACCESSOR_CONV(uint64_t, INT, _int)
+MAKE_VARIANT_ACCESSOR_CONV(float, FLOAT, _float)
+MAKE_VARIANT_ACCESSOR_CONV(double, FLOAT, _float)
+
+MAKE_VARIANT_ACCESSOR_LOCALMEM(String, STRING)
+MAKE_VARIANT_ACCESSOR_LOCALMEM(Vector2, VECTOR2)
+MAKE_VARIANT_ACCESSOR_LOCALMEM(Vector2i, VECTOR2I)
+MAKE_VARIANT_ACCESSOR_LOCALMEM(Rect2, RECT2)
+MAKE_VARIANT_ACCESSOR_LOCALMEM(Rect2i, RECT2I)
+MAKE_VARIANT_ACCESSOR_LOCALMEM(Vector3, VECTOR3)
+MAKE_VARIANT_ACCESSOR_LOCALMEM(Vector3i, VECTOR3I)
+MAKE_VARIANT_ACCESSOR_LOCALMEM(Plane, PLANE)
+MAKE_VARIANT_ACCESSOR_LOCALMEM(Quat, QUAT)
+MAKE_VARIANT_ACCESSOR_LOCALMEM(Color, COLOR)
+MAKE_VARIANT_ACCESSOR_LOCALMEM(StringName, STRING_NAME)
+
+MAKE_VARIANT_ACCESSOR_PTR(Transform2D, TRANSFORM2D, _transform2d)
+MAKE_VARIANT_ACCESSOR_PTR(::AABB, AABB, _aabb)
+MAKE_VARIANT_ACCESSOR_PTR(Basis, BASIS, _basis)
+MAKE_VARIANT_ACCESSOR_PTR(Transform, TRANSFORM, _transform)
+
+#define MAKE_VARIANT_ACCESSOR_PACKED(m_type, m_var_type, m_elem)                                    \
+	template <>                                                                                     \
+	struct VariantInternalAccessor<m_type> {                                                        \
+		static const Variant::Type TYPE = Variant::m_var_type;                                      \
+		static _FORCE_INLINE_ const m_type &get(const Variant *p_v) {                               \
+			return Variant::PackedArrayRef<m_elem>::get_array(p_v->_data.packed_array);             \
+		}                                                                                           \
+		static _FORCE_INLINE_ m_type *get_ptr(Variant *p_v) {                                       \
+			return Variant::PackedArrayRef<m_elem>::get_array_ptr(p_v->_data.packed_array);         \
+		}                                                                                           \
+		static _FORCE_INLINE_ void set(Variant *p_v, const m_type &p_value) {                       \
+			if (p_v->type == TYPE) {                                                                \
+				*Variant::PackedArrayRef<m_elem>::get_array_ptr(p_v->_data.packed_array) = p_value; \
+			} else {                                                                                \
+				*p_v = p_value;                                                                     \
+			}                                                                                       \
+		}                                                                                           \
+	};
+
+MAKE_VARIANT_ACCESSOR_LOCALMEM(Array, ARRAY)
+MAKE_VARIANT_ACCESSOR_LOCALMEM(Dictionary, DICTIONARY)
+
+MAKE_VARIANT_ACCESSOR_PACKED(PackedByteArray, PACKED_BYTE_ARRAY, uint8_t)
+MAKE_VARIANT_ACCESSOR_PACKED(PackedInt32Array, PACKED_INT32_ARRAY, int32_t)
+MAKE_VARIANT_ACCESSOR_PACKED(PackedInt64Array, PACKED_INT64_ARRAY, int64_t)
+MAKE_VARIANT_ACCESSOR_PACKED(PackedFloat32Array, PACKED_FLOAT32_ARRAY, float)
+MAKE_VARIANT_ACCESSOR_PACKED(PackedFloat64Array, PACKED_FLOAT64_ARRAY, double)
+MAKE_VARIANT_ACCESSOR_PACKED(PackedStringArray, PACKED_STRING_ARRAY, String)
+MAKE_VARIANT_ACCESSOR_PACKED(PackedVector2Array, PACKED_VECTOR2_ARRAY, Vector2)
+MAKE_VARIANT_ACCESSOR_PACKED(PackedVector3Array, PACKED_VECTOR3_ARRAY, Vector3)
+MAKE_VARIANT_ACCESSOR_PACKED(PackedColorArray, PACKED_COLOR_ARRAY, Color)
+
+#undef MAKE_VARIANT_ACCESSOR_CONV
+#undef MAKE_VARIANT_ACCESSOR_LOCALMEM
+#undef MAKE_VARIANT_ACCESSOR_PTR
+#undef MAKE_VARIANT_ACCESSOR_PACKED
+
+// Payload of a Variant in the layout MethodBind::ptrcall() expects for arguments
+// and return values of its type. Variant arguments are passed as the Variant
+// itself instead. Objects are left out, since Object * and Ref<T> are encoded
+// differently, and nullptr is returned for them.
+struct VariantInternal {
+
+	static _FORCE_INLINE_ void *get_opaque_pointer(Variant *p_v) {
+		switch (p_v->type) {
+			case Variant::NIL:
+			case Variant::OBJECT:
+				return nullptr;
+			case Variant::BOOL:
+				return &p_v->_data._bool;
+			case Variant::INT:
+				return &p_v->_data._int;
+			case Variant::FLOAT:
+				return &p_v->_data._float;
+			case Variant::TRANSFORM2D:
+				return p_v->_data._transform2d;
+			case Variant::AABB:
+				return p_v->_data._aabb;
+			case Variant::BASIS:
+				return p_v->_data._basis;
+			case Variant::TRANSFORM:
+				return p_v->_data._transform;
+			case Variant::PACKED_BYTE_ARRAY:
+				return VariantInternalAccessor<PackedByteArray>::get_ptr(p_v);
+			case Variant::PACKED_INT32_ARRAY:
+				return VariantInternalAccessor<PackedInt32Array>::get_ptr(p_v);
+			case Variant::PACKED_INT64_ARRAY:
+				return VariantInternalAccessor<PackedInt64Array>::get_ptr(p_v);
+			case Variant::PACKED_FLOAT32_ARRAY:
+				return VariantInternalAccessor<PackedFloat32Array>::get_ptr(p_v);
+			case Variant::PACKED_FLOAT64_ARRAY:
+				return VariantInternalAccessor<PackedFloat64Array>::get_ptr(p_v);
+			case Variant::PACKED_STRING_ARRAY:
+				return VariantInternalAccessor<PackedStringArray>::get_ptr(p_v);
+			case Variant::PACKED_VECTOR2_ARRAY:
+				return VariantInternalAccessor<PackedVector2Array>::get_ptr(p_v);
+			case Variant::PACKED_VECTOR3_ARRAY:
+				return VariantInternalAccessor<PackedVector3Array>::get_ptr(p_v);
+			case Variant::PACKED_COLOR_ARRAY:
+				return VariantInternalAccessor<PackedColorArray>::get_ptr(p_v);
+			default:
+				// Everything else lives in place, in _mem.
+				return p_v->_data._mem;
+		}
+	}
+
+	// Makes p_v hold a value of p_type, so a ptrcall can write its result in place.
+	static _FORCE_INLINE_ void initialize(Variant *p_v, Variant::Type p_type) {
+		if (p_v->type != p_type) {
+			Callable::CallError ce;
+			*p_v = Variant::construct(p_type, nullptr, 0, ce);
+		}
+	}
+};
+
+#endif // VARIANT_INTERNAL_H
@@ -33,6 +33,7 @@
 #include "core/core_string_names.h"
 #include "core/debugger/engine_debugger.h"
 #include "core/object.h"
+#include "core/variant_internal.h"
 
 #define CASE_TYPE_ALL(PREFIX, OP) \
 	CASE_TYPE(PREFIX, OP, INT)    \
@@ -1379,6 +1380,217 @@ void Variant::evaluate(const Operator &p_op, const Variant &p_a,
 	}
 }
 
+/* VALIDATED OPERATORS */
+
+// Evaluators for operand combinations whose result type is fixed and which
+// can't fail. They are resolved once by (op, type_a, type_b) and then called
+// without any of the type checks done by evaluate(), so the results must stay
+// identical to what evaluate() returns for the same operands.
+
+#define VALIDATED_BINARY_OP(m_class, m_expr)                                                  \
+	template <class R, class A, class B>                                                      \
+	struct m_class {                                                                          \
+		static void evaluate(const Variant *p_left, const Variant *p_right, Variant *r_ret) { \
+			const A &a = VariantInternalAccessor<A>::get(p_left);                             \
+			const B &b = VariantInternalAccessor<B>::get(p_right);                            \
+			R ret = m_expr;                                                                   \
+			VariantInternalAccessor<R>::set(r_ret, ret);                                      \
+		}                                                                                     \
+		static Variant::Type get_return_type() { return VariantInternalAccessor<R>::TYPE; }   \
+	};
+
+#define VALIDATED_UNARY_OP(m_class, m_expr)                                                   \
+	template <class R, class A>                                                               \
+	struct m_class {                                                                          \
+		static void evaluate(const Variant *p_left, const Variant *p_right, Variant *r_ret) { \
+			const A &a = VariantInternalAccessor<A>::get(p_left);                             \
+			R ret = m_expr;                                                                   \
+			VariantInternalAccessor<R>::set(r_ret, ret);                                      \
+		}                                                                                     \
+		static Variant::Type get_return_type() { return VariantInternalAccessor<R>::TYPE; }   \
+	};
+
+VALIDATED_BINARY_OP(OperatorEvaluatorEqual, a == b)
+VALIDATED_BINARY_OP(OperatorEvaluatorNotEqual, a != b)
+VALIDATED_BINARY_OP(OperatorEvaluatorLess, a < b)
+VALIDATED_BINARY_OP(OperatorEvaluatorLessEqual, a <= b)
+// Same operand order as evaluate(), which only relies on operator< and operator<=.
+VALIDATED_BINARY_OP(OperatorEvaluatorGreater, b < a)
+VALIDATED_BINARY_OP(OperatorEvaluatorGreaterEqual, b <= a)
+VALIDATED_BINARY_OP(OperatorEvaluatorAdd, a + b)
+VALIDATED_BINARY_OP(OperatorEvaluatorSub, a - b)
+VALIDATED_BINARY_OP(OperatorEvaluatorMul, a * b)
+VALIDATED_BINARY_OP(OperatorEvaluatorDiv, a / b)
+VALIDATED_BINARY_OP(OperatorEvaluatorMod, a % b)
+VALIDATED_BINARY_OP(OperatorEvaluatorBitAnd, a & b)
+VALIDATED_BINARY_OP(OperatorEvaluatorBitOr, a | b)
+VALIDATED_BINARY_OP(OperatorEvaluatorBitXor, a ^ b)
+VALIDATED_BINARY_OP(OperatorEvaluatorAnd, a && b)
+VALIDATED_BINARY_OP(OperatorEvaluatorOr, a || b)
+VALIDATED_BINARY_OP(OperatorEvaluatorXor, (a || b) && !(a && b))
+
+VALIDATED_UNARY_OP(OperatorEvaluatorNeg, -a)
+VALIDATED_UNARY_OP(OperatorEvaluatorPos, a)
+VALIDATED_UNARY_OP(OperatorEvaluatorBitNeg, ~a)
+VALIDATED_UNARY_OP(OperatorEvaluatorNot, !a)
+
+static Variant::ValidatedOperatorEvaluator validated_operator_evaluator_table[Variant::OP_MAX][Variant::VARIANT_MAX][Variant::VARIANT_MAX];
+static Variant::Type operator_return_type_table[Variant::OP_MAX][Variant::VARIANT_MAX][Variant::VARIANT_MAX];
+
+static _FORCE_INLINE_ bool _is_unary_operator(Variant::Operator p_op) {
+	return p_op == Variant::OP_NEGATE || p_op == Variant::OP_POSITIVE || p_op == Variant::OP_BIT_NEGATE || p_op == Variant::OP_NOT;
+}
+
+template <class T>
+static void register_op(Variant::Operator p_op, Variant::Type p_type_a, Variant::Type p_type_b) {
+	validated_operator_evaluator_table[p_op][p_type_a][p_type_b] = T::evaluate;
+	operator_return_type_table[p_op][p_type_a][p_type_b] = T::get_return_type();
+}
+
+template <class T>
+static void register_unary_op(Variant::Operator p_op, Variant::Type p_type) {
+	register_op<T>(p_op, p_type, Variant::NIL);
+}
+
+template <template <class, class, class> class Op>
+static void register_numeric_op(Variant::Operator p_op) {
+	register_op<Op<int64_t, int64_t, int64_t>>(p_op, Variant::INT, Variant::INT);
+	register_op<Op<double, int64_t, double>>(p_op, Variant::INT, Variant::FLOAT);
+	register_op<Op<double, double, int64_t>>(p_op, Variant::FLOAT, Variant::INT);
+	register_op<Op<double, double, double>>(p_op, Variant::FLOAT, Variant::FLOAT);
+}
+
+template <template <class, class, class> class Op>
+static void register_numeric_compare_op(Variant::Operator p_op) {
+	register_op<Op<bool, int64_t, int64_t>>(p_op, Variant::INT, Variant::INT);
+	register_op<Op<bool, int64_t, double>>(p_op, Variant::INT, Variant::FLOAT);
+	register_op<Op<bool, double, int64_t>>(p_op, Variant::FLOAT, Variant::INT);
+	register_op<Op<bool, double, double>>(p_op, Variant::FLOAT, Variant::FLOAT);
+}
+
+template <class T>
+static void register_vector_ops() {
+	const Variant::Type type = VariantInternalAccessor<T>::TYPE;
+
+	register_op<OperatorEvaluatorEqual<bool, T, T>>(Variant::OP_EQUAL, type, type);
+	register_op<OperatorEvaluatorNotEqual<bool, T, T>>(Variant::OP_NOT_EQUAL, type, type);
+	register_op<OperatorEvaluatorLess<bool, T, T>>(Variant::OP_LESS, type, type);
+	register_op<OperatorEvaluatorLessEqual<bool, T, T>>(Variant::OP_LESS_EQUAL, type, type);
+	register_op<OperatorEvaluatorGreater<bool, T, T>>(Variant::OP_GREATER, type, type);
+	register_op<OperatorEvaluatorGreaterEqual<bool, T, T>>(Variant::OP_GREATER_EQUAL, type, type);
+	register_op<OperatorEvaluatorAdd<T, T, T>>(Variant::OP_ADD, type, type);
+	register_op<OperatorEvaluatorSub<T, T, T>>(Variant::OP_SUBTRACT, type, type);
+	register_op<OperatorEvaluatorMul<T, T, T>>(Variant::OP_MULTIPLY, type, type);
+	register_op<OperatorEvaluatorMul<T, T, int64_t>>(Variant::OP_MULTIPLY, type, Variant::INT);
+	register_unary_op<OperatorEvaluatorNeg<T, T>>(Variant::OP_NEGATE, type);
+	register_unary_op<OperatorEvaluatorPos<T, T>>(Variant::OP_POSITIVE, type);
+}
+
+template <class T>
+static void register_real_vector_ops() {
+	const Variant::Type type = VariantInternalAccessor<T>::TYPE;
+
+	register_vector_ops<T>();
+	register_op<OperatorEvaluatorMul<T, T, double>>(Variant::OP_MULTIPLY, type, Variant::FLOAT);
+	register_op<OperatorEvaluatorMul<T, int64_t, T>>(Variant::OP_MULTIPLY, Variant::INT, type);
+	register_op<OperatorEvaluatorMul<T, double, T>>(Variant::OP_MULTIPLY, Variant::FLOAT, type);
+	// Floating point division is never checked by evaluate().
+	register_op<OperatorEvaluatorDiv<T, T, T>>(Variant::OP_DIVIDE, type, type);
+	register_op<OperatorEvaluatorDiv<T, T, int64_t>>(Variant::OP_DIVIDE, type, Variant::INT);
+	register_op<OperatorEvaluatorDiv<T, T, double>>(Variant::OP_DIVIDE, type, Variant::FLOAT);
+}
+
+void register_variant_operators() {
+
+	register_numeric_op<OperatorEvaluatorAdd>(Variant::OP_ADD);
+	register_numeric_op<OperatorEvaluatorSub>(Variant::OP_SUBTRACT);
+	register_numeric_op<OperatorEvaluatorMul>(Variant::OP_MULTIPLY);
+#ifndef DEBUG_ENABLED
+	// Debug builds report division by zero, which needs evaluate().
+	register_numeric_op<OperatorEvaluatorDiv>(Variant::OP_DIVIDE);
+	register_op<OperatorEvaluatorMod<int64_t, int64_t, int64_t>>(Variant::OP_MODULE, Variant::INT, Variant::INT);
+#endif
+
+	register_numeric_compare_op<OperatorEvaluatorEqual>(Variant::OP_EQUAL);
+	register_numeric_compare_op<OperatorEvaluatorNotEqual>(Variant::OP_NOT_EQUAL);
+	register_numeric_compare_op<OperatorEvaluatorLess>(Variant::OP_LESS);
+	register_numeric_compare_op<OperatorEvaluatorLessEqual>(Variant::OP_LESS_EQUAL);
+	register_numeric_compare_op<OperatorEvaluatorGreater>(Variant::OP_GREATER);
+	register_numeric_compare_op<OperatorEvaluatorGreaterEqual>(Variant::OP_GREATER_EQUAL);
+
+	register_unary_op<OperatorEvaluatorNeg<int64_t, int64_t>>(Variant::OP_NEGATE, Variant::INT);
+	register_unary_op<OperatorEvaluatorNeg<double, double>>(Variant::OP_NEGATE, Variant::FLOAT);
+	register_unary_op<OperatorEvaluatorPos<int64_t, int64_t>>(Variant::OP_POSITIVE, Variant::INT);
+	register_unary_op<OperatorEvaluatorPos<double, double>>(Variant::OP_POSITIVE, Variant::FLOAT);
+
+	register_op<OperatorEvaluatorBitAnd<int64_t, int64_t, int64_t>>(Variant::OP_BIT_AND, Variant::INT, Variant::INT);
+	register_op<OperatorEvaluatorBitOr<int64_t, int64_t, int64_t>>(Variant::OP_BIT_OR, Variant::INT, Variant::INT);
+	register_op<OperatorEvaluatorBitXor<int64_t, int64_t, int64_t>>(Variant::OP_BIT_XOR, Variant::INT, Variant::INT);
+	register_unary_op<OperatorEvaluatorBitNeg<int64_t, int64_t>>(Variant::OP_BIT_NEGATE, Variant::INT);
+
+	register_op<OperatorEvaluatorEqual<bool, bool, bool>>(Variant::OP_EQUAL, Variant::BOOL, Variant::BOOL);
+	register_op<OperatorEvaluatorNotEqual<bool, bool, bool>>(Variant::OP_NOT_EQUAL, Variant::BOOL, Variant::BOOL);
+	register_op<OperatorEvaluatorAnd<bool, bool, bool>>(Variant::OP_AND, Variant::BOOL, Variant::BOOL);
+	register_op<OperatorEvaluatorOr<bool, bool, bool>>(Variant::OP_OR, Variant::BOOL, Variant::BOOL);
+	register_op<OperatorEvaluatorXor<bool, bool, bool>>(Variant::OP_XOR, Variant::BOOL, Variant::BOOL);
+	register_unary_op<OperatorEvaluatorNot<bool, bool>>(Variant::OP_NOT, Variant::BOOL);
+	register_unary_op<OperatorEvaluatorNot<bool, int64_t>>(Variant::OP_NOT, Variant::INT);
+	register_unary_op<OperatorEvaluatorNot<bool, double>>(Variant::OP_NOT, Variant::FLOAT);
+
+	register_real_vector_ops<Vector2>();
+	register_real_vector_ops<Vector3>();
+	register_vector_ops<Vector2i>();
+	register_vector_ops<Vector3i>();
+
+	register_op<OperatorEvaluatorEqual<bool, Color, Color>>(Variant::OP_EQUAL, Variant::COLOR, Variant::COLOR);
+	register_op<OperatorEvaluatorNotEqual<bool, Color, Color>>(Variant::OP_NOT_EQUAL, Variant::COLOR, Variant::COLOR);
+	register_op<OperatorEvaluatorAdd<Color, Color, Color>>(Variant::OP_ADD, Variant::COLOR, Variant::COLOR);
+	register_op<OperatorEvaluatorSub<Color, Color, Color>>(Variant::OP_SUBTRACT, Variant::COLOR, Variant::COLOR);
+	register_op<OperatorEvaluatorMul<Color, Color, Color>>(Variant::OP_MULTIPLY, Variant::COLOR, Variant::COLOR);
+	register_op<OperatorEvaluatorMul<Color, Color, int64_t>>(Variant::OP_MULTIPLY, Variant::COLOR, Variant::INT);
+	register_op<OperatorEvaluatorMul<Color, Color, double>>(Variant::OP_MULTIPLY, Variant::COLOR, Variant::FLOAT);
+	register_op<OperatorEvaluatorDiv<Color, Color, Color>>(Variant::OP_DIVIDE, Variant::COLOR, Variant::COLOR);
+	register_op<OperatorEvaluatorDiv<Color, Color, int64_t>>(Variant::OP_DIVIDE, Variant::COLOR, Variant::INT);
+	register_op<OperatorEvaluatorDiv<Color, Color, double>>(Variant::OP_DIVIDE, Variant::COLOR, Variant::FLOAT);
+	register_unary_op<OperatorEvaluatorNeg<Color, Color>>(Variant::OP_NEGATE, Variant::COLOR);
+
+	register_op<OperatorEvaluatorEqual<bool, Quat, Quat>>(Variant::OP_EQUAL, Variant::QUAT, Variant::QUAT);
+	register_op<OperatorEvaluatorNotEqual<bool, Quat, Quat>>(Variant::OP_NOT_EQUAL, Variant::QUAT, Variant::QUAT);
+	register_op<OperatorEvaluatorAdd<Quat, Quat, Quat>>(Variant::OP_ADD, Variant::QUAT, Variant::QUAT);
+	register_op<OperatorEvaluatorSub<Quat, Quat, Quat>>(Variant::OP_SUBTRACT, Variant::QUAT, Variant::QUAT);
+	register_unary_op<OperatorEvaluatorNeg<Quat, Quat>>(Variant::OP_NEGATE, Variant::QUAT);
+	register_unary_op<OperatorEvaluatorPos<Quat, Quat>>(Variant::OP_POSITIVE, Variant::QUAT);
+
+	register_op<OperatorEvaluatorEqual<bool, String, String>>(Variant::OP_EQUAL, Variant::STRING, Variant::STRING);
+	register_op<OperatorEvaluatorNotEqual<bool, String, String>>(Variant::OP_NOT_EQUAL, Variant::STRING, Variant::STRING);
+	register_op<OperatorEvaluatorLess<bool, String, String>>(Variant::OP_LESS, Variant::STRING, Variant::STRING);
+	register_op<OperatorEvaluatorLessEqual<bool, String, String>>(Variant::OP_LESS_EQUAL, Variant::STRING, Variant::STRING);
+	register_op<OperatorEvaluatorAdd<String, String, String>>(Variant::OP_ADD, Variant::STRING, Variant::STRING);
+
+	register_op<OperatorEvaluatorEqual<bool, StringName, StringName>>(Variant::OP_EQUAL, Variant::STRING_NAME, Variant::STRING_NAME);
+	register_op<OperatorEvaluatorNotEqual<bool, StringName, StringName>>(Variant::OP_NOT_EQUAL, Variant::STRING_NAME, Variant::STRING_NAME);
+}
+
+Variant::ValidatedOperatorEvaluator Variant::get_validated_operator_evaluator(Operator p_op, Type p_type_a, Type p_type_b) {
+	ERR_FAIL_INDEX_V(p_op, OP_MAX, nullptr);
+	ERR_FAIL_INDEX_V(p_type_a, VARIANT_MAX, nullptr);
+	ERR_FAIL_INDEX_V(p_type_b, VARIANT_MAX, nullptr);
+	if (_is_unary_operator(p_op)) {
+		p_type_b = NIL;
+	}
+	return validated_operator_evaluator_table[p_op][p_type_a][p_type_b];
+}
+
+Variant::Type Variant::get_operator_return_type(Operator p_op, Type p_type_a, Type p_type_b) {
+	ERR_FAIL_INDEX_V(p_op, OP_MAX, NIL);
+	ERR_FAIL_INDEX_V(p_type_a, VARIANT_MAX, NIL);
+	ERR_FAIL_INDEX_V(p_type_b, VARIANT_MAX, NIL);
+	if (_is_unary_operator(p_op)) {
+		p_type_b = NIL;
+	}
+	return operator_return_type_table[p_op][p_type_a][p_type_b];
+}
+
 void Variant::set_named(const StringName &p_index, const Variant &p_value, bool *r_valid) {
 
 	bool valid = false;
@@ -0,0 +1,119 @@
+/*************************************************************************/
+/*  packed_source_pck_posix.cpp                                          */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+
+#if defined(UNIX_ENABLED) && !defined(JAVASCRIPT_ENABLED)
+
+#include "packed_source_pck_posix.h"
+
+#include "core/project_settings.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+PackedSourcePCK *PackedSourcePCKPosix::create_func_posix() {
+
+	return memnew(PackedSourcePCKPosix);
+}
+
+void PackedSourcePCKPosix::make_default() {
+
+	create_func = create_func_posix;
+}
+
+bool PackedSourcePCKPosix::try_open_pack(const String &p_path, bool p_replace_files) {
+
+	if (!PackedSourcePCK::try_open_pack(p_path, p_replace_files)) {
+		return false;
+	}
+
+	if (mappings.has(p_path)) {
+		return true;
+	}
+
+	String path = p_path;
+	if (ProjectSettings::get_singleton()) {
+		path = ProjectSettings::get_singleton()->globalize_path(p_path);
+	}
+
+	int fd = ::open(path.utf8().get_data(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return true; // Directory is registered, files will be read through FileAccess.
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0 || uint64_t(st.st_size) > uint64_t(SIZE_MAX)) {
+		::close(fd);
+		return true;
+	}
+
+	void *data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd); // The mapping keeps its own reference to the file.
+	if (data == MAP_FAILED) {
+		return true;
+	}
+
+	Mapping m;
+	m.data = (uint8_t *)data;
+	m.size = st.st_size;
+	mappings[p_path] = m;
+
+	return true;
+}
+
+FileAccess *PackedSourcePCKPosix::get_file(const String &p_path, PackedData::PackedFile *p_file) {
+
+	const Map<String, Mapping>::Element *E = mappings.find(p_file->pack);
+	if (!E) {
+		return PackedSourcePCK::get_file(p_path, p_file);
+	}
+
+	if (p_file->flags & PACK_FILE_COMPRESSED) {
+		// Bounds are only known after reading the block index, which does its own checks.
+		return memnew(FileAccessPackCompressed(p_path, *p_file, E->get().data, E->get().size));
+	}
+
+	if (p_file->offset + p_file->size > E->get().size) {
+		return PackedSourcePCK::get_file(p_path, p_file);
+	}
+
+	return memnew(FileAccessPack(p_path, *p_file, E->get().data));
+}
+
+PackedSourcePCKPosix::~PackedSourcePCKPosix() {
+
+	for (Map<String, Mapping>::Element *E = mappings.front(); E; E = E->next()) {
+		munmap(E->get().data, size_t(E->get().size));
+	}
+}
+
+#endif
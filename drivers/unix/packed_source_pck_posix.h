@@ -0,0 +1,65 @@
+/*************************************************************************/
+/*  packed_source_pck_posix.h                                            */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+
+#ifndef PACKED_SOURCE_PCK_POSIX_H
+#define PACKED_SOURCE_PCK_POSIX_H
+
+#if defined(UNIX_ENABLED) && !defined(JAVASCRIPT_ENABLED)
+
+#include "core/io/file_access_pack.h"
+#include "core/map.h"
+
+// Maps every opened pack read-only into the address space, so files inside it
+// are served straight from the mapping (see FileAccess::get_buffer_view()).
+// Packs that can't be mapped fall back to regular file reads.
+class PackedSourcePCKPosix : public PackedSourcePCK {
+
+	struct Mapping {
+		uint8_t *data = nullptr;
+		uint64_t size = 0;
+	};
+
+	Map<String, Mapping> mappings;
+
+	static PackedSourcePCK *create_func_posix();
+
+public:
+	virtual bool try_open_pack(const String &p_path, bool p_replace_files);
+	virtual FileAccess *get_file(const String &p_path, PackedData::PackedFile *p_file);
+
+	static void make_default();
+
+	~PackedSourcePCKPosix();
+};
+
+#endif
+
+#endif // PACKED_SOURCE_PCK_POSIX_H
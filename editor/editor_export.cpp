@@ -1004,6 +1004,7 @@ Error EditorExportPlatform::save_pack(const Ref<EditorExportPreset> &p_preset, c
 		header_size += 8; // offset to file _with_ header size included
 		header_size += 8; // size of file
 		header_size += 16; // md5
+		header_size += 4; // flags
 	}
 
 	int header_padding = _get_pad(PCK_PADDING, header_size);
@@ -1022,6 +1023,7 @@ Error EditorExportPlatform::save_pack(const Ref<EditorExportPreset> &p_preset, c
 		f->store_64(pd.file_ofs[i].ofs + header_padding + header_size);
 		f->store_64(pd.file_ofs[i].size); // pay attention here, this is where file is
 		f->store_buffer(pd.file_ofs[i].md5.ptr(), 16); //also save md5 for file
+		f->store_32(0); // flags, files are stored uncompressed
 	}
 
 	for (int i = 0; i < header_padding; i++) {
@@ -39,9 +39,14 @@
 #include "core/io/file_access_zip.h"
 #include "core/io/image_loader.h"
 #include "core/io/ip.h"
+#include "core/io/pck_packer.h"
+#include "core/io/resource_format_binary.h"
 #include "core/io/resource_loader.h"
+#include "core/job_system.h"
+#include "core/math/random_pcg.h"
 #include "core/message_queue.h"
 #include "core/os/dir_access.h"
+#include "core/os/frame_allocator.h"
 #include "core/os/os.h"
 #include "core/project_settings.h"
 #include "core/register_core_types.h"
@@ -100,6 +105,8 @@ static ZipArchive *zip_packed_data = nullptr;
 #endif
 static FileAccessNetworkClient *file_access_network_client = nullptr;
 static MessageQueue *message_queue = nullptr;
+static JobSystem *job_system = nullptr;
+static FrameAllocator *frame_allocator = nullptr;
 
 // Initialized in setup2()
 static AudioServer *audio_server = nullptr;
@@ -321,6 +328,7 @@ void Main::print_help(const char *p_binary) {
 	OS::get_singleton()->print("  -d, --debug                      Debug (local stdout debugger).\n");
 	OS::get_singleton()->print("  -b, --breakpoints                Breakpoint list as source::line comma-separated pairs, no spaces (use %%20 instead).\n");
 	OS::get_singleton()->print("  --profiling                      Enable profiling in the script debugger.\n");
+	OS::get_singleton()->print("  --profile-scripts <file>         Sample GDScript execution and save the profile as folded stacks to the given file on exit (debug builds only).\n");
 	OS::get_singleton()->print("  --gpu-abort                      Abort on GPU errors (usually validation layer errors), may help see the problem if your system freezes.\n");
 	OS::get_singleton()->print("  --remote-debug <address>         Remote debug (<host/IP>:<port> address).\n");
 #if defined(DEBUG_ENABLED) && !defined(SERVER_ENABLED)
@@ -345,6 +353,9 @@ void Main::print_help(const char *p_binary) {
 	OS::get_singleton()->print("  --export-pack <preset> <path>    Same as --export, but only export the game pack for the given preset. The <path> extension determines whether it will be in PCK or ZIP format.\n");
 	OS::get_singleton()->print("  --doctool <path>                 Dump the engine API reference to the given <path> in XML format, merging if existing files are found.\n");
 	OS::get_singleton()->print("  --no-docbase                     Disallow dumping the base types (used with --doctool).\n");
+	OS::get_singleton()->print("  --repack-pck <source> <path>     Rewrite the <source> PCK to <path>, storing files as compressed blocks.\n");
+	OS::get_singleton()->print("  --benchmark-pck <path>           Time reading every file in the given PCK.\n");
+	OS::get_singleton()->print("  --convert-res <path>             Resave the binary resources in the given file or directory to the current format, which aligns their arrays.\n");
 	OS::get_singleton()->print("  --build-solutions                Build the scripting solutions (e.g. for C# projects). Implies --editor and requires a valid project to edit.\n");
 #ifdef DEBUG_METHODS_ENABLED
 	OS::get_singleton()->print("  --gdnative-generate-json-api     Generate JSON dump of the Godot API for GDNative bindings.\n");
@@ -675,6 +686,20 @@ Error Main::setup(const char *execpath, int argc, char *argv[], bool p_second_ph
 
 			use_debug_profiler = true;
 
+		} else if (I->get() == "--profile-scripts") { // sample scripts without the debugger
+
+			if (I->next()) {
+
+				Engine::singleton->script_profile_path = I->next()->get();
+#ifndef DEBUG_ENABLED
+				OS::get_singleton()->print("Warning: --profile-scripts only works in debug builds, ignoring.\n");
+#endif
+				N = I->next()->next();
+			} else {
+				OS::get_singleton()->print("Missing profile output path argument, aborting.\n");
+				goto error;
+			}
+
 		} else if (I->get() == "-l" || I->get() == "--language") { // language
 
 			if (I->next()) {
@@ -1182,6 +1207,11 @@ Error Main::setup(const char *execpath, int argc, char *argv[], bool p_second_ph
 
 	Engine::get_singleton()->set_frame_delay(frame_delay);
 
+	job_system = memnew(JobSystem);
+	job_system->init(GLOBAL_DEF("threading/worker_pool/max_threads", -1));
+	ProjectSettings::get_singleton()->set_custom_property_info("threading/worker_pool/max_threads", PropertyInfo(Variant::INT, "threading/worker_pool/max_threads", PROPERTY_HINT_RANGE, "-1,128,1"));
+
+	frame_allocator = memnew(FrameAllocator);
 	message_queue = memnew(MessageQueue);
 
 	if (p_second_phase)
@@ -1225,6 +1255,10 @@ error:
 
 	if (message_queue)
 		memdelete(message_queue);
+	if (frame_allocator)
+		memdelete(frame_allocator);
+	if (job_system)
+		memdelete(job_system);
 	OS::get_singleton()->finalize_core();
 	locale = String();
 
@@ -1508,6 +1542,183 @@ Error Main::setup2(Thread::ID p_main_tid_override) {
 // everything the main loop needs to know about frame timings
 static MainTimerSync main_timer_sync;
 
+#ifdef TOOLS_ENABLED
+static uint64_t _get_file_size(const String &p_path) {
+
+	FileAccessRef f = FileAccess::open(p_path, FileAccess::READ);
+	return f ? f->get_len() : 0;
+}
+
+// Files are read back through PackedData, so the source pack takes over any
+// path it shares with the project.
+static Error _repack_pck(const String &p_source, const String &p_dest) {
+
+	Vector<PackedSourcePCK::DirectoryEntry> entries;
+	Error err = PackedSourcePCK::read_directory(p_source, entries);
+	ERR_FAIL_COND_V_MSG(err != OK, err, "Can't read the pack directory of '" + p_source + "'.");
+
+	packed_data->set_disabled(false);
+	err = packed_data->add_pack(p_source, true);
+	ERR_FAIL_COND_V_MSG(err != OK, err, "Can't load the pack '" + p_source + "'.");
+
+	Ref<PCKPacker> packer;
+	packer.instance();
+	err = packer->pck_start(p_dest, 0, true);
+	ERR_FAIL_COND_V(err != OK, err);
+
+	for (int i = 0; i < entries.size(); i++) {
+		if (entries[i].file.flags & PACK_FILE_DICTIONARY) {
+			continue; // Files are compressed again without it.
+		}
+		err = packer->add_file(entries[i].path, entries[i].path);
+		ERR_FAIL_COND_V_MSG(err != OK, err, "Can't read '" + entries[i].path + "' from the pack '" + p_source + "'.");
+	}
+
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+	err = packer->flush();
+	ERR_FAIL_COND_V(err != OK, err);
+
+	uint64_t source_size = _get_file_size(p_source);
+	uint64_t dest_size = _get_file_size(p_dest);
+	print_line(vformat("Repacked %d files in %d ms: %s -> %s (%.1f%%).", entries.size(), int((OS::get_singleton()->get_ticks_usec() - from) / 1000),
+			String::humanize_size(source_size), String::humanize_size(dest_size), source_size ? 100.0 * dest_size / source_size : 0.0));
+
+	return OK;
+}
+
+// Reads every file of the pack sequentially, then in small chunks at random
+// offsets, which is what seeking formats do.
+static Error _benchmark_pck(const String &p_path) {
+
+	Vector<PackedSourcePCK::DirectoryEntry> entries;
+	Error err = PackedSourcePCK::read_directory(p_path, entries);
+	ERR_FAIL_COND_V_MSG(err != OK, err, "Can't read the pack directory of '" + p_path + "'.");
+
+	packed_data->set_disabled(false);
+	err = packed_data->add_pack(p_path, true);
+	ERR_FAIL_COND_V_MSG(err != OK, err, "Can't load the pack '" + p_path + "'.");
+
+	const int chunk_size = 64 * 1024;
+	const int random_chunk_size = 4 * 1024;
+	const int random_reads_per_file = 16;
+
+	Vector<uint8_t> buffer;
+	buffer.resize(chunk_size);
+	uint8_t *w = buffer.ptrw();
+
+	int compressed = 0;
+	uint64_t total_size = 0;
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+
+	for (int i = 0; i < entries.size(); i++) {
+		if (entries[i].file.flags & PACK_FILE_DICTIONARY) {
+			continue;
+		}
+		FileAccessRef f = FileAccess::open(entries[i].path, FileAccess::READ);
+		ERR_CONTINUE_MSG(!f, "Can't open '" + entries[i].path + "'.");
+
+		while (f->get_buffer(w, chunk_size) == chunk_size) {
+		}
+		total_size += f->get_len();
+		if (entries[i].file.flags & PACK_FILE_COMPRESSED) {
+			compressed++;
+		}
+	}
+
+	uint64_t sequential_usec = OS::get_singleton()->get_ticks_usec() - from;
+
+	RandomPCG rng;
+	from = OS::get_singleton()->get_ticks_usec();
+
+	for (int i = 0; i < entries.size(); i++) {
+		if (entries[i].file.flags & PACK_FILE_DICTIONARY) {
+			continue;
+		}
+		FileAccessRef f = FileAccess::open(entries[i].path, FileAccess::READ);
+		ERR_CONTINUE(!f);
+
+		uint64_t len = f->get_len();
+		for (int j = 0; j < random_reads_per_file && len > 0; j++) {
+			f->seek(rng.rand() % len);
+			f->get_buffer(w, random_chunk_size);
+		}
+	}
+
+	uint64_t random_usec = OS::get_singleton()->get_ticks_usec() - from;
+
+	print_line(vformat("%s: %d files (%d compressed), %s of data in %s.", p_path, entries.size(), compressed, String::humanize_size(total_size), String::humanize_size(_get_file_size(p_path))));
+	print_line(vformat("Sequential reads: %d ms (%.1f MiB/s).", int(sequential_usec / 1000), sequential_usec ? (total_size / (1024.0 * 1024.0)) / (sequential_usec / 1000000.0) : 0.0));
+	print_line(vformat("Random %s reads: %d ms for %d reads.", String::humanize_size(random_chunk_size), int(random_usec / 1000), entries.size() * random_reads_per_file));
+
+	return OK;
+}
+
+static void _find_binary_resources(const String &p_path, Vector<String> &r_paths) {
+
+	DirAccessRef da = DirAccess::open(p_path);
+	if (!da) {
+		uint8_t magic[4] = {};
+		FileAccessRef f = FileAccess::open(p_path, FileAccess::READ);
+		if (f && f->get_buffer(magic, 4) == 4 && magic[0] == 'R' && magic[1] == 'S' && (magic[2] == 'R' || magic[2] == 'C') && magic[3] == magic[2]) {
+			r_paths.push_back(p_path);
+		}
+		return;
+	}
+
+	da->list_dir_begin();
+	String name = da->get_next();
+	while (name != String()) {
+		if (!name.begins_with(".") || name == ".import") {
+			_find_binary_resources(p_path.plus_file(name), r_paths);
+		}
+		name = da->get_next();
+	}
+	da->list_dir_end();
+}
+
+// Resaving converts older binary resources to the current format revision,
+// which stores plain data arrays aligned so they can be read in place.
+static Error _convert_resources(const String &p_path) {
+
+	Vector<String> paths;
+	_find_binary_resources(ProjectSettings::get_singleton()->localize_path(p_path), paths);
+
+	int converted = 0;
+	int aligned_arrays = 0;
+	uint64_t aligned_size = 0;
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+
+	for (int i = 0; i < paths.size(); i++) {
+		uint8_t magic[4] = {};
+		{
+			FileAccessRef f = FileAccess::open(paths[i], FileAccess::READ);
+			ERR_CONTINUE(!f);
+			f->get_buffer(magic, 4);
+		}
+
+		Error err;
+		RES res = ResourceLoader::load(paths[i], "", true, &err);
+		ERR_CONTINUE_MSG(res.is_null(), "Can't load '" + paths[i] + "'.");
+
+		err = ResourceFormatSaverBinary::singleton->save(paths[i], res, magic[2] == 'C' ? ResourceSaver::FLAG_COMPRESS : 0);
+		ERR_CONTINUE_MSG(err != OK, "Can't save '" + paths[i] + "'.");
+
+		Vector<ResourceLoaderBinary::AlignedArray> arrays;
+		ResourceFormatLoaderBinary::get_aligned_arrays(paths[i], &arrays);
+		for (int j = 0; j < arrays.size(); j++) {
+			aligned_size += arrays[j].size;
+		}
+		aligned_arrays += arrays.size();
+		converted++;
+	}
+
+	print_line(vformat("Converted %d of %d binary resources in %d ms, %d arrays (%s) are now aligned.", converted, paths.size(), int((OS::get_singleton()->get_ticks_usec() - from) / 1000),
+			aligned_arrays, String::humanize_size(aligned_size)));
+
+	return converted == paths.size() ? OK : ERR_CANT_CREATE;
+}
+#endif
+
 bool Main::start() {
 
 	ERR_FAIL_COND_V(!_start_success, false);
@@ -1524,6 +1735,9 @@ bool Main::start() {
 #ifdef TOOLS_ENABLED
 	bool doc_base = true;
 	String _export_preset;
+	String repack_pck;
+	String benchmark_pck;
+	String convert_res;
 	bool export_debug = false;
 	bool export_pack_only = false;
 #endif
@@ -1579,6 +1793,12 @@ bool Main::start() {
 				editor = true;
 				_export_preset = args[i + 1];
 				export_pack_only = true;
+			} else if (args[i] == "--repack-pck") {
+				repack_pck = args[i + 1];
+			} else if (args[i] == "--benchmark-pck") {
+				benchmark_pck = args[i + 1];
+			} else if (args[i] == "--convert-res") {
+				convert_res = args[i + 1];
 #endif
 			} else {
 				// The parameter does not match anything known, don't skip the next argument
@@ -1661,6 +1881,31 @@ bool Main::start() {
 		return false;
 	}
 
+	if (repack_pck != "") {
+		if (positional_arg == "") {
+			ERR_PRINT("Command line includes the --repack-pck option, but no destination path was given.");
+			return false;
+		}
+		if (_repack_pck(repack_pck, positional_arg) != OK) {
+			OS::get_singleton()->set_exit_code(1);
+		}
+		return false;
+	}
+
+	if (benchmark_pck != "") {
+		if (_benchmark_pck(benchmark_pck) != OK) {
+			OS::get_singleton()->set_exit_code(1);
+		}
+		return false;
+	}
+
+	if (convert_res != "") {
+		if (_convert_resources(convert_res) != OK) {
+			OS::get_singleton()->set_exit_code(1);
+		}
+		return false;
+	}
+
 	if (_export_preset != "") {
 		if (positional_arg == "") {
 			String err = "Command line includes export parameter option, but no destination path was given.\n";
@@ -2102,6 +2347,12 @@ bool Main::iteration() {
 
 	iterating++;
 
+	// Nested iterations (e.g. from progress dialogs) can run while the outer
+	// frame still holds frame memory, so only the outermost one starts a frame.
+	if (iterating == 1) {
+		frame_allocator->begin_frame();
+	}
+
 	uint64_t ticks = OS::get_singleton()->get_ticks_usec();
 	Engine::get_singleton()->_frame_ticks = ticks;
 	main_timer_sync.set_cpu_ticks_usec(ticks);
@@ -2368,6 +2619,10 @@ void Main::cleanup() {
 		OS::get_singleton()->set_restart_on_exit(false, List<String>()); //clear list (uses memory)
 	}
 
+	// Servers are gone, nothing else can submit jobs.
+	memdelete(job_system);
+	memdelete(frame_allocator);
+
 	unregister_core_driver_types();
 	unregister_core_types();
 
@@ -0,0 +1,210 @@
+/*************************************************************************/
+/*  test_command_queue.cpp                                               */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_command_queue.h"
+
+#include "core/command_queue_mt.h"
+#include "core/os/os.h"
+#include "core/os/thread.h"
+
+namespace TestCommandQueue {
+
+enum {
+	MAX_PRODUCERS = 16,
+	COMMANDS_PER_PRODUCER = 100000,
+	RET_EVERY = 1000,
+};
+
+// Stands in for a server running on its own thread.
+struct Server {
+	uint32_t last[MAX_PRODUCERS];
+	uint64_t executed = 0;
+	bool out_of_order = false;
+	bool exit = false;
+
+	void command(int p_producer, uint32_t p_index, float p_value) {
+		if (p_index != last[p_producer] + 1) {
+			out_of_order = true;
+		}
+		last[p_producer] = p_index;
+		executed++;
+	}
+
+	int double_value(int p_value) {
+		return p_value * 2;
+	}
+
+	void quit() {
+		exit = true;
+	}
+
+	Server() {
+		for (int i = 0; i < MAX_PRODUCERS; i++) {
+			last[i] = 0;
+		}
+	}
+};
+
+struct Context {
+	CommandQueueMT *queue;
+	Server *server;
+	Mutex *global_lock; // Emulates the single lock CommandQueueMT used to take on every push.
+	int producer;
+	bool ret_failed;
+};
+
+static void _consumer_thread(void *p_ud) {
+
+	Context *ctx = (Context *)p_ud;
+	while (!ctx->server->exit) {
+		ctx->queue->wait_and_flush_one();
+	}
+	ctx->queue->flush_all();
+}
+
+static void _producer_thread(void *p_ud) {
+
+	Context *ctx = (Context *)p_ud;
+	for (uint32_t i = 1; i <= COMMANDS_PER_PRODUCER; i++) {
+		if (ctx->global_lock) {
+			ctx->global_lock->lock();
+		}
+		ctx->queue->push(ctx->server, &Server::command, ctx->producer, i, 1.0f);
+		if (ctx->global_lock) {
+			ctx->global_lock->unlock();
+		}
+
+		if (i % RET_EVERY == 0) {
+			int ret = 0;
+			ctx->queue->push_and_ret(ctx->server, &Server::double_value, (int)i, &ret);
+			if (ret != (int)i * 2) {
+				ctx->ret_failed = true;
+			}
+		}
+	}
+}
+
+static bool _run(int p_producers, bool p_global_lock, uint64_t &r_usec) {
+
+	CommandQueueMT queue(true);
+	Server server;
+	Mutex global_lock;
+
+	Context consumer_ctx;
+	consumer_ctx.queue = &queue;
+	consumer_ctx.server = &server;
+	Thread *consumer = Thread::create(_consumer_thread, &consumer_ctx);
+
+	Context ctx[MAX_PRODUCERS];
+	Thread *producers[MAX_PRODUCERS];
+
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+
+	for (int i = 0; i < p_producers; i++) {
+		ctx[i].queue = &queue;
+		ctx[i].server = &server;
+		ctx[i].global_lock = p_global_lock ? &global_lock : nullptr;
+		ctx[i].producer = i;
+		ctx[i].ret_failed = false;
+		producers[i] = Thread::create(_producer_thread, &ctx[i]);
+	}
+
+	bool ret_failed = false;
+	for (int i = 0; i < p_producers; i++) {
+		Thread::wait_to_finish(producers[i]);
+		memdelete(producers[i]);
+		ret_failed = ret_failed || ctx[i].ret_failed;
+	}
+
+	// Commands run in push order, so once this one returns everything before it ran too.
+	queue.push_and_sync(&server, &Server::quit);
+	r_usec = OS::get_singleton()->get_ticks_usec() - from;
+
+	Thread::wait_to_finish(consumer);
+	memdelete(consumer);
+
+	return !ret_failed && !server.out_of_order && server.executed == uint64_t(p_producers) * COMMANDS_PER_PRODUCER;
+}
+
+bool test_contention() {
+
+	OS::get_singleton()->print("\n\nTest 1: Push throughput from concurrent producers\n");
+	OS::get_singleton()->print("\t%d commands per producer, push_and_ret every %d\n", COMMANDS_PER_PRODUCER, RET_EVERY);
+
+	bool pass = true;
+
+	for (int producers = 1; producers <= MAX_PRODUCERS; producers *= 2) {
+		uint64_t locked_usec = 0;
+		uint64_t usec = 0;
+		pass = _run(producers, true, locked_usec) && pass;
+		pass = _run(producers, false, usec) && pass;
+
+		double total = double(producers) * COMMANDS_PER_PRODUCER;
+		OS::get_singleton()->print("\t%2d producers: global lock %8.2f Mcmd/s, per-producer buffers %8.2f Mcmd/s\n", producers, total / locked_usec, total / usec);
+	}
+
+	return pass;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_contention,
+	nullptr
+
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestCommandQueue
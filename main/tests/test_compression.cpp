@@ -0,0 +1,412 @@
+/*************************************************************************/
+/*  test_compression.cpp                                                 */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_compression.h"
+
+#include "core/io/compression.h"
+#include "core/io/file_access_compressed.h"
+#include "core/io/file_access_pack.h"
+#include "core/io/marshalls.h"
+#include "core/io/pck_packer.h"
+#include "core/math/random_pcg.h"
+#include "core/os/dir_access.h"
+#include "core/os/os.h"
+
+namespace TestCompression {
+
+enum {
+	TRAINING_SAMPLES = 1000,
+	BENCHMARK_SAMPLES = 2000,
+	BENCHMARK_ROUNDS = 10,
+	PACKED_FILES = 64,
+};
+
+static const char *states[] = { "idle", "running", "jumping", "falling", "attacking", "dead" };
+
+// Looks like the state updates games send over the network: a few entities
+// with the same keys, positions and small enums, 64 to 1024 bytes encoded.
+static Vector<uint8_t> _make_payload(RandomPCG &p_rng, int p_entities) {
+
+	Array entities;
+	for (int i = 0; i < p_entities; i++) {
+		Dictionary entity;
+		entity["id"] = int(p_rng.rand() % 64);
+		entity["position"] = Vector3(p_rng.randf() * 100, p_rng.randf() * 10, p_rng.randf() * 100);
+		entity["state"] = states[p_rng.rand() % 6];
+		if (p_rng.rand() % 2) {
+			entity["health"] = int(p_rng.rand() % 101);
+		}
+		entities.push_back(entity);
+	}
+
+	int len = 0;
+	encode_variant(entities, nullptr, len);
+	Vector<uint8_t> payload;
+	payload.resize(len);
+	encode_variant(entities, payload.ptrw(), len);
+	return payload;
+}
+
+static Vector<Vector<uint8_t>> _make_payloads(int p_count, uint64_t p_seed, int p_max_entities) {
+
+	RandomPCG rng(p_seed);
+	Vector<Vector<uint8_t>> payloads;
+	for (int i = 0; i < p_count; i++) {
+		payloads.push_back(_make_payload(rng, 1 + rng.rand() % p_max_entities));
+	}
+	return payloads;
+}
+
+static bool _equal(const Vector<uint8_t> &p_a, const Vector<uint8_t> &p_b) {
+
+	return p_a.size() == p_b.size() && memcmp(p_a.ptr(), p_b.ptr(), p_a.size()) == 0;
+}
+
+static bool _round_trip(const Vector<uint8_t> &p_data, uint32_t p_dictionary, int *r_compressed_size = nullptr) {
+
+	Vector<uint8_t> compressed;
+	compressed.resize(Compression::get_max_compressed_buffer_size(p_data.size(), Compression::MODE_ZSTD));
+	int size = Compression::compress(compressed.ptrw(), p_data.ptr(), p_data.size(), Compression::MODE_ZSTD, p_dictionary);
+	if (size <= 0) {
+		return false;
+	}
+	if (r_compressed_size) {
+		*r_compressed_size = size;
+	}
+
+	Vector<uint8_t> decompressed;
+	decompressed.resize(p_data.size());
+	int ret = Compression::decompress(decompressed.ptrw(), decompressed.size(), compressed.ptr(), size, Compression::MODE_ZSTD, p_dictionary);
+	return ret == p_data.size() && _equal(decompressed, p_data);
+}
+
+static String _get_temp_path(const String &p_file) {
+
+	return OS::get_singleton()->get_cache_path().plus_file(p_file);
+}
+
+bool test_registry() {
+
+	OS::get_singleton()->print("\n\nTest 1: Dictionaries are registered once per content and reference counted\n");
+
+	Vector<uint8_t> dictionary = Compression::train_dictionary(_make_payloads(TRAINING_SAMPLES, 1, 16), 4096);
+	if (dictionary.empty() || dictionary.size() > 4096) {
+		OS::get_singleton()->print("\ttrained dictionary has %d bytes\n", dictionary.size());
+		return false;
+	}
+
+	bool pass = true;
+	uint32_t id = Compression::register_dictionary(dictionary);
+	pass = pass && id != 0 && Compression::has_dictionary(id);
+	pass = pass && Compression::register_dictionary(dictionary) == id;
+
+	Compression::unregister_dictionary(id);
+	pass = pass && Compression::has_dictionary(id);
+	Compression::unregister_dictionary(id);
+	pass = pass && !Compression::has_dictionary(id);
+
+	// Data compressed with a dictionary can't be read without it.
+	id = Compression::register_dictionary(dictionary);
+	Vector<uint8_t> payload = _make_payloads(1, 2, 16)[0];
+	Vector<uint8_t> compressed;
+	compressed.resize(Compression::get_max_compressed_buffer_size(payload.size(), Compression::MODE_ZSTD));
+	int size = Compression::compress(compressed.ptrw(), payload.ptr(), payload.size(), Compression::MODE_ZSTD, id);
+	Compression::unregister_dictionary(id);
+
+	Vector<uint8_t> decompressed;
+	decompressed.resize(payload.size());
+	pass = pass && size > 0;
+	pass = pass && Compression::decompress(decompressed.ptrw(), decompressed.size(), compressed.ptr(), size, Compression::MODE_ZSTD, id) < 0;
+	pass = pass && Compression::decompress(decompressed.ptrw(), decompressed.size(), compressed.ptr(), size, Compression::MODE_ZSTD) < 0;
+
+	// Bytes 0x42 0x61 and 0x41 0x82 hash the same, so this dictionary gets the
+	// same id with different content, and must not be confused with the first.
+	Vector<uint8_t> colliding = dictionary;
+	colliding.write[0] = 0x42;
+	colliding.write[1] = 0x61;
+	id = Compression::register_dictionary(colliding);
+	colliding.write[0] = 0x41;
+	colliding.write[1] = 0x82;
+	pass = pass && id != 0 && Compression::register_dictionary(colliding) == 0;
+	Compression::unregister_dictionary(id);
+	pass = pass && !Compression::has_dictionary(id);
+
+	return pass;
+}
+
+bool test_round_trip() {
+
+	OS::get_singleton()->print("\n\nTest 2: Small payloads round trip with and without a dictionary\n");
+
+	uint32_t id = Compression::register_dictionary(Compression::train_dictionary(_make_payloads(TRAINING_SAMPLES, 1, 16)));
+	Vector<Vector<uint8_t>> payloads = _make_payloads(200, 3, 16);
+
+	bool pass = id != 0;
+	for (int i = 0; i < payloads.size(); i++) {
+		pass = pass && _round_trip(payloads[i], 0) && _round_trip(payloads[i], id);
+	}
+
+	// Content the dictionary knows nothing about must still work.
+	RandomPCG rng(4);
+	Vector<uint8_t> noise;
+	noise.resize(1000);
+	for (int i = 0; i < noise.size(); i++) {
+		noise.write[i] = rng.rand() & 0xff;
+	}
+	pass = pass && _round_trip(noise, id);
+
+	Compression::unregister_dictionary(id);
+	return pass;
+}
+
+bool test_file_access_compressed() {
+
+	OS::get_singleton()->print("\n\nTest 3: FileAccessCompressed stores which dictionary it was written with\n");
+
+	Vector<uint8_t> dictionary = Compression::train_dictionary(_make_payloads(TRAINING_SAMPLES, 1, 16));
+	uint32_t id = Compression::register_dictionary(dictionary);
+	Vector<Vector<uint8_t>> payloads = _make_payloads(100, 5, 16);
+	String path = _get_temp_path("test_compression.bin");
+
+	FileAccessCompressed *fac = memnew(FileAccessCompressed);
+	fac->configure("GCPF", Compression::MODE_ZSTD, 4096, id);
+	if (fac->_open(path, FileAccess::WRITE) != OK) {
+		memdelete(fac);
+		Compression::unregister_dictionary(id);
+		OS::get_singleton()->print("\tcan't write %s\n", path.utf8().get_data());
+		return false;
+	}
+	for (int i = 0; i < payloads.size(); i++) {
+		fac->store_32(payloads[i].size());
+		fac->store_buffer(payloads[i].ptr(), payloads[i].size());
+	}
+	memdelete(fac);
+
+	bool pass = true;
+	fac = memnew(FileAccessCompressed);
+	fac->configure("GCPF");
+	pass = pass && fac->_open(path, FileAccess::READ) == OK;
+	for (int i = 0; pass && i < payloads.size(); i++) {
+		Vector<uint8_t> data;
+		data.resize(fac->get_32());
+		fac->get_buffer(data.ptrw(), data.size());
+		pass = _equal(data, payloads[i]);
+	}
+	memdelete(fac);
+
+	// Without the dictionary the file can't be opened at all.
+	Compression::unregister_dictionary(id);
+	fac = memnew(FileAccessCompressed);
+	fac->configure("GCPF");
+	pass = pass && fac->_open(path, FileAccess::READ) != OK;
+	memdelete(fac);
+
+	DirAccess::remove_file_or_error(path);
+	return pass;
+}
+
+bool test_pck_dictionary() {
+
+	OS::get_singleton()->print("\n\nTest 4: Packs store their dictionary and compress small files with it\n");
+
+	Vector<Vector<uint8_t>> payloads = _make_payloads(PACKED_FILES, 6, 32);
+	Vector<uint8_t> dictionary = Compression::train_dictionary(_make_payloads(TRAINING_SAMPLES, 1, 32));
+	String pack_path = _get_temp_path("test_compression.pck");
+	String plain_pack_path = _get_temp_path("test_compression_plain.pck");
+
+	Vector<String> sources;
+	for (int i = 0; i < payloads.size(); i++) {
+		String source = _get_temp_path("test_compression_" + itos(i) + ".bin");
+		FileAccess *f = FileAccess::open(source, FileAccess::WRITE);
+		if (!f) {
+			OS::get_singleton()->print("\tcan't write source files\n");
+			return false;
+		}
+		f->store_buffer(payloads[i].ptr(), payloads[i].size());
+		memdelete(f);
+		sources.push_back(source);
+	}
+
+	Ref<PCKPacker> packer;
+	packer.instance();
+	packer->pck_start(plain_pack_path, 0, true);
+	for (int i = 0; i < sources.size(); i++) {
+		packer->add_file("res://test_compression/plain_" + itos(i) + ".bin", sources[i]);
+	}
+	packer->flush();
+
+	packer->pck_start(pack_path, 0, true);
+	packer->set_compression_dictionary(dictionary);
+	for (int i = 0; i < sources.size(); i++) {
+		packer->add_file("res://test_compression/" + itos(i) + ".bin", sources[i]);
+	}
+	packer->flush();
+
+	for (int i = 0; i < sources.size(); i++) {
+		DirAccess::remove_file_or_error(sources[i]);
+	}
+
+	Vector<PackedSourcePCK::DirectoryEntry> entries;
+	bool pass = PackedSourcePCK::read_directory(pack_path, entries) == OK;
+	int compressed = 0;
+	for (int i = 0; i < entries.size(); i++) {
+		if (entries[i].file.flags & PACK_FILE_COMPRESSED) {
+			compressed++;
+		}
+	}
+	Vector<PackedSourcePCK::DirectoryEntry> plain_entries;
+	pass = pass && PackedSourcePCK::read_directory(plain_pack_path, plain_entries) == OK;
+	int plain_compressed = 0;
+	for (int i = 0; i < plain_entries.size(); i++) {
+		if (plain_entries[i].file.flags & PACK_FILE_COMPRESSED) {
+			plain_compressed++;
+		}
+	}
+
+	FileAccessRef pack = FileAccess::open(pack_path, FileAccess::READ);
+	FileAccessRef plain_pack = FileAccess::open(plain_pack_path, FileAccess::READ);
+	OS::get_singleton()->print("\t%d files: %d compressed without dictionary (%d bytes), %d with it (%d bytes plus the %d bytes dictionary)\n", payloads.size(),
+			plain_compressed, int(plain_pack ? plain_pack->get_len() : 0), compressed, int(pack ? pack->get_len() - dictionary.size() : 0), dictionary.size());
+	pass = pass && compressed >= plain_compressed;
+
+	pass = pass && PackedData::get_singleton()->add_pack(pack_path, true) == OK;
+	for (int i = 0; pass && i < payloads.size(); i++) {
+		FileAccessRef f = FileAccess::open("res://test_compression/" + itos(i) + ".bin", FileAccess::READ);
+		if (!f || f->get_len() != size_t(payloads[i].size())) {
+			pass = false;
+			break;
+		}
+		Vector<uint8_t> data;
+		data.resize(f->get_len());
+		f->get_buffer(data.ptrw(), data.size());
+		pass = _equal(data, payloads[i]);
+	}
+
+	return pass;
+}
+
+bool test_benchmark() {
+
+	OS::get_singleton()->print("\n\nTest 5: Benchmark, compressing and decompressing small payloads\n");
+
+	static const int sizes[] = { 64, 128, 256, 512, 1024 };
+
+	uint32_t id = Compression::register_dictionary(Compression::train_dictionary(_make_payloads(TRAINING_SAMPLES, 1, 32)));
+	Vector<Vector<uint8_t>> payloads = _make_payloads(BENCHMARK_SAMPLES * 4, 7, 32);
+
+	Vector<uint8_t> compressed;
+	compressed.resize(Compression::get_max_compressed_buffer_size(4096, Compression::MODE_ZSTD));
+	Vector<uint8_t> decompressed;
+	decompressed.resize(4096);
+
+	bool pass = id != 0;
+	for (int s = 0; s < 4; s++) {
+		Vector<Vector<uint8_t>> bucket;
+		for (int i = 0; i < payloads.size() && bucket.size() < BENCHMARK_SAMPLES; i++) {
+			if (payloads[i].size() >= sizes[s] && payloads[i].size() < sizes[s + 1]) {
+				bucket.push_back(payloads[i]);
+			}
+		}
+		if (bucket.empty()) {
+			continue;
+		}
+
+		for (int d = 0; d < 2; d++) {
+			uint32_t dictionary = d ? id : 0;
+			uint64_t raw_size = 0;
+			uint64_t compressed_size = 0;
+			uint64_t compress_usec = 0;
+			uint64_t decompress_usec = 0;
+
+			for (int r = 0; r < BENCHMARK_ROUNDS; r++) {
+				for (int i = 0; i < bucket.size(); i++) {
+					const Vector<uint8_t> &payload = bucket[i];
+					uint64_t from = OS::get_singleton()->get_ticks_usec();
+					int size = Compression::compress(compressed.ptrw(), payload.ptr(), payload.size(), Compression::MODE_ZSTD, dictionary);
+					compress_usec += OS::get_singleton()->get_ticks_usec() - from;
+
+					from = OS::get_singleton()->get_ticks_usec();
+					int ret = Compression::decompress(decompressed.ptrw(), payload.size(), compressed.ptr(), size, Compression::MODE_ZSTD, dictionary);
+					decompress_usec += OS::get_singleton()->get_ticks_usec() - from;
+
+					pass = pass && size > 0 && ret == payload.size();
+					raw_size += payload.size();
+					compressed_size += size;
+				}
+			}
+
+			OS::get_singleton()->print("\t%4d-%4d bytes, %s: ratio %5.3f, compress %7.1f MiB/s, decompress %7.1f MiB/s\n", sizes[s], sizes[s + 1] - 1, d ? "dictionary   " : "no dictionary",
+					double(compressed_size) / raw_size, raw_size / (1024.0 * 1024.0) / (compress_usec / 1000000.0), raw_size / (1024.0 * 1024.0) / (decompress_usec / 1000000.0));
+		}
+	}
+
+	Compression::unregister_dictionary(id);
+	return pass;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_registry,
+	test_round_trip,
+	test_file_access_compressed,
+	test_pck_dictionary,
+	test_benchmark,
+	nullptr
+
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestCompression
@@ -0,0 +1,362 @@
+/*************************************************************************/
+/*  test_file_access_pack.cpp                                            */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+
+#include "test_file_access_pack.h"
+
+#include "core/io/file_access_memory.h"
+#include "core/io/file_access_pack.h"
+#include "core/io/pck_packer.h"
+#include "core/math/random_pcg.h"
+#include "core/os/dir_access.h"
+#include "core/os/os.h"
+
+namespace TestFileAccessPack {
+
+enum {
+	SMALL_FILE_SIZE = 1000,
+	LARGE_FILE_SIZE = 8 * 1024 * 1024 + 12345, // Not a multiple of the compressed block size.
+	CHUNK_SIZE = 64 * 1024,
+	BENCHMARK_ROUNDS = 20,
+};
+
+static const char *small_res_path = "res://test_file_access_pack/small.bin";
+static const char *large_res_path = "res://test_file_access_pack/large.bin";
+static const char *compressed_res_path = "res://test_file_access_pack/compressed/large.bin";
+
+// Random letters out of 16, so it compresses to about half without making decompression trivial.
+static Vector<uint8_t> _make_data(int p_size, uint8_t p_seed) {
+
+	RandomPCG rng(p_seed);
+	Vector<uint8_t> data;
+	data.resize(p_size);
+	uint8_t *w = data.ptrw();
+	for (int i = 0; i < p_size; i++) {
+		w[i] = 'a' + (rng.rand() & 0x0f);
+	}
+	return data;
+}
+
+static String _get_temp_path(const String &p_file) {
+
+	return OS::get_singleton()->get_cache_path().plus_file(p_file);
+}
+
+static bool _write_file(const String &p_path, const Vector<uint8_t> &p_data) {
+
+	FileAccess *f = FileAccess::open(p_path, FileAccess::WRITE);
+	if (!f) {
+		return false;
+	}
+	f->store_buffer(p_data.ptr(), p_data.size());
+	memdelete(f);
+	return true;
+}
+
+static bool _pack_ready = false;
+static uint64_t _pack_size = 0;
+static uint64_t _compressed_pack_size = 0;
+
+static uint64_t _get_file_size(const String &p_path) {
+
+	FileAccessRef f = FileAccess::open(p_path, FileAccess::READ);
+	return f ? f->get_len() : 0;
+}
+
+// Packs a small and a large file, plus a compressed copy of the large one, and registers both packs, once.
+static bool _setup_pack() {
+
+	if (_pack_ready) {
+		return true;
+	}
+
+	String small_src = _get_temp_path("test_file_access_pack_small.bin");
+	String large_src = _get_temp_path("test_file_access_pack_large.bin");
+	String pack_path = _get_temp_path("test_file_access_pack.pck");
+	String compressed_pack_path = _get_temp_path("test_file_access_pack_compressed.pck");
+
+	if (!_write_file(small_src, _make_data(SMALL_FILE_SIZE, 1)) || !_write_file(large_src, _make_data(LARGE_FILE_SIZE, 2))) {
+		OS::get_singleton()->print("\tcan't write source files\n");
+		return false;
+	}
+
+	Ref<PCKPacker> packer;
+	packer.instance();
+	packer->pck_start(pack_path);
+	packer->add_file(small_res_path, small_src);
+	packer->add_file(large_res_path, large_src);
+	packer->flush();
+
+	packer->pck_start(compressed_pack_path, 0, true);
+	packer->add_file(compressed_res_path, large_src);
+	packer->flush();
+
+	DirAccess::remove_file_or_error(small_src);
+	DirAccess::remove_file_or_error(large_src);
+
+	if (PackedData::get_singleton()->add_pack(pack_path, true) != OK || PackedData::get_singleton()->add_pack(compressed_pack_path, true) != OK) {
+		OS::get_singleton()->print("\tcan't load packs\n");
+		return false;
+	}
+
+	_pack_size = _get_file_size(pack_path);
+	_compressed_pack_size = _get_file_size(compressed_pack_path);
+	_pack_ready = true;
+	return true;
+}
+
+bool test_memory_view() {
+
+	OS::get_singleton()->print("\n\nTest 1: FileAccessMemory views match get_buffer()\n");
+
+	Vector<uint8_t> data = _make_data(SMALL_FILE_SIZE, 3);
+	FileAccessMemory *f = memnew(FileAccessMemory);
+	f->open_custom(data.ptr(), data.size());
+
+	bool pass = true;
+
+	f->seek(10);
+	const uint8_t *view = f->get_buffer_view(100);
+	pass = view == data.ptr() + 10 && f->get_position() == 110 && pass;
+
+	// Out of range views fail without moving the position.
+	pass = f->get_buffer_view(SMALL_FILE_SIZE) == nullptr && f->get_position() == 110 && pass;
+
+	uint8_t buf[16];
+	f->get_buffer(buf, 16);
+	pass = memcmp(buf, data.ptr() + 110, 16) == 0 && pass;
+
+	memdelete(f);
+	return pass;
+}
+
+bool test_pack_reads() {
+
+	OS::get_singleton()->print("\n\nTest 2: Files read from a pack match their source\n");
+
+	if (!_setup_pack()) {
+		return false;
+	}
+
+	FileAccess *f = FileAccess::open(small_res_path, FileAccess::READ);
+	if (!f) {
+		OS::get_singleton()->print("\tcan't open %s\n", small_res_path);
+		return false;
+	}
+
+	Vector<uint8_t> expected = _make_data(SMALL_FILE_SIZE, 1);
+	bool pass = f->get_len() == SMALL_FILE_SIZE;
+
+	Vector<uint8_t> data;
+	data.resize(SMALL_FILE_SIZE);
+	pass = f->get_buffer(data.ptrw(), SMALL_FILE_SIZE) == SMALL_FILE_SIZE && pass;
+	pass = memcmp(data.ptr(), expected.ptr(), SMALL_FILE_SIZE) == 0 && pass;
+
+	f->seek(5);
+	pass = f->get_8() == expected[5] && pass;
+
+	// Views are optional, but must agree with get_buffer() when available.
+	f->seek(0);
+	const uint8_t *view = f->get_buffer_view(SMALL_FILE_SIZE);
+	if (view) {
+		pass = memcmp(view, expected.ptr(), SMALL_FILE_SIZE) == 0 && f->get_position() == SMALL_FILE_SIZE && pass;
+		pass = f->get_buffer_view(1) == nullptr && pass;
+	}
+	OS::get_singleton()->print("\tzero-copy views %s\n", view ? "available" : "not available");
+
+	memdelete(f);
+	return pass;
+}
+
+bool test_compressed_reads() {
+
+	OS::get_singleton()->print("\n\nTest 3: Compressed files read back the same, in order and after seeks\n");
+
+	if (!_setup_pack()) {
+		return false;
+	}
+
+	FileAccess *f = FileAccess::open(compressed_res_path, FileAccess::READ);
+	if (!f) {
+		OS::get_singleton()->print("\tcan't open %s\n", compressed_res_path);
+		return false;
+	}
+
+	OS::get_singleton()->print("\tpack size %d KiB, compressed pack size %d KiB\n", int(_pack_size / 1024), int(_compressed_pack_size / 1024));
+	bool pass = f->get_len() == LARGE_FILE_SIZE && _compressed_pack_size < _pack_size;
+
+	Vector<uint8_t> expected = _make_data(LARGE_FILE_SIZE, 2);
+	const uint8_t *r = expected.ptr();
+
+	// Odd sized reads, so they straddle block boundaries.
+	Vector<uint8_t> buffer;
+	buffer.resize(10007);
+	uint8_t *w = buffer.ptrw();
+	int ofs = 0;
+	while (ofs < LARGE_FILE_SIZE) {
+		int read = f->get_buffer(w, buffer.size());
+		if (read <= 0 || memcmp(w, &r[ofs], read) != 0) {
+			pass = false;
+			break;
+		}
+		ofs += read;
+	}
+	pass = ofs == LARGE_FILE_SIZE && f->eof_reached() && pass;
+
+	RandomPCG rng(3);
+	for (int i = 0; i < 200; i++) {
+		int pos = rng.rand() % LARGE_FILE_SIZE;
+		f->seek(pos);
+		int read = f->get_buffer(w, 3000);
+		pass = read == MIN(3000, LARGE_FILE_SIZE - pos) && memcmp(w, &r[pos], read) == 0 && pass;
+	}
+
+	// Byte reads across a block boundary.
+	f->seek(CHUNK_SIZE - 2);
+	for (int i = 0; i < 4; i++) {
+		pass = f->get_8() == r[CHUNK_SIZE - 2 + i] && pass;
+	}
+
+	f->seek(LARGE_FILE_SIZE);
+	f->get_8();
+	pass = f->eof_reached() && pass;
+
+	memdelete(f);
+	return pass;
+}
+
+bool test_benchmark() {
+
+	OS::get_singleton()->print("\n\nTest 4: Benchmark reading a %d MiB file from a pack in %d KiB chunks\n", LARGE_FILE_SIZE / (1024 * 1024), CHUNK_SIZE / 1024);
+
+	if (!_setup_pack()) {
+		return false;
+	}
+
+	Vector<uint8_t> buffer;
+	buffer.resize(CHUNK_SIZE);
+	uint8_t *w = buffer.ptrw();
+
+	uint32_t copy_sum = 0;
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < BENCHMARK_ROUNDS; i++) {
+		FileAccess *f = FileAccess::open(large_res_path, FileAccess::READ);
+		ERR_FAIL_COND_V(!f, false);
+		for (int ofs = 0; ofs < LARGE_FILE_SIZE; ofs += CHUNK_SIZE) {
+			f->get_buffer(w, CHUNK_SIZE);
+			copy_sum += w[0];
+		}
+		memdelete(f);
+	}
+	uint64_t copy_usec = OS::get_singleton()->get_ticks_usec() - from;
+
+	uint32_t view_sum = 0;
+	bool has_view = true;
+	from = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < BENCHMARK_ROUNDS && has_view; i++) {
+		FileAccess *f = FileAccess::open(large_res_path, FileAccess::READ);
+		ERR_FAIL_COND_V(!f, false);
+		for (int ofs = 0; ofs < LARGE_FILE_SIZE; ofs += CHUNK_SIZE) {
+			const uint8_t *view = f->get_buffer_view(MIN(CHUNK_SIZE, LARGE_FILE_SIZE - ofs));
+			if (!view) {
+				has_view = false;
+				break;
+			}
+			view_sum += view[0];
+		}
+		memdelete(f);
+	}
+	uint64_t view_usec = OS::get_singleton()->get_ticks_usec() - from;
+
+	uint32_t compressed_sum = 0;
+	from = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < BENCHMARK_ROUNDS; i++) {
+		FileAccess *f = FileAccess::open(compressed_res_path, FileAccess::READ);
+		ERR_FAIL_COND_V(!f, false);
+		for (int ofs = 0; ofs < LARGE_FILE_SIZE; ofs += CHUNK_SIZE) {
+			f->get_buffer(w, CHUNK_SIZE);
+			compressed_sum += w[0];
+		}
+		memdelete(f);
+	}
+	uint64_t compressed_usec = OS::get_singleton()->get_ticks_usec() - from;
+
+	OS::get_singleton()->print("\tget_buffer: %d msec\n", int(copy_usec / 1000));
+	OS::get_singleton()->print("\tget_buffer, compressed: %d msec\n", int(compressed_usec / 1000));
+	if (compressed_sum != copy_sum) {
+		return false;
+	}
+	if (!has_view) {
+		OS::get_singleton()->print("\tget_buffer_view: not available\n");
+		return true;
+	}
+	OS::get_singleton()->print("\tget_buffer_view: %d msec\n", int(view_usec / 1000));
+
+	return copy_sum == view_sum;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_memory_view,
+	test_pack_reads,
+	test_compressed_reads,
+	test_benchmark,
+	nullptr
+
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestFileAccessPack
@@ -0,0 +1,260 @@
+/*************************************************************************/
+/*  test_frame_allocator.cpp                                             */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_frame_allocator.h"
+
+#include "core/os/frame_allocator.h"
+#include "core/os/os.h"
+#include "core/os/thread.h"
+#include "core/vector.h"
+
+#include <string.h>
+
+namespace TestFrameAllocator {
+
+enum {
+	BLOCK_SIZE = 4096,
+	OVERFLOW_ALLOCATIONS = 3,
+	OVERFLOW_SIZE = 3000,
+	THREADS = 4,
+	ALLOCATIONS_PER_THREAD = 2000,
+};
+
+bool test_alignment() {
+
+	OS::get_singleton()->print("\n\nTest 1: Allocations are aligned as requested\n");
+
+	FrameAllocator allocator(BLOCK_SIZE);
+	int misaligned = 0;
+	int count = 0;
+
+	for (size_t align = 1; align <= 256; align *= 2) {
+		for (size_t size = 1; size <= 100; size += 7) {
+			uint8_t *ptr = (uint8_t *)allocator.alloc(size, align);
+			if (!ptr || uintptr_t(ptr) % align != 0) {
+				misaligned++;
+			}
+			memset(ptr, 0xFF, size);
+			count++;
+		}
+	}
+
+	struct alignas(64) Aligned {
+		uint8_t data[24];
+	};
+	for (int i = 0; i < 16; i++) {
+		Aligned *array = allocator.alloc_array<Aligned>(i + 1);
+		if (uintptr_t(array) % alignof(Aligned) != 0) {
+			misaligned++;
+		}
+		count++;
+	}
+
+	OS::get_singleton()->print("\t%d allocations, %d misaligned\n", count, misaligned);
+	return misaligned == 0;
+}
+
+bool test_overflow() {
+
+	OS::get_singleton()->print("\n\nTest 2: Blocks added when a frame overflows are merged on reset\n");
+
+	FrameAllocator allocator(BLOCK_SIZE);
+	uint8_t *ptrs[OVERFLOW_ALLOCATIONS];
+
+	for (int i = 0; i < OVERFLOW_ALLOCATIONS; i++) {
+		ptrs[i] = (uint8_t *)allocator.alloc(OVERFLOW_SIZE);
+		memset(ptrs[i], i + 1, OVERFLOW_SIZE);
+	}
+
+	// Each allocation needed a block of its own.
+	bool pass = allocator.get_used_bytes() >= OVERFLOW_ALLOCATIONS * OVERFLOW_SIZE;
+	for (int i = 0; i < OVERFLOW_ALLOCATIONS; i++) {
+		pass = pass && ptrs[i][0] == i + 1 && ptrs[i][OVERFLOW_SIZE - 1] == i + 1;
+	}
+
+	// The arena is rewound two frames later, as a single block that fits the
+	// whole frame, so the same allocations are contiguous this time.
+	allocator.begin_frame();
+	allocator.begin_frame();
+
+	uint8_t *first = (uint8_t *)allocator.alloc(OVERFLOW_SIZE);
+	bool contiguous = true;
+	for (int i = 1; i < OVERFLOW_ALLOCATIONS; i++) {
+		uint8_t *ptr = (uint8_t *)allocator.alloc(OVERFLOW_SIZE);
+		contiguous = contiguous && ptr == first + i * ((OVERFLOW_SIZE + 15) & ~15);
+	}
+
+	OS::get_singleton()->print("\tused %d bytes, %s after reset\n", int(allocator.get_used_bytes()), contiguous ? "contiguous" : "not contiguous");
+	return pass && contiguous && allocator.get_used_bytes() <= OVERFLOW_ALLOCATIONS * ((OVERFLOW_SIZE + 15) & ~15);
+}
+
+bool test_lifetime() {
+
+	OS::get_singleton()->print("\n\nTest 3: Allocations live until the end of the next frame\n");
+
+	FrameAllocator allocator(BLOCK_SIZE);
+
+	uint64_t frame = allocator.get_frame();
+	uint8_t *ptr = (uint8_t *)allocator.alloc(64);
+	memset(ptr, 0xAB, 64);
+
+	allocator.begin_frame();
+	bool pass = allocator.is_frame_alive(frame);
+	for (int i = 0; i < 64; i++) {
+		pass = pass && ptr[i] == 0xAB;
+	}
+
+	allocator.begin_frame();
+	pass = pass && !allocator.is_frame_alive(frame);
+#ifdef DEBUG_ENABLED
+	// Rewound memory is poisoned, stale reads don't look like valid data.
+	for (int i = 0; i < 64; i++) {
+		pass = pass && ptr[i] == 0xDD;
+	}
+#endif
+
+	// FrameVector goes through the engine's allocator, and checks the frame
+	// of its data on access in debug builds.
+	FrameAllocator *singleton = FrameAllocator::get_singleton();
+	Vector<int> source;
+	for (int i = 0; i < 1000; i++) {
+		source.push_back(i);
+	}
+
+	{
+		FrameVector<int> values;
+		values.assign(source);
+		uint64_t values_frame = singleton->get_frame();
+
+		singleton->begin_frame();
+		pass = pass && singleton->is_frame_alive(values_frame) && values.size() == 1000;
+		for (uint32_t i = 0; i < values.size(); i++) {
+			pass = pass && values[i] == int(i);
+		}
+
+		singleton->begin_frame();
+		pass = pass && !singleton->is_frame_alive(values_frame);
+	}
+
+	return pass;
+}
+
+struct ThreadData {
+	FrameAllocator *allocator;
+	uint8_t pattern;
+	uint8_t *ptrs[ALLOCATIONS_PER_THREAD];
+};
+
+static void _allocate(void *p_userdata) {
+
+	ThreadData *data = (ThreadData *)p_userdata;
+	for (int i = 0; i < ALLOCATIONS_PER_THREAD; i++) {
+		size_t size = 8 + (i % 64);
+		data->ptrs[i] = (uint8_t *)data->allocator->alloc(size, 8);
+		memset(data->ptrs[i], data->pattern, size);
+	}
+}
+
+bool test_threads() {
+
+	OS::get_singleton()->print("\n\nTest 4: %d threads allocate from the same frame\n", THREADS);
+
+	FrameAllocator allocator(BLOCK_SIZE);
+	ThreadData *data = memnew_arr(ThreadData, THREADS);
+	Thread *threads[THREADS];
+
+	for (int i = 0; i < THREADS; i++) {
+		data[i].allocator = &allocator;
+		data[i].pattern = uint8_t(i + 1);
+		threads[i] = Thread::create(_allocate, &data[i]);
+	}
+	for (int i = 0; i < THREADS; i++) {
+		Thread::wait_to_finish(threads[i]);
+		memdelete(threads[i]);
+	}
+
+	// Overlapping allocations would have overwritten each other's pattern.
+	int overwritten = 0;
+	for (int i = 0; i < THREADS; i++) {
+		for (int j = 0; j < ALLOCATIONS_PER_THREAD; j++) {
+			size_t size = 8 + (j % 64);
+			for (size_t k = 0; k < size; k++) {
+				if (data[i].ptrs[j][k] != data[i].pattern) {
+					overwritten++;
+					break;
+				}
+			}
+		}
+	}
+
+	memdelete_arr(data);
+
+	OS::get_singleton()->print("\t%d allocations, %d overwritten\n", THREADS * ALLOCATIONS_PER_THREAD, overwritten);
+	return overwritten == 0;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_alignment,
+	test_overflow,
+	test_lifetime,
+	test_threads,
+	nullptr
+
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestFrameAllocator
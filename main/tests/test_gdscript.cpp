@@ -38,8 +38,10 @@
 #ifdef MODULE_GDSCRIPT_ENABLED
 
 #include "modules/gdscript/gdscript.h"
+#include "modules/gdscript/gdscript_compiled_buffer.h"
 #include "modules/gdscript/gdscript_compiler.h"
 #include "modules/gdscript/gdscript_parser.h"
+#include "modules/gdscript/gdscript_sampling_profiler.h"
 #include "modules/gdscript/gdscript_tokenizer.h"
 
 namespace TestGDScript {
@@ -524,7 +526,7 @@ static String _disassemble_addr(const Ref<GDScript> &p_script, const GDScriptFun
 		} break;
 		case GDScriptFunction::ADDR_TYPE_GLOBAL: {
 
-			return "global(" + func.get_global_name(addr) + ")";
+			return "global(" + func.get_global_variable_name(addr) + ")";
 		} break;
 		case GDScriptFunction::ADDR_TYPE_NIL: {
 			return "nil";
@@ -534,401 +536,546 @@ static String _disassemble_addr(const Ref<GDScript> &p_script, const GDScriptFun
 	return "<err>";
 }
 
-static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String> &p_code) {
+#define DADDR(m_ip) (_disassemble_addr(p_class, func, code[ip + m_ip]))
 
-	const Map<StringName, GDScriptFunction *> &mf = p_class->debug_get_member_functions();
+// Returns the size of the instruction at ip, or 0 if the opcode is unknown.
+static int _disassemble_instruction(const Ref<GDScript> &p_class, const GDScriptFunction &func, const Vector<String> &p_code, int ip, String &r_txt) {
 
-	for (const Map<StringName, GDScriptFunction *>::Element *E = mf.front(); E; E = E->next()) {
+	const int *code = func.get_code();
+	int incr = 0;
+	String txt = itos(ip) + " ";
 
-		const GDScriptFunction &func = *E->get();
-		const int *code = func.get_code();
-		int codelen = func.get_code_size();
-		String defargs;
-		if (func.get_default_argument_count()) {
-			defargs = "defarg at: ";
-			for (int i = 0; i < func.get_default_argument_count(); i++) {
+	switch (code[ip]) {
 
-				if (i > 0)
-					defargs += ",";
-				defargs += itos(func.get_default_argument_addr(i));
+		case GDScriptFunction::OPCODE_OPERATOR: {
+
+			int op = code[ip + 1];
+			txt += " op ";
+
+			String opname = Variant::get_operator_name(Variant::Operator(op));
+
+			txt += DADDR(4);
+			txt += " = ";
+			txt += DADDR(2);
+			txt += " " + opname + " ";
+			txt += DADDR(3);
+			incr += 5;
+
+		} break;
+		case GDScriptFunction::OPCODE_OPERATOR_VALIDATED: {
+
+			const GDScriptFunction::ValidatedOperator &vop = func.get_validated_operator(code[ip + 1]);
+			txt += " op-validated ";
+			txt += DADDR(4);
+			txt += " = ";
+			txt += DADDR(2);
+			txt += " " + Variant::get_operator_name(vop.op) + " ";
+			txt += DADDR(3);
+			txt += " (" + Variant::get_type_name(vop.type_a) + ", " + Variant::get_type_name(vop.type_b) + ")";
+			incr += 5;
+
+		} break;
+		case GDScriptFunction::OPCODE_OPERATOR_INT:
+		case GDScriptFunction::OPCODE_OPERATOR_FLOAT: {
+
+			txt += code[ip] == GDScriptFunction::OPCODE_OPERATOR_INT ? " op-int " : " op-float ";
+			txt += DADDR(4);
+			txt += " = ";
+			txt += DADDR(2);
+			txt += " " + Variant::get_operator_name(Variant::Operator(code[ip + 1])) + " ";
+			txt += DADDR(3);
+			incr += 5;
+
+		} break;
+		case GDScriptFunction::OPCODE_SET_INDEXED_VALIDATED: {
+
+			txt += "set-indexed ";
+			txt += DADDR(1);
+			txt += "[";
+			txt += DADDR(2);
+			txt += "]=";
+			txt += DADDR(3);
+			incr += 4;
+
+		} break;
+		case GDScriptFunction::OPCODE_SET: {
+
+			txt += "set ";
+			txt += DADDR(1);
+			txt += "[";
+			txt += DADDR(2);
+			txt += "]=";
+			txt += DADDR(3);
+			incr += 4;
+
+		} break;
+		case GDScriptFunction::OPCODE_GET_INDEXED_VALIDATED: {
+
+			txt += " get-indexed ";
+			txt += DADDR(3);
+			txt += "=";
+			txt += DADDR(1);
+			txt += "[";
+			txt += DADDR(2);
+			txt += "]";
+			incr += 4;
+
+		} break;
+		case GDScriptFunction::OPCODE_GET: {
+
+			txt += " get ";
+			txt += DADDR(3);
+			txt += "=";
+			txt += DADDR(1);
+			txt += "[";
+			txt += DADDR(2);
+			txt += "]";
+			incr += 4;
+
+		} break;
+		case GDScriptFunction::OPCODE_SET_NAMED: {
+
+			txt += " set_named ";
+			txt += DADDR(1);
+			txt += "[\"";
+			txt += func.get_global_name(code[ip + 2]);
+			txt += "\"]=";
+			txt += DADDR(3);
+			incr += 4;
+
+		} break;
+		case GDScriptFunction::OPCODE_GET_NAMED: {
+
+			txt += " get_named ";
+			txt += DADDR(3);
+			txt += "=";
+			txt += DADDR(1);
+			txt += "[\"";
+			txt += func.get_global_name(code[ip + 2]);
+			txt += "\"]";
+			incr += 4;
+
+		} break;
+		case GDScriptFunction::OPCODE_INCREMENT_INT: {
+
+			txt += " increment ";
+			txt += DADDR(1);
+			txt += " += ";
+			txt += DADDR(2);
+			incr += 3;
+
+		} break;
+		case GDScriptFunction::OPCODE_SET_MEMBER: {
+
+			txt += " set_member ";
+			txt += "[\"";
+			txt += func.get_global_name(code[ip + 1]);
+			txt += "\"]=";
+			txt += DADDR(2);
+			incr += 3;
+
+		} break;
+		case GDScriptFunction::OPCODE_GET_MEMBER_CALL: {
+
+			String call_txt;
+			int call_incr = _disassemble_instruction(p_class, func, p_code, ip + 2, call_txt);
+			if (call_incr == 0) {
+				break;
 			}
-			defargs += " ";
-		}
-		print_line("== function " + String(func.get_name()) + "() :: stack size: " + itos(func.get_max_stack_size()) + " " + defargs + "==");
 
-#define DADDR(m_ip) (_disassemble_addr(p_class, func, code[ip + m_ip]))
+			txt += " get_member ";
+			txt += DADDR(4);
+			txt += "=";
+			txt += "[\"";
+			txt += func.get_global_name(code[ip + 1]);
+			txt += "\"], ";
+			txt += call_txt.substr(call_txt.find(" ") + 1, call_txt.length());
+			incr = 2 + call_incr;
 
-		for (int ip = 0; ip < codelen;) {
+		} break;
+		case GDScriptFunction::OPCODE_GET_MEMBER: {
 
-			int incr = 0;
-			String txt = itos(ip) + " ";
+			txt += " get_member ";
+			txt += DADDR(2);
+			txt += "=";
+			txt += "[\"";
+			txt += func.get_global_name(code[ip + 1]);
+			txt += "\"]";
+			incr += 3;
 
-			switch (code[ip]) {
+		} break;
+		case GDScriptFunction::OPCODE_ASSIGN: {
 
-				case GDScriptFunction::OPCODE_OPERATOR: {
+			txt += " assign ";
+			txt += DADDR(1);
+			txt += "=";
+			txt += DADDR(2);
+			incr += 3;
 
-					int op = code[ip + 1];
-					txt += " op ";
+		} break;
+		case GDScriptFunction::OPCODE_ASSIGN_TRUE: {
 
-					String opname = Variant::get_operator_name(Variant::Operator(op));
+			txt += " assign ";
+			txt += DADDR(1);
+			txt += "= true";
+			incr += 2;
 
-					txt += DADDR(4);
-					txt += " = ";
-					txt += DADDR(2);
-					txt += " " + opname + " ";
-					txt += DADDR(3);
-					incr += 5;
+		} break;
+		case GDScriptFunction::OPCODE_ASSIGN_FALSE: {
 
-				} break;
-				case GDScriptFunction::OPCODE_SET: {
+			txt += " assign ";
+			txt += DADDR(1);
+			txt += "= false";
+			incr += 2;
 
-					txt += "set ";
-					txt += DADDR(1);
-					txt += "[";
-					txt += DADDR(2);
-					txt += "]=";
-					txt += DADDR(3);
-					incr += 4;
+		} break;
+		case GDScriptFunction::OPCODE_ASSIGN_TYPED_BUILTIN: {
 
-				} break;
-				case GDScriptFunction::OPCODE_GET: {
+			txt += " assign typed builtin (";
+			txt += Variant::get_type_name((Variant::Type)code[ip + 1]);
+			txt += ") ";
+			txt += DADDR(2);
+			txt += " = ";
+			txt += DADDR(3);
+			incr += 4;
 
-					txt += " get ";
-					txt += DADDR(3);
-					txt += "=";
-					txt += DADDR(1);
-					txt += "[";
-					txt += DADDR(2);
-					txt += "]";
-					incr += 4;
+		} break;
+		case GDScriptFunction::OPCODE_ASSIGN_TYPED_NATIVE: {
 
-				} break;
-				case GDScriptFunction::OPCODE_SET_NAMED: {
+			txt += " assign typed native (";
+			txt += DADDR(1);
+			txt += ") ";
+			txt += DADDR(2);
+			txt += " = ";
+			txt += DADDR(3);
+			incr += 4;
 
-					txt += " set_named ";
-					txt += DADDR(1);
-					txt += "[\"";
-					txt += func.get_global_name(code[ip + 2]);
-					txt += "\"]=";
-					txt += DADDR(3);
-					incr += 4;
+		} break;
+		case GDScriptFunction::OPCODE_CAST_TO_BUILTIN: {
 
-				} break;
-				case GDScriptFunction::OPCODE_GET_NAMED: {
+			txt += " cast ";
+			txt += DADDR(3);
+			txt += "=";
+			txt += DADDR(2);
+			txt += " as ";
+			txt += Variant::get_type_name(Variant::Type(code[ip + 1]));
+			incr += 4;
 
-					txt += " get_named ";
-					txt += DADDR(3);
-					txt += "=";
-					txt += DADDR(1);
-					txt += "[\"";
-					txt += func.get_global_name(code[ip + 2]);
-					txt += "\"]";
-					incr += 4;
+		} break;
+		case GDScriptFunction::OPCODE_CAST_TO_NATIVE: {
 
-				} break;
-				case GDScriptFunction::OPCODE_SET_MEMBER: {
+			txt += " cast ";
+			txt += DADDR(3);
+			txt += "=";
+			txt += DADDR(2);
+			txt += " as ";
+			txt += DADDR(1);
+			incr += 4;
 
-					txt += " set_member ";
-					txt += "[\"";
-					txt += func.get_global_name(code[ip + 1]);
-					txt += "\"]=";
-					txt += DADDR(2);
-					incr += 3;
+		} break;
+		case GDScriptFunction::OPCODE_CAST_TO_SCRIPT: {
 
-				} break;
-				case GDScriptFunction::OPCODE_GET_MEMBER: {
+			txt += " cast ";
+			txt += DADDR(3);
+			txt += "=";
+			txt += DADDR(1);
+			txt += " as ";
+			txt += DADDR(2);
+			incr += 4;
 
-					txt += " get_member ";
-					txt += DADDR(2);
-					txt += "=";
-					txt += "[\"";
-					txt += func.get_global_name(code[ip + 1]);
-					txt += "\"]";
-					incr += 3;
+		} break;
+		case GDScriptFunction::OPCODE_CONSTRUCT: {
 
-				} break;
-				case GDScriptFunction::OPCODE_ASSIGN: {
+			Variant::Type t = Variant::Type(code[ip + 1]);
+			int argc = code[ip + 2];
 
-					txt += " assign ";
-					txt += DADDR(1);
-					txt += "=";
-					txt += DADDR(2);
-					incr += 3;
+			txt += " construct ";
+			txt += DADDR(3 + argc);
+			txt += " = ";
 
-				} break;
-				case GDScriptFunction::OPCODE_ASSIGN_TRUE: {
+			txt += Variant::get_type_name(t) + "(";
+			for (int i = 0; i < argc; i++) {
 
-					txt += " assign ";
-					txt += DADDR(1);
-					txt += "= true";
-					incr += 2;
+				if (i > 0)
+					txt += ", ";
+				txt += DADDR(i + 3);
+			}
+			txt += ")";
 
-				} break;
-				case GDScriptFunction::OPCODE_ASSIGN_FALSE: {
+			incr = 4 + argc;
 
-					txt += " assign ";
-					txt += DADDR(1);
-					txt += "= false";
-					incr += 2;
+		} break;
+		case GDScriptFunction::OPCODE_CONSTRUCT_ARRAY: {
 
-				} break;
-				case GDScriptFunction::OPCODE_ASSIGN_TYPED_BUILTIN: {
+			int argc = code[ip + 1];
+			txt += " make_array ";
+			txt += DADDR(2 + argc);
+			txt += " = [ ";
 
-					txt += " assign typed builtin (";
-					txt += Variant::get_type_name((Variant::Type)code[ip + 1]);
-					txt += ") ";
-					txt += DADDR(2);
-					txt += " = ";
-					txt += DADDR(3);
-					incr += 4;
+			for (int i = 0; i < argc; i++) {
+				if (i > 0)
+					txt += ", ";
+				txt += DADDR(2 + i);
+			}
 
-				} break;
-				case GDScriptFunction::OPCODE_ASSIGN_TYPED_NATIVE: {
-					Variant className = func.get_constant(code[ip + 1]);
-					GDScriptNativeClass *nc = Object::cast_to<GDScriptNativeClass>(className.operator Object *());
-
-					txt += " assign typed native (";
-					txt += nc->get_name().operator String();
-					txt += ") ";
-					txt += DADDR(2);
-					txt += " = ";
-					txt += DADDR(3);
-					incr += 4;
+			txt += "]";
 
-				} break;
-				case GDScriptFunction::OPCODE_CAST_TO_SCRIPT: {
+			incr += 3 + argc;
 
-					txt += " cast ";
-					txt += DADDR(3);
-					txt += "=";
-					txt += DADDR(1);
-					txt += " as ";
-					txt += DADDR(2);
-					incr += 4;
+		} break;
+		case GDScriptFunction::OPCODE_CONSTRUCT_DICTIONARY: {
 
-				} break;
-				case GDScriptFunction::OPCODE_CONSTRUCT: {
+			int argc = code[ip + 1];
+			txt += " make_dict ";
+			txt += DADDR(2 + argc * 2);
+			txt += " = { ";
 
-					Variant::Type t = Variant::Type(code[ip + 1]);
-					int argc = code[ip + 2];
+			for (int i = 0; i < argc; i++) {
+				if (i > 0)
+					txt += ", ";
+				txt += DADDR(2 + i * 2 + 0);
+				txt += ":";
+				txt += DADDR(2 + i * 2 + 1);
+			}
 
-					txt += " construct ";
-					txt += DADDR(3 + argc);
-					txt += " = ";
+			txt += "}";
 
-					txt += Variant::get_type_name(t) + "(";
-					for (int i = 0; i < argc; i++) {
+			incr += 3 + argc * 2;
 
-						if (i > 0)
-							txt += ", ";
-						txt += DADDR(i + 3);
-					}
-					txt += ")";
+		} break;
 
-					incr = 4 + argc;
+		case GDScriptFunction::OPCODE_CALL:
+		case GDScriptFunction::OPCODE_CALL_RETURN: {
 
-				} break;
-				case GDScriptFunction::OPCODE_CONSTRUCT_ARRAY: {
+			bool ret = code[ip] == GDScriptFunction::OPCODE_CALL_RETURN;
 
-					int argc = code[ip + 1];
-					txt += " make_array ";
-					txt += DADDR(2 + argc);
-					txt += " = [ ";
+			if (ret)
+				txt += " call-ret ";
+			else
+				txt += " call ";
 
-					for (int i = 0; i < argc; i++) {
-						if (i > 0)
-							txt += ", ";
-						txt += DADDR(2 + i);
-					}
+			int argc = code[ip + 1];
+			if (ret) {
+				txt += DADDR(4 + argc) + "=";
+			}
 
-					txt += "]";
+			txt += DADDR(2) + ".";
+			txt += String(func.get_global_name(code[ip + 3]));
+			txt += "(";
 
-					incr += 3 + argc;
+			for (int i = 0; i < argc; i++) {
+				if (i > 0)
+					txt += ", ";
+				txt += DADDR(4 + i);
+			}
+			txt += ")";
 
-				} break;
-				case GDScriptFunction::OPCODE_CONSTRUCT_DICTIONARY: {
+			incr = 5 + argc;
 
-					int argc = code[ip + 1];
-					txt += " make_dict ";
-					txt += DADDR(2 + argc * 2);
-					txt += " = { ";
+		} break;
+		case GDScriptFunction::OPCODE_CALL_BUILTIN_METHOD_VALIDATED:
+		case GDScriptFunction::OPCODE_CALL_METHOD_BIND: {
+
+			bool validated = code[ip] == GDScriptFunction::OPCODE_CALL_BUILTIN_METHOD_VALIDATED;
+			txt += validated ? " call-validated " : " call-method-bind ";
+
+			int argc = code[ip + 1];
+			txt += DADDR(4 + argc) + "=";
+			txt += DADDR(2) + ".";
+			if (validated) {
+				txt += String(func.get_validated_builtin_method(code[ip + 3]).name);
+			} else {
+				txt += String(func.get_method_bind_call(code[ip + 3]).name);
+			}
+			txt += "(";
 
-					for (int i = 0; i < argc; i++) {
-						if (i > 0)
-							txt += ", ";
-						txt += DADDR(2 + i * 2 + 0);
-						txt += ":";
-						txt += DADDR(2 + i * 2 + 1);
-					}
+			for (int i = 0; i < argc; i++) {
+				if (i > 0)
+					txt += ", ";
+				txt += DADDR(4 + i);
+			}
+			txt += ")";
 
-					txt += "}";
+			incr = 5 + argc;
 
-					incr += 3 + argc * 2;
+		} break;
+		case GDScriptFunction::OPCODE_CALL_BUILT_IN: {
 
-				} break;
+			txt += " call-built-in ";
 
-				case GDScriptFunction::OPCODE_CALL:
-				case GDScriptFunction::OPCODE_CALL_RETURN: {
+			int argc = code[ip + 2];
+			txt += DADDR(3 + argc) + "=";
 
-					bool ret = code[ip] == GDScriptFunction::OPCODE_CALL_RETURN;
+			txt += GDScriptFunctions::get_func_name(GDScriptFunctions::Function(code[ip + 1]));
+			txt += "(";
 
-					if (ret)
-						txt += " call-ret ";
-					else
-						txt += " call ";
+			for (int i = 0; i < argc; i++) {
+				if (i > 0)
+					txt += ", ";
+				txt += DADDR(3 + i);
+			}
+			txt += ")";
 
-					int argc = code[ip + 1];
-					if (ret) {
-						txt += DADDR(4 + argc) + "=";
-					}
+			incr = 4 + argc;
 
-					txt += DADDR(2) + ".";
-					txt += String(func.get_global_name(code[ip + 3]));
-					txt += "(";
+		} break;
+		case GDScriptFunction::OPCODE_CALL_SELF_BASE: {
 
-					for (int i = 0; i < argc; i++) {
-						if (i > 0)
-							txt += ", ";
-						txt += DADDR(4 + i);
-					}
-					txt += ")";
+			txt += " call-self-base ";
 
-					incr = 5 + argc;
+			int argc = code[ip + 2];
+			txt += DADDR(3 + argc) + "=";
 
-				} break;
-				case GDScriptFunction::OPCODE_CALL_BUILT_IN: {
+			txt += func.get_global_name(code[ip + 1]);
+			txt += "(";
 
-					txt += " call-built-in ";
+			for (int i = 0; i < argc; i++) {
+				if (i > 0)
+					txt += ", ";
+				txt += DADDR(3 + i);
+			}
+			txt += ")";
 
-					int argc = code[ip + 2];
-					txt += DADDR(3 + argc) + "=";
+			incr = 4 + argc;
 
-					txt += GDScriptFunctions::get_func_name(GDScriptFunctions::Function(code[ip + 1]));
-					txt += "(";
+		} break;
+		case GDScriptFunction::OPCODE_YIELD: {
 
-					for (int i = 0; i < argc; i++) {
-						if (i > 0)
-							txt += ", ";
-						txt += DADDR(3 + i);
-					}
-					txt += ")";
+			txt += " yield ";
+			incr = 1;
 
-					incr = 4 + argc;
+		} break;
+		case GDScriptFunction::OPCODE_YIELD_SIGNAL: {
 
-				} break;
-				case GDScriptFunction::OPCODE_CALL_SELF_BASE: {
+			txt += " yield_signal ";
+			txt += DADDR(1);
+			txt += ",";
+			txt += DADDR(2);
+			incr = 3;
+		} break;
+		case GDScriptFunction::OPCODE_YIELD_RESUME: {
 
-					txt += " call-self-base ";
+			txt += " yield resume: ";
+			txt += DADDR(1);
+			incr = 2;
+		} break;
+		case GDScriptFunction::OPCODE_JUMP: {
 
-					int argc = code[ip + 2];
-					txt += DADDR(3 + argc) + "=";
+			txt += " jump ";
+			txt += itos(code[ip + 1]);
 
-					txt += func.get_global_name(code[ip + 1]);
-					txt += "(";
+			incr = 2;
 
-					for (int i = 0; i < argc; i++) {
-						if (i > 0)
-							txt += ", ";
-						txt += DADDR(3 + i);
-					}
-					txt += ")";
+		} break;
+		case GDScriptFunction::OPCODE_JUMP_IF: {
 
-					incr = 4 + argc;
+			txt += " jump-if ";
+			txt += DADDR(1);
+			txt += " to ";
+			txt += itos(code[ip + 2]);
 
-				} break;
-				case GDScriptFunction::OPCODE_YIELD: {
+			incr = 3;
+		} break;
+		case GDScriptFunction::OPCODE_JUMP_IF_NOT: {
 
-					txt += " yield ";
-					incr = 1;
+			txt += " jump-if-not ";
+			txt += DADDR(1);
+			txt += " to ";
+			txt += itos(code[ip + 2]);
 
-				} break;
-				case GDScriptFunction::OPCODE_YIELD_SIGNAL: {
+			incr = 3;
+		} break;
+		case GDScriptFunction::OPCODE_JUMP_IF_NOT_COMPARE: {
 
-					txt += " yield_signal ";
-					txt += DADDR(1);
-					txt += ",";
-					txt += DADDR(2);
-					incr = 3;
-				} break;
-				case GDScriptFunction::OPCODE_YIELD_RESUME: {
+			txt += " jump-if-not ";
+			txt += DADDR(2);
+			txt += " " + Variant::get_operator_name(Variant::Operator(code[ip + 1])) + " ";
+			txt += DADDR(3);
+			txt += " to ";
+			txt += itos(code[ip + 4]);
 
-					txt += " yield resume: ";
-					txt += DADDR(1);
-					incr = 2;
-				} break;
-				case GDScriptFunction::OPCODE_JUMP: {
+			incr = 5;
+		} break;
+		case GDScriptFunction::OPCODE_JUMP_TO_DEF_ARGUMENT: {
 
-					txt += " jump ";
-					txt += itos(code[ip + 1]);
+			txt += " jump-to-default-argument ";
+			incr = 1;
+		} break;
+		case GDScriptFunction::OPCODE_RETURN: {
 
-					incr = 2;
+			txt += " return ";
+			txt += DADDR(1);
 
-				} break;
-				case GDScriptFunction::OPCODE_JUMP_IF: {
+			incr = 2;
 
-					txt += " jump-if ";
-					txt += DADDR(1);
-					txt += " to ";
-					txt += itos(code[ip + 2]);
+		} break;
+		case GDScriptFunction::OPCODE_ITERATE_BEGIN: {
 
-					incr = 3;
-				} break;
-				case GDScriptFunction::OPCODE_JUMP_IF_NOT: {
+			txt += " for-init " + DADDR(4) + " in " + DADDR(2) + " counter " + DADDR(1) + " end " + itos(code[ip + 3]);
+			incr += 5;
 
-					txt += " jump-if-not ";
-					txt += DADDR(1);
-					txt += " to ";
-					txt += itos(code[ip + 2]);
+		} break;
+		case GDScriptFunction::OPCODE_ITERATE: {
 
-					incr = 3;
-				} break;
-				case GDScriptFunction::OPCODE_JUMP_TO_DEF_ARGUMENT: {
+			txt += " for-loop " + DADDR(4) + " in " + DADDR(2) + " counter " + DADDR(1) + " end " + itos(code[ip + 3]);
+			incr += 5;
 
-					txt += " jump-to-default-argument ";
-					incr = 1;
-				} break;
-				case GDScriptFunction::OPCODE_RETURN: {
+		} break;
+		case GDScriptFunction::OPCODE_LINE: {
 
-					txt += " return ";
-					txt += DADDR(1);
+			int line = code[ip + 1] - 1;
+			if (line >= 0 && line < p_code.size())
+				txt = "\n" + itos(line + 1) + ": " + p_code[line] + "\n";
+			else
+				txt = "";
+			incr += 2;
+		} break;
+		case GDScriptFunction::OPCODE_END: {
 
-					incr = 2;
+			txt += " end";
+			incr += 1;
+		} break;
+		case GDScriptFunction::OPCODE_ASSERT: {
 
-				} break;
-				case GDScriptFunction::OPCODE_ITERATE_BEGIN: {
+			txt += " assert ";
+			txt += DADDR(1);
+			incr += 2;
 
-					txt += " for-init " + DADDR(4) + " in " + DADDR(2) + " counter " + DADDR(1) + " end " + itos(code[ip + 3]);
-					incr += 5;
+		} break;
+	}
 
-				} break;
-				case GDScriptFunction::OPCODE_ITERATE: {
+	r_txt = txt;
+	return incr;
+}
 
-					txt += " for-loop " + DADDR(4) + " in " + DADDR(2) + " counter " + DADDR(1) + " end " + itos(code[ip + 3]);
-					incr += 5;
+#undef DADDR
 
-				} break;
-				case GDScriptFunction::OPCODE_LINE: {
-
-					int line = code[ip + 1] - 1;
-					if (line >= 0 && line < p_code.size())
-						txt = "\n" + itos(line + 1) + ": " + p_code[line] + "\n";
-					else
-						txt = "";
-					incr += 2;
-				} break;
-				case GDScriptFunction::OPCODE_END: {
+static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String> &p_code) {
 
-					txt += " end";
-					incr += 1;
-				} break;
-				case GDScriptFunction::OPCODE_ASSERT: {
+	const Map<StringName, GDScriptFunction *> &mf = p_class->debug_get_member_functions();
 
-					txt += " assert ";
-					txt += DADDR(1);
-					incr += 2;
+	for (const Map<StringName, GDScriptFunction *>::Element *E = mf.front(); E; E = E->next()) {
 
-				} break;
+		const GDScriptFunction &func = *E->get();
+		const int *code = func.get_code();
+		int codelen = func.get_code_size();
+		String defargs;
+		if (func.get_default_argument_count()) {
+			defargs = "defarg at: ";
+			for (int i = 0; i < func.get_default_argument_count(); i++) {
+
+				if (i > 0)
+					defargs += ",";
+				defargs += itos(func.get_default_argument_addr(i));
 			}
+			defargs += " ";
+		}
+		print_line("== function " + String(func.get_name()) + "() :: stack size: " + itos(func.get_max_stack_size()) + " " + defargs + "==");
+
+		for (int ip = 0; ip < codelen;) {
+
+			String txt;
+			int incr = _disassemble_instruction(p_class, func, p_code, ip, txt);
 
 			if (incr == 0) {
 
@@ -942,8 +1089,340 @@ static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String
 	}
 }
 
+// Every benchmark is a static function running a single loop n times, with
+// a typed and an untyped variant of the same code.
+static const char *_benchmark_code =
+		"extends Reference\n"
+		"\n"
+		"static func int_typed(n: int) -> int:\n"
+		"\tvar i: int = 0\n"
+		"\tvar acc: int = 0\n"
+		"\twhile i < n:\n"
+		"\t\tacc = (acc + i * 3) % 1024\n"
+		"\t\ti += 1\n"
+		"\treturn acc\n"
+		"\n"
+		"static func int_untyped(n):\n"
+		"\tvar i = 0\n"
+		"\tvar acc = 0\n"
+		"\twhile i < n:\n"
+		"\t\tacc = (acc + i * 3) % 1024\n"
+		"\t\ti += 1\n"
+		"\treturn acc\n"
+		"\n"
+		"static func float_typed(n: int) -> float:\n"
+		"\tvar i: int = 0\n"
+		"\tvar f: float = 0.0\n"
+		"\tvar acc: float = 0.0\n"
+		"\twhile i < n:\n"
+		"\t\tacc = acc * 0.5 + f\n"
+		"\t\tf += 1.0\n"
+		"\t\ti += 1\n"
+		"\treturn acc\n"
+		"\n"
+		"static func float_untyped(n):\n"
+		"\tvar i = 0\n"
+		"\tvar f = 0.0\n"
+		"\tvar acc = 0.0\n"
+		"\twhile i < n:\n"
+		"\t\tacc = acc * 0.5 + f\n"
+		"\t\tf += 1.0\n"
+		"\t\ti += 1\n"
+		"\treturn acc\n"
+		"\n"
+		"static func vector3_typed(n: int) -> Vector3:\n"
+		"\tvar i: int = 0\n"
+		"\tvar v: Vector3 = Vector3()\n"
+		"\tvar d: Vector3 = Vector3(1, 2, 3)\n"
+		"\twhile i < n:\n"
+		"\t\tv = v * 0.5 + d\n"
+		"\t\ti += 1\n"
+		"\treturn v\n"
+		"\n"
+		"static func vector3_untyped(n):\n"
+		"\tvar i = 0\n"
+		"\tvar v = Vector3()\n"
+		"\tvar d = Vector3(1, 2, 3)\n"
+		"\twhile i < n:\n"
+		"\t\tv = v * 0.5 + d\n"
+		"\t\ti += 1\n"
+		"\treturn v\n"
+		"\n"
+		"static func array_typed(n: int) -> int:\n"
+		"\tvar i: int = 0\n"
+		"\tvar a: Array = [0, 1, 2, 3, 4, 5, 6, 7]\n"
+		"\tvar p: PackedInt32Array = PackedInt32Array(a)\n"
+		"\twhile i < n:\n"
+		"\t\ta[i & 7] = p[(i + 1) & 7]\n"
+		"\t\ti += 1\n"
+		"\treturn a[0]\n"
+		"\n"
+		"static func array_untyped(n):\n"
+		"\tvar i = 0\n"
+		"\tvar a = [0, 1, 2, 3, 4, 5, 6, 7]\n"
+		"\tvar p = PackedInt32Array(a)\n"
+		"\twhile i < n:\n"
+		"\t\ta[i & 7] = p[(i + 1) & 7]\n"
+		"\t\ti += 1\n"
+		"\treturn a[0]\n"
+		"\n"
+		"static func call_typed(n: int) -> float:\n"
+		"\tvar i: int = 0\n"
+		"\tvar acc: float = 0.0\n"
+		"\tvar v: Vector3 = Vector3(1, 2, 3)\n"
+		"\tvar r: Reference = Reference.new()\n"
+		"\twhile i < n:\n"
+		"\t\tacc += v.dot(v) + (r.get_instance_id() & 1)\n"
+		"\t\ti += 1\n"
+		"\treturn acc\n"
+		"\n"
+		"static func call_untyped(n):\n"
+		"\tvar i = 0\n"
+		"\tvar acc = 0.0\n"
+		"\tvar v = Vector3(1, 2, 3)\n"
+		"\tvar r = Reference.new()\n"
+		"\twhile i < n:\n"
+		"\t\tacc += v.dot(v) + (r.get_instance_id() & 1)\n"
+		"\t\ti += 1\n"
+		"\treturn acc\n"
+		"\n"
+		"static func _coroutine(n):\n"
+		"\tvar acc = 0\n"
+		"\tvar v = Vector3(1, 2, 3)\n"
+		"\tfor i in range(n):\n"
+		"\t\tacc += i + int(v.x)\n"
+		"\t\tyield()\n"
+		"\treturn acc\n";
+
+// Counts the instructions in the body of the first loop of the function,
+// which are executed once per iteration.
+static int _count_loop_instructions(const Ref<GDScript> &p_class, const GDScriptFunction &func) {
+
+	const int *code = func.get_code();
+	int codelen = func.get_code_size();
+	Vector<String> source;
+	Vector<int> starts;
+
+	for (int ip = 0; ip < codelen;) {
+
+		String txt;
+		int incr = _disassemble_instruction(p_class, func, source, ip, txt);
+		ERR_FAIL_COND_V_MSG(incr == 0, 0, "Unhandled opcode: " + itos(code[ip]));
+
+		if (code[ip] == GDScriptFunction::OPCODE_JUMP && code[ip + 1] <= ip) {
+			int count = 0;
+			for (int i = 0; i < starts.size(); i++) {
+				if (starts[i] >= code[ip + 1]) {
+					count++;
+				}
+			}
+			return count + 1;
+		}
+
+		starts.push_back(ip);
+		ip += incr;
+	}
+
+	return 0;
+}
+
+static Ref<GDScript> _compile_benchmark() {
+
+	GDScriptParser parser;
+	Error err = parser.parse(_benchmark_code);
+	if (err) {
+		print_line("Parse Error:\n" + itos(parser.get_error_line()) + ":" + itos(parser.get_error_column()) + ":" + parser.get_error());
+		return Ref<GDScript>();
+	}
+
+	Ref<GDScript> gds;
+	gds.instance();
+
+	GDScriptCompiler gdc;
+	err = gdc.compile(&parser, gds.ptr());
+	if (err) {
+		print_line("Compile Error:\n" + itos(gdc.get_error_line()) + ":" + itos(gdc.get_error_column()) + ":" + gdc.get_error());
+		return Ref<GDScript>();
+	}
+
+	return gds;
+}
+
+static MainLoop *_benchmark() {
+
+	const int iterations = 1000000;
+	const char *benchmarks[] = { "int", "float", "vector3", "array", "call", nullptr };
+
+	Ref<GDScript> gds = _compile_benchmark();
+	if (gds.is_null()) {
+		return nullptr;
+	}
+
+	const Map<StringName, GDScriptFunction *> &mf = gds->get_member_functions();
+
+	for (int i = 0; benchmarks[i]; i++) {
+
+		String line = String(benchmarks[i]) + ":";
+
+		for (int j = 0; j < 2; j++) {
+
+			String name = String(benchmarks[i]) + (j == 0 ? "_typed" : "_untyped");
+			ERR_CONTINUE(!mf.has(name));
+			GDScriptFunction *func = mf[name];
+
+			Variant arg = iterations;
+			const Variant *args[1] = { &arg };
+			Callable::CallError ce;
+
+			uint64_t from = OS::get_singleton()->get_ticks_usec();
+			func->call(nullptr, args, 1, ce);
+			uint64_t usec = MAX(OS::get_singleton()->get_ticks_usec() - from, (uint64_t)1);
+
+			ERR_CONTINUE_MSG(ce.error != Callable::CallError::CALL_OK, "Benchmark call failed: " + name);
+
+			uint64_t instructions = (uint64_t)_count_loop_instructions(gds, *func) * iterations;
+			line += " " + String(j == 0 ? "typed " : "untyped ") + itos(usec / 1000) + " msec, " + rtos(instructions / (double)usec) + " M instructions/sec";
+		}
+
+		print_line(line);
+	}
+
+	return nullptr;
+}
+
+// Runs every benchmark with and without the sampling profiler, to measure its
+// overhead, and prints the report of the profiled runs.
+static MainLoop *_profiler() {
+
+	const int iterations = 1000000;
+
+	Ref<GDScript> gds = _compile_benchmark();
+	if (gds.is_null()) {
+		return nullptr;
+	}
+
+	const Map<StringName, GDScriptFunction *> &mf = gds->get_member_functions();
+
+	uint64_t usec[2] = {};
+	for (int i = 0; i < 2; i++) {
+
+		if (i == 1) {
+			GDScriptSamplingProfiler::start(1000);
+		}
+
+		for (const Map<StringName, GDScriptFunction *>::Element *E = mf.front(); E; E = E->next()) {
+
+			if (String(E->key()).begins_with("_")) {
+				continue;
+			}
+
+			Variant arg = iterations;
+			const Variant *args[1] = { &arg };
+			Callable::CallError ce;
+
+			uint64_t from = OS::get_singleton()->get_ticks_usec();
+			E->get()->call(nullptr, args, 1, ce);
+			usec[i] += OS::get_singleton()->get_ticks_usec() - from;
+
+			ERR_CONTINUE_MSG(ce.error != Callable::CallError::CALL_OK, "Benchmark call failed: " + String(E->key()));
+		}
+
+		if (i == 1) {
+			GDScriptSamplingProfiler::stop();
+		}
+	}
+
+	print_line("Without profiler: " + itos(usec[0] / 1000) + " msec, with profiler: " + itos(usec[1] / 1000) + " msec, overhead: " + rtos(100.0 * (double(usec[1]) / MAX(usec[0], (uint64_t)1) - 1.0)) + "%");
+	print_line("");
+	print_line(GDScriptSamplingProfiler::get_report(20));
+
+	String folded = GDScriptSamplingProfiler::get_folded_stacks();
+	Vector<String> stacks = folded.split("\n", false);
+	print_line(itos(stacks.size()) + " distinct stacks, the first ones are:");
+	for (int i = 0; i < MIN(stacks.size(), 10); i++) {
+		print_line(stacks[i]);
+	}
+
+	GDScriptSamplingProfiler::finish();
+
+	return nullptr;
+}
+
+// Keeps thousands of coroutines waiting at the same time and resumes them all
+// a few times, to measure the cost of a yield and resume cycle.
+static MainLoop *_coroutines() {
+
+	const int count = 10000;
+	const int rounds = 100;
+
+	Ref<GDScript> gds = _compile_benchmark();
+	if (gds.is_null()) {
+		return nullptr;
+	}
+
+	const Map<StringName, GDScriptFunction *> &mf = gds->get_member_functions();
+	ERR_FAIL_COND_V(!mf.has("_coroutine"), nullptr);
+	GDScriptFunction *func = mf["_coroutine"];
+
+	Vector<Ref<GDScriptFunctionState>> states;
+	states.resize(count);
+
+	Variant arg = rounds;
+	const Variant *args[1] = { &arg };
+	uint64_t mem_from = Memory::get_mem_usage();
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+
+	for (int i = 0; i < count; i++) {
+		Callable::CallError ce;
+		states.write[i] = func->call(nullptr, args, 1, ce);
+		ERR_FAIL_COND_V_MSG(states[i].is_null(), nullptr, "Coroutine did not yield.");
+	}
+
+	uint64_t start_usec = OS::get_singleton()->get_ticks_usec() - from;
+	uint64_t mem_waiting = Memory::get_mem_usage() - mem_from;
+
+	int64_t expected = 0;
+	for (int i = 0; i < rounds; i++) {
+		expected += i + 1;
+	}
+
+	from = OS::get_singleton()->get_ticks_usec();
+
+	for (int r = 0; r < rounds; r++) {
+		for (int i = 0; i < count; i++) {
+			Variant ret = states.write[i]->resume();
+			if (r < rounds - 1) {
+				states.write[i] = ret;
+				ERR_FAIL_COND_V_MSG(states[i].is_null(), nullptr, "Coroutine did not yield again.");
+			} else {
+				ERR_FAIL_COND_V_MSG(int64_t(ret) != expected, nullptr, "Coroutine returned a wrong result.");
+			}
+		}
+	}
+
+	uint64_t resume_usec = MAX(OS::get_singleton()->get_ticks_usec() - from, (uint64_t)1);
+	states.clear();
+
+	print_line(itos(count) + " coroutines started in " + itos(start_usec / 1000) + " msec, " + itos(mem_waiting / count) + " bytes each while waiting");
+	print_line(itos(count * rounds) + " resumes in " + itos(resume_usec / 1000) + " msec, " + rtos(1000.0 * resume_usec / (count * rounds)) + " nsec per resume and yield");
+
+	return nullptr;
+}
+
 MainLoop *test(TestType p_type) {
 
+	if (p_type == TEST_BENCHMARK) {
+		return _benchmark();
+	}
+
+	if (p_type == TEST_PROFILER) {
+		return _profiler();
+	}
+
+	if (p_type == TEST_COROUTINES) {
+		return _coroutines();
+	}
+
 	List<String> cmdlargs = OS::get_singleton()->get_cmdline_args();
 
 	if (cmdlargs.empty()) {
@@ -1074,11 +1553,40 @@ MainLoop *test(TestType p_type) {
 
 	} else if (p_type == TEST_BYTECODE) {
 
-		Vector<uint8_t> buf2 = GDScriptTokenizerBuffer::parse_code_string(code);
+		Vector<uint8_t> buf2 = GDScriptCompiledBuffer::parse_code_string(code, test);
 		String dst = test.get_basename() + ".gdc";
 		FileAccess *fw = FileAccess::open(dst, FileAccess::WRITE);
 		fw->store_buffer(buf2.ptr(), buf2.size());
 		memdelete(fw);
+
+		if (!GDScriptCompiledBuffer::is_compiled_buffer(buf2)) {
+			print_line("Can't compile ahead of time, saved tokenized code.");
+			memdelete(fa);
+			return nullptr;
+		}
+
+		// Load the compiled code back the way exported projects do.
+		Ref<GDScript> gds;
+		gds.instance();
+		gds->set_script_path(dst);
+
+		GDScriptCompiledBuffer compiled;
+		Error err = compiled.load_script(gds.ptr(), buf2);
+		if (err) {
+			print_line("Load Error:\n" + compiled.get_error());
+			memdelete(fa);
+			return nullptr;
+		}
+
+		Ref<GDScript> current = gds;
+
+		while (current.is_valid()) {
+
+			print_line("** CLASS **");
+			_disassemble_class(current, lines);
+
+			current = current->get_base();
+		}
 	}
 
 	memdelete(fa);
@@ -0,0 +1,330 @@
+/*************************************************************************/
+/*  test_image.cpp                                                       */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+
+#include "test_image.h"
+
+#include "core/image.h"
+#include "core/os/os.h"
+
+namespace TestImage {
+
+// Scalar versions of the kernels, as they were before being vectorized and
+// split over threads. Results must match them exactly.
+
+static Vector<uint8_t> _reference_mipmap_rgba8(const Vector<uint8_t> &p_src, int p_width, int p_height) {
+
+	int dst_w = MAX(p_width >> 1, 1);
+	int dst_h = MAX(p_height >> 1, 1);
+	int right = p_width == 1 ? 0 : 4;
+	int down = p_height == 1 ? 0 : p_width * 4;
+
+	Vector<uint8_t> dst;
+	dst.resize(dst_w * dst_h * 4);
+	for (int y = 0; y < dst_h; y++) {
+		for (int x = 0; x < dst_w; x++) {
+			const uint8_t *up = &p_src[y * 2 * down + x * 2 * right];
+			for (int c = 0; c < 4; c++) {
+				dst.write[(y * dst_w + x) * 4 + c] = (up[c] + up[c + right] + up[c + down] + up[c + down + right] + 2) >> 2;
+			}
+		}
+	}
+	return dst;
+}
+
+static Vector<uint8_t> _reference_bilinear_rgba8(const Vector<uint8_t> &p_src, uint32_t p_src_width, uint32_t p_src_height, uint32_t p_dst_width, uint32_t p_dst_height) {
+
+	Vector<uint8_t> dst;
+	dst.resize(p_dst_width * p_dst_height * 4);
+	for (uint32_t i = 0; i < p_dst_height; i++) {
+		uint32_t yofs_fp = i * p_src_height * 256 / p_dst_height;
+		uint32_t yofs_up = (yofs_fp >> 8) * p_src_width * 4;
+		uint32_t yofs_down = MIN((i + 1) * p_src_height / p_dst_height, p_src_height - 1) * p_src_width * 4;
+		for (uint32_t j = 0; j < p_dst_width; j++) {
+			uint32_t xofs_fp = j * p_src_width * 256 / p_dst_width;
+			uint32_t xofs_left = (xofs_fp >> 8) * 4;
+			uint32_t xofs_right = MIN((j + 1) * p_src_width / p_dst_width, p_src_width - 1) * 4;
+			for (uint32_t l = 0; l < 4; l++) {
+				uint32_t p00 = p_src[yofs_up + xofs_left + l] << 8;
+				uint32_t p10 = p_src[yofs_up + xofs_right + l] << 8;
+				uint32_t p01 = p_src[yofs_down + xofs_left + l] << 8;
+				uint32_t p11 = p_src[yofs_down + xofs_right + l] << 8;
+				uint32_t up = p00 + (((p10 - p00) * (xofs_fp & 255)) >> 8);
+				uint32_t down = p01 + (((p11 - p01) * (xofs_fp & 255)) >> 8);
+				dst.write[(i * p_dst_width + j) * 4 + l] = (up + (((down - up) * (yofs_fp & 255)) >> 8)) >> 8;
+			}
+		}
+	}
+	return dst;
+}
+
+static Vector<uint8_t> _reference_premultiply_rgba8(const Vector<uint8_t> &p_src) {
+
+	Vector<uint8_t> dst = p_src;
+	for (int i = 0; i < dst.size(); i += 4) {
+		for (int c = 0; c < 3; c++) {
+			dst.write[i + c] = (uint16_t(dst[i + c]) * uint16_t(dst[i + 3])) >> 8;
+		}
+	}
+	return dst;
+}
+
+static Vector<uint8_t> _random_data(int p_size, uint32_t p_seed) {
+
+	Vector<uint8_t> data;
+	data.resize(p_size);
+	uint32_t state = p_seed * 2654435761u + 1;
+	for (int i = 0; i < p_size; i++) {
+		state = state * 1664525u + 1013904223u;
+		data.write[i] = state >> 24;
+	}
+	return data;
+}
+
+static bool _equal(const Vector<uint8_t> &p_a, const Vector<uint8_t> &p_b, int p_offset = 0) {
+
+	if (p_offset + p_b.size() > p_a.size()) {
+		return false;
+	}
+	return memcmp(p_a.ptr() + p_offset, p_b.ptr(), p_b.size()) == 0;
+}
+
+// Odd sizes exercise the scalar tails, large ones get split over threads.
+static const int sizes[][2] = { { 1, 1 }, { 3, 1 }, { 1, 7 }, { 13, 11 }, { 64, 64 }, { 333, 257 }, { 1024, 768 } };
+
+bool test_mipmaps() {
+
+	OS::get_singleton()->print("\n\nTest 1: Mipmaps match the scalar averaging\n");
+
+	bool pass = true;
+
+	for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		int w = sizes[i][0];
+		int h = sizes[i][1];
+		Vector<uint8_t> data = _random_data(w * h * 4, i);
+		Ref<Image> img = memnew(Image(w, h, false, Image::FORMAT_RGBA8, data));
+		img->generate_mipmaps();
+		Vector<uint8_t> result = img->get_data();
+
+		// Check every level against the one above it.
+		for (int m = 1; m <= img->get_mipmap_count(); m++) {
+			int ofs, prev_ofs, size, prev_size;
+			img->get_mipmap_offset_and_size(m, ofs, size);
+			img->get_mipmap_offset_and_size(m - 1, prev_ofs, prev_size);
+			int prev_w = MAX(w >> (m - 1), 1);
+			int prev_h = MAX(h >> (m - 1), 1);
+			Vector<uint8_t> prev = result.subarray(prev_ofs, prev_ofs + prev_size - 1);
+			pass = pass && _equal(result, _reference_mipmap_rgba8(prev, prev_w, prev_h), ofs);
+		}
+
+		// Float averages must keep the summation order of the scalar code.
+		Ref<Image> fimg = memnew(Image(w, h, false, Image::FORMAT_RGBAF));
+		for (int y = 0; y < h; y++) {
+			for (int x = 0; x < w; x++) {
+				fimg->set_pixel(x, y, Color(data[(y * w + x) * 4] / 7.0, data[(y * w + x) * 4 + 1] / 3.0, 0.1, 1.0 / (1 + x)));
+			}
+		}
+		fimg->generate_mipmaps();
+		if (w >= 2 && h >= 2) {
+			int ofs, size;
+			fimg->get_mipmap_offset_and_size(1, ofs, size);
+			const float *mip = (const float *)&fimg->get_data()[ofs];
+			for (int y = 0; y < h / 2 && pass; y++) {
+				for (int x = 0; x < w / 2; x++) {
+					Color a = fimg->get_pixel(x * 2, y * 2);
+					Color b = fimg->get_pixel(x * 2 + 1, y * 2);
+					Color c = fimg->get_pixel(x * 2, y * 2 + 1);
+					Color d = fimg->get_pixel(x * 2 + 1, y * 2 + 1);
+					pass = pass && mip[(y * (w / 2) + x) * 4] == (a.r + b.r + c.r + d.r) * 0.25f;
+					pass = pass && mip[(y * (w / 2) + x) * 4 + 3] == (a.a + b.a + c.a + d.a) * 0.25f;
+				}
+			}
+		}
+	}
+
+	return pass;
+}
+
+bool test_resize_convert() {
+
+	OS::get_singleton()->print("\n\nTest 2: Resize, convert and premultiply match the scalar code\n");
+
+	bool pass = true;
+
+	for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		int w = sizes[i][0];
+		int h = sizes[i][1];
+		Vector<uint8_t> data = _random_data(w * h * 4, i + 100);
+
+		Ref<Image> img = memnew(Image(w, h, false, Image::FORMAT_RGBA8, data));
+		int dw = w * 3 / 2 + 1;
+		int dh = MAX(h * 2 / 3, 1);
+		img->resize(dw, dh, Image::INTERPOLATE_BILINEAR);
+		pass = pass && _equal(img->get_data(), _reference_bilinear_rgba8(data, w, h, dw, dh));
+
+		img.instance();
+		img->create(w, h, false, Image::FORMAT_RGBA8, data);
+		img->resize(dw, dh, Image::INTERPOLATE_NEAREST);
+		for (int y = 0; y < dh && pass; y++) {
+			for (int x = 0; x < dw; x++) {
+				pass = pass && memcmp(&img->get_data()[(y * dw + x) * 4], &data[((y * h / dh) * w + (x * w / dw)) * 4], 4) == 0;
+			}
+		}
+
+		img.instance();
+		img->create(w, h, false, Image::FORMAT_RGBA8, data);
+		img->premultiply_alpha();
+		pass = pass && _equal(img->get_data(), _reference_premultiply_rgba8(data));
+
+		img.instance();
+		img->create(w, h, false, Image::FORMAT_RGBA8, data);
+		img->convert(Image::FORMAT_RGB8);
+		Vector<uint8_t> rgb = img->get_data();
+		pass = pass && rgb.size() == w * h * 3;
+		for (int p = 0; p < w * h && pass; p++) {
+			pass = pass && memcmp(&rgb[p * 3], &data[p * 4], 3) == 0;
+		}
+		img->convert(Image::FORMAT_RGBA8);
+		Vector<uint8_t> rgba = img->get_data();
+		pass = pass && rgba.size() == w * h * 4;
+		for (int p = 0; p < w * h && pass; p++) {
+			pass = pass && memcmp(&rgba[p * 4], &data[p * 4], 3) == 0 && rgba[p * 4 + 3] == 255;
+		}
+	}
+
+	return pass;
+}
+
+bool test_benchmark() {
+
+	OS::get_singleton()->print("\n\nTest 3: Timing a 2048x2048 RGBA8 image against the scalar code\n");
+
+	enum {
+		SIZE = 2048,
+		ITERATIONS = 8,
+	};
+
+	Vector<uint8_t> data = _random_data(SIZE * SIZE * 4, 1);
+
+	uint64_t reference_usec = 0;
+	uint64_t usec = 0;
+	for (int i = 0; i < ITERATIONS; i++) {
+		uint64_t from = OS::get_singleton()->get_ticks_usec();
+		Vector<uint8_t> mip = data;
+		for (int s = SIZE; s > 1; s >>= 1) {
+			mip = _reference_mipmap_rgba8(mip, s, s);
+		}
+		reference_usec += OS::get_singleton()->get_ticks_usec() - from;
+
+		Ref<Image> img = memnew(Image(SIZE, SIZE, false, Image::FORMAT_RGBA8, data));
+		from = OS::get_singleton()->get_ticks_usec();
+		img->generate_mipmaps();
+		usec += OS::get_singleton()->get_ticks_usec() - from;
+	}
+	OS::get_singleton()->print("\tgenerate_mipmaps: scalar %8.2f ms, image %8.2f ms\n", reference_usec / 1000.0 / ITERATIONS, usec / 1000.0 / ITERATIONS);
+
+	reference_usec = 0;
+	usec = 0;
+	for (int i = 0; i < ITERATIONS; i++) {
+		uint64_t from = OS::get_singleton()->get_ticks_usec();
+		_reference_bilinear_rgba8(data, SIZE, SIZE, SIZE * 3 / 4, SIZE * 3 / 4);
+		reference_usec += OS::get_singleton()->get_ticks_usec() - from;
+
+		Ref<Image> img = memnew(Image(SIZE, SIZE, false, Image::FORMAT_RGBA8, data));
+		from = OS::get_singleton()->get_ticks_usec();
+		img->resize(SIZE * 3 / 4, SIZE * 3 / 4, Image::INTERPOLATE_BILINEAR);
+		usec += OS::get_singleton()->get_ticks_usec() - from;
+	}
+	OS::get_singleton()->print("\tresize (bilinear): scalar %8.2f ms, image %8.2f ms\n", reference_usec / 1000.0 / ITERATIONS, usec / 1000.0 / ITERATIONS);
+
+	reference_usec = 0;
+	usec = 0;
+	for (int i = 0; i < ITERATIONS; i++) {
+		uint64_t from = OS::get_singleton()->get_ticks_usec();
+		_reference_premultiply_rgba8(data);
+		reference_usec += OS::get_singleton()->get_ticks_usec() - from;
+
+		Ref<Image> img = memnew(Image(SIZE, SIZE, false, Image::FORMAT_RGBA8, data));
+		from = OS::get_singleton()->get_ticks_usec();
+		img->premultiply_alpha();
+		usec += OS::get_singleton()->get_ticks_usec() - from;
+	}
+	OS::get_singleton()->print("\tpremultiply_alpha: scalar %8.2f ms, image %8.2f ms\n", reference_usec / 1000.0 / ITERATIONS, usec / 1000.0 / ITERATIONS);
+
+	usec = 0;
+	for (int i = 0; i < ITERATIONS; i++) {
+		Ref<Image> img = memnew(Image(SIZE, SIZE, false, Image::FORMAT_RGBA8, data));
+		uint64_t from = OS::get_singleton()->get_ticks_usec();
+		img->convert(Image::FORMAT_RGB8);
+		img->convert(Image::FORMAT_RGBA8);
+		usec += OS::get_singleton()->get_ticks_usec() - from;
+	}
+	OS::get_singleton()->print("\tconvert RGBA8 -> RGB8 -> RGBA8: %8.2f ms\n", usec / 1000.0 / ITERATIONS);
+
+	return true;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_mipmaps,
+	test_resize_convert,
+	test_benchmark,
+	nullptr
+
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestImage
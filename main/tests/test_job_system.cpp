@@ -0,0 +1,262 @@
+/*************************************************************************/
+/*  test_job_system.cpp                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_job_system.h"
+
+#include "core/job_system.h"
+#include "core/math/math_funcs.h"
+#include "core/os/os.h"
+#include "core/thread_work_pool.h"
+
+namespace TestJobSystem {
+
+struct Workload {
+	Vector<float> data;
+	std::atomic<uint64_t> sum;
+	std::atomic<uint32_t> order;
+	uint32_t stage[3];
+
+	// Fine grained: a handful of instructions per element, dominated by scheduling overhead.
+	void fine(uint32_t p_index, float p_scale) {
+		data.write[p_index] = data[p_index] * p_scale + 1.0;
+	}
+
+	// Coarse grained: long and uneven elements, dominated by load balancing.
+	void coarse(uint32_t p_index, uint32_t p_iterations) {
+		float accum = 0;
+		uint32_t iterations = p_iterations * (1 + (p_index % 4));
+		for (uint32_t i = 0; i < iterations; i++) {
+			accum += Math::sin(float(i) * 0.001) * Math::cos(float(p_index));
+		}
+		data.write[p_index] = accum;
+	}
+
+	void count(uint32_t p_index, uint32_t p_unused) {
+		sum.fetch_add(p_index, std::memory_order_relaxed);
+	}
+
+	void stage_task(uint32_t p_stage) {
+		stage[p_stage] = order.fetch_add(1);
+	}
+
+	void nested(uint32_t p_index, JobSystem *p_job_system) {
+		p_job_system->do_work(100, this, &Workload::count, 0u);
+	}
+
+	Workload() {
+		sum.store(0);
+		order.store(0);
+	}
+};
+
+bool test_group_task() {
+
+	OS::get_singleton()->print("\n\nTest 1: Group task visits every element once\n");
+
+	Workload w;
+	JobSystem::get_singleton()->do_work(10000, &w, &Workload::count, 0u);
+
+	OS::get_singleton()->print("\tExpected: %llu\n", 49995000ull);
+	OS::get_singleton()->print("\tResulted: %llu\n", (unsigned long long)w.sum.load());
+
+	return w.sum.load() == 49995000ull;
+}
+
+bool test_dependencies() {
+
+	OS::get_singleton()->print("\n\nTest 2: Dependencies run in order\n");
+
+	JobSystem *js = JobSystem::get_singleton();
+	bool pass = true;
+
+	for (int i = 0; i < 1000 && pass; i++) {
+		Workload w;
+		JobSystem::Handle a = js->add_task(&w, &Workload::stage_task, 0u);
+		JobSystem::Handle b = js->add_task(&w, &Workload::stage_task, 1u, a);
+		Vector<JobSystem::Handle> deps;
+		deps.push_back(a);
+		deps.push_back(b);
+		JobSystem::Handle c = js->add_task(&w, &Workload::stage_task, 2u, deps);
+		c.wait();
+		pass = a.is_completed() && b.is_completed() && w.stage[0] < w.stage[1] && w.stage[1] < w.stage[2];
+	}
+
+	return pass;
+}
+
+bool test_held_task() {
+
+	OS::get_singleton()->print("\n\nTest 3: Held jobs wait for dependencies added later\n");
+
+	JobSystem *js = JobSystem::get_singleton();
+	bool pass = true;
+
+	for (int i = 0; i < 1000 && pass; i++) {
+		Workload w;
+		JobSystem::Handle c = js->add_held_task(&w, &Workload::stage_task, 2u);
+		JobSystem::Handle a = js->add_task(&w, &Workload::stage_task, 0u);
+		JobSystem::Handle b = js->add_task(&w, &Workload::stage_task, 1u, a);
+		a.wait();
+		pass = !c.is_completed();
+		js->add_dependency(c, a); // Already done, must not hold it back.
+		js->add_dependency(c, b);
+		js->release(c);
+		c.wait();
+		pass = pass && b.is_completed() && w.stage[0] < w.stage[1] && w.stage[1] < w.stage[2];
+	}
+
+	return pass;
+}
+
+bool test_nested_wait() {
+
+	OS::get_singleton()->print("\n\nTest 4: Jobs waiting on their own group tasks\n");
+
+	Workload w;
+	JobSystem::get_singleton()->do_work(64, &w, &Workload::nested, JobSystem::get_singleton());
+
+	OS::get_singleton()->print("\tExpected: %llu\n", 64ull * 4950ull);
+	OS::get_singleton()->print("\tResulted: %llu\n", (unsigned long long)w.sum.load());
+
+	return w.sum.load() == 64ull * 4950ull;
+}
+
+bool test_benchmark() {
+
+	OS::get_singleton()->print("\n\nTest 5: Benchmark against ThreadWorkPool\n");
+
+	const int passes = 20;
+	const uint32_t fine_elements = 1 << 20;
+	const uint32_t coarse_elements = 256;
+	const uint32_t coarse_iterations = 20000;
+
+	ThreadWorkPool pool;
+	pool.init();
+	JobSystem *js = JobSystem::get_singleton();
+
+	OS::get_singleton()->print("\tThreadWorkPool: %d threads, JobSystem: %d workers + caller\n", OS::get_singleton()->get_processor_count(), js->get_thread_count());
+
+	Workload w;
+	w.data.resize(fine_elements);
+
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < passes; i++) {
+		pool.do_work(fine_elements, &w, &Workload::fine, 0.5f);
+	}
+	uint64_t pool_fine = OS::get_singleton()->get_ticks_usec() - from;
+
+	from = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < passes; i++) {
+		js->do_work(fine_elements, &w, &Workload::fine, 0.5f);
+	}
+	uint64_t js_fine = OS::get_singleton()->get_ticks_usec() - from;
+
+	w.data.resize(coarse_elements);
+
+	from = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < passes; i++) {
+		pool.do_work(coarse_elements, &w, &Workload::coarse, coarse_iterations);
+	}
+	uint64_t pool_coarse = OS::get_singleton()->get_ticks_usec() - from;
+
+	from = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < passes; i++) {
+		js->do_work(coarse_elements, &w, &Workload::coarse, coarse_iterations, 1);
+	}
+	uint64_t js_coarse = OS::get_singleton()->get_ticks_usec() - from;
+
+	// Same amount of work, but as independent submissions in flight at once, which ThreadWorkPool can't express.
+	from = OS::get_singleton()->get_ticks_usec();
+	Workload *loads = memnew_arr(Workload, passes);
+	{
+		Vector<JobSystem::Handle> handles;
+		for (int i = 0; i < passes; i++) {
+			loads[i].data.resize(coarse_elements);
+			handles.push_back(js->add_group_task(&loads[i], &Workload::coarse, coarse_iterations, coarse_elements, 1));
+		}
+		for (int i = 0; i < handles.size(); i++) {
+			handles[i].wait();
+		}
+	}
+	uint64_t js_concurrent = OS::get_singleton()->get_ticks_usec() - from;
+	memdelete_arr(loads);
+
+	pool.finish();
+
+	OS::get_singleton()->print("\tfine grained (%d x %d elements):\n", passes, fine_elements);
+	OS::get_singleton()->print("\t\tThreadWorkPool: %.2f msec\n", pool_fine / 1000.0);
+	OS::get_singleton()->print("\t\tJobSystem:      %.2f msec\n", js_fine / 1000.0);
+	OS::get_singleton()->print("\tcoarse grained (%d x %d elements):\n", passes, coarse_elements);
+	OS::get_singleton()->print("\t\tThreadWorkPool: %.2f msec\n", pool_coarse / 1000.0);
+	OS::get_singleton()->print("\t\tJobSystem:      %.2f msec\n", js_coarse / 1000.0);
+	OS::get_singleton()->print("\t\tJobSystem, %d concurrent group tasks: %.2f msec\n", passes, js_concurrent / 1000.0);
+
+	return true;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_group_task,
+	test_dependencies,
+	test_held_task,
+	test_nested_wait,
+	test_benchmark,
+	nullptr
+
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestJobSystem
@@ -35,16 +35,31 @@
 #ifdef DEBUG_ENABLED
 
 #include "test_astar.h"
+#include "test_command_queue.h"
+#include "test_compression.h"
+#include "test_file_access_pack.h"
+#include "test_frame_allocator.h"
 #include "test_gdscript.h"
 #include "test_gui.h"
+#include "test_image.h"
+#include "test_job_system.h"
 #include "test_math.h"
+#include "test_message_queue.h"
 #include "test_oa_hash_map.h"
+#include "test_object_db.h"
 #include "test_ordered_hash_map.h"
 #include "test_physics_2d.h"
 #include "test_physics_3d.h"
 #include "test_render.h"
+#include "test_resource_format_binary.h"
+#include "test_resource_loader.h"
+#include "test_rid.h"
 #include "test_shader_lang.h"
+#include "test_signal.h"
+#include "test_small_allocator.h"
 #include "test_string.h"
+#include "test_string_name.h"
+#include "test_variant.h"
 
 const char **tests_get_names() {
 
@@ -61,8 +76,26 @@ const char **tests_get_names() {
 		"gd_parser",
 		"gd_compiler",
 		"gd_bytecode",
+		"gd_benchmark",
+		"gd_profiler",
+		"gd_coroutines",
 		"ordered_hash_map",
 		"astar",
+		"job_system",
+		"command_queue",
+		"string_name",
+		"variant",
+		"signal",
+		"message_queue",
+		"file_access_pack",
+		"resource_loader",
+		"object_db",
+		"rid",
+		"image",
+		"compression",
+		"small_allocator",
+		"frame_allocator",
+		"resource_format_binary",
 		nullptr
 	};
 
@@ -133,6 +166,21 @@ MainLoop *test_main(String p_test, const List<String> &p_args) {
 		return TestGDScript::test(TestGDScript::TEST_BYTECODE);
 	}
 
+	if (p_test == "gd_benchmark") {
+
+		return TestGDScript::test(TestGDScript::TEST_BENCHMARK);
+	}
+
+	if (p_test == "gd_profiler") {
+
+		return TestGDScript::test(TestGDScript::TEST_PROFILER);
+	}
+
+	if (p_test == "gd_coroutines") {
+
+		return TestGDScript::test(TestGDScript::TEST_COROUTINES);
+	}
+
 	if (p_test == "ordered_hash_map") {
 
 		return TestOrderedHashMap::test();
@@ -143,6 +191,81 @@ MainLoop *test_main(String p_test, const List<String> &p_args) {
 		return TestAStar::test();
 	}
 
+	if (p_test == "job_system") {
+
+		return TestJobSystem::test();
+	}
+
+	if (p_test == "command_queue") {
+
+		return TestCommandQueue::test();
+	}
+
+	if (p_test == "string_name") {
+
+		return TestStringName::test();
+	}
+
+	if (p_test == "variant") {
+
+		return TestVariant::test();
+	}
+
+	if (p_test == "signal") {
+
+		return TestSignal::test();
+	}
+
+	if (p_test == "message_queue") {
+
+		return TestMessageQueue::test();
+	}
+
+	if (p_test == "file_access_pack") {
+
+		return TestFileAccessPack::test();
+	}
+
+	if (p_test == "resource_loader") {
+
+		return TestResourceLoader::test();
+	}
+
+	if (p_test == "object_db") {
+
+		return TestObjectDB::test();
+	}
+
+	if (p_test == "rid") {
+
+		return TestRID::test();
+	}
+
+	if (p_test == "image") {
+
+		return TestImage::test();
+	}
+
+	if (p_test == "compression") {
+
+		return TestCompression::test();
+	}
+
+	if (p_test == "small_allocator") {
+
+		return TestSmallAllocator::test();
+	}
+
+	if (p_test == "frame_allocator") {
+
+		return TestFrameAllocator::test();
+	}
+
+	if (p_test == "resource_format_binary") {
+
+		return TestResourceFormatBinary::test();
+	}
+
 	print_line("Unknown test: " + p_test);
 	return nullptr;
 }
@@ -0,0 +1,319 @@
+/*************************************************************************/
+/*  test_message_queue.cpp                                               */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_message_queue.h"
+
+#include "core/callable_method_pointer.h"
+#include "core/message_queue.h"
+#include "core/os/os.h"
+#include "core/os/thread.h"
+
+#include <atomic>
+
+namespace TestMessageQueue {
+
+enum {
+	MAX_THREADS = 8,
+	// Well past the default 1 MiB the queue used to be limited to.
+	MESSAGES_PER_THREAD = 50000,
+	BENCHMARK_MESSAGES_PER_THREAD = 200000,
+	RELAY_THREADS = 4,
+	RELAY_MESSAGES = 20000,
+};
+
+class MessageReceiver : public Object {
+
+public:
+	Vector<int> last_index; // Per thread.
+	int received;
+	int out_of_order;
+	int requeue;
+
+	void on_message(int p_thread, int p_index) {
+		if (p_index != last_index[p_thread] + 1) {
+			out_of_order++;
+		}
+		last_index.write[p_thread] = p_index;
+		received++;
+	}
+
+	void on_requeue(int p_index) {
+		received++;
+		if (p_index < requeue) {
+			Variant index = p_index + 1;
+			const Variant *argp[] = { &index };
+			MessageQueue::get_singleton()->push_callable(callable_mp(this, &MessageReceiver::on_requeue), argp, 1);
+		}
+	}
+
+	void reset(int p_threads) {
+		last_index.resize(p_threads);
+		for (int i = 0; i < p_threads; i++) {
+			last_index.write[i] = -1;
+		}
+		received = 0;
+		out_of_order = 0;
+		requeue = 0;
+	}
+
+	MessageReceiver() {
+		reset(1);
+	}
+};
+
+struct Context {
+	MessageReceiver *receiver;
+	int thread;
+	int count;
+};
+
+static void _push_messages(void *p_ud) {
+
+	Context *ctx = (Context *)p_ud;
+	Callable callable = callable_mp(ctx->receiver, &MessageReceiver::on_message);
+
+	Variant thread = ctx->thread;
+	Variant index;
+	const Variant *argp[] = { &thread, &index };
+	for (int i = 0; i < ctx->count; i++) {
+		index = i;
+		MessageQueue::get_singleton()->push_callable(callable, argp, 2);
+	}
+}
+
+struct RelayContext {
+	MessageReceiver *receiver;
+	std::atomic<int> *turn;
+	int thread;
+};
+
+// The threads take turns, so every message is pushed after the previous one
+// in the relay, whichever thread pushed it.
+static void _relay_messages(void *p_ud) {
+
+	RelayContext *ctx = (RelayContext *)p_ud;
+	Callable callable = callable_mp(ctx->receiver, &MessageReceiver::on_message);
+
+	Variant thread = 0; // The receiver checks the order of the whole relay.
+	Variant index;
+	const Variant *argp[] = { &thread, &index };
+	for (int i = ctx->thread; i < RELAY_MESSAGES; i += RELAY_THREADS) {
+		while (ctx->turn->load(std::memory_order_acquire) != i) {
+			OS::get_singleton()->yield();
+		}
+		index = i;
+		MessageQueue::get_singleton()->push_callable(callable, argp, 2);
+		ctx->turn->store(i + 1, std::memory_order_release);
+	}
+}
+
+static uint64_t _push_from_threads(MessageReceiver *p_receiver, int p_threads, int p_count) {
+
+	Context ctx[MAX_THREADS];
+	Thread *threads[MAX_THREADS];
+
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+
+	for (int i = 0; i < p_threads; i++) {
+		ctx[i].receiver = p_receiver;
+		ctx[i].thread = i;
+		ctx[i].count = p_count;
+		threads[i] = Thread::create(_push_messages, &ctx[i]);
+	}
+
+	for (int i = 0; i < p_threads; i++) {
+		Thread::wait_to_finish(threads[i]);
+		memdelete(threads[i]);
+	}
+
+	return OS::get_singleton()->get_ticks_usec() - from;
+}
+
+bool test_single_thread() {
+
+	OS::get_singleton()->print("\n\nTest 1: Messages from one thread keep their order past the old size limit\n");
+
+	MessageQueue::get_singleton()->flush();
+
+	MessageReceiver *receiver = memnew(MessageReceiver);
+	Context ctx;
+	ctx.receiver = receiver;
+	ctx.thread = 0;
+	ctx.count = MESSAGES_PER_THREAD;
+	_push_messages(&ctx);
+	MessageQueue::get_singleton()->flush();
+
+	OS::get_singleton()->print("\treceived %d, out of order %d, max usage %d KiB\n", receiver->received, receiver->out_of_order, MessageQueue::get_singleton()->get_max_buffer_usage() / 1024);
+	bool pass = receiver->received == MESSAGES_PER_THREAD && receiver->out_of_order == 0;
+
+	memdelete(receiver);
+	return pass;
+}
+
+bool test_threads() {
+
+	OS::get_singleton()->print("\n\nTest 2: Messages from %d threads keep their order per thread\n", MAX_THREADS);
+
+	MessageReceiver *receiver = memnew(MessageReceiver);
+	receiver->reset(MAX_THREADS);
+	_push_from_threads(receiver, MAX_THREADS, MESSAGES_PER_THREAD);
+
+	MessageQueue::get_singleton()->flush();
+	bool pass = receiver->received == MAX_THREADS * MESSAGES_PER_THREAD && receiver->out_of_order == 0;
+
+	// A second round, the threads exited and new ones take over their queues.
+	receiver->reset(MAX_THREADS);
+	_push_from_threads(receiver, MAX_THREADS, MESSAGES_PER_THREAD);
+	MessageQueue::get_singleton()->flush();
+	pass = receiver->received == MAX_THREADS * MESSAGES_PER_THREAD && receiver->out_of_order == 0 && pass;
+
+	OS::get_singleton()->print("\treceived %d, out of order %d\n", receiver->received, receiver->out_of_order);
+
+	memdelete(receiver);
+	return pass;
+}
+
+bool test_order_across_threads() {
+
+	OS::get_singleton()->print("\n\nTest 3: Messages from %d threads keep their push order while flushing\n", RELAY_THREADS);
+
+	MessageReceiver *receiver = memnew(MessageReceiver);
+	std::atomic<int> turn(0);
+
+	RelayContext ctx[RELAY_THREADS];
+	Thread *threads[RELAY_THREADS];
+	for (int i = 0; i < RELAY_THREADS; i++) {
+		ctx[i].receiver = receiver;
+		ctx[i].turn = &turn;
+		ctx[i].thread = i;
+		threads[i] = Thread::create(_relay_messages, &ctx[i]);
+	}
+
+	// Flushing while the threads push, so batches end in the middle of the relay.
+	while (turn.load(std::memory_order_acquire) < RELAY_MESSAGES) {
+		MessageQueue::get_singleton()->flush();
+		OS::get_singleton()->yield();
+	}
+
+	for (int i = 0; i < RELAY_THREADS; i++) {
+		Thread::wait_to_finish(threads[i]);
+		memdelete(threads[i]);
+	}
+	MessageQueue::get_singleton()->flush();
+
+	OS::get_singleton()->print("\treceived %d, out of order %d\n", receiver->received, receiver->out_of_order);
+	bool pass = receiver->received == RELAY_MESSAGES && receiver->out_of_order == 0;
+
+	memdelete(receiver);
+	return pass;
+}
+
+bool test_push_while_flushing() {
+
+	OS::get_singleton()->print("\n\nTest 4: Messages pushed while flushing are flushed too\n");
+
+	MessageReceiver *receiver = memnew(MessageReceiver);
+	receiver->requeue = 1000;
+
+	Variant index = 0;
+	const Variant *argp[] = { &index };
+	MessageQueue::get_singleton()->push_callable(callable_mp(receiver, &MessageReceiver::on_requeue), argp, 1);
+	MessageQueue::get_singleton()->flush();
+
+	// Every call but the last pushes the next one.
+	OS::get_singleton()->print("\treceived %d\n", receiver->received);
+	bool pass = receiver->received == receiver->requeue + 1;
+
+	memdelete(receiver);
+	return pass;
+}
+
+bool test_benchmark() {
+
+	OS::get_singleton()->print("\n\nTest 5: Benchmark pushing %d deferred calls per thread\n", BENCHMARK_MESSAGES_PER_THREAD);
+
+	MessageReceiver *receiver = memnew(MessageReceiver);
+	bool pass = true;
+
+	for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+		receiver->reset(threads);
+		uint64_t push_usec = _push_from_threads(receiver, threads, BENCHMARK_MESSAGES_PER_THREAD);
+
+		uint64_t from = OS::get_singleton()->get_ticks_usec();
+		MessageQueue::get_singleton()->flush();
+		uint64_t flush_usec = OS::get_singleton()->get_ticks_usec() - from;
+
+		OS::get_singleton()->print("\t%d threads: push %d msec, flush %d msec\n", threads, int(push_usec / 1000), int(flush_usec / 1000));
+		pass = receiver->received == threads * BENCHMARK_MESSAGES_PER_THREAD && receiver->out_of_order == 0 && pass;
+	}
+
+	memdelete(receiver);
+	return pass;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_single_thread,
+	test_threads,
+	test_order_across_threads,
+	test_push_while_flushing,
+	test_benchmark,
+	nullptr
+
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestMessageQueue
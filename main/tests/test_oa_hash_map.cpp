@@ -30,11 +30,89 @@
 
 #include "test_oa_hash_map.h"
 
+#include "core/hash_map.h"
 #include "core/oa_hash_map.h"
 #include "core/os/os.h"
+#include "core/swiss_hash_map.h"
 
 namespace TestOAHashMap {
 
+// Thin adapters so the benchmarks below run the same code on all three maps.
+
+template <class K, class V>
+static void bench_set(HashMap<K, V> &p_map, const K &p_key, const V &p_value) { p_map.set(p_key, p_value); }
+template <class K, class V>
+static void bench_set(OAHashMap<K, V> &p_map, const K &p_key, const V &p_value) { p_map.set(p_key, p_value); }
+template <class K, class V>
+static void bench_set(SwissHashMap<K, V> &p_map, const K &p_key, const V &p_value) { p_map.set(p_key, p_value); }
+
+template <class K, class V>
+static const V *bench_get(const HashMap<K, V> &p_map, const K &p_key) { return p_map.getptr(p_key); }
+template <class K, class V>
+static const V *bench_get(const OAHashMap<K, V> &p_map, const K &p_key) { return p_map.lookup_ptr(p_key); }
+template <class K, class V>
+static const V *bench_get(const SwissHashMap<K, V> &p_map, const K &p_key) { return p_map.getptr(p_key); }
+
+template <class K, class V>
+static void bench_erase(HashMap<K, V> &p_map, const K &p_key) { p_map.erase(p_key); }
+template <class K, class V>
+static void bench_erase(OAHashMap<K, V> &p_map, const K &p_key) { p_map.remove(p_key); }
+template <class K, class V>
+static void bench_erase(SwissHashMap<K, V> &p_map, const K &p_key) { p_map.erase(p_key); }
+
+// Inserts p_count keys, looks all of them up, looks up as many missing keys,
+// then erases every key. p_keys holds the present keys followed by the missing ones.
+template <class M, class K>
+static void benchmark_map(const char *p_name, const Vector<K> &p_keys, int p_count, int p_rounds) {
+	uint64_t insert_usec = 0;
+	uint64_t hit_usec = 0;
+	uint64_t miss_usec = 0;
+	uint64_t erase_usec = 0;
+	int found = 0;
+
+	for (int r = 0; r < p_rounds; r++) {
+		M map;
+
+		uint64_t t = OS::get_singleton()->get_ticks_usec();
+		for (int i = 0; i < p_count; i++) {
+			bench_set(map, p_keys[i], i);
+		}
+		insert_usec += OS::get_singleton()->get_ticks_usec() - t;
+
+		t = OS::get_singleton()->get_ticks_usec();
+		for (int i = 0; i < p_count; i++) {
+			found += bench_get(map, p_keys[i]) != nullptr;
+		}
+		hit_usec += OS::get_singleton()->get_ticks_usec() - t;
+
+		t = OS::get_singleton()->get_ticks_usec();
+		for (int i = p_count; i < p_count * 2; i++) {
+			found += bench_get(map, p_keys[i]) != nullptr;
+		}
+		miss_usec += OS::get_singleton()->get_ticks_usec() - t;
+
+		t = OS::get_singleton()->get_ticks_usec();
+		for (int i = 0; i < p_count; i++) {
+			bench_erase(map, p_keys[i]);
+		}
+		erase_usec += OS::get_singleton()->get_ticks_usec() - t;
+	}
+
+	if (found != p_count * p_rounds) {
+		OS::get_singleton()->print("%s: found %d keys, expected %d!\n", p_name, found, p_count * p_rounds);
+	}
+	OS::get_singleton()->print("%-14s insert %7d usec, hit %7d usec, miss %7d usec, erase %7d usec\n", p_name,
+			int(insert_usec / p_rounds), int(hit_usec / p_rounds), int(miss_usec / p_rounds), int(erase_usec / p_rounds));
+}
+
+template <class K>
+static void benchmark_maps(const char *p_title, const Vector<K> &p_keys, int p_count, int p_rounds) {
+	OS::get_singleton()->print("\n%s, %d keys (average of %d rounds):\n", p_title, p_count, p_rounds);
+	benchmark_map<HashMap<K, int>>("HashMap", p_keys, p_count, p_rounds);
+	benchmark_map<OAHashMap<K, int>>("OAHashMap", p_keys, p_count, p_rounds);
+	benchmark_map<SwissHashMap<K, int>>("SwissHashMap", p_keys, p_count, p_rounds);
+}
+
 MainLoop *test() {
 
 	OS::get_singleton()->print("\n\n\nHello from test\n");
@@ -152,6 +230,95 @@ MainLoop *test() {
 		map.set(5, 1);
 	}
 
+	// SwissHashMap against HashMap with random inserts and erases, enough to
+	// grow the table and to fill groups with tombstones.
+	{
+		OS::get_singleton()->print("SwissHashMap consistency test started...\n");
+
+		SwissHashMap<int, int> swiss;
+		HashMap<int, int> reference;
+		bool ok = true;
+
+		Math::seed(0);
+		for (int i = 0; i < 200000 && ok; i++) {
+			int key = Math::rand() % 5000;
+			switch (Math::rand() % 3) {
+				case 0: {
+					swiss[key] = i;
+					reference[key] = i;
+				} break;
+				case 1: {
+					ok = swiss.erase(key) == reference.erase(key);
+				} break;
+				case 2: {
+					const int *a = swiss.getptr(key);
+					const int *b = reference.getptr(key);
+					ok = (a == nullptr) == (b == nullptr) && (!a || *a == *b);
+				} break;
+			}
+			ok = ok && swiss.size() == reference.size();
+		}
+
+		uint32_t iterated = 0;
+		for (const int *k = swiss.next(nullptr); k && ok; k = swiss.next(k)) {
+			ok = reference.has(*k);
+			iterated++;
+		}
+		ok = ok && iterated == reference.size();
+
+		SwissHashMap<int, int> copy = swiss;
+		ok = ok && copy.size() == swiss.size();
+		for (const int *k = reference.next(nullptr); k && ok; k = reference.next(k)) {
+			ok = copy.has(*k) && copy[*k] == reference[*k];
+		}
+
+		OS::get_singleton()->print("SwissHashMap consistency test %s.\n", ok ? "passed" : "FAILED");
+	}
+
+	// benchmarks against HashMap and OAHashMap
+	{
+		const int count = 100000;
+		const int rounds = 5;
+
+		Math::seed(1);
+
+		Vector<uint32_t> int_keys;
+		int_keys.resize(count * 2);
+		{
+			SwissHashMap<uint32_t, bool> used;
+			for (int i = 0; i < count * 2; i++) {
+				uint32_t key;
+				do {
+					key = Math::rand();
+				} while (used.has(key));
+				used[key] = true;
+				int_keys.write[i] = key;
+			}
+		}
+		benchmark_maps("Random integer keys", int_keys, count, rounds);
+
+		Vector<uint32_t> sequential_keys;
+		sequential_keys.resize(count * 2);
+		for (int i = 0; i < count * 2; i++) {
+			sequential_keys.write[i] = i;
+		}
+		benchmark_maps("Sequential integer keys", sequential_keys, count, rounds);
+
+		Vector<String> string_keys;
+		string_keys.resize(count * 2);
+		for (int i = 0; i < count * 2; i++) {
+			string_keys.write[i] = "res://some/path/resource_" + itos(int_keys[i]) + ".tres";
+		}
+		benchmark_maps("String keys", string_keys, count, rounds);
+
+		Vector<StringName> string_name_keys;
+		string_name_keys.resize(count * 2);
+		for (int i = 0; i < count * 2; i++) {
+			string_name_keys.write[i] = StringName(string_keys[i]);
+		}
+		benchmark_maps("StringName keys", string_name_keys, count, rounds);
+	}
+
 	return nullptr;
 }
 } // namespace TestOAHashMap
@@ -0,0 +1,253 @@
+/*************************************************************************/
+/*  test_object_db.cpp                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_object_db.h"
+
+#include "core/object.h"
+#include "core/os/os.h"
+#include "core/os/thread.h"
+
+namespace TestObjectDB {
+
+enum {
+	MAX_THREADS = 8,
+	LIVE_OBJECTS = 256,
+	ROUNDS = 200,
+	LOOKUPS_PER_ROUND = 2048,
+};
+
+struct Context {
+	Mutex *global_lock; // Emulates an object table behind a single lock.
+	std::atomic<uint64_t> *shared_ids; // Written by the other threads, may be stale.
+	int seed;
+	bool failed;
+	uint64_t operations;
+};
+
+static void _churn_thread(void *p_ud) {
+
+	Context *ctx = (Context *)p_ud;
+	uint32_t state = ctx->seed * 2654435761u + 1;
+	Object *objects[LIVE_OBJECTS];
+
+	for (int round = 0; round < ROUNDS; round++) {
+		for (int i = 0; i < LIVE_OBJECTS; i++) {
+			if (ctx->global_lock) {
+				ctx->global_lock->lock();
+			}
+			objects[i] = memnew(Object);
+			if (ctx->global_lock) {
+				ctx->global_lock->unlock();
+			}
+			ctx->shared_ids[(ctx->seed * LIVE_OBJECTS + i) % (MAX_THREADS * LIVE_OBJECTS)].store(objects[i]->get_instance_id(), std::memory_order_relaxed);
+		}
+
+		// Own objects must always be found, other ones may be freed at any
+		// time but must never resolve to an object of this thread.
+		for (int i = 0; i < LOOKUPS_PER_ROUND; i++) {
+			state = state * 1664525u + 1013904223u;
+			if (ctx->global_lock) {
+				ctx->global_lock->lock();
+			}
+			if (i & 1) {
+				Object *own = objects[(state >> 8) % LIVE_OBJECTS];
+				if (ObjectDB::get_instance(own->get_instance_id()) != own) {
+					ctx->failed = true;
+				}
+			} else {
+				ObjectID id = ObjectID(ctx->shared_ids[(state >> 8) % (MAX_THREADS * LIVE_OBJECTS)].load(std::memory_order_relaxed));
+				Object *other = ObjectDB::get_instance(id);
+				for (int j = 0; other && j < 4; j++) {
+					if (other == objects[(state >> (8 + j)) % LIVE_OBJECTS] && other->get_instance_id() != id) {
+						ctx->failed = true;
+					}
+				}
+			}
+			if (ctx->global_lock) {
+				ctx->global_lock->unlock();
+			}
+		}
+
+		for (int i = 0; i < LIVE_OBJECTS; i++) {
+			ObjectID id = objects[i]->get_instance_id();
+			if (ctx->global_lock) {
+				ctx->global_lock->lock();
+			}
+			memdelete(objects[i]);
+			if (ctx->global_lock) {
+				ctx->global_lock->unlock();
+			}
+			if (ObjectDB::get_instance(id) != nullptr) {
+				ctx->failed = true; // Freed IDs must stay invalid, even if the slot is reused.
+			}
+		}
+
+		ctx->operations += LIVE_OBJECTS * 2 + LOOKUPS_PER_ROUND;
+	}
+}
+
+static bool _run(int p_threads, bool p_global_lock, uint64_t &r_usec, uint64_t &r_operations) {
+
+	Mutex global_lock;
+	Context ctx[MAX_THREADS];
+	Thread *threads[MAX_THREADS];
+	std::atomic<uint64_t> shared_ids[MAX_THREADS * LIVE_OBJECTS];
+	for (int i = 0; i < MAX_THREADS * LIVE_OBJECTS; i++) {
+		shared_ids[i].store(0);
+	}
+
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+
+	for (int i = 0; i < p_threads; i++) {
+		ctx[i].global_lock = p_global_lock ? &global_lock : nullptr;
+		ctx[i].shared_ids = shared_ids;
+		ctx[i].seed = i + 1;
+		ctx[i].failed = false;
+		ctx[i].operations = 0;
+		threads[i] = Thread::create(_churn_thread, &ctx[i]);
+	}
+
+	bool failed = false;
+	r_operations = 0;
+	for (int i = 0; i < p_threads; i++) {
+		Thread::wait_to_finish(threads[i]);
+		memdelete(threads[i]);
+		failed = failed || ctx[i].failed;
+		r_operations += ctx[i].operations;
+	}
+
+	r_usec = OS::get_singleton()->get_ticks_usec() - from;
+	return !failed;
+}
+
+bool test_lifetime() {
+
+	OS::get_singleton()->print("\n\nTest 1: Instance IDs stay valid while alive and invalid once freed\n");
+
+	int count = ObjectDB::get_object_count();
+	bool pass = true;
+
+	Vector<Object *> objects;
+	Vector<ObjectID> ids;
+	for (int i = 0; i < 10000; i++) {
+		Object *o = memnew(Object);
+		objects.push_back(o);
+		ids.push_back(o->get_instance_id());
+	}
+	pass = pass && ObjectDB::get_object_count() == count + objects.size();
+
+	for (int i = 0; i < objects.size(); i++) {
+		pass = pass && ObjectDB::get_instance(ids[i]) == objects[i];
+	}
+
+	// Free every other object and create new ones, which reuse their slots.
+	for (int i = 0; i < objects.size(); i += 2) {
+		memdelete(objects[i]);
+	}
+	Vector<Object *> reused;
+	for (int i = 0; i < objects.size() / 2; i++) {
+		reused.push_back(memnew(Object));
+	}
+
+	for (int i = 0; i < objects.size(); i++) {
+		pass = pass && ObjectDB::get_instance(ids[i]) == (i % 2 ? objects[i] : nullptr);
+	}
+	for (int i = 0; i < reused.size(); i++) {
+		pass = pass && ObjectDB::get_instance(reused[i]->get_instance_id()) == reused[i];
+	}
+
+	for (int i = 1; i < objects.size(); i += 2) {
+		memdelete(objects[i]);
+	}
+	for (int i = 0; i < reused.size(); i++) {
+		memdelete(reused[i]);
+	}
+	pass = pass && ObjectDB::get_object_count() == count;
+	pass = pass && ObjectDB::get_instance(ObjectID()) == nullptr;
+
+	return pass;
+}
+
+bool test_contention() {
+
+	OS::get_singleton()->print("\n\nTest 2: Creating, freeing and looking up objects from concurrent threads\n");
+	OS::get_singleton()->print("\t%d objects per thread, %d lookups per round, %d rounds\n", LIVE_OBJECTS, LOOKUPS_PER_ROUND, ROUNDS);
+
+	bool pass = true;
+
+	for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+		uint64_t locked_usec = 0;
+		uint64_t usec = 0;
+		uint64_t operations = 0;
+		pass = _run(threads, true, locked_usec, operations) && pass;
+		pass = _run(threads, false, usec, operations) && pass;
+
+		OS::get_singleton()->print("\t%d threads: global lock %8.2f Mops/s, lock-free %8.2f Mops/s\n", threads, double(operations) / locked_usec, double(operations) / usec);
+	}
+
+	return pass;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_lifetime,
+	test_contention,
+	nullptr
+
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestObjectDB
@@ -0,0 +1,399 @@
+/*************************************************************************/
+/*  test_resource_format_binary.cpp                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+
+#include "test_resource_format_binary.h"
+
+#include "core/io/resource_format_binary.h"
+#include "core/io/resource_loader.h"
+#include "core/io/resource_saver.h"
+#include "core/os/dir_access.h"
+#include "core/os/file_access.h"
+#include "core/os/os.h"
+#include "scene/resources/audio_stream_sample.h"
+#include "scene/resources/resource_format_text.h"
+
+#include <string.h>
+
+namespace TestResourceFormatBinary {
+
+enum {
+	LAZY_LOAD_MIN_SIZE = 64 * 1024,
+	LARGE_SAMPLE_SIZE = 256 * 1024,
+	SMALL_SAMPLE_SIZE = 1024,
+	MIX_RATE = 22050,
+	LARGE_ARRAY_SIZE = 100003,
+	VERTEX_COUNT = 5000,
+	FLOAT_COUNT = 7,
+};
+
+static String _get_temp_path(const String &p_file) {
+
+	return OS::get_singleton()->get_cache_path().plus_file(p_file);
+}
+
+static Vector<uint8_t> _make_bytes(int p_size) {
+
+	Vector<uint8_t> bytes;
+	bytes.resize(p_size);
+	for (int i = 0; i < p_size; i++) {
+		bytes.write[i] = (i * 7 + (i >> 8)) & 0xFF;
+	}
+	return bytes;
+}
+
+static bool _equal(const Vector<uint8_t> &p_a, const Vector<uint8_t> &p_b) {
+
+	return p_a.size() == p_b.size() && memcmp(p_a.ptr(), p_b.ptr(), p_a.size()) == 0;
+}
+
+// Saves a 16 bits stereo sample, then loads it back with the given lazy load threshold.
+static Ref<AudioStreamSample> _save_and_load_sample(const String &p_path, const Vector<uint8_t> &p_data, uint32_t p_lazy_load_min_size) {
+
+	Ref<AudioStreamSample> sample;
+	sample.instance();
+	sample->set_format(AudioStreamSample::FORMAT_16_BITS);
+	sample->set_stereo(true);
+	sample->set_mix_rate(MIX_RATE);
+	sample->set_data(p_data);
+
+	Error err = ResourceSaver::save(p_path, sample);
+	if (err != OK) {
+		OS::get_singleton()->print("\tSaving '%s' failed\n", p_path.utf8().get_data());
+		return Ref<AudioStreamSample>();
+	}
+
+	uint32_t previous_min_size = ResourceFormatLoaderBinary::get_lazy_load_min_size();
+	ResourceFormatLoaderBinary::set_lazy_load_min_size(p_lazy_load_min_size);
+	Ref<AudioStreamSample> loaded = ResourceLoader::load(p_path, "", true);
+	ResourceFormatLoaderBinary::set_lazy_load_min_size(previous_min_size);
+
+	if (loaded.is_null()) {
+		OS::get_singleton()->print("\tLoading '%s' failed\n", p_path.utf8().get_data());
+	}
+	return loaded;
+}
+
+bool test_lazy_sample() {
+
+	OS::get_singleton()->print("\n\nTest 1: Large sample data is read on first use\n");
+
+	String path = _get_temp_path("test_lazy_sample.res");
+	Vector<uint8_t> data = _make_bytes(LARGE_SAMPLE_SIZE);
+	Ref<AudioStreamSample> sample = _save_and_load_sample(path, data, LAZY_LOAD_MIN_SIZE);
+	if (sample.is_null()) {
+		DirAccess::remove_file_or_error(path);
+		return false;
+	}
+
+	bool deferred = sample->get_deferred_property("data") != nullptr;
+	float expected_length = float(LARGE_SAMPLE_SIZE / 4) / MIX_RATE; // 2 bytes per sample, 2 channels.
+	bool length_ok = Math::is_equal_approx(sample->get_length(), expected_length);
+	// get_length() must work from the recorded size, without reading the data.
+	bool still_deferred = sample->get_deferred_property("data") != nullptr;
+
+	bool data_ok = _equal(sample->get_data(), data);
+	bool released = sample->get_deferred_property("data") == nullptr;
+
+	DirAccess::remove_file_or_error(path);
+
+	OS::get_singleton()->print("\tdeferred: %s, length: %s, deferred after length: %s, data: %s, released: %s\n", deferred ? "yes" : "no", length_ok ? "ok" : "wrong", still_deferred ? "yes" : "no", data_ok ? "ok" : "wrong", released ? "yes" : "no");
+	return deferred && length_ok && still_deferred && data_ok && released;
+}
+
+bool test_small_sample() {
+
+	OS::get_singleton()->print("\n\nTest 2: Sample data below the threshold is loaded up front\n");
+
+	String path = _get_temp_path("test_small_sample.res");
+	Vector<uint8_t> data = _make_bytes(SMALL_SAMPLE_SIZE);
+	Ref<AudioStreamSample> sample = _save_and_load_sample(path, data, LAZY_LOAD_MIN_SIZE);
+	if (sample.is_null()) {
+		DirAccess::remove_file_or_error(path);
+		return false;
+	}
+
+	bool deferred = sample->get_deferred_property("data") != nullptr;
+	bool data_ok = _equal(sample->get_data(), data);
+
+	DirAccess::remove_file_or_error(path);
+
+	OS::get_singleton()->print("\tdeferred: %s, data: %s\n", deferred ? "yes" : "no", data_ok ? "ok" : "wrong");
+	return !deferred && data_ok;
+}
+
+bool test_lazy_load_disabled() {
+
+	OS::get_singleton()->print("\n\nTest 3: Nothing is deferred when lazy loading is off\n");
+
+	String path = _get_temp_path("test_eager_sample.res");
+	Vector<uint8_t> data = _make_bytes(LARGE_SAMPLE_SIZE);
+	Ref<AudioStreamSample> sample = _save_and_load_sample(path, data, 0);
+	if (sample.is_null()) {
+		DirAccess::remove_file_or_error(path);
+		return false;
+	}
+
+	bool deferred = sample->get_deferred_property("data") != nullptr;
+	bool data_ok = _equal(sample->get_data(), data);
+
+	DirAccess::remove_file_or_error(path);
+
+	OS::get_singleton()->print("\tdeferred: %s, data: %s\n", deferred ? "yes" : "no", data_ok ? "ok" : "wrong");
+	return !deferred && data_ok;
+}
+
+// Plain data arrays of a resource, kept in its metadata so no custom class is needed.
+struct ArrayResource {
+
+	Vector<uint8_t> bytes;
+	Vector<Vector3> vertices;
+	Vector<float> floats;
+	Ref<Resource> dependency;
+
+	Ref<Resource> make() const {
+
+		Ref<Resource> resource;
+		resource.instance();
+		resource->set_meta("bytes", bytes);
+		resource->set_meta("vertices", vertices);
+		resource->set_meta("floats", floats);
+		resource->set_meta("dependency", dependency);
+		return resource;
+	}
+
+	bool matches(const Ref<Resource> &p_resource) const {
+
+		Vector<uint8_t> loaded_bytes = p_resource->get_meta("bytes");
+		Vector<Vector3> loaded_vertices = p_resource->get_meta("vertices");
+		Vector<float> loaded_floats = p_resource->get_meta("floats");
+		return _equal(loaded_bytes, bytes) &&
+			   loaded_vertices.size() == vertices.size() && memcmp(loaded_vertices.ptr(), vertices.ptr(), vertices.size() * sizeof(Vector3)) == 0 &&
+			   loaded_floats.size() == floats.size() && memcmp(loaded_floats.ptr(), floats.ptr(), floats.size() * sizeof(float)) == 0;
+	}
+};
+
+static String _get_dependency_path(const String &p_name) {
+
+	return "res://test_resource_format_binary/" + p_name + ".res";
+}
+
+// Dependencies only live in the resource cache, which is where the loader finds
+// them first. They need resource paths, rename_dependencies() only maps those.
+static Ref<Resource> _make_dependency(const String &p_path) {
+
+	Ref<Resource> dependency;
+	dependency.instance();
+	dependency->set_path(p_path);
+	return dependency;
+}
+
+static ArrayResource _make_array_resource(const String &p_dependency_path) {
+
+	ArrayResource arrays;
+	arrays.bytes = _make_bytes(LARGE_ARRAY_SIZE);
+	arrays.vertices.resize(VERTEX_COUNT);
+	for (int i = 0; i < VERTEX_COUNT; i++) {
+		arrays.vertices.write[i] = Vector3(i, -i, i * 0.5);
+	}
+	arrays.floats.resize(FLOAT_COUNT); // Small enough to only need 16 bytes alignment.
+	for (int i = 0; i < FLOAT_COUNT; i++) {
+		arrays.floats.write[i] = i * 1.5;
+	}
+
+	arrays.dependency = _make_dependency(p_dependency_path);
+	return arrays;
+}
+
+// Loads the file back and checks its data, its dependency, and that every array
+// in its array table starts at an aligned offset holding the array's payload.
+static bool _check_aligned_file(const String &p_path, const ArrayResource &p_arrays, const String &p_dependency_path, bool p_compressed) {
+
+	Ref<Resource> loaded = ResourceLoader::load(p_path, "", true);
+	bool data_ok = loaded.is_valid() && p_arrays.matches(loaded);
+
+	List<String> dependencies;
+	ResourceLoader::get_dependencies(p_path, &dependencies);
+	bool dependency_ok = dependencies.size() == 1 && dependencies.front()->get() == p_dependency_path;
+
+	Vector<ResourceLoaderBinary::AlignedArray> arrays;
+	Error err = ResourceFormatLoaderBinary::get_aligned_arrays(p_path, &arrays);
+
+	int misaligned = 0;
+	for (int i = 0; i < arrays.size(); i++) {
+		uint64_t alignment = arrays[i].size >= 4096 ? 64 : 16;
+		if (arrays[i].offset % alignment != 0) {
+			misaligned++;
+		}
+	}
+
+	bool payload_ok = true;
+	if (!p_compressed) {
+		// Offsets of compressed files are in the uncompressed stream, only check the plain ones.
+		FileAccessRef f = FileAccess::open(p_path, FileAccess::READ);
+		for (int i = 0; i < arrays.size(); i++) {
+			if (f && arrays[i].size == (uint64_t)p_arrays.bytes.size()) {
+				Vector<uint8_t> payload;
+				payload.resize(p_arrays.bytes.size());
+				f->seek(arrays[i].offset);
+				f->get_buffer(payload.ptrw(), payload.size());
+				payload_ok = payload_ok && _equal(payload, p_arrays.bytes);
+			}
+		}
+	}
+
+	OS::get_singleton()->print("\t%s: data: %s, dependency: %s, %d arrays, %d misaligned, payload: %s\n", p_path.get_file().utf8().get_data(), data_ok ? "ok" : "wrong", dependency_ok ? "ok" : "wrong", arrays.size(), misaligned, payload_ok ? "ok" : "wrong");
+	return data_ok && dependency_ok && err == OK && arrays.size() == 3 && misaligned == 0 && payload_ok;
+}
+
+bool test_aligned_arrays() {
+
+	OS::get_singleton()->print("\n\nTest 4: Arrays are saved aligned\n");
+
+	String dependency_path = _get_dependency_path("dependency");
+	ArrayResource arrays = _make_array_resource(dependency_path);
+	Ref<Resource> resource = arrays.make();
+
+	bool pass = true;
+	for (int compressed = 0; compressed < 2; compressed++) {
+		String path = _get_temp_path(compressed ? "test_aligned_arrays_compressed.res" : "test_aligned_arrays.res");
+		Error err = ResourceSaver::save(path, resource, compressed ? ResourceSaver::FLAG_COMPRESS : 0);
+		pass = err == OK && _check_aligned_file(path, arrays, dependency_path, compressed) && pass;
+		DirAccess::remove_file_or_error(path);
+	}
+
+	return pass;
+}
+
+bool test_rename_dependencies() {
+
+	OS::get_singleton()->print("\n\nTest 5: Arrays stay aligned when dependencies are renamed\n");
+
+	String dependency_path = _get_dependency_path("dependency");
+	String long_dependency_path = _get_dependency_path("dependency_with_a_much_longer_name");
+	ArrayResource arrays = _make_array_resource(dependency_path);
+	Ref<Resource> long_dependency = _make_dependency(long_dependency_path);
+
+	bool pass = true;
+	for (int compressed = 0; compressed < 2; compressed++) {
+		String path = _get_temp_path(compressed ? "test_renamed_arrays_compressed.res" : "test_renamed_arrays.res");
+		pass = ResourceSaver::save(path, arrays.make(), compressed ? ResourceSaver::FLAG_COMPRESS : 0) == OK && pass;
+
+		// Grow the external resource table, then shrink it back.
+		Map<String, String> to_long;
+		to_long[dependency_path] = long_dependency_path;
+		pass = ResourceLoader::rename_dependencies(path, to_long) == OK && pass;
+		pass = _check_aligned_file(path, arrays, long_dependency_path, compressed) && pass;
+
+		Map<String, String> to_short;
+		to_short[long_dependency_path] = dependency_path;
+		pass = ResourceLoader::rename_dependencies(path, to_short) == OK && pass;
+		pass = _check_aligned_file(path, arrays, dependency_path, compressed) && pass;
+
+		DirAccess::remove_file_or_error(path);
+	}
+
+	return pass;
+}
+
+bool test_version_3() {
+
+	OS::get_singleton()->print("\n\nTest 6: Version 3 files still load\n");
+
+	String dependency_path = _get_dependency_path("dependency");
+	String text_path = _get_temp_path("test_version_3.tres");
+	String path = _get_temp_path("test_version_3.res");
+	ArrayResource arrays = _make_array_resource(dependency_path);
+
+	// The text to binary converter writes version 3.
+	bool converted = ResourceSaver::save(text_path, arrays.make()) == OK && ResourceFormatLoaderText::convert_file_to_binary(text_path, path) == OK;
+
+	uint32_t version = 0;
+	{
+		FileAccessRef f = FileAccess::open(path, FileAccess::READ);
+		if (f) {
+			f->seek(20); // Magic, endianness, real size, major and minor versions come first.
+			version = f->get_32();
+		}
+	}
+
+	Ref<Resource> loaded = ResourceLoader::load(path, "", true);
+	bool data_ok = loaded.is_valid() && arrays.matches(loaded);
+
+	Vector<ResourceLoaderBinary::AlignedArray> aligned;
+	Error err = ResourceFormatLoaderBinary::get_aligned_arrays(path, &aligned);
+
+	DirAccess::remove_file_or_error(text_path);
+	DirAccess::remove_file_or_error(path);
+
+	OS::get_singleton()->print("\tconverted: %s, version: %d, data: %s, %d aligned arrays\n", converted ? "yes" : "no", version, data_ok ? "ok" : "wrong", aligned.size());
+	return converted && version == 3 && data_ok && err == OK && aligned.empty();
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_lazy_sample,
+	test_small_sample,
+	test_lazy_load_disabled,
+	test_aligned_arrays,
+	test_rename_dependencies,
+	test_version_3,
+	nullptr
+
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestResourceFormatBinary
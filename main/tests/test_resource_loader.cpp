@@ -0,0 +1,370 @@
+/*************************************************************************/
+/*  test_resource_loader.cpp                                             */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+
+#include "test_resource_loader.h"
+
+#include "core/io/resource_loader.h"
+#include "core/job_system.h"
+#include "core/os/os.h"
+
+namespace TestResourceLoader {
+
+enum {
+	TEXTURE_COUNT = 48,
+	MATERIAL_COUNT = 12,
+	MESH_COUNT = 24,
+	LOAD_USEC = 2000, // Time every resource takes to load, standing in for file I/O and decoding.
+};
+
+static String _get_path(const String &p_name) {
+
+	return "res://test_resource_loader/" + p_name + ".testdep";
+}
+
+// Serves resources out of a dependency graph kept in memory. Like the binary
+// format loader without sub-threads, it loads its dependencies with
+// ResourceLoader::load() before doing its own work.
+class ResourceFormatLoaderTestGraph : public ResourceFormatLoader {
+
+	GDCLASS(ResourceFormatLoaderTestGraph, ResourceFormatLoader);
+
+public:
+	Map<String, Vector<String>> graph;
+	Set<String> unloaded_dependencies; // Listed as dependencies but never loaded, to build cycles.
+
+	Mutex mutex;
+	Map<String, int> load_counts;
+	int early_loads = 0; // Loads that started before all their dependencies were loaded.
+
+	virtual RES load(const String &p_path, const String &p_original_path, Error *r_error, bool p_use_sub_threads, float *r_progress, bool p_no_cache) {
+
+		if (r_error) {
+			*r_error = ERR_FILE_CANT_OPEN;
+		}
+		if (!graph.has(p_path)) {
+			return RES();
+		}
+
+		const Vector<String> &dependencies = graph[p_path];
+
+		mutex.lock();
+		if (load_counts.has(p_path)) {
+			load_counts[p_path]++;
+		} else {
+			load_counts[p_path] = 1;
+		}
+		for (int i = 0; i < dependencies.size(); i++) {
+			if (!unloaded_dependencies.has(dependencies[i]) && !ResourceCache::has(dependencies[i])) {
+				early_loads++;
+				break;
+			}
+		}
+		mutex.unlock();
+
+		Array loaded;
+		for (int i = 0; i < dependencies.size(); i++) {
+			if (unloaded_dependencies.has(dependencies[i])) {
+				continue;
+			}
+			RES dependency = ResourceLoader::load(dependencies[i]);
+			if (dependency.is_null()) {
+				return RES();
+			}
+			loaded.push_back(dependency);
+			if (r_progress) {
+				*r_progress = float(i + 1) / float(dependencies.size() + 1);
+			}
+		}
+
+		OS::get_singleton()->delay_usec(LOAD_USEC);
+
+		Ref<Resource> resource;
+		resource.instance();
+		resource->set_meta("dependencies", loaded);
+
+		if (r_error) {
+			*r_error = OK;
+		}
+		return resource;
+	}
+
+	virtual void get_recognized_extensions(List<String> *p_extensions) const {
+
+		p_extensions->push_back("testdep");
+	}
+
+	virtual bool handles_type(const String &p_type) const {
+
+		return p_type == "Resource";
+	}
+
+	virtual String get_resource_type(const String &p_path) const {
+
+		return p_path.get_extension() == "testdep" ? "Resource" : "";
+	}
+
+	virtual void get_dependencies(const String &p_path, List<String> *p_dependencies, bool p_add_types) {
+
+		if (!graph.has(p_path)) {
+			return;
+		}
+		const Vector<String> &dependencies = graph[p_path];
+		for (int i = 0; i < dependencies.size(); i++) {
+			p_dependencies->push_back(p_add_types ? dependencies[i] + "::Resource" : dependencies[i]);
+		}
+	}
+
+	void reset() {
+
+		load_counts.clear();
+		early_loads = 0;
+	}
+};
+
+static Ref<ResourceFormatLoaderTestGraph> loader;
+
+// Two levels sharing meshes, materials and textures, with a few textures
+// referenced directly as well.
+static void _setup_graph() {
+
+	Map<String, Vector<String>> &graph = loader->graph;
+
+	for (int i = 0; i < TEXTURE_COUNT; i++) {
+		graph[_get_path("texture_" + itos(i))] = Vector<String>();
+	}
+	for (int i = 0; i < MATERIAL_COUNT; i++) {
+		Vector<String> &dependencies = graph[_get_path("material_" + itos(i))];
+		for (int j = 0; j < TEXTURE_COUNT / MATERIAL_COUNT; j++) {
+			dependencies.push_back(_get_path("texture_" + itos(i * TEXTURE_COUNT / MATERIAL_COUNT + j)));
+		}
+	}
+	for (int i = 0; i < MESH_COUNT; i++) {
+		Vector<String> &dependencies = graph[_get_path("mesh_" + itos(i))];
+		dependencies.push_back(_get_path("material_" + itos(i % MATERIAL_COUNT)));
+		dependencies.push_back(_get_path("material_" + itos((i + 5) % MATERIAL_COUNT)));
+	}
+
+	Vector<String> &level_a = graph[_get_path("level_a")];
+	for (int i = 0; i < MESH_COUNT * 2 / 3; i++) {
+		level_a.push_back(_get_path("mesh_" + itos(i)));
+	}
+	for (int i = 0; i < 8; i++) {
+		level_a.push_back(_get_path("texture_" + itos(i)));
+	}
+
+	Vector<String> &level_b = graph[_get_path("level_b")];
+	for (int i = MESH_COUNT / 3; i < MESH_COUNT; i++) {
+		level_b.push_back(_get_path("mesh_" + itos(i)));
+	}
+
+	// Listed as depending on each other, but only one of them actually loads the other.
+	graph[_get_path("cycle_a")].push_back(_get_path("cycle_b"));
+	graph[_get_path("cycle_b")].push_back(_get_path("cycle_a"));
+	loader->unloaded_dependencies.insert(_get_path("cycle_a"));
+}
+
+static bool _has_workers() {
+
+	return JobSystem::get_singleton() && JobSystem::get_singleton()->get_thread_count() > 0;
+}
+
+// Polls the request until done, checking progress never goes backwards.
+static ResourceLoader::ThreadLoadStatus _wait_for(const String &p_path, bool *r_progress_valid) {
+
+	float last_progress = 0;
+	while (true) {
+		float progress = 0;
+		ResourceLoader::ThreadLoadStatus status = ResourceLoader::load_threaded_get_status(p_path, &progress);
+		if (progress < last_progress || progress < 0 || progress > 1) {
+			*r_progress_valid = false;
+		}
+		last_progress = progress;
+		if (status != ResourceLoader::THREAD_LOAD_IN_PROGRESS) {
+			return status;
+		}
+		OS::get_singleton()->delay_usec(100);
+	}
+}
+
+static bool _check_load_counts() {
+
+	for (Map<String, int>::Element *E = loader->load_counts.front(); E; E = E->next()) {
+		if (E->get() != 1) {
+			OS::get_singleton()->print("\t%s loaded %d times\n", E->key().utf8().get_data(), E->get());
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool test_level_load() {
+
+	OS::get_singleton()->print("\n\nTest 1: Threaded request loads every resource of a level once, dependencies first\n");
+
+	loader->reset();
+
+	String level = _get_path("level_a");
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+
+	if (ResourceLoader::load_threaded_request(level, "Resource") != OK) {
+		OS::get_singleton()->print("\trequest failed\n");
+		return false;
+	}
+
+	bool progress_valid = true;
+	ResourceLoader::ThreadLoadStatus status = _wait_for(level, &progress_valid);
+	RES resource = ResourceLoader::load_threaded_get(level);
+
+	uint64_t usec = OS::get_singleton()->get_ticks_usec() - from;
+	int loaded = loader->load_counts.size();
+
+	OS::get_singleton()->print("\t%d resources in %d msec (%d msec loading them one after another), %d threads\n", loaded, int(usec / 1000), loaded * LOAD_USEC / 1000, _has_workers() ? JobSystem::get_singleton()->get_thread_count() : 0);
+
+	if (status != ResourceLoader::THREAD_LOAD_LOADED || resource.is_null()) {
+		OS::get_singleton()->print("\tlevel failed to load\n");
+		return false;
+	}
+	if (!progress_valid) {
+		OS::get_singleton()->print("\tprogress went backwards or out of range\n");
+		return false;
+	}
+	if (!_check_load_counts()) {
+		return false;
+	}
+	if (_has_workers() && loader->early_loads > 0) {
+		OS::get_singleton()->print("\t%d resources started loading before their dependencies\n", loader->early_loads);
+		return false;
+	}
+
+	return ResourceLoader::load_threaded_get_status(level) == ResourceLoader::THREAD_LOAD_INVALID_RESOURCE;
+}
+
+static bool test_shared_requests() {
+
+	OS::get_singleton()->print("\n\nTest 2: Overlapping requests share the resources they have in common\n");
+
+	loader->reset();
+
+	String level_a = _get_path("level_a");
+	String level_b = _get_path("level_b");
+	String material = _get_path("material_3");
+
+	if (ResourceLoader::load_threaded_request(level_a, "Resource") != OK || ResourceLoader::load_threaded_request(level_b, "Resource") != OK) {
+		OS::get_singleton()->print("\trequest failed\n");
+		return false;
+	}
+
+	// A blocking load of something both levels use, while they are in flight.
+	RES shared = ResourceLoader::load(material);
+
+	bool progress_valid = true;
+	_wait_for(level_b, &progress_valid);
+	RES resource_b = ResourceLoader::load_threaded_get(level_b);
+	RES resource_a = ResourceLoader::load_threaded_get(level_a);
+
+	if (resource_a.is_null() || resource_b.is_null() || shared.is_null()) {
+		OS::get_singleton()->print("\tfailed to load\n");
+		return false;
+	}
+	if (!progress_valid) {
+		OS::get_singleton()->print("\tprogress went backwards or out of range\n");
+		return false;
+	}
+	if (ResourceCache::get(material) != shared.ptr()) {
+		OS::get_singleton()->print("\tshared material was loaded twice\n");
+		return false;
+	}
+
+	OS::get_singleton()->print("\t%d resources loaded\n", loader->load_counts.size());
+
+	return _check_load_counts();
+}
+
+static bool test_cyclic_dependencies() {
+
+	OS::get_singleton()->print("\n\nTest 3: Cyclic dependency lists don't stall the request\n");
+
+	loader->reset();
+
+	String path = _get_path("cycle_a");
+	if (ResourceLoader::load_threaded_request(path, "Resource") != OK) {
+		OS::get_singleton()->print("\trequest failed\n");
+		return false;
+	}
+
+	RES resource = ResourceLoader::load_threaded_get(path);
+	return resource.is_valid() && _check_load_counts();
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_level_load,
+	test_shared_requests,
+	test_cyclic_dependencies,
+	nullptr
+
+};
+
+MainLoop *test() {
+
+	loader.instance();
+	_setup_graph();
+	ResourceLoader::add_resource_format_loader(loader, true);
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	ResourceLoader::remove_resource_format_loader(loader);
+	loader.unref();
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestResourceLoader
@@ -0,0 +1,470 @@
+/*************************************************************************/
+/*  test_rid.cpp                                                         */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#include "test_rid.h"
+
+#include "core/os/os.h"
+#include "core/os/thread.h"
+#include "core/rid_owner.h"
+#include "core/set.h"
+
+namespace TestRID {
+
+enum {
+	THREADS = 4,
+	RIDS_PER_THREAD = 1000,
+	SLOTS_PER_CHUNK = 64,
+	BENCHMARK_MAX_THREADS = 8,
+	BENCHMARK_BATCH = 256,
+	BENCHMARK_ROUNDS = 200,
+};
+
+struct Data {
+	uint32_t thread;
+	uint32_t index;
+};
+
+typedef RID_Owner<Data, true> ThreadSafeOwner;
+
+static uint32_t _get_slot(const RID &p_rid) {
+	return uint32_t(p_rid.get_id() & 0xFFFFFFFF);
+}
+
+template <bool THREAD_SAFE>
+static bool _test_reuse() {
+
+	RID_Owner<Data, THREAD_SAFE> owner;
+	bool pass = true;
+
+	Vector<RID> rids;
+	for (int i = 0; i < 10000; i++) {
+		Data data;
+		data.thread = 0;
+		data.index = i;
+		rids.push_back(owner.make_rid(data));
+	}
+	pass = pass && owner.get_rid_count() == uint32_t(rids.size());
+
+	for (int i = 0; i < rids.size(); i++) {
+		Data *data = owner.getornull(rids[i]);
+		pass = pass && data && data->index == uint32_t(i);
+	}
+
+	// Free every other RID and make new ones, which reuse their slots.
+	for (int i = 0; i < rids.size(); i += 2) {
+		owner.free(rids[i]);
+	}
+	Vector<RID> reused;
+	for (int i = 0; i < rids.size() / 2; i++) {
+		Data data;
+		data.thread = 1;
+		data.index = i;
+		reused.push_back(owner.make_rid(data));
+	}
+
+	for (int i = 0; i < rids.size(); i++) {
+		pass = pass && owner.owns(rids[i]) == bool(i % 2);
+		pass = pass && (owner.getornull(rids[i]) != nullptr) == bool(i % 2);
+	}
+	for (int i = 0; i < reused.size(); i++) {
+		Data *data = owner.getornull(reused[i]);
+		pass = pass && data && data->thread == 1 && data->index == uint32_t(i);
+	}
+
+	for (int i = 1; i < rids.size(); i += 2) {
+		owner.free(rids[i]);
+	}
+	for (int i = 0; i < reused.size(); i++) {
+		owner.free(reused[i]);
+	}
+	pass = pass && owner.get_rid_count() == 0;
+	pass = pass && owner.getornull(RID()) == nullptr;
+
+	return pass;
+}
+
+template <bool THREAD_SAFE>
+static bool _test_index_lookup() {
+
+	RID_Owner<Data, THREAD_SAFE> owner;
+
+	Vector<RID> rids;
+	for (int i = 0; i < 1000; i++) {
+		Data data;
+		data.thread = 0;
+		data.index = i;
+		rids.push_back(owner.make_rid(data));
+	}
+
+	// Leave holes, which thread safe owners have to skip when scanning.
+	Set<RID> live;
+	for (int i = 0; i < rids.size(); i++) {
+		if (i % 3 == 0) {
+			owner.free(rids[i]);
+		} else {
+			live.insert(rids[i]);
+		}
+	}
+	bool pass = owner.get_rid_count() == uint32_t(live.size());
+
+	// Every live RID must be found at exactly one index.
+	Set<RID> found;
+	for (uint32_t i = 0; i < owner.get_rid_count(); i++) {
+		RID rid = owner.get_rid_by_index(i);
+		Data *data = owner.get_ptr_by_index(i);
+		pass = pass && live.has(rid) && !found.has(rid);
+		pass = pass && data && data == owner.getornull(rid) && rids[data->index] == rid;
+		found.insert(rid);
+	}
+	pass = pass && found.size() == live.size();
+
+	List<RID> owned;
+	owner.get_owned_list(&owned);
+	pass = pass && owned.size() == live.size();
+	for (List<RID>::Element *E = owned.front(); E; E = E->next()) {
+		pass = pass && live.has(E->get());
+	}
+
+	for (Set<RID>::Element *E = live.front(); E; E = E->next()) {
+		owner.free(E->get());
+	}
+
+	return pass && owner.get_rid_count() == 0;
+}
+
+struct FreeListContext {
+	ThreadSafeOwner *owner;
+	uint32_t thread;
+	RID rids[RIDS_PER_THREAD];
+	const RID *to_free; // Made by another thread.
+	const RID *stale; // Being freed by another thread meanwhile.
+	bool failed;
+};
+
+static void _make_thread(void *p_ud) {
+
+	FreeListContext *ctx = (FreeListContext *)p_ud;
+	for (int i = 0; i < RIDS_PER_THREAD; i++) {
+		Data data;
+		data.thread = ctx->thread;
+		data.index = i;
+		ctx->rids[i] = ctx->owner->make_rid(data);
+	}
+}
+
+static void _free_and_make_thread(void *p_ud) {
+
+	FreeListContext *ctx = (FreeListContext *)p_ud;
+	Set<uint32_t> own_slots;
+	for (int i = 0; i < RIDS_PER_THREAD; i++) {
+		// The freed slot goes to the list of this thread and is reused
+		// right away, while another thread may still look up its old RID.
+		ctx->owner->free(ctx->to_free[i]);
+
+		Data data;
+		data.thread = ctx->thread;
+		data.index = i;
+		ctx->rids[i] = ctx->owner->make_rid(data);
+		own_slots.insert(_get_slot(ctx->rids[i]));
+
+		// Other RIDs may be freed at any time, but never resolve once their
+		// slot holds a RID of this thread.
+		if (ctx->owner->getornull(ctx->stale[i]) && own_slots.has(_get_slot(ctx->stale[i]))) {
+			ctx->failed = true;
+		}
+	}
+}
+
+static void _free_thread(void *p_ud) {
+
+	FreeListContext *ctx = (FreeListContext *)p_ud;
+	for (int i = 0; i < RIDS_PER_THREAD; i++) {
+		ctx->owner->free(ctx->rids[i]);
+	}
+}
+
+static void _run_threads(FreeListContext *p_ctx, void (*p_func)(void *), bool p_concurrent) {
+
+	Thread *threads[THREADS];
+	for (int i = 0; i < THREADS; i++) {
+		threads[i] = Thread::create(p_func, &p_ctx[i]);
+		if (!p_concurrent) {
+			Thread::wait_to_finish(threads[i]);
+		}
+	}
+	for (int i = 0; i < THREADS; i++) {
+		if (p_concurrent) {
+			Thread::wait_to_finish(threads[i]);
+		}
+		memdelete(threads[i]);
+	}
+}
+
+// Checks that the RIDs made by all threads are valid and use distinct slots.
+static bool _check_rids(ThreadSafeOwner &p_owner, FreeListContext *p_ctx, uint32_t &r_max_slot) {
+
+	bool pass = true;
+	Set<uint32_t> slots;
+	for (int t = 0; t < THREADS; t++) {
+		for (int i = 0; i < RIDS_PER_THREAD; i++) {
+			Data *data = p_owner.getornull(p_ctx[t].rids[i]);
+			pass = pass && data && data->thread == p_ctx[t].thread && data->index == uint32_t(i);
+			uint32_t slot = _get_slot(p_ctx[t].rids[i]);
+			pass = pass && !slots.has(slot);
+			slots.insert(slot);
+			r_max_slot = MAX(r_max_slot, slot);
+		}
+	}
+	return pass;
+}
+
+bool test_reuse() {
+
+	OS::get_singleton()->print("\n\nTest 1: RIDs stay valid while alive and invalid once freed\n");
+
+	return _test_reuse<false>() && _test_reuse<true>();
+}
+
+bool test_index_lookup() {
+
+	OS::get_singleton()->print("\n\nTest 2: Looking up RIDs by index skips freed slots\n");
+
+	return _test_index_lookup<false>() && _test_index_lookup<true>();
+}
+
+bool test_free_lists() {
+
+	OS::get_singleton()->print("\n\nTest 3: Thread safe owners recycle slots through per-thread free lists\n");
+
+	ThreadSafeOwner owner(SLOTS_PER_CHUNK * sizeof(Data));
+	bool pass = true;
+	uint32_t max_slot = 0;
+
+	// A thread gets back the slots it freed itself.
+	Vector<RID> rids;
+	Set<uint32_t> freed;
+	for (int i = 0; i < RIDS_PER_THREAD; i++) {
+		Data data;
+		data.thread = 0;
+		data.index = i;
+		rids.push_back(owner.make_rid(data));
+	}
+	for (int i = 0; i < rids.size(); i++) {
+		freed.insert(_get_slot(rids[i]));
+		max_slot = MAX(max_slot, _get_slot(rids[i]));
+		owner.free(rids[i]);
+	}
+	for (int i = 0; i < rids.size(); i++) {
+		Data data;
+		data.thread = 0;
+		data.index = i;
+		rids.write[i] = owner.make_rid(data);
+		pass = pass && freed.has(_get_slot(rids[i]));
+	}
+	for (int i = 0; i < rids.size(); i++) {
+		owner.free(rids[i]);
+	}
+	OS::get_singleton()->print("\tOwn slots reused: %s\n", pass ? "yes" : "no");
+
+	FreeListContext ctx[THREADS];
+	RID old_rids[THREADS][RIDS_PER_THREAD];
+
+	for (int i = 0; i < THREADS; i++) {
+		ctx[i].owner = &owner;
+		ctx[i].thread = i + 1;
+		ctx[i].failed = false;
+	}
+
+	// Concurrent makes must never hand out a slot twice.
+	_run_threads(ctx, _make_thread, true);
+	pass = _check_rids(owner, ctx, max_slot) && pass;
+
+	// Free RIDs made by the next thread, so slots move between lists.
+	for (int i = 0; i < THREADS; i++) {
+		for (int j = 0; j < RIDS_PER_THREAD; j++) {
+			old_rids[i][j] = ctx[i].rids[j];
+		}
+	}
+	for (int i = 0; i < THREADS; i++) {
+		ctx[i].to_free = old_rids[(i + 1) % THREADS];
+		ctx[i].stale = old_rids[(i + 2) % THREADS];
+	}
+	_run_threads(ctx, _free_and_make_thread, true);
+	pass = _check_rids(owner, ctx, max_slot) && pass;
+	for (int i = 0; i < THREADS; i++) {
+		pass = pass && !ctx[i].failed;
+		for (int j = 0; j < RIDS_PER_THREAD; j++) {
+			pass = pass && !owner.owns(old_rids[i][j]);
+		}
+	}
+	pass = pass && owner.get_rid_count() == THREADS * RIDS_PER_THREAD;
+
+	// Threads that start with an empty list take slots from the others
+	// instead of adding chunks. One at a time, so it is deterministic.
+	uint32_t chunks = max_slot / SLOTS_PER_CHUNK + 1;
+	_run_threads(ctx, _free_thread, true);
+	_run_threads(ctx, _make_thread, false);
+	pass = _check_rids(owner, ctx, max_slot) && pass;
+	OS::get_singleton()->print("\tChunks: %d before, %d after refilling from other lists\n", chunks, max_slot / SLOTS_PER_CHUNK + 1);
+	pass = pass && max_slot / SLOTS_PER_CHUNK + 1 == chunks;
+
+	_run_threads(ctx, _free_thread, true);
+
+	return pass && owner.get_rid_count() == 0;
+}
+
+template <class O>
+struct BenchmarkContext {
+	O *owner;
+	Mutex *global_lock; // Emulates a server guarding a non thread safe owner with a single lock.
+	uint64_t operations;
+};
+
+template <class O>
+static void _benchmark_thread(void *p_ud) {
+
+	BenchmarkContext<O> *ctx = (BenchmarkContext<O> *)p_ud;
+	RID rids[BENCHMARK_BATCH];
+	Data data;
+	data.thread = 0;
+	data.index = 0;
+
+	for (int round = 0; round < BENCHMARK_ROUNDS; round++) {
+		for (int i = 0; i < BENCHMARK_BATCH; i++) {
+			if (ctx->global_lock) {
+				ctx->global_lock->lock();
+			}
+			rids[i] = ctx->owner->make_rid(data);
+			if (ctx->global_lock) {
+				ctx->global_lock->unlock();
+			}
+		}
+		for (int i = 0; i < BENCHMARK_BATCH * 4; i++) {
+			if (ctx->global_lock) {
+				ctx->global_lock->lock();
+			}
+			ctx->owner->getornull(rids[i % BENCHMARK_BATCH]);
+			if (ctx->global_lock) {
+				ctx->global_lock->unlock();
+			}
+		}
+		for (int i = 0; i < BENCHMARK_BATCH; i++) {
+			if (ctx->global_lock) {
+				ctx->global_lock->lock();
+			}
+			ctx->owner->free(rids[i]);
+			if (ctx->global_lock) {
+				ctx->global_lock->unlock();
+			}
+		}
+		ctx->operations += BENCHMARK_BATCH * 6;
+	}
+}
+
+template <class O>
+static double _benchmark(int p_threads, bool p_global_lock) {
+
+	O owner;
+	Mutex global_lock;
+	BenchmarkContext<O> ctx[BENCHMARK_MAX_THREADS];
+	Thread *threads[BENCHMARK_MAX_THREADS];
+
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+
+	for (int i = 0; i < p_threads; i++) {
+		ctx[i].owner = &owner;
+		ctx[i].global_lock = p_global_lock ? &global_lock : nullptr;
+		ctx[i].operations = 0;
+		threads[i] = Thread::create(_benchmark_thread<O>, &ctx[i]);
+	}
+
+	uint64_t operations = 0;
+	for (int i = 0; i < p_threads; i++) {
+		Thread::wait_to_finish(threads[i]);
+		memdelete(threads[i]);
+		operations += ctx[i].operations;
+	}
+
+	uint64_t usec = OS::get_singleton()->get_ticks_usec() - from;
+	return double(operations) / MAX(usec, (uint64_t)1);
+}
+
+bool test_benchmark() {
+
+	OS::get_singleton()->print("\n\nTest 4: Benchmark making, looking up and freeing RIDs from concurrent threads\n");
+	OS::get_singleton()->print("\t%d RIDs per batch, %d rounds\n", BENCHMARK_BATCH, BENCHMARK_ROUNDS);
+
+	for (int threads = 1; threads <= BENCHMARK_MAX_THREADS; threads *= 2) {
+		double locked = _benchmark<RID_Owner<Data, false>>(threads, true);
+		double thread_safe = _benchmark<ThreadSafeOwner>(threads, false);
+
+		OS::get_singleton()->print("\t%d threads: global lock %8.2f Mops/s, thread safe owner %8.2f Mops/s\n", threads, locked, thread_safe);
+	}
+
+	return true;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_reuse,
+	test_index_lookup,
+	test_free_lists,
+	test_benchmark,
+	nullptr
+
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestRID
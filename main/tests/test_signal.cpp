@@ -0,0 +1,293 @@
+/*************************************************************************/
+/*  test_signal.cpp                                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_signal.h"
+
+#include "core/callable_method_pointer.h"
+#include "core/object.h"
+#include "core/os/os.h"
+
+namespace TestSignal {
+
+enum {
+	BENCHMARK_CONNECTIONS = 8,
+	BENCHMARK_EMISSIONS = 200000,
+};
+
+class SignalReceiver : public Object {
+
+public:
+	Object *emitter;
+	Vector<int> calls;
+	int count;
+	Callable disconnect_on_call; // Disconnected by on_disconnect().
+	Callable connect_on_call; // Connected by on_connect().
+
+	void on_value(int p_value, int p_id) {
+		calls.push_back(p_id * 1000 + p_value);
+	}
+	void on_first(int p_value) { on_value(p_value, 0); }
+	void on_second(int p_value) { on_value(p_value, 1); }
+	void on_third(int p_value) { on_value(p_value, 2); }
+	void on_fourth(int p_value) { on_value(p_value, 3); }
+
+	void on_disconnect(int p_value) {
+		on_value(p_value, 9);
+		emitter->disconnect("value_changed", disconnect_on_call);
+	}
+	void on_connect(int p_value) {
+		on_value(p_value, 8);
+		if (!emitter->is_connected("value_changed", connect_on_call)) {
+			emitter->connect("value_changed", connect_on_call);
+		}
+	}
+	void on_emit(int p_value) {
+		on_value(p_value, 7);
+		if (p_value > 0) {
+			emitter->emit_signal("value_changed", p_value - 1);
+		}
+	}
+	void on_count() {
+		count++;
+	}
+
+	SignalReceiver() {
+		emitter = nullptr;
+		count = 0;
+	}
+};
+
+static Object *_make_emitter() {
+
+	Object *emitter = memnew(Object);
+	emitter->add_user_signal(MethodInfo("value_changed", PropertyInfo(Variant::INT, "value")));
+	emitter->add_user_signal(MethodInfo("ticked"));
+	return emitter;
+}
+
+static bool _check_calls(const SignalReceiver *p_receiver, const int *p_expected, int p_count) {
+
+	bool pass = p_receiver->calls.size() == p_count;
+	for (int i = 0; pass && i < p_count; i++) {
+		pass = p_receiver->calls[i] == p_expected[i];
+	}
+
+	if (!pass) {
+		String got;
+		for (int i = 0; i < p_receiver->calls.size(); i++) {
+			got += itos(p_receiver->calls[i]) + " ";
+		}
+		OS::get_singleton()->print("\tFAIL: unexpected calls: %s\n", got.utf8().get_data());
+	}
+	return pass;
+}
+
+bool test_emission_order() {
+
+	OS::get_singleton()->print("\n\nTest 1: Connections are called in connection order\n");
+
+	Object *emitter = _make_emitter();
+	SignalReceiver *receiver = memnew(SignalReceiver);
+
+	emitter->connect("value_changed", callable_mp(receiver, &SignalReceiver::on_third));
+	emitter->connect("value_changed", callable_mp(receiver, &SignalReceiver::on_first));
+	emitter->connect("value_changed", callable_mp(receiver, &SignalReceiver::on_second));
+	emitter->emit_signal("value_changed", 5);
+
+	static const int expected[] = { 2005, 5, 1005 };
+	bool pass = _check_calls(receiver, expected, 3);
+
+	List<Object::Connection> connections;
+	emitter->get_signal_connection_list("value_changed", &connections);
+	pass = connections.size() == 3 && pass;
+
+	memdelete(receiver);
+	memdelete(emitter);
+	return pass;
+}
+
+bool test_disconnect_while_emitting() {
+
+	OS::get_singleton()->print("\n\nTest 2: Disconnecting while emitting skips the slot\n");
+
+	Object *emitter = _make_emitter();
+	SignalReceiver *receiver = memnew(SignalReceiver);
+	receiver->emitter = emitter;
+	receiver->disconnect_on_call = callable_mp(receiver, &SignalReceiver::on_second);
+
+	emitter->connect("value_changed", callable_mp(receiver, &SignalReceiver::on_first));
+	emitter->connect("value_changed", callable_mp(receiver, &SignalReceiver::on_disconnect));
+	emitter->connect("value_changed", callable_mp(receiver, &SignalReceiver::on_second));
+	emitter->connect("value_changed", callable_mp(receiver, &SignalReceiver::on_third));
+	emitter->emit_signal("value_changed", 1);
+
+	static const int expected_first[] = { 1, 9001, 2001 };
+	bool pass = _check_calls(receiver, expected_first, 3);
+	pass = !emitter->is_connected("value_changed", receiver->disconnect_on_call) && pass;
+
+	// Compacted after the emission, the remaining slots still work and can be disconnected.
+	receiver->calls.clear();
+	emitter->disconnect("value_changed", callable_mp(receiver, &SignalReceiver::on_disconnect));
+	emitter->emit_signal("value_changed", 2);
+
+	static const int expected_second[] = { 2, 2002 };
+	pass = _check_calls(receiver, expected_second, 2) && pass;
+
+	List<Object::Connection> connections;
+	emitter->get_signal_connection_list("value_changed", &connections);
+	pass = connections.size() == 2 && pass;
+
+	memdelete(receiver);
+	memdelete(emitter);
+	return pass;
+}
+
+bool test_connect_while_emitting() {
+
+	OS::get_singleton()->print("\n\nTest 3: Connecting while emitting waits for the next emission\n");
+
+	Object *emitter = _make_emitter();
+	SignalReceiver *receiver = memnew(SignalReceiver);
+	receiver->emitter = emitter;
+	receiver->connect_on_call = callable_mp(receiver, &SignalReceiver::on_fourth);
+
+	emitter->connect("value_changed", callable_mp(receiver, &SignalReceiver::on_connect));
+	emitter->connect("value_changed", callable_mp(receiver, &SignalReceiver::on_first));
+	emitter->emit_signal("value_changed", 1);
+
+	static const int expected_first[] = { 8001, 1 };
+	bool pass = _check_calls(receiver, expected_first, 2);
+
+	receiver->calls.clear();
+	emitter->emit_signal("value_changed", 2);
+
+	static const int expected_second[] = { 8002, 2, 3002 };
+	pass = _check_calls(receiver, expected_second, 3) && pass;
+
+	memdelete(receiver);
+	memdelete(emitter);
+	return pass;
+}
+
+bool test_nested_oneshot_and_binds() {
+
+	OS::get_singleton()->print("\n\nTest 4: Nested emission, one shot connections and binds\n");
+
+	Object *emitter = _make_emitter();
+	SignalReceiver *receiver = memnew(SignalReceiver);
+	receiver->emitter = emitter;
+
+	// The one shot slot is disconnected by the innermost emission while the outer ones still walk it.
+	emitter->connect("value_changed", callable_mp(receiver, &SignalReceiver::on_emit));
+	emitter->connect("value_changed", callable_mp(receiver, &SignalReceiver::on_first), Vector<Variant>(), Object::CONNECT_ONESHOT);
+	emitter->emit_signal("value_changed", 2);
+
+	static const int expected_nested[] = { 7002, 7001, 7000, 0 };
+	bool pass = _check_calls(receiver, expected_nested, 4);
+	pass = !emitter->is_connected("value_changed", callable_mp(receiver, &SignalReceiver::on_first)) && pass;
+
+	// A bound argument on a regular method callable.
+	emitter->connect("ticked", Callable(receiver, "set_meta"), varray("ticked", 42));
+	emitter->emit_signal("ticked");
+	pass = int(receiver->get_meta("ticked")) == 42 && pass;
+
+	memdelete(receiver);
+	memdelete(emitter);
+	return pass;
+}
+
+bool test_benchmark() {
+
+	OS::get_singleton()->print("\n\nTest 5: Benchmark emitting to %d connections, %d emissions\n", BENCHMARK_CONNECTIONS, BENCHMARK_EMISSIONS);
+
+	Object *emitter = _make_emitter();
+	Vector<SignalReceiver *> receivers;
+	for (int i = 0; i < BENCHMARK_CONNECTIONS; i++) {
+		SignalReceiver *receiver = memnew(SignalReceiver);
+		emitter->connect("ticked", callable_mp(receiver, &SignalReceiver::on_count));
+		receivers.push_back(receiver);
+	}
+
+	uint64_t t = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < BENCHMARK_EMISSIONS; i++) {
+		emitter->emit_signal("ticked");
+	}
+	uint64_t usec = OS::get_singleton()->get_ticks_usec() - t;
+
+	OS::get_singleton()->print("\t%d msec, %.1f nsec per connection call\n", int(usec / 1000), usec * 1000.0 / (double(BENCHMARK_EMISSIONS) * BENCHMARK_CONNECTIONS));
+
+	bool pass = true;
+	for (int i = 0; i < receivers.size(); i++) {
+		pass = receivers[i]->count == BENCHMARK_EMISSIONS && pass;
+		memdelete(receivers[i]);
+	}
+	memdelete(emitter);
+	return pass;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_emission_order,
+	test_disconnect_while_emitting,
+	test_connect_while_emitting,
+	test_nested_oneshot_and_binds,
+	test_benchmark,
+	nullptr
+
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestSignal
@@ -0,0 +1,327 @@
+/*************************************************************************/
+/*  test_small_allocator.cpp                                             */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_small_allocator.h"
+
+#include "core/os/os.h"
+
+#ifdef SMALL_ALLOCATOR_ENABLED
+
+#include "core/math/random_pcg.h"
+#include "core/os/mutex.h"
+#include "core/os/small_allocator.h"
+#include "core/os/thread.h"
+
+#include <string.h>
+#include <atomic>
+
+#endif
+
+namespace TestSmallAllocator {
+
+#ifdef SMALL_ALLOCATOR_ENABLED
+
+enum {
+	CHURN_THREADS = 4,
+	CHURN_ITERATIONS = 200000,
+	CHURN_LIVE_BLOCKS = 256,
+	CHURN_DRAIN_INTERVAL = 64,
+	HANDOFF_BLOCKS = 10000,
+	HANDOFF_SIZE = 500, // Largest size class, which little else uses.
+	HANDOFF_CLASS = SmallAllocator::SIZE_CLASS_COUNT - 1,
+};
+
+// Blocks start with their size and are filled with a pattern of their
+// allocating thread, so a block handed out twice is noticed when freed.
+static void _fill(uint8_t *p_block, uint32_t p_size, uint8_t p_pattern) {
+
+	memcpy(p_block, &p_size, sizeof(uint32_t));
+	memset(p_block + sizeof(uint32_t), p_pattern, p_size - sizeof(uint32_t));
+}
+
+static bool _check(const uint8_t *p_block, uint8_t p_pattern) {
+
+	uint32_t size;
+	memcpy(&size, p_block, sizeof(uint32_t));
+	for (uint32_t i = sizeof(uint32_t); i < size; i++) {
+		if (p_block[i] != p_pattern) {
+			return false;
+		}
+	}
+	return true;
+}
+
+struct ChurnThread {
+	int index;
+	Mutex mailbox_mutex;
+	Vector<uint8_t *> mailbox; // Blocks of the previous thread, freed by this one.
+	ChurnThread *next;
+	std::atomic<int> corrupted;
+};
+
+static uint8_t _get_pattern(int p_thread) {
+
+	return uint8_t(0x11 * (p_thread + 1));
+}
+
+static void _drain_mailbox(ChurnThread *p_thread, int p_from) {
+
+	p_thread->mailbox_mutex.lock();
+	Vector<uint8_t *> blocks = p_thread->mailbox;
+	p_thread->mailbox.clear();
+	p_thread->mailbox_mutex.unlock();
+
+	for (int i = 0; i < blocks.size(); i++) {
+		if (!_check(blocks[i], _get_pattern(p_from))) {
+			p_thread->corrupted++;
+		}
+		SmallAllocator::free(blocks[i]);
+	}
+}
+
+static void _churn(void *p_userdata) {
+
+	ChurnThread *thread = (ChurnThread *)p_userdata;
+	int previous = (thread->index + CHURN_THREADS - 1) % CHURN_THREADS;
+	uint8_t pattern = _get_pattern(thread->index);
+	RandomPCG rng(thread->index + 1);
+
+	uint8_t *live[CHURN_LIVE_BLOCKS] = {};
+
+	for (int i = 0; i < CHURN_ITERATIONS; i++) {
+
+		int slot = i % CHURN_LIVE_BLOCKS;
+		if (live[slot]) {
+			if (!_check(live[slot], pattern)) {
+				thread->corrupted++;
+			}
+			if (i & 1) {
+				SmallAllocator::free(live[slot]);
+			} else {
+				// Every other block is freed by the next thread.
+				thread->next->mailbox_mutex.lock();
+				thread->next->mailbox.push_back(live[slot]);
+				thread->next->mailbox_mutex.unlock();
+			}
+		}
+
+		uint32_t size = sizeof(uint32_t) + rng.rand() % (SmallAllocator::MAX_SIZE - sizeof(uint32_t) + 1);
+		live[slot] = (uint8_t *)SmallAllocator::alloc(size);
+		_fill(live[slot], size, pattern);
+
+		if (i % CHURN_DRAIN_INTERVAL == 0) {
+			_drain_mailbox(thread, previous);
+		}
+	}
+
+	for (int i = 0; i < CHURN_LIVE_BLOCKS; i++) {
+		if (live[i]) {
+			if (!_check(live[i], pattern)) {
+				thread->corrupted++;
+			}
+			SmallAllocator::free(live[i]);
+		}
+	}
+}
+
+static uint64_t _sum(const uint64_t *p_values) {
+
+	uint64_t sum = 0;
+	for (int i = 0; i < SmallAllocator::SIZE_CLASS_COUNT; i++) {
+		sum += p_values[i];
+	}
+	return sum;
+}
+
+bool test_churn() {
+
+	OS::get_singleton()->print("\n\nTest 1: %d threads allocate and free, half of the blocks from another thread\n", CHURN_THREADS);
+
+	SmallAllocator::Stats before;
+	SmallAllocator::get_stats(before);
+
+	ChurnThread threads[CHURN_THREADS];
+	Thread *handles[CHURN_THREADS];
+	for (int i = 0; i < CHURN_THREADS; i++) {
+		threads[i].index = i;
+		threads[i].next = &threads[(i + 1) % CHURN_THREADS];
+		threads[i].corrupted = 0;
+	}
+
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < CHURN_THREADS; i++) {
+		handles[i] = Thread::create(_churn, &threads[i]);
+	}
+	for (int i = 0; i < CHURN_THREADS; i++) {
+		Thread::wait_to_finish(handles[i]);
+		memdelete(handles[i]);
+	}
+	uint64_t usec = OS::get_singleton()->get_ticks_usec() - from;
+
+	// Blocks passed on after their receiver exited.
+	int corrupted = 0;
+	for (int i = 0; i < CHURN_THREADS; i++) {
+		_drain_mailbox(&threads[i], (i + CHURN_THREADS - 1) % CHURN_THREADS);
+		corrupted += threads[i].corrupted;
+	}
+
+	SmallAllocator::Stats after;
+	SmallAllocator::get_stats(after);
+
+	uint64_t allocs = _sum(after.allocs) - _sum(before.allocs);
+	uint64_t remote_frees = _sum(after.remote_frees) - _sum(before.remote_frees);
+	OS::get_singleton()->print("\t%d msec, %d allocations, %d collected remote frees, %d corrupted blocks, %d heaps, %d KiB reserved\n", int(usec / 1000), int(allocs), int(remote_frees), corrupted, after.heaps, int(after.reserved_bytes / 1024));
+
+	return corrupted == 0 && allocs >= CHURN_THREADS * CHURN_ITERATIONS && remote_frees > 0;
+}
+
+struct HandoffThread {
+	uint8_t *blocks[HANDOFF_BLOCKS];
+	std::atomic<int> step;
+};
+
+static void _wait_for_step(std::atomic<int> &p_step, int p_value) {
+
+	while (p_step.load(std::memory_order_acquire) != p_value) {
+		OS::get_singleton()->yield();
+	}
+}
+
+static void _handoff(void *p_userdata) {
+
+	HandoffThread *handoff = (HandoffThread *)p_userdata;
+
+	for (int i = 0; i < HANDOFF_BLOCKS; i++) {
+		handoff->blocks[i] = (uint8_t *)SmallAllocator::alloc(HANDOFF_SIZE);
+	}
+	handoff->step.store(1, std::memory_order_release);
+
+	// The blocks are freed by the main thread, allocating again collects them.
+	_wait_for_step(handoff->step, 2);
+	for (int i = 0; i < HANDOFF_BLOCKS; i++) {
+		handoff->blocks[i] = (uint8_t *)SmallAllocator::alloc(HANDOFF_SIZE);
+	}
+	handoff->step.store(3, std::memory_order_release);
+
+	_wait_for_step(handoff->step, 4);
+	for (int i = 0; i < HANDOFF_BLOCKS; i++) {
+		SmallAllocator::free(handoff->blocks[i]);
+	}
+	handoff->step.store(5, std::memory_order_release);
+}
+
+bool test_remote_free() {
+
+	OS::get_singleton()->print("\n\nTest 2: Blocks freed from another thread are reused by their owner\n");
+
+	HandoffThread *handoff = memnew(HandoffThread);
+	handoff->step = 0;
+
+	SmallAllocator::Stats allocated, freed, reused, released;
+
+	Thread *thread = Thread::create(_handoff, handoff);
+
+	_wait_for_step(handoff->step, 1);
+	SmallAllocator::get_stats(allocated);
+	for (int i = 0; i < HANDOFF_BLOCKS; i++) {
+		SmallAllocator::free(handoff->blocks[i]);
+	}
+	SmallAllocator::get_stats(freed);
+	handoff->step.store(2, std::memory_order_release);
+
+	_wait_for_step(handoff->step, 3);
+	SmallAllocator::get_stats(reused);
+	handoff->step.store(4, std::memory_order_release);
+
+	_wait_for_step(handoff->step, 5);
+	SmallAllocator::get_stats(released);
+
+	Thread::wait_to_finish(thread);
+	memdelete(thread);
+	memdelete(handoff);
+
+	int c = HANDOFF_CLASS;
+	OS::get_singleton()->print("\tused after allocating %d, after remote frees %d, after reusing %d, after local frees %d\n", int(allocated.blocks_used[c]), int(freed.blocks_used[c]), int(reused.blocks_used[c]), int(released.blocks_used[c]));
+	OS::get_singleton()->print("\tcollected remote frees %d, reserved %d KiB before reusing and %d KiB after\n", int(reused.remote_frees[c] - freed.remote_frees[c]), int(freed.reserved_bytes / 1024), int(reused.reserved_bytes / 1024));
+
+	bool pass = allocated.blocks_used[c] >= HANDOFF_BLOCKS;
+	// Remote frees count as used until the owner collects them.
+	pass = pass && freed.blocks_used[c] == allocated.blocks_used[c] && freed.remote_frees[c] == allocated.remote_frees[c];
+	pass = pass && reused.remote_frees[c] - freed.remote_frees[c] == HANDOFF_BLOCKS;
+	pass = pass && reused.blocks_used[c] == allocated.blocks_used[c];
+	// The collected blocks were enough, no new slab was needed.
+	pass = pass && reused.reserved_bytes == freed.reserved_bytes;
+	// Emptied slabs go back to the pool.
+	pass = pass && released.blocks_used[c] == allocated.blocks_used[c] - HANDOFF_BLOCKS && released.free_slabs > reused.free_slabs;
+	return pass;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_churn,
+	test_remote_free,
+	nullptr
+
+};
+
+#endif // SMALL_ALLOCATOR_ENABLED
+
+MainLoop *test() {
+
+#ifdef SMALL_ALLOCATOR_ENABLED
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+#else
+	OS::get_singleton()->print("The small allocator is not enabled in this build, build with small_allocator=yes to test it.\n");
+#endif
+
+	return nullptr;
+}
+} // namespace TestSmallAllocator
@@ -1125,6 +1125,95 @@ bool test_35() {
 	return state;
 }
 
+bool test_36() {
+
+	OS::get_singleton()->print("\n\nTest 36: Concatenation and self append\n");
+
+	bool state = true;
+
+	String a = "Hello";
+	String b = "World";
+	state = state && a + b == "HelloWorld";
+	state = state && "<" + a == "<Hello";
+	state = state && a + String() == a && String() + b == b;
+
+	String c = a;
+	c += c;
+	state = state && c == "HelloHello" && a == "Hello";
+
+	String d = a;
+	d += '!';
+	d += " and ";
+	d += b;
+	state = state && d == "Hello! and World" && a == "Hello";
+
+	return state;
+}
+
+bool test_37() {
+
+	OS::get_singleton()->print("\n\nTest 37: String memory and Variant string operation benchmark\n");
+
+	const int count = 100000;
+
+	Vector<CharString> sources;
+	sources.resize(count);
+	Math::seed(0);
+	for (int i = 0; i < count; i++) {
+		// Identifier-like lengths, most strings in a project are short names and paths.
+		int len = 3 + Math::rand() % 30;
+		CharString cs;
+		cs.resize(len + 1);
+		for (int j = 0; j < len; j++) {
+			cs.set(j, 'a' + Math::rand() % 26);
+		}
+		cs.set(len, 0);
+		sources.write[i] = cs;
+	}
+
+	Vector<Variant> strings;
+	strings.resize(count);
+	uint64_t mem_array = Memory::get_mem_usage();
+	for (int i = 0; i < count; i++) {
+		strings.write[i] = String(sources[i].get_data());
+	}
+	uint64_t mem_to = Memory::get_mem_usage();
+	if (mem_to > mem_array) {
+		// Only tracked in debug builds.
+		OS::get_singleton()->print("\t%.1f bytes allocated per string\n", double(mem_to - mem_array) / count);
+	}
+
+	bool valid = true;
+	int equal = 0;
+
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < count - 1; i++) {
+		Variant r;
+		Variant::evaluate(Variant::OP_ADD, strings[i], strings[i + 1], r, valid);
+	}
+	uint64_t add_usec = OS::get_singleton()->get_ticks_usec() - from;
+
+	from = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < count; i++) {
+		Variant r;
+		Variant other = String(sources[i].get_data());
+		Variant::evaluate(Variant::OP_EQUAL, strings[i], other, r, valid);
+		equal += r.operator bool();
+	}
+	uint64_t equal_usec = OS::get_singleton()->get_ticks_usec() - from;
+
+	from = OS::get_singleton()->get_ticks_usec();
+	String built;
+	for (int i = 0; i < count; i++) {
+		built += CharType('a' + i % 26);
+	}
+	uint64_t append_usec = OS::get_singleton()->get_ticks_usec() - from;
+
+	OS::get_singleton()->print("\tOP_ADD %d usec, construct + OP_EQUAL %d usec, append %d chars %d usec\n", int(add_usec), int(equal_usec), count, int(append_usec));
+
+	return valid && equal == count && built.length() == count;
+}
+
 typedef bool (*TestFunc)(void);
 
 TestFunc test_funcs[] = {
@@ -1164,6 +1253,8 @@ TestFunc test_funcs[] = {
 	test_33,
 	test_34,
 	test_35,
+	test_36,
+	test_37,
 	nullptr
 
 };
@@ -0,0 +1,232 @@
+/*************************************************************************/
+/*  test_string_name.cpp                                                 */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_string_name.h"
+
+#include "core/os/os.h"
+#include "core/os/thread.h"
+#include "core/string_name.h"
+
+namespace TestStringName {
+
+enum {
+	MAX_THREADS = 8,
+	NAME_POOL_SIZE = 16384,
+	HOT_NAMES = 64,
+	LOOKUPS_PER_THREAD = 200000,
+};
+
+static const char *static_names[] = { "_process", "_physics_process", "_ready", "_input", "position", "rotation", "scale", "visible" };
+
+struct Context {
+	const Vector<String> *names;
+	Mutex *global_lock; // Emulates a table behind a single lock.
+	bool hot; // Draw from a few names, like per-frame method and property names.
+	int seed;
+	bool failed;
+};
+
+static void _intern_thread(void *p_ud) {
+
+	Context *ctx = (Context *)p_ud;
+	const Vector<String> &names = *ctx->names;
+	uint32_t state = ctx->seed * 2654435761u + 1;
+	int pool = ctx->hot ? HOT_NAMES : names.size();
+
+	for (int i = 0; i < LOOKUPS_PER_THREAD; i++) {
+		state = state * 1664525u + 1013904223u;
+		const String &name = names[(state >> 8) % pool];
+
+		if (ctx->global_lock) {
+			ctx->global_lock->lock();
+		}
+		StringName sn(name);
+		if (ctx->global_lock) {
+			ctx->global_lock->unlock();
+		}
+
+		if ((i & 1023) == 0 && String(sn) != name) {
+			ctx->failed = true;
+		}
+	}
+}
+
+static bool _run(const Vector<String> &p_names, int p_threads, bool p_hot, bool p_global_lock, uint64_t &r_usec) {
+
+	Mutex global_lock;
+	Context ctx[MAX_THREADS];
+	Thread *threads[MAX_THREADS];
+
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+
+	for (int i = 0; i < p_threads; i++) {
+		ctx[i].names = &p_names;
+		ctx[i].global_lock = p_global_lock ? &global_lock : nullptr;
+		ctx[i].hot = p_hot;
+		ctx[i].seed = i + 1;
+		ctx[i].failed = false;
+		threads[i] = Thread::create(_intern_thread, &ctx[i]);
+	}
+
+	bool failed = false;
+	for (int i = 0; i < p_threads; i++) {
+		Thread::wait_to_finish(threads[i]);
+		memdelete(threads[i]);
+		failed = failed || ctx[i].failed;
+	}
+
+	r_usec = OS::get_singleton()->get_ticks_usec() - from;
+	return !failed;
+}
+
+static void _identity_thread(void *p_ud) {
+
+	Context *ctx = (Context *)p_ud;
+	const Vector<String> &names = *ctx->names;
+
+	for (int i = 0; i < names.size(); i++) {
+		// The same name built from a String, a C string and a static C string
+		// must always end up as the same entry.
+		StringName a(names[i]);
+		StringName b(names[i].utf8().get_data());
+		if (a != b || a.hash() != names[i].hash()) {
+			ctx->failed = true;
+		}
+
+		const char *s = static_names[i % (sizeof(static_names) / sizeof(static_names[0]))];
+		StringName c(StaticCString::create(s));
+		StringName d = String(s);
+		if (c != d || String(c) != s) {
+			ctx->failed = true;
+		}
+	}
+}
+
+bool test_identity() {
+
+	OS::get_singleton()->print("\n\nTest 1: Concurrent interning yields unique names\n");
+
+	Vector<String> names;
+	for (int i = 0; i < NAME_POOL_SIZE; i++) {
+		names.push_back("test_string_name_identity_" + itos(i));
+	}
+
+	Context ctx[MAX_THREADS];
+	Thread *threads[MAX_THREADS];
+	for (int i = 0; i < MAX_THREADS; i++) {
+		ctx[i].names = &names;
+		ctx[i].failed = false;
+		threads[i] = Thread::create(_identity_thread, &ctx[i]);
+	}
+
+	bool pass = true;
+	for (int i = 0; i < MAX_THREADS; i++) {
+		Thread::wait_to_finish(threads[i]);
+		memdelete(threads[i]);
+		pass = pass && !ctx[i].failed;
+	}
+
+	// search() finds existing names only.
+	StringName kept(names[0]);
+	pass = pass && StringName::search(names[0]) == kept;
+	pass = pass && StringName::search("test_string_name_never_created") == StringName();
+
+	return pass;
+}
+
+bool test_contention() {
+
+	OS::get_singleton()->print("\n\nTest 2: Interning throughput from concurrent threads\n");
+	OS::get_singleton()->print("\t%d lookups per thread, %d hot names or %d names\n", LOOKUPS_PER_THREAD, HOT_NAMES, NAME_POOL_SIZE);
+
+	Vector<String> names;
+	for (int i = 0; i < NAME_POOL_SIZE; i++) {
+		names.push_back("test_string_name_bench_" + itos(i));
+	}
+
+	// Keep the names alive, so the benchmark measures lookups rather than creation.
+	Vector<StringName> held;
+	for (int i = 0; i < names.size(); i++) {
+		held.push_back(names[i]);
+	}
+
+	bool pass = true;
+
+	for (int hot = 1; hot >= 0; hot--) {
+		for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+			uint64_t locked_usec = 0;
+			uint64_t usec = 0;
+			pass = _run(names, threads, hot, true, locked_usec) && pass;
+			pass = _run(names, threads, hot, false, usec) && pass;
+
+			double total = double(threads) * LOOKUPS_PER_THREAD;
+			OS::get_singleton()->print("\t%s names, %d threads: global lock %8.2f Mnames/s, sharded %8.2f Mnames/s\n", hot ? "hot" : "all", threads, total / locked_usec, total / usec);
+		}
+	}
+
+	return pass;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_identity,
+	test_contention,
+	nullptr
+
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestStringName
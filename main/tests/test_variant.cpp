@@ -0,0 +1,431 @@
+/*************************************************************************/
+/*  test_variant.cpp                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+
+#include "test_variant.h"
+
+#include "core/os/os.h"
+#include "core/variant.h"
+
+namespace TestVariant {
+
+enum {
+	BENCHMARK_ITERATIONS = 5000000,
+};
+
+static Variant _make_sample(Variant::Type p_type, int p_seed) {
+
+	real_t r = 1.5 + p_seed * 0.75;
+	int i = 3 + p_seed * 5;
+
+	switch (p_type) {
+		case Variant::BOOL:
+			return (p_seed & 1) != 0;
+		case Variant::INT:
+			return i;
+		case Variant::FLOAT:
+			return r;
+		case Variant::STRING:
+			return "sample" + itos(p_seed);
+		case Variant::VECTOR2:
+			return Vector2(r, -r * 2);
+		case Variant::VECTOR2I:
+			return Vector2i(i, -i * 2);
+		case Variant::VECTOR3:
+			return Vector3(r, -r * 2, r * 3);
+		case Variant::VECTOR3I:
+			return Vector3i(i, -i * 2, i * 3);
+		case Variant::QUAT:
+			return Quat(r, -r, r * 2, 0.5);
+		case Variant::COLOR:
+			return Color(r, r * 0.5, 0.25, 1);
+		case Variant::STRING_NAME:
+			return StringName("sample" + itos(p_seed));
+		default:
+			return Variant();
+	}
+}
+
+static bool _same_result(const Variant &p_a, const Variant &p_b) {
+
+	return p_a.get_type() == p_b.get_type() && p_a.hash_compare(p_b);
+}
+
+bool test_validated_operators() {
+
+	OS::get_singleton()->print("\n\nTest 1: Validated operator evaluators match Variant::evaluate\n");
+
+	bool pass = true;
+	int checked = 0;
+
+	for (int op = 0; op < Variant::OP_MAX; op++) {
+		bool unary = op == Variant::OP_NEGATE || op == Variant::OP_POSITIVE || op == Variant::OP_BIT_NEGATE || op == Variant::OP_NOT;
+
+		for (int a = 0; a < Variant::VARIANT_MAX; a++) {
+			// Unary operators ignore the right hand type, only check them once.
+			for (int b = 0; b < (unary ? 1 : int(Variant::VARIANT_MAX)); b++) {
+
+				Variant::ValidatedOperatorEvaluator evaluator = Variant::get_validated_operator_evaluator(Variant::Operator(op), Variant::Type(a), Variant::Type(b));
+				if (!evaluator) {
+					continue;
+				}
+
+				for (int seed = 0; seed < 4; seed++) {
+					Variant left = _make_sample(Variant::Type(a), seed);
+					// Unary operators get the operand repeated, like GDScript does.
+					Variant right = unary ? left : _make_sample(Variant::Type(b), (seed * 3 + 1) % 4);
+					if (left.get_type() != a || right.get_type() != (unary ? a : b)) {
+						OS::get_singleton()->print("\tNo sample for %s and %s\n", Variant::get_type_name(Variant::Type(a)).utf8().get_data(), Variant::get_type_name(Variant::Type(b)).utf8().get_data());
+						pass = false;
+						break;
+					}
+
+					Variant expected;
+					bool valid;
+					Variant::evaluate(Variant::Operator(op), left, right, expected, valid);
+
+					// Start from a destination of another type, which has to be released.
+					Variant ret = "previous value";
+					evaluator(&left, &right, &ret);
+
+					// The result can alias an operand.
+					Variant aliased = left;
+					evaluator(&aliased, &right, &aliased);
+
+					if (!valid || !_same_result(expected, ret) || !_same_result(expected, aliased) || ret.get_type() != Variant::get_operator_return_type(Variant::Operator(op), Variant::Type(a), Variant::Type(b))) {
+						OS::get_singleton()->print("\tMismatch in '%s' for %s and %s: expected %s, got %s\n", Variant::get_operator_name(Variant::Operator(op)).utf8().get_data(), Variant::get_type_name(Variant::Type(a)).utf8().get_data(), Variant::get_type_name(Variant::Type(b)).utf8().get_data(), String(expected).utf8().get_data(), String(ret).utf8().get_data());
+						pass = false;
+					}
+				}
+				checked++;
+			}
+		}
+	}
+
+	OS::get_singleton()->print("\tChecked %d operator and type combinations\n", checked);
+
+	return pass && checked > 0;
+}
+
+static void _print_timing(const char *p_name, uint64_t p_evaluate_usec, uint64_t p_validated_usec) {
+
+	OS::get_singleton()->print("\t%-22s evaluate %6d msec, validated %6d msec, %.2fx\n", p_name, int(p_evaluate_usec / 1000), int(p_validated_usec / 1000), double(p_evaluate_usec) / MAX(p_validated_usec, 1));
+}
+
+// Accumulates into the left operand, like `a = a + b` in a script loop.
+static bool _benchmark_op(const char *p_name, Variant::Operator p_op, const Variant &p_start, const Variant &p_operand) {
+
+	Variant::ValidatedOperatorEvaluator evaluator = Variant::get_validated_operator_evaluator(p_op, p_start.get_type(), p_operand.get_type());
+	if (!evaluator) {
+		OS::get_singleton()->print("\t%s: no validated evaluator\n", p_name);
+		return false;
+	}
+
+	Variant acc_evaluate = p_start;
+	bool valid = true;
+	uint64_t t = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		Variant::evaluate(p_op, acc_evaluate, p_operand, acc_evaluate, valid);
+	}
+	uint64_t evaluate_usec = OS::get_singleton()->get_ticks_usec() - t;
+
+	Variant acc_validated = p_start;
+	t = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		evaluator(&acc_validated, &p_operand, &acc_validated);
+	}
+	uint64_t validated_usec = OS::get_singleton()->get_ticks_usec() - t;
+
+	_print_timing(p_name, evaluate_usec, validated_usec);
+
+	return valid && _same_result(acc_evaluate, acc_validated);
+}
+
+bool test_benchmark() {
+
+	OS::get_singleton()->print("\n\nTest 2: Benchmark tight math loops, %d iterations\n", BENCHMARK_ITERATIONS);
+
+	bool pass = true;
+	pass = _benchmark_op("int + int", Variant::OP_ADD, 0, 3) && pass;
+	pass = _benchmark_op("int ^ int", Variant::OP_BIT_XOR, 0x1234, 0x5555) && pass;
+	pass = _benchmark_op("float * float", Variant::OP_MULTIPLY, 1.0, 1.0000001) && pass;
+	pass = _benchmark_op("float + int", Variant::OP_ADD, 0.5, 1) && pass;
+	pass = _benchmark_op("Vector2 + Vector2", Variant::OP_ADD, Vector2(), Vector2(0.5, 0.25)) && pass;
+	pass = _benchmark_op("Vector3 * float", Variant::OP_MULTIPLY, Vector3(1, 2, 3), 1.0000001) && pass;
+	pass = _benchmark_op("-Vector2", Variant::OP_NEGATE, Vector2(1, 2), Variant()) && pass;
+
+	// Loop condition: the result type differs from the operands, so write elsewhere.
+	Variant index = 5;
+	Variant limit = 1000;
+	Variant::ValidatedOperatorEvaluator less = Variant::get_validated_operator_evaluator(Variant::OP_LESS, Variant::INT, Variant::INT);
+
+	Variant cmp_evaluate;
+	bool valid = true;
+	uint64_t t = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		Variant::evaluate(Variant::OP_LESS, index, limit, cmp_evaluate, valid);
+	}
+	uint64_t evaluate_usec = OS::get_singleton()->get_ticks_usec() - t;
+
+	Variant cmp_validated;
+	t = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		less(&index, &limit, &cmp_validated);
+	}
+	uint64_t validated_usec = OS::get_singleton()->get_ticks_usec() - t;
+
+	_print_timing("int < int", evaluate_usec, validated_usec);
+	pass = valid && _same_result(cmp_evaluate, cmp_validated) && pass;
+
+	return pass;
+}
+
+struct MethodSample {
+	Variant self;
+	const char *method;
+	Vector<Variant> args;
+};
+
+static Vector<MethodSample> _make_method_samples() {
+
+	Vector3 v(1.5, -2.0, 3.25);
+	Vector3 w(-0.5, 4.0, 1.0);
+	Basis b(Vector3(0, 1, 0), 0.5);
+	Transform t(b, Vector3(1, 2, 3));
+
+	Vector<MethodSample> samples;
+	samples.push_back({ v, "dot", varray(w) });
+	samples.push_back({ v, "cross", varray(w) });
+	samples.push_back({ v, "normalized", varray() });
+	samples.push_back({ v, "length", varray() });
+	samples.push_back({ v, "max_axis", varray() });
+	samples.push_back({ v, "is_normalized", varray() });
+	samples.push_back({ v, "rotated", varray(Vector3(0, 0, 1), 0.25) });
+	samples.push_back({ v, "linear_interpolate", varray(w, 0.3) });
+	samples.push_back({ v, "snapped", varray(Vector3(0.5, 0.5, 0.5)) });
+	samples.push_back({ v, "distance_to", varray(w) });
+	samples.push_back({ v, "outer", varray(w) });
+	samples.push_back({ b, "xform", varray(v) });
+	samples.push_back({ b, "inverse", varray() });
+	samples.push_back({ b, "scaled", varray(w) });
+	samples.push_back({ b, "determinant", varray() });
+	samples.push_back({ b, "get_euler", varray() });
+	samples.push_back({ b, "get_rotation_quat", varray() });
+	samples.push_back({ t, "rotated", varray(Vector3(1, 0, 0), 0.75) });
+	samples.push_back({ t, "translated", varray(w) });
+	samples.push_back({ t, "affine_inverse", varray() });
+	samples.push_back({ t, "looking_at", varray(w, Vector3(0, 1, 0)) });
+	samples.push_back({ t, "interpolate_with", varray(Transform(), 0.5) });
+	samples.push_back({ Quat(b), "slerp", varray(Quat(), 0.5) });
+	samples.push_back({ Color(0.25, 0.5, 0.75), "inverted", varray() });
+	samples.push_back({ Rect2(1, 2, 3, 4), "has_point", varray(Vector2(2, 3)) });
+	samples.push_back({ Plane(Vector3(0, 1, 0), 2), "distance_to", varray(v) });
+	samples.push_back({ AABB(v, w.abs()), "get_longest_axis", varray() });
+	samples.push_back({ Transform2D(0.5, Vector2(1, 2)), "rotated", varray(0.25) });
+	return samples;
+}
+
+bool test_validated_builtin_methods() {
+
+	OS::get_singleton()->print("\n\nTest 3: Validated builtin methods match Variant::call\n");
+
+	Vector<MethodSample> samples = _make_method_samples();
+	bool pass = true;
+
+	for (int i = 0; i < samples.size(); i++) {
+
+		const MethodSample &sample = samples[i];
+		Variant::Type type = sample.self.get_type();
+		String name = Variant::get_type_name(type) + "." + sample.method;
+
+		const Variant *argp[VARIANT_ARG_MAX];
+		for (int j = 0; j < sample.args.size(); j++) {
+			argp[j] = &sample.args[j];
+		}
+
+		Variant::ValidatedBuiltInMethod validated = Variant::get_validated_builtin_method(type, sample.method);
+		if (!validated) {
+			OS::get_singleton()->print("\tFAIL: %s has no validated version\n", name.utf8().get_data());
+			pass = false;
+			continue;
+		}
+
+		Variant self = sample.self;
+		Callable::CallError ce;
+		Variant expected = self.call(sample.method, argp, sample.args.size(), ce);
+
+		// Start from a different type, the result must replace it.
+		Variant result = "previous";
+		Variant validated_self = sample.self;
+		validated(result, validated_self, argp);
+
+		if (ce.error != Callable::CallError::CALL_OK || !_same_result(expected, result) || !_same_result(self, validated_self)) {
+			OS::get_singleton()->print("\tFAIL: %s returned %s, expected %s\n", name.utf8().get_data(), String(result).utf8().get_data(), String(expected).utf8().get_data());
+			pass = false;
+		}
+	}
+
+	OS::get_singleton()->print("\tChecked %i methods\n", samples.size());
+
+#ifdef PTRCALL_ENABLED
+	// Raw values, encoded as for MethodBind::ptrcall().
+	Vector3 v(1.5, -2.0, 3.25);
+	Vector3 w(-0.5, 4.0, 1.0);
+	Transform t(Basis(Vector3(0, 1, 0), 0.5), Vector3(1, 2, 3));
+
+	Variant::PTRBuiltInMethod cross = Variant::get_ptr_builtin_method(Variant::VECTOR3, "cross");
+	Variant::PTRBuiltInMethod dot = Variant::get_ptr_builtin_method(Variant::VECTOR3, "dot");
+	Variant::PTRBuiltInMethod rotated = Variant::get_ptr_builtin_method(Variant::TRANSFORM, "rotated");
+	if (!cross || !dot || !rotated) {
+		OS::get_singleton()->print("\tFAIL: missing ptrcall versions\n");
+		return false;
+	}
+
+	const void *cross_args[] = { &w };
+	Vector3 cross_ret;
+	cross(&v, cross_args, &cross_ret);
+
+	double dot_ret = 0;
+	dot(&v, cross_args, &dot_ret);
+
+	Vector3 axis(1, 0, 0);
+	double angle = 0.75;
+	const void *rotated_args[] = { &axis, &angle };
+	Transform rotated_ret;
+	rotated(&t, rotated_args, &rotated_ret);
+
+	if (cross_ret != v.cross(w) || dot_ret != double(v.dot(w)) || rotated_ret != t.rotated(axis, angle)) {
+		OS::get_singleton()->print("\tFAIL: ptrcall results differ\n");
+		pass = false;
+	}
+#endif
+
+	return pass;
+}
+
+static bool _benchmark_method(const char *p_name, const Variant &p_self, const StringName &p_method, const Vector<Variant> &p_args) {
+
+	const Variant *argp[VARIANT_ARG_MAX];
+	for (int i = 0; i < p_args.size(); i++) {
+		argp[i] = &p_args[i];
+	}
+
+	Variant self = p_self;
+	Variant ret_call;
+	Callable::CallError ce;
+	uint64_t t = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		ret_call = self.call(p_method, argp, p_args.size(), ce);
+	}
+	uint64_t call_usec = OS::get_singleton()->get_ticks_usec() - t;
+
+	// Resolved once, as a script compiler would.
+	Variant::ValidatedBuiltInMethod validated = Variant::get_validated_builtin_method(p_self.get_type(), p_method);
+	Variant ret_validated;
+	t = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		validated(ret_validated, self, argp);
+	}
+	uint64_t validated_usec = OS::get_singleton()->get_ticks_usec() - t;
+
+	OS::get_singleton()->print("\t%-22s call %6d msec, validated %6d msec, %.2fx\n", p_name, int(call_usec / 1000), int(validated_usec / 1000), double(call_usec) / MAX(validated_usec, 1));
+
+	return ce.error == Callable::CallError::CALL_OK && _same_result(ret_call, ret_validated);
+}
+
+bool test_benchmark_methods() {
+
+	OS::get_singleton()->print("\n\nTest 4: Benchmark builtin method calls, %d iterations\n", BENCHMARK_ITERATIONS);
+
+	Vector3 v(1.5, -2.0, 3.25);
+	Vector3 w(-0.5, 4.0, 1.0);
+	Basis b(Vector3(0, 1, 0), 0.5);
+	Transform t(b, Vector3(1, 2, 3));
+
+	bool pass = true;
+	pass = _benchmark_method("Vector3.dot", v, "dot", varray(w)) && pass;
+	pass = _benchmark_method("Vector3.cross", v, "cross", varray(w)) && pass;
+	pass = _benchmark_method("Vector3.normalized", v, "normalized", varray()) && pass;
+	pass = _benchmark_method("Basis.xform", b, "xform", varray(v)) && pass;
+	pass = _benchmark_method("Transform.rotated", t, "rotated", varray(Vector3(1, 0, 0), 0.75)) && pass;
+
+#ifdef PTRCALL_ENABLED
+	Variant::PTRBuiltInMethod cross = Variant::get_ptr_builtin_method(Variant::VECTOR3, "cross");
+	const void *args[] = { &w };
+	Vector3 ret;
+	uint64_t t0 = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		cross(&v, args, &ret);
+	}
+	OS::get_singleton()->print("\t%-22s ptrcall %6d msec\n", "Vector3.cross", int((OS::get_singleton()->get_ticks_usec() - t0) / 1000));
+	pass = ret == v.cross(w) && pass;
+#endif
+
+	return pass;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_validated_operators,
+	test_benchmark,
+	test_validated_builtin_methods,
+	test_benchmark_methods,
+	nullptr
+
+};
+
+MainLoop *test() {
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count])
+			break;
+		bool pass = test_funcs[count]();
+		if (pass)
+			passed++;
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestVariant
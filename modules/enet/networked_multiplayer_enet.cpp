@@ -685,6 +685,26 @@ NetworkedMultiplayerENet::CompressionMode NetworkedMultiplayerENet::get_compress
 	return compression_mode;
 }
 
+void NetworkedMultiplayerENet::set_compression_dictionary(const Vector<uint8_t> &p_dictionary) {
+	ERR_FAIL_COND_MSG(active, "The compression dictionary can't be changed while the connection is active.");
+
+	uint32_t id = 0;
+	if (p_dictionary.size()) {
+		id = Compression::register_dictionary(p_dictionary);
+		ERR_FAIL_COND_MSG(id == 0, "Couldn't register the compression dictionary.");
+	}
+	if (compression_dictionary_id) {
+		Compression::unregister_dictionary(compression_dictionary_id);
+	}
+	compression_dictionary = p_dictionary;
+	compression_dictionary_id = id;
+}
+
+Vector<uint8_t> NetworkedMultiplayerENet::get_compression_dictionary() const {
+
+	return compression_dictionary;
+}
+
 size_t NetworkedMultiplayerENet::enet_compress(void *context, const ENetBuffer *inBuffers, size_t inBufferCount, size_t inLimit, enet_uint8 *outData, size_t outLimit) {
 
 	NetworkedMultiplayerENet *enet = (NetworkedMultiplayerENet *)(context);
@@ -725,7 +745,8 @@ size_t NetworkedMultiplayerENet::enet_compress(void *context, const ENetBuffer *
 	if (enet->dst_compressor_mem.size() < req_size) {
 		enet->dst_compressor_mem.resize(req_size);
 	}
-	int ret = Compression::compress(enet->dst_compressor_mem.ptrw(), enet->src_compressor_mem.ptr(), ofs, mode);
+	uint32_t dictionary = mode == Compression::MODE_ZSTD ? enet->compression_dictionary_id : 0;
+	int ret = Compression::compress(enet->dst_compressor_mem.ptrw(), enet->src_compressor_mem.ptr(), ofs, mode, dictionary);
 
 	if (ret < 0)
 		return 0;
@@ -753,7 +774,7 @@ size_t NetworkedMultiplayerENet::enet_decompress(void *context, const enet_uint8
 		} break;
 		case COMPRESS_ZSTD: {
 
-			ret = Compression::decompress(outData, outLimit, inData, inLimit, Compression::MODE_ZSTD);
+			ret = Compression::decompress(outData, outLimit, inData, inLimit, Compression::MODE_ZSTD, enet->compression_dictionary_id);
 		} break;
 		default: {
 		}
@@ -866,6 +887,8 @@ void NetworkedMultiplayerENet::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("disconnect_peer", "id", "now"), &NetworkedMultiplayerENet::disconnect_peer, DEFVAL(false));
 	ClassDB::bind_method(D_METHOD("set_compression_mode", "mode"), &NetworkedMultiplayerENet::set_compression_mode);
 	ClassDB::bind_method(D_METHOD("get_compression_mode"), &NetworkedMultiplayerENet::get_compression_mode);
+	ClassDB::bind_method(D_METHOD("set_compression_dictionary", "dictionary"), &NetworkedMultiplayerENet::set_compression_dictionary);
+	ClassDB::bind_method(D_METHOD("get_compression_dictionary"), &NetworkedMultiplayerENet::get_compression_dictionary);
 	ClassDB::bind_method(D_METHOD("set_bind_ip", "ip"), &NetworkedMultiplayerENet::set_bind_ip);
 	ClassDB::bind_method(D_METHOD("set_dtls_enabled", "enabled"), &NetworkedMultiplayerENet::set_dtls_enabled);
 	ClassDB::bind_method(D_METHOD("is_dtls_enabled"), &NetworkedMultiplayerENet::is_dtls_enabled);
@@ -888,6 +911,7 @@ void NetworkedMultiplayerENet::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("is_server_relay_enabled"), &NetworkedMultiplayerENet::is_server_relay_enabled);
 
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "compression_mode", PROPERTY_HINT_ENUM, "None,Range Coder,FastLZ,ZLib,ZStd"), "set_compression_mode", "get_compression_mode");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_BYTE_ARRAY, "compression_dictionary"), "set_compression_dictionary", "get_compression_dictionary");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "transfer_channel"), "set_transfer_channel", "get_transfer_channel");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "channel_count"), "set_channel_count", "get_channel_count");
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "always_ordered"), "set_always_ordered", "is_always_ordered");
@@ -917,6 +941,7 @@ NetworkedMultiplayerENet::NetworkedMultiplayerENet() {
 	always_ordered = false;
 	connection_status = CONNECTION_DISCONNECTED;
 	compression_mode = COMPRESS_NONE;
+	compression_dictionary_id = 0;
 	enet_compressor.context = this;
 	enet_compressor.compress = enet_compress;
 	enet_compressor.decompress = enet_decompress;
@@ -933,6 +958,9 @@ NetworkedMultiplayerENet::~NetworkedMultiplayerENet() {
 	if (active) {
 		close_connection();
 	}
+	if (compression_dictionary_id) {
+		Compression::unregister_dictionary(compression_dictionary_id);
+	}
 }
 
 // Sets IP for ENet to bind when using create_server or create_client
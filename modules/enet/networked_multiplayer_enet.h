@@ -93,6 +93,8 @@ private:
 	};
 
 	CompressionMode compression_mode;
+	Vector<uint8_t> compression_dictionary;
+	uint32_t compression_dictionary_id;
 
 	List<Packet> incoming_packets;
 
@@ -157,6 +159,9 @@ public:
 	void set_compression_mode(CompressionMode p_mode);
 	CompressionMode get_compression_mode() const;
 
+	void set_compression_dictionary(const Vector<uint8_t> &p_dictionary);
+	Vector<uint8_t> get_compression_dictionary() const;
+
 	int get_packet_channel() const;
 	int get_last_packet_channel() const;
 	void set_transfer_channel(int p_channel);
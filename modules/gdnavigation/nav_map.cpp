@@ -30,7 +30,7 @@
 
 #include "nav_map.h"
 
-#include "core/os/threaded_array_processor.h"
+#include "core/job_system.h"
 #include "nav_region.h"
 #include "rvo_agent.h"
 #include <algorithm>
@@ -759,7 +759,7 @@ void NavMap::compute_single_step(uint32_t index, RvoAgent **agent) {
 void NavMap::step(real_t p_deltatime) {
 	deltatime = p_deltatime;
 	if (controlled_agents.size() > 0) {
-		thread_process_array(
+		JobSystem::get_singleton()->do_work(
 				controlled_agents.size(),
 				this,
 				&NavMap::compute_single_step,
@@ -39,7 +39,9 @@
 #include "core/os/file_access.h"
 #include "core/os/os.h"
 #include "core/project_settings.h"
+#include "gdscript_compiled_buffer.h"
 #include "gdscript_compiler.h"
+#include "gdscript_sampling_profiler.h"
 
 ///////////////////////////
 
@@ -814,19 +816,35 @@ Error GDScript::load_byte_code(const String &p_path) {
 		basedir = basedir.get_base_dir();
 
 	valid = false;
-	GDScriptParser parser;
-	Error err = parser.parse_bytecode(bytecode, basedir, get_path());
-	if (err) {
-		_err_print_error("GDScript::load_byte_code", path.empty() ? "built-in" : (const char *)path.utf8().get_data(), parser.get_error_line(), ("Parse Error: " + parser.get_error()).utf8().get_data(), ERR_HANDLER_SCRIPT);
-		ERR_FAIL_V(ERR_PARSE_ERROR);
+
+	// Compiled code is used as is, the tokens are only parsed when it no
+	// longer matches the engine.
+	if (GDScriptCompiledBuffer::is_compiled_buffer(bytecode)) {
+		GDScriptCompiledBuffer compiled;
+		if (compiled.load_script(this, bytecode) == OK) {
+			valid = true;
+		} else {
+			print_verbose("GDScript: Can't use the compiled code of '" + p_path + "', compiling it again: " + compiled.get_error());
+			bytecode = GDScriptCompiledBuffer::get_token_buffer(bytecode);
+			ERR_FAIL_COND_V(bytecode.size() == 0, ERR_PARSE_ERROR);
+		}
 	}
 
-	GDScriptCompiler compiler;
-	err = compiler.compile(&parser, this);
+	if (!valid) {
+		GDScriptParser parser;
+		Error err = parser.parse_bytecode(bytecode, basedir, get_path());
+		if (err) {
+			_err_print_error("GDScript::load_byte_code", path.empty() ? "built-in" : (const char *)path.utf8().get_data(), parser.get_error_line(), ("Parse Error: " + parser.get_error()).utf8().get_data(), ERR_HANDLER_SCRIPT);
+			ERR_FAIL_V(ERR_PARSE_ERROR);
+		}
 
-	if (err) {
-		_err_print_error("GDScript::load_byte_code", path.empty() ? "built-in" : (const char *)path.utf8().get_data(), compiler.get_error_line(), ("Compile Error: " + compiler.get_error()).utf8().get_data(), ERR_HANDLER_SCRIPT);
-		ERR_FAIL_V(ERR_COMPILATION_FAILED);
+		GDScriptCompiler compiler;
+		err = compiler.compile(&parser, this);
+
+		if (err) {
+			_err_print_error("GDScript::load_byte_code", path.empty() ? "built-in" : (const char *)path.utf8().get_data(), compiler.get_error_line(), ("Compile Error: " + compiler.get_error()).utf8().get_data(), ERR_HANDLER_SCRIPT);
+			ERR_FAIL_V(ERR_COMPILATION_FAILED);
+		}
 	}
 
 	valid = true;
@@ -1556,6 +1574,14 @@ void GDScriptLanguage::init() {
 
 		_add_global(E->get().name, E->get().ptr);
 	}
+
+#ifdef DEBUG_ENABLED
+	// --profile-scripts enables it without touching the project settings.
+	bool profile = GLOBAL_GET("debug/gdscript/sampling_profiler/enabled") || Engine::get_singleton()->get_script_profile_path() != String();
+	if (profile && !Engine::get_singleton()->is_editor_hint()) {
+		GDScriptSamplingProfiler::start(GLOBAL_GET("debug/gdscript/sampling_profiler/interval_usec"));
+	}
+#endif
 }
 
 String GDScriptLanguage::get_type() const {
@@ -1572,6 +1598,23 @@ Error GDScriptLanguage::execute_file(const String &p_path) {
 	return OK;
 }
 void GDScriptLanguage::finish() {
+
+#ifdef DEBUG_ENABLED
+	if (GDScriptSamplingProfiler::is_running()) {
+		GDScriptSamplingProfiler::stop();
+
+		String path = Engine::get_singleton()->get_script_profile_path();
+		if (path == String()) {
+			path = GLOBAL_GET("debug/gdscript/sampling_profiler/output_path");
+		}
+		if (GDScriptSamplingProfiler::save(path) == OK) {
+			print_line("GDScript profile with " + itos(GDScriptSamplingProfiler::get_sample_count()) + " samples saved to: " + ProjectSettings::get_singleton()->globalize_path(path));
+		}
+	}
+	GDScriptSamplingProfiler::finish();
+#endif
+
+	GDScriptFramePool::clear();
 }
 
 void GDScriptLanguage::profiling_start() {
@@ -2241,6 +2284,10 @@ GDScriptLanguage::GDScriptLanguage() {
 	GLOBAL_DEF("debug/gdscript/warnings/treat_warnings_as_errors", false);
 	GLOBAL_DEF("debug/gdscript/warnings/exclude_addons", true);
 	GLOBAL_DEF("debug/gdscript/completion/autocomplete_setters_and_getters", false);
+	GLOBAL_DEF("debug/gdscript/sampling_profiler/enabled", false);
+	GLOBAL_DEF("debug/gdscript/sampling_profiler/interval_usec", 1000);
+	ProjectSettings::get_singleton()->set_custom_property_info("debug/gdscript/sampling_profiler/interval_usec", PropertyInfo(Variant::INT, "debug/gdscript/sampling_profiler/interval_usec", PROPERTY_HINT_RANGE, "50,100000,1,or_greater"));
+	GLOBAL_DEF("debug/gdscript/sampling_profiler/output_path", "user://gdscript_profile.folded");
 	for (int i = 0; i < (int)GDScriptWarning::WARNING_MAX; i++) {
 		String warning = GDScriptWarning::get_name_from_code((GDScriptWarning::Code)i).to_lower();
 		bool default_enabled = !warning.begins_with("unsafe_") && i != GDScriptWarning::UNUSED_CLASS_VARIABLE;
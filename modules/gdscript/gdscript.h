@@ -72,6 +72,7 @@ class GDScript : public Script {
 	friend class GDScriptInstance;
 	friend class GDScriptFunction;
 	friend class GDScriptCompiler;
+	friend class GDScriptCompiledBuffer;
 	friend class GDScriptFunctions;
 	friend class GDScriptLanguage;
 
@@ -0,0 +1,1219 @@
+/*************************************************************************/
+/*  gdscript_compiled_buffer.cpp                                         */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "gdscript_compiled_buffer.h"
+
+#include "core/io/marshalls.h"
+#include "core/io/resource_loader.h"
+#include "core/version.h"
+#include "gdscript_compiler.h"
+#include "gdscript_functions.h"
+#include "gdscript_tokenizer.h"
+
+// Bump when the layout of the buffer changes. Changes in the instruction set
+// are caught by the layout check below.
+#define COMPILED_VERSION 2
+
+static const uint32_t compiled_layout[] = {
+	GDScriptFunction::OPCODE_END,
+	GDScriptFunction::ADDR_TYPE_MAX,
+	Variant::VARIANT_MAX,
+	Variant::OP_MAX,
+	GDScriptFunctions::FUNC_MAX,
+};
+
+#define COMPILED_LAYOUT_SIZE (sizeof(compiled_layout) / sizeof(compiled_layout[0]))
+
+#define GET_U32(m_value)             \
+	if (!_get_u32(m_value)) {        \
+		return false;                \
+	}
+
+#define GET_NAME(m_name)             \
+	if (!_get_name(m_name)) {        \
+		return false;                \
+	}
+
+static void _encode_u32(Vector<uint8_t> &r_buffer, uint32_t p_value) {
+
+	int pos = r_buffer.size();
+	r_buffer.resize(pos + 4);
+	encode_uint32(p_value, &r_buffer.write[pos]);
+}
+
+static void _encode_string(Vector<uint8_t> &r_buffer, const String &p_string) {
+
+	CharString cs = p_string.utf8();
+	_encode_u32(r_buffer, cs.length());
+	if (cs.length()) {
+		int pos = r_buffer.size();
+		r_buffer.resize(pos + cs.length());
+		copymem(&r_buffer.write[pos], cs.get_data(), cs.length());
+	}
+}
+
+static bool _decode_string(const uint8_t *p_buffer, int p_len, int &r_pos, String &r_string) {
+
+	if (r_pos + 4 > p_len) {
+		return false;
+	}
+	uint32_t len = decode_uint32(&p_buffer[r_pos]);
+	r_pos += 4;
+	if (len > uint32_t(p_len - r_pos)) {
+		return false;
+	}
+	r_string.parse_utf8((const char *)&p_buffer[r_pos], len);
+	r_pos += len;
+	return true;
+}
+
+/* SAVING */
+
+void GDScriptCompiledBuffer::_put_u32(uint32_t p_value) {
+
+	_encode_u32(data, p_value);
+}
+
+void GDScriptCompiledBuffer::_put_name(const StringName &p_name) {
+
+	Map<StringName, int>::Element *E = name_map.find(p_name);
+	if (!E) {
+		E = name_map.insert(p_name, name_map.size());
+	}
+	_put_u32(E->get());
+}
+
+bool GDScriptCompiledBuffer::_put_variant(const Variant &p_variant) {
+
+	switch (p_variant.get_type()) {
+		case Variant::OBJECT: {
+			Object *obj = p_variant.get_validated_object();
+			if (!obj) {
+				_put_u32(VARIANT_NULL_OBJECT);
+				return true;
+			}
+
+			GDScriptNativeClass *native = Object::cast_to<GDScriptNativeClass>(obj);
+			if (native) {
+				_put_u32(VARIANT_NATIVE_CLASS);
+				_put_name(native->get_name());
+				return true;
+			}
+
+			Script *script = Object::cast_to<Script>(obj);
+			if (script) {
+				_put_u32(VARIANT_SCRIPT);
+				return _put_script(Ref<Script>(script));
+			}
+
+			Resource *resource = Object::cast_to<Resource>(obj);
+			if (resource && resource->get_path() != String() && resource->get_path().find("::") == -1) {
+				_put_u32(VARIANT_RESOURCE);
+				_put_name(resource->get_path());
+				return true;
+			}
+
+			error = "Constant of class '" + obj->get_class() + "' can't be saved, only native classes, scripts and resources loaded from a file are supported.";
+			return false;
+		} break;
+		case Variant::ARRAY: {
+			Array array = p_variant;
+			_put_u32(VARIANT_ARRAY);
+			_put_u32(array.size());
+			for (int i = 0; i < array.size(); i++) {
+				if (!_put_variant(array[i])) {
+					return false;
+				}
+			}
+			return true;
+		} break;
+		case Variant::DICTIONARY: {
+			Dictionary dict = p_variant;
+			List<Variant> keys;
+			dict.get_key_list(&keys);
+			_put_u32(VARIANT_DICTIONARY);
+			_put_u32(keys.size());
+			for (List<Variant>::Element *E = keys.front(); E; E = E->next()) {
+				if (!_put_variant(E->get()) || !_put_variant(dict[E->get()])) {
+					return false;
+				}
+			}
+			return true;
+		} break;
+		default: {
+			int len;
+			Error err = encode_variant(p_variant, nullptr, len, false);
+			if (err != OK) {
+				error = "Constant of type '" + Variant::get_type_name(p_variant.get_type()) + "' can't be saved.";
+				return false;
+			}
+			_put_u32(VARIANT_VALUE);
+			_put_u32(len);
+			int pos = data.size();
+			data.resize(pos + len);
+			encode_variant(p_variant, &data.write[pos], len, false);
+			return true;
+		}
+	}
+}
+
+const GDScript *GDScriptCompiledBuffer::_get_subclass_path(const GDScript *p_class, Vector<StringName> &r_path) {
+
+	const GDScript *top = p_class;
+	while (top->_owner) {
+		const GDScript *owner = top->_owner;
+		const StringName *name = nullptr;
+		for (const Map<StringName, Ref<GDScript>>::Element *E = owner->subclasses.front(); E; E = E->next()) {
+			if (E->get().ptr() == top) {
+				name = &E->key();
+				break;
+			}
+		}
+		if (!name) {
+			return nullptr;
+		}
+		r_path.insert(0, *name);
+		top = owner;
+	}
+	return top;
+}
+
+bool GDScriptCompiledBuffer::_put_script(const Ref<Script> &p_script) {
+
+	if (p_script.is_null()) {
+		_put_u32(SCRIPT_NONE);
+		return true;
+	}
+
+	Vector<StringName> subclass_path;
+	String path = p_script->get_path();
+
+	const GDScript *gdscript = Object::cast_to<GDScript>(p_script.ptr());
+	if (gdscript) {
+		const GDScript *top = _get_subclass_path(gdscript, subclass_path);
+		if (!top) {
+			error = "Reference to a class that is no longer part of its script.";
+			return false;
+		}
+		path = top->get_path();
+
+		// The script being saved can also be reached through its path, as with
+		// its class name or a preload of itself.
+		if (top == root || (path != String() && path == root->path)) {
+			_put_u32(SCRIPT_LOCAL);
+			_put_u32(subclass_path.size());
+			for (int i = 0; i < subclass_path.size(); i++) {
+				_put_name(subclass_path[i]);
+			}
+			return true;
+		}
+	}
+
+	if (path == String() || path.find("::") != -1) {
+		error = "Reference to a built-in script, only scripts loaded from a file are supported.";
+		return false;
+	}
+
+	_put_u32(SCRIPT_EXTERNAL);
+	_put_name(path);
+	_put_u32(subclass_path.size());
+	for (int i = 0; i < subclass_path.size(); i++) {
+		_put_name(subclass_path[i]);
+	}
+	return true;
+}
+
+bool GDScriptCompiledBuffer::_put_data_type(const GDScriptDataType &p_type) {
+
+	_put_u32(p_type.has_type);
+	if (!p_type.has_type) {
+		return true;
+	}
+	_put_u32(p_type.kind);
+	_put_u32(p_type.builtin_type);
+	_put_name(p_type.native_type);
+	return _put_script(p_type.script_type);
+}
+
+bool GDScriptCompiledBuffer::_put_function(const GDScriptFunction *p_function) {
+
+	_put_name(p_function->name);
+	_put_u32(p_function->_static);
+	_put_u32(p_function->_has_yield);
+	_put_u32(p_function->rpc_mode);
+	_put_u32(p_function->_argument_count);
+
+#ifdef TOOLS_ENABLED
+	_put_u32(p_function->arg_names.size());
+	for (int i = 0; i < p_function->arg_names.size(); i++) {
+		_put_name(p_function->arg_names[i]);
+	}
+#else
+	_put_u32(0);
+#endif
+
+	_put_u32(p_function->argument_types.size());
+	for (int i = 0; i < p_function->argument_types.size(); i++) {
+		if (!_put_data_type(p_function->argument_types[i])) {
+			return false;
+		}
+	}
+	if (!_put_data_type(p_function->return_type)) {
+		return false;
+	}
+
+	_put_u32(p_function->default_arguments.size());
+	for (int i = 0; i < p_function->default_arguments.size(); i++) {
+		_put_u32(p_function->default_arguments[i]);
+	}
+
+	_put_u32(p_function->code.size());
+	for (int i = 0; i < p_function->code.size(); i++) {
+		_put_u32(p_function->code[i]);
+	}
+
+	_put_u32(p_function->constants.size());
+	for (int i = 0; i < p_function->constants.size(); i++) {
+		if (!_put_variant(p_function->constants[i])) {
+			error = "In function '" + String(p_function->name) + "': " + error;
+			return false;
+		}
+	}
+
+	_put_u32(p_function->global_names.size());
+	for (int i = 0; i < p_function->global_names.size(); i++) {
+		_put_name(p_function->global_names[i]);
+	}
+
+	_put_u32(p_function->global_variable_names.size());
+	for (int i = 0; i < p_function->global_variable_names.size(); i++) {
+		_put_name(p_function->global_variable_names[i]);
+	}
+
+	_put_u32(p_function->validated_operators.size());
+	for (int i = 0; i < p_function->validated_operators.size(); i++) {
+		const GDScriptFunction::ValidatedOperator &vop = p_function->validated_operators[i];
+		_put_u32(vop.op);
+		_put_u32(vop.type_a);
+		_put_u32(vop.type_b);
+	}
+
+	_put_u32(p_function->validated_builtin_methods.size());
+	for (int i = 0; i < p_function->validated_builtin_methods.size(); i++) {
+		const GDScriptFunction::ValidatedBuiltinMethod &vbm = p_function->validated_builtin_methods[i];
+		_put_u32(vbm.base_type);
+		_put_name(vbm.name);
+	}
+
+	_put_u32(p_function->method_bind_calls.size());
+	for (int i = 0; i < p_function->method_bind_calls.size(); i++) {
+		const GDScriptFunction::MethodBindCall &mbc = p_function->method_bind_calls[i];
+		_put_name(mbc.method->get_instance_class());
+		_put_name(mbc.name);
+		// Only debug builds know the argument types, keeping them lets release
+		// builds use ptrcalls as well.
+#ifdef PTRCALL_ENABLED
+		_put_u32(mbc.ptrcall);
+		_put_u32(mbc.argument_types.size());
+		for (int j = 0; j < mbc.argument_types.size(); j++) {
+			_put_u32(mbc.argument_types[j]);
+		}
+		_put_u32(mbc.return_type);
+#else
+		_put_u32(false);
+		_put_u32(0);
+		_put_u32(Variant::NIL);
+#endif
+	}
+
+	_put_u32(p_function->_stack_size);
+	_put_u32(p_function->_call_size);
+	_put_u32(p_function->_initial_line);
+
+	_put_u32(p_function->stack_debug.size());
+	for (const List<GDScriptFunction::StackDebug>::Element *E = p_function->stack_debug.front(); E; E = E->next()) {
+		_put_u32(E->get().line);
+		_put_u32(E->get().pos);
+		_put_u32(E->get().added);
+		_put_name(E->get().identifier);
+	}
+
+	return true;
+}
+
+void GDScriptCompiledBuffer::_put_class_tree(const GDScript *p_class) {
+
+	_put_u32(p_class->subclasses.size());
+	for (const Map<StringName, Ref<GDScript>>::Element *E = p_class->subclasses.front(); E; E = E->next()) {
+		_put_name(E->key());
+		_put_class_tree(E->get().ptr());
+	}
+}
+
+bool GDScriptCompiledBuffer::_put_class(const GDScript *p_class) {
+
+	if (saved_classes.has(p_class)) {
+		return true;
+	}
+	saved_classes.insert(p_class);
+
+	Vector<StringName> subclass_path;
+	_get_subclass_path(p_class, subclass_path);
+
+	// Classes extending another class of the same script are saved after it,
+	// they need its members when loading.
+	if (p_class->_base) {
+		Vector<StringName> base_path;
+		const GDScript *top = _get_subclass_path(p_class->_base, base_path);
+		if (top && (top == root || (top->get_path() != String() && top->get_path() == root->path))) {
+			const GDScript *base = root;
+			for (int i = 0; base && i < base_path.size(); i++) {
+				const Map<StringName, Ref<GDScript>>::Element *E = base->subclasses.find(base_path[i]);
+				base = E ? E->get().ptr() : nullptr;
+			}
+			if (base && !_put_class(base)) {
+				return false;
+			}
+		}
+	}
+
+	_put_u32(subclass_path.size());
+	for (int i = 0; i < subclass_path.size(); i++) {
+		_put_name(subclass_path[i]);
+	}
+
+	_put_u32(p_class->tool);
+	_put_name(p_class->name);
+
+	if (p_class->base.is_valid()) {
+		_put_u32(true);
+		if (!_put_script(p_class->base)) {
+			return false;
+		}
+	} else {
+		ERR_FAIL_COND_V(p_class->native.is_null(), false);
+		_put_u32(false);
+		_put_name(p_class->native->get_name());
+	}
+
+	_put_u32(p_class->member_indices.size() - p_class->members.size());
+	_put_u32(p_class->members.size());
+	for (const Set<StringName>::Element *E = p_class->members.front(); E; E = E->next()) {
+		const GDScript::MemberInfo &minfo = p_class->member_indices[E->get()];
+		const PropertyInfo &pinfo = p_class->member_info[E->get()];
+
+		_put_name(E->get());
+		_put_u32(minfo.index);
+		_put_name(minfo.setter);
+		_put_name(minfo.getter);
+		_put_u32(minfo.rpc_mode);
+		if (!_put_data_type(minfo.data_type)) {
+			return false;
+		}
+		_put_u32(pinfo.type);
+		_put_name(pinfo.class_name);
+		_put_u32(pinfo.hint);
+		_put_name(pinfo.hint_string);
+		_put_u32(pinfo.usage);
+	}
+
+	_put_u32(p_class->constants.size());
+	for (const Map<StringName, Variant>::Element *E = p_class->constants.front(); E; E = E->next()) {
+		_put_name(E->key());
+		if (!_put_variant(E->get())) {
+			error = "In constant '" + String(E->key()) + "': " + error;
+			return false;
+		}
+	}
+
+	_put_u32(p_class->_signals.size());
+	for (const Map<StringName, Vector<StringName>>::Element *E = p_class->_signals.front(); E; E = E->next()) {
+		_put_name(E->key());
+		_put_u32(E->get().size());
+		for (int i = 0; i < E->get().size(); i++) {
+			_put_name(E->get()[i]);
+		}
+	}
+
+	_put_u32(p_class->member_functions.size());
+	for (const Map<StringName, GDScriptFunction *>::Element *E = p_class->member_functions.front(); E; E = E->next()) {
+		if (!_put_function(E->get())) {
+			return false;
+		}
+	}
+
+	for (const Map<StringName, Ref<GDScript>>::Element *E = p_class->subclasses.front(); E; E = E->next()) {
+		if (!_put_class(E->get().ptr())) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Error GDScriptCompiledBuffer::save_script(const GDScript *p_script, const Vector<uint8_t> &p_token_buffer, Vector<uint8_t> &r_buffer) {
+
+	ERR_FAIL_COND_V(!p_script->valid, ERR_INVALID_PARAMETER);
+
+	root = p_script;
+	data.clear();
+	name_map.clear();
+	saved_classes.clear();
+	error = String();
+
+	_put_class_tree(p_script);
+	if (!_put_class(p_script)) {
+		return ERR_INVALID_DATA;
+	}
+
+	Vector<uint8_t> body = data;
+	data.clear();
+
+	data.push_back('G');
+	data.push_back('D');
+	data.push_back('C');
+	data.push_back('F');
+	_put_u32(COMPILED_VERSION);
+
+	// Tokens go first, so they can be read back whatever the rest looks like.
+	_put_u32(p_token_buffer.size());
+	data.append_array(p_token_buffer);
+
+	for (uint32_t i = 0; i < COMPILED_LAYOUT_SIZE; i++) {
+		_put_u32(compiled_layout[i]);
+	}
+	_encode_string(data, VERSION_FULL_CONFIG);
+
+	Vector<StringName> rev_name_map;
+	rev_name_map.resize(name_map.size());
+	for (Map<StringName, int>::Element *E = name_map.front(); E; E = E->next()) {
+		rev_name_map.write[E->get()] = E->key();
+	}
+	_put_u32(rev_name_map.size());
+	for (int i = 0; i < rev_name_map.size(); i++) {
+		_encode_string(data, rev_name_map[i]);
+	}
+
+	data.append_array(body);
+
+	r_buffer = data;
+	data.clear();
+	return OK;
+}
+
+/* LOADING */
+
+bool GDScriptCompiledBuffer::_get_u32(uint32_t &r_value) {
+
+	if (buffer_pos + 4 > buffer_len) {
+		error = "Unexpected end of buffer.";
+		return false;
+	}
+	r_value = decode_uint32(&buffer[buffer_pos]);
+	buffer_pos += 4;
+	return true;
+}
+
+bool GDScriptCompiledBuffer::_get_name(StringName &r_name) {
+
+	uint32_t idx;
+	GET_U32(idx);
+	if (idx >= uint32_t(names.size())) {
+		error = "Invalid name index.";
+		return false;
+	}
+	r_name = names[idx];
+	return true;
+}
+
+bool GDScriptCompiledBuffer::_get_variant(Variant &r_variant) {
+
+	uint32_t kind;
+	GET_U32(kind);
+
+	switch (kind) {
+		case VARIANT_VALUE: {
+			uint32_t len;
+			GET_U32(len);
+			if (len > uint32_t(buffer_len - buffer_pos) || decode_variant(r_variant, &buffer[buffer_pos], len, nullptr, false) != OK) {
+				error = "Invalid constant.";
+				return false;
+			}
+			buffer_pos += len;
+		} break;
+		case VARIANT_ARRAY: {
+			uint32_t size;
+			GET_U32(size);
+			Array array;
+			for (uint32_t i = 0; i < size; i++) {
+				Variant value;
+				if (!_get_variant(value)) {
+					return false;
+				}
+				array.push_back(value);
+			}
+			r_variant = array;
+		} break;
+		case VARIANT_DICTIONARY: {
+			uint32_t size;
+			GET_U32(size);
+			Dictionary dict;
+			for (uint32_t i = 0; i < size; i++) {
+				Variant key;
+				Variant value;
+				if (!_get_variant(key) || !_get_variant(value)) {
+					return false;
+				}
+				dict[key] = value;
+			}
+			r_variant = dict;
+		} break;
+		case VARIANT_NULL_OBJECT: {
+			r_variant = (Object *)nullptr;
+		} break;
+		case VARIANT_NATIVE_CLASS: {
+			StringName name;
+			GET_NAME(name);
+			const Map<StringName, int>::Element *E = GDScriptLanguage::get_singleton()->get_global_map().find(name);
+			if (!E || !Object::cast_to<GDScriptNativeClass>(GDScriptLanguage::get_singleton()->get_global_array()[E->get()])) {
+				error = "Native class '" + String(name) + "' not found.";
+				return false;
+			}
+			r_variant = GDScriptLanguage::get_singleton()->get_global_array()[E->get()];
+		} break;
+		case VARIANT_SCRIPT: {
+			Ref<Script> script;
+			if (!_get_script(script)) {
+				return false;
+			}
+			r_variant = script;
+		} break;
+		case VARIANT_RESOURCE: {
+			StringName path;
+			GET_NAME(path);
+			RES res = ResourceLoader::load(path);
+			if (res.is_null()) {
+				error = "Can't load resource '" + String(path) + "'.";
+				return false;
+			}
+			r_variant = res;
+		} break;
+		default: {
+			error = "Invalid constant kind.";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool GDScriptCompiledBuffer::_get_script(Ref<Script> &r_script) {
+
+	uint32_t kind;
+	GET_U32(kind);
+
+	Ref<Script> script;
+	switch (kind) {
+		case SCRIPT_NONE: {
+			r_script = Ref<Script>();
+			return true;
+		} break;
+		case SCRIPT_LOCAL: {
+			script = Ref<Script>(load_root);
+		} break;
+		case SCRIPT_EXTERNAL: {
+			StringName path;
+			GET_NAME(path);
+			script = ResourceLoader::load(path);
+			if (script.is_null()) {
+				error = "Can't load script '" + String(path) + "'.";
+				return false;
+			}
+		} break;
+		default: {
+			error = "Invalid script kind.";
+			return false;
+		}
+	}
+
+	uint32_t depth;
+	GET_U32(depth);
+	for (uint32_t i = 0; i < depth; i++) {
+		StringName name;
+		GET_NAME(name);
+		GDScript *gdscript = Object::cast_to<GDScript>(script.ptr());
+		if (!gdscript || !gdscript->subclasses.has(name)) {
+			error = "Class '" + String(name) + "' not found in '" + script->get_path() + "'.";
+			return false;
+		}
+		script = gdscript->subclasses[name];
+	}
+
+	r_script = script;
+	return true;
+}
+
+bool GDScriptCompiledBuffer::_get_data_type(GDScriptDataType &r_type) {
+
+	r_type = GDScriptDataType();
+
+	uint32_t value;
+	GET_U32(value);
+	r_type.has_type = value;
+	if (!r_type.has_type) {
+		return true;
+	}
+	GET_U32(value);
+	r_type.kind = (GDScriptDataType::Kind)value;
+	GET_U32(value);
+	r_type.builtin_type = (Variant::Type)value;
+	GET_NAME(r_type.native_type);
+	return _get_script(r_type.script_type);
+}
+
+bool GDScriptCompiledBuffer::_get_int_array(Vector<int> &r_array) {
+
+	uint32_t size;
+	GET_U32(size);
+	if (size > uint32_t(buffer_len - buffer_pos) / 4) {
+		error = "Unexpected end of buffer.";
+		return false;
+	}
+	r_array.resize(size);
+	for (uint32_t i = 0; i < size; i++) {
+		r_array.write[i] = decode_uint32(&buffer[buffer_pos]);
+		buffer_pos += 4;
+	}
+	return true;
+}
+
+bool GDScriptCompiledBuffer::_get_name_array(Vector<StringName> &r_array) {
+
+	uint32_t size;
+	GET_U32(size);
+	if (size > uint32_t(buffer_len - buffer_pos) / 4) {
+		error = "Unexpected end of buffer.";
+		return false;
+	}
+	r_array.resize(size);
+	for (uint32_t i = 0; i < size; i++) {
+		GET_NAME(r_array.write[i]);
+	}
+	return true;
+}
+
+bool GDScriptCompiledBuffer::_get_function(GDScript *p_class, GDScriptFunction *r_function) {
+
+	uint32_t value;
+	uint32_t count;
+
+	GET_NAME(r_function->name);
+	GET_U32(value);
+	r_function->_static = value;
+	GET_U32(value);
+	r_function->_has_yield = value;
+	GET_U32(value);
+	r_function->rpc_mode = (MultiplayerAPI::RPCMode)value;
+	GET_U32(value);
+	r_function->_argument_count = value;
+
+	Vector<StringName> arg_names;
+	if (!_get_name_array(arg_names)) {
+		return false;
+	}
+#ifdef TOOLS_ENABLED
+	r_function->arg_names = arg_names;
+#endif
+
+	GET_U32(count);
+	r_function->argument_types.resize(count);
+	for (uint32_t i = 0; i < count; i++) {
+		if (!_get_data_type(r_function->argument_types.write[i])) {
+			return false;
+		}
+	}
+	if (!_get_data_type(r_function->return_type)) {
+		return false;
+	}
+
+	if (!_get_int_array(r_function->default_arguments) || !_get_int_array(r_function->code)) {
+		return false;
+	}
+
+	GET_U32(count);
+	r_function->constants.resize(count);
+	for (uint32_t i = 0; i < count; i++) {
+		if (!_get_variant(r_function->constants.write[i])) {
+			return false;
+		}
+	}
+
+	if (!_get_name_array(r_function->global_names) || !_get_name_array(r_function->global_variable_names)) {
+		return false;
+	}
+	if (!r_function->_resolve_global_variables()) {
+		error = "Global identifier not found.";
+		return false;
+	}
+
+	GET_U32(count);
+	for (uint32_t i = 0; i < count; i++) {
+		GDScriptFunction::ValidatedOperator vop;
+		GET_U32(value);
+		vop.op = (Variant::Operator)value;
+		GET_U32(value);
+		vop.type_a = (Variant::Type)value;
+		GET_U32(value);
+		vop.type_b = (Variant::Type)value;
+		vop.evaluator = Variant::get_validated_operator_evaluator(vop.op, vop.type_a, vop.type_b);
+		if (!vop.evaluator) {
+			error = "Validated operator '" + Variant::get_operator_name(vop.op) + "' not found.";
+			return false;
+		}
+		r_function->validated_operators.push_back(vop);
+	}
+
+	GET_U32(count);
+	for (uint32_t i = 0; i < count; i++) {
+		GDScriptFunction::ValidatedBuiltinMethod vbm;
+		GET_U32(value);
+		vbm.base_type = (Variant::Type)value;
+		GET_NAME(vbm.name);
+		vbm.method = Variant::get_validated_builtin_method(vbm.base_type, vbm.name);
+		if (!vbm.method) {
+			error = "Built-in method '" + String(vbm.name) + "' not found.";
+			return false;
+		}
+		vbm.argument_types = Variant::get_method_argument_types(vbm.base_type, vbm.name);
+		vbm.has_return = false;
+		Variant::get_method_return_type(vbm.base_type, vbm.name, &vbm.has_return);
+		r_function->validated_builtin_methods.push_back(vbm);
+	}
+
+	GET_U32(count);
+	for (uint32_t i = 0; i < count; i++) {
+		GDScriptFunction::MethodBindCall mbc;
+		StringName class_name;
+		GET_NAME(class_name);
+		GET_NAME(mbc.name);
+		mbc.method = ClassDB::get_method(class_name, mbc.name);
+		mbc.class_ptr = mbc.method ? ClassDB::get_class_ptr(mbc.method->get_instance_class()) : nullptr;
+		if (!mbc.class_ptr) {
+			error = "Method '" + String(class_name) + "." + String(mbc.name) + "' not found.";
+			return false;
+		}
+
+		uint32_t ptrcall;
+		GET_U32(ptrcall);
+		GET_U32(count);
+		Vector<Variant::Type> argument_types;
+		for (uint32_t j = 0; j < count; j++) {
+			GET_U32(value);
+			argument_types.push_back((Variant::Type)value);
+		}
+		GET_U32(value);
+#ifdef PTRCALL_ENABLED
+		mbc.ptrcall = ptrcall && !mbc.method->is_vararg() && argument_types.size() == mbc.method->get_argument_count();
+		mbc.argument_types = argument_types;
+		mbc.return_type = (Variant::Type)value;
+#endif
+		r_function->method_bind_calls.push_back(mbc);
+	}
+
+	GET_U32(value);
+	r_function->_stack_size = value;
+	GET_U32(value);
+	r_function->_call_size = value;
+	GET_U32(value);
+	r_function->_initial_line = value;
+
+	GET_U32(count);
+	for (uint32_t i = 0; i < count; i++) {
+		GDScriptFunction::StackDebug sd;
+		GET_U32(value);
+		sd.line = value;
+		GET_U32(value);
+		sd.pos = value;
+		GET_U32(value);
+		sd.added = value;
+		GET_NAME(sd.identifier);
+		r_function->stack_debug.push_back(sd);
+	}
+
+	// Same setup as GDScriptCompiler::_parse_function().
+	r_function->_constants_ptr = r_function->constants.size() ? r_function->constants.ptrw() : nullptr;
+	r_function->_constant_count = r_function->constants.size();
+	r_function->_global_names_ptr = r_function->global_names.size() ? r_function->global_names.ptr() : nullptr;
+	r_function->_global_names_count = r_function->global_names.size();
+	r_function->_validated_operators_ptr = r_function->validated_operators.ptr();
+	r_function->_validated_operators_count = r_function->validated_operators.size();
+	r_function->_validated_builtin_methods_ptr = r_function->validated_builtin_methods.ptr();
+	r_function->_validated_builtin_methods_count = r_function->validated_builtin_methods.size();
+	r_function->_method_bind_calls_ptr = r_function->method_bind_calls.ptr();
+	r_function->_method_bind_calls_count = r_function->method_bind_calls.size();
+	r_function->_code_ptr = r_function->code.size() ? r_function->code.ptr() : nullptr;
+	r_function->_code_size = r_function->code.size();
+	if (r_function->default_arguments.size()) {
+		r_function->_default_arg_count = r_function->default_arguments.size() - 1;
+		r_function->_default_arg_ptr = r_function->default_arguments.ptr();
+	} else {
+		r_function->_default_arg_count = 0;
+		r_function->_default_arg_ptr = nullptr;
+	}
+
+	r_function->_script = p_class;
+	r_function->source = load_root->get_path();
+
+#ifdef DEBUG_ENABLED
+	if (EngineDebugger::is_active()) {
+		String signature;
+		if (p_class->get_path() != String())
+			signature += p_class->get_path();
+		signature += "::" + itos(r_function->_initial_line);
+		if (p_class->name != String()) {
+			signature += "::" + String(p_class->name) + "." + String(r_function->name);
+		} else {
+			signature += "::" + String(r_function->name);
+		}
+		r_function->profile.signature = signature;
+	}
+
+	r_function->func_cname = (String(r_function->source) + " - " + String(r_function->name)).utf8();
+	r_function->_func_cname = r_function->func_cname.get_data();
+#endif
+
+	return true;
+}
+
+int GDScriptCompiledBuffer::_get_class_tree(GDScript *p_class) {
+
+	// Same as GDScriptCompiler::_make_scripts().
+	p_class->subclasses.clear();
+
+	uint32_t count;
+	if (!_get_u32(count)) {
+		return -1;
+	}
+
+	int classes = 1;
+	for (uint32_t i = 0; i < count; i++) {
+		StringName name;
+		if (!_get_name(name)) {
+			return -1;
+		}
+
+		String fully_qualified_name = p_class->fully_qualified_name + "::" + name;
+		Ref<GDScript> subclass = GDScriptLanguage::get_singleton()->get_orphan_subclass(fully_qualified_name);
+		if (subclass.is_null()) {
+			subclass.instance();
+		}
+		subclass->_owner = p_class;
+		subclass->fully_qualified_name = fully_qualified_name;
+		p_class->subclasses.insert(name, subclass);
+
+		int subclasses = _get_class_tree(subclass.ptr());
+		if (subclasses < 0) {
+			return -1;
+		}
+		classes += subclasses;
+	}
+	return classes;
+}
+
+bool GDScriptCompiledBuffer::_get_class() {
+
+	uint32_t value;
+	uint32_t count;
+
+	GDScript *script = load_root;
+	GET_U32(count);
+	for (uint32_t i = 0; i < count; i++) {
+		StringName name;
+		GET_NAME(name);
+		if (!script->subclasses.has(name)) {
+			error = "Class '" + String(name) + "' not found.";
+			return false;
+		}
+		script = script->subclasses[name].ptr();
+	}
+
+	// Same reset as GDScriptCompiler::_parse_class_level().
+	script->native = Ref<GDScriptNativeClass>();
+	script->base = Ref<GDScript>();
+	script->_base = nullptr;
+	script->members.clear();
+	script->constants.clear();
+	for (Map<StringName, GDScriptFunction *>::Element *E = script->member_functions.front(); E; E = E->next()) {
+		memdelete(E->get());
+	}
+	script->member_functions.clear();
+	script->member_indices.clear();
+	script->member_info.clear();
+	script->_signals.clear();
+	script->initializer = nullptr;
+
+	StringName class_name;
+	GET_U32(value);
+	script->tool = value;
+	GET_NAME(class_name);
+	script->name = class_name;
+
+	GET_U32(value);
+	if (value) {
+		Ref<Script> base;
+		if (!_get_script(base)) {
+			return false;
+		}
+		script->base = base;
+		if (script->base.is_null() || !script->base->valid) {
+			error = "Invalid base script.";
+			return false;
+		}
+		script->_base = script->base.ptr();
+		script->member_indices = script->base->member_indices;
+	} else {
+		StringName native;
+		GET_NAME(native);
+		const Map<StringName, int>::Element *E = GDScriptLanguage::get_singleton()->get_global_map().find(native);
+		if (E) {
+			script->native = GDScriptLanguage::get_singleton()->get_global_array()[E->get()];
+		}
+		if (script->native.is_null()) {
+			error = "Native class '" + String(native) + "' not found.";
+			return false;
+		}
+	}
+
+	// Member indices are part of the code, the base must have the layout it
+	// had when compiling.
+	GET_U32(value);
+	if (value != uint32_t(script->member_indices.size())) {
+		error = "Members of the base class changed.";
+		return false;
+	}
+
+	GET_U32(count);
+	for (uint32_t i = 0; i < count; i++) {
+		StringName name;
+		GDScript::MemberInfo minfo;
+		PropertyInfo pinfo;
+
+		GET_NAME(name);
+		GET_U32(value);
+		minfo.index = value;
+		GET_NAME(minfo.setter);
+		GET_NAME(minfo.getter);
+		GET_U32(value);
+		minfo.rpc_mode = (MultiplayerAPI::RPCMode)value;
+		if (!_get_data_type(minfo.data_type)) {
+			return false;
+		}
+
+		pinfo.name = name;
+		GET_U32(value);
+		pinfo.type = (Variant::Type)value;
+		GET_NAME(pinfo.class_name);
+		GET_U32(value);
+		pinfo.hint = (PropertyHint)value;
+		StringName hint_string;
+		GET_NAME(hint_string);
+		pinfo.hint_string = hint_string;
+		GET_U32(value);
+		pinfo.usage = value;
+
+		script->member_info[name] = pinfo;
+		script->member_indices[name] = minfo;
+		script->members.insert(name);
+	}
+
+	GET_U32(count);
+	for (uint32_t i = 0; i < count; i++) {
+		StringName name;
+		Variant constant;
+		GET_NAME(name);
+		if (!_get_variant(constant)) {
+			return false;
+		}
+		script->constants.insert(name, constant);
+	}
+
+	GET_U32(count);
+	for (uint32_t i = 0; i < count; i++) {
+		StringName name;
+		GET_NAME(name);
+		if (!_get_name_array(script->_signals[name])) {
+			return false;
+		}
+	}
+
+	GET_U32(count);
+	for (uint32_t i = 0; i < count; i++) {
+		GDScriptFunction *gdfunc = memnew(GDScriptFunction);
+		if (!_get_function(script, gdfunc)) {
+			memdelete(gdfunc);
+			return false;
+		}
+		if (script->member_functions.has(gdfunc->name)) {
+			memdelete(script->member_functions[gdfunc->name]);
+		}
+		script->member_functions[gdfunc->name] = gdfunc;
+		if (gdfunc->name == "_init") {
+			script->initializer = gdfunc;
+		}
+	}
+
+	script->valid = true;
+	return true;
+}
+
+Error GDScriptCompiledBuffer::load_script(GDScript *p_script, const Vector<uint8_t> &p_buffer) {
+
+	load_root = p_script;
+	buffer = p_buffer.ptr();
+	buffer_len = p_buffer.size();
+	buffer_pos = 4;
+	names.clear();
+	error = String();
+
+	ERR_FAIL_COND_V(!is_compiled_buffer(p_buffer), ERR_INVALID_DATA);
+
+	uint32_t value;
+	if (!_get_u32(value) || value != COMPILED_VERSION) {
+		error = "Unsupported compiled code version.";
+		return ERR_INVALID_DATA;
+	}
+	if (!_get_u32(value) || value > uint32_t(buffer_len - buffer_pos)) {
+		error = "Unexpected end of buffer.";
+		return ERR_INVALID_DATA;
+	}
+	buffer_pos += value;
+
+	for (uint32_t i = 0; i < COMPILED_LAYOUT_SIZE; i++) {
+		if (!_get_u32(value) || value != compiled_layout[i]) {
+			error = "Compiled with an incompatible engine version.";
+			return ERR_INVALID_DATA;
+		}
+	}
+	String version;
+	if (!_decode_string(buffer, buffer_len, buffer_pos, version) || version != VERSION_FULL_CONFIG) {
+		error = "Compiled with an incompatible engine version.";
+		return ERR_INVALID_DATA;
+	}
+
+	uint32_t name_count;
+	if (!_get_u32(name_count) || name_count > uint32_t(buffer_len - buffer_pos) / 4) {
+		error = "Unexpected end of buffer.";
+		return ERR_INVALID_DATA;
+	}
+	names.resize(name_count);
+	for (uint32_t i = 0; i < name_count; i++) {
+		String name;
+		if (!_decode_string(buffer, buffer_len, buffer_pos, name)) {
+			error = "Unexpected end of buffer.";
+			return ERR_INVALID_DATA;
+		}
+		names.write[i] = name;
+	}
+
+	// Same as GDScriptCompiler::compile().
+	p_script->fully_qualified_name = p_script->path;
+	p_script->_owner = nullptr;
+
+	int classes = _get_class_tree(p_script);
+	if (classes < 0) {
+		return ERR_INVALID_DATA;
+	}
+	for (int i = 0; i < classes; i++) {
+		if (!_get_class()) {
+			return ERR_INVALID_DATA;
+		}
+	}
+
+	return OK;
+}
+
+bool GDScriptCompiledBuffer::is_compiled_buffer(const Vector<uint8_t> &p_buffer) {
+
+	return p_buffer.size() >= 12 && p_buffer[0] == 'G' && p_buffer[1] == 'D' && p_buffer[2] == 'C' && p_buffer[3] == 'F';
+}
+
+Vector<uint8_t> GDScriptCompiledBuffer::get_token_buffer(const Vector<uint8_t> &p_buffer) {
+
+	ERR_FAIL_COND_V(!is_compiled_buffer(p_buffer), Vector<uint8_t>());
+
+	uint32_t size = decode_uint32(&p_buffer[8]);
+	ERR_FAIL_COND_V(size == 0 || size > uint32_t(p_buffer.size() - 12), Vector<uint8_t>());
+	return p_buffer.subarray(12, 12 + size - 1);
+}
+
+Vector<uint8_t> GDScriptCompiledBuffer::parse_code_string(const String &p_code, const String &p_path) {
+
+	Vector<uint8_t> tokens = GDScriptTokenizerBuffer::parse_code_string(p_code);
+	if (tokens.empty()) {
+		return tokens;
+	}
+
+	Ref<GDScript> script;
+	script.instance();
+	script->set_script_path(p_path);
+
+	GDScriptParser parser;
+	Error err = parser.parse(p_code, p_path.get_base_dir(), false, p_path);
+	if (err == OK) {
+		GDScriptCompiler compiler;
+		// Keep what the debugger needs, exports can run with it.
+		compiler.set_debug_stack(true);
+		err = compiler.compile(&parser, script.ptr());
+	}
+
+	// Scripts that don't compile here are left to fail at load time, as usual.
+	if (err != OK) {
+		return tokens;
+	}
+
+	GDScriptCompiledBuffer compiled;
+	Vector<uint8_t> buffer;
+	err = compiled.save_script(script.ptr(), tokens, buffer);
+	if (err != OK) {
+		print_verbose("GDScript: Can't save compiled code of '" + p_path + "', exporting it tokenized: " + compiled.get_error());
+		return tokens;
+	}
+
+	return buffer;
+}
+
+GDScriptCompiledBuffer::GDScriptCompiledBuffer() {
+
+	root = nullptr;
+	load_root = nullptr;
+	buffer = nullptr;
+	buffer_len = 0;
+	buffer_pos = 0;
+}
@@ -0,0 +1,111 @@
+/*************************************************************************/
+/*  gdscript_compiled_buffer.h                                           */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef GDSCRIPT_COMPILED_BUFFER_H
+#define GDSCRIPT_COMPILED_BUFFER_H
+
+#include "gdscript.h"
+
+// Serialized form of a compiled script, so exported projects can load the
+// functions as they are instead of parsing and compiling the source again.
+// Everything that depends on the running engine (globals, native classes,
+// method binds, validated operators and methods, other scripts and resources)
+// is stored by name and resolved again when loading. The tokenized code is
+// kept alongside, and used whenever the compiled code can't be loaded.
+
+class GDScriptCompiledBuffer {
+
+	enum {
+		VARIANT_VALUE,
+		VARIANT_ARRAY,
+		VARIANT_DICTIONARY,
+		VARIANT_NULL_OBJECT,
+		VARIANT_NATIVE_CLASS,
+		VARIANT_SCRIPT,
+		VARIANT_RESOURCE,
+	};
+
+	enum {
+		SCRIPT_NONE,
+		SCRIPT_LOCAL,
+		SCRIPT_EXTERNAL,
+	};
+
+	// Saving.
+	const GDScript *root;
+	Vector<uint8_t> data;
+	Map<StringName, int> name_map;
+	Set<const GDScript *> saved_classes;
+
+	// Loading.
+	GDScript *load_root;
+	const uint8_t *buffer;
+	int buffer_len;
+	int buffer_pos;
+	Vector<StringName> names;
+
+	String error;
+
+	void _put_u32(uint32_t p_value);
+	void _put_name(const StringName &p_name);
+	bool _put_variant(const Variant &p_variant);
+	bool _put_script(const Ref<Script> &p_script);
+	bool _put_data_type(const GDScriptDataType &p_type);
+	bool _put_function(const GDScriptFunction *p_function);
+	bool _put_class(const GDScript *p_class);
+	void _put_class_tree(const GDScript *p_class);
+
+	bool _get_u32(uint32_t &r_value);
+	bool _get_name(StringName &r_name);
+	bool _get_variant(Variant &r_variant);
+	bool _get_script(Ref<Script> &r_script);
+	bool _get_int_array(Vector<int> &r_array);
+	bool _get_name_array(Vector<StringName> &r_array);
+	bool _get_data_type(GDScriptDataType &r_type);
+	bool _get_function(GDScript *p_class, GDScriptFunction *r_function);
+	bool _get_class();
+	int _get_class_tree(GDScript *p_class);
+
+	static const GDScript *_get_subclass_path(const GDScript *p_class, Vector<StringName> &r_path);
+
+public:
+	static bool is_compiled_buffer(const Vector<uint8_t> &p_buffer);
+	static Vector<uint8_t> get_token_buffer(const Vector<uint8_t> &p_buffer);
+	static Vector<uint8_t> parse_code_string(const String &p_code, const String &p_path);
+
+	Error save_script(const GDScript *p_script, const Vector<uint8_t> &p_token_buffer, Vector<uint8_t> &r_buffer);
+	Error load_script(GDScript *p_script, const Vector<uint8_t> &p_buffer);
+
+	String get_error() const { return error; }
+
+	GDScriptCompiledBuffer();
+};
+
+#endif // GDSCRIPT_COMPILED_BUFFER_H
@@ -74,6 +74,217 @@ void GDScriptCompiler::_set_error(const String &p_error, const GDScriptParser::N
 	}
 }
 
+bool GDScriptCompiler::_get_builtin_type(const GDScriptParser::Node *p_node, Variant::Type &r_type) const {
+
+	GDScriptParser::DataType datatype = p_node->get_datatype();
+	if (!datatype.has_type || datatype.is_meta_type || datatype.may_yield || datatype.kind != GDScriptParser::DataType::BUILTIN) {
+		return false;
+	}
+	if (datatype.builtin_type == Variant::NIL || datatype.builtin_type == Variant::OBJECT) {
+		return false;
+	}
+	r_type = datatype.builtin_type;
+	return true;
+}
+
+static bool _is_numeric_operator(Variant::Operator p_op, Variant::Type p_type) {
+
+	switch (p_op) {
+		case Variant::OP_EQUAL:
+		case Variant::OP_NOT_EQUAL:
+		case Variant::OP_LESS:
+		case Variant::OP_LESS_EQUAL:
+		case Variant::OP_GREATER:
+		case Variant::OP_GREATER_EQUAL:
+		case Variant::OP_ADD:
+		case Variant::OP_SUBTRACT:
+		case Variant::OP_MULTIPLY:
+		case Variant::OP_DIVIDE:
+		case Variant::OP_NEGATE:
+			return true;
+		case Variant::OP_MODULE:
+		case Variant::OP_BIT_AND:
+		case Variant::OP_BIT_OR:
+		case Variant::OP_BIT_XOR:
+			return p_type == Variant::INT;
+		default:
+			return false;
+	}
+}
+
+static bool _is_indexable_array(Variant::Type p_type) {
+
+	return p_type == Variant::ARRAY || (p_type >= Variant::PACKED_BYTE_ARRAY && p_type <= Variant::PACKED_COLOR_ARRAY);
+}
+
+void GDScriptCompiler::_write_operator(CodeGen &codegen, Variant::Operator p_op, const GDScriptParser::Node *p_a, const GDScriptParser::Node *p_b, int p_address_a, int p_address_b) {
+
+	codegen.last_operator_pos = codegen.opcodes.size();
+
+	// Operators with operands of known types skip the type dispatch.
+	Variant::Type type_a;
+	Variant::Type type_b;
+	if (_get_builtin_type(p_a, type_a) && _get_builtin_type(p_b, type_b)) {
+
+		if (type_a == type_b && (type_a == Variant::INT || type_a == Variant::FLOAT) && _is_numeric_operator(p_op, type_a)) {
+			codegen.opcodes.push_back(type_a == Variant::INT ? GDScriptFunction::OPCODE_OPERATOR_INT : GDScriptFunction::OPCODE_OPERATOR_FLOAT);
+			codegen.opcodes.push_back(p_op);
+			codegen.opcodes.push_back(p_address_a);
+			codegen.opcodes.push_back(p_address_b);
+			return;
+		}
+
+		Variant::ValidatedOperatorEvaluator evaluator = Variant::get_validated_operator_evaluator(p_op, type_a, type_b);
+		if (evaluator) {
+			codegen.opcodes.push_back(GDScriptFunction::OPCODE_OPERATOR_VALIDATED);
+			codegen.opcodes.push_back(codegen.get_validated_operator_pos(p_op, type_a, type_b, evaluator));
+			codegen.opcodes.push_back(p_address_a);
+			codegen.opcodes.push_back(p_address_b);
+			return;
+		}
+	}
+
+	codegen.opcodes.push_back(GDScriptFunction::OPCODE_OPERATOR); // perform operator
+	codegen.opcodes.push_back(p_op); //which operator
+	codegen.opcodes.push_back(p_address_a); // argument 1
+	codegen.opcodes.push_back(p_address_b); // argument 2
+}
+
+bool GDScriptCompiler::_write_typed_call(CodeGen &codegen, const GDScriptParser::OperatorNode *p_call, const Vector<int> &p_arguments) {
+
+	const GDScriptParser::Node *instance = p_call->arguments[0];
+	if (instance->type == GDScriptParser::Node::TYPE_SELF) {
+		return false;
+	}
+
+	GDScriptParser::DataType base_type = instance->get_datatype();
+	if (!base_type.has_type || base_type.is_meta_type || base_type.may_yield) {
+		return false;
+	}
+
+	StringName method = static_cast<const GDScriptParser::IdentifierNode *>(p_call->arguments[1])->name;
+	int argc = p_call->arguments.size() - 2;
+
+	if (base_type.kind == GDScriptParser::DataType::BUILTIN) {
+
+		Variant::Type type = base_type.builtin_type;
+		if (type == Variant::NIL || type == Variant::OBJECT) {
+			return false;
+		}
+
+		Variant::ValidatedBuiltInMethod validated = Variant::get_validated_builtin_method(type, method);
+		if (!validated) {
+			return false;
+		}
+
+		// Validated calls need every argument with its exact type, the generic
+		// path fills in defaults and converts.
+		Vector<Variant::Type> argument_types = Variant::get_method_argument_types(type, method);
+		if (argument_types.size() != argc) {
+			return false;
+		}
+		for (int i = 0; i < argc; i++) {
+			Variant::Type arg_type;
+			if (argument_types[i] != Variant::NIL && _get_builtin_type(p_call->arguments[i + 2], arg_type) && arg_type != argument_types[i]) {
+				return false;
+			}
+		}
+
+		GDScriptFunction::ValidatedBuiltinMethod vbm;
+		vbm.method = validated;
+		vbm.base_type = type;
+		vbm.argument_types = argument_types;
+		vbm.has_return = false;
+		Variant::get_method_return_type(type, method, &vbm.has_return);
+		vbm.name = method;
+
+		codegen.opcodes.push_back(GDScriptFunction::OPCODE_CALL_BUILTIN_METHOD_VALIDATED);
+		codegen.opcodes.push_back(argc);
+		codegen.alloc_call(argc);
+		codegen.opcodes.push_back(p_arguments[0]); // base
+		codegen.opcodes.push_back(codegen.validated_builtin_methods.size());
+		codegen.validated_builtin_methods.push_back(vbm);
+		for (int i = 2; i < p_arguments.size(); i++)
+			codegen.opcodes.push_back(p_arguments[i]);
+		return true;
+	}
+
+	if (base_type.kind == GDScriptParser::DataType::NATIVE) {
+
+		MethodBind *mb = ClassDB::get_method(base_type.native_type, method);
+		if (!mb || (!mb->is_vararg() && argc > mb->get_argument_count())) {
+			return false;
+		}
+
+		void *class_ptr = ClassDB::get_class_ptr(mb->get_instance_class());
+		if (!class_ptr) {
+			return false;
+		}
+
+		GDScriptFunction::MethodBindCall mbc;
+		mbc.method = mb;
+		mbc.class_ptr = class_ptr;
+		mbc.name = method;
+#ifdef PTRCALL_ENABLED
+		mbc.ptrcall = false;
+		mbc.return_type = Variant::NIL;
+#ifdef DEBUG_METHODS_ENABLED
+		// Argument types are only known to debug builds, release ones always go
+		// through MethodBind::call().
+		mbc.ptrcall = !mb->is_vararg() && argc == mb->get_argument_count();
+		for (int i = 0; mbc.ptrcall && i < argc; i++) {
+			Variant::Type expected = mb->get_argument_type(i);
+			Variant::Type arg_type;
+			if (expected == Variant::OBJECT || (expected != Variant::NIL && _get_builtin_type(p_call->arguments[i + 2], arg_type) && arg_type != expected)) {
+				mbc.ptrcall = false;
+			}
+			mbc.argument_types.push_back(expected);
+		}
+		if (mbc.ptrcall && mb->has_return()) {
+			// Enums are returned as 32 bits ints, which would leave garbage in the Variant.
+			PropertyInfo return_info = mb->get_return_info();
+			mbc.return_type = return_info.type;
+			mbc.ptrcall = return_info.type != Variant::OBJECT && !(return_info.usage & PROPERTY_USAGE_CLASS_IS_ENUM);
+		}
+#endif
+#endif
+
+		codegen.opcodes.push_back(GDScriptFunction::OPCODE_CALL_METHOD_BIND);
+		codegen.opcodes.push_back(argc);
+		codegen.alloc_call(argc);
+		codegen.opcodes.push_back(p_arguments[0]); // base
+		codegen.opcodes.push_back(codegen.method_bind_calls.size());
+		codegen.method_bind_calls.push_back(mbc);
+		for (int i = 2; i < p_arguments.size(); i++)
+			codegen.opcodes.push_back(p_arguments[i]);
+		return true;
+	}
+
+	return false;
+}
+
+int GDScriptCompiler::_write_jump_if_not(CodeGen &codegen, int p_condition) {
+
+	// A comparison only read by the jump is fused with it, its result is never stored.
+	int pos = codegen.last_operator_pos;
+	if (pos >= 0 && pos + 5 == codegen.opcodes.size() && codegen.opcodes[pos + 4] == p_condition && (p_condition >> GDScriptFunction::ADDR_BITS) == GDScriptFunction::ADDR_TYPE_STACK) {
+
+		int opcode = codegen.opcodes[pos];
+		Variant::Operator op = Variant::Operator(codegen.opcodes[pos + 1]);
+		bool comparison = op == Variant::OP_EQUAL || op == Variant::OP_NOT_EQUAL || op == Variant::OP_LESS || op == Variant::OP_LESS_EQUAL || op == Variant::OP_GREATER || op == Variant::OP_GREATER_EQUAL;
+		if (comparison && (opcode == GDScriptFunction::OPCODE_OPERATOR || opcode == GDScriptFunction::OPCODE_OPERATOR_INT || opcode == GDScriptFunction::OPCODE_OPERATOR_FLOAT)) {
+			codegen.opcodes.write[pos] = GDScriptFunction::OPCODE_JUMP_IF_NOT_COMPARE;
+			codegen.last_operator_pos = -1;
+			return pos + 4;
+		}
+	}
+
+	codegen.opcodes.push_back(GDScriptFunction::OPCODE_JUMP_IF_NOT);
+	codegen.opcodes.push_back(p_condition);
+	codegen.opcodes.push_back(0); // temporary
+	return codegen.opcodes.size() - 1;
+}
+
 bool GDScriptCompiler::_create_unary_operator(CodeGen &codegen, const GDScriptParser::OperatorNode *on, Variant::Operator op, int p_stack_level) {
 
 	ERR_FAIL_COND_V(on->arguments.size() != 1, false);
@@ -82,11 +293,7 @@ bool GDScriptCompiler::_create_unary_operator(CodeGen &codegen, const GDScriptPa
 	if (src_address_a < 0)
 		return false;
 
-	codegen.opcodes.push_back(GDScriptFunction::OPCODE_OPERATOR); // perform operator
-	codegen.opcodes.push_back(op); //which operator
-	codegen.opcodes.push_back(src_address_a); // argument 1
-	codegen.opcodes.push_back(src_address_a); // argument 2 (repeated)
-	//codegen.opcodes.push_back(GDScriptFunction::ADDR_TYPE_NIL); // argument 2 (unary only takes one parameter)
+	_write_operator(codegen, op, on->arguments[0], on->arguments[0], src_address_a, src_address_a); // argument 2 (repeated)
 	return true;
 }
 
@@ -104,10 +311,7 @@ bool GDScriptCompiler::_create_binary_operator(CodeGen &codegen, const GDScriptP
 	if (src_address_b < 0)
 		return false;
 
-	codegen.opcodes.push_back(GDScriptFunction::OPCODE_OPERATOR); // perform operator
-	codegen.opcodes.push_back(op); //which operator
-	codegen.opcodes.push_back(src_address_a); // argument 1
-	codegen.opcodes.push_back(src_address_b); // argument 2 (unary only takes one parameter)
+	_write_operator(codegen, op, on->arguments[0], on->arguments[1], src_address_a, src_address_b);
 	return true;
 }
 
@@ -239,6 +443,7 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 			// TRY CLASS MEMBER
 			if (_is_class_member_property(codegen, identifier)) {
 				//get property
+				codegen.last_get_member_pos = codegen.opcodes.size();
 				codegen.opcodes.push_back(GDScriptFunction::OPCODE_GET_MEMBER); // perform operator
 				codegen.opcodes.push_back(codegen.get_name_map_pos(identifier)); // argument 2 (unary only takes one parameter)
 				int dst_addr = (p_stack_level) | (GDScriptFunction::ADDR_TYPE_STACK << GDScriptFunction::ADDR_BITS);
@@ -307,7 +512,7 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 
 			if (GDScriptLanguage::get_singleton()->get_global_map().has(identifier)) {
 
-				int idx = GDScriptLanguage::get_singleton()->get_global_map()[identifier];
+				int idx = codegen.get_global_variable_pos(identifier);
 				return idx | (GDScriptFunction::ADDR_TYPE_GLOBAL << GDScriptFunction::ADDR_BITS); //argument (stack root)
 			}
 
@@ -349,12 +554,8 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 #ifdef TOOLS_ENABLED
 			if (GDScriptLanguage::get_singleton()->get_named_globals_map().has(identifier)) {
 
-				int idx = codegen.named_globals.find(identifier);
-				if (idx == -1) {
-					idx = codegen.named_globals.size();
-					codegen.named_globals.push_back(identifier);
-				}
-				return idx | (GDScriptFunction::ADDR_TYPE_NAMED_GLOBAL << GDScriptFunction::ADDR_BITS);
+				int idx = codegen.get_global_variable_pos(identifier);
+				return idx | (GDScriptFunction::ADDR_TYPE_GLOBAL << GDScriptFunction::ADDR_BITS);
 			}
 #endif
 
@@ -486,7 +687,7 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 					int class_idx;
 					if (GDScriptLanguage::get_singleton()->get_global_map().has(cast_type.native_type)) {
 
-						class_idx = GDScriptLanguage::get_singleton()->get_global_map()[cast_type.native_type];
+						class_idx = codegen.get_global_variable_pos(cast_type.native_type);
 						class_idx |= (GDScriptFunction::ADDR_TYPE_GLOBAL << GDScriptFunction::ADDR_BITS); //argument (stack root)
 					} else {
 						_set_error("Invalid native class type '" + String(cast_type.native_type) + "'.", cn);
@@ -656,11 +857,22 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 							arguments.push_back(ret);
 						}
 
-						codegen.opcodes.push_back(p_root ? GDScriptFunction::OPCODE_CALL : GDScriptFunction::OPCODE_CALL_RETURN); // perform operator
-						codegen.opcodes.push_back(on->arguments.size() - 2);
-						codegen.alloc_call(on->arguments.size() - 2);
-						for (int i = 0; i < arguments.size(); i++)
-							codegen.opcodes.push_back(arguments[i]);
+						if (!_write_typed_call(codegen, on, arguments)) {
+							int get_pos = codegen.last_get_member_pos;
+							if (get_pos >= 0 && get_pos + 3 == codegen.opcodes.size() && codegen.opcodes[get_pos + 2] == arguments[0]) {
+								// The base is a member property fetched right before the call, fetch it as part of the call.
+								int member_name = codegen.opcodes[get_pos + 1];
+								codegen.opcodes.resize(get_pos);
+								codegen.opcodes.push_back(GDScriptFunction::OPCODE_GET_MEMBER_CALL);
+								codegen.opcodes.push_back(member_name);
+								codegen.last_get_member_pos = -1;
+							}
+							codegen.opcodes.push_back(p_root ? GDScriptFunction::OPCODE_CALL : GDScriptFunction::OPCODE_CALL_RETURN); // perform operator
+							codegen.opcodes.push_back(on->arguments.size() - 2);
+							codegen.alloc_call(on->arguments.size() - 2);
+							for (int i = 0; i < arguments.size(); i++)
+								codegen.opcodes.push_back(arguments[i]);
+						}
 					}
 				} break;
 				case GDScriptParser::OperatorNode::OP_YIELD: {
@@ -682,6 +894,7 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 					}
 
 					//push call bytecode
+					codegen.has_yield = true;
 					codegen.opcodes.push_back(arguments.size() == 0 ? GDScriptFunction::OPCODE_YIELD : GDScriptFunction::OPCODE_YIELD_SIGNAL); // basic type constructor
 					for (int i = 0; i < arguments.size(); i++)
 						codegen.opcodes.push_back(arguments[i]); //arguments
@@ -749,7 +962,15 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 						}
 					}
 
-					codegen.opcodes.push_back(named ? GDScriptFunction::OPCODE_GET_NAMED : GDScriptFunction::OPCODE_GET); // perform operator
+					Variant::Type base_type;
+					Variant::Type index_type;
+					if (named) {
+						codegen.opcodes.push_back(GDScriptFunction::OPCODE_GET_NAMED); // perform operator
+					} else if (_get_builtin_type(on->arguments[0], base_type) && _is_indexable_array(base_type) && _get_builtin_type(on->arguments[1], index_type) && index_type == Variant::INT) {
+						codegen.opcodes.push_back(GDScriptFunction::OPCODE_GET_INDEXED_VALIDATED);
+					} else {
+						codegen.opcodes.push_back(GDScriptFunction::OPCODE_GET);
+					}
 					codegen.opcodes.push_back(from); // argument 1
 					codegen.opcodes.push_back(index); // argument 2 (unary only takes one parameter)
 
@@ -1097,7 +1318,15 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 						if (set_value < 0) //error
 							return set_value;
 
-						codegen.opcodes.push_back(named ? GDScriptFunction::OPCODE_SET_NAMED : GDScriptFunction::OPCODE_SET);
+						Variant::Type base_type;
+						Variant::Type index_type;
+						if (named) {
+							codegen.opcodes.push_back(GDScriptFunction::OPCODE_SET_NAMED);
+						} else if (_get_builtin_type(op->arguments[0], base_type) && _is_indexable_array(base_type) && _get_builtin_type(op->arguments[1], index_type) && index_type == Variant::INT) {
+							codegen.opcodes.push_back(GDScriptFunction::OPCODE_SET_INDEXED_VALIDATED);
+						} else {
+							codegen.opcodes.push_back(GDScriptFunction::OPCODE_SET);
+						}
 						codegen.opcodes.push_back(prev_pos);
 						codegen.opcodes.push_back(set_index);
 						codegen.opcodes.push_back(set_value);
@@ -1140,6 +1369,23 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 							codegen.alloc_stack(slevel);
 						}
 
+						if (on->op == GDScriptParser::OperatorNode::OP_ASSIGN_ADD && (dst_address_a >> GDScriptFunction::ADDR_BITS) == GDScriptFunction::ADDR_TYPE_STACK_VARIABLE) {
+							// Adding an int to an int or untyped local is done in place.
+							Variant::Type dst_type;
+							Variant::Type value_type;
+							bool dst_int = !on->arguments[0]->get_datatype().has_type || (_get_builtin_type(on->arguments[0], dst_type) && dst_type == Variant::INT);
+							if (dst_int && _get_builtin_type(on->arguments[1], value_type) && value_type == Variant::INT) {
+								int value_address = _parse_expression(codegen, on->arguments[1], slevel);
+								if (value_address < 0)
+									return -1;
+
+								codegen.opcodes.push_back(GDScriptFunction::OPCODE_INCREMENT_INT);
+								codegen.opcodes.push_back(dst_address_a);
+								codegen.opcodes.push_back(value_address);
+								return dst_address_a;
+							}
+						}
+
 						int src_address_b = _parse_assign_right_expression(codegen, on, slevel);
 						if (src_address_b < 0)
 							return -1;
@@ -1159,7 +1405,7 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 									int class_idx;
 									if (GDScriptLanguage::get_singleton()->get_global_map().has(assign_type.native_type)) {
 
-										class_idx = GDScriptLanguage::get_singleton()->get_global_map()[assign_type.native_type];
+										class_idx = codegen.get_global_variable_pos(assign_type.native_type);
 										class_idx |= (GDScriptFunction::ADDR_TYPE_GLOBAL << GDScriptFunction::ADDR_BITS); //argument (stack root)
 									} else {
 										_set_error("Invalid native class type '" + String(assign_type.native_type) + "'.", on->arguments[0]);
@@ -1365,10 +1611,7 @@ Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::Blo
 						if (ret2 < 0)
 							return ERR_PARSE_ERROR;
 
-						codegen.opcodes.push_back(GDScriptFunction::OPCODE_JUMP_IF_NOT);
-						codegen.opcodes.push_back(ret2);
-						int else_addr = codegen.opcodes.size();
-						codegen.opcodes.push_back(0); //temporary
+						int else_addr = _write_jump_if_not(codegen, ret2);
 
 						Error err = _parse_block(codegen, cf->body, p_stack_level, p_break_addr, p_continue_addr);
 						if (err)
@@ -1456,9 +1699,7 @@ Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::Blo
 						int ret2 = _parse_expression(codegen, cf->arguments[0], p_stack_level, false);
 						if (ret2 < 0)
 							return ERR_PARSE_ERROR;
-						codegen.opcodes.push_back(GDScriptFunction::OPCODE_JUMP_IF_NOT);
-						codegen.opcodes.push_back(ret2);
-						codegen.opcodes.push_back(break_addr);
+						codegen.opcodes.write[_write_jump_if_not(codegen, ret2)] = break_addr;
 						Error err = _parse_block(codegen, cf->body, p_stack_level, break_addr, continue_addr);
 						if (err)
 							return err;
@@ -1579,7 +1820,10 @@ Error GDScriptCompiler::_parse_function(GDScript *p_script, const GDScriptParser
 	codegen.stack_max = 0;
 	codegen.current_line = 0;
 	codegen.call_max = 0;
-	codegen.debug_stack = EngineDebugger::is_active();
+	codegen.has_yield = false;
+	codegen.last_operator_pos = -1;
+	codegen.last_get_member_pos = -1;
+	codegen.debug_stack = debug_stack || EngineDebugger::is_active();
 	Vector<StringName> argnames;
 
 	int stack_level = 0;
@@ -1726,17 +1970,24 @@ Error GDScriptCompiler::_parse_function(GDScript *p_script, const GDScriptParser
 		gdfunc->_global_names_count = 0;
 	}
 
-#ifdef TOOLS_ENABLED
-	// Named globals
-	if (codegen.named_globals.size()) {
-		gdfunc->named_globals.resize(codegen.named_globals.size());
-		gdfunc->_named_globals_ptr = gdfunc->named_globals.ptr();
-		for (int i = 0; i < codegen.named_globals.size(); i++) {
-			gdfunc->named_globals.write[i] = codegen.named_globals[i];
-		}
-		gdfunc->_named_globals_count = gdfunc->named_globals.size();
+	if (codegen.validated_operators.size()) {
+		gdfunc->validated_operators = codegen.validated_operators;
+		gdfunc->_validated_operators_ptr = gdfunc->validated_operators.ptr();
+		gdfunc->_validated_operators_count = gdfunc->validated_operators.size();
+	}
+	if (codegen.validated_builtin_methods.size()) {
+		gdfunc->validated_builtin_methods = codegen.validated_builtin_methods;
+		gdfunc->_validated_builtin_methods_ptr = gdfunc->validated_builtin_methods.ptr();
+		gdfunc->_validated_builtin_methods_count = gdfunc->validated_builtin_methods.size();
+	}
+	if (codegen.method_bind_calls.size()) {
+		gdfunc->method_bind_calls = codegen.method_bind_calls;
+		gdfunc->_method_bind_calls_ptr = gdfunc->method_bind_calls.ptr();
+		gdfunc->_method_bind_calls_count = gdfunc->method_bind_calls.size();
 	}
-#endif
+
+	gdfunc->global_variable_names = codegen.global_variables;
+	gdfunc->_resolve_global_variables();
 
 	if (codegen.opcodes.size()) {
 
@@ -1763,6 +2014,7 @@ Error GDScriptCompiler::_parse_function(GDScript *p_script, const GDScriptParser
 	gdfunc->_argument_count = p_func ? p_func->arguments.size() : 0;
 	gdfunc->_stack_size = codegen.stack_max;
 	gdfunc->_call_size = codegen.call_max;
+	gdfunc->_has_yield = codegen.has_yield;
 	gdfunc->name = func_name;
 #ifdef DEBUG_ENABLED
 	if (EngineDebugger::is_active()) {
@@ -2189,5 +2441,12 @@ int GDScriptCompiler::get_error_column() const {
 	return err_column;
 }
 
+void GDScriptCompiler::set_debug_stack(bool p_enable) {
+
+	debug_stack = p_enable;
+}
+
 GDScriptCompiler::GDScriptCompiler() {
+
+	debug_stack = false;
 }
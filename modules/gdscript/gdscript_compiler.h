@@ -98,9 +98,8 @@ class GDScriptCompiler {
 
 		HashMap<Variant, int, VariantHasher, VariantComparator> constant_map;
 		Map<StringName, int> name_map;
-#ifdef TOOLS_ENABLED
-		Vector<StringName> named_globals;
-#endif
+		Vector<StringName> global_variables;
+		Map<StringName, int> global_variable_map;
 
 		int get_name_map_pos(const StringName &p_identifier) {
 			int ret;
@@ -113,6 +112,16 @@ class GDScriptCompiler {
 			return ret;
 		}
 
+		int get_global_variable_pos(const StringName &p_identifier) {
+			const Map<StringName, int>::Element *E = global_variable_map.find(p_identifier);
+			if (E)
+				return E->get();
+			int pos = global_variables.size();
+			global_variables.push_back(p_identifier);
+			global_variable_map[p_identifier] = pos;
+			return pos;
+		}
+
 		int get_constant_pos(const Variant &p_constant) {
 			if (constant_map.has(p_constant))
 				return constant_map[p_constant];
@@ -121,6 +130,26 @@ class GDScriptCompiler {
 			return pos;
 		}
 
+		Vector<GDScriptFunction::ValidatedOperator> validated_operators;
+		Map<uint32_t, int> validated_operator_map;
+		Vector<GDScriptFunction::ValidatedBuiltinMethod> validated_builtin_methods;
+		Vector<GDScriptFunction::MethodBindCall> method_bind_calls;
+
+		int get_validated_operator_pos(Variant::Operator p_op, Variant::Type p_type_a, Variant::Type p_type_b, Variant::ValidatedOperatorEvaluator p_evaluator) {
+			uint32_t key = uint32_t(p_op) | (uint32_t(p_type_a) << 8) | (uint32_t(p_type_b) << 16);
+			if (validated_operator_map.has(key))
+				return validated_operator_map[key];
+			GDScriptFunction::ValidatedOperator vop;
+			vop.evaluator = p_evaluator;
+			vop.op = p_op;
+			vop.type_a = p_type_a;
+			vop.type_b = p_type_b;
+			int pos = validated_operators.size();
+			validated_operators.push_back(vop);
+			validated_operator_map[key] = pos;
+			return pos;
+		}
+
 		Vector<int> opcodes;
 		void alloc_stack(int p_level) {
 			if (p_level >= stack_max) stack_max = p_level + 1;
@@ -129,9 +158,15 @@ class GDScriptCompiler {
 			if (p_params >= call_max) call_max = p_params;
 		}
 
+		// Positions of the last operator and member get, so the instruction
+		// consuming their result can be fused with them.
+		int last_operator_pos;
+		int last_get_member_pos;
+
 		int current_line;
 		int stack_max;
 		int call_max;
+		bool has_yield;
 	};
 
 	bool _is_class_member_property(CodeGen &codegen, const StringName &p_name);
@@ -139,6 +174,10 @@ class GDScriptCompiler {
 
 	void _set_error(const String &p_error, const GDScriptParser::Node *p_node);
 
+	bool _get_builtin_type(const GDScriptParser::Node *p_node, Variant::Type &r_type) const;
+	void _write_operator(CodeGen &codegen, Variant::Operator p_op, const GDScriptParser::Node *p_a, const GDScriptParser::Node *p_b, int p_address_a, int p_address_b);
+	bool _write_typed_call(CodeGen &codegen, const GDScriptParser::OperatorNode *p_call, const Vector<int> &p_arguments);
+	int _write_jump_if_not(CodeGen &codegen, int p_condition);
 	bool _create_unary_operator(CodeGen &codegen, const GDScriptParser::OperatorNode *on, Variant::Operator op, int p_stack_level);
 	bool _create_binary_operator(CodeGen &codegen, const GDScriptParser::OperatorNode *on, Variant::Operator op, int p_stack_level, bool p_initializer = false, int p_index_addr = 0);
 
@@ -155,10 +194,14 @@ class GDScriptCompiler {
 	int err_column;
 	StringName source;
 	String error;
+	bool debug_stack;
 
 public:
 	Error compile(const GDScriptParser *p_parser, GDScript *p_script, bool p_keep_state = false);
 
+	// Keeps the stack debug info even when no debugger is active.
+	void set_debug_stack(bool p_enable);
+
 	String get_error() const;
 	int get_error_line() const;
 	int get_error_column() const;
@@ -31,8 +31,10 @@
 #include "gdscript_function.h"
 
 #include "core/os/os.h"
+#include "core/variant_internal.h"
 #include "gdscript.h"
 #include "gdscript_functions.h"
+#include "gdscript_sampling_profiler.h"
 
 Variant *GDScriptFunction::_get_variant(int p_address, GDScriptInstance *p_instance, GDScript *p_script, Variant &self, Variant &static_ref, Variant *p_stack, String &r_error) const {
 
@@ -103,25 +105,23 @@ Variant *GDScriptFunction::_get_variant(int p_address, GDScriptInstance *p_insta
 		} break;
 		case ADDR_TYPE_GLOBAL: {
 #ifdef DEBUG_ENABLED
-			ERR_FAIL_INDEX_V(address, GDScriptLanguage::get_singleton()->get_global_array_size(), nullptr);
+			ERR_FAIL_INDEX_V(address, _global_variables_count, nullptr);
 #endif
-			return &GDScriptLanguage::get_singleton()->get_global_array()[address];
-		} break;
+			int index = _global_variables_ptr[address];
 #ifdef TOOLS_ENABLED
-		case ADDR_TYPE_NAMED_GLOBAL: {
-#ifdef DEBUG_ENABLED
-			ERR_FAIL_INDEX_V(address, _named_globals_count, nullptr);
-#endif
-			StringName id = _named_globals_ptr[address];
-
-			if (GDScriptLanguage::get_singleton()->get_named_globals_map().has(id)) {
-				return (Variant *)&GDScriptLanguage::get_singleton()->get_named_globals_map()[id];
-			} else {
-				r_error = "Autoload singleton '" + String(id) + "' has been removed.";
-				return nullptr;
+			if (unlikely(index < 0)) {
+				const StringName &id = global_variable_names[address];
+				const Map<StringName, Variant>::Element *E = GDScriptLanguage::get_singleton()->get_named_globals_map().find(id);
+				if (E) {
+					return (Variant *)&E->get();
+				} else {
+					r_error = "Autoload singleton '" + String(id) + "' has been removed.";
+					return nullptr;
+				}
 			}
-		} break;
 #endif
+			return &GDScriptLanguage::get_singleton()->get_global_array()[index];
+		} break;
 		case ADDR_TYPE_NIL: {
 			return &nil;
 		} break;
@@ -190,49 +190,270 @@ String GDScriptFunction::_get_call_error(const Callable::CallError &p_err, const
 	return err_text;
 }
 
+bool GDScriptFunction::_evaluate_operator(Variant::Operator p_op, const Variant *p_a, const Variant *p_b, Variant *r_dst, String &r_error) const {
+
+	bool valid;
+#ifdef DEBUG_ENABLED
+
+	//allow better error message in cases where src and dst are the same stack position
+	Variant ret;
+	Variant::evaluate(p_op, *p_a, *p_b, ret, valid);
+	if (!valid) {
+
+		if (ret.get_type() == Variant::STRING) {
+			//return a string when invalid with the error
+			r_error = ret;
+			r_error += " in operator '" + Variant::get_operator_name(p_op) + "'.";
+		} else {
+			r_error = "Invalid operands '" + Variant::get_type_name(p_a->get_type()) + "' and '" + Variant::get_type_name(p_b->get_type()) + "' in operator '" + Variant::get_operator_name(p_op) + "'.";
+		}
+		return false;
+	}
+	*r_dst = ret;
+#else
+	Variant::evaluate(p_op, *p_a, *p_b, *r_dst, valid);
+#endif
+	return true;
+}
+
+// Fast paths of Variant::get() and Variant::set() for arrays indexed with an int,
+// used by the typed indexing instructions. They return false when the generic
+// path must be taken instead, which also reports errors.
+
+template <class T, class E>
+static _FORCE_INLINE_ bool _get_indexed_packed(const Variant *p_base, int64_t p_index, Variant *r_dst) {
+
+	const T &array = VariantInternalAccessor<T>::get(p_base);
+	int64_t size = array.size();
+	if (p_index < 0) {
+		p_index += size;
+	}
+	if (unlikely(p_index < 0 || p_index >= size)) {
+		return false;
+	}
+	// Copy first, r_dst may be the array itself.
+	E value = array[p_index];
+	VariantInternalAccessor<E>::set(r_dst, value);
+	return true;
+}
+
+template <class T, class E>
+static _FORCE_INLINE_ bool _set_indexed_packed(Variant *p_base, int64_t p_index, const Variant *p_value) {
+
+	if (unlikely(p_value->get_type() != VariantInternalAccessor<E>::TYPE)) {
+		return false;
+	}
+	T *array = VariantInternalAccessor<T>::get_ptr(p_base);
+	int64_t size = array->size();
+	if (p_index < 0) {
+		p_index += size;
+	}
+	if (unlikely(p_index < 0 || p_index >= size)) {
+		return false;
+	}
+	array->set(p_index, VariantInternalAccessor<E>::get(p_value));
+	return true;
+}
+
+static _FORCE_INLINE_ bool _get_indexed_validated(const Variant *p_base, const Variant *p_index, Variant *r_dst) {
+
+	if (unlikely(p_index->get_type() != Variant::INT)) {
+		return false;
+	}
+	int64_t index = VariantInternalAccessor<int64_t>::get(p_index);
+
+	switch (p_base->get_type()) {
+		case Variant::ARRAY: {
+			const Array &array = VariantInternalAccessor<Array>::get(p_base);
+			int64_t size = array.size();
+			if (index < 0) {
+				index += size;
+			}
+			if (unlikely(index < 0 || index >= size)) {
+				return false;
+			}
+			if (unlikely(r_dst == p_base)) {
+				Variant value = array[index];
+				*r_dst = value;
+			} else {
+				*r_dst = array[index];
+			}
+			return true;
+		}
+		case Variant::PACKED_BYTE_ARRAY:
+			return _get_indexed_packed<PackedByteArray, int64_t>(p_base, index, r_dst);
+		case Variant::PACKED_INT32_ARRAY:
+			return _get_indexed_packed<PackedInt32Array, int64_t>(p_base, index, r_dst);
+		case Variant::PACKED_INT64_ARRAY:
+			return _get_indexed_packed<PackedInt64Array, int64_t>(p_base, index, r_dst);
+		case Variant::PACKED_FLOAT32_ARRAY:
+			return _get_indexed_packed<PackedFloat32Array, double>(p_base, index, r_dst);
+		case Variant::PACKED_FLOAT64_ARRAY:
+			return _get_indexed_packed<PackedFloat64Array, double>(p_base, index, r_dst);
+		case Variant::PACKED_STRING_ARRAY:
+			return _get_indexed_packed<PackedStringArray, String>(p_base, index, r_dst);
+		case Variant::PACKED_VECTOR2_ARRAY:
+			return _get_indexed_packed<PackedVector2Array, Vector2>(p_base, index, r_dst);
+		case Variant::PACKED_VECTOR3_ARRAY:
+			return _get_indexed_packed<PackedVector3Array, Vector3>(p_base, index, r_dst);
+		case Variant::PACKED_COLOR_ARRAY:
+			return _get_indexed_packed<PackedColorArray, Color>(p_base, index, r_dst);
+		default:
+			return false;
+	}
+}
+
+template <class T>
+static _FORCE_INLINE_ bool _compare_values(Variant::Operator p_op, T p_a, T p_b, bool &r_result) {
+
+	switch (p_op) {
+		case Variant::OP_EQUAL: {
+			r_result = p_a == p_b;
+		} break;
+		case Variant::OP_NOT_EQUAL: {
+			r_result = p_a != p_b;
+		} break;
+		case Variant::OP_LESS: {
+			r_result = p_a < p_b;
+		} break;
+		case Variant::OP_LESS_EQUAL: {
+			r_result = p_a <= p_b;
+		} break;
+		case Variant::OP_GREATER: {
+			r_result = p_a > p_b;
+		} break;
+		case Variant::OP_GREATER_EQUAL: {
+			r_result = p_a >= p_b;
+		} break;
+		default: {
+			return false;
+		}
+	}
+	return true;
+}
+
+static _FORCE_INLINE_ bool _set_indexed_validated(Variant *p_base, const Variant *p_index, const Variant *p_value) {
+
+	if (unlikely(p_index->get_type() != Variant::INT)) {
+		return false;
+	}
+	int64_t index = VariantInternalAccessor<int64_t>::get(p_index);
+
+	switch (p_base->get_type()) {
+		case Variant::ARRAY: {
+			Array *array = VariantInternalAccessor<Array>::get_ptr(p_base);
+			int64_t size = array->size();
+			if (index < 0) {
+				index += size;
+			}
+			if (unlikely(index < 0 || index >= size)) {
+				return false;
+			}
+			(*array)[index] = *p_value;
+			return true;
+		}
+		case Variant::PACKED_BYTE_ARRAY:
+			return _set_indexed_packed<PackedByteArray, int64_t>(p_base, index, p_value);
+		case Variant::PACKED_INT32_ARRAY:
+			return _set_indexed_packed<PackedInt32Array, int64_t>(p_base, index, p_value);
+		case Variant::PACKED_INT64_ARRAY:
+			return _set_indexed_packed<PackedInt64Array, int64_t>(p_base, index, p_value);
+		case Variant::PACKED_FLOAT32_ARRAY:
+			return _set_indexed_packed<PackedFloat32Array, double>(p_base, index, p_value);
+		case Variant::PACKED_FLOAT64_ARRAY:
+			return _set_indexed_packed<PackedFloat64Array, double>(p_base, index, p_value);
+		case Variant::PACKED_STRING_ARRAY:
+			return _set_indexed_packed<PackedStringArray, String>(p_base, index, p_value);
+		case Variant::PACKED_VECTOR2_ARRAY:
+			return _set_indexed_packed<PackedVector2Array, Vector2>(p_base, index, p_value);
+		case Variant::PACKED_VECTOR3_ARRAY:
+			return _set_indexed_packed<PackedVector3Array, Vector3>(p_base, index, p_value);
+		case Variant::PACKED_COLOR_ARRAY:
+			return _set_indexed_packed<PackedColorArray, Color>(p_base, index, p_value);
+		default:
+			return false;
+	}
+}
+
+// Whether writing the result of a call to p_ret would clobber its base or an
+// argument before the callee reads them.
+static _FORCE_INLINE_ bool _is_call_result_aliased(const Variant *p_ret, const Variant *p_base, Variant **p_args, int p_argcount) {
+
+	if (p_ret == p_base) {
+		return true;
+	}
+	for (int i = 0; i < p_argcount; i++) {
+		if (p_args[i] == p_ret) {
+			return true;
+		}
+	}
+	return false;
+}
+
+#ifdef DEBUG_ENABLED
+// Checked before every dispatch, sampler is null unless the sampling profiler
+// was running when the function was called.
+#define OPCODE_SAMPLE                                        \
+	if (unlikely(sampler && sampler->is_sample_pending())) { \
+		sampler->sample(_code_ptr[ip]);                      \
+	}
+#else
+#define OPCODE_SAMPLE
+#endif
+
 #if defined(__GNUC__)
-#define OPCODES_TABLE                         \
-	static const void *switch_table_ops[] = { \
-		&&OPCODE_OPERATOR,                    \
-		&&OPCODE_EXTENDS_TEST,                \
-		&&OPCODE_IS_BUILTIN,                  \
-		&&OPCODE_SET,                         \
-		&&OPCODE_GET,                         \
-		&&OPCODE_SET_NAMED,                   \
-		&&OPCODE_GET_NAMED,                   \
-		&&OPCODE_SET_MEMBER,                  \
-		&&OPCODE_GET_MEMBER,                  \
-		&&OPCODE_ASSIGN,                      \
-		&&OPCODE_ASSIGN_TRUE,                 \
-		&&OPCODE_ASSIGN_FALSE,                \
-		&&OPCODE_ASSIGN_TYPED_BUILTIN,        \
-		&&OPCODE_ASSIGN_TYPED_NATIVE,         \
-		&&OPCODE_ASSIGN_TYPED_SCRIPT,         \
-		&&OPCODE_CAST_TO_BUILTIN,             \
-		&&OPCODE_CAST_TO_NATIVE,              \
-		&&OPCODE_CAST_TO_SCRIPT,              \
-		&&OPCODE_CONSTRUCT,                   \
-		&&OPCODE_CONSTRUCT_ARRAY,             \
-		&&OPCODE_CONSTRUCT_DICTIONARY,        \
-		&&OPCODE_CALL,                        \
-		&&OPCODE_CALL_RETURN,                 \
-		&&OPCODE_CALL_BUILT_IN,               \
-		&&OPCODE_CALL_SELF,                   \
-		&&OPCODE_CALL_SELF_BASE,              \
-		&&OPCODE_YIELD,                       \
-		&&OPCODE_YIELD_SIGNAL,                \
-		&&OPCODE_YIELD_RESUME,                \
-		&&OPCODE_JUMP,                        \
-		&&OPCODE_JUMP_IF,                     \
-		&&OPCODE_JUMP_IF_NOT,                 \
-		&&OPCODE_JUMP_TO_DEF_ARGUMENT,        \
-		&&OPCODE_RETURN,                      \
-		&&OPCODE_ITERATE_BEGIN,               \
-		&&OPCODE_ITERATE,                     \
-		&&OPCODE_ASSERT,                      \
-		&&OPCODE_BREAKPOINT,                  \
-		&&OPCODE_LINE,                        \
-		&&OPCODE_END                          \
+#define OPCODES_TABLE                           \
+	static const void *switch_table_ops[] = {   \
+		&&OPCODE_OPERATOR,                      \
+		&&OPCODE_OPERATOR_VALIDATED,            \
+		&&OPCODE_OPERATOR_INT,                  \
+		&&OPCODE_OPERATOR_FLOAT,                \
+		&&OPCODE_INCREMENT_INT,                 \
+		&&OPCODE_EXTENDS_TEST,                  \
+		&&OPCODE_IS_BUILTIN,                    \
+		&&OPCODE_SET_INDEXED_VALIDATED,         \
+		&&OPCODE_SET,                           \
+		&&OPCODE_GET_INDEXED_VALIDATED,         \
+		&&OPCODE_GET,                           \
+		&&OPCODE_SET_NAMED,                     \
+		&&OPCODE_GET_NAMED,                     \
+		&&OPCODE_SET_MEMBER,                    \
+		&&OPCODE_GET_MEMBER,                    \
+		&&OPCODE_ASSIGN,                        \
+		&&OPCODE_ASSIGN_TRUE,                   \
+		&&OPCODE_ASSIGN_FALSE,                  \
+		&&OPCODE_ASSIGN_TYPED_BUILTIN,          \
+		&&OPCODE_ASSIGN_TYPED_NATIVE,           \
+		&&OPCODE_ASSIGN_TYPED_SCRIPT,           \
+		&&OPCODE_CAST_TO_BUILTIN,               \
+		&&OPCODE_CAST_TO_NATIVE,                \
+		&&OPCODE_CAST_TO_SCRIPT,                \
+		&&OPCODE_CONSTRUCT,                     \
+		&&OPCODE_CONSTRUCT_ARRAY,               \
+		&&OPCODE_CONSTRUCT_DICTIONARY,          \
+		&&OPCODE_GET_MEMBER_CALL,               \
+		&&OPCODE_CALL,                          \
+		&&OPCODE_CALL_RETURN,                   \
+		&&OPCODE_CALL_BUILTIN_METHOD_VALIDATED, \
+		&&OPCODE_CALL_METHOD_BIND,              \
+		&&OPCODE_CALL_BUILT_IN,                 \
+		&&OPCODE_CALL_SELF,                     \
+		&&OPCODE_CALL_SELF_BASE,                \
+		&&OPCODE_YIELD,                         \
+		&&OPCODE_YIELD_SIGNAL,                  \
+		&&OPCODE_YIELD_RESUME,                  \
+		&&OPCODE_JUMP,                          \
+		&&OPCODE_JUMP_IF,                       \
+		&&OPCODE_JUMP_IF_NOT,                   \
+		&&OPCODE_JUMP_IF_NOT_COMPARE,           \
+		&&OPCODE_JUMP_TO_DEF_ARGUMENT,          \
+		&&OPCODE_RETURN,                        \
+		&&OPCODE_ITERATE_BEGIN,                 \
+		&&OPCODE_ITERATE,                       \
+		&&OPCODE_ASSERT,                        \
+		&&OPCODE_BREAKPOINT,                    \
+		&&OPCODE_LINE,                          \
+		&&OPCODE_END                            \
 	};
 
 #define OPCODE(m_op) \
@@ -242,20 +463,26 @@ String GDScriptFunction::_get_call_error(const Callable::CallError &p_err, const
 	OPSEXIT:
 #define OPCODES_OUT \
 	OPSOUT:
-#define DISPATCH_OPCODE goto *switch_table_ops[_code_ptr[ip]]
+#define DISPATCH_OPCODE \
+	OPCODE_SAMPLE       \
+	goto *switch_table_ops[_code_ptr[ip]]
 #define OPCODE_SWITCH(m_test) DISPATCH_OPCODE;
 #define OPCODE_BREAK goto OPSEXIT
 #define OPCODE_OUT goto OPSOUT
+#define OPCODE_FALLTHROUGH
 #else
 #define OPCODES_TABLE
 #define OPCODE(m_op) case m_op:
 #define OPCODE_WHILE(m_test) while (m_test)
 #define OPCODES_END
 #define OPCODES_OUT
-#define DISPATCH_OPCODE continue
+#define DISPATCH_OPCODE \
+	OPCODE_SAMPLE       \
+	continue
 #define OPCODE_SWITCH(m_test) switch (m_test)
 #define OPCODE_BREAK break
 #define OPCODE_OUT break
+#define OPCODE_FALLTHROUGH [[fallthrough]]
 #endif
 
 Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_args, int p_argcount, Callable::CallError &r_err, CallState *p_state) {
@@ -283,17 +510,19 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 #endif
 
 	uint32_t alloca_size = 0;
+	uint8_t *frame = nullptr; // Pooled frame owned by this call, until it yields.
+	bool yielded = false;
 	GDScript *script;
 	int ip = 0;
 	int line = _initial_line;
 
 	if (p_state) {
-		//use existing (supplied) state (yielded)
-		stack = (Variant *)p_state->stack.ptr();
-		call_args = (Variant **)&p_state->stack.ptr()[sizeof(Variant) * p_state->stack_size]; //ptr() to avoid bounds check
+		//use existing (supplied) state (yielded), which keeps the frame
+		stack = (Variant *)p_state->frame;
+		call_args = (Variant **)&p_state->frame[sizeof(Variant) * p_state->stack_size];
 		line = p_state->line;
 		ip = p_state->ip;
-		alloca_size = p_state->stack.size();
+		alloca_size = p_state->alloca_size;
 		script = p_state->script.ptr();
 		p_instance = p_state->instance;
 		defarg = p_state->defarg;
@@ -325,7 +554,13 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 
 		if (alloca_size) {
 
-			uint8_t *aptr = (uint8_t *)alloca(alloca_size);
+			uint8_t *aptr;
+			if (_has_yield) {
+				frame = GDScriptFramePool::alloc(alloca_size);
+				aptr = frame;
+			} else {
+				aptr = (uint8_t *)alloca(alloca_size);
+			}
 
 			if (_stack_size) {
 
@@ -340,6 +575,12 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 						r_err.error = Callable::CallError::CALL_ERROR_INVALID_ARGUMENT;
 						r_err.argument = i;
 						r_err.expected = argument_types[i].kind == GDScriptDataType::BUILTIN ? argument_types[i].builtin_type : Variant::OBJECT;
+						for (int j = 0; j < i; j++) {
+							stack[j].~Variant();
+						}
+						if (frame) {
+							GDScriptFramePool::free(frame, alloca_size);
+						}
 						return Variant();
 					}
 					if (argument_types[i].kind == GDScriptDataType::BUILTIN) {
@@ -400,18 +641,35 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 #define CHECK_SPACE(m_space) \
 	GD_ERR_BREAK((ip + m_space) > _code_size)
 
-#define GET_VARIANT_PTR(m_v, m_code_ofs)                                                                   \
-	Variant *m_v;                                                                                          \
-	m_v = _get_variant(_code_ptr[ip + m_code_ofs], p_instance, script, self, static_ref, stack, err_text); \
-	if (unlikely(!m_v))                                                                                    \
-		OPCODE_BREAK;
+#define GET_VARIANT_PTR(m_v, m_code_ofs)                                                                              \
+	Variant *m_v;                                                                                                     \
+	{                                                                                                                 \
+		int address = _code_ptr[ip + m_code_ofs];                                                                     \
+		uint32_t address_type = uint32_t(address) >> ADDR_BITS;                                                       \
+		int address_index = address & ADDR_MASK;                                                                      \
+		if (likely(address_type < ADDR_TYPE_MAX && address_index < variant_address_sizes[address_type])) {           \
+			m_v = &variant_addresses[address_type][address_index];                                                    \
+		} else {                                                                                                      \
+			m_v = _get_variant(address, p_instance, script, self, static_ref, stack, err_text);                       \
+			if (unlikely(!m_v))                                                                                       \
+				OPCODE_BREAK;                                                                                         \
+		}                                                                                                             \
+	}
 
 #else
 #define GD_ERR_BREAK(m_cond)
 #define CHECK_SPACE(m_space)
-#define GET_VARIANT_PTR(m_v, m_code_ofs) \
-	Variant *m_v;                        \
-	m_v = _get_variant(_code_ptr[ip + m_code_ofs], p_instance, script, self, static_ref, stack, err_text);
+#define GET_VARIANT_PTR(m_v, m_code_ofs)                                                               \
+	Variant *m_v;                                                                                      \
+	{                                                                                                  \
+		int address = _code_ptr[ip + m_code_ofs];                                                      \
+		Variant *address_base = variant_addresses[uint32_t(address) >> ADDR_BITS];                     \
+		if (likely(address_base)) {                                                                    \
+			m_v = &address_base[address & ADDR_MASK];                                                  \
+		} else {                                                                                       \
+			m_v = _get_variant(address, p_instance, script, self, static_ref, stack, err_text);        \
+		}                                                                                              \
+	}
 
 #endif
 
@@ -427,7 +685,35 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 		profile.frame_call_count++;
 	}
 	bool exit_ok = false;
-	bool yielded = false;
+
+	GDScriptSamplingProfiler::ThreadState *sampler = GDScriptSamplingProfiler::is_running() ? GDScriptSamplingProfiler::get_thread_state() : nullptr;
+	if (sampler) {
+		sampler->enter(this, &line);
+	}
+#endif
+
+	// Operand addresses are decoded with a table lookup. Types whose location can
+	// change while the function runs, or that need a name lookup, are left out
+	// and go through _get_variant().
+	Variant *variant_addresses[ADDR_TYPE_MAX] = {};
+	variant_addresses[ADDR_TYPE_SELF] = &self;
+	variant_addresses[ADDR_TYPE_CLASS] = &static_ref;
+	variant_addresses[ADDR_TYPE_MEMBER] = p_instance ? p_instance->members.ptrw() : nullptr;
+	variant_addresses[ADDR_TYPE_LOCAL_CONSTANT] = _constants_ptr;
+	variant_addresses[ADDR_TYPE_STACK] = stack;
+	variant_addresses[ADDR_TYPE_STACK_VARIABLE] = stack;
+	variant_addresses[ADDR_TYPE_NIL] = &nil;
+
+#ifdef DEBUG_ENABLED
+	// Out of range addresses also go through _get_variant(), which reports the error.
+	int variant_address_sizes[ADDR_TYPE_MAX] = {};
+	variant_address_sizes[ADDR_TYPE_SELF] = p_instance ? 1 : 0;
+	variant_address_sizes[ADDR_TYPE_CLASS] = 1;
+	variant_address_sizes[ADDR_TYPE_MEMBER] = p_instance ? p_instance->members.size() : 0;
+	variant_address_sizes[ADDR_TYPE_LOCAL_CONSTANT] = _constant_count;
+	variant_address_sizes[ADDR_TYPE_STACK] = _stack_size;
+	variant_address_sizes[ADDR_TYPE_STACK_VARIABLE] = _stack_size;
+	variant_address_sizes[ADDR_TYPE_NIL] = 1;
 #endif
 
 #ifdef DEBUG_ENABLED
@@ -443,7 +729,6 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 
 				CHECK_SPACE(5);
 
-				bool valid;
 				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
 				GD_ERR_BREAK(op >= Variant::OP_MAX);
 
@@ -451,31 +736,206 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				GET_VARIANT_PTR(b, 3);
 				GET_VARIANT_PTR(dst, 4);
 
-#ifdef DEBUG_ENABLED
+				Variant::ValidatedOperatorEvaluator evaluator = Variant::get_validated_operator_evaluator(op, a->get_type(), b->get_type());
+				if (evaluator) {
+					// Operand types are known to be valid for this operator, skip the generic dispatch.
+					evaluator(a, b, dst);
+					ip += 5;
+					DISPATCH_OPCODE;
+				}
 
-				Variant ret;
-				Variant::evaluate(op, *a, *b, ret, valid);
-#else
-				Variant::evaluate(op, *a, *b, *dst, valid);
-#endif
-#ifdef DEBUG_ENABLED
-				if (!valid) {
+				if (!_evaluate_operator(op, a, b, dst, err_text)) {
+					OPCODE_BREAK;
+				}
+				ip += 5;
+			}
+			DISPATCH_OPCODE;
 
-					if (ret.get_type() == Variant::STRING) {
-						//return a string when invalid with the error
-						err_text = ret;
-						err_text += " in operator '" + Variant::get_operator_name(op) + "'.";
-					} else {
-						err_text = "Invalid operands '" + Variant::get_type_name(a->get_type()) + "' and '" + Variant::get_type_name(b->get_type()) + "' in operator '" + Variant::get_operator_name(op) + "'.";
+			OPCODE(OPCODE_OPERATOR_VALIDATED) {
+
+				CHECK_SPACE(5);
+
+				int op_idx = _code_ptr[ip + 1];
+				GD_ERR_BREAK(op_idx < 0 || op_idx >= _validated_operators_count);
+				const ValidatedOperator &vop = _validated_operators_ptr[op_idx];
+
+				GET_VARIANT_PTR(a, 2);
+				GET_VARIANT_PTR(b, 3);
+				GET_VARIANT_PTR(dst, 4);
+
+				if (likely(a->get_type() == vop.type_a && b->get_type() == vop.type_b)) {
+					vop.evaluator(a, b, dst);
+				} else if (!_evaluate_operator(vop.op, a, b, dst, err_text)) {
+					OPCODE_BREAK;
+				}
+				ip += 5;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_OPERATOR_INT) {
+
+				CHECK_SPACE(5);
+
+				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
+				GD_ERR_BREAK(op >= Variant::OP_MAX);
+
+				GET_VARIANT_PTR(a, 2);
+				GET_VARIANT_PTR(b, 3);
+				GET_VARIANT_PTR(dst, 4);
+
+				bool done = false;
+				if (likely(a->get_type() == Variant::INT && b->get_type() == Variant::INT)) {
+					int64_t va = VariantInternalAccessor<int64_t>::get(a);
+					int64_t vb = VariantInternalAccessor<int64_t>::get(b);
+					done = true;
+					switch (op) {
+						case Variant::OP_ADD: {
+							VariantInternalAccessor<int64_t>::set(dst, va + vb);
+						} break;
+						case Variant::OP_SUBTRACT: {
+							VariantInternalAccessor<int64_t>::set(dst, va - vb);
+						} break;
+						case Variant::OP_MULTIPLY: {
+							VariantInternalAccessor<int64_t>::set(dst, va * vb);
+						} break;
+						case Variant::OP_DIVIDE: {
+							// Division by zero is reported by the generic path.
+							done = vb != 0;
+							if (done) {
+								VariantInternalAccessor<int64_t>::set(dst, va / vb);
+							}
+						} break;
+						case Variant::OP_MODULE: {
+							done = vb != 0;
+							if (done) {
+								VariantInternalAccessor<int64_t>::set(dst, va % vb);
+							}
+						} break;
+						case Variant::OP_NEGATE: {
+							VariantInternalAccessor<int64_t>::set(dst, -va);
+						} break;
+						case Variant::OP_BIT_AND: {
+							VariantInternalAccessor<int64_t>::set(dst, va & vb);
+						} break;
+						case Variant::OP_BIT_OR: {
+							VariantInternalAccessor<int64_t>::set(dst, va | vb);
+						} break;
+						case Variant::OP_BIT_XOR: {
+							VariantInternalAccessor<int64_t>::set(dst, va ^ vb);
+						} break;
+						case Variant::OP_EQUAL: {
+							VariantInternalAccessor<bool>::set(dst, va == vb);
+						} break;
+						case Variant::OP_NOT_EQUAL: {
+							VariantInternalAccessor<bool>::set(dst, va != vb);
+						} break;
+						case Variant::OP_LESS: {
+							VariantInternalAccessor<bool>::set(dst, va < vb);
+						} break;
+						case Variant::OP_LESS_EQUAL: {
+							VariantInternalAccessor<bool>::set(dst, va <= vb);
+						} break;
+						case Variant::OP_GREATER: {
+							VariantInternalAccessor<bool>::set(dst, va > vb);
+						} break;
+						case Variant::OP_GREATER_EQUAL: {
+							VariantInternalAccessor<bool>::set(dst, va >= vb);
+						} break;
+						default: {
+							done = false;
+						} break;
 					}
+				}
+
+				if (!done && !_evaluate_operator(op, a, b, dst, err_text)) {
+					OPCODE_BREAK;
+				}
+				ip += 5;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_OPERATOR_FLOAT) {
+
+				CHECK_SPACE(5);
+
+				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
+				GD_ERR_BREAK(op >= Variant::OP_MAX);
+
+				GET_VARIANT_PTR(a, 2);
+				GET_VARIANT_PTR(b, 3);
+				GET_VARIANT_PTR(dst, 4);
+
+				bool done = false;
+				if (likely(a->get_type() == Variant::FLOAT && b->get_type() == Variant::FLOAT)) {
+					double va = VariantInternalAccessor<double>::get(a);
+					double vb = VariantInternalAccessor<double>::get(b);
+					done = true;
+					switch (op) {
+						case Variant::OP_ADD: {
+							VariantInternalAccessor<double>::set(dst, va + vb);
+						} break;
+						case Variant::OP_SUBTRACT: {
+							VariantInternalAccessor<double>::set(dst, va - vb);
+						} break;
+						case Variant::OP_MULTIPLY: {
+							VariantInternalAccessor<double>::set(dst, va * vb);
+						} break;
+						case Variant::OP_DIVIDE: {
+							done = vb != 0;
+							if (done) {
+								VariantInternalAccessor<double>::set(dst, va / vb);
+							}
+						} break;
+						case Variant::OP_NEGATE: {
+							VariantInternalAccessor<double>::set(dst, -va);
+						} break;
+						case Variant::OP_EQUAL: {
+							VariantInternalAccessor<bool>::set(dst, va == vb);
+						} break;
+						case Variant::OP_NOT_EQUAL: {
+							VariantInternalAccessor<bool>::set(dst, va != vb);
+						} break;
+						case Variant::OP_LESS: {
+							VariantInternalAccessor<bool>::set(dst, va < vb);
+						} break;
+						case Variant::OP_LESS_EQUAL: {
+							VariantInternalAccessor<bool>::set(dst, va <= vb);
+						} break;
+						case Variant::OP_GREATER: {
+							VariantInternalAccessor<bool>::set(dst, va > vb);
+						} break;
+						case Variant::OP_GREATER_EQUAL: {
+							VariantInternalAccessor<bool>::set(dst, va >= vb);
+						} break;
+						default: {
+							done = false;
+						} break;
+					}
+				}
+
+				if (!done && !_evaluate_operator(op, a, b, dst, err_text)) {
 					OPCODE_BREAK;
 				}
-				*dst = ret;
-#endif
 				ip += 5;
 			}
 			DISPATCH_OPCODE;
 
+			OPCODE(OPCODE_INCREMENT_INT) {
+
+				CHECK_SPACE(3);
+
+				GET_VARIANT_PTR(dst, 1);
+				GET_VARIANT_PTR(value, 2);
+
+				if (likely(dst->get_type() == Variant::INT && value->get_type() == Variant::INT)) {
+					VariantInternalAccessor<int64_t>::set(dst, VariantInternalAccessor<int64_t>::get(dst) + VariantInternalAccessor<int64_t>::get(value));
+				} else if (!_evaluate_operator(Variant::OP_ADD, dst, value, dst, err_text)) {
+					OPCODE_BREAK;
+				}
+				ip += 3;
+			}
+			DISPATCH_OPCODE;
+
 			OPCODE(OPCODE_EXTENDS_TEST) {
 
 				CHECK_SPACE(4);
@@ -573,6 +1033,22 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 			}
 			DISPATCH_OPCODE;
 
+			OPCODE(OPCODE_SET_INDEXED_VALIDATED) {
+
+				CHECK_SPACE(3);
+
+				GET_VARIANT_PTR(dst, 1);
+				GET_VARIANT_PTR(index, 2);
+				GET_VARIANT_PTR(value, 3);
+
+				if (likely(_set_indexed_validated(dst, index, value))) {
+					ip += 4;
+					DISPATCH_OPCODE;
+				}
+				// Same operands as OPCODE_SET, fall through to the generic path.
+			}
+			OPCODE_FALLTHROUGH;
+
 			OPCODE(OPCODE_SET) {
 
 				CHECK_SPACE(3);
@@ -600,6 +1076,22 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 			}
 			DISPATCH_OPCODE;
 
+			OPCODE(OPCODE_GET_INDEXED_VALIDATED) {
+
+				CHECK_SPACE(3);
+
+				GET_VARIANT_PTR(src, 1);
+				GET_VARIANT_PTR(index, 2);
+				GET_VARIANT_PTR(dst, 3);
+
+				if (likely(_get_indexed_validated(src, index, dst))) {
+					ip += 4;
+					DISPATCH_OPCODE;
+				}
+				// Same operands as OPCODE_GET, fall through to the generic path.
+			}
+			OPCODE_FALLTHROUGH;
+
 			OPCODE(OPCODE_GET) {
 
 				CHECK_SPACE(3);
@@ -1056,6 +1548,30 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 			}
 			DISPATCH_OPCODE;
 
+			OPCODE(OPCODE_GET_MEMBER_CALL) {
+
+				// Same as OPCODE_GET_MEMBER followed by a call on the property,
+				// which is encoded right after and runs without a dispatch.
+				CHECK_SPACE(7);
+				int indexname = _code_ptr[ip + 1];
+				GD_ERR_BREAK(indexname < 0 || indexname >= _global_names_count);
+				GD_ERR_BREAK(_code_ptr[ip + 2] != OPCODE_CALL && _code_ptr[ip + 2] != OPCODE_CALL_RETURN);
+				const StringName *index = &_global_names_ptr[indexname];
+				GET_VARIANT_PTR(dst, 4);
+
+#ifndef DEBUG_ENABLED
+				ClassDB::get_property(p_instance->owner, *index, *dst);
+#else
+				bool ok = ClassDB::get_property(p_instance->owner, *index, *dst);
+				if (!ok) {
+					err_text = "Internal error getting property: " + String(*index);
+					OPCODE_BREAK;
+				}
+#endif
+				ip += 2;
+			}
+			OPCODE_FALLTHROUGH;
+
 			OPCODE(OPCODE_CALL_RETURN)
 			OPCODE(OPCODE_CALL) {
 
@@ -1101,6 +1617,17 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 					function_call_time += OS::get_singleton()->get_ticks_usec() - call_time;
 				}
 
+				// A tick during the call is attributed to the native method. The
+				// base is not looked at if the call overwrote it with its result.
+				if (unlikely(sampler && sampler->is_sample_pending())) {
+					int opcode = call_ret ? OPCODE_CALL_RETURN : OPCODE_CALL;
+					if (call_ret && _code_ptr[ip + argc] == _code_ptr[ip - 2]) {
+						sampler->sample(opcode);
+					} else {
+						sampler->sample_call(opcode, GDScriptSamplingProfiler::get_call_owner(*base, *methodname), *methodname);
+					}
+				}
+
 				if (err.error != Callable::CallError::CALL_OK) {
 
 					String methodstr = *methodname;
@@ -1137,6 +1664,164 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 			}
 			DISPATCH_OPCODE;
 
+			OPCODE(OPCODE_CALL_BUILTIN_METHOD_VALIDATED) {
+
+				CHECK_SPACE(4);
+
+				int argc = _code_ptr[ip + 1];
+				GET_VARIANT_PTR(base, 2);
+				int method_idx = _code_ptr[ip + 3];
+
+				GD_ERR_BREAK(method_idx < 0 || method_idx >= _validated_builtin_methods_count);
+				const ValidatedBuiltinMethod &vbm = _validated_builtin_methods_ptr[method_idx];
+
+				GD_ERR_BREAK(argc < 0);
+				ip += 4;
+				CHECK_SPACE(argc + 1);
+				Variant **argptrs = call_args;
+
+				bool validated = base->get_type() == vbm.base_type && argc == vbm.argument_types.size();
+				for (int i = 0; i < argc; i++) {
+					GET_VARIANT_PTR(v, i);
+					argptrs[i] = v;
+					Variant::Type arg_type = vbm.argument_types[i];
+					validated = validated && (arg_type == Variant::NIL || arg_type == v->get_type());
+				}
+				GET_VARIANT_PTR(ret, argc);
+
+				Callable::CallError err;
+				err.error = Callable::CallError::CALL_OK;
+				if (likely(validated)) {
+					if (!vbm.has_return) {
+						vbm.method(*ret, *base, (const Variant **)argptrs);
+						*ret = Variant();
+					} else if (unlikely(_is_call_result_aliased(ret, base, argptrs, argc))) {
+						Variant result;
+						vbm.method(result, *base, (const Variant **)argptrs);
+						*ret = result;
+					} else {
+						vbm.method(*ret, *base, (const Variant **)argptrs);
+					}
+				} else {
+					base->call_ptr(vbm.name, (const Variant **)argptrs, argc, ret, err);
+				}
+
+#ifdef DEBUG_ENABLED
+				if (err.error != Callable::CallError::CALL_OK) {
+					err_text = _get_call_error(err, "function '" + String(vbm.name) + "' in base '" + _get_var_type(base) + "'", (const Variant **)argptrs);
+					OPCODE_BREAK;
+				}
+#endif
+				ip += argc + 1;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_CALL_METHOD_BIND) {
+
+				CHECK_SPACE(4);
+
+				int argc = _code_ptr[ip + 1];
+				GET_VARIANT_PTR(base, 2);
+				int call_idx = _code_ptr[ip + 3];
+
+				GD_ERR_BREAK(call_idx < 0 || call_idx >= _method_bind_calls_count);
+				const MethodBindCall &mbc = _method_bind_calls_ptr[call_idx];
+
+				GD_ERR_BREAK(argc < 0);
+				ip += 4;
+				CHECK_SPACE(argc + 1);
+				Variant **argptrs = call_args;
+
+				for (int i = 0; i < argc; i++) {
+					GET_VARIANT_PTR(v, i);
+					argptrs[i] = v;
+				}
+				GET_VARIANT_PTR(ret, argc);
+
+#ifdef DEBUG_ENABLED
+				uint64_t call_time = 0;
+
+				if (GDScriptLanguage::get_singleton()->profiling) {
+					call_time = OS::get_singleton()->get_ticks_usec();
+				}
+
+#endif
+				// The static type of the base may be wrong, and a script on the
+				// instance may override the method, both take the generic path.
+				Object *obj = base->get_type() == Variant::OBJECT ? base->get_validated_object() : nullptr;
+				bool direct = obj && obj->is_class_ptr(mbc.class_ptr);
+				if (direct) {
+					ScriptInstance *script_instance = obj->get_script_instance();
+					direct = !script_instance || !script_instance->has_method(mbc.name);
+				}
+
+				Callable::CallError err;
+				err.error = Callable::CallError::CALL_OK;
+				if (likely(direct)) {
+#ifdef PTRCALL_ENABLED
+					bool ptrcall = mbc.ptrcall;
+					for (int i = 0; ptrcall && i < argc; i++) {
+						Variant::Type arg_type = mbc.argument_types[i];
+						ptrcall = arg_type == Variant::NIL || arg_type == argptrs[i]->get_type();
+					}
+
+					if (ptrcall) {
+						bool aliased = _is_call_result_aliased(ret, base, argptrs, argc);
+						// Arguments are converted in place, call_args is not needed afterwards.
+						const void **ptrargs = (const void **)argptrs;
+						for (int i = 0; i < argc; i++) {
+							if (mbc.argument_types[i] != Variant::NIL) {
+								ptrargs[i] = VariantInternal::get_opaque_pointer(argptrs[i]);
+							}
+						}
+
+						if (!mbc.method->has_return()) {
+							mbc.method->ptrcall(obj, ptrargs, nullptr);
+							*ret = Variant();
+						} else if (mbc.return_type == Variant::NIL) {
+							Variant result;
+							mbc.method->ptrcall(obj, ptrargs, &result);
+							*ret = result;
+						} else if (unlikely(aliased)) {
+							Variant result;
+							VariantInternal::initialize(&result, mbc.return_type);
+							mbc.method->ptrcall(obj, ptrargs, VariantInternal::get_opaque_pointer(&result));
+							*ret = result;
+						} else {
+							VariantInternal::initialize(ret, mbc.return_type);
+							mbc.method->ptrcall(obj, ptrargs, VariantInternal::get_opaque_pointer(ret));
+						}
+					} else
+#endif
+					{
+						*ret = mbc.method->call(obj, (const Variant **)argptrs, argc, err);
+					}
+				} else {
+					base->call_ptr(mbc.name, (const Variant **)argptrs, argc, ret, err);
+				}
+
+#ifdef DEBUG_ENABLED
+				if (GDScriptLanguage::get_singleton()->profiling) {
+					function_call_time += OS::get_singleton()->get_ticks_usec() - call_time;
+				}
+
+				if (unlikely(sampler && sampler->is_sample_pending())) {
+					if (ret == base) {
+						sampler->sample(OPCODE_CALL_METHOD_BIND);
+					} else {
+						sampler->sample_call(OPCODE_CALL_METHOD_BIND, GDScriptSamplingProfiler::get_call_owner(*base, mbc.name), mbc.name);
+					}
+				}
+
+				if (err.error != Callable::CallError::CALL_OK) {
+					err_text = _get_call_error(err, "function '" + String(mbc.name) + "' in base '" + _get_var_type(base) + "'", (const Variant **)argptrs);
+					OPCODE_BREAK;
+				}
+#endif
+				ip += argc + 1;
+			}
+			DISPATCH_OPCODE;
+
 			OPCODE(OPCODE_CALL_BUILT_IN) {
 
 				CHECK_SPACE(4);
@@ -1161,6 +1846,10 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				GDScriptFunctions::call(func, (const Variant **)argptrs, argc, *dst, err);
 
 #ifdef DEBUG_ENABLED
+				if (unlikely(sampler && sampler->is_sample_pending())) {
+					sampler->sample_call(OPCODE_CALL_BUILT_IN, GDScriptSamplingProfiler::get_builtin_func_owner(), GDScriptSamplingProfiler::get_builtin_func_name(func));
+				}
+
 				if (err.error != Callable::CallError::CALL_OK) {
 
 					String methodstr = GDScriptFunctions::get_func_name(func);
@@ -1261,6 +1950,8 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 			OPCODE(OPCODE_YIELD)
 			OPCODE(OPCODE_YIELD_SIGNAL) {
 
+				GD_ERR_BREAK(alloca_size && !p_state && !frame); // Only functions known to yield can.
+
 				int ipofs = 1;
 				if (_code_ptr[ip] == OPCODE_YIELD_SIGNAL) {
 					CHECK_SPACE(4);
@@ -1272,11 +1963,7 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				Ref<GDScriptFunctionState> gdfs = memnew(GDScriptFunctionState);
 				gdfs->function = this;
 
-				gdfs->state.stack.resize(alloca_size);
-				//copy variant stack
-				for (int i = 0; i < _stack_size; i++) {
-					memnew_placement(&gdfs->state.stack.write[sizeof(Variant) * i], Variant(stack[i]));
-				}
+				// The frame is handed over once the yield can't fail anymore.
 				gdfs->state.stack_size = _stack_size;
 				gdfs->state.self = self;
 				gdfs->state.alloca_size = alloca_size;
@@ -1289,8 +1976,6 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				gdfs->state.instance = p_instance;
 				gdfs->function = this;
 
-				retvalue = gdfs;
-
 				if (_code_ptr[ip] == OPCODE_YIELD_SIGNAL) {
 					//do the oneshot connect
 					GET_VARIANT_PTR(argobj, 1);
@@ -1340,9 +2025,17 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 #endif
 				}
 
+				if (p_state) {
+					gdfs->state.frame = p_state->frame;
+					p_state->frame = nullptr;
+				} else {
+					gdfs->state.frame = frame;
+					frame = nullptr;
+				}
+				retvalue = gdfs;
+				yielded = true;
 #ifdef DEBUG_ENABLED
 				exit_ok = true;
-				yielded = true;
 #endif
 				OPCODE_BREAK;
 			}
@@ -1408,6 +2101,43 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 			}
 			DISPATCH_OPCODE;
 
+			OPCODE(OPCODE_JUMP_IF_NOT_COMPARE) {
+
+				CHECK_SPACE(5);
+
+				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
+				GD_ERR_BREAK(op >= Variant::OP_MAX);
+
+				GET_VARIANT_PTR(a, 2);
+				GET_VARIANT_PTR(b, 3);
+
+				bool result = false;
+				bool done = false;
+				Variant::Type type_a = a->get_type();
+				Variant::Type type_b = b->get_type();
+				if (type_a == Variant::INT && type_b == Variant::INT) {
+					done = _compare_values(op, VariantInternalAccessor<int64_t>::get(a), VariantInternalAccessor<int64_t>::get(b), result);
+				} else if (type_a == Variant::FLOAT && type_b == Variant::FLOAT) {
+					done = _compare_values(op, VariantInternalAccessor<double>::get(a), VariantInternalAccessor<double>::get(b), result);
+				}
+				if (!done) {
+					Variant ret;
+					if (!_evaluate_operator(op, a, b, &ret, err_text)) {
+						OPCODE_BREAK;
+					}
+					result = ret.booleanize();
+				}
+
+				if (!result) {
+					int to = _code_ptr[ip + 4];
+					GD_ERR_BREAK(to < 0 || to > _code_size);
+					ip = to;
+				} else {
+					ip += 5;
+				}
+			}
+			DISPATCH_OPCODE;
+
 			OPCODE(OPCODE_JUMP_TO_DEF_ARGUMENT) {
 
 				CHECK_SPACE(2);
@@ -1531,6 +2261,7 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				line = _code_ptr[ip + 1];
 				ip += 2;
 
+#ifdef DEBUG_ENABLED
 				if (EngineDebugger::is_active()) {
 					// line
 					bool do_break = false;
@@ -1552,6 +2283,7 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 
 					EngineDebugger::get_singleton()->line_poll();
 				}
+#endif
 			}
 			DISPATCH_OPCODE;
 
@@ -1603,6 +2335,10 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 
 	OPCODES_OUT
 #ifdef DEBUG_ENABLED
+	if (sampler) {
+		sampler->exit();
+	}
+
 	if (GDScriptLanguage::get_singleton()->profiling) {
 		uint64_t time_taken = OS::get_singleton()->get_ticks_usec() - function_start_time;
 		profile.total_time += time_taken;
@@ -1619,17 +2355,23 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 	if (!p_state || yielded) {
 		if (EngineDebugger::is_active())
 			GDScriptLanguage::get_singleton()->exit_function();
+	}
 #endif
 
+	// A yielded frame now belongs to its GDScriptFunctionState, and the frame
+	// of a resumed call is released by the state it was resumed from.
+	if (!p_state && !yielded) {
+
 		if (_stack_size) {
 			//free stack
 			for (int i = 0; i < _stack_size; i++)
 				stack[i].~Variant();
 		}
 
-#ifdef DEBUG_ENABLED
+		if (frame) {
+			GDScriptFramePool::free(frame, alloca_size);
+		}
 	}
-#endif
 
 	return retvalue;
 }
@@ -1655,6 +2397,55 @@ StringName GDScriptFunction::get_global_name(int p_idx) const {
 	return global_names[p_idx];
 }
 
+StringName GDScriptFunction::get_global_variable_name(int p_idx) const {
+
+	ERR_FAIL_INDEX_V(p_idx, global_variable_names.size(), "<errgname>");
+	return global_variable_names[p_idx];
+}
+
+bool GDScriptFunction::_resolve_global_variables() {
+
+	const Map<StringName, int> &global_map = GDScriptLanguage::get_singleton()->get_global_map();
+	bool resolved = true;
+
+	global_variable_indices.resize(global_variable_names.size());
+	for (int i = 0; i < global_variable_names.size(); i++) {
+		const Map<StringName, int>::Element *E = global_map.find(global_variable_names[i]);
+		if (E) {
+			global_variable_indices.write[i] = E->get();
+		} else {
+#ifdef TOOLS_ENABLED
+			resolved = resolved && GDScriptLanguage::get_singleton()->get_named_globals_map().has(global_variable_names[i]);
+#else
+			resolved = false;
+#endif
+			global_variable_indices.write[i] = -1;
+		}
+	}
+
+	_global_variables_ptr = global_variable_indices.ptr();
+	_global_variables_count = global_variable_indices.size();
+	return resolved;
+}
+
+const GDScriptFunction::ValidatedOperator &GDScriptFunction::get_validated_operator(int p_idx) const {
+
+	CRASH_BAD_INDEX(p_idx, validated_operators.size());
+	return validated_operators[p_idx];
+}
+
+const GDScriptFunction::ValidatedBuiltinMethod &GDScriptFunction::get_validated_builtin_method(int p_idx) const {
+
+	CRASH_BAD_INDEX(p_idx, validated_builtin_methods.size());
+	return validated_builtin_methods[p_idx];
+}
+
+const GDScriptFunction::MethodBindCall &GDScriptFunction::get_method_bind_call(int p_idx) const {
+
+	CRASH_BAD_INDEX(p_idx, method_bind_calls.size());
+	return method_bind_calls[p_idx];
+}
+
 int GDScriptFunction::get_default_argument_count() const {
 
 	return _default_arg_count;
@@ -1759,6 +2550,15 @@ GDScriptFunction::GDScriptFunction() :
 
 	_stack_size = 0;
 	_call_size = 0;
+	_has_yield = false;
+	_validated_operators_ptr = nullptr;
+	_validated_operators_count = 0;
+	_validated_builtin_methods_ptr = nullptr;
+	_validated_builtin_methods_count = 0;
+	_method_bind_calls_ptr = nullptr;
+	_method_bind_calls_count = 0;
+	_global_variables_ptr = nullptr;
+	_global_variables_count = 0;
 	rpc_mode = MultiplayerAPI::RPC_MODE_DISABLED;
 	name = "<anonymous>";
 #ifdef DEBUG_ENABLED
@@ -1794,6 +2594,65 @@ GDScriptFunction::~GDScriptFunction() {
 
 /////////////////////
 
+Mutex GDScriptFramePool::mutex;
+GDScriptFramePool::FreeFrame *GDScriptFramePool::free_frames[SIZE_CLASS_COUNT] = {};
+
+int GDScriptFramePool::_get_size_class(uint32_t p_size) {
+
+	int size_class = 0;
+	while ((uint32_t(1) << (size_class + MIN_SIZE_SHIFT)) < p_size) {
+		size_class++;
+	}
+	return size_class;
+}
+
+uint8_t *GDScriptFramePool::alloc(uint32_t p_size) {
+
+	int size_class = _get_size_class(p_size);
+	if (size_class >= SIZE_CLASS_COUNT) {
+		return (uint8_t *)memalloc(p_size);
+	}
+
+	{
+		MutexLock lock(mutex);
+		FreeFrame *frame = free_frames[size_class];
+		if (frame) {
+			free_frames[size_class] = frame->next;
+			return (uint8_t *)frame;
+		}
+	}
+
+	return (uint8_t *)memalloc(size_t(1) << (size_class + MIN_SIZE_SHIFT));
+}
+
+void GDScriptFramePool::free(uint8_t *p_frame, uint32_t p_size) {
+
+	int size_class = _get_size_class(p_size);
+	if (size_class >= SIZE_CLASS_COUNT) {
+		memfree(p_frame);
+		return;
+	}
+
+	MutexLock lock(mutex);
+	FreeFrame *frame = (FreeFrame *)p_frame;
+	frame->next = free_frames[size_class];
+	free_frames[size_class] = frame;
+}
+
+void GDScriptFramePool::clear() {
+
+	MutexLock lock(mutex);
+	for (int i = 0; i < SIZE_CLASS_COUNT; i++) {
+		while (free_frames[i]) {
+			FreeFrame *frame = free_frames[i];
+			free_frames[i] = frame->next;
+			memfree(frame);
+		}
+	}
+}
+
+/////////////////////
+
 Variant GDScriptFunctionState::_signal_callback(const Variant **p_args, int p_argcount, Callable::CallError &r_error) {
 
 	Variant arg;
@@ -1881,18 +2740,30 @@ Variant GDScriptFunctionState::resume(const Variant &p_arg) {
 #ifdef DEBUG_ENABLED
 		if (EngineDebugger::is_active())
 			GDScriptLanguage::get_singleton()->exit_function();
-		if (state.stack_size) {
-			//free stack
-			Variant *stack = (Variant *)state.stack.ptr();
-			for (int i = 0; i < state.stack_size; i++)
-				stack[i].~Variant();
-		}
 #endif
 	}
 
+	// Still set if the call did not yield again.
+	_release_frame();
+
 	return ret;
 }
 
+void GDScriptFunctionState::_release_frame() {
+
+	if (!state.frame) {
+		return;
+	}
+
+	Variant *stack = (Variant *)state.frame;
+	for (int i = 0; i < state.stack_size; i++) {
+		stack[i].~Variant();
+	}
+
+	GDScriptFramePool::free(state.frame, state.alloca_size);
+	state.frame = nullptr;
+}
+
 void GDScriptFunctionState::_bind_methods() {
 
 	ClassDB::bind_method(D_METHOD("resume", "arg"), &GDScriptFunctionState::resume, DEFVAL(Variant()));
@@ -1909,11 +2780,6 @@ GDScriptFunctionState::GDScriptFunctionState() {
 
 GDScriptFunctionState::~GDScriptFunctionState() {
 
-	if (function != nullptr) {
-		//never called, deinitialize stack
-		for (int i = 0; i < state.stack_size; i++) {
-			Variant *v = (Variant *)&state.stack[sizeof(Variant) * i];
-			v->~Variant();
-		}
-	}
+	//never resumed, deinitialize stack
+	_release_frame();
 }
@@ -31,6 +31,7 @@
 #ifndef GDSCRIPT_FUNCTION_H
 #define GDSCRIPT_FUNCTION_H
 
+#include "core/os/mutex.h"
 #include "core/os/thread.h"
 #include "core/pair.h"
 #include "core/reference.h"
@@ -40,11 +41,39 @@
 #include "core/variant.h"
 
 class GDScriptInstance;
+class MethodBind;
 class GDScript;
 
+// Frames of functions that can yield are taken from here instead of the C
+// stack. Yielding hands the frame to the GDScriptFunctionState as it is, and
+// resuming runs on it again, so suspended calls are neither copied nor given
+// new storage. Released frames are kept in free lists by power of two size
+// and reused by the next calls.
+class GDScriptFramePool {
+
+	enum {
+		MIN_SIZE_SHIFT = 6,
+		SIZE_CLASS_COUNT = 15, // 64 bytes to 1 MiB, larger frames are not pooled.
+	};
+
+	struct FreeFrame {
+		FreeFrame *next;
+	};
+
+	static Mutex mutex;
+	static FreeFrame *free_frames[SIZE_CLASS_COUNT];
+
+	static int _get_size_class(uint32_t p_size);
+
+public:
+	static uint8_t *alloc(uint32_t p_size);
+	static void free(uint8_t *p_frame, uint32_t p_size);
+	static void clear();
+};
+
 struct GDScriptDataType {
 	bool has_type;
-	enum {
+	enum Kind {
 		UNINITIALIZED,
 		BUILTIN,
 		NATIVE,
@@ -156,9 +185,15 @@ class GDScriptFunction {
 public:
 	enum Opcode {
 		OPCODE_OPERATOR,
+		OPCODE_OPERATOR_VALIDATED,
+		OPCODE_OPERATOR_INT,
+		OPCODE_OPERATOR_FLOAT,
+		OPCODE_INCREMENT_INT,
 		OPCODE_EXTENDS_TEST,
 		OPCODE_IS_BUILTIN,
+		OPCODE_SET_INDEXED_VALIDATED,
 		OPCODE_SET,
+		OPCODE_GET_INDEXED_VALIDATED,
 		OPCODE_GET,
 		OPCODE_SET_NAMED,
 		OPCODE_GET_NAMED,
@@ -176,8 +211,11 @@ public:
 		OPCODE_CONSTRUCT, //only for basic types!!
 		OPCODE_CONSTRUCT_ARRAY,
 		OPCODE_CONSTRUCT_DICTIONARY,
+		OPCODE_GET_MEMBER_CALL,
 		OPCODE_CALL,
 		OPCODE_CALL_RETURN,
+		OPCODE_CALL_BUILTIN_METHOD_VALIDATED,
+		OPCODE_CALL_METHOD_BIND,
 		OPCODE_CALL_BUILT_IN,
 		OPCODE_CALL_SELF,
 		OPCODE_CALL_SELF_BASE,
@@ -187,6 +225,7 @@ public:
 		OPCODE_JUMP,
 		OPCODE_JUMP_IF,
 		OPCODE_JUMP_IF_NOT,
+		OPCODE_JUMP_IF_NOT_COMPARE,
 		OPCODE_JUMP_TO_DEF_ARGUMENT,
 		OPCODE_RETURN,
 		OPCODE_ITERATE_BEGIN,
@@ -209,8 +248,8 @@ public:
 		ADDR_TYPE_STACK = 5,
 		ADDR_TYPE_STACK_VARIABLE = 6,
 		ADDR_TYPE_GLOBAL = 7,
-		ADDR_TYPE_NAMED_GLOBAL = 8,
-		ADDR_TYPE_NIL = 9
+		ADDR_TYPE_NIL = 8,
+		ADDR_TYPE_MAX = 9
 	};
 
 	struct StackDebug {
@@ -221,8 +260,42 @@ public:
 		StringName identifier;
 	};
 
+	// Typed instructions are emitted by the compiler when it knows the types of
+	// the operands, and resolve what they call ahead of time. The types are only
+	// hints, so they are checked again before use and the instruction takes the
+	// generic path when they don't match.
+
+	struct ValidatedOperator {
+		Variant::ValidatedOperatorEvaluator evaluator;
+		Variant::Operator op;
+		Variant::Type type_a;
+		Variant::Type type_b;
+	};
+
+	struct ValidatedBuiltinMethod {
+		Variant::ValidatedBuiltInMethod method;
+		Variant::Type base_type;
+		Vector<Variant::Type> argument_types; // NIL takes any value.
+		bool has_return;
+		StringName name;
+	};
+
+	struct MethodBindCall {
+		MethodBind *method;
+		void *class_ptr;
+		StringName name;
+#ifdef PTRCALL_ENABLED
+		// Set when all argument and return types are known and can be passed
+		// without conversion, so the call can skip Variant marshalling.
+		bool ptrcall;
+		Vector<Variant::Type> argument_types; // NIL takes any value.
+		Variant::Type return_type;
+#endif
+	};
+
 private:
 	friend class GDScriptCompiler;
+	friend class GDScriptCompiledBuffer;
 
 	StringName source;
 
@@ -231,10 +304,14 @@ private:
 	int _constant_count;
 	const StringName *_global_names_ptr;
 	int _global_names_count;
-#ifdef TOOLS_ENABLED
-	const StringName *_named_globals_ptr;
-	int _named_globals_count;
-#endif
+	const ValidatedOperator *_validated_operators_ptr;
+	int _validated_operators_count;
+	const ValidatedBuiltinMethod *_validated_builtin_methods_ptr;
+	int _validated_builtin_methods_count;
+	const MethodBindCall *_method_bind_calls_ptr;
+	int _method_bind_calls_count;
+	const int *_global_variables_ptr;
+	int _global_variables_count;
 	const int *_default_arg_ptr;
 	int _default_arg_count;
 	const int *_code_ptr;
@@ -244,6 +321,7 @@ private:
 	int _call_size;
 	int _initial_line;
 	bool _static;
+	bool _has_yield;
 	MultiplayerAPI::RPCMode rpc_mode;
 
 	GDScript *_script;
@@ -251,9 +329,14 @@ private:
 	StringName name;
 	Vector<Variant> constants;
 	Vector<StringName> global_names;
-#ifdef TOOLS_ENABLED
-	Vector<StringName> named_globals;
-#endif
+	Vector<ValidatedOperator> validated_operators;
+	Vector<ValidatedBuiltinMethod> validated_builtin_methods;
+	Vector<MethodBindCall> method_bind_calls;
+	// Globals are addressed through these tables so the code doesn't depend on
+	// the layout of the language global array. Autoloads are only known by
+	// name in the editor, their index is -1 there.
+	Vector<StringName> global_variable_names;
+	Vector<int> global_variable_indices;
 	Vector<int> default_arguments;
 	Vector<int> code;
 	Vector<GDScriptDataType> argument_types;
@@ -267,6 +350,8 @@ private:
 
 	_FORCE_INLINE_ Variant *_get_variant(int p_address, GDScriptInstance *p_instance, GDScript *p_script, Variant &self, Variant &static_ref, Variant *p_stack, String &r_error) const;
 	_FORCE_INLINE_ String _get_call_error(const Callable::CallError &p_err, const String &p_where, const Variant **argptrs) const;
+	_FORCE_INLINE_ bool _evaluate_operator(Variant::Operator p_op, const Variant *p_a, const Variant *p_b, Variant *r_dst, String &r_error) const;
+	bool _resolve_global_variables();
 
 	friend class GDScriptLanguage;
 
@@ -295,7 +380,7 @@ public:
 
 		ObjectID instance_id;
 		GDScriptInstance *instance;
-		Vector<uint8_t> stack;
+		uint8_t *frame = nullptr; // From GDScriptFramePool, released by the state once the call completes.
 		int stack_size;
 		Variant self;
 		uint32_t alloca_size;
@@ -307,11 +392,16 @@ public:
 	};
 
 	_FORCE_INLINE_ bool is_static() const { return _static; }
+	_FORCE_INLINE_ bool has_yield() const { return _has_yield; }
 
 	const int *get_code() const; //used for debug
 	int get_code_size() const;
 	Variant get_constant(int p_idx) const;
 	StringName get_global_name(int p_idx) const;
+	StringName get_global_variable_name(int p_idx) const;
+	const ValidatedOperator &get_validated_operator(int p_idx) const;
+	const ValidatedBuiltinMethod &get_validated_builtin_method(int p_idx) const;
+	const MethodBindCall &get_method_bind_call(int p_idx) const;
 	StringName get_name() const;
 	int get_max_stack_size() const;
 	int get_default_argument_count() const;
@@ -355,6 +445,8 @@ class GDScriptFunctionState : public Reference {
 	Variant _signal_callback(const Variant **p_args, int p_argcount, Callable::CallError &r_error);
 	Ref<GDScriptFunctionState> first_state;
 
+	void _release_frame();
+
 protected:
 	static void _bind_methods();
 
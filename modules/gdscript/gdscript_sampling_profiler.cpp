@@ -0,0 +1,451 @@
+/*************************************************************************/
+/*  gdscript_sampling_profiler.cpp                                       */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "gdscript_sampling_profiler.h"
+
+#include "core/os/file_access.h"
+#include "core/os/os.h"
+
+static const char *_opcode_names[] = {
+	"OPERATOR",
+	"OPERATOR_VALIDATED",
+	"OPERATOR_INT",
+	"OPERATOR_FLOAT",
+	"INCREMENT_INT",
+	"EXTENDS_TEST",
+	"IS_BUILTIN",
+	"SET_INDEXED_VALIDATED",
+	"SET",
+	"GET_INDEXED_VALIDATED",
+	"GET",
+	"SET_NAMED",
+	"GET_NAMED",
+	"SET_MEMBER",
+	"GET_MEMBER",
+	"ASSIGN",
+	"ASSIGN_TRUE",
+	"ASSIGN_FALSE",
+	"ASSIGN_TYPED_BUILTIN",
+	"ASSIGN_TYPED_NATIVE",
+	"ASSIGN_TYPED_SCRIPT",
+	"CAST_TO_BUILTIN",
+	"CAST_TO_NATIVE",
+	"CAST_TO_SCRIPT",
+	"CONSTRUCT",
+	"CONSTRUCT_ARRAY",
+	"CONSTRUCT_DICTIONARY",
+	"GET_MEMBER_CALL",
+	"CALL",
+	"CALL_RETURN",
+	"CALL_BUILTIN_METHOD_VALIDATED",
+	"CALL_METHOD_BIND",
+	"CALL_BUILT_IN",
+	"CALL_SELF",
+	"CALL_SELF_BASE",
+	"YIELD",
+	"YIELD_SIGNAL",
+	"YIELD_RESUME",
+	"JUMP",
+	"JUMP_IF",
+	"JUMP_IF_NOT",
+	"JUMP_IF_NOT_COMPARE",
+	"JUMP_TO_DEF_ARGUMENT",
+	"RETURN",
+	"ITERATE_BEGIN",
+	"ITERATE",
+	"ASSERT",
+	"BREAKPOINT",
+	"LINE",
+	"END",
+};
+
+static_assert(sizeof(_opcode_names) / sizeof(*_opcode_names) == GDScriptFunction::OPCODE_END + 1, "Opcode names are out of sync with GDScriptFunction::Opcode.");
+
+std::atomic<uint32_t> GDScriptSamplingProfiler::tick(0);
+std::atomic<bool> GDScriptSamplingProfiler::running(false);
+std::atomic<bool> GDScriptSamplingProfiler::exit_thread(false);
+int GDScriptSamplingProfiler::interval_usec = 1000;
+uint64_t GDScriptSamplingProfiler::start_time = 0;
+uint64_t GDScriptSamplingProfiler::run_time = 0;
+Thread *GDScriptSamplingProfiler::thread = nullptr;
+Mutex GDScriptSamplingProfiler::states_mutex;
+Vector<GDScriptSamplingProfiler::ThreadState *> GDScriptSamplingProfiler::states;
+std::atomic<uint32_t> GDScriptSamplingProfiler::generation(0);
+thread_local GDScriptSamplingProfiler::ThreadState *GDScriptSamplingProfiler::thread_state = nullptr;
+thread_local uint32_t GDScriptSamplingProfiler::thread_state_generation = 0;
+StringName GDScriptSamplingProfiler::builtin_type_names[Variant::VARIANT_MAX];
+StringName GDScriptSamplingProfiler::builtin_func_owner;
+StringName GDScriptSamplingProfiler::builtin_func_names[GDScriptFunctions::FUNC_MAX];
+
+static String _get_location(const GDScriptFunction *p_function, int p_line) {
+
+	String source = p_function->get_source();
+	return (source.empty() ? String("<built-in>") : source) + ":" + itos(p_line);
+}
+
+uint32_t GDScriptSamplingProfiler::ThreadState::_take_ticks() {
+
+	uint32_t now = GDScriptSamplingProfiler::tick.load(std::memory_order_relaxed);
+	uint32_t elapsed = now - tick;
+	tick = now;
+	return elapsed;
+}
+
+void GDScriptSamplingProfiler::ThreadState::_record(int p_opcode, const NativeKey *p_native, uint32_t p_weight) {
+
+	// One frame per script function, named after the function and the line
+	// it is on, followed by the native method if the sample was taken on its
+	// return.
+	String stack;
+	for (int i = 0; i < MIN(depth, (int)MAX_DEPTH); i++) {
+		if (i > 0) {
+			stack += ";";
+		}
+		stack += String(frames[i].function->get_name()) + " (" + _get_location(frames[i].function, *frames[i].line) + ")";
+	}
+
+	String line;
+	if (depth > MAX_DEPTH) {
+		stack += ";[...]";
+	} else if (depth > 0) {
+		line = _get_location(frames[depth - 1].function, *frames[depth - 1].line);
+	}
+
+	if (p_native) {
+		stack += (stack.empty() ? "" : ";") + String(p_native->owner) + "." + String(p_native->method) + " (native)";
+	}
+
+	MutexLock lock(mutex);
+
+	stacks[stack] += p_weight;
+	if (!line.empty()) {
+		lines[line] += p_weight;
+	}
+
+	if (p_opcode >= 0 && p_opcode <= GDScriptFunction::OPCODE_END) {
+		opcodes[p_opcode] += p_weight;
+	}
+
+	if (p_native) {
+		native_calls[*p_native] += p_weight;
+	}
+}
+
+void GDScriptSamplingProfiler::ThreadState::_clear() {
+
+	MutexLock lock(mutex);
+
+	stacks.clear();
+	lines.clear();
+	for (int i = 0; i <= GDScriptFunction::OPCODE_END; i++) {
+		opcodes[i] = 0;
+	}
+	native_calls.clear();
+}
+
+void GDScriptSamplingProfiler::ThreadState::sample(int p_opcode) {
+
+	_record(p_opcode, nullptr, _take_ticks());
+}
+
+void GDScriptSamplingProfiler::ThreadState::sample_call(int p_opcode, const StringName &p_owner, const StringName &p_method) {
+
+	if (p_owner == StringName()) {
+		_record(p_opcode, nullptr, _take_ticks());
+		return;
+	}
+
+	NativeKey key;
+	key.owner = p_owner;
+	key.method = p_method;
+	_record(p_opcode, &key, _take_ticks());
+}
+
+void GDScriptSamplingProfiler::_thread_func(void *p_userdata) {
+
+	while (!exit_thread.load(std::memory_order_acquire)) {
+		OS::get_singleton()->delay_usec(interval_usec);
+		tick.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+GDScriptSamplingProfiler::ThreadState *GDScriptSamplingProfiler::_create_thread_state() {
+
+	// States are kept until finish(), as functions that were already running
+	// on a thread keep using its state after the thread is gone from scripts.
+	ThreadState *state = memnew(ThreadState);
+	state->tick = tick.load(std::memory_order_relaxed);
+
+	MutexLock lock(states_mutex);
+	states.push_back(state);
+	return state;
+}
+
+StringName GDScriptSamplingProfiler::get_call_owner(const Variant &p_base, const StringName &p_method) {
+
+	if (p_base.get_type() != Variant::OBJECT) {
+		return builtin_type_names[p_base.get_type()];
+	}
+
+	Object *obj = p_base.get_validated_object();
+	if (!obj) {
+		return StringName();
+	}
+
+	ScriptInstance *script_instance = obj->get_script_instance();
+	if (script_instance && script_instance->has_method(p_method)) {
+		return StringName();
+	}
+
+	return obj->get_class_name();
+}
+
+void GDScriptSamplingProfiler::start(int p_interval_usec) {
+
+	ERR_FAIL_COND_MSG(thread, "The GDScript sampling profiler is already running.");
+	ERR_FAIL_COND(p_interval_usec <= 0);
+
+	for (int i = 0; i < Variant::VARIANT_MAX; i++) {
+		builtin_type_names[i] = Variant::get_type_name(Variant::Type(i));
+	}
+	builtin_func_owner = "@GDScript";
+	for (int i = 0; i < GDScriptFunctions::FUNC_MAX; i++) {
+		builtin_func_names[i] = GDScriptFunctions::get_func_name(GDScriptFunctions::Function(i));
+	}
+
+	{
+		MutexLock lock(states_mutex);
+		for (int i = 0; i < states.size(); i++) {
+			states[i]->_clear();
+		}
+	}
+
+	interval_usec = p_interval_usec;
+	run_time = 0;
+	start_time = OS::get_singleton()->get_ticks_usec();
+	exit_thread.store(false, std::memory_order_release);
+	thread = Thread::create(_thread_func, nullptr);
+	running.store(true, std::memory_order_relaxed);
+}
+
+void GDScriptSamplingProfiler::stop() {
+
+	if (!thread) {
+		return;
+	}
+
+	running.store(false, std::memory_order_relaxed);
+	exit_thread.store(true, std::memory_order_release);
+	Thread::wait_to_finish(thread);
+	memdelete(thread);
+	thread = nullptr;
+	run_time = OS::get_singleton()->get_ticks_usec() - start_time;
+}
+
+void GDScriptSamplingProfiler::finish() {
+
+	stop();
+
+	MutexLock lock(states_mutex);
+	for (int i = 0; i < states.size(); i++) {
+		memdelete(states[i]);
+	}
+	states.clear();
+	thread_state = nullptr;
+	generation.fetch_add(1, std::memory_order_release);
+
+	for (int i = 0; i < Variant::VARIANT_MAX; i++) {
+		builtin_type_names[i] = StringName();
+	}
+	builtin_func_owner = StringName();
+	for (int i = 0; i < GDScriptFunctions::FUNC_MAX; i++) {
+		builtin_func_names[i] = StringName();
+	}
+}
+
+uint64_t GDScriptSamplingProfiler::get_sample_count() {
+
+	uint64_t count = 0;
+
+	MutexLock lock(states_mutex);
+	for (int i = 0; i < states.size(); i++) {
+		MutexLock state_lock(states[i]->mutex);
+		for (int j = 0; j <= GDScriptFunction::OPCODE_END; j++) {
+			count += states[i]->opcodes[j];
+		}
+	}
+
+	return count;
+}
+
+struct _SampledEntry {
+	String name;
+	uint64_t samples = 0;
+};
+
+struct _SampledEntrySort {
+	bool operator()(const _SampledEntry &p_a, const _SampledEntry &p_b) const {
+		if (p_a.samples != p_b.samples) {
+			return p_a.samples > p_b.samples;
+		}
+		return p_a.name < p_b.name;
+	}
+};
+
+static void _merge_samples(const HashMap<String, uint64_t> &p_from, HashMap<String, uint64_t> &r_to) {
+
+	const String *key = nullptr;
+	while ((key = p_from.next(key))) {
+		r_to[*key] += p_from[*key];
+	}
+}
+
+static Vector<_SampledEntry> _sorted_entries(const HashMap<String, uint64_t> &p_samples) {
+
+	Vector<_SampledEntry> entries;
+
+	const String *key = nullptr;
+	while ((key = p_samples.next(key))) {
+		_SampledEntry entry;
+		entry.name = *key;
+		entry.samples = p_samples[*key];
+		entries.push_back(entry);
+	}
+
+	entries.sort_custom<_SampledEntrySort>();
+	return entries;
+}
+
+static String _format_entries(const Vector<_SampledEntry> &p_entries, uint64_t p_total, int p_max_entries, const String &p_what, int p_interval_usec = 0) {
+
+	String text = String("samples").lpad(10) + String("%").lpad(8) + (p_interval_usec ? String("msec").lpad(10) : String()) + "  " + p_what + "\n";
+
+	for (int i = 0; i < MIN(p_entries.size(), p_max_entries); i++) {
+		const _SampledEntry &entry = p_entries[i];
+		text += itos(entry.samples).lpad(10) + String::num(entry.samples * 100.0 / MAX(p_total, (uint64_t)1), 2).lpad(8);
+		if (p_interval_usec) {
+			text += String::num(entry.samples * p_interval_usec / 1000.0, 1).lpad(10);
+		}
+		text += "  " + entry.name + "\n";
+	}
+
+	return text;
+}
+
+String GDScriptSamplingProfiler::get_folded_stacks() {
+
+	HashMap<String, uint64_t> stacks;
+	{
+		MutexLock lock(states_mutex);
+		for (int i = 0; i < states.size(); i++) {
+			MutexLock state_lock(states[i]->mutex);
+			_merge_samples(states[i]->stacks, stacks);
+		}
+	}
+
+	List<String> keys;
+	stacks.get_key_list(&keys);
+	keys.sort();
+
+	String folded;
+	for (List<String>::Element *E = keys.front(); E; E = E->next()) {
+		folded += E->get() + " " + itos(stacks[E->get()]) + "\n";
+	}
+
+	return folded;
+}
+
+String GDScriptSamplingProfiler::get_report(int p_max_entries) {
+
+	HashMap<String, uint64_t> lines;
+	uint64_t opcodes[GDScriptFunction::OPCODE_END + 1] = {};
+	HashMap<String, uint64_t> native_calls;
+	{
+		MutexLock lock(states_mutex);
+		for (int i = 0; i < states.size(); i++) {
+			ThreadState *state = states[i];
+			MutexLock state_lock(state->mutex);
+
+			_merge_samples(state->lines, lines);
+			for (int j = 0; j <= GDScriptFunction::OPCODE_END; j++) {
+				opcodes[j] += state->opcodes[j];
+			}
+
+			const ThreadState::NativeKey *key = nullptr;
+			while ((key = state->native_calls.next(key))) {
+				native_calls[String(key->owner) + "." + String(key->method)] += state->native_calls[*key];
+			}
+		}
+	}
+
+	uint64_t total = 0;
+	for (int i = 0; i <= GDScriptFunction::OPCODE_END; i++) {
+		total += opcodes[i];
+	}
+
+	uint64_t elapsed = thread ? OS::get_singleton()->get_ticks_usec() - start_time : run_time;
+	String report = "GDScript sampling profile: " + itos(total) + " samples every " + itos(interval_usec) + " usec over " + itos(elapsed / 1000) + " msec.\n";
+
+	report += "\nLines:\n";
+	report += _format_entries(_sorted_entries(lines), total, p_max_entries, "location");
+
+	report += "\nInstructions:\n";
+	HashMap<String, uint64_t> instructions;
+	for (int i = 0; i <= GDScriptFunction::OPCODE_END; i++) {
+		if (opcodes[i]) {
+			instructions[_opcode_names[i]] = opcodes[i];
+		}
+	}
+	report += _format_entries(_sorted_entries(instructions), total, p_max_entries, "opcode");
+
+	// The time in a native method is estimated from the samples taken on its
+	// return, which are weighted by the ticks spent in it.
+	report += "\nNative calls:\n";
+	report += _format_entries(_sorted_entries(native_calls), total, p_max_entries, "method", interval_usec);
+
+	return report;
+}
+
+Error GDScriptSamplingProfiler::save(const String &p_path) {
+
+	Error err;
+	FileAccess *f = FileAccess::open(p_path, FileAccess::WRITE, &err);
+	ERR_FAIL_COND_V_MSG(!f, err, "Cannot save GDScript profile to '" + p_path + "'.");
+	f->store_string(get_folded_stacks());
+	memdelete(f);
+
+	String report_path = p_path.get_basename() + ".report.txt";
+	f = FileAccess::open(report_path, FileAccess::WRITE, &err);
+	ERR_FAIL_COND_V_MSG(!f, err, "Cannot save GDScript profile report to '" + report_path + "'.");
+	f->store_string(get_report());
+	memdelete(f);
+
+	return OK;
+}
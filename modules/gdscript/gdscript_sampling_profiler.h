@@ -0,0 +1,182 @@
+/*************************************************************************/
+/*  gdscript_sampling_profiler.h                                         */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef GDSCRIPT_SAMPLING_PROFILER_H
+#define GDSCRIPT_SAMPLING_PROFILER_H
+
+#include "core/hash_map.h"
+#include "core/os/mutex.h"
+#include "core/os/thread.h"
+#include "gdscript_function.h"
+#include "gdscript_functions.h"
+
+#include <atomic>
+
+// Statistical profiler for finding script hot spots in runs without the
+// debugger, such as headless runs on a build machine. A timer thread advances
+// a tick at a fixed interval. Each thread running scripts notices the new tick
+// the next time it dispatches an instruction or returns from a native call,
+// and records a sample: the script call stack with the current line of every
+// frame, the instruction about to run, and the native method that was called
+// if any. The sample is weighted by the ticks elapsed since the last one, so
+// the time spent in long native calls is not undercounted. Nothing is timed
+// per call, the cost on the interpreter is a check of the tick per dispatch.
+//
+// The samples are saved as folded stacks, which flamegraph.pl, inferno and
+// speedscope read as they are, next to a report of the hottest lines,
+// instructions and native calls.
+class GDScriptSamplingProfiler {
+public:
+	enum {
+		MAX_DEPTH = 256,
+	};
+
+	class ThreadState {
+
+		friend class GDScriptSamplingProfiler;
+
+		struct Frame {
+			const GDScriptFunction *function;
+			const int *line;
+		};
+
+		struct NativeKey {
+			StringName owner;
+			StringName method;
+
+			bool operator==(const NativeKey &p_key) const { return owner == p_key.owner && method == p_key.method; }
+			static uint32_t hash(const NativeKey &p_key) { return hash_djb2_one_32(p_key.method.hash(), p_key.owner.hash()); }
+		};
+
+		// Only touched by the owner thread.
+		uint32_t tick = 0;
+		int depth = 0;
+		Frame frames[MAX_DEPTH];
+
+		// Collected data, also read when saving.
+		Mutex mutex;
+		HashMap<String, uint64_t> stacks;
+		HashMap<String, uint64_t> lines;
+		uint64_t opcodes[GDScriptFunction::OPCODE_END + 1] = {};
+		HashMap<NativeKey, uint64_t, NativeKey> native_calls;
+
+		uint32_t _take_ticks();
+		void _record(int p_opcode, const NativeKey *p_native, uint32_t p_weight);
+		void _clear();
+
+	public:
+		_FORCE_INLINE_ bool is_sample_pending() const {
+			return tick != GDScriptSamplingProfiler::tick.load(std::memory_order_relaxed);
+		}
+
+		_FORCE_INLINE_ void enter(const GDScriptFunction *p_function, const int *p_line) {
+			if (depth == 0) {
+				// Time spent outside of scripts is not attributed to the next sample.
+				tick = GDScriptSamplingProfiler::tick.load(std::memory_order_relaxed);
+			}
+			if (depth < MAX_DEPTH) {
+				frames[depth].function = p_function;
+				frames[depth].line = p_line;
+			}
+			depth++;
+		}
+
+		_FORCE_INLINE_ void exit() {
+			depth--;
+		}
+
+		void sample(int p_opcode);
+		// Sample taken on return from a native call. An empty owner means the
+		// call ran a script method, which has frames of its own.
+		void sample_call(int p_opcode, const StringName &p_owner, const StringName &p_method);
+	};
+
+private:
+	static std::atomic<uint32_t> tick;
+	static std::atomic<bool> running;
+	static std::atomic<bool> exit_thread;
+	static int interval_usec;
+	static uint64_t start_time;
+	static uint64_t run_time;
+	static Thread *thread;
+
+	static Mutex states_mutex;
+	static Vector<ThreadState *> states;
+	// finish() frees the states of all threads but can only reset the cached
+	// pointer of its own, the others see the generation changed instead.
+	static std::atomic<uint32_t> generation;
+	static thread_local ThreadState *thread_state;
+	static thread_local uint32_t thread_state_generation;
+
+	static StringName builtin_type_names[Variant::VARIANT_MAX];
+	static StringName builtin_func_owner;
+	static StringName builtin_func_names[GDScriptFunctions::FUNC_MAX];
+
+	static void _thread_func(void *p_userdata);
+	static ThreadState *_create_thread_state();
+
+public:
+	_FORCE_INLINE_ static bool is_running() {
+		return running.load(std::memory_order_relaxed);
+	}
+
+	_FORCE_INLINE_ static ThreadState *get_thread_state() {
+		uint32_t current = generation.load(std::memory_order_acquire);
+		if (unlikely(!thread_state || thread_state_generation != current)) {
+			thread_state = _create_thread_state();
+			thread_state_generation = current;
+		}
+		return thread_state;
+	}
+
+	// Name of the class or builtin type whose native method runs for this call,
+	// empty when the call runs a script method instead.
+	static StringName get_call_owner(const Variant &p_base, const StringName &p_method);
+	_FORCE_INLINE_ static const StringName &get_builtin_func_owner() {
+		return builtin_func_owner;
+	}
+	_FORCE_INLINE_ static const StringName &get_builtin_func_name(GDScriptFunctions::Function p_func) {
+		return builtin_func_names[p_func];
+	}
+
+	static void start(int p_interval_usec);
+	static void stop();
+	static void finish(); // Must not be called while scripts are running.
+
+	static uint64_t get_sample_count();
+	static String get_folded_stacks();
+	static String get_report(int p_max_entries = 50);
+
+	// Saves the folded stacks to p_path, and the report next to it with a
+	// ".report.txt" extension.
+	static Error save(const String &p_path);
+};
+
+#endif // GDSCRIPT_SAMPLING_PROFILER_H
@@ -35,7 +35,7 @@
 #include "core/os/dir_access.h"
 #include "core/os/file_access.h"
 #include "gdscript.h"
-#include "gdscript_tokenizer.h"
+#include "gdscript_compiled_buffer.h"
 
 GDScriptLanguage *script_language_gd = nullptr;
 Ref<ResourceFormatLoaderGDScript> resource_loader_gd;
@@ -79,7 +79,7 @@ public:
 
 		String txt;
 		txt.parse_utf8((const char *)file.ptr(), file.size());
-		file = GDScriptTokenizerBuffer::parse_code_string(txt);
+		file = GDScriptCompiledBuffer::parse_code_string(txt, p_path);
 
 		if (!file.empty()) {
 
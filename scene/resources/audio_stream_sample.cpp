@@ -464,6 +464,10 @@ bool AudioStreamSample::is_stereo() const {
 float AudioStreamSample::get_length() const {
 
 	int len = data_bytes;
+	const DeferredProperty *deferred = get_deferred_property("data");
+	if (deferred) {
+		len = deferred->length;
+	}
 	switch (format) {
 		case AudioStreamSample::FORMAT_8_BITS: len /= 1; break;
 		case AudioStreamSample::FORMAT_16_BITS: len /= 2; break;
@@ -477,8 +481,25 @@ float AudioStreamSample::get_length() const {
 	return float(len) / mix_rate;
 }
 
+void AudioStreamSample::_load_deferred_data() const {
+
+	if (!get_deferred_property("data")) {
+		return;
+	}
+	// Left in the file by the loader, read it now that it's needed.
+	AudioStreamSample *self = const_cast<AudioStreamSample *>(this);
+	self->set_data(load_deferred_property("data"));
+}
+
+bool AudioStreamSample::can_defer_property(const StringName &p_property) const {
+
+	return p_property == "data";
+}
+
 void AudioStreamSample::set_data(const Vector<uint8_t> &p_data) {
 
+	clear_deferred_property("data");
+
 	AudioServer::get_singleton()->lock();
 	if (data) {
 		memfree(data);
@@ -502,6 +523,8 @@ void AudioStreamSample::set_data(const Vector<uint8_t> &p_data) {
 }
 Vector<uint8_t> AudioStreamSample::get_data() const {
 
+	_load_deferred_data();
+
 	Vector<uint8_t> pv;
 
 	if (data) {
@@ -523,6 +546,8 @@ Error AudioStreamSample::save_to_wav(const String &p_path) {
 		return ERR_UNAVAILABLE;
 	}
 
+	_load_deferred_data();
+
 	int sub_chunk_2_size = data_bytes; //Subchunk2Size = Size of data in bytes
 
 	// Format code
@@ -593,6 +618,8 @@ Error AudioStreamSample::save_to_wav(const String &p_path) {
 
 Ref<AudioStreamPlayback> AudioStreamSample::instance_playback() {
 
+	_load_deferred_data();
+
 	Ref<AudioStreamPlaybackSample> sample;
 	sample.instance();
 	sample->base = Ref<AudioStreamSample>(this);
@@ -114,6 +114,8 @@ private:
 	void *data;
 	uint32_t data_bytes;
 
+	void _load_deferred_data() const;
+
 protected:
 	static void _bind_methods();
 
@@ -143,6 +145,8 @@ public:
 
 	Error save_to_wav(const String &p_path);
 
+	virtual bool can_defer_property(const StringName &p_property) const;
+
 	virtual Ref<AudioStreamPlayback> instance_playback();
 	virtual String get_stream_name() const;
 
@@ -387,20 +387,22 @@ Ref<Image> StreamTexture::load_image_from_file(FileAccess *f, int p_size_limit)
 				continue;
 			}
 
+			// Decode straight from the file's memory when it has some (e.g. a mapped pack).
 			Vector<uint8_t> pv;
-			pv.resize(size);
-			{
-				uint8_t *wr = pv.ptrw();
-				f->get_buffer(wr, size);
+			const uint8_t *src = f->get_buffer_view(size);
+			if (!src) {
+				pv.resize(size);
+				f->get_buffer(pv.ptrw(), size);
+				src = pv.ptr();
 			}
 
 			Ref<Image> img;
 			if (data_format == DATA_FORMAT_BASIS_UNIVERSAL) {
-				img = Image::basis_universal_unpacker(pv);
+				img = Image::basis_universal_unpacker(src, size);
 			} else if (data_format == DATA_FORMAT_LOSSLESS) {
-				img = Image::lossless_unpacker(pv);
+				img = Image::lossless_unpacker(src, size);
 			} else {
-				img = Image::lossy_unpacker(pv);
+				img = Image::lossy_unpacker(src, size);
 			}
 
 			if (img.is_null() || img->empty()) {
@@ -2093,13 +2095,14 @@ RES ResourceFormatLoaderTextureLayered::load(const String &p_path, const String
 				uint32_t size = f->get_32();
 
 				Vector<uint8_t> pv;
-				pv.resize(size);
-				{
-					uint8_t *w = pv.ptrw();
-					f->get_buffer(w, size);
+				const uint8_t *src = f->get_buffer_view(size);
+				if (!src) {
+					pv.resize(size);
+					f->get_buffer(pv.ptrw(), size);
+					src = pv.ptr();
 				}
 
-				Ref<Image> img = Image::lossless_unpacker(pv);
+				Ref<Image> img = Image::lossless_unpacker(src, size);
 
 				if (img.is_null() || img->empty() || format != img->get_format()) {
 					if (r_error) {